@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+
+#include <cmath>
+#include <fstream>
+
+#include "SyntheticScan.h"
+
+namespace
+{
+   constexpr double cScale = 0.0001;
+
+   // Largest coordinate which fits the type (with some room to spare for ScaledIntegers)
+   double coordinateLimit( SyntheticScan::Coordinates coordinates )
+   {
+      switch ( coordinates )
+      {
+         case SyntheticScan::Coordinates::ScaledInteger16:
+            return 32'767 * cScale;
+         case SyntheticScan::Coordinates::ScaledInteger24:
+            return 8'388'607 * cScale;
+         case SyntheticScan::Coordinates::ScaledInteger32:
+            return 2'147'483'647 * cScale;
+         default:
+            return 100.0;
+      }
+   }
+}
+
+namespace SyntheticScan
+{
+   void AllSpecs( benchmark::internal::Benchmark *bench )
+   {
+      const unsigned attributeSets[] = { None, Color | Intensity, Normals };
+
+      for ( const auto coordinates : { Coordinates::Float, Coordinates::Double,
+                                       Coordinates::ScaledInteger16, Coordinates::ScaledInteger24,
+                                       Coordinates::ScaledInteger32 } )
+      {
+         for ( const unsigned attributes : attributeSets )
+         {
+            bench->Args( { static_cast<int64_t>( coordinates ), attributes } );
+         }
+      }
+   }
+
+   Spec SpecFromState( const benchmark::State &state )
+   {
+      Spec spec;
+      spec.coordinates = static_cast<Coordinates>( state.range( 0 ) );
+      spec.attributes = static_cast<unsigned>( state.range( 1 ) );
+
+      return spec;
+   }
+
+   std::string Label( const Spec &spec )
+   {
+      std::string label;
+
+      switch ( spec.coordinates )
+      {
+         case Coordinates::Float:
+            label = "float";
+            break;
+         case Coordinates::Double:
+            label = "double";
+            break;
+         case Coordinates::ScaledInteger16:
+            label = "scaled16";
+            break;
+         case Coordinates::ScaledInteger24:
+            label = "scaled24";
+            break;
+         case Coordinates::ScaledInteger32:
+            label = "scaled32";
+            break;
+      }
+
+      if ( spec.attributes & Color )
+      {
+         label += "+color";
+      }
+
+      if ( spec.attributes & Intensity )
+      {
+         label += "+intensity";
+      }
+
+      if ( spec.attributes & Normals )
+      {
+         label += "+normals";
+      }
+
+      if ( spec.attributes & Grid )
+      {
+         label += "+grid";
+      }
+
+      return label;
+   }
+
+   e57::Data3D Header( const Spec &spec )
+   {
+      e57::Data3D header;
+      header.guid = "Synthetic Scan GUID";
+      header.pointCount = cPointCount;
+
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      const double limit = coordinateLimit( spec.coordinates );
+
+      header.pointFields.pointRangeMinimum = -limit;
+      header.pointFields.pointRangeMaximum = limit;
+
+      switch ( spec.coordinates )
+      {
+         case Coordinates::Float:
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::Float;
+            break;
+         case Coordinates::Double:
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::Double;
+            break;
+         default:
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+            header.pointFields.pointRangeScale = cScale;
+            break;
+      }
+
+      if ( spec.attributes & Color )
+      {
+         header.pointFields.colorRedField = true;
+         header.pointFields.colorGreenField = true;
+         header.pointFields.colorBlueField = true;
+
+         header.colorLimits.colorRedMaximum = 255;
+         header.colorLimits.colorGreenMaximum = 255;
+         header.colorLimits.colorBlueMaximum = 255;
+      }
+
+      if ( spec.attributes & Intensity )
+      {
+         header.pointFields.intensityField = true;
+         header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+
+         header.intensityLimits.intensityMinimum = 0;
+         header.intensityLimits.intensityMaximum = 4'095;
+      }
+
+      if ( spec.attributes & Normals )
+      {
+         header.pointFields.normalXField = true;
+         header.pointFields.normalYField = true;
+         header.pointFields.normalZField = true;
+      }
+
+      if ( spec.attributes & Grid )
+      {
+         header.pointFields.rowIndexField = true;
+         header.pointFields.rowIndexMaximum = cRows - 1;
+         header.pointFields.columnIndexField = true;
+         header.pointFields.columnIndexMaximum = cColumns - 1;
+      }
+
+      return header;
+   }
+
+   void Fill( const e57::Data3D &header, e57::Data3DPointsDouble &points )
+   {
+      const double limit = header.pointFields.pointRangeMaximum * 0.9;
+
+      for ( int64_t i = 0; i < header.pointCount; ++i )
+      {
+         const int64_t row = i / cColumns;
+         const int64_t column = i % cColumns;
+
+         const double u = static_cast<double>( column ) / cColumns * 2.0 - 1.0;
+         const double v = static_cast<double>( row ) / cRows * 2.0 - 1.0;
+         const double w = std::sin( u * 3.0 ) * std::cos( v * 2.0 );
+
+         points.cartesianX[i] = u * limit;
+         points.cartesianY[i] = v * limit;
+         points.cartesianZ[i] = w * limit * 0.5;
+
+         if ( points.colorRed != nullptr )
+         {
+            points.colorRed[i] = static_cast<uint16_t>( ( column * 255 ) / cColumns );
+            points.colorGreen[i] = static_cast<uint16_t>( ( row * 255 ) / cRows );
+            points.colorBlue[i] = static_cast<uint16_t>( ( w + 1.0 ) * 127.5 );
+         }
+
+         if ( points.intensity != nullptr )
+         {
+            points.intensity[i] = std::floor( ( w + 1.0 ) * 2'047.0 );
+         }
+
+         if ( points.normalX != nullptr )
+         {
+            // Not quite normal to the surface, but unit length and just as smooth
+            const double length = std::sqrt( u * u + v * v + 1.0 );
+
+            points.normalX[i] = static_cast<float>( u / length );
+            points.normalY[i] = static_cast<float>( v / length );
+            points.normalZ[i] = static_cast<float>( 1.0 / length );
+         }
+
+         if ( points.rowIndex != nullptr )
+         {
+            points.rowIndex[i] = static_cast<int32_t>( row );
+            points.columnIndex[i] = static_cast<int32_t>( column );
+         }
+      }
+   }
+
+   int64_t Write( const std::string &fileName, const Spec &spec,
+                  const e57::WriterOptions &options )
+   {
+      e57::Data3D header = Header( spec );
+      e57::Data3DPointsDouble points( header );
+
+      Fill( header, points );
+
+      {
+         e57::Writer writer( fileName, options );
+         writer.WriteData3DData( header, points );
+      }
+
+      return FileSize( fileName );
+   }
+
+   int64_t FileSize( const std::string &fileName )
+   {
+      std::ifstream file( fileName, std::ifstream::ate | std::ifstream::binary );
+      return static_cast<int64_t>( file.tellg() );
+   }
+}
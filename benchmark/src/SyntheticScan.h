@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "E57SimpleWriter.h"
+
+/// Structured scans made up for benchmarking, written with the Simple API
+namespace SyntheticScan
+{
+   /// How the cartesian coordinates are stored
+   enum class Coordinates
+   {
+      Float,
+      Double,
+      ScaledInteger16, ///< ScaledInteger using 16 bits (0.1 mm over +/- 3.2 m)
+      ScaledInteger24, ///< ScaledInteger using 24 bits (0.1 mm over +/- 838 m)
+      ScaledInteger32, ///< ScaledInteger using 32 bits (0.1 mm over +/- 214 km)
+   };
+
+   /// Fields stored along with the coordinates
+   enum Attributes : unsigned
+   {
+      None = 0,
+      Color = 1,     ///< colorRed, colorGreen, and colorBlue as 8-bit Integers
+      Intensity = 2, ///< intensity as a 12-bit Integer
+      Normals = 4,   ///< nor:normalX, nor:normalY, and nor:normalZ as single precision floats
+      Grid = 8,      ///< rowIndex and columnIndex
+   };
+
+   struct Spec
+   {
+      Coordinates coordinates = Coordinates::Double;
+      unsigned attributes = None;
+   };
+
+   /// Number of points in the scans (a grid of rows x columns)
+   constexpr int64_t cRows = 1'000;
+   constexpr int64_t cColumns = 1'000;
+   constexpr int64_t cPointCount = cRows * cColumns;
+
+   /// Register each kind of coordinates with and without the other fields as the arguments of a
+   /// benchmark. Use SpecFromState() to get them back.
+   void AllSpecs( benchmark::internal::Benchmark *bench );
+
+   Spec SpecFromState( const benchmark::State &state );
+
+   /// A short description, e.g. "scaled24+color+intensity"
+   std::string Label( const Spec &spec );
+
+   e57::Data3D Header( const Spec &spec );
+
+   /// Fill the buffers of a header from Header() with a smooth surface scanned row by row
+   void Fill( const e57::Data3D &header, e57::Data3DPointsDouble &points );
+
+   /// Write a file with one scan
+   /// @returns The size of the file in bytes
+   int64_t Write( const std::string &fileName, const Spec &spec,
+                  const e57::WriterOptions &options = {} );
+
+   int64_t FileSize( const std::string &fileName );
+}
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: MIT
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "E57SimpleReader.h"
+#include "E57SimpleWriter.h"
+
+#include "SyntheticScan.h"
+
+namespace
+{
+   constexpr size_t cBufferSize = 64 * 1024;
+
+   enum class Codec
+   {
+      BitPack,   ///< the standard codec
+      Deflate,   ///< see WriterOptions::deflateLevel
+      Delta,     ///< see WriterOptions::deltaCodecFields
+      RunLength, ///< see WriterOptions::runLengthCodecFields
+   };
+
+   const char *codecName( Codec codec )
+   {
+      switch ( codec )
+      {
+         case Codec::BitPack:
+            return "bitPack";
+         case Codec::Deflate:
+            return "deflate";
+         case Codec::Delta:
+            return "delta";
+         case Codec::RunLength:
+            return "runLength";
+      }
+
+      return "";
+   }
+
+   void allCodecs( benchmark::internal::Benchmark *bench )
+   {
+      for ( const auto codec : { Codec::BitPack, Codec::Deflate, Codec::Delta, Codec::RunLength } )
+      {
+         bench->Arg( static_cast<int64_t>( codec ) );
+      }
+   }
+
+   e57::WriterOptions optionsFor( Codec codec )
+   {
+      e57::WriterOptions options;
+
+      switch ( codec )
+      {
+         case Codec::BitPack:
+            break;
+         case Codec::Deflate:
+            options.deflateLevel = 6;
+            break;
+         case Codec::Delta:
+            options.deltaCodecFields = { "rowIndex", "columnIndex", "cartesianX", "cartesianY",
+                                         "cartesianZ" };
+            break;
+         case Codec::RunLength:
+            options.runLengthCodecFields = { "rowIndex" };
+            break;
+      }
+
+      return options;
+   }
+
+   // A structured scan, which is what the codecs other than bitPack are meant for
+   SyntheticScan::Spec codecSpec()
+   {
+      SyntheticScan::Spec spec;
+      spec.coordinates = SyntheticScan::Coordinates::ScaledInteger24;
+      spec.attributes = SyntheticScan::Grid | SyntheticScan::Intensity;
+
+      return spec;
+   }
+
+   std::string fileNameFor( Codec codec )
+   {
+      return std::string( "./benchCodec-" ) + codecName( codec ) + ".e57";
+   }
+
+   void BM_Encode( benchmark::State &state )
+   {
+      const auto codec = static_cast<Codec>( state.range( 0 ) );
+      const e57::WriterOptions options = optionsFor( codec );
+      const std::string fileName = fileNameFor( codec );
+
+      e57::Data3D header = SyntheticScan::Header( codecSpec() );
+      e57::Data3DPointsDouble points( header );
+
+      SyntheticScan::Fill( header, points );
+
+      try
+      {
+         for ( auto _ : state )
+         {
+            e57::Writer writer( fileName, options );
+
+            e57::Data3D scanHeader = header;
+            writer.WriteData3DData( scanHeader, points );
+         }
+      }
+      catch ( const e57::E57Exception &e )
+      {
+         // e.g. deflate without E57_WITH_ZLIB
+         state.SkipWithError( e.errorStr().c_str() );
+         return;
+      }
+
+      state.SetLabel( codecName( codec ) );
+      state.SetItemsProcessed( state.iterations() * header.pointCount );
+      state.SetBytesProcessed( state.iterations() * SyntheticScan::FileSize( fileName ) );
+   }
+
+   void BM_Decode( benchmark::State &state )
+   {
+      const auto codec = static_cast<Codec>( state.range( 0 ) );
+      const std::string fileName = fileNameFor( codec );
+
+      int64_t fileSize = 0;
+
+      try
+      {
+         fileSize = SyntheticScan::Write( fileName, codecSpec(), optionsFor( codec ) );
+      }
+      catch ( const e57::E57Exception &e )
+      {
+         state.SkipWithError( e.errorStr().c_str() );
+         return;
+      }
+
+      e57::Reader reader( fileName, {} );
+
+      e57::Data3D header;
+      reader.ReadData3D( 0, header );
+
+      e57::Data3D bufferHeader = header;
+      bufferHeader.pointCount = cBufferSize;
+
+      e57::Data3DPointsDouble points( bufferHeader );
+
+      for ( auto _ : state )
+      {
+         auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, points );
+
+         while ( vectorReader.read() > 0 )
+         {
+            benchmark::DoNotOptimize( points.rowIndex[0] );
+         }
+
+         vectorReader.close();
+      }
+
+      state.SetLabel( codecName( codec ) );
+      state.SetItemsProcessed( state.iterations() * header.pointCount );
+      state.SetBytesProcessed( state.iterations() * fileSize );
+   }
+}
+
+BENCHMARK( BM_Encode )->Apply( allCodecs )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Decode )->Apply( allCodecs )->Unit( benchmark::kMillisecond );
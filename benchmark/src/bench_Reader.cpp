@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: MIT
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "E57SimpleReader.h"
+
+#include "SyntheticScan.h"
+
+namespace
+{
+   constexpr size_t cBufferSize = 64 * 1024;
+
+   // Write the file for a spec the first time it is needed
+   // @returns its size
+   int64_t prepareFile( const SyntheticScan::Spec &spec, std::string &fileName )
+   {
+      static std::map<std::string, int64_t> written;
+
+      fileName = "./benchReader-" + SyntheticScan::Label( spec ) + ".e57";
+
+      auto found = written.find( fileName );
+
+      if ( found == written.end() )
+      {
+         found = written.emplace( fileName, SyntheticScan::Write( fileName, spec ) ).first;
+      }
+
+      return found->second;
+   }
+
+   // Read a whole scan with the Simple API, which converts and scales it to doubles
+   void BM_Reader( benchmark::State &state )
+   {
+      const SyntheticScan::Spec spec = SyntheticScan::SpecFromState( state );
+      std::string fileName;
+      const int64_t fileSize = prepareFile( spec, fileName );
+
+      e57::Reader reader( fileName, {} );
+
+      e57::Data3D header;
+      reader.ReadData3D( 0, header );
+
+      // Buffers for cBufferSize points
+      e57::Data3D bufferHeader = header;
+      bufferHeader.pointCount = cBufferSize;
+
+      e57::Data3DPointsDouble points( bufferHeader );
+
+      for ( auto _ : state )
+      {
+         auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, points );
+
+         while ( vectorReader.read() > 0 )
+         {
+            benchmark::DoNotOptimize( points.cartesianX[0] );
+         }
+
+         vectorReader.close();
+      }
+
+      state.SetLabel( SyntheticScan::Label( spec ) );
+      state.SetItemsProcessed( state.iterations() * header.pointCount );
+      state.SetBytesProcessed( state.iterations() * fileSize );
+   }
+
+   // Read a whole scan with the Simple API, split into ranges read by one thread per hardware
+   // thread
+   void BM_Reader_Parallel( benchmark::State &state )
+   {
+      const SyntheticScan::Spec spec = SyntheticScan::SpecFromState( state );
+      std::string fileName;
+      const int64_t fileSize = prepareFile( spec, fileName );
+
+      e57::Reader reader( fileName, {} );
+
+      e57::Data3D header;
+      reader.ReadData3D( 0, header );
+
+      e57::Data3DPointsDouble points( header );
+
+      for ( auto _ : state )
+      {
+         reader.ReadData3DPointsDataParallel( 0, points, 0 );
+
+         benchmark::DoNotOptimize( points.cartesianX[0] );
+      }
+
+      state.SetLabel( SyntheticScan::Label( spec ) );
+      state.SetItemsProcessed( state.iterations() * header.pointCount );
+      state.SetBytesProcessed( state.iterations() * fileSize );
+   }
+
+   // Read a whole scan with a CompressedVectorReader into buffers of the types the fields are
+   // stored as, without any conversion or scaling
+   void BM_CompressedVectorReader( benchmark::State &state )
+   {
+      const SyntheticScan::Spec spec = SyntheticScan::SpecFromState( state );
+      std::string fileName;
+      const int64_t fileSize = prepareFile( spec, fileName );
+
+      e57::ImageFile imf( fileName, "r" );
+
+      const e57::VectorNode data3D( imf.root().get( "/data3D" ) );
+      const e57::StructureNode scan( data3D.get( 0 ) );
+      e57::CompressedVectorNode points( scan.get( "points" ) );
+      const e57::StructureNode proto( points.prototype() );
+      const int64_t pointCount = points.childCount();
+
+      std::vector<std::vector<int64_t>> integers;
+      std::vector<std::vector<double>> doubles;
+      std::vector<std::vector<float>> floats;
+      std::vector<e57::SourceDestBuffer> buffers;
+
+      // Keep the vectors from moving once we have pointed buffers at them
+      integers.reserve( static_cast<size_t>( proto.childCount() ) );
+      doubles.reserve( static_cast<size_t>( proto.childCount() ) );
+      floats.reserve( static_cast<size_t>( proto.childCount() ) );
+
+      for ( int64_t i = 0; i < proto.childCount(); ++i )
+      {
+         const e57::Node field = proto.get( i );
+         const e57::ustring path = field.pathName();
+
+         if ( field.type() == e57::TypeFloat )
+         {
+            if ( e57::FloatNode( field ).precision() == e57::PrecisionSingle )
+            {
+               floats.emplace_back( cBufferSize );
+               buffers.emplace_back( imf, path, floats.back().data(), cBufferSize );
+            }
+            else
+            {
+               doubles.emplace_back( cBufferSize );
+               buffers.emplace_back( imf, path, doubles.back().data(), cBufferSize );
+            }
+         }
+         else
+         {
+            integers.emplace_back( cBufferSize );
+            buffers.emplace_back( imf, path, integers.back().data(), cBufferSize );
+         }
+      }
+
+      for ( auto _ : state )
+      {
+         e57::CompressedVectorReader reader = points.reader( buffers );
+
+         while ( reader.read() > 0 )
+         {
+            benchmark::DoNotOptimize( buffers.front() );
+         }
+
+         reader.close();
+      }
+
+      imf.close();
+
+      state.SetLabel( SyntheticScan::Label( spec ) );
+      state.SetItemsProcessed( state.iterations() * pointCount );
+      state.SetBytesProcessed( state.iterations() * fileSize );
+   }
+}
+
+BENCHMARK( BM_Reader )->Apply( SyntheticScan::AllSpecs )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Reader_Parallel )
+   ->Apply( SyntheticScan::AllSpecs )
+   ->Unit( benchmark::kMillisecond )
+   ->UseRealTime();
+BENCHMARK( BM_CompressedVectorReader )
+   ->Apply( SyntheticScan::AllSpecs )
+   ->Unit( benchmark::kMillisecond );
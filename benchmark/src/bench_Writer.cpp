@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+
+#include "benchmark/benchmark.h"
+
+#include "E57SimpleWriter.h"
+
+#include "SyntheticScan.h"
+
+namespace
+{
+   constexpr const char *cFileName = "./benchWriter.e57";
+
+   // Write a whole scan with WriteData3DData()
+   void BM_Writer( benchmark::State &state, const e57::WriterOptions &options )
+   {
+      const SyntheticScan::Spec spec = SyntheticScan::SpecFromState( state );
+
+      e57::Data3D header = SyntheticScan::Header( spec );
+      e57::Data3DPointsDouble points( header );
+
+      SyntheticScan::Fill( header, points );
+
+      for ( auto _ : state )
+      {
+         e57::Writer writer( cFileName, options );
+
+         // It fills in the limits, so give it a fresh copy each time
+         e57::Data3D scanHeader = header;
+         writer.WriteData3DData( scanHeader, points );
+      }
+
+      state.SetLabel( SyntheticScan::Label( spec ) );
+      state.SetItemsProcessed( state.iterations() * header.pointCount );
+      state.SetBytesProcessed( state.iterations() * SyntheticScan::FileSize( cFileName ) );
+   }
+
+   void BM_Writer_Default( benchmark::State &state )
+   {
+      BM_Writer( state, {} );
+   }
+
+   void BM_Writer_EncodeThreads( benchmark::State &state )
+   {
+      e57::WriterOptions options;
+      options.encodeThreadCount = 0;
+
+      BM_Writer( state, options );
+   }
+}
+
+BENCHMARK( BM_Writer_Default )->Apply( SyntheticScan::AllSpecs )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Writer_EncodeThreads )
+   ->Apply( SyntheticScan::AllSpecs )
+   ->Unit( benchmark::kMillisecond );
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: MIT
+
+#include "benchmark/benchmark.h"
+
+#include "E57Version.h"
+
+int main( int argc, char **argv )
+{
+   ::benchmark::Initialize( &argc, argv );
+
+   if ( ::benchmark::ReportUnrecognizedArguments( argc, argv ) )
+   {
+      return 1;
+   }
+
+   // Recorded with the results, e.g. in the "context" of the JSON output
+   ::benchmark::AddCustomContext( "e57Format version", e57::Version::library() );
+   ::benchmark::AddCustomContext( "ASTM version", e57::Version::astm() );
+
+   ::benchmark::RunSpecifiedBenchmarks();
+   ::benchmark::Shutdown();
+
+   return 0;
+}
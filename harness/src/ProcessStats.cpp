@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+
+#include <fstream>
+#include <string>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <sys/resource.h>
+#endif
+
+#include "ProcessStats.h"
+
+namespace ProcessStats
+{
+   Snapshot Take()
+   {
+      Snapshot snapshot;
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+      rusage usage = {};
+
+      if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+      {
+         // ru_maxrss is in bytes on macOS and in KiB elsewhere
+#if defined( __APPLE__ )
+         snapshot.peakResidentBytes = static_cast<uint64_t>( usage.ru_maxrss );
+#else
+         snapshot.peakResidentBytes = static_cast<uint64_t>( usage.ru_maxrss ) * 1024;
+#endif
+         snapshot.majorFaults = static_cast<uint64_t>( usage.ru_majflt );
+         snapshot.minorFaults = static_cast<uint64_t>( usage.ru_minflt );
+      }
+#endif
+
+      // Lines like "syscr: 1234"
+      std::ifstream io( "/proc/self/io" );
+      std::string name;
+      uint64_t value = 0;
+
+      while ( io >> name >> value )
+      {
+         if ( name == "syscr:" )
+         {
+            snapshot.readCalls = value;
+            snapshot.callsKnown = true;
+         }
+         else if ( name == "syscw:" )
+         {
+            snapshot.writeCalls = value;
+         }
+      }
+
+      return snapshot;
+   }
+}
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+/// What the process has used so far, to report for each phase of the harness
+namespace ProcessStats
+{
+   struct Snapshot
+   {
+      /// Most memory resident at once since the process started, in bytes (0 if unknown)
+      uint64_t peakResidentBytes = 0;
+
+      /// Page faults, which count the pages of memory mapped files read from disk too
+      uint64_t majorFaults = 0;
+      uint64_t minorFaults = 0;
+
+      /// System calls which read or wrote (Linux only, see /proc/self/io)
+      bool callsKnown = false;
+      uint64_t readCalls = 0;
+      uint64_t writeCalls = 0;
+   };
+
+   Snapshot Take();
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MIT
+
+#include <chrono>
+
+#include "TraceFile.h"
+
+TraceFile::TraceFile( const std::string &fileName ) :
+   stream_( fileName ),
+   originNanoseconds_( static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() )
+         .count() ) )
+{
+   stream_ << "{\"traceEvents\":[";
+}
+
+TraceFile::~TraceFile()
+{
+   stream_ << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+e57::TraceHandler TraceFile::handler()
+{
+   return [this]( const e57::TraceEvent &event ) { add( event ); };
+}
+
+void TraceFile::add( const e57::TraceEvent &event )
+{
+   const uint64_t start =
+      ( event.startNanoseconds > originNanoseconds_ ) ? event.startNanoseconds - originNanoseconds_
+                                                      : 0;
+
+   std::lock_guard<std::mutex> lock( mutex_ );
+
+   const auto found = threadNumbers_.emplace( event.threadId, threadNumbers_.size() + 1 );
+
+   // Complete events, in microseconds
+   stream_ << ( firstEvent_ ? "\n" : ",\n" ) << "{\"name\":\"" << event.name
+           << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << found.first->second
+           << ",\"ts\":" << start / 1000.0 << ",\"dur\":" << event.durationNanoseconds / 1000.0
+           << ",\"args\":{\"bytes\":" << event.bytes << "}}";
+
+   firstEvent_ = false;
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "E57Format.h"
+
+/// Writes the spans reported to e57::TraceHandler as a Chrome trace (JSON), which can be loaded
+/// into chrome://tracing or https://ui.perfetto.dev to see how the threads' work overlaps.
+class TraceFile
+{
+public:
+   explicit TraceFile( const std::string &fileName );
+   ~TraceFile();
+
+   TraceFile( const TraceFile & ) = delete;
+   TraceFile &operator=( const TraceFile & ) = delete;
+
+   bool isOpen() const
+   {
+      return stream_.is_open();
+   }
+
+   /// A handler for ReaderOptions::traceHandler or WriterOptions::traceHandler which adds the
+   /// spans to this file. The file must outlive it.
+   e57::TraceHandler handler();
+
+private:
+   void add( const e57::TraceEvent &event );
+
+   std::mutex mutex_;
+   std::ofstream stream_;
+   uint64_t originNanoseconds_; // times are written relative to when the file was made
+   bool firstEvent_ = true;
+
+   std::map<std::thread::id, unsigned int> threadNumbers_; // small numbers for the trace's tids
+};
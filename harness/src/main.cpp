@@ -0,0 +1,526 @@
+// SPDX-License-Identifier: MIT
+
+// Write a large file with the Simple API and read it back in several ways, reporting the time,
+// throughput, memory, and I/O of each phase. The defaults make a file of about 16 GB with more
+// than 2^31 points, so problems which only show up at scale do. See harness/README.md.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "E57SimpleReader.h"
+#include "E57SimpleWriter.h"
+#include "E57Version.h"
+
+#include "ProcessStats.h"
+#include "TraceFile.h"
+
+namespace
+{
+   constexpr double cPi = 3.14159265358979323846;
+
+   // Each scan is a grid of rows of this many points
+   constexpr int64_t cColumns = 4'096;
+
+   // Number of points read at a time
+   constexpr size_t cBufferSize = 1024 * 1024;
+
+   struct Options
+   {
+      std::string fileName = "./harnessE57.e57";
+      int64_t scanCount = 256;
+      int64_t pointsPerScan = 8'400'000;
+      int64_t imageCount = 4;
+      int64_t imageBytes = 64 * 1024 * 1024;
+      int64_t partialPoints = 100'000;
+      unsigned int threadCount = 1;
+      bool keepFile = false;
+      std::string traceFileName; // empty for no trace
+   };
+
+   void PrintUsage( const Options &defaults )
+   {
+      std::cerr << "Usage: harnessE57 [options]" << std::endl
+                << "  --file <path>          file to write and read (" << defaults.fileName
+                << ")" << std::endl
+                << "  --scans <count>        Data3D blocks to write (" << defaults.scanCount
+                << ")" << std::endl
+                << "  --points <count>       points in each scan (" << defaults.pointsPerScan
+                << ")" << std::endl
+                << "  --images <count>       Image2D blocks to write (" << defaults.imageCount
+                << ")" << std::endl
+                << "  --image-bytes <count>  size of each image's blob (" << defaults.imageBytes
+                << ")" << std::endl
+                << "  --partial <count>      points read from the middle of each scan by the "
+                   "partial read ("
+                << defaults.partialPoints << ")" << std::endl
+                << "  --threads <count>      encode and decode threads, 0 for one per hardware "
+                   "thread ("
+                << defaults.threadCount << ")" << std::endl
+                << "  --trace <path>         write the library's trace spans as a Chrome trace "
+                   "(needs E57_TRACING)"
+                << std::endl
+                << "  --keep                 don't delete the file at the end" << std::endl;
+   }
+
+   bool ParseArguments( int argc, char **argv, Options &options )
+   {
+      for ( int i = 1; i < argc; ++i )
+      {
+         const std::string argument = argv[i];
+
+         if ( argument == "--keep" )
+         {
+            options.keepFile = true;
+            continue;
+         }
+
+         if ( i + 1 >= argc )
+         {
+            return false;
+         }
+
+         const std::string value = argv[++i];
+
+         try
+         {
+            if ( argument == "--file" )
+            {
+               options.fileName = value;
+            }
+            else if ( argument == "--scans" )
+            {
+               options.scanCount = std::stoll( value );
+            }
+            else if ( argument == "--points" )
+            {
+               options.pointsPerScan = std::stoll( value );
+            }
+            else if ( argument == "--images" )
+            {
+               options.imageCount = std::stoll( value );
+            }
+            else if ( argument == "--image-bytes" )
+            {
+               options.imageBytes = std::stoll( value );
+            }
+            else if ( argument == "--partial" )
+            {
+               options.partialPoints = std::stoll( value );
+            }
+            else if ( argument == "--threads" )
+            {
+               options.threadCount = static_cast<unsigned int>( std::stoul( value ) );
+            }
+            else if ( argument == "--trace" )
+            {
+               options.traceFileName = value;
+            }
+            else
+            {
+               return false;
+            }
+         }
+         catch ( const std::exception & )
+         {
+            return false;
+         }
+      }
+
+      return ( options.scanCount > 0 ) && ( options.pointsPerScan > 0 ) &&
+             ( options.imageCount >= 0 ) && ( options.imageBytes > 0 ) &&
+             ( options.partialPoints >= 0 );
+   }
+
+   // Cartesian coordinates stored as ScaledIntegers of 1 mm, with 12-bit intensity and 8-bit
+   // color, like many terrestrial scanners write
+   e57::Data3D ScanHeader( int64_t scan, int64_t pointCount )
+   {
+      e57::Data3D header;
+      header.guid = "Harness Scan GUID " + std::to_string( scan );
+      header.name = "Scan " + std::to_string( scan );
+      header.pointCount = pointCount;
+
+      header.pose.translation.x = static_cast<double>( scan % 16 ) * 10.0;
+      header.pose.translation.y = static_cast<double>( scan / 16 ) * 10.0;
+
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.001;
+      header.pointFields.pointRangeMinimum = -100.0;
+      header.pointFields.pointRangeMaximum = 100.0;
+
+      header.pointFields.intensityField = true;
+      header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+      header.intensityLimits.intensityMinimum = 0;
+      header.intensityLimits.intensityMaximum = 4095;
+
+      header.pointFields.colorRedField = true;
+      header.pointFields.colorGreenField = true;
+      header.pointFields.colorBlueField = true;
+      header.colorLimits.colorRedMaximum = 255;
+      header.colorLimits.colorGreenMaximum = 255;
+      header.colorLimits.colorBlueMaximum = 255;
+
+      return header;
+   }
+
+   // Rows of points swept around the scanner, hitting a surface whose distance varies a little
+   void FillScan( int64_t scan, int64_t pointCount, e57::Data3DPointsFloat &points )
+   {
+      static std::vector<float> cosines;
+      static std::vector<float> sines;
+
+      if ( cosines.empty() )
+      {
+         for ( int64_t column = 0; column < cColumns; ++column )
+         {
+            const double azimuth = 2.0 * cPi * static_cast<double>( column ) / cColumns;
+            cosines.push_back( static_cast<float>( std::cos( azimuth ) ) );
+            sines.push_back( static_cast<float>( std::sin( azimuth ) ) );
+         }
+      }
+
+      const int64_t rowCount = ( pointCount + cColumns - 1 ) / cColumns;
+
+      for ( int64_t i = 0; i < pointCount; ++i )
+      {
+         const int64_t row = i / cColumns;
+         const auto column = static_cast<size_t>( i % cColumns );
+
+         const double elevation = cPi * ( static_cast<double>( row ) / rowCount - 0.5 ) * 0.8;
+         const auto hash = static_cast<uint32_t>( ( i + scan * 7919 ) * 2654435761u );
+         const float range = 20.0f + static_cast<float>( hash >> 20 ) * 0.001f;
+         const auto horizontal = static_cast<float>( range * std::cos( elevation ) );
+
+         points.cartesianX[i] = horizontal * cosines[column];
+         points.cartesianY[i] = horizontal * sines[column];
+         points.cartesianZ[i] = static_cast<float>( range * std::sin( elevation ) );
+         points.intensity[i] = static_cast<float>( hash >> 20 );
+         points.colorRed[i] = static_cast<uint16_t>( hash & 0xff );
+         points.colorGreen[i] = static_cast<uint16_t>( ( hash >> 8 ) & 0xff );
+         points.colorBlue[i] = static_cast<uint16_t>( column & 0xff );
+      }
+   }
+
+   e57::Image2D ImageHeader( int64_t image, int64_t byteCount )
+   {
+      e57::Image2D header;
+      header.guid = "Harness Image GUID " + std::to_string( image );
+      header.name = "Image " + std::to_string( image );
+      header.associatedData3DGuid = "Harness Scan GUID 0";
+      header.visualReferenceRepresentation.imageWidth = 8192;
+      header.visualReferenceRepresentation.imageHeight = 8192;
+      header.visualReferenceRepresentation.jpegImageSize = byteCount;
+
+      return header;
+   }
+
+   struct PhaseResult
+   {
+      std::string name;
+      double seconds = 0.0;
+      int64_t points = 0;
+      ProcessStats::Snapshot before;
+      ProcessStats::Snapshot after;
+   };
+
+   // Run a phase, which returns the number of points it wrote or read
+   PhaseResult Measure( const std::string &name, const std::function<int64_t()> &phase )
+   {
+      std::cout << "Running " << name << "..." << std::endl;
+
+      PhaseResult result;
+      result.name = name;
+      result.before = ProcessStats::Take();
+
+      const auto start = std::chrono::steady_clock::now();
+      result.points = phase();
+      const auto end = std::chrono::steady_clock::now();
+
+      result.after = ProcessStats::Take();
+      result.seconds = std::chrono::duration<double>( end - start ).count();
+
+      return result;
+   }
+
+   void PrintResults( const std::vector<PhaseResult> &results, uint64_t fileSize )
+   {
+      std::printf( "\nFile size: %.2f GiB\n\n", static_cast<double>( fileSize ) / ( 1 << 30 ) );
+      std::printf( "%-14s %10s %14s %12s %14s %12s %12s %12s\n", "phase", "seconds", "points",
+                   "Mpoints/s", "peak RSS MiB", "read calls", "write calls", "major faults" );
+
+      for ( const PhaseResult &result : results )
+      {
+         const double pointsPerSecond =
+            ( result.seconds > 0.0 ) ? static_cast<double>( result.points ) / result.seconds
+                                     : 0.0;
+
+         std::printf( "%-14s %10.3f %14lld %12.2f %14.1f ", result.name.c_str(), result.seconds,
+                      static_cast<long long>( result.points ), pointsPerSecond / 1e6,
+                      static_cast<double>( result.after.peakResidentBytes ) / ( 1 << 20 ) );
+
+         if ( result.after.callsKnown )
+         {
+            std::printf( "%12llu %12llu ",
+                         static_cast<unsigned long long>( result.after.readCalls -
+                                                          result.before.readCalls ),
+                         static_cast<unsigned long long>( result.after.writeCalls -
+                                                          result.before.writeCalls ) );
+         }
+         else
+         {
+            std::printf( "%12s %12s ", "n/a", "n/a" );
+         }
+
+         std::printf( "%12llu\n",
+                      static_cast<unsigned long long>( result.after.majorFaults -
+                                                       result.before.majorFaults ) );
+      }
+   }
+
+   int64_t WriteFile( const Options &options, const e57::TraceHandler &traceHandler )
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Harness File GUID";
+      writerOptions.encodeThreadCount = options.threadCount;
+      writerOptions.traceHandler = traceHandler;
+
+      e57::Writer writer( options.fileName, writerOptions );
+
+      // The scans all have the same fields and size, so the buffers are reused
+      e57::Data3D header = ScanHeader( 0, options.pointsPerScan );
+      e57::Data3DPointsFloat points( header );
+
+      for ( int64_t scan = 0; scan < options.scanCount; ++scan )
+      {
+         header = ScanHeader( scan, options.pointsPerScan );
+         FillScan( scan, options.pointsPerScan, points );
+
+         writer.WriteData3DData( header, points );
+      }
+
+      std::vector<uint8_t> image( static_cast<size_t>( options.imageBytes ) );
+
+      for ( size_t i = 0; i < image.size(); ++i )
+      {
+         image[i] = static_cast<uint8_t>( ( i * 2654435761u ) >> 24 );
+      }
+
+      for ( int64_t i = 0; i < options.imageCount; ++i )
+      {
+         e57::Image2D imageHeader = ImageHeader( i, options.imageBytes );
+
+         writer.WriteImage2DData( imageHeader, e57::ImageJPEG, e57::ProjectionVisual, 0,
+                                  image.data(), options.imageBytes );
+      }
+
+      writer.Close();
+
+      return options.scanCount * options.pointsPerScan;
+   }
+
+   e57::ReaderOptions MakeReaderOptions( const Options &options,
+                                         const e57::TraceHandler &traceHandler )
+   {
+      e57::ReaderOptions readerOptions;
+      readerOptions.decodeThreadCount = options.threadCount;
+      readerOptions.traceHandler = traceHandler;
+
+      return readerOptions;
+   }
+
+   int64_t ReadMetadata( const e57::Reader &reader )
+   {
+      for ( int64_t i = 0; i < reader.GetData3DCount(); ++i )
+      {
+         e57::Data3D header;
+         reader.ReadData3D( i, header );
+      }
+
+      for ( int64_t i = 0; i < reader.GetImage2DCount(); ++i )
+      {
+         e57::Image2D header;
+         reader.ReadImage2D( i, header );
+      }
+
+      return 0;
+   }
+
+   // Read every point of every scan, and every image
+   int64_t ReadAll( const e57::Reader &reader )
+   {
+      int64_t total = 0;
+
+      for ( int64_t i = 0; i < reader.GetData3DCount(); ++i )
+      {
+         e57::Data3D header;
+         reader.ReadData3D( i, header );
+
+         e57::Data3D bufferHeader = header;
+         bufferHeader.pointCount = cBufferSize;
+
+         e57::Data3DPointsFloat points( bufferHeader );
+         e57::CompressedVectorReader vectorReader =
+            reader.SetUpData3DPointsData( i, cBufferSize, points );
+
+         int64_t scanPoints = 0;
+
+         while ( const unsigned count = vectorReader.read() )
+         {
+            scanPoints += count;
+         }
+
+         vectorReader.close();
+
+         if ( scanPoints != header.pointCount )
+         {
+            throw std::runtime_error( "scan " + std::to_string( i ) + " has " +
+                                      std::to_string( scanPoints ) + " points instead of " +
+                                      std::to_string( header.pointCount ) );
+         }
+
+         total += scanPoints;
+      }
+
+      std::vector<uint8_t> image;
+
+      for ( int64_t i = 0; i < reader.GetImage2DCount(); ++i )
+      {
+         e57::Image2D header;
+         reader.ReadImage2D( i, header );
+
+         image.resize( static_cast<size_t>( header.visualReferenceRepresentation.jpegImageSize ) );
+
+         reader.ReadImage2DData( i, e57::ProjectionVisual, e57::ImageJPEG, image.data(), 0,
+                                 static_cast<int64_t>( image.size() ) );
+      }
+
+      return total;
+   }
+
+   // Read a run of points from the middle of every scan
+   int64_t ReadPartial( const e57::Reader &reader, int64_t partialPoints )
+   {
+      int64_t total = 0;
+
+      for ( int64_t i = 0; i < reader.GetData3DCount(); ++i )
+      {
+         e57::Data3D header;
+         reader.ReadData3D( i, header );
+
+         const int64_t first = header.pointCount / 2;
+         const auto count =
+            static_cast<size_t>( std::min<int64_t>( partialPoints, header.pointCount - first ) );
+
+         if ( count == 0 )
+         {
+            continue;
+         }
+
+         e57::Data3D bufferHeader = header;
+         bufferHeader.pointCount = static_cast<int64_t>( count );
+
+         e57::Data3DPointsFloat points( bufferHeader );
+         e57::CompressedVectorReader vectorReader =
+            reader.SetUpData3DPointsData( i, count, points );
+
+         vectorReader.seek( first );
+         total += vectorReader.read();
+         vectorReader.close();
+      }
+
+      return total;
+   }
+}
+
+int main( int argc, char **argv )
+{
+   Options options;
+
+   if ( !ParseArguments( argc, argv, options ) )
+   {
+      PrintUsage( Options() );
+      return 1;
+   }
+
+   std::cout << "libE57Format " << e57::Version::library() << ": " << options.scanCount
+             << " scans of " << options.pointsPerScan << " points, " << options.imageCount
+             << " images of " << options.imageBytes << " bytes, in " << options.fileName
+             << std::endl;
+
+   std::unique_ptr<TraceFile> traceFile;
+   e57::TraceHandler traceHandler;
+
+   if ( !options.traceFileName.empty() )
+   {
+      traceFile.reset( new TraceFile( options.traceFileName ) );
+
+      if ( !traceFile->isOpen() )
+      {
+         std::cerr << "Can't write " << options.traceFileName << std::endl;
+         return 1;
+      }
+
+      traceHandler = traceFile->handler();
+   }
+
+   std::vector<PhaseResult> results;
+   uint64_t fileSize = 0;
+
+   try
+   {
+      results.push_back( Measure( "write", [&] { return WriteFile( options, traceHandler ); } ) );
+
+      fileSize = static_cast<uint64_t>(
+         std::ifstream( options.fileName, std::ifstream::ate | std::ifstream::binary ).tellg() );
+
+      const e57::ReaderOptions readerOptions = MakeReaderOptions( options, traceHandler );
+
+      results.push_back( Measure( "open", [&] {
+         e57::Reader reader( options.fileName, readerOptions );
+         reader.Close();
+         return int64_t{ 0 };
+      } ) );
+
+      // The rest share one reader, as an application would
+      e57::Reader reader( options.fileName, readerOptions );
+
+      results.push_back( Measure( "metadata read", [&] { return ReadMetadata( reader ); } ) );
+      results.push_back( Measure( "full read", [&] { return ReadAll( reader ); } ) );
+      results.push_back( Measure( "partial read", [&] {
+         return ReadPartial( reader, options.partialPoints );
+      } ) );
+
+      reader.Close();
+   }
+   catch ( const e57::E57Exception &e )
+   {
+      std::cerr << "Failed: " << e.errorStr() << " " << e.context() << std::endl;
+      return 1;
+   }
+   catch ( const std::exception &e )
+   {
+      std::cerr << "Failed: " << e.what() << std::endl;
+      return 1;
+   }
+
+   PrintResults( results, fileSize );
+
+   if ( !options.keepFile )
+   {
+      std::remove( options.fileName.c_str() );
+   }
+
+   return 0;
+}
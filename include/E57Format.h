@@ -33,7 +33,10 @@
 
 #include <cfloat>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "E57Exception.h"
@@ -112,6 +115,8 @@ namespace e57
       Real32 = 9,   ///< C++ float type
       Real64 = 10,  ///< C++ double type
       UString = 11, ///< Unicode UTF-8 std::string
+      Real16 = 12,  ///< IEEE 754 half precision float, stored in a uint16_t (see
+                    ///< SourceDestBuffer::setHalfPrecision())
 
       /// @deprecated Will be removed in 4.0. Use e57::Int8.
       E57_INT8 DEPRECATED_ENUM( "Will be removed in 4.0. Use Int8." ) = Int8,
@@ -139,12 +144,15 @@ namespace e57
 
    /// @brief Default checksum policies for e57::ReadChecksumPolicy
    /// @details These are some convenient default checksum policies, though you can use any value
-   /// you want (0-100).
+   /// you want (0-100). The pages to verify are spread evenly through the file, and each page is
+   /// verified at most once while the file is open for reading.
    enum ChecksumPolicy
    {
       ChecksumNone = 0,    ///< Do not verify the checksums. (fast)
-      ChecksumSparse = 25, ///< Only verify 25% of the checksums. The last block is always verified.
-      ChecksumHalf = 50,   ///< Only verify 50% of the checksums. The last block is always verified.
+      ChecksumSparse = 25, ///< Only verify 25% of the checksums. The first and last pages of the
+                           ///< file are always verified.
+      ChecksumHalf = 50,   ///< Only verify 50% of the checksums. The first and last pages of the
+                           ///< file are always verified.
       ChecksumAll = 100    ///< Verify all checksums. This is the default. (slow)
    };
 
@@ -179,6 +187,33 @@ namespace e57
 
    ///@}
 
+   /// @brief How thoroughly the data of a file is checked as points are read or written
+   /// @details This is about the data packets and the values in them. The XML section is always
+   /// checked when the file is opened.
+   enum ValidationLevel
+   {
+      ValidationNone = 0,  ///< Skip the checks of each data packet and of each value. Only use
+                           ///< this for files you trust: damaged data may then be read as
+                           ///< garbage, and values outside their limits are written garbled.
+                           ///< (fast)
+      ValidationBasic = 1, ///< Check the layout of each packet, and that each value fits its
+                           ///< field and buffer. This is the default.
+      ValidationDeep = 2   ///< Also check the padding and order of the index packets, and that
+                           ///< each integer read is within its field's limits. (slow)
+   };
+
+   /// @brief How a writer shares a data packet between the bytestreams (one per field) when they
+   /// have more data than fits in it
+   enum PacketPacking
+   {
+      PacketPackingProportional = 0, ///< Send the same fraction of what each bytestream has.
+                                     ///< This is the default.
+      PacketPackingRecordAligned = 1 ///< Send each bytestream up to the same record, going by
+                                     ///< its bits per record, so a reader finishes the records
+                                     ///< of all the fields in a packet together and needs fewer
+                                     ///< packets cached at once.
+   };
+
    /// @brief The URI of ASTM E57 v1.0 standard XML namespace
    /// @note Even though this URI does not point to a valid document, the standard (section 8.4.2.3)
    /// says that this is the required namespace.
@@ -188,6 +223,48 @@ namespace e57
    [[deprecated( "Will be removed in 4.0. Use e57::VERSION_1_0_URI." )]] // TODO Remove in 4.0
    constexpr auto E57_V1_0_URI = VERSION_1_0_URI;
 
+   /// @brief The URI of the libE57Format extension which compresses point data with deflate
+   /// @details A CompressedVectorNode's data packets are compressed if one of its codecs is a
+   /// StructureNode holding a "deflateCodec" StructureNode in this namespace (with an optional
+   /// IntegerNode "level" from 1 to 9). The packets are flagged, so readers don't need the codecs,
+   /// but they must be built with E57_WITH_ZLIB.
+   constexpr char DEFLATE_CODEC_URI[] = "urn:libE57Format:E57_EXT_deflate_codec:1.0";
+
+   /// @brief The URI of the libE57Format extension which stores integers as predicted differences
+   /// @details Integer and ScaledInteger fields listed in the "inputs" of a codec StructureNode
+   /// holding a "deltaCodec" StructureNode in this namespace are stored as the difference from
+   /// the previous value (or with an IntegerNode "order" of 2, from a line through the previous
+   /// two), packed with as few bits as each block of 64 records needs. This suits fields which
+   /// change slowly from one record to the next, like the row and column of structured scans.
+   /// Readers must know this codec to read these fields.
+   constexpr char DELTA_CODEC_URI[] = "urn:libE57Format:E57_EXT_delta_codec:1.0";
+
+   /// @brief The URI of the libE57Format extension which stores integers as runs of equal values
+   /// @details Integer and ScaledInteger fields listed in the "inputs" of a codec StructureNode
+   /// holding a "runLengthCodec" StructureNode in this namespace are stored as runs of records
+   /// with the same value. This suits fields which are almost always the same, like
+   /// cartesianInvalidState or returnIndex. Readers must know this codec to read these fields.
+   constexpr char RUN_LENGTH_CODEC_URI[] = "urn:libE57Format:E57_EXT_run_length_codec:1.0";
+
+   /// @brief The URI of the libE57Format extension which keeps the range of the values of each
+   /// run of points of a Data3D (a zone map)
+   /// @details A Data3D StructureNode may hold a "zoneMap" StructureNode in this namespace with an
+   /// IntegerNode "pointCount" and a CompressedVectorNode "zones". Zone i holds the points from
+   /// i * pointCount on (the last one may have fewer). Each record of "zones" has the FloatNodes
+   /// "xMinimum", "xMaximum", "yMinimum", "yMaximum", "zMinimum", and "zMaximum" bounding the
+   /// zone's valid cartesian points, and may have "intensityMinimum", "intensityMaximum",
+   /// "timeStampMinimum", and "timeStampMaximum". A minimum greater than its maximum means the
+   /// zone has no valid values for the field. Readers which don't know this extension ignore it.
+   constexpr char ZONE_MAP_URI[] = "urn:libE57Format:E57_EXT_zone_map:1.0";
+
+   /// @brief The URI of the libE57Format extension which keeps a small sample of the points of a
+   /// Data3D (a preview)
+   /// @details A Data3D StructureNode may hold a "preview" StructureNode in this namespace with an
+   /// IntegerNode "pointInterval" and a CompressedVectorNode "points" with the same prototype as
+   /// the Data3D's "points". It holds one point picked from each run of pointInterval points, in
+   /// order (the last run may have none). Readers which don't know this extension ignore it.
+   constexpr char PREVIEW_URI[] = "urn:libE57Format:E57_EXT_preview:1.0";
+
    /// @cond documentNonPublic   The following aren't documented
    // Minimum and maximum values for integers
    constexpr uint8_t UINT8_MIN = 0U;
@@ -219,6 +296,7 @@ public:
 
    class BlobNode;
    class BlobNodeImpl;
+   class BlobViewImpl;
    class CompressedVectorNode;
    class CompressedVectorNodeImpl;
    class CompressedVectorReader;
@@ -361,6 +439,59 @@ public:
       /// @endcond
    };
 
+   /// @brief Strings stored one after another in a single block of characters, with where each
+   /// one starts (like an Apache Arrow string column)
+   /// @details String i is chars[offsets[i]] up to chars[offsets[i + 1]], so offsets has one more
+   /// element than there are strings. A SourceDestBuffer for a StringColumn transfers the strings
+   /// without allocating each of them: reading into one replaces its strings with those read,
+   /// reusing its memory, and writing from one reads the strings in place.
+   struct E57_DLL StringColumn
+   {
+      /// The characters of all the strings, without terminators
+      std::vector<char> chars;
+
+      /// Offset in chars of the start of each string, followed by the end of the last one
+      std::vector<uint64_t> offsets = { 0 };
+
+      /// Number of strings
+      size_t size() const
+      {
+         return offsets.size() - 1;
+      }
+
+      /// Length of string index
+      size_t length( size_t index ) const
+      {
+         return static_cast<size_t>( offsets.at( index + 1 ) - offsets[index] );
+      }
+
+      /// First character of string index (not null-terminated)
+      const char *data( size_t index ) const
+      {
+         return chars.data() + offsets.at( index );
+      }
+
+      /// A copy of string index
+      ustring at( size_t index ) const
+      {
+         return ustring( data( index ), length( index ) );
+      }
+
+      /// Add a string at the end
+      void append( const char *string, size_t length )
+      {
+         chars.insert( chars.end(), string, string + length );
+         offsets.push_back( chars.size() );
+      }
+
+      /// Remove all the strings, keeping the memory
+      void clear()
+      {
+         chars.clear();
+         offsets.assign( 1, 0 );
+      }
+   };
+
    class E57_DLL SourceDestBuffer
    {
    public:
@@ -397,6 +528,8 @@ public:
                         size_t stride = sizeof( double ) );
       SourceDestBuffer( const ImageFile &destImageFile, const ustring &pathName,
                         std::vector<ustring> *b );
+      SourceDestBuffer( const ImageFile &destImageFile, const ustring &pathName, StringColumn *b,
+                        size_t capacity );
 
       ustring pathName() const;
       enum MemoryRepresentation memoryRepresentation() const;
@@ -405,6 +538,9 @@ public:
       bool doScaling() const;
       size_t stride() const;
 
+      void setHalfPrecision();
+      void setNormalizedRange( double minimum, double maximum );
+
       // Diagnostic functions:
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
       void checkInvariant( bool doRecurse = true ) const;
@@ -417,6 +553,20 @@ public:
       /// @endcond
    };
 
+   /// @brief A range of values which a field must be in for CompressedVectorReader::read() to
+   /// return a record (see CompressedVectorReader::setRecordFilters()).
+   struct E57_DLL RecordFilter
+   {
+      /// Path name of the field in the prototype. There must be a (numeric) buffer for it.
+      ustring pathName;
+
+      /// Smallest value to keep, as stored in the buffer
+      double minimum = -DBL_MAX;
+
+      /// Largest value to keep, as stored in the buffer
+      double maximum = DBL_MAX;
+   };
+
    class E57_DLL CompressedVectorReader
    {
    public:
@@ -424,7 +574,16 @@ public:
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
-      void seek( int64_t recordNumber ); // !!! not implemented yet
+      std::future<unsigned> readAsync( std::vector<SourceDestBuffer> &dbufs );
+      unsigned addBufferSet( std::vector<SourceDestBuffer> &dbufs );
+      void useBufferSet( unsigned bufferSet );
+      void setRecordFilters( const std::vector<RecordFilter> &filters );
+      void setRecordStride( unsigned stride );
+      void seek( int64_t recordNumber );
+      void restart( const CompressedVectorNode &cv );
+      void buildRecordIndex();
+      void writeRecordIndex( const ustring &fileName ) const;
+      void readRecordIndex( const ustring &fileName );
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
@@ -452,6 +611,9 @@ public:
 
       void write( size_t recordCount );
       void write( std::vector<SourceDestBuffer> &sbufs, size_t recordCount );
+      std::future<void> writeAsync( std::vector<SourceDestBuffer> &sbufs, size_t recordCount );
+      unsigned addBufferSet( std::vector<SourceDestBuffer> &sbufs );
+      void useBufferSet( unsigned bufferSet );
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
@@ -487,6 +649,8 @@ public:
       CompressedVectorWriter writer( std::vector<SourceDestBuffer> &sbufs );
       CompressedVectorReader reader( const std::vector<SourceDestBuffer> &dbufs );
 
+      void copyPacketsFrom( const CompressedVectorNode &source );
+
       // Up/Down cast conversion
       operator Node() const;
       explicit CompressedVectorNode( const Node &n );
@@ -526,6 +690,7 @@ public:
                             int64_t minimum = INT64_MIN, int64_t maximum = INT64_MAX );
 
       int64_t value() const;
+      void setValue( int64_t value );
       int64_t minimum() const;
       int64_t maximum() const;
 
@@ -615,6 +780,7 @@ public:
                           double maximum = DOUBLE_MAX );
 
       double value() const;
+      void setValue( double value );
       FloatPrecision precision() const;
       double minimum() const;
       double maximum() const;
@@ -653,6 +819,7 @@ public:
       explicit StringNode( const ImageFile &destImageFile, const ustring &value = "" );
 
       ustring value() const;
+      void setValue( const ustring &value );
 
       // Up/Down cast conversion
       operator Node() const;
@@ -683,6 +850,42 @@ public:
       /// @endcond
    };
 
+   /// @brief A contiguous piece of the data in a BlobView
+   struct E57_DLL BlobSegment
+   {
+      const uint8_t *data = nullptr;
+      size_t size = 0;
+   };
+
+   /// @brief A read-only view of part of the data of a Blob, made by BlobNode::view()
+   /// @details When the whole file is in memory (it is memory mapped, or was opened from a
+   /// buffer), the view points into it. The checksum at the end of each page splits the data up,
+   /// so there is one segment for each page. A page's checksum is verified (as the
+   /// ReadChecksumPolicy says) the first time its segment is asked for. Otherwise the data is
+   /// read into a buffer owned by the view, which is its only segment.
+   ///
+   /// The segments can be used until the ImageFile is closed. Views of a file open for reading
+   /// may be used by several threads at once.
+   class E57_DLL BlobView
+   {
+   public:
+      BlobView() = default;
+
+      size_t size() const;
+      size_t segmentCount() const;
+      BlobSegment segment( size_t index ) const;
+      bool isInPlace() const;
+
+      /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   private:
+      friend class BlobNodeImpl;
+
+      explicit BlobView( std::shared_ptr<BlobViewImpl> ni );
+
+      std::shared_ptr<BlobViewImpl> impl_;
+      /// @endcond
+   };
+
    class E57_DLL BlobNode
    {
    public:
@@ -692,6 +895,7 @@ public:
       int64_t byteCount() const;
       void read( uint8_t *buf, int64_t start, size_t count );
       void write( uint8_t *buf, int64_t start, size_t count );
+      BlobView view( int64_t start, size_t count ) const;
 
       // Up/Down cast conversion
       operator Node() const;
@@ -725,12 +929,224 @@ public:
       /// @endcond
    };
 
+   /// @brief Positional reads and writes of the data of an ImageFile which isn't a local file
+   /// @details Implement this to read or write E57 files through something other than the file
+   /// system, such as ranges of an object in a cloud store. Offsets are physical, so they count
+   /// the checksums at the end of each page. When the ImageFile is open for reading, readAt() may
+   /// be called from several threads at once. When it is open for writing, calls are made one at
+   /// a time and the data starts out empty. Errors may be reported by throwing any exception
+   /// derived from std::exception. Point data is read in large requests, several at once (see
+   /// ReaderOptions::rangeReadSize).
+   class E57_DLL ImageFileIO
+   {
+   public:
+      virtual ~ImageFileIO() = default;
+
+      /// Read up to count bytes at offset into buffer.
+      /// @returns The number of bytes read, which is only 0 if offset is at the end of the data
+      virtual size_t readAt( uint64_t offset, void *buffer, size_t count ) = 0;
+
+      /// Write up to count bytes from buffer at offset, extending the data if needed. The
+      /// default throws ErrorFileReadOnly, which is enough for backends only used for reading.
+      /// @returns The number of bytes written
+      virtual size_t writeAt( uint64_t offset, const void *buffer, size_t count );
+
+      /// Size of the data in bytes. Only used when reading.
+      virtual uint64_t size() = 0;
+
+      /// Name of the file, used by ImageFile::fileName() and in error messages
+      virtual ustring name() const;
+   };
+
+   /// @brief Runs the library's parallel work on the application's threads
+   /// @details Implement this to have decoding, encoding, and checksum verification (see
+   /// ReaderOptions::executor and WriterOptions::executor) scheduled on a thread pool the
+   /// application already has, instead of threads started by the library. The work is split
+   /// into tasks which are submitted and also run by the calling thread, which only waits for
+   /// the tasks which have started. Tasks which start later find nothing left to do and return
+   /// at once, so it is safe to make these calls from a task running on the executor.
+   class E57_DLL Executor
+   {
+   public:
+      virtual ~Executor() = default;
+
+      /// Run task once, on any thread, at any time. Tasks don't throw. If this throws, the
+      /// calling thread does the work instead.
+      virtual void submit( std::function<void()> task ) = 0;
+
+      /// The number of tasks which can run at once. Thread counts of 0 use this instead of the
+      /// number of hardware threads.
+      virtual unsigned int concurrency() const = 0;
+   };
+
+   /// @brief A span of work done by the library on an ImageFile, given to its TraceHandler.
+   /// @details The spans are only reported if the library was built with the E57_TRACING CMake
+   /// option. Spans on other threads (e.g. decoding threads or the background reads of the
+   /// packet cache) may overlap those of the thread using the file, which is what they show.
+   struct E57_DLL TraceEvent
+   {
+      /// What was done: "open", "parseXml", "close", "readPacket" (read and checksum a packet
+      /// into the packet cache), "decodePacket" (give a packet to the decoders of a
+      /// CompressedVectorReader), "writePacket", "readPages" or "writePages" (bulk reads and
+      /// writes of the file's pages). It is a string literal.
+      const char *name = nullptr;
+
+      /// When it started, in nanoseconds since the epoch of std::chrono::steady_clock, so that the
+      /// spans of several files can be put together
+      uint64_t startNanoseconds = 0;
+
+      /// How long it took, in nanoseconds
+      uint64_t durationNanoseconds = 0;
+
+      /// Bytes read, written, or decoded, 0 if not known
+      uint64_t bytes = 0;
+
+      /// Thread the work was done on
+      std::thread::id threadId;
+   };
+
+   /// @brief Called with each span of work done on an ImageFile, once it has finished.
+   /// @details It may be called by several threads at once, so it must be thread safe, and it
+   /// should be quick since the work waits for it.
+   using TraceHandler = std::function<void( const TraceEvent &event )>;
+
+   /// Alignment (in bytes) of the memory given by a BufferAllocator
+   constexpr size_t BUFFER_ALIGNMENT = 4096;
+
+   /// @brief Supplies the memory of an ImageFile's larger internal buffers (see
+   /// ReaderOptions::bufferAllocator and WriterOptions::bufferAllocator).
+   /// @details These are the entries of the data packet cache and its read-ahead buffers, the
+   /// buffers the file's pages are read into and written from, and the output buffers of the
+   /// encoders. Most are allocated once and reused. This allocator gets them from the heap;
+   /// derive from it to take the memory from somewhere else. It may be called by several threads
+   /// at once, and is kept alive by the buffers until they are all freed.
+   class E57_DLL BufferAllocator
+   {
+   public:
+      virtual ~BufferAllocator() = default;
+
+      /// @returns at least size bytes which start on a BUFFER_ALIGNMENT boundary
+      virtual void *allocate( size_t size );
+
+      /// @brief Give back memory returned by allocate( size ).
+      virtual void deallocate( void *memory, size_t size );
+   };
+
+   class HugePageAllocatorImpl;
+
+   /// @brief A BufferAllocator which places the buffers in 2 MiB huge pages.
+   /// @details On Linux the memory is mapped in whole huge pages, marked for transparent huge
+   /// pages (MADV_HUGEPAGE), so the buffers need fewer TLB entries. Buffers smaller than half a
+   /// huge page share them, and are kept for reuse when they are given back; those pages are
+   /// unmapped when the allocator is destroyed. On other platforms the memory comes from the heap.
+   class E57_DLL HugePageAllocator : public BufferAllocator
+   {
+   public:
+      static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+      /// @param [in] numaLocal touch the pages as they are mapped, so Linux's first touch policy
+      /// puts them on the NUMA node of the thread allocating the buffer (e.g. the one opening the
+      /// file or setting up a reader) rather than that of the thread which first fills it
+      explicit HugePageAllocator( bool numaLocal = true );
+      ~HugePageAllocator() override;
+
+      HugePageAllocator( const HugePageAllocator & ) = delete;
+      HugePageAllocator &operator=( const HugePageAllocator & ) = delete;
+
+      void *allocate( size_t size ) override;
+      void deallocate( void *memory, size_t size ) override;
+
+   private:
+      std::unique_ptr<HugePageAllocatorImpl> impl_;
+   };
+
+   /// @brief Counters of the work done reading an ImageFile (see ImageFile::statistics()).
+   /// @details They are only kept if the library was built with the E57_STATISTICS CMake option.
+   /// Otherwise they are all 0 and enabled is false. Times are summed over all the threads doing
+   /// the work, so together they may add up to more than the time taken.
+   struct E57_DLL ImageFileStatistics
+   {
+      /// The library was built with E57_STATISTICS
+      bool enabled = false;
+
+      /// Bytes read from the file (or ImageFileIO), including checksums
+      uint64_t bytesRead = 0;
+
+      /// Pages whose checksums were verified
+      uint64_t pagesVerified = 0;
+
+      /// Lookups of packets in the packet cache which found the packet
+      uint64_t packetCacheHits = 0;
+
+      /// Lookups of packets in the packet cache which had to read it
+      uint64_t packetCacheMisses = 0;
+
+      /// Data packets given to the decoders of a CompressedVectorReader
+      uint64_t dataPacketsDecoded = 0;
+
+      /// Values (one per field of a record) decoded by each kind of decoder
+      uint64_t bitpackValuesDecoded = 0;
+      uint64_t constantValuesDecoded = 0;
+      uint64_t deltaValuesDecoded = 0;
+      uint64_t runLengthValuesDecoded = 0;
+
+      /// Nanoseconds spent reading from the file (or ImageFileIO)
+      uint64_t readNanoseconds = 0;
+
+      /// Nanoseconds spent verifying checksums
+      uint64_t checksumNanoseconds = 0;
+
+      /// Nanoseconds spent checking (and inflating) packets once they have been read
+      uint64_t packetParseNanoseconds = 0;
+
+      /// Nanoseconds spent by the decoders unpacking values into the destination buffers,
+      /// including the conversion to the buffers' types
+      uint64_t decodeNanoseconds = 0;
+
+      /// Nanoseconds spent by the Simple API converting the records once they have been decoded
+      /// (converting spherical coordinates to cartesian and applying poses)
+      uint64_t conversionNanoseconds = 0;
+   };
+
+   /// @brief Bytes held by the larger working buffers of an ImageFile (see
+   /// ImageFile::memoryUsage()).
+   /// @details This counts the packet cache and the packets read ahead of it, the range reads
+   /// made through an ImageFileIO, and the buffers of the encoders and decoders. It doesn't count
+   /// the node tree or buffers owned by the application.
+   struct E57_DLL ImageFileMemoryUsage
+   {
+      /// The budget the buffers were sized to fit in (see ReaderOptions::memoryBudget and
+      /// WriterOptions::memoryBudget), 0 if there is none
+      uint64_t budget = 0;
+
+      /// Bytes held now
+      uint64_t current = 0;
+
+      /// Most bytes held at once since the file was opened
+      uint64_t peak = 0;
+   };
+
+   /// @brief What was checked by ImageFile::verify().
+   struct E57_DLL ImageFileVerification
+   {
+      /// Physical pages whose checksums were verified (all of them)
+      uint64_t pageCount = 0;
+
+      /// Binary sections (of Blobs and CompressedVectors) whose headers were verified
+      uint64_t sectionCount = 0;
+
+      /// Packets of the CompressedVector sections whose headers were verified
+      uint64_t packetCount = 0;
+   };
+
    class E57_DLL ImageFile
    {
    public:
       ImageFile() = delete;
       ImageFile( const ustring &fname, const ustring &mode,
-                 ReadChecksumPolicy checksumPolicy = ChecksumAll );
+                 ReadChecksumPolicy checksumPolicy = ChecksumAll, bool lazyLoad = false );
+      ImageFile( std::shared_ptr<ImageFileIO> io, const ustring &mode,
+                 ReadChecksumPolicy checksumPolicy = ChecksumAll, bool lazyLoad = false );
       ImageFile( const char *input, uint64_t size,
                  ReadChecksumPolicy checksumPolicy = ChecksumAll );
 
@@ -742,6 +1158,9 @@ public:
       ustring fileName() const;
       int writerCount() const;
       int readerCount() const;
+      ImageFileStatistics statistics() const;
+      ImageFileMemoryUsage memoryUsage() const;
+      ImageFileVerification verify( unsigned threadCount = 1 ) const;
 
       // Manipulate registered extensions in the file
       void extensionsAdd( const ustring &prefix, const ustring &uri );
@@ -33,6 +33,10 @@
 /// @file
 /// @brief Data structures for E57 Simple API
 
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 #include "E57Format.h"
 
 namespace e57
@@ -616,10 +620,63 @@ namespace e57
       size_t pointCount = 0;
    };
 
+   /// Alignment (in bytes) of each buffer allocated by Data3DPointsData_t from a
+   /// Data3DPointsAllocator
+   constexpr size_t DATA3D_POINTS_ALIGNMENT = 64;
+
+   /// @brief Supplies the memory for the buffers of a Data3DPointsData_t.
+   /// @details The buffers of all the fields are placed in one block of memory, each starting on
+   /// a DATA3D_POINTS_ALIGNMENT boundary. This allocator gets each block from the heap and frees
+   /// it again; derive from it to take the memory from somewhere else.
+   class E57_DLL Data3DPointsAllocator
+   {
+   public:
+      virtual ~Data3DPointsAllocator() = default;
+
+      /// @returns at least size bytes which start on a DATA3D_POINTS_ALIGNMENT boundary
+      virtual void *allocate( size_t size );
+
+      /// @brief Give back memory returned by allocate( size ).
+      virtual void deallocate( void *memory, size_t size );
+   };
+
+   /// @brief A Data3DPointsAllocator which keeps the blocks it is given back, so the memory can be
+   /// reused for the buffers of the next Data3D block.
+   /// @details Blocks are reused for any request which fits in them. The pool must outlive the
+   /// Data3DPointsData_t using it. It isn't thread-safe.
+   class E57_DLL Data3DPointsPool : public Data3DPointsAllocator
+   {
+   public:
+      Data3DPointsPool() = default;
+      ~Data3DPointsPool() override;
+
+      Data3DPointsPool( const Data3DPointsPool & ) = delete;
+      Data3DPointsPool &operator=( const Data3DPointsPool & ) = delete;
+
+      void *allocate( size_t size ) override;
+      void deallocate( void *memory, size_t size ) override;
+
+      /// @brief Free the blocks which aren't in use.
+      void clear();
+
+   private:
+      struct Block
+      {
+         void *memory;
+         size_t size;
+      };
+
+      std::vector<Block> freeBlocks_;
+   };
+
    /// @brief Stores pointers to user-provided buffers
+   /// @details COORDTYPE is the type of the coordinates: float, double, or int32_t for the raw
+   /// integers of ScaledInteger coordinates (see Data3DPointsInt32).
    template <typename COORDTYPE = float> struct Data3DPointsData_t
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
+      static_assert( std::is_floating_point<COORDTYPE>::value ||
+                        std::is_same<COORDTYPE, int32_t>::value,
+                     "Floating point or int32_t type required." );
 
       /// @brief Default constructor does not manage any memory, adjust min/max for floats, or
       /// validate data.
@@ -639,8 +696,25 @@ namespace e57
       */
       explicit Data3DPointsData_t( e57::Data3D &data3D );
 
+      /*!
+      @brief Constructor which allocates buffers for all valid fields in the given Data3D header
+      from one block of memory.
+
+      @details
+      This does the same as Data3DPointsData_t( e57::Data3D & ), but the buffers are placed
+      together in one block from the allocator, each aligned to DATA3D_POINTS_ALIGNMENT. With a
+      Data3DPointsPool the block can be reused for the next Data3D block once this is destroyed.
+
+      @param [in] data3D Completed header which indicates the fields we are using
+      @param [in] allocator Supplies the memory. It must outlive this object.
+
+      @throw ::ErrorValueOutOfBounds
+      @throw ::ErrorInvalidNodeType
+      */
+      Data3DPointsData_t( e57::Data3D &data3D, Data3DPointsAllocator &allocator );
+
       /// @brief Destructor will delete any memory allocated using the Data3DPointsData_t( const
-      /// e57::Data3D & ) constructor
+      /// e57::Data3D & ) constructor, or give it back to its allocator
       ~Data3DPointsData_t();
 
       /// @brief Pointer to a buffer with the X coordinate (in meters) of the point in Cartesian
@@ -732,11 +806,27 @@ namespace e57
       /// @brief Keeps track of whether we used the Data3D constructor or not so we can free our
       /// memory.
       bool _selfAllocated = false;
+
+      /// @brief Where the buffers came from if they were allocated in one block, else null
+      Data3DPointsAllocator *_allocator = nullptr;
+      void *_block = nullptr;
+      size_t _blockSize = 0;
    };
 
    using Data3DPointsFloat = Data3DPointsData_t<float>;
    using Data3DPointsDouble = Data3DPointsData_t<double>;
 
+   /// @brief Buffers for points whose coordinates are stored as ScaledIntegers, holding the raw
+   /// integers of the coordinates instead of scaling them to floating point.
+   /// @details Each raw integer stands for raw * scale + offset, using the scale and offset of its
+   /// field (see Reader::GetData3DScaling()). This takes half the memory of Data3DPointsDouble
+   /// for the coordinates, e.g. for points which are scaled later on a GPU. Reading into these
+   /// throws if a coordinate field which is read isn't a ScaledInteger, and the Data3D
+   /// constructors throw if pointRangeNodeType, or angleNodeType for spherical angles, isn't
+   /// NumericalNodeType::ScaledInteger. Writing stores them as they are, using pointRangeScale and
+   /// angleScale (with an offset of 0).
+   using Data3DPointsInt32 = Data3DPointsData_t<int32_t>;
+
    /// @deprecated Will be removed in 4.0. Use e57::Data3DPointsFloat.
    using Data3DPointsData [[deprecated( "Will be removed in 4.0. Use Data3DPointsFloat." )]] =
       Data3DPointsData_t<float>;
@@ -746,6 +836,241 @@ namespace e57
 
    extern template struct Data3DPointsData_t<float>;
    extern template struct Data3DPointsData_t<double>;
+   extern template struct Data3DPointsData_t<int32_t>;
+
+   /// @brief Where one field is stored in the records of a Data3DPointsInterleaved
+   struct E57_DLL Data3DPointsField
+   {
+      /// Name of the field, which is the same as its Data3DPointsData_t member (e.g.
+      /// "cartesianX", "colorRed", or "normalX")
+      ustring name;
+
+      /// Type of the field in the record. Real16 stores a half precision float in a uint16_t
+      /// (e.g. for normals).
+      MemoryRepresentation memoryRepresentation = Real32;
+
+      /// Offset (in bytes) of the field from the start of each record
+      size_t offset = 0;
+
+      /// For UInt8 or UInt16 fields, store the values normalized from the limits of the field in
+      /// the file (its minimum and maximum) to 0..255 or 0..65535 (e.g. for color). For Real32
+      /// or Real64 fields, store them normalized to 0..1 (e.g. for intensity). Float fields in the
+      /// file need finite limits for this, as the Writer gives them from intensityLimits. The
+      /// values are converted as they are decoded, without another pass over them.
+      bool normalized = false;
+   };
+
+   /// @brief Describes a user-provided array of records with the fields of each point stored
+   /// together (e.g. struct { float x, y, z; uint8_t r, g, b; float intensity; })
+   /// @details For 8-bit color straight from the colorLimits (e.g. packed RGBA8 for a GPU), use
+   /// normalized UInt8 fields for colorRed, colorGreen, and colorBlue at offsets 0, 1, and 2 of
+   /// a 4 byte record; the alpha byte is left as it is. Intensity can likewise be read as a
+   /// normalized Real32 field holding 0..1 from the intensityLimits.
+   struct E57_DLL Data3DPointsInterleaved
+   {
+      /// Pointer to the first record
+      void *records = nullptr;
+
+      /// Size (in bytes) of each record, usually sizeof( the record's struct )
+      size_t stride = 0;
+
+      /// The fields to read into each record. Fields which the Data3D doesn't have are left
+      /// untouched.
+      std::vector<Data3DPointsField> fields;
+   };
+
+   /// @brief The MemoryRepresentation of a record field of C++ type T (see recordField())
+   template <typename T> struct MemoryRepresentationOf;
+
+   /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+#define E57_MEMORY_REPRESENTATION_OF( TYPE, REPRESENTATION )                                     \
+   template <> struct MemoryRepresentationOf<TYPE>                                               \
+   {                                                                                             \
+      static constexpr MemoryRepresentation value = REPRESENTATION;                              \
+   };
+
+   E57_MEMORY_REPRESENTATION_OF( int8_t, Int8 )
+   E57_MEMORY_REPRESENTATION_OF( uint8_t, UInt8 )
+   E57_MEMORY_REPRESENTATION_OF( int16_t, Int16 )
+   E57_MEMORY_REPRESENTATION_OF( uint16_t, UInt16 )
+   E57_MEMORY_REPRESENTATION_OF( int32_t, Int32 )
+   E57_MEMORY_REPRESENTATION_OF( uint32_t, UInt32 )
+   E57_MEMORY_REPRESENTATION_OF( int64_t, Int64 )
+   E57_MEMORY_REPRESENTATION_OF( bool, Bool )
+   E57_MEMORY_REPRESENTATION_OF( float, Real32 )
+   E57_MEMORY_REPRESENTATION_OF( double, Real64 )
+
+#undef E57_MEMORY_REPRESENTATION_OF
+   /// @endcond
+
+   /// @brief One field of a record struct, as given by its RECORD::e57Fields() (see
+   /// makeData3DPointsInterleaved())
+   template <typename RECORD, typename T> struct Data3DRecordField
+   {
+      /// Name of the field, as in Data3DPointsField
+      const char *name;
+
+      /// The member of RECORD the field is stored in
+      T RECORD::*member;
+
+      /// The type of the member, from MemoryRepresentationOf unless it holds a half float
+      MemoryRepresentation memoryRepresentation;
+
+      /// As in Data3DPointsField
+      bool normalized;
+   };
+
+   /// @brief Describe a field stored in a member of a record struct, typed by the member
+   template <typename RECORD, typename T>
+   constexpr Data3DRecordField<RECORD, T> recordField( const char *name, T RECORD::*member,
+                                                       bool normalized = false )
+   {
+      return { name, member, MemoryRepresentationOf<T>::value, normalized };
+   }
+
+   /// @brief Describe a field stored as a half precision float in a uint16_t member (Real16)
+   template <typename RECORD>
+   constexpr Data3DRecordField<RECORD, uint16_t> halfRecordField( const char *name,
+                                                                  uint16_t RECORD::*member )
+   {
+      return { name, member, Real16, false };
+   }
+
+   /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   namespace detail
+   {
+      template <typename RECORD, typename T>
+      Data3DPointsField data3DPointsField( const RECORD *records,
+                                           const Data3DRecordField<RECORD, T> &field )
+      {
+         Data3DPointsField pointsField;
+         pointsField.name = field.name;
+         pointsField.memoryRepresentation = field.memoryRepresentation;
+         pointsField.offset = static_cast<size_t>(
+            reinterpret_cast<const char *>( &( records->*field.member ) ) -
+            reinterpret_cast<const char *>( records ) );
+         pointsField.normalized = field.normalized;
+
+         return pointsField;
+      }
+
+      template <typename RECORD, typename FIELDS, size_t... I>
+      std::vector<Data3DPointsField> data3DPointsFields( const RECORD *records,
+                                                         const FIELDS &fields,
+                                                         std::index_sequence<I...> )
+      {
+         return { data3DPointsField( records, std::get<I>( fields ) )... };
+      }
+   }
+   /// @endcond
+
+   /// @brief Describe an array of records whose fields are given by the record struct itself
+   /// @details RECORD lists its fields with a static constexpr e57Fields() returning a
+   /// std::tuple of recordField() and halfRecordField(), e.g.
+   /// @code
+   /// struct Point
+   /// {
+   ///    float x, y, z;
+   ///    uint8_t red, green, blue;
+   ///
+   ///    static constexpr auto e57Fields()
+   ///    {
+   ///       return std::make_tuple( e57::recordField( "cartesianX", &Point::x ),
+   ///                               e57::recordField( "cartesianY", &Point::y ),
+   ///                               e57::recordField( "cartesianZ", &Point::z ),
+   ///                               e57::recordField( "colorRed", &Point::red, true ),
+   ///                               e57::recordField( "colorGreen", &Point::green, true ),
+   ///                               e57::recordField( "colorBlue", &Point::blue, true ) );
+   ///    }
+   /// };
+   /// @endcode
+   /// The types, offsets, and stride come from the struct, so they can't get out of step with
+   /// it, and a member of a type with no MemoryRepresentation doesn't compile. The records are
+   /// then read as any Data3DPointsInterleaved (see Reader::SetUpData3DRecords()).
+   /// @param [in] records the first of the records to read into
+   template <typename RECORD> Data3DPointsInterleaved makeData3DPointsInterleaved( RECORD *records )
+   {
+      static_assert( std::is_standard_layout<RECORD>::value,
+                     "Record structs must have a standard layout, so their fields have offsets" );
+
+      constexpr auto fields = RECORD::e57Fields();
+      constexpr size_t fieldCount = std::tuple_size<decltype( fields )>::value;
+
+      Data3DPointsInterleaved interleaved;
+      interleaved.records = records;
+      interleaved.stride = sizeof( RECORD );
+
+      // Without records there are no offsets to take, and the reader refuses them anyway
+      if ( records != nullptr )
+      {
+         interleaved.fields =
+            detail::data3DPointsFields( records, fields, std::make_index_sequence<fieldCount>() );
+      }
+
+      return interleaved;
+   }
+
+   /// @brief The values of one field for a block of points read using Data3DPointBlocks
+   struct E57_DLL Data3DPointColumn
+   {
+      /// Name of the field, as for Data3DPointsField (e.g. "cartesianX" or "normalX")
+      ustring name;
+
+      /// Type of the values, chosen to hold the field without converting it: the smallest
+      /// integer type which holds an Integer field's range, Real32 or Real64 for a Float field
+      /// depending on its precision, and Real64 for a ScaledInteger field (with its scale and
+      /// offset applied).
+      MemoryRepresentation memoryRepresentation = Real64;
+
+      /// The values, one per point. Cast this to the type given by memoryRepresentation, e.g.
+      /// to const uint8_t * for UInt8.
+      const void *data = nullptr;
+
+      /// The values as the given type, which must match memoryRepresentation
+      template <typename T> const T *values() const
+      {
+         return static_cast<const T *>( data );
+      }
+   };
+
+   /// @brief A block of points read using Data3DPointBlocks
+   struct E57_DLL Data3DPointBlock
+   {
+      /// Index of the first point of the block in its Data3D
+      int64_t firstPoint = 0;
+
+      /// Number of points in the block. Only the last block has fewer than the block size.
+      size_t pointCount = 0;
+
+      /// One column for each field asked for which the Data3D has, in the order asked for
+      std::vector<Data3DPointColumn> columns;
+
+      /// @brief Returns the column of the named field, or nullptr if there isn't one
+      const Data3DPointColumn *column( const ustring &name ) const;
+   };
+
+   /// @brief A run of points of a Data3D and the range of their values, from its zone map (see
+   /// WriterOptions::zoneMapPointCount)
+   struct E57_DLL Data3DZone
+   {
+      /// Index of the first point of the zone in its Data3D
+      int64_t firstPoint = 0;
+
+      /// Number of points in the zone
+      int64_t pointCount = 0;
+
+      /// Box holding the points of the zone with valid cartesian coordinates. Its minimums are
+      /// greater than its maximums if there are none.
+      CartesianBounds cartesianBounds;
+
+      /// Range of the valid intensities of the zone, if the zone map has them (both 0 if not)
+      double intensityMinimum = 0.0;
+      double intensityMaximum = 0.0;
+
+      /// Range of the valid time stamps of the zone, if the zone map has them (both 0 if not)
+      double timeStampMinimum = 0.0;
+      double timeStampMaximum = 0.0;
+   };
 
    /// @brief Stores an image that is to be used only as a visual reference.
    struct E57_DLL VisualReferenceRepresentation
@@ -996,4 +1321,18 @@ namespace e57
       E57_CYLINDRICAL DEPRECATED_ENUM( "Will be removed in 4.0. Use ProjectionCylindrical." ) =
          ProjectionCylindrical,
    };
+
+   /// @brief One image to read with Reader::ReadImage2DDataParallel()
+   struct E57_DLL Image2DRead
+   {
+      int64_t imageIndex = 0;                           ///< index of the image
+      Image2DProjection imageProjection = ProjectionNone; ///< projection of the image
+      Image2DType imageType = ImageNone;                ///< format of the image
+      void *buffer = nullptr;                           ///< buffer to read into
+      int64_t start = 0;                                ///< position in the blob to start at
+      int64_t count = 0;                                ///< number of bytes to read
+
+      /// Set to the number of bytes read, 0 if the image doesn't have this blob
+      int64_t transferred = 0;
+   };
 } // end namespace e57
@@ -35,6 +35,9 @@
 /// @details This includes support for the
 /// [E57_EXT_surface_normals](http://www.libe57.org/E57_EXT_surface_normals.txt) extension.
 
+#include <functional>
+#include <iterator>
+
 #include "E57SimpleData.h"
 
 namespace e57
@@ -44,6 +47,186 @@ namespace e57
    {
       /// Set how frequently to verify the checksums (see ReadChecksumPolicy).
       ReadChecksumPolicy checksumPolicy = ChecksumAll;
+
+      /// Number of threads (including the reading thread) used to verify checksums on large
+      /// reads such as images and big binary sections. 1 verifies them on the reading thread only.
+      /// 0 uses one thread per hardware thread.
+      unsigned int checksumThreadCount = 1;
+
+      /// How thoroughly the data packets and the values in them are checked as they are read
+      /// (see ValidationLevel). ValidationNone is faster for files you trust, e.g. those written
+      /// by your own tools, and ValidationDeep is meant for files from elsewhere.
+      ValidationLevel validationLevel = ValidationBasic;
+
+      /// Number of data packets (up to 64 KiB each) cached while reading point data. The cache is
+      /// shared by all the readers of the file. Files with many fields may benefit from a larger
+      /// cache since each field can be reading from a different packet. Must be at least 1.
+      unsigned int packetCacheSize = 32;
+
+      /// Number of threads (including the reading thread) used to decode the fields of point data.
+      /// Each field is stored in its own bytestream, so the fields in a data packet can be decoded
+      /// at the same time. 1 decodes them on the reading thread only. 0 uses one thread per
+      /// hardware thread.
+      unsigned int decodeThreadCount = 1;
+
+      /// Run the checksum verification and decoding described by checksumThreadCount and
+      /// decodeThreadCount, and the readers of ReadData3DPointsData() and
+      /// ReadData3DPointsDataParallel(), as tasks on this executor instead of threads started by
+      /// the library, e.g. to share a thread pool the application already has. The thread counts
+      /// still say how many ways the work is split, and 0 uses Executor::concurrency(). Null
+      /// starts threads. Range reads (see rangeReadsInFlight) always have threads of their own,
+      /// since they mostly wait for I/O.
+      std::shared_ptr<Executor> executor = nullptr;
+
+      /// Called with the spans of work done on the file as they finish (see TraceEvent), e.g. to
+      /// see how I/O and decoding overlap. The spans are only reported if the library was built
+      /// with the E57_TRACING CMake option. Those of opening the file are reported once it is
+      /// open. Empty reports nothing.
+      TraceHandler traceHandler = nullptr;
+
+      /// Supplies the memory of the file's larger internal buffers (see BufferAllocator), e.g. a
+      /// HugePageAllocator. Null takes them from the heap.
+      std::shared_ptr<BufferAllocator> bufferAllocator = nullptr;
+
+      /// When reading through an ImageFileIO, point data is read in requests of this many bytes
+      /// (rounded down to whole 1 KiB pages), well ahead of where it is needed. This cuts the
+      /// number of round trips to high latency stores, e.g. ranged GETs from an object store.
+      size_t rangeReadSize = 8 * 1024 * 1024;
+
+      /// Number of the requests described by rangeReadSize kept in flight for each Data3D block
+      /// being read. 0 reads only what is needed, when it is needed.
+      unsigned int rangeReadsInFlight = 4;
+
+      /// Read the file with direct I/O, bypassing the OS's page cache (O_DIRECT on Linux,
+      /// F_NOCACHE on macOS), so that reading huge files doesn't push other programs' data out of
+      /// it. The file isn't memory mapped then. It is ignored elsewhere and for ImageFileIO.
+      bool directIO = false;
+
+      /// Tell the OS how the point data is going to be read (posix_fadvise() on Linux and the
+      /// BSDs): each Data3D block front to back, a window of it ahead of time, and that what has
+      /// been read can be dropped from its cache. This helps its read ahead on slow disks. It is
+      /// ignored elsewhere and for ImageFileIO.
+      bool accessHints = false;
+
+      /// Size the larger working buffers to fit in this many bytes, 0 for no budget. The range
+      /// reads (see rangeReadSize) of all the blocks read at once take at most a quarter of it,
+      /// with fewer or smaller requests if need be. The packet cache and the packets read ahead
+      /// of it share the rest, with fewer packets than packetCacheSize asks for if need be (but
+      /// at least 1). The decoders' own buffers are small, and the node tree isn't counted.
+      /// ImageFile::memoryUsage() of GetRawIMF() reports the peak.
+      uint64_t memoryBudget = 0;
+
+      /// Parse the metadata of each Data3D and Image2D block when it is first read, instead of
+      /// all of it when the file is opened. This makes opening files with many blocks faster, but
+      /// errors in a block's metadata are only reported once it is read.
+      bool lazyLoad = false;
+
+      /// For Data3D blocks which have spherical but not cartesian coordinates, report cartesian
+      /// fields in their headers and compute cartesianX/Y/Z from the spherical coordinates as the
+      /// points are read. The spherical buffers may then be left out, e.g. by clearing the
+      /// spherical fields of the header before constructing Data3DPointsData_t from it.
+      /// cartesianInvalidState is read from sphericalInvalidState. This applies to reading into
+      /// Data3DPointsData_t buffers, not Data3DPointsInterleaved records.
+      bool sphericalToCartesian = false;
+
+      /// Transform the cartesian coordinates of each Data3D block by its pose as the points are
+      /// read, so the points of all the blocks are in the file's coordinate system. This is done
+      /// in double precision. ReadData3D() then reports an identity pose, though the cartesian
+      /// bounds remain in the block's own coordinates. With sphericalToCartesian, the computed
+      /// coordinates are transformed too. This applies to reading into Data3DPointsData_t
+      /// buffers, which must then have all of cartesianX/Y/Z or none of them.
+      bool applyPose = false;
+
+      /// Keep the points read by ReadData3DPointsData() and ReadData3DPointsDataParallel() in
+      /// sidecar files in this directory, one for each Data3D block and coordinate type, named
+      /// after the file's GUID and where the block's points are in it. Later reads of the block
+      /// into the same buffers (or fewer of them) copy the points from the memory mapped sidecar
+      /// instead of decoding them. A sidecar is made again if the file's length, modification
+      /// time or XML section have changed, if more buffers are asked for, or if
+      /// sphericalToCartesian or applyPose differ. The directory must exist. The points are still
+      /// read if a sidecar can't be written. Empty keeps no sidecars.
+      ustring decodedCacheDirectory;
+   };
+
+   /// @brief Called by Reader::ReadData3DPointsData() each time a Data3D block has been read.
+   /// @details It is called on the thread which read the block, so it may be called from several
+   /// threads at once.
+   /// @param [in] dataIndex index of the Data3D block which has been read
+   /// @param [in] pointCount number of points read into its buffers
+   using Data3DReadCallback = std::function<void( int64_t dataIndex, size_t pointCount )>;
+
+   class Data3DPointBlocksImpl;
+
+   /// @brief The points of a Data3D block, read one block of points at a time
+   /// @details Made by Reader::ReadData3DPointBlocks(). Each block is read into buffers owned by
+   /// this, which are reused for the next block, so a block is only valid until the next one is
+   /// read. The blocks can be pulled one at a time with next(), or iterated over:
+   /// @code
+   /// for ( const auto &block : reader.ReadData3DPointBlocks( 0, { "cartesianX" }, 10000 ) )
+   /// {
+   ///    const double *x = block.columns[0].values<double>();
+   ///    ...
+   /// }
+   /// @endcode
+   /// The Reader must stay open while this is used.
+   class E57_DLL Data3DPointBlocks
+   {
+   public:
+      /// @brief Input iterator over the blocks. Incrementing it reads the next block.
+      class E57_DLL Iterator
+      {
+      public:
+         using iterator_category = std::input_iterator_tag;
+         using value_type = Data3DPointBlock;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const Data3DPointBlock *;
+         using reference = const Data3DPointBlock &;
+
+         Iterator() = default;
+
+         reference operator*() const;
+         pointer operator->() const;
+         Iterator &operator++();
+
+         bool operator==( const Iterator &rhs ) const
+         {
+            return blocks_ == rhs.blocks_;
+         }
+
+         bool operator!=( const Iterator &rhs ) const
+         {
+            return blocks_ != rhs.blocks_;
+         }
+
+      private:
+         friend class Data3DPointBlocks;
+
+         explicit Iterator( Data3DPointBlocks *blocks );
+
+         Data3DPointBlocks *blocks_ = nullptr; // null at the end
+      };
+
+      /// @brief Reads the next block of points, replacing the one in block()
+      /// @return false (leaving block() empty) once all the points have been read
+      bool next();
+
+      /// @brief Returns the block read by the last call to next()
+      const Data3DPointBlock &block() const;
+
+      /// @brief Reads the first block if none has been read yet, and returns an iterator at the
+      /// current block
+      Iterator begin();
+
+      Iterator end();
+
+      /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   private:
+      friend class ReaderImpl;
+
+      explicit Data3DPointBlocks( std::shared_ptr<Data3DPointBlocksImpl> impl );
+
+      std::shared_ptr<Data3DPointBlocksImpl> impl_;
+      /// @endcond
    };
 
    /// @brief Used for reading an E57 file using E57 Simple API.
@@ -58,6 +241,11 @@ namespace e57
       /// @param [in] options Options to be used for the file
       Reader( const ustring &filePath, const ReaderOptions &options );
 
+      /// @brief Reader constructor for a file read through an ImageFileIO
+      /// @param [in] io Backend which reads the file (e.g. from a cloud store)
+      /// @param [in] options Options to be used for the file
+      Reader( std::shared_ptr<ImageFileIO> io, const ReaderOptions &options );
+
       /// @brief Reader constructor (deprecated)
       /// @param [in] filePath Path to E57 file
       /// @deprecated Will be removed in 4.0. Use Reader( const ustring &, const ReaderOptions & )
@@ -125,6 +313,27 @@ namespace e57
                                Image2DType imageType, void *buffer, int64_t start,
                                int64_t count ) const;
 
+      /// @brief Get a read-only view of an image's blob, without copying it when the file is in
+      /// memory (see BlobNode::view())
+      /// @param [in] imageIndex index of the image. Must be less than GetImage2DCount()
+      /// @param [in] imageProjection identifies the projection desired.
+      /// @param [in] imageType identifies the image format desired.
+      /// @return Returns the view of the whole blob, an empty view if the image doesn't have it.
+      BlobView GetImage2DView( int64_t imageIndex, Image2DProjection imageProjection,
+                               Image2DType imageType ) const;
+
+      /// @brief Read several images at once, sharing them between threadCount threads
+      /// @details The blobs are looked up on the calling thread, then read (and their checksums
+      /// verified) in parallel. Each read is as ReadImage2DData() would do it, and its
+      /// Image2DRead::transferred is set to the number of bytes read. This returns once all of
+      /// them have been read.
+      /// @param [in,out] reads the images to read
+      /// @param [in] threadCount maximum number of images to read at once. 0 uses one thread per
+      /// hardware thread (or ReaderOptions::executor's concurrency).
+      /// @return Returns true if successful
+      bool ReadImage2DDataParallel( std::vector<Image2DRead> &reads,
+                                    unsigned int threadCount ) const;
+
       ///@}
 
       /// @name Data3D
@@ -167,6 +376,18 @@ namespace e57
       bool ReadData3DGroupsData( int64_t dataIndex, size_t groupCount, int64_t *idElementValue,
                                  int64_t *startPointIndex, int64_t *pointCount ) const;
 
+      /// @brief Returns how the raw integers of a ScaledInteger point field are scaled
+      /// @details The value of a point is raw * scale + offset, e.g. for coordinates read into
+      /// Data3DPointsInt32 buffers.
+      /// @param [in] dataIndex This in the index into the images3D vector. Must be less than
+      /// GetData3DCount().
+      /// @param [in] fieldName name of the field, as for Data3DPointsField (e.g. "cartesianX")
+      /// @param [out] scale scale of the field
+      /// @param [out] offset offset of the field
+      /// @return Return true if successful, false if the field isn't a ScaledInteger
+      bool GetData3DScaling( int64_t dataIndex, const ustring &fieldName, double &scale,
+                             double &offset ) const;
+
       /// @brief Use this to read the actual 3D data
       /// @details All the non-NULL buffers in buffers have number of elements = pointCount.
       ///          Call the CompressedVectorReader::read() until all data is read.
@@ -181,6 +402,184 @@ namespace e57
       CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                     const Data3DPointsDouble &buffers ) const;
 
+      /// @overload
+      /// @details The coordinates are read as the raw integers they are stored as (see
+      /// Data3DPointsInt32 and GetData3DScaling()), so ReaderOptions::sphericalToCartesian and
+      /// ReaderOptions::applyPose don't change them.
+      /// @throw ::ErrorBadAPIArgument if a coordinate with a buffer isn't a ScaledInteger
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsInt32 &buffers ) const;
+
+      /// @brief Use this to read the 3D data into interleaved records
+      /// @details The buffer of records given by buffers holds pointCount records. The fields are
+      /// decoded straight into the records, so there is no need to copy them from separate
+      /// per-field buffers. Call the CompressedVectorReader::read() until all data is read.
+      /// @param [in] dataIndex data block index
+      /// @param [in] pointCount number of records in buffers
+      /// @param [in] buffers the records and where each field is stored in them
+      /// @return vector reader setup to read the selected data into the provided records
+      /// @throw ::ErrorBadAPIArgument if a field is unknown, given twice, doesn't fit in the
+      /// stride, or is normalized but isn't UInt8, UInt16, Real32, or Real64 or has no finite
+      /// limits
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsInterleaved &buffers ) const;
+
+      /// @brief Use this to read the 3D data into records described by their struct
+      /// @details The same as SetUpData3DPointsData() with makeData3DPointsInterleaved( records ),
+      /// so the fields of RECORD are given by its e57Fields().
+      /// @param [in] dataIndex data block index
+      /// @param [in] pointCount number of records in records
+      /// @param [in] records the records to read into
+      /// @return vector reader setup to read the selected data into the provided records
+      /// @throw ::ErrorBadAPIArgument as SetUpData3DPointsData()
+      template <typename RECORD>
+      CompressedVectorReader SetUpData3DRecords( int64_t dataIndex, size_t pointCount,
+                                                 RECORD *records ) const
+      {
+         return SetUpData3DPointsData( dataIndex, pointCount,
+                                       makeData3DPointsInterleaved( records ) );
+      }
+
+      /// @brief Make a reader set up by SetUpData3DPointsData() read another data block
+      /// @details For files with many small scans, this saves setting up a reader for each of
+      /// them: the buffers, decoders, and conversions of the reader are kept, and it starts over
+      /// at the first point of the data block (see CompressedVectorReader::restart()). The
+      /// data block must have the same point fields, with the same limits, as the one the reader
+      /// was set up for, and was written with the same codecs.
+      /// @param [in] dataIndex data block index
+      /// @param [in,out] reader an open reader returned by SetUpData3DPointsData()
+      /// @throw ::ErrorBadPrototype if the point fields differ
+      /// @throw ::ErrorBadCodecs if the codecs differ
+      /// @throw ::ErrorBadAPIArgument with ReaderOptions::applyPose, if the data blocks have
+      /// different poses
+      void RestartData3DPointsData( int64_t dataIndex, CompressedVectorReader &reader ) const;
+
+      /// @brief Read the zone map of a data block (see WriterOptions::zoneMapPointCount)
+      /// @param [in] dataIndex data block index
+      /// @param [out] zones the zones, in the order of their points
+      /// @return false if the data block has no zone map
+      bool ReadData3DZones( int64_t dataIndex, std::vector<Data3DZone> &zones ) const;
+
+      /// @brief Find the runs of points of a data block which may have points inside a box
+      /// @details Read the points of each zone with a reader from SetUpData3DPointsData(),
+      /// seeking to their first point (see CompressedVectorReader::seek()), and skip the rest.
+      /// The zones only say where the points inside the box can be: the points of a zone still
+      /// need to be compared with the box, e.g. with CompressedVectorReader::setRecordFilters().
+      /// Without a zone map, the one zone returned holds all the points.
+      /// @param [in] dataIndex data block index
+      /// @param [in] box the region of interest, in the coordinates the points are stored in
+      /// (i.e. without the pose of the data block)
+      /// @return the zones whose cartesian bounds overlap the box, in the order of their points
+      std::vector<Data3DZone> FindData3DZones( int64_t dataIndex,
+                                               const CartesianBounds &box ) const;
+
+      /// @brief Read the points of a Data3D block in blocks of blockSize points
+      /// @details Each field is read in the memoryRepresentation which holds it without
+      /// conversion (see Data3DPointColumn). The values are as stored in the file, so
+      /// ReaderOptions::sphericalToCartesian and ReaderOptions::applyPose don't apply.
+      /// @param [in] dataIndex data block index
+      /// @param [in] fields names of the fields to read, as for Data3DPointsField (e.g.
+      /// "cartesianX", "colorRed", or "normalX"). Fields which the Data3D doesn't have are left
+      /// out of the blocks. Empty reads all the fields it has.
+      /// @param [in] blockSize maximum number of points in each block
+      /// @return the blocks, which are read as they are asked for
+      /// @throw ::ErrorBadAPIArgument if a field is unknown or given twice, or blockSize is 0
+      Data3DPointBlocks ReadData3DPointBlocks( int64_t dataIndex,
+                                               const std::vector<ustring> &fields = {},
+                                               size_t blockSize = 64 * 1024 ) const;
+
+      /// @brief Read all the points of several Data3D blocks at the same time
+      /// @details Each block is read into its own buffers, which must hold all of its points
+      /// (e.g. constructed using its Data3D header). Up to threadCount blocks are read at once.
+      /// This will not use more threads than the number of packets in the cache (see
+      /// ReaderOptions::packetCacheSize). This returns once all of them have been read.
+      /// @param [in] dataIndices indices of the Data3D blocks to read
+      /// @param [in] buffers buffers for each block in dataIndices
+      /// @param [in] threadCount maximum number of blocks to read at once. 0 uses one thread per
+      /// hardware thread (or ReaderOptions::executor's concurrency).
+      /// @param [in] callback if set, called as each block is finished
+      /// @return Returns true if successful
+      /// @throw ::ErrorBadAPIArgument if the indices or buffers are not valid
+      bool ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                 const std::vector<Data3DPointsFloat *> &buffers,
+                                 unsigned int threadCount,
+                                 const Data3DReadCallback &callback = {} ) const;
+
+      /// @overload
+      bool ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                 const std::vector<Data3DPointsDouble *> &buffers,
+                                 unsigned int threadCount,
+                                 const Data3DReadCallback &callback = {} ) const;
+
+      /// @overload
+      bool ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                 const std::vector<Data3DPointsInt32 *> &buffers,
+                                 unsigned int threadCount,
+                                 const Data3DReadCallback &callback = {} ) const;
+
+      /// @brief Read all the points of one Data3D block using several threads
+      /// @details The block's points are split into up to threadCount ranges of consecutive
+      /// points. Each range is read by its own thread straight into its part of buffers, which
+      /// must hold all the points (e.g. constructed using the Data3D header). A record index of
+      /// the block is built from its data packet headers first (see
+      /// CompressedVectorReader::buildRecordIndex()), so each thread can start at the first point
+      /// of its range without decoding the ones before it. This works best for fields using the
+      /// bitPack codec. Other codecs have to be decoded from the start of the block, or of an
+      /// index chunk, up to that point. Ranges are at least 65536 points long, and there are no
+      /// more of them than the number of packets in the cache (see
+      /// ReaderOptions::packetCacheSize). This returns once all of them have been read.
+      /// @param [in] dataIndex data block index
+      /// @param [in] buffers buffers for all the points of the block
+      /// @param [in] threadCount maximum number of ranges to read at once. 0 uses one thread per
+      /// hardware thread (or ReaderOptions::executor's concurrency).
+      /// @return Returns true if successful
+      /// @throw ::ErrorBadAPIArgument if dataIndex is not valid
+      bool ReadData3DPointsDataParallel( int64_t dataIndex, Data3DPointsFloat &buffers,
+                                         unsigned int threadCount ) const;
+
+      /// @overload
+      bool ReadData3DPointsDataParallel( int64_t dataIndex, Data3DPointsDouble &buffers,
+                                         unsigned int threadCount ) const;
+
+      /// @brief Read a preview of a data block: a small sample of its points
+      /// @details With a preview written with WriterOptions::previewPointInterval, its points are
+      /// read. Without one, or if it has more than maxPointCount points, up to 64 runs of points
+      /// spread evenly through the data block (or the preview) are read. Each run is found with
+      /// CompressedVectorReader::seek(), so only the data packets holding it are decoded.
+      /// @param [in] dataIndex data block index
+      /// @param [in] maxPointCount number of points the buffers have room for
+      /// @param [out] buffers buffers to read the points into (see SetUpData3DPointsData())
+      /// @return Returns the number of points read
+      /// @throw ::ErrorBadAPIArgument if dataIndex is not valid or maxPointCount is negative
+      int64_t ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                 Data3DPointsFloat &buffers ) const;
+
+      /// @overload
+      int64_t ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                 Data3DPointsDouble &buffers ) const;
+
+      /// @brief Read the points of a structured data block in a window of rows and columns
+      /// @details The points whose rowIndex and columnIndex are within the row and column bounds
+      /// of window are read, in the order they are stored. If the points are grouped by line
+      /// (see ReadData3DGroupsData()), only the lines in the window are read, each found with
+      /// CompressedVectorReader::seek() from its startPointIndex, so the rest of the points are
+      /// not decoded. Otherwise all the points are read to find them. Reading stops once the
+      /// buffers are full.
+      /// @param [in] dataIndex data block index
+      /// @param [in] window rows and columns to read (the return bounds are not used)
+      /// @param [in] maxPointCount number of points the buffers have room for
+      /// @param [out] buffers buffers to read the points into (see SetUpData3DPointsData()).
+      /// rowIndex and columnIndex are required.
+      /// @return Returns the number of points read
+      /// @throw ::ErrorBadAPIArgument if dataIndex is not valid, maxPointCount is negative, or
+      /// the buffers have no rowIndex or columnIndex
+      int64_t ReadData3DWindow( int64_t dataIndex, const IndexBounds &window, int64_t maxPointCount,
+                                Data3DPointsFloat &buffers ) const;
+
+      /// @overload
+      int64_t ReadData3DWindow( int64_t dataIndex, const IndexBounds &window, int64_t maxPointCount,
+                                Data3DPointsDouble &buffers ) const;
+
       ///@}
 
       /// @name File information
@@ -211,4 +610,169 @@ namespace e57
       /// @endcond
    }; // end Reader class
 
+   /// @brief Used for reading only the header information of an E57 file.
+   ///
+   /// It gives the same E57Root, Data3D and Image2D headers as Reader, but the metadata of each
+   /// Data3D and Image2D block is only parsed while its header is being read. Memory use is
+   /// therefore bounded by the largest block rather than by the whole file, which suits
+   /// cataloguing many files (or files with many scans). Point and image data can't be read; use
+   /// Reader for that.
+   class E57_DLL MetadataReader
+   {
+   public:
+      /// @brief MetadataReader constructor
+      /// @param [in] filePath Path to E57 file
+      /// @param [in] options Options to be used for the file. ReaderOptions::lazyLoad is ignored
+      /// since blocks are always parsed on demand.
+      explicit MetadataReader( const ustring &filePath, const ReaderOptions &options = {} );
+
+      /// @brief Returns true if the file is open
+      bool IsOpen() const;
+
+      /// @brief Closes the file
+      bool Close();
+
+      /// @brief Returns the file header information
+      /// @param [out] fileHeader is the main header information
+      /// @return Returns true if successful
+      bool GetE57Root( E57Root &fileHeader ) const;
+
+      /// @brief Returns the total number of Picture Blocks
+      int64_t GetImage2DCount() const;
+
+      /// @brief Returns an image2D header
+      /// @param [in] imageIndex This in the index into the image2D vector
+      /// @param [out] image2DHeader Image2D header
+      /// @return Returns true if successful
+      bool ReadImage2D( int64_t imageIndex, Image2D &image2DHeader ) const;
+
+      /// @brief Returns the total number of Data3D Blocks
+      int64_t GetData3DCount() const;
+
+      /// @brief Returns a Data3D header
+      /// @param [in] dataIndex This in the index into the data3D vector. Must be less than
+      /// GetData3DCount().
+      /// @param [out] data3DHeader Data3D header
+      /// @return Returns true if successful
+      bool ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const;
+
+      /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   protected:
+      std::shared_ptr<ReaderImpl> impl_;
+      /// @endcond
+   }; // end MetadataReader class
+
+   /// @brief Options for a DatasetReader
+   struct E57_DLL DatasetOptions
+   {
+      /// Options each file is opened with. If its executor is null and it asks for more than one
+      /// checksum or decode thread, the files share an executor made by the DatasetReader, with
+      /// one thread per hardware thread, instead of each starting threads of its own.
+      ReaderOptions readerOptions;
+
+      /// Most files kept open at once. Past this, the files used least recently which nothing is
+      /// reading from are closed. This bounds the open files and the packet caches and other
+      /// buffers they hold. 0 keeps every file open once it has been opened.
+      unsigned int maxOpenFiles = 16;
+
+      /// Size the buffers of all the open files to fit in this many bytes: each is opened with a
+      /// ReaderOptions::memoryBudget of this divided by maxOpenFiles (or by the number of files if
+      /// it is 0). 0 uses readerOptions.memoryBudget for each file.
+      uint64_t memoryBudget = 0;
+
+      /// Number of threads running the reads submitted to the DatasetReader. 0 uses one thread
+      /// per hardware thread.
+      unsigned int threadCount = 0;
+
+      /// Most reads run at once from the files on each device (each file system device on POSIX,
+      /// each drive on Windows), so that reading many files doesn't make a disk seek between
+      /// all of them. Must be at least 1.
+      unsigned int readsPerDevice = 2;
+   };
+
+   class DatasetReaderImpl;
+
+   /// @brief Reads a set of E57 files which are used together (e.g. the scans of a project)
+   /// @details The files are opened when they are first used, and at most
+   /// DatasetOptions::maxOpenFiles of them are kept open. Reads of the files are submitted with
+   /// a priority and run on the DatasetReader's own threads: the highest priority read whose
+   /// device has room for it (see DatasetOptions::readsPerDevice) runs first, and reads of the
+   /// same priority run in the order they were submitted. For example, a viewer can submit the
+   /// scans in view with a higher priority than the rest.
+   /// @code
+   /// e57::DatasetReader dataset( filePaths, {} );
+   /// std::future<void> done = dataset.ReadData3DPointsData( 12, 0, buffers, 10 );
+   /// @endcode
+   /// It is safe to use from several threads at once. Destroying it waits for the reads which
+   /// have started. The futures of those which haven't throw std::future_error
+   /// (broken_promise).
+   class E57_DLL DatasetReader
+   {
+   public:
+      /// @brief Work done by Submit() on a file
+      using Task = std::function<void( Reader &reader )>;
+
+      /// @brief DatasetReader constructor. No file is opened.
+      /// @param [in] filePaths paths of the E57 files
+      /// @param [in] options options to be used for the files
+      /// @throw ::ErrorBadAPIArgument if options.readsPerDevice is 0
+      DatasetReader( const std::vector<ustring> &filePaths, const DatasetOptions &options );
+
+      ~DatasetReader();
+
+      DatasetReader( const DatasetReader & ) = delete;
+      DatasetReader &operator=( const DatasetReader & ) = delete;
+
+      /// @brief Returns the number of files
+      size_t FileCount() const;
+
+      /// @brief Returns the path of a file
+      /// @throw ::ErrorBadAPIArgument if fileIndex is not valid
+      ustring FilePath( size_t fileIndex ) const;
+
+      /// @brief Returns the number of files which are open
+      size_t OpenFileCount() const;
+
+      /// @brief Returns the Reader of a file, opening it if need be
+      /// @details The file is kept open while the Reader returned is held.
+      /// @throw ::ErrorBadAPIArgument if fileIndex is not valid
+      /// @throw the exceptions of Reader( const ustring &, const ReaderOptions & ) if the file
+      /// can't be opened
+      std::shared_ptr<Reader> GetReader( size_t fileIndex );
+
+      /// @brief Queue work to be done on a file by one of the DatasetReader's threads
+      /// @param [in] fileIndex index of the file, which is opened if need be
+      /// @param [in] task called with the file's Reader
+      /// @param [in] priority reads with larger priorities are run first
+      /// @return a future which becomes ready (or holds the exception thrown by opening the file
+      /// or by task) once task is done
+      /// @throw ::ErrorBadAPIArgument if fileIndex is not valid
+      std::future<void> Submit( size_t fileIndex, Task task, int priority = 0 );
+
+      /// @brief Queue reading all the points of a Data3D block of a file
+      /// @details This is Reader::ReadData3DPointsData() of the block, submitted with Submit().
+      /// buffers must hold all of the block's points, and must stay valid until the future is
+      /// ready.
+      /// @param [in] fileIndex index of the file, which is opened if need be
+      /// @param [in] dataIndex data block index in the file
+      /// @param [in] buffers buffers for all the points of the block
+      /// @param [in] priority reads with larger priorities are run first
+      /// @throw ::ErrorBadAPIArgument if fileIndex is not valid
+      std::future<void> ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                              Data3DPointsFloat &buffers, int priority = 0 );
+
+      /// @overload
+      std::future<void> ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                              Data3DPointsDouble &buffers, int priority = 0 );
+
+      /// @overload
+      std::future<void> ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                              Data3DPointsInt32 &buffers, int priority = 0 );
+
+      /// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+   private:
+      std::shared_ptr<DatasetReaderImpl> impl_;
+      /// @endcond
+   };
+
 } // end namespace e57
@@ -39,6 +39,13 @@
 
 namespace e57
 {
+   /// @brief Fills a block of points for Writer::WriteData3DData( Data3D &, size_t, ... ).
+   /// @details The buffers of block are those of the fields in the Data3D header. It returns the
+   /// number of points it put at the start of them, at most capacity, or 0 when there are no more.
+   template <typename COORDTYPE>
+   using Data3DPointsProducer =
+      std::function<size_t( Data3DPointsData_t<COORDTYPE> &block, size_t capacity )>;
+
    /// Options to the Writer constructor
    struct E57_DLL WriterOptions
    {
@@ -47,6 +54,138 @@ namespace e57
 
       /// Information describing the Coordinate Reference System to be used for the file
       ustring coordinateMetadata;
+
+      /// Number of threads (including the writing thread) used to encode point data. Batches of
+      /// points covering several chunks (the units the index points to) have each chunk encoded
+      /// on its own thread, and the data packets are written in order, just as one thread would
+      /// write them. Anything smaller has its fields, each stored in its own bytestream, encoded
+      /// at the same time. More than 1 also checksums and writes out the file in the background
+      /// while the next data is encoded. 1 does everything on the writing thread. 0 uses one
+      /// thread per hardware thread.
+      unsigned int encodeThreadCount = 1;
+
+      /// Run the encoding described by encodeThreadCount as tasks on this executor instead of
+      /// threads started by the library, e.g. to share a thread pool the application already
+      /// has. encodeThreadCount still says how many ways the work is split, and 0 uses
+      /// Executor::concurrency(). Null starts threads. The background writes always have a
+      /// thread of their own, since it mostly waits for I/O.
+      std::shared_ptr<Executor> executor = nullptr;
+
+      /// Called with the spans of work done on the file as they finish (see TraceEvent), e.g. to
+      /// see how encoding and I/O overlap. The spans are only reported if the library was built
+      /// with the E57_TRACING CMake option. Those of opening the file are reported once it is
+      /// open. Empty reports nothing.
+      TraceHandler traceHandler = nullptr;
+
+      /// Supplies the memory of the file's larger internal buffers (see BufferAllocator), e.g. a
+      /// HugePageAllocator. Null takes them from the heap.
+      std::shared_ptr<BufferAllocator> bufferAllocator = nullptr;
+
+      /// A data packet is written out once it holds at least this many bytes of point data. The
+      /// format allows packets of up to 65536 bytes, and setting this to 65536 fills each packet
+      /// as full as it can be, carrying what doesn't fit over to the next one. Fewer, fuller
+      /// packets mean less overhead when reading. 0 uses the default of 49152 (75% of the
+      /// maximum).
+      unsigned int packetFillTarget = 0;
+
+      /// Size in bytes of the output buffer of each field's encoder. Must be at least
+      /// packetFillTarget. 0 uses the default of 65536.
+      unsigned int encoderBufferSize = 0;
+
+      /// How the data packets are shared between the fields once they have more data than fits
+      /// in one (see PacketPacking). PacketPackingRecordAligned helps most when the fields are
+      /// stored with very different numbers of bits, or when encoderBufferSize lets the encoders
+      /// get far ahead of each other.
+      PacketPacking packetPacking = PacketPackingProportional;
+
+      /// How thoroughly the points are checked as they are written (see ValidationLevel).
+      /// ValidationNone skips checking that each value is within its field's limits, which is
+      /// only safe when the points are known to fit, e.g. because fitScaledIntegerRanges is set.
+      /// ValidationDeep also checks the index packets more thoroughly before writing them.
+      ValidationLevel validationLevel = ValidationBasic;
+
+      /// Compute the cartesian and spherical bounds of each Data3D block from its points as they
+      /// are written, and add them to its header when its CompressedVectorWriter is closed. Bounds
+      /// set in the Data3D header are written as given instead. Points whose invalid state says
+      /// their coordinates aren't valid are left out. The intensity and color limits are not
+      /// computed this way since they define how the points are stored.
+      bool computeBounds = false;
+
+      /// By default WriteData3DData() only computes the ranges of ScaledInteger fields (see
+      /// Data3D::pointFields and intensityLimits) from the points if they are left unset. With
+      /// this set, ranges given in the header are replaced by the range of the points too, so they
+      /// are stored with as few bits as possible. The limits of Integer intensity and color fields
+      /// are left as given since they also say how to scale the values.
+      bool fitScaledIntegerRanges = false;
+
+      /// Write a zone map for each Data3D block written with WriteData3DData() or a writer from
+      /// SetUpData3DPointsData(), holding the range of the cartesian coordinates (and of the
+      /// intensities and time stamps, if there are any) of each run of this many points. Readers
+      /// use it to skip the runs which can't hold points in a region (see
+      /// Reader::FindData3DZones()). It is stored with a libE57Format extension (see
+      /// e57::ZONE_MAP_URI) which other readers ignore. 0 doesn't write one. The Data3D block
+      /// needs cartesian coordinates.
+      int64_t zoneMapPointCount = 0;
+
+      /// Have WriteData3DData() store the points of each run of this many points in Morton
+      /// (Z-order) order of their cartesian coordinates, so points which are close in space are
+      /// close in the file too. This makes zone map runs (see zoneMapPointCount) and reads of a
+      /// region touch fewer packets. The buffers passed in are not changed. Points whose
+      /// coordinates aren't valid go at the end of each run. Write rowIndex and columnIndex to be
+      /// able to get back the original order. 0 keeps the points in the order given. The Data3D
+      /// block needs cartesian coordinates.
+      int64_t spatialOrderPointCount = 0;
+
+      /// Write a preview of each Data3D block written with WriteData3DData() or a writer from
+      /// SetUpData3DPointsData(): one point picked from each run of this many points (e.g. 100 for
+      /// 1%), stored with the same fields as the block. Reader::ReadData3DPreview() reads it
+      /// without decoding the rest of the points. It is stored with a libE57Format extension (see
+      /// e57::PREVIEW_URI) which other readers ignore. 0 doesn't write one.
+      int64_t previewPointInterval = 0;
+
+      /// Compress the point data of each Data3D block with deflate, from 1 (fastest) to 9
+      /// (smallest). 0 doesn't compress it. This uses a libE57Format extension (see
+      /// e57::DEFLATE_CODEC_URI), so the files can only be read by libE57Format built with
+      /// E57_WITH_ZLIB. Throws ErrorNotImplemented if the library was built without it.
+      int deflateLevel = 0;
+
+      /// Point fields (by their names in the prototype, e.g. "rowIndex") stored as differences
+      /// from the previous point using a libE57Format extension (see e57::DELTA_CODEC_URI). This
+      /// suits Integer and ScaledInteger fields which change slowly from point to point, such as
+      /// the row and column of a structured scan. Other fields, and those the Data3D doesn't
+      /// have, are ignored. The files can only be read by libE57Format.
+      std::vector<ustring> deltaCodecFields = {};
+
+      /// Point fields stored as runs of points with the same value using a libE57Format
+      /// extension (see e57::RUN_LENGTH_CODEC_URI). This suits Integer and ScaledInteger fields
+      /// which hardly ever change, such as cartesianInvalidState or returnIndex. Other fields,
+      /// and those the Data3D doesn't have, are ignored, as are fields in deltaCodecFields. The
+      /// files can only be read by libE57Format.
+      std::vector<ustring> runLengthCodecFields = {};
+
+      /// Expected size of the file in bytes. If set, space for the file is reserved when it is
+      /// created so the file system can lay it out in one piece instead of growing it with every
+      /// write. Whatever isn't used is given back when the file is closed. It is only a hint,
+      /// which is ignored for files written through an ImageFileIO and where the OS doesn't
+      /// support it.
+      uint64_t estimatedFileSize = 0;
+
+      /// Reserve space for a Data3D block's points (as they would be stored without compression)
+      /// before writing them with WriteData3DData() or a writer from SetUpData3DPointsData(), in
+      /// the same way as estimatedFileSize.
+      bool preallocatePointData = false;
+
+      /// Write the file with direct I/O, bypassing the OS's page cache (O_DIRECT on Linux,
+      /// F_NOCACHE on macOS), so that writing huge files doesn't push other programs' data out of
+      /// it. It is ignored elsewhere and for ImageFileIO.
+      bool directIO = false;
+
+      /// Size the larger working buffers to fit in this many bytes, 0 for no budget. Each
+      /// CompressedVector's encoders share half of it, with smaller output buffers and packets
+      /// than encoderBufferSize and packetFillTarget ask for if need be (but at least 1 KiB each),
+      /// and chunks encoded in parallel share the rest, or aren't used if one doesn't fit. The
+      /// node tree isn't counted. ImageFile::memoryUsage() of GetRawIMF() reports the peak.
+      uint64_t memoryBudget = 0;
    };
 
    /// @brief Used for writing an E57 file using the E57 Simple API.
@@ -61,6 +200,11 @@ namespace e57
       /// @param [in] options Options to be used for the file
       Writer( const ustring &filePath, const WriterOptions &options );
 
+      /// @brief Writer constructor for a file written through an ImageFileIO
+      /// @param [in] io Backend which writes the file (e.g. to a cloud store)
+      /// @param [in] options Options to be used for the file
+      Writer( std::shared_ptr<ImageFileIO> io, const WriterOptions &options );
+
       /// @brief Writer constructor (deprecated)
       /// @param [in] filePath Path to E57 file
       /// @param [in] coordinateMetadata Information describing the Coordinate Reference System to
@@ -133,6 +277,10 @@ namespace e57
       /// @details The user needs to config a Data3D structure with all the scanning information
       /// before making this call.
       /// @note @p data3DHeader may be modified (adding a guid or adding missing, required fields).
+      /// @note Several threads may call this at once to write different scans, e.g. one thread
+      /// per scan. Their points are encoded at the same time, and each scan after the first is
+      /// held in a temporary file until the one before it is finished. Nothing else may be
+      /// called on the Writer while they do.
       /// @param [in,out] data3DHeader metadata about what is included in the buffers
       /// @param [in] buffers pointers to user-provided buffers containing the actual data
       /// @return Returns the index of the new scan's data3D block.
@@ -141,6 +289,41 @@ namespace e57
       /// @overload
       int64_t WriteData3DData( Data3D &data3DHeader, const Data3DPointsDouble &buffers );
 
+      /// @overload
+      /// @details The coordinates are the raw integers of their ScaledInteger fields (see
+      /// Data3DPointsInt32), which are written as they are. pointRangeScale and angleScale say how
+      /// they are scaled, and missing ranges and bounds are worked out from the scaled values.
+      /// @throw ::ErrorBadAPIArgument if a coordinate with a buffer isn't a ScaledInteger
+      int64_t WriteData3DData( Data3D &data3DHeader, const Data3DPointsInt32 &buffers );
+
+      /// @brief This function writes the Data3D data to the file, asking producer for the points
+      /// a block at a time
+      /// @details The Writer owns two blocks of blockSize points, with aligned buffers for the
+      /// fields in @p data3DHeader. While one is being written (on another thread), producer
+      /// fills the other on the calling thread, until it returns 0.
+      ///
+      /// The points aren't known when the header is written, so ranges aren't worked out from
+      /// them (and WriterOptions::fitScaledIntegerRanges doesn't apply): ScaledInteger fields and
+      /// intensities need their ranges and limits set. With WriterOptions::spatialOrderPointCount,
+      /// each block is ordered in runs of that many points from its start.
+      /// @note @p data3DHeader may be modified as by WriteData3DData( Data3D &, const
+      /// Data3DPointsFloat & ), and its pointCount is set to the number of points written.
+      /// @param [in,out] data3DHeader metadata about what is included in the blocks
+      /// @param [in] blockSize number of points in each block (at least 1)
+      /// @param [in] producer fills the blocks. It must not use the Writer.
+      /// @return Returns the index of the new scan's data3D block.
+      /// @throw ::ErrorBadAPIArgument if blockSize is 0 or producer returns more than blockSize
+      int64_t WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                               const Data3DPointsProducer<float> &producer );
+
+      /// @overload
+      int64_t WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                               const Data3DPointsProducer<double> &producer );
+
+      /// @overload
+      int64_t WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                               const Data3DPointsProducer<int32_t> &producer );
+
       /// @brief Writes a new Data3D header
       /// @details The user needs to config a Data3D structure with all the scanning information
       /// before making this call.
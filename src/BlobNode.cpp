@@ -121,6 +121,9 @@ is attached to an ImageFile by adding it underneath the predefined root of the I
 from ImageFile::root). It is not an error to fail to attach the BlobNode to the @a destImageFile. It
 is an error to attempt to attach the BlobNode to a different ImageFile.
 
+The space is reserved at the end of the file, so a BlobNode can't be created while an open
+CompressedVectorWriter of the @a destImageFile is writing its data packets there.
+
 @pre The @a destImageFile must be open (i.e. destImageFile.isOpen() must be true).
 @pre The @a destImageFile must have been opened in write mode (i.e. destImageFile.isWritable()
 must be true).
@@ -129,6 +132,7 @@ must be true).
 @throw ::ErrorBadAPIArgument
 @throw ::ErrorImageFileNotOpen
 @throw ::ErrorFileReadOnly
+@throw ::ErrorTooManyWriters
 @throw ::ErrorInternal All objects in undocumented state
 
 @see Node, BlobNode::read, BlobNode::write
@@ -247,6 +251,42 @@ void BlobNode::read( uint8_t *buf, int64_t start, size_t count )
    impl_->read( buf, start, count );
 }
 
+/*!
+@brief Get a read-only view of some of the bytes of a blob, without copying them if the file is in
+memory.
+
+@param [in] start The index of the first byte in the blob to view.
+@param [in] count The number of bytes to view.
+
+@details
+When the ImageFile is open for reading and memory mapped (as local files are when possible, unless
+direct I/O is used), or was opened from a buffer, the segments of the view point straight into it,
+one for each page of the file the bytes are in. The checksum of a page is verified the first time
+its segment is asked for, so viewing a large blob costs nothing until it is used. Otherwise the
+bytes are read (and verified) into a buffer owned by the view.
+
+The view can be used until the ImageFile is closed. If the ImageFile is open for reading, views may
+be used by several threads at once.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre 0 <= @a start
+@pre (@a start + @a count) <= byteCount()
+
+@return The view of the bytes.
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReadFailed
+@throw ::ErrorBadChecksum
+@throw ::ErrorInternal All objects in undocumented state
+
+@see BlobNode::read, BlobView
+*/
+BlobView BlobNode::view( int64_t start, size_t count ) const
+{
+   return impl_->view( start, count );
+}
+
 /*!
 @brief Write a buffer of bytes to a blob.
 
@@ -365,3 +405,52 @@ BlobNode::BlobNode( std::shared_ptr<BlobNodeImpl> ni ) : impl_( ni )
 {
 }
 /// @endcond
+
+/*!
+@brief Get the number of bytes in the view.
+*/
+size_t BlobView::size() const
+{
+   return ( impl_ != nullptr ) ? impl_->size() : 0;
+}
+
+/*!
+@brief Get the number of contiguous segments the bytes of the view are in.
+*/
+size_t BlobView::segmentCount() const
+{
+   return ( impl_ != nullptr ) ? impl_->segmentCount() : 0;
+}
+
+/*!
+@brief Get one of the contiguous segments of the view, verifying its checksum the first time.
+
+@param [in] index The index of the segment, less than segmentCount(). The segments are in order.
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorBadChecksum
+*/
+BlobSegment BlobView::segment( size_t index ) const
+{
+   if ( impl_ == nullptr )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument, "index=" + toString( index ) + " segmentCount=0" );
+   }
+
+   return impl_->segment( index );
+}
+
+/*!
+@brief Does the view point into the file in memory, rather than into a copy of the bytes.
+*/
+bool BlobView::isInPlace() const
+{
+   return ( impl_ != nullptr ) && impl_->isInPlace();
+}
+
+/// @cond documentNonPublic The following isn't part of the API, and isn't documented.
+BlobView::BlobView( std::shared_ptr<BlobViewImpl> ni ) : impl_( std::move( ni ) )
+{
+}
+/// @endcond
@@ -51,9 +51,28 @@ namespace e57
          binarySectionLogicalLength_ += 4 - remainder;
       }
 
+      // The section can't go in between the data packets of a CompressedVectorWriter which has
+      // the end of the file
+      if ( !imf->claimFileEnd( this ) )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + imf->fileName() +
+                                  " writerCount=" + toString( imf->writerCount() ) );
+      }
+
       // Reserve space for blob in file, extend with zeros since writes will
       // happen at later time by caller
-      binarySectionLogicalStart_ = imf->allocateSpace( binarySectionLogicalLength_, true );
+      try
+      {
+         binarySectionLogicalStart_ = imf->allocateSpace( binarySectionLogicalLength_, true );
+      }
+      catch ( ... )
+      {
+         imf->releaseFileEnd( this );
+         throw;
+      }
+
+      imf->releaseFileEnd( this );
 
       // Prepare BlobSectionHeader
       BlobSectionHeader header;
@@ -136,9 +155,30 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->read( reinterpret_cast<char *>( buf ),
-                        static_cast<size_t>( count ) ); //??? arg1 void* ?
+
+      // Don't move the file's position, so blobs can be read while other threads use the file
+      imf->file_->readAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                          reinterpret_cast<char *>( buf ),
+                          static_cast<size_t>( count ) ); //??? arg1 void* ?
+   }
+
+   BlobView BlobNodeImpl::view( int64_t start, size_t count )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      if ( ( start < 0 ) || ( static_cast<uint64_t>( start ) + count > blobLogicalLength_ ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "this->pathName=" + this->pathName() +
+                                  " start=" + toString( start ) + " count=" + toString( count ) +
+                                  " length=" + toString( blobLogicalLength_ ) );
+      }
+
+      ImageFileImplSharedPtr imf( destImageFile_ );
+
+      const uint64_t logicalStart =
+         binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start;
+
+      return BlobView( std::make_shared<BlobViewImpl>( imf, logicalStart, count ) );
    }
 
    void BlobNodeImpl::write( uint8_t *buf, int64_t start, size_t count )
@@ -148,7 +188,9 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      if ( !destImageFile->isWriter() )
+      // Blobs which were already in an updated file stay as they are
+      if ( !destImageFile->isWriter() ||
+           destImageFile->isExistingData( binarySectionLogicalStart_ ) )
       {
          throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + destImageFile->fileName() );
       }
@@ -171,6 +213,68 @@ namespace e57
                          static_cast<size_t>( count ) ); //??? arg1 void* ?
    }
 
+   BlobViewImpl::BlobViewImpl( ImageFileImplSharedPtr imf, uint64_t logicalStart,
+                               size_t size ) :
+      imf_( imf ), size_( size )
+   {
+      if ( imf_->file_->isInMemory() )
+      {
+         firstPage_ = logicalStart / CheckedFile::logicalPageSize;
+         firstPageOffset_ =
+            static_cast<size_t>( logicalStart - firstPage_ * CheckedFile::logicalPageSize );
+         inPlace_ = true;
+      }
+      else
+      {
+         copy_.resize( size_ );
+         imf_->file_->readAt( logicalStart, reinterpret_cast<char *>( copy_.data() ), size_ );
+      }
+   }
+
+   size_t BlobViewImpl::segmentCount() const
+   {
+      if ( !inPlace_ || ( size_ == 0 ) )
+      {
+         return ( size_ > 0 ) ? 1 : 0;
+      }
+
+      return ( firstPageOffset_ + size_ + CheckedFile::logicalPageSize - 1 ) /
+             CheckedFile::logicalPageSize;
+   }
+
+   BlobSegment BlobViewImpl::segment( size_t index ) const
+   {
+      if ( !imf_->isOpen() )
+      {
+         throw E57_EXCEPTION2( ErrorImageFileNotOpen, "fileName=" + imf_->fileName() );
+      }
+
+      const size_t count = segmentCount();
+
+      if ( index >= count )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "index=" + toString( index ) +
+                                                       " segmentCount=" + toString( count ) );
+      }
+
+      if ( !inPlace_ )
+      {
+         return { copy_.data(), size_ };
+      }
+
+      // The first segment starts part way through its page, the others at the start of theirs
+      const size_t pageOffset = ( index == 0 ) ? firstPageOffset_ : 0;
+      const size_t viewOffset =
+         ( index == 0 ) ? 0
+                        : ( CheckedFile::logicalPageSize - firstPageOffset_ ) +
+                             ( index - 1 ) * CheckedFile::logicalPageSize;
+
+      const char *page_buffer = imf_->file_->pageInMemory( firstPage_ + index );
+
+      return { reinterpret_cast<const uint8_t *>( page_buffer + pageOffset ),
+               std::min( CheckedFile::logicalPageSize - pageOffset, size_ - viewOffset ) };
+   }
+
    void BlobNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
    {
       // don't checkImageFileOpen
@@ -195,7 +299,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       //??? need to implement
@@ -30,6 +30,34 @@
 
 namespace e57
 {
+   /// The pages of a Blob behind a BlobView, or a copy of its data if the file isn't in memory
+   class BlobViewImpl
+   {
+   public:
+      BlobViewImpl( ImageFileImplSharedPtr imf, uint64_t logicalStart, size_t size );
+
+      size_t size() const
+      {
+         return size_;
+      }
+
+      size_t segmentCount() const;
+      BlobSegment segment( size_t index ) const;
+
+      bool isInPlace() const
+      {
+         return inPlace_;
+      }
+
+   private:
+      ImageFileImplSharedPtr imf_;
+      uint64_t firstPage_ = 0;       /// physical page the data starts in
+      size_t firstPageOffset_ = 0;   /// where in that page it starts
+      size_t size_ = 0;
+      bool inPlace_ = false;
+      std::vector<uint8_t> copy_; /// the data, unless it is in place
+   };
+
    class BlobNodeImpl : public NodeImpl
    {
    public:
@@ -46,8 +74,15 @@ namespace e57
       bool isDefined( const ustring &pathName ) override;
 
       int64_t byteCount();
+
+      uint64_t getBinarySectionLogicalStart() const
+      {
+         return binarySectionLogicalStart_;
+      }
+
       void read( uint8_t *buf, int64_t start, size_t count );
       void write( uint8_t *buf, int64_t start, size_t count );
+      BlobView view( int64_t start, size_t count );
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#if defined( __linux__ )
+#include <sys/mman.h>
+#endif
+
+#include "Common.h"
+
+namespace e57
+{
+   namespace
+   {
+      size_t roundUp( size_t size, size_t multiple )
+      {
+         return ( size + multiple - 1 ) / multiple * multiple;
+      }
+   }
+
+   void *BufferAllocator::allocate( size_t size )
+   {
+      // Keep the address of the allocation just before the aligned memory we return
+      const size_t cExtra = BUFFER_ALIGNMENT - 1 + sizeof( void * );
+
+      auto allocation = static_cast<char *>( ::operator new( size + cExtra ) );
+
+      const auto cAddress = reinterpret_cast<uintptr_t>( allocation + sizeof( void * ) );
+      const auto cAligned =
+         ( cAddress + BUFFER_ALIGNMENT - 1 ) & ~static_cast<uintptr_t>( BUFFER_ALIGNMENT - 1 );
+
+      auto memory = reinterpret_cast<char *>( cAligned );
+
+      reinterpret_cast<void **>( memory )[-1] = allocation;
+
+      return memory;
+   }
+
+   void BufferAllocator::deallocate( void *memory, size_t size )
+   {
+      UNUSED( size );
+
+      if ( memory != nullptr )
+      {
+         ::operator delete( static_cast<void **>( memory )[-1] );
+      }
+   }
+
+   class HugePageAllocatorImpl
+   {
+   public:
+      explicit HugePageAllocatorImpl( bool numaLocal ) : numaLocal_( numaLocal )
+      {
+      }
+
+      ~HugePageAllocatorImpl()
+      {
+#if defined( __linux__ )
+         for ( char *page : sharedPages_ )
+         {
+            munmap( page, HugePageAllocator::hugePageSize );
+         }
+#endif
+      }
+
+#if defined( __linux__ )
+      /// Map size bytes (a multiple of the huge page size) starting on a huge page boundary
+      char *map( size_t size ) const
+      {
+         constexpr size_t cHugePageSize = HugePageAllocator::hugePageSize;
+
+         // Map an extra huge page so the start can be moved to a boundary, then cut off the rest
+         const size_t mappedSize = size + cHugePageSize;
+
+         void *mapped =
+            mmap( nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+         if ( mapped == MAP_FAILED )
+         {
+            throw std::bad_alloc();
+         }
+
+         auto *start = static_cast<char *>( mapped );
+         auto *aligned = reinterpret_cast<char *>( roundUp(
+            reinterpret_cast<uintptr_t>( start ), static_cast<uintptr_t>( cHugePageSize ) ) );
+
+         if ( aligned > start )
+         {
+            munmap( start, static_cast<size_t>( aligned - start ) );
+         }
+
+         munmap( aligned + size, static_cast<size_t>( start + mappedSize - ( aligned + size ) ) );
+
+         // Without transparent huge pages this fails, and the pages are just smaller
+         madvise( aligned, size, MADV_HUGEPAGE );
+
+         if ( numaLocal_ )
+         {
+            for ( size_t offset = 0; offset < size; offset += BUFFER_ALIGNMENT )
+            {
+               static_cast<volatile char *>( aligned )[offset] = 0;
+            }
+         }
+
+         return aligned;
+      }
+#endif
+
+      void *allocate( size_t size )
+      {
+#if defined( __linux__ )
+         constexpr size_t cHugePageSize = HugePageAllocator::hugePageSize;
+
+         const size_t blockSize = roundUp( std::max<size_t>( size, 1 ), BUFFER_ALIGNMENT );
+
+         if ( blockSize > cHugePageSize / 2 )
+         {
+            return map( roundUp( blockSize, cHugePageSize ) );
+         }
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         std::vector<void *> &freeBlocks = freeBlocks_[blockSize];
+
+         if ( !freeBlocks.empty() )
+         {
+            void *memory = freeBlocks.back();
+            freeBlocks.pop_back();
+
+            return memory;
+         }
+
+         // What is left of the last shared page is lost if this doesn't fit in it
+         if ( sharedPageLeft_ < blockSize )
+         {
+            sharedPages_.push_back( map( cHugePageSize ) );
+
+            sharedPageNext_ = sharedPages_.back();
+            sharedPageLeft_ = cHugePageSize;
+         }
+
+         void *memory = sharedPageNext_;
+
+         sharedPageNext_ += blockSize;
+         sharedPageLeft_ -= blockSize;
+
+         return memory;
+#else
+         UNUSED( numaLocal_ );
+
+         return heap_.allocate( size );
+#endif
+      }
+
+      void deallocate( void *memory, size_t size )
+      {
+         if ( memory == nullptr )
+         {
+            return;
+         }
+
+#if defined( __linux__ )
+         constexpr size_t cHugePageSize = HugePageAllocator::hugePageSize;
+
+         const size_t blockSize = roundUp( std::max<size_t>( size, 1 ), BUFFER_ALIGNMENT );
+
+         if ( blockSize > cHugePageSize / 2 )
+         {
+            munmap( memory, roundUp( blockSize, cHugePageSize ) );
+            return;
+         }
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         freeBlocks_[blockSize].push_back( memory );
+#else
+         heap_.deallocate( memory, size );
+#endif
+      }
+
+   private:
+      bool numaLocal_;
+
+#if defined( __linux__ )
+      std::mutex mutex_;
+
+      // Huge pages shared by the smaller blocks, and the part of the last one not handed out yet
+      std::vector<char *> sharedPages_;
+      char *sharedPageNext_ = nullptr;
+      size_t sharedPageLeft_ = 0;
+
+      // Blocks given back, by size, to be handed out again
+      std::unordered_map<size_t, std::vector<void *>> freeBlocks_;
+#else
+      BufferAllocator heap_;
+#endif
+   };
+
+   HugePageAllocator::HugePageAllocator( bool numaLocal ) :
+      impl_( new HugePageAllocatorImpl( numaLocal ) )
+   {
+   }
+
+   HugePageAllocator::~HugePageAllocator() = default;
+
+   void *HugePageAllocator::allocate( size_t size )
+   {
+      return impl_->allocate( size );
+   }
+
+   void HugePageAllocator::deallocate( void *memory, size_t size )
+   {
+      impl_->deallocate( memory, size );
+   }
+}
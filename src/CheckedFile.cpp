@@ -60,26 +60,29 @@
 #error "no supported OS platform defined"
 #endif
 
-#include <cmath>
+// Memory-mapped read support
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 #include <cstdio>
 #include <cstring>
+#include <iterator>
+#include <limits>
 #include <fcntl.h>
 
-// This is fixed in a newer version of CRCpp.
-//    https://github.com/d-bahr/CRCpp/issues/17
-// TODO: Remove when new CRCpp is released.
-#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
-// Disable warning about "conditional expression is constant".
-#pragma warning( push )
-#pragma warning( disable : 4127 )
-#endif
-#include "CRC.h"
-#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
-#pragma warning( pop )
-#endif
-
 #include "CheckedFile.h"
+#include "Checksum.h"
+#include "Statistics.h"
 #include "StringFunctions.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 // #define E57_CHECK_FILE_DEBUG
 #ifdef E57_CHECK_FILE_DEBUG
@@ -94,6 +97,16 @@ constexpr size_t CheckedFile::physicalPageSizeLog2;
 constexpr size_t CheckedFile::physicalPageSize;
 constexpr uint64_t CheckedFile::physicalPageSizeMask;
 constexpr size_t CheckedFile::logicalPageSize;
+constexpr size_t CheckedFile::maxPagesPerRead;
+constexpr size_t CheckedFile::maxPagesPerDirectRead;
+constexpr size_t CheckedFile::maxPagesPerWrite;
+constexpr size_t CheckedFile::textBufferSize;
+constexpr size_t CheckedFile::minPagesForParallelVerify;
+constexpr size_t CheckedFile::defaultRangeReadSize;
+constexpr unsigned CheckedFile::defaultRangeReadsInFlight;
+constexpr size_t CheckedFile::maxRangePlans;
+constexpr size_t CheckedFile::directIOAlignment;
+constexpr size_t CheckedFile::directIOBounceSize;
 
 namespace
 {
@@ -104,15 +117,34 @@ namespace
       return ( val << 16 ) | ( val >> 16 );
    }
 
-   /// Calc CRC32C of given data
-   uint32_t checksum( char *buf, size_t size )
+   /// Get the first address in buffer which is aligned to a physical page
+   char *pageAligned( IOBuffer &buffer )
+   {
+      const auto address = reinterpret_cast<uintptr_t>( buffer.data() );
+      const auto offset = static_cast<size_t>( address & CheckedFile::physicalPageSizeMask );
+      const auto padding = static_cast<size_t>( ( CheckedFile::physicalPageSize - offset ) &
+                                                CheckedFile::physicalPageSizeMask );
+
+      return buffer.data() + padding;
+   }
+
+   /// Write the decimal digits of value backwards, ending just before end
+   /// @returns The first digit
+   char *decimalDigits( uint64_t value, char *end )
    {
-      static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{ 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF,
-                                                                 true, true };
+      do
+      {
+         *--end = static_cast<char>( '0' + value % 10 );
+         value /= 10;
+      } while ( value != 0 );
 
-      static const CRC::Table<crcpp_uint32, 32> sCRCTable = sCRCParams.MakeTable();
+      return end;
+   }
 
-      auto crc = CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   /// Calc CRC32C of given data
+   uint32_t checksum( const char *buf, size_t size )
+   {
+      auto crc = crc32c( buf, size );
 
       // (Andy) I don't understand why we need to swap bytes here
       crc = swap_uint32( crc );
@@ -162,14 +194,28 @@ public:
       return true;
    }
 
-   void read( char *buffer, uint64_t count )
+   /// Get a pointer to count bytes in the buffer starting at offset.
+   /// @returns nullptr if the range is not entirely within the buffer
+   const char *data( uint64_t offset, uint64_t count ) const
    {
-      const uint64_t start = cursorStream_;
-      for ( uint64_t i = 0; i < count; ++i )
+      if ( ( offset > streamSize_ ) || ( count > streamSize_ - offset ) )
       {
-         buffer[i] = stream_[start + i];
-         ++cursorStream_;
+         return nullptr;
       }
+
+      return stream_ + offset;
+   }
+
+   /// Copy count bytes from the current cursor position and advance the cursor.
+   /// @returns the number of bytes copied (less than count at the end of the buffer)
+   uint64_t read( char *buffer, uint64_t count )
+   {
+      count = std::min( count, streamSize_ - cursorStream_ );
+
+      memcpy( buffer, stream_ + cursorStream_, static_cast<size_t>( count ) );
+      cursorStream_ += count;
+
+      return count;
    }
 
 private:
@@ -199,6 +245,12 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
          lseek64( 0, SEEK_SET );
 
          logicalLength_ = physicalToLogical( physicalLength_ );
+
+         initVerifiedPages();
+
+         // If we can map the whole file, all reads go through bufView_ from now on.
+         // Otherwise we silently fall back to reading pages through fd_.
+         mapFile();
       }
       break;
 
@@ -217,6 +269,23 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
          fd_ = open64( fileName_, writeFlags, writeMode );
       }
       break;
+
+      case Update:
+      {
+#if defined( _MSC_VER )
+         constexpr int updateFlags = O_RDWR | O_BINARY;
+#else
+         constexpr int updateFlags = O_RDWR;
+#endif
+
+         fd_ = open64( fileName_, updateFlags, 0 );
+
+         physicalLength_ = lseek64( 0LL, SEEK_END );
+         lseek64( 0, SEEK_SET );
+
+         logicalLength_ = physicalToLogical( physicalLength_ );
+      }
+      break;
    }
 }
 
@@ -231,6 +300,34 @@ CheckedFile::CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy p
    lseek64( 0, SEEK_SET );
 
    logicalLength_ = physicalToLogical( physicalLength_ );
+
+   initVerifiedPages();
+}
+
+CheckedFile::CheckedFile( std::shared_ptr<ImageFileIO> io, Mode mode, ReadChecksumPolicy policy ) :
+   fileName_( io->name() ), checkSumPolicy_( policy ), io_( std::move( io ) )
+{
+   if ( mode != Write )
+   {
+      readOnly_ = ( mode == Read );
+
+      try
+      {
+         physicalLength_ = io_->size();
+      }
+      catch ( const E57Exception & )
+      {
+         throw;
+      }
+      catch ( const std::exception &e )
+      {
+         throw E57_EXCEPTION2( ErrorOpenFailed, "fileName=" + fileName_ + " error=" + e.what() );
+      }
+
+      logicalLength_ = physicalToLogical( physicalLength_ );
+
+      initVerifiedPages();
+   }
 }
 
 int CheckedFile::open64( const ustring &fileName, int flags, int mode )
@@ -286,12 +383,31 @@ CheckedFile::~CheckedFile()
 }
 
 void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
+{
+   //??? check bufSize OK
+
+   const uint64_t offset = position( Logical );
+
+   readAt( offset, buf, nRead );
+
+   // When done, leave cursor just past end of last byte read
+   seek( offset + nRead, Logical );
+}
+
+void CheckedFile::readAt( uint64_t logicalOffset, char *buf, size_t nRead )
 {
    //??? what if read past logical end?, or physical end?
    //??? need to keep track of logical length?
-   //??? check bufSize OK
 
-   const uint64_t end = position( Logical ) + nRead;
+   // A file open for reading never changes, so it can be read by several threads at once
+   std::unique_lock<std::mutex> lock( readMutex_, std::defer_lock );
+
+   if ( !readOnly_ )
+   {
+      lock.lock();
+   }
+
+   const uint64_t end = logicalOffset + nRead;
    const uint64_t logicalLength = length( Logical );
 
    if ( end > logicalLength )
@@ -300,55 +416,117 @@ void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
                                               " length=" + toString( logicalLength ) );
    }
 
-   uint64_t page = 0;
-   size_t pageOffset = 0;
+   // If we are writing, make sure we read what has been written
+   if ( !readOnly_ )
+   {
+      flushText();
+      flushWriteBuffer( true );
+   }
 
-   getCurrentPageAndOffset( page, pageOffset );
+   // If the file isn't in memory we read it into a buffer. Use the shared one unless another
+   // thread has it.
+   std::unique_lock<std::mutex> bufferLock( readBufferMutex_, std::defer_lock );
+   IOBuffer ownBuffer( bufferAllocator_ );
+
+   if ( bufView_ == nullptr )
+   {
+      bufferLock.try_lock();
+   }
 
-   size_t n = std::min( nRead, logicalPageSize - pageOffset );
+   IOBuffer &buffer = bufferLock.owns_lock() ? readBuffer_ : ownBuffer;
 
-   // Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = page_buffer_v.data();
+   uint64_t page = logicalOffset / logicalPageSize;
+   size_t pageOffset = static_cast<size_t>( logicalOffset - page * logicalPageSize );
 
    while ( nRead > 0 )
    {
-      readPhysicalPage( page_buffer, page );
-
-      switch ( checkSumPolicy_ )
+      // If the file isn't in memory, read runs of whole pages straight into buf while it has
+      // room for their checksums too, then strip the checksums in place.
+      if ( ( bufView_ == nullptr ) && ( pageOffset == 0 ) && ( nRead >= physicalPageSize ) )
       {
-         case ChecksumPolicy::ChecksumNone:
-            break;
+         const size_t pageCount = std::min( nRead / physicalPageSize, maxPagesPerDirectRead );
 
-         case ChecksumPolicy::ChecksumAll:
-            verifyChecksum( page_buffer, page );
-            break;
+         readPhysicalPages( buf, page, pageCount );
+         verifyPages( buf, page, pageCount );
 
-         default:
+         for ( size_t i = 1; i < pageCount; ++i )
          {
-            const auto checksumMod =
-               static_cast<unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
-
-            if ( !( page % checksumMod ) || ( nRead < physicalPageSize ) )
-            {
-               verifyChecksum( page_buffer, page );
-            }
+            memmove( buf + i * logicalPageSize, buf + i * physicalPageSize, logicalPageSize );
          }
-         break;
+
+         buf += pageCount * logicalPageSize;
+         nRead -= pageCount * logicalPageSize;
+         page += pageCount;
+         continue;
       }
 
-      memcpy( buf, page_buffer + pageOffset, n );
+      // Fetch as many of the remaining pages as we can in one go. If the rest can be read
+      // straight into buf, just get the page we start in the middle of.
+      uint64_t pagesWanted = ( pageOffset + nRead + logicalPageSize - 1 ) / logicalPageSize;
 
-      buf += n;
-      nRead -= n;
-      pageOffset = 0;
-      ++page;
+      if ( ( bufView_ == nullptr ) && ( nRead >= logicalPageSize - pageOffset + physicalPageSize ) )
+      {
+         pagesWanted = 1;
+      }
+
+      size_t pageCount = 0;
+      const char *pages = physicalPages( page, pagesWanted, pageCount, buffer );
+
+      verifyPages( pages, page, pageCount );
+
+      for ( size_t i = 0; i < pageCount; ++i )
+      {
+         const char *page_buffer = pages + i * physicalPageSize;
+         const size_t n = std::min( nRead, logicalPageSize - pageOffset );
+
+         memcpy( buf, page_buffer + pageOffset, n );
+
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+         ++page;
+      }
+   }
+}
 
-      n = std::min( nRead, logicalPageSize );
+const char *CheckedFile::pageInMemory( uint64_t page )
+{
+   if ( !isInMemory() )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ );
    }
 
-   // When done, leave cursor just past end of last byte read
-   seek( end, Logical );
+   // Nothing is read into the buffer when the file is in memory
+   IOBuffer unusedBuffer;
+   size_t pageCount = 0;
+
+   const char *page_buffer = physicalPages( page, 1, pageCount, unusedBuffer );
+
+   verifyPages( page_buffer, page, pageCount );
+
+   return page_buffer;
+}
+
+size_t CheckedFile::readRecordAt( uint64_t logicalOffset, char *buf, size_t headerSize,
+                                  const std::function<size_t( const char *header )> &recordLength )
+{
+   // Read to the end of the first page (or of the file), which normally holds the header
+   const uint64_t pageEnd = ( logicalOffset / logicalPageSize + 1 ) * logicalPageSize;
+   const uint64_t firstEnd = std::max( std::min( pageEnd, length( Logical ) ),
+                                       logicalOffset + headerSize );
+   const auto firstRead = static_cast<size_t>( firstEnd - logicalOffset );
+
+   readAt( logicalOffset, buf, firstRead );
+
+   const size_t recordSize = recordLength( buf );
+
+   // The rest starts on a page boundary, so it never reads the first page again
+   if ( recordSize > firstRead )
+   {
+      readAt( firstEnd, buf + firstRead, recordSize - firstRead );
+   }
+
+   return recordSize;
 }
 
 void CheckedFile::write( const char *buf, size_t nWrite )
@@ -362,6 +540,8 @@ void CheckedFile::write( const char *buf, size_t nWrite )
       throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
    }
 
+   flushText();
+
    uint64_t end = position( Logical ) + nWrite;
 
    uint64_t page = 0;
@@ -371,31 +551,13 @@ void CheckedFile::write( const char *buf, size_t nWrite )
 
    size_t n = std::min( nWrite, logicalPageSize - pageOffset );
 
-   // Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = page_buffer_v.data();
-
    while ( nWrite > 0 )
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page * physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
+      // Pages are collected in the write buffer and written out (with their checksums) later
+      char *page_buffer = writablePage( page );
 
-#ifdef E57_VERBOSE
-      // cout << "  page_buffer[0] read: '" << page_buffer[0] << "'" << std::endl;
-      // cout << "copy " << n << "bytes to page=" << page << " pageOffset=" <<
-      // pageOffset << " buf='"; //??? for (size_t i=0; i < n; i++) cout <<
-      // buf[i]; cout << "'" << std::endl;
-#endif
       memcpy( page_buffer + pageOffset, buf, n );
-      writePhysicalPage( page_buffer, page );
-#ifdef E57_VERBOSE
-      // cout << "  page_buffer[0] after write: '" << page_buffer[0] << "'" <<
-      // std::endl; //???
-#endif
+
       buf += n;
       nWrite -= n;
       pageOffset = 0;
@@ -414,22 +576,39 @@ void CheckedFile::write( const char *buf, size_t nWrite )
 
 CheckedFile &CheckedFile::operator<<( const ustring &s )
 {
-   write( s.c_str(), s.length() ); //??? should be times size of uchar?
+   appendText( s.data(), s.length() ); //??? should be times size of uchar?
+   return ( *this );
+}
+
+CheckedFile &CheckedFile::operator<<( const char *s )
+{
+   appendText( s, strlen( s ) );
    return ( *this );
 }
 
 CheckedFile &CheckedFile::operator<<( int64_t i )
 {
-   std::stringstream ss;
-   ss << i;
-   return ( *this << ss.str() );
+   if ( i >= 0 )
+   {
+      return ( *this << static_cast<uint64_t>( i ) );
+   }
+
+   char digits[24];
+   char *first = decimalDigits( uint64_t{ 0 } - static_cast<uint64_t>( i ), std::end( digits ) );
+
+   *--first = '-';
+
+   appendText( first, static_cast<size_t>( std::end( digits ) - first ) );
+   return ( *this );
 }
 
 CheckedFile &CheckedFile::operator<<( uint64_t i )
 {
-   std::stringstream ss;
-   ss << i;
-   return ( *this << ss.str() );
+   char digits[24];
+   const char *first = decimalDigits( i, std::end( digits ) );
+
+   appendText( first, static_cast<size_t>( std::end( digits ) - first ) );
+   return ( *this );
 }
 
 CheckedFile &CheckedFile::operator<<( float f )
@@ -453,25 +632,70 @@ template <class FTYPE> CheckedFile &CheckedFile::writeFloatingPoint( FTYPE value
              << std::endl;
 #endif
 
-   return *this << floatingPointToStr( value, precision );
+   char chars[floatingPointMaxChars];
+   const size_t length = floatingPointToChars( value, precision, chars );
+
+   appendText( chars, length );
+   return ( *this );
+}
+
+void CheckedFile::appendText( const char *text, size_t length )
+{
+   if ( readOnly_ )
+   {
+      throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+   }
+
+   textBuffer_.append( text, length );
+
+   if ( textBuffer_.size() >= textBufferSize )
+   {
+      flushText();
+   }
+}
+
+void CheckedFile::flushText()
+{
+   if ( textBuffer_.empty() )
+   {
+      return;
+   }
+
+   // write() flushes the text first, so give it what we have in the other buffer
+   textWriteBuffer_.swap( textBuffer_ );
+
+   write( textWriteBuffer_.data(), textWriteBuffer_.size() );
+
+   textWriteBuffer_.clear();
 }
 
 void CheckedFile::seek( uint64_t offset, OffsetMode omode )
 {
+   flushText();
+
    //??? check for seek beyond logicalLength_
-   const auto pos =
-      static_cast<int64_t>( omode == Physical ? offset : logicalToPhysical( offset ) );
+   const uint64_t pos = ( omode == Physical ) ? offset : logicalToPhysical( offset );
 
 #ifdef E57_VERBOSE
    // cout << "seek offset=" << offset << " omode=" << omode << " pos=" << pos
    // << std::endl; //???
 #endif
-   lseek64( pos, SEEK_SET );
+
+   // Same restrictions as seeking the underlying file (or buffer) would have
+   if ( ( pos > static_cast<uint64_t>( std::numeric_limits<int64_t>::max() ) ) ||
+        ( ( bufView_ != nullptr ) && ( pos > physicalLength_ ) ) )
+   {
+      throw E57_EXCEPTION2( ErrorSeekFailed, "fileName=" + fileName_ +
+                                                " offset=" + toString( pos ) +
+                                                " whence=" + toString( SEEK_SET ) );
+   }
+
+   position_ = pos;
 }
 
 uint64_t CheckedFile::lseek64( int64_t offset, int whence )
 {
-   if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+   if ( bufView_ != nullptr )
    {
       const auto uoffset = static_cast<uint64_t>( offset );
 
@@ -507,36 +731,31 @@ uint64_t CheckedFile::lseek64( int64_t offset, int whence )
 
 uint64_t CheckedFile::position( OffsetMode omode )
 {
-   // Get current file cursor position
-   const uint64_t pos = lseek64( 0LL, SEEK_CUR );
+   flushText();
 
    if ( omode == Physical )
    {
-      return pos;
+      return position_;
    }
 
-   return physicalToLogical( pos );
+   return physicalToLogical( position_ );
 }
 
 uint64_t CheckedFile::length( OffsetMode omode )
 {
+   flushText();
+
    if ( omode == Physical )
    {
-      if ( readOnly_ )
+      // When writing, physicalLength_ tracks what we've written to the file, and anything
+      // still in the write buffer will be written past that.
+      if ( writeBufferPageCount_ > 0 )
       {
-         return physicalLength_;
+         return std::max( physicalLength_,
+                          ( writeBufferFirstPage_ + writeBufferPageCount_ ) * physicalPageSize );
       }
 
-      // Current file position
-      uint64_t original_pos = lseek64( 0LL, SEEK_CUR );
-
-      // End file position
-      uint64_t end_pos = lseek64( 0LL, SEEK_END );
-
-      // Restore original position
-      lseek64( original_pos, SEEK_SET );
-
-      return end_pos;
+      return physicalLength_;
    }
 
    return logicalLength_;
@@ -598,26 +817,14 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
       n = logicalPageSize - pageOffset;
    }
 
-   // Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = page_buffer_v.data();
-
    while ( nWrite > 0 )
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page * physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
-
 #ifdef E57_VERBOSE
       // cout << "extend " << n << "bytes on page=" << page << " pageOffset=" <<
       // pageOffset << std::endl;
       // //???
 #endif
-      memset( page_buffer + pageOffset, 0, n );
-      writePhysicalPage( page_buffer, page );
+      memset( writablePage( page ) + pageOffset, 0, n );
 
       nWrite -= n;
       pageOffset = 0;
@@ -640,8 +847,109 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
    seek( newLogicalLength, Logical );
 }
 
+void CheckedFile::preallocate( uint64_t physicalLength )
+{
+   if ( readOnly_ )
+   {
+      throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+   }
+
+   // Files written through an ImageFileIO are handled by its owner
+   if ( fd_ < 0 )
+   {
+      return;
+   }
+
+   const uint64_t reserved = std::max( physicalLength_, preallocatedLength_ );
+
+   if ( physicalLength <= reserved )
+   {
+      return;
+   }
+
+   // Failures are ignored: the space will be allocated by the writes as usual.
+#if defined( __linux__ )
+   if ( ::fallocate64( fd_, 0, static_cast<off64_t>( reserved ),
+                       static_cast<off64_t>( physicalLength - reserved ) ) == 0 )
+   {
+      preallocatedLength_ = physicalLength;
+   }
+#elif defined( _WIN32 )
+   // This only sets the allocation size, not the end of the file, so the space isn't readable
+   // until it has been written. The unused part is released when the file is closed.
+   FILE_ALLOCATION_INFO info;
+   info.AllocationSize.QuadPart = static_cast<LONGLONG>( physicalLength );
+
+   const auto handle = reinterpret_cast<HANDLE>( ::_get_osfhandle( fd_ ) );
+
+   if ( ( handle != INVALID_HANDLE_VALUE ) &&
+        ::SetFileInformationByHandle( handle, FileAllocationInfo, &info, sizeof( info ) ) )
+   {
+      preallocatedLength_ = physicalLength;
+   }
+#endif
+}
+
 void CheckedFile::close()
 {
+   if ( ( fd_ >= 0 ) || ( io_ != nullptr ) )
+   {
+      // Write out the rest before stopping the background thread. If this throws, don't leave a
+      // write running which uses buffers we are about to free.
+      try
+      {
+         flushText();
+         flushWriteBuffer();
+      }
+      catch ( ... )
+      {
+         backgroundPool_.reset();
+         throw;
+      }
+
+      waitForPendingWrite();
+
+#if defined( __linux__ )
+      // Give back the space reserved by preallocate() which we didn't write
+      if ( ( fd_ >= 0 ) && ( preallocatedLength_ > physicalLength_ ) )
+      {
+         if ( ::ftruncate64( fd_, static_cast<off64_t>( physicalLength_ ) ) < 0 )
+         {
+            backgroundPool_.reset();
+            throw E57_EXCEPTION2( ErrorWriteFailed, "fileName=" + fileName_ +
+                                                       " errno=" + toString( errno ) );
+         }
+      }
+#endif
+      preallocatedLength_ = 0;
+   }
+
+   // Let any background tasks finish while everything they might use is still here
+   backgroundPool_.reset();
+
+   // Reads which haven't started yet are skipped once their plans are gone
+   rangePlans_.clear();
+   rangePool_.reset();
+
+   if ( bufView_ != nullptr )
+   {
+      delete bufView_;
+      bufView_ = nullptr;
+
+      // WARNING: do NOT delete buffer of bufView_ because
+      // pointer is handled by user !!
+   }
+
+   unmapFile();
+
+#if defined( __linux__ )
+   if ( directFd_ >= 0 )
+   {
+      ::close( directFd_ );
+      directFd_ = -1;
+   }
+#endif
+
    if ( fd_ >= 0 )
    {
 #if defined( _MSC_VER )
@@ -660,18 +968,24 @@ void CheckedFile::close()
       fd_ = -1;
    }
 
-   if ( bufView_ != nullptr )
-   {
-      delete bufView_;
-      bufView_ = nullptr;
-
-      // WARNING: do NOT delete buffer of bufView_ because
-      // pointer is handled by user !!
-   }
+   io_.reset();
 }
 
 void CheckedFile::unlink()
 {
+   // No point writing out what we are about to remove
+   textBuffer_.clear();
+   writeBufferPageCount_ = 0;
+
+   // ...or reporting a failure to write it
+   try
+   {
+      waitForPendingWrite();
+   }
+   catch ( ... )
+   {
+   }
+
    close();
 
    // Try to remove the file, don't report a failure
@@ -686,20 +1000,570 @@ void CheckedFile::unlink()
 #endif
 }
 
-void CheckedFile::verifyChecksum( char *page_buffer, uint64_t page )
+void CheckedFile::truncateAndClose( uint64_t physicalLength )
 {
-   const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   const uint32_t check_sum_in_page =
-      *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] );
+   // Whatever hasn't been written yet is past physicalLength too
+   textBuffer_.clear();
+   writeBufferPageCount_ = 0;
 
-   if ( check_sum_in_page != check_sum )
+   try
    {
-      const uint64_t physicalLength = length( Physical );
-
-      throw E57_EXCEPTION2( ErrorBadChecksum,
-                            "fileName=" + fileName_ + " computedChecksum=" + toString( check_sum ) +
-                               " storedChecksum=" + toString( check_sum_in_page ) + " page=" +
-                               toString( page ) + " length=" + toString( physicalLength ) );
+      waitForPendingWrite();
+   }
+   catch ( ... )
+   {
+   }
+
+   if ( fd_ >= 0 )
+   {
+#if defined( _MSC_VER )
+      const int result = ::_chsize_s( fd_, static_cast<__int64>( physicalLength ) );
+#elif defined( __linux__ )
+      const int result = ::ftruncate64( fd_, static_cast<off64_t>( physicalLength ) );
+#else
+      const int result = ::ftruncate( fd_, static_cast<off_t>( physicalLength ) );
+#endif
+
+      if ( result != 0 )
+      {
+         close();
+         throw E57_EXCEPTION2( ErrorWriteFailed, "fileName=" + fileName_ +
+                                                    " errno=" + toString( errno ) );
+      }
+   }
+
+   // Don't let close() give the space back to what it thinks the length is
+   physicalLength_ = physicalLength;
+   logicalLength_ = physicalToLogical( physicalLength );
+   preallocatedLength_ = 0;
+
+   close();
+}
+
+uint64_t CheckedFile::verifyAllPages( ThreadPool *pool )
+{
+   const uint64_t pageCount = length( Physical ) / physicalPageSize;
+   const uint64_t runCount = ( pageCount + maxPagesPerRead - 1 ) / maxPagesPerRead;
+
+   // Give each thread a contiguous part of the file, so its reads stay sequential
+   const size_t threadCount = ( pool != nullptr ) ? pool->threadCount() + 1 : 1;
+   const auto partCount = static_cast<size_t>( std::min<uint64_t>( threadCount, runCount ) );
+
+   if ( partCount == 0 )
+   {
+      return 0;
+   }
+
+   const uint64_t runsPerPart = ( runCount + partCount - 1 ) / partCount;
+
+   const auto verifyPart = [&]( size_t part ) {
+      IOBuffer buffer( bufferAllocator_ );
+
+      const uint64_t partEnd = std::min( pageCount, ( part + 1 ) * runsPerPart * maxPagesPerRead );
+
+      for ( uint64_t page = part * runsPerPart * maxPagesPerRead; page < partEnd; )
+      {
+         size_t count = 0;
+         const char *pages = physicalPages( page, std::min<uint64_t>( partEnd - page,
+                                                                      maxPagesPerRead ),
+                                            count, buffer );
+
+         for ( size_t i = 0; i < count; ++i, ++page )
+         {
+            verifyChecksum( pages + i * physicalPageSize, page );
+
+            if ( !verifiedPages_.empty() )
+            {
+               verifiedPages_[static_cast<size_t>( page / 64 )].fetch_or(
+                  uint64_t{ 1 } << ( page % 64 ), std::memory_order_relaxed );
+            }
+         }
+      }
+   };
+
+   if ( partCount == 1 )
+   {
+      verifyPart( 0 );
+   }
+   else
+   {
+      pool->parallelFor( partCount, verifyPart );
+   }
+
+   return pageCount;
+}
+
+void CheckedFile::setChecksumThreadCount( unsigned int threadCount,
+                                          std::shared_ptr<Executor> executor )
+{
+   if ( threadCount == 0 )
+   {
+      threadCount = ThreadPool::defaultThreadCount( executor );
+   }
+
+   // The reading thread does some of the work, so we only need threadCount - 1 more
+   if ( threadCount > 1 )
+   {
+      verifyPool_.reset( new ThreadPool( threadCount - 1, std::move( executor ) ) );
+   }
+   else
+   {
+      verifyPool_.reset();
+   }
+}
+
+void CheckedFile::setBufferAllocator( std::shared_ptr<BufferAllocator> allocator )
+{
+   // The pending buffer can't be moved while it is being written out
+   waitForPendingWrite();
+
+   {
+      std::lock_guard<std::mutex> lock( readBufferMutex_ );
+      readBuffer_.setAllocator( allocator );
+   }
+
+   writeBuffer_.setAllocator( allocator );
+   pendingWriteBuffer_.setAllocator( allocator );
+
+   bufferAllocator_ = std::move( allocator );
+}
+
+void CheckedFile::setDirectIO( bool enable )
+{
+   if ( fd_ < 0 )
+   {
+      return;
+   }
+
+   // Nothing may be using the file the old way while we switch
+   waitForPendingWrite();
+
+   bool uncached = false;
+
+#if defined( __linux__ )
+   if ( enable && ( directFd_ < 0 ) )
+   {
+      // If the file system doesn't support O_DIRECT, we keep using the page cache
+      directFd_ = ::open( fileName_.c_str(), ( readOnly_ ? O_RDONLY : O_RDWR ) | O_DIRECT );
+   }
+   else if ( !enable && ( directFd_ >= 0 ) )
+   {
+      ::close( directFd_ );
+      directFd_ = -1;
+   }
+
+   uncached = ( directFd_ >= 0 );
+#elif defined( __APPLE__ )
+   uncached = ( ::fcntl( fd_, F_NOCACHE, enable ? 1 : 0 ) != -1 ) && enable;
+#else
+   UNUSED( enable );
+#endif
+
+   // Reads of a mapped file would go through the page cache
+   if ( uncached && ( mappedView_ != nullptr ) )
+   {
+      delete bufView_;
+      bufView_ = nullptr;
+
+      unmapFile();
+   }
+}
+
+void CheckedFile::setAccessHints( bool enable )
+{
+   accessHints_ = enable;
+}
+
+void CheckedFile::advise( uint64_t logicalStart, uint64_t logicalEnd, Advice advice )
+{
+   if ( !accessHints_ || ( fd_ < 0 ) || ( logicalEnd <= logicalStart ) )
+   {
+      return;
+   }
+
+   const uint64_t physicalStart = logicalToPhysical( logicalStart );
+   const uint64_t physicalEnd = logicalToPhysical( logicalEnd );
+
+#if defined( __linux__ ) || defined( __BSD )
+   int flag = POSIX_FADV_NORMAL;
+
+   switch ( advice )
+   {
+      case Sequential:
+         flag = POSIX_FADV_SEQUENTIAL;
+         break;
+      case WillNeed:
+         flag = POSIX_FADV_WILLNEED;
+         break;
+      case DontNeed:
+         flag = POSIX_FADV_DONTNEED;
+         break;
+   }
+
+   // Failures are ignored, since this doesn't change what is read
+#if defined( __linux__ )
+   ::posix_fadvise64( fd_, static_cast<off64_t>( physicalStart ),
+                      static_cast<off64_t>( physicalEnd - physicalStart ), flag );
+#else
+   ::posix_fadvise( fd_, static_cast<off_t>( physicalStart ),
+                    static_cast<off_t>( physicalEnd - physicalStart ), flag );
+#endif
+#else
+   UNUSED( physicalStart );
+   UNUSED( physicalEnd );
+   UNUSED( advice );
+#endif
+}
+
+void CheckedFile::setBackgroundWrites( bool enable )
+{
+   if ( readOnly_ )
+   {
+      throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+   }
+
+   if ( !enable )
+   {
+      // Everything from here on is written by the calling thread
+      waitForPendingWrite();
+   }
+
+   backgroundWrites_ = enable;
+}
+
+std::future<void> CheckedFile::runInBackground( std::function<void()> task )
+{
+   if ( backgroundPool_ == nullptr )
+   {
+      backgroundPool_.reset( new ThreadPool( 1 ) );
+   }
+
+   return backgroundPool_->submit( std::move( task ) );
+}
+
+void CheckedFile::planRangeReads( uint64_t logicalStart, uint64_t logicalEnd )
+{
+   if ( ( io_ == nullptr ) || !readOnly_ || ( rangeReadsInFlight_ == 0 ) )
+   {
+      return;
+   }
+
+   const uint64_t firstPage = logicalStart / logicalPageSize;
+   const uint64_t endPage = std::min( ( logicalEnd + logicalPageSize - 1 ) / logicalPageSize,
+                                      physicalLength_ / physicalPageSize );
+
+   if ( firstPage >= endPage )
+   {
+      return;
+   }
+
+   std::lock_guard<std::mutex> guard( rangeMutex_ );
+
+   auto found =
+      std::find_if( rangePlans_.begin(), rangePlans_.end(),
+                    [endPage]( const RangePlan &plan ) { return plan.endPage == endPage; } );
+
+   if ( found == rangePlans_.end() )
+   {
+      // Forget the section planned longest ago to make room
+      if ( rangePlans_.size() == maxRangePlans )
+      {
+         rangePlans_.erase( rangePlans_.begin() );
+      }
+
+      RangePlan plan;
+      plan.endPage = endPage;
+      plan.nextPage = firstPage;
+
+      rangePlans_.push_back( std::move( plan ) );
+   }
+   else
+   {
+      std::rotate( found, found + 1, rangePlans_.end() );
+   }
+
+   auto &plan = rangePlans_.back();
+
+   // Several bytestreams may be reading from packets a little behind the others, so only start
+   // again if we've moved past what has been requested or well before it (e.g. after a seek).
+   const uint64_t requestedPage =
+      plan.reads.empty() ? plan.nextPage : plan.reads.front()->firstPage;
+
+   if ( ( firstPage >= plan.nextPage ) || ( firstPage + rangeReadPages_ < requestedPage ) )
+   {
+      plan.reads.clear();
+      plan.nextPage = firstPage;
+   }
+
+   // Make room for more by dropping the reads we have moved past
+   while ( !plan.reads.empty() &&
+           ( plan.reads.front()->firstPage + plan.reads.front()->pageCount <= firstPage ) )
+   {
+      plan.reads.pop_front();
+   }
+
+   requestRangeReads( plan );
+}
+
+/// Keep rangeReadsInFlight_ reads requested for plan. rangeMutex_ must be locked.
+void CheckedFile::requestRangeReads( RangePlan &plan )
+{
+   if ( rangePool_ == nullptr )
+   {
+      rangePool_.reset( new ThreadPool( rangeReadsInFlight_ ) );
+   }
+
+   while ( ( plan.reads.size() < rangeReadsInFlight_ ) && ( plan.nextPage < plan.endPage ) )
+   {
+      auto read = std::make_shared<RangeRead>();
+      read->firstPage = plan.nextPage;
+      read->buffer = IOBuffer( bufferAllocator_ );
+      read->pageCount =
+         static_cast<size_t>( std::min<uint64_t>( rangeReadPages_, plan.endPage - plan.nextPage ) );
+
+      const std::weak_ptr<RangeRead> weakRead = read;
+
+      read->done = rangePool_
+                      ->submit( [this, weakRead] {
+                         const auto range = weakRead.lock();
+
+                         // Dropped from its plan before it started
+                         if ( range == nullptr )
+                         {
+                            return;
+                         }
+
+                         range->buffer.resize( range->pageCount * physicalPageSize );
+                         range->memory.reset( memoryUsage_, range->buffer.size() );
+
+                         readFromIO( range->buffer.data(), range->firstPage * physicalPageSize,
+                                     range->buffer.size() );
+                      } )
+                      .share();
+
+      plan.nextPage += read->pageCount;
+      plan.reads.push_back( std::move( read ) );
+   }
+}
+
+/// Copy pageCount pages starting at page from the range reads which cover them, waiting for the
+/// reads to finish if necessary.
+/// @returns false (without reading anything) if no plan has requested all of them
+bool CheckedFile::readFromRangePlans( char *page_buffer, uint64_t page, size_t pageCount )
+{
+   const uint64_t endPage = page + pageCount;
+
+   std::vector<std::shared_ptr<RangeRead>> reads;
+
+   {
+      std::lock_guard<std::mutex> guard( rangeMutex_ );
+
+      for ( const auto &plan : rangePlans_ )
+      {
+         uint64_t coveredPage = page;
+
+         for ( const auto &read : plan.reads )
+         {
+            if ( ( read->firstPage <= coveredPage ) &&
+                 ( coveredPage < read->firstPage + read->pageCount ) )
+            {
+               reads.push_back( read );
+               coveredPage = read->firstPage + read->pageCount;
+
+               if ( coveredPage >= endPage )
+               {
+                  break;
+               }
+            }
+         }
+
+         if ( coveredPage >= endPage )
+         {
+            break;
+         }
+
+         reads.clear();
+      }
+   }
+
+   if ( reads.empty() )
+   {
+      return false;
+   }
+
+   for ( const auto &read : reads )
+   {
+      // Throws whatever the read threw
+      read->done.get();
+
+      const uint64_t first = std::max( page, read->firstPage );
+      const uint64_t end = std::min( endPage, read->firstPage + read->pageCount );
+
+      std::memcpy( page_buffer + ( first - page ) * physicalPageSize,
+                   read->buffer.data() + ( first - read->firstPage ) * physicalPageSize,
+                   static_cast<size_t>( end - first ) * physicalPageSize );
+   }
+
+   return true;
+}
+
+void CheckedFile::setRangeReads( size_t requestSize, unsigned requestsInFlight )
+{
+   std::lock_guard<std::mutex> guard( rangeMutex_ );
+
+   // Finish the reads in flight before the pool is replaced, skipping the rest
+   rangePlans_.clear();
+   rangePool_.reset();
+
+   const uint64_t budget = ( memoryUsage_ != nullptr ) ? memoryUsage_->budget() : 0;
+
+   if ( ( budget > 0 ) && ( requestsInFlight > 0 ) )
+   {
+      const uint64_t planBudget = budget / 4 / maxRangePlans;
+
+      if ( planBudget < physicalPageSize )
+      {
+         requestsInFlight = 0;
+      }
+      else if ( planBudget < requestSize )
+      {
+         requestSize = static_cast<size_t>( planBudget );
+         requestsInFlight = 1;
+      }
+      else
+      {
+         const uint64_t fitCount = planBudget / std::max<size_t>( requestSize, 1 );
+
+         requestsInFlight =
+            static_cast<unsigned>( std::min<uint64_t>( requestsInFlight, fitCount ) );
+      }
+   }
+
+   rangeReadPages_ = std::max<size_t>( requestSize / physicalPageSize, 1 );
+   rangeReadsInFlight_ = requestsInFlight;
+}
+
+void CheckedFile::initVerifiedPages()
+{
+   // The contents can't change while reading, so we can remember which pages we've verified
+   if ( readOnly_ && ( checkSumPolicy_ != ChecksumPolicy::ChecksumNone ) )
+   {
+      const uint64_t pageCount = ( physicalLength_ + physicalPageSize - 1 ) / physicalPageSize;
+
+      const uint64_t wordCount = ( pageCount + 63 ) / 64;
+
+      verifiedPages_ = std::vector<std::atomic<uint64_t>>( static_cast<size_t>( wordCount ) );
+   }
+}
+
+bool CheckedFile::shouldVerifyPage( uint64_t page ) const
+{
+   // Each page only needs to be verified once while the file is open for reading
+   if ( !verifiedPages_.empty() &&
+        ( verifiedPages_[static_cast<size_t>( page / 64 )].load( std::memory_order_relaxed ) &
+          ( uint64_t{ 1 } << ( page % 64 ) ) ) )
+   {
+      return false;
+   }
+
+   switch ( checkSumPolicy_ )
+   {
+      case ChecksumPolicy::ChecksumNone:
+         return false;
+
+      case ChecksumPolicy::ChecksumAll:
+         return true;
+
+      default:
+      {
+         // Always check the first and last pages of the file
+         if ( ( page == 0 ) || ( ( page + 1 ) * physicalPageSize >= physicalLength_ ) )
+         {
+            return true;
+         }
+
+         // Otherwise pick checkSumPolicy_ pages out of every 100, spread out evenly
+         const auto policy = static_cast<uint64_t>( checkSumPolicy_ );
+
+         return ( ( ( page + 1 ) * policy ) / 100 ) != ( ( page * policy ) / 100 );
+      }
+   }
+}
+
+void CheckedFile::verifyPages( const char *pages, uint64_t firstPage, size_t pageCount )
+{
+   if ( checkSumPolicy_ == ChecksumPolicy::ChecksumNone )
+   {
+      return;
+   }
+
+   E57_STATISTICS_TIME( statistics_, checksumNanoseconds );
+
+   const auto verifyRange = [&]( size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; ++i )
+      {
+         if ( shouldVerifyPage( firstPage + i ) )
+         {
+            verifyChecksum( pages + i * physicalPageSize, firstPage + i );
+         }
+      }
+   };
+
+   const auto markVerified = [&]() {
+      if ( verifiedPages_.empty() )
+      {
+         return;
+      }
+
+      for ( size_t i = 0; i < pageCount; ++i )
+      {
+         if ( shouldVerifyPage( firstPage + i ) )
+         {
+            const uint64_t page = firstPage + i;
+
+            verifiedPages_[static_cast<size_t>( page / 64 )].fetch_or(
+               uint64_t{ 1 } << ( page % 64 ), std::memory_order_relaxed );
+         }
+      }
+   };
+
+   if ( ( verifyPool_ == nullptr ) || ( pageCount < minPagesForParallelVerify ) )
+   {
+      verifyRange( 0, pageCount );
+      markVerified();
+      return;
+   }
+
+   // Each page is independent, so split them up between the reading thread and the pool
+   const size_t chunkCount = std::min( verifyPool_->threadCount() + 1,
+                                       pageCount / ( minPagesForParallelVerify / 2 ) );
+   const size_t chunkSize = ( pageCount + chunkCount - 1 ) / chunkCount;
+
+   verifyPool_->parallelFor( chunkCount, [&]( size_t chunk ) {
+      verifyRange( chunk * chunkSize, std::min( pageCount, ( chunk + 1 ) * chunkSize ) );
+   } );
+
+   markVerified();
+}
+
+void CheckedFile::verifyChecksum( const char *page_buffer, uint64_t page )
+{
+   const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
+
+   E57_STATISTICS_ADD( statistics_, pagesVerified, 1 );
+
+   // The page may be in a user-supplied buffer, so don't assume alignment
+   uint32_t check_sum_in_page = 0;
+   memcpy( &check_sum_in_page, &page_buffer[logicalPageSize], sizeof( check_sum_in_page ) );
+
+   if ( check_sum_in_page != check_sum )
+   {
+      const uint64_t physicalLength = length( Physical );
+
+      throw E57_EXCEPTION2( ErrorBadChecksum,
+                            "fileName=" + fileName_ + " computedChecksum=" + toString( check_sum ) +
+                               " storedChecksum=" + toString( check_sum_in_page ) + " page=" +
+                               toString( page ) + " length=" + toString( physicalLength ) );
    }
 }
 
@@ -719,67 +1583,533 @@ void CheckedFile::getCurrentPageAndOffset( uint64_t &page, size_t &pageOffset, O
    }
 }
 
-void CheckedFile::readPhysicalPage( char *page_buffer, uint64_t page )
+void CheckedFile::readPhysicalPages( char *page_buffer, uint64_t page, size_t pageCount )
 {
-#ifdef E57_VERBOSE
-   // cout << "readPhysicalPage, page:" << page << std::endl;
-#endif
+   // Pages still being written in the background aren't in the file yet
+   waitForPendingWrite();
 
 #ifdef E57_CHECK_FILE_DEBUG
    const uint64_t physicalLength = length( Physical );
 
-   assert( page * physicalPageSize < physicalLength );
+   assert( ( page + pageCount ) * physicalPageSize <= physicalLength );
 #endif
 
-   // Seek to start of physical page
-   seek( page * physicalPageSize, Physical );
+   const uint64_t offset = page * physicalPageSize;
+   const size_t size = pageCount * physicalPageSize;
+
+   E57_STATISTICS_ADD( statistics_, bytesRead, size );
+   E57_STATISTICS_TIME( statistics_, readNanoseconds );
+   E57_TRACE_SPAN( tracer_, "readPages" );
+   E57_TRACE_BYTES( size );
+
+   if ( io_ != nullptr )
+   {
+      if ( !readFromRangePlans( page_buffer, page, pageCount ) )
+      {
+         readFromIO( page_buffer, offset, size );
+      }
+
+      return;
+   }
 
-   if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
+   if ( directFd_ >= 0 )
    {
-      bufView_->read( page_buffer, physicalPageSize );
+      transferDirect( page_buffer, offset, size, false );
       return;
    }
 
+   size_t total = 0;
+
+   while ( total < size )
+   {
+#if defined( _WIN32 )
+      // No positional read, so seek to the start of the remaining data
+      lseek64( static_cast<int64_t>( offset + total ), SEEK_SET );
+
+      const auto count = static_cast<unsigned int>( size - total );
 #if defined( _MSC_VER )
-   int result = ::_read( fd_, page_buffer, physicalPageSize );
-#elif defined( __GNUC__ )
-   ssize_t result = ::read( fd_, page_buffer, physicalPageSize );
+      int result = ::_read( fd_, page_buffer + total, count );
 #else
-#error "no supported compiler defined"
+      ssize_t result = ::read( fd_, page_buffer + total, count );
 #endif
+#elif defined( __linux__ )
+      ssize_t result = ::pread64( fd_, page_buffer + total, size - total,
+                                  static_cast<off64_t>( offset + total ) );
+#else
+      ssize_t result =
+         ::pread( fd_, page_buffer + total, size - total, static_cast<off_t>( offset + total ) );
+#endif
+
+      // The file must contain whole pages, so running out of data is an error too
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ + " result=" +
+                                                   toString( result ) + " page=" +
+                                                   toString( page ) + " count=" +
+                                                   toString( pageCount ) );
+      }
+
+      total += static_cast<size_t>( result );
+   }
+}
+
+const char *CheckedFile::physicalPages( uint64_t page, uint64_t pagesWanted, size_t &pageCount,
+                                       IOBuffer &buffer )
+{
+   if ( bufView_ != nullptr )
+   {
+      // The whole file is in memory, so use it in place
+      const char *data = nullptr;
+
+      if ( pagesWanted <= std::numeric_limits<size_t>::max() / physicalPageSize )
+      {
+         data = bufView_->data( page * physicalPageSize, pagesWanted * physicalPageSize );
+      }
+
+      if ( data == nullptr )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ + " page=" +
+                                                   toString( page ) + " count=" +
+                                                   toString( pagesWanted ) + " length=" +
+                                                   toString( physicalLength_ ) );
+      }
+
+      pageCount = static_cast<size_t>( pagesWanted );
+
+      E57_STATISTICS_ADD( statistics_, bytesRead, pageCount * physicalPageSize );
+
+      return data;
+   }
+
+   pageCount = static_cast<size_t>( std::min<uint64_t>( pagesWanted, maxPagesPerRead ) );
+
+   // Allocate the read buffer the first time we need it, aligned to the page size
+   if ( buffer.empty() )
+   {
+      buffer.resize( ( maxPagesPerRead + 1 ) * physicalPageSize );
+   }
+
+   char *pageBuffer = pageAligned( buffer );
+
+   readPhysicalPages( pageBuffer, page, pageCount );
+
+   return pageBuffer;
+}
+
+char *CheckedFile::writablePage( uint64_t page )
+{
+   if ( ( writeBufferPageCount_ > 0 ) && ( page >= writeBufferFirstPage_ ) &&
+        ( page < writeBufferFirstPage_ + writeBufferPageCount_ ) )
+   {
+      return pageAligned( writeBuffer_ ) + ( page - writeBufferFirstPage_ ) * physicalPageSize;
+   }
+
+   // Allocate the write buffer the first time we need it, aligned to the page size
+   if ( writeBuffer_.empty() )
+   {
+      writeBuffer_.resize( ( maxPagesPerWrite + 1 ) * physicalPageSize );
+   }
+
+   if ( ( writeBufferPageCount_ == 0 ) ||
+        ( page != writeBufferFirstPage_ + writeBufferPageCount_ ) )
+   {
+      // Not contiguous with what we have, so write it out and start again at this page
+      flushWriteBuffer();
+
+      writeBufferFirstPage_ = page;
+   }
+   else if ( writeBufferPageCount_ == maxPagesPerWrite )
+   {
+      // Full, so write it out. Keep the last page since it is probably only partially filled
+      // and we would just need to read it back in again.
+      flushWriteBuffer( true );
+   }
+
+   char *page_buffer = pageAligned( writeBuffer_ ) + writeBufferPageCount_ * physicalPageSize;
+
+   // We only need to read a page if we are modifying one which is already in the file
+   if ( page * physicalPageSize < physicalLength_ )
+   {
+      readPhysicalPages( page_buffer, page, 1 );
+   }
+   else
+   {
+      memset( page_buffer, 0, physicalPageSize );
+   }
+
+   ++writeBufferPageCount_;
+
+   return page_buffer;
+}
+
+void CheckedFile::flushWriteBuffer( bool keepLastPage )
+{
+   if ( writeBufferPageCount_ == 0 )
+   {
+      return;
+   }
+
+   const uint64_t firstPage = writeBufferFirstPage_;
+   const size_t pageCount = writeBufferPageCount_;
+
+   // Mark as written before we try so we don't try again with the same data if it fails
+   writeBufferPageCount_ = 0;
+
+   if ( backgroundWrites_ )
+   {
+      // Only one write is in flight at a time, so the buffer it uses is free once it is done
+      waitForPendingWrite();
+
+      std::swap( writeBuffer_, pendingWriteBuffer_ );
+
+      if ( writeBuffer_.empty() )
+      {
+         writeBuffer_.resize( pendingWriteBuffer_.size() );
+      }
+
+      char *data = pageAligned( pendingWriteBuffer_ );
+
+      if ( keepLastPage )
+      {
+         memcpy( pageAligned( writeBuffer_ ), data + ( pageCount - 1 ) * physicalPageSize,
+                 physicalPageSize );
+
+         writeBufferFirstPage_ = firstPage + pageCount - 1;
+         writeBufferPageCount_ = 1;
+      }
+
+      pendingWrite_ = runInBackground(
+         [this, data, firstPage, pageCount] { writePhysicalPages( data, firstPage, pageCount ); } );
+
+      physicalLength_ = std::max( physicalLength_, ( firstPage + pageCount ) * physicalPageSize );
+
+      return;
+   }
+
+   char *data = pageAligned( writeBuffer_ );
+
+   writePhysicalPages( data, firstPage, pageCount );
+
+   physicalLength_ = std::max( physicalLength_, ( firstPage + pageCount ) * physicalPageSize );
 
-   if ( result < 0 || static_cast<size_t>( result ) != physicalPageSize )
+   if ( keepLastPage )
    {
-      throw E57_EXCEPTION2( ErrorReadFailed,
-                            "fileName=" + fileName_ + " result=" + toString( result ) );
+      if ( pageCount > 1 )
+      {
+         memcpy( data, data + ( pageCount - 1 ) * physicalPageSize, physicalPageSize );
+      }
+
+      writeBufferFirstPage_ = firstPage + pageCount - 1;
+      writeBufferPageCount_ = 1;
+   }
+}
+
+void CheckedFile::waitForPendingWrite()
+{
+   if ( pendingWrite_.valid() )
+   {
+      // Rethrows anything thrown by writePhysicalPages()
+      pendingWrite_.get();
    }
 }
 
-void CheckedFile::writePhysicalPage( char *page_buffer, uint64_t page )
+void CheckedFile::writePhysicalPages( char *page_buffer, uint64_t page, size_t pageCount )
 {
 #ifdef E57_VERBOSE
-   // cout << "writePhysicalPage, page:" << page << std::endl;
+   // cout << "writePhysicalPages, page:" << page << " count:" << pageCount << std::endl;
 #endif
 
-   // Append checksum
-   uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] ) =
-      check_sum; //??? little endian dependency
+   E57_TRACE_SPAN( tracer_, "writePages" );
+   E57_TRACE_BYTES( pageCount * physicalPageSize );
+
+   // Append checksums
+   for ( size_t i = 0; i < pageCount; ++i )
+   {
+      char *current = page_buffer + i * physicalPageSize;
+
+      uint32_t check_sum = checksum( current, logicalPageSize );
+      memcpy( &current[logicalPageSize], &check_sum,
+              sizeof( check_sum ) ); //??? little endian dependency
+   }
+
+   const uint64_t offset = page * physicalPageSize;
+   const size_t size = pageCount * physicalPageSize;
+
+   if ( io_ != nullptr )
+   {
+      writeToIO( page_buffer, offset, size );
+      return;
+   }
+
+   if ( directFd_ >= 0 )
+   {
+      transferDirect( page_buffer, offset, size, true );
+      return;
+   }
+
+   size_t total = 0;
 
-   // Seek to start of physical page
-   seek( page * physicalPageSize, Physical );
+   while ( total < size )
+   {
+#if defined( _WIN32 )
+      // No positional write, so seek to the start of the remaining data
+      lseek64( static_cast<int64_t>( offset + total ), SEEK_SET );
 
+      const auto count = static_cast<unsigned int>( size - total );
 #if defined( _MSC_VER )
-   int result = ::_write( fd_, page_buffer, physicalPageSize );
-#elif defined( __GNUC__ )
-   ssize_t result = ::write( fd_, page_buffer, physicalPageSize );
+      int result = ::_write( fd_, page_buffer + total, count );
 #else
-#error "no supported compiler defined"
+      ssize_t result = ::write( fd_, page_buffer + total, count );
+#endif
+#elif defined( __linux__ )
+      ssize_t result = ::pwrite64( fd_, page_buffer + total, size - total,
+                                   static_cast<off64_t>( offset + total ) );
+#else
+      ssize_t result =
+         ::pwrite( fd_, page_buffer + total, size - total, static_cast<off_t>( offset + total ) );
 #endif
 
-   if ( result < 0 )
+      if ( result < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorWriteFailed,
+                               "fileName=" + fileName_ + " result=" + toString( result ) );
+      }
+
+      total += static_cast<size_t>( result );
+   }
+}
+
+void CheckedFile::transferAt( int fd, char *buffer, uint64_t offset, size_t size, bool write )
+{
+#if defined( __linux__ )
+   size_t total = 0;
+
+   while ( total < size )
+   {
+      const auto position = static_cast<off64_t>( offset + total );
+
+      ssize_t result = write ? ::pwrite64( fd, buffer + total, size - total, position )
+                             : ::pread64( fd, buffer + total, size - total, position );
+
+      if ( ( result < 0 ) || ( !write && result == 0 ) )
+      {
+         const std::string context = "fileName=" + fileName_ + " result=" + toString( result ) +
+                                     " errno=" + toString( errno ) +
+                                     " offset=" + toString( offset + total );
+         if ( write )
+         {
+            throw E57_EXCEPTION2( ErrorWriteFailed, context );
+         }
+
+         throw E57_EXCEPTION2( ErrorReadFailed, context );
+      }
+
+      total += static_cast<size_t>( result );
+   }
+#else
+   UNUSED( fd );
+   UNUSED( buffer );
+   UNUSED( offset );
+   UNUSED( size );
+   UNUSED( write );
+
+   throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ );
+#endif
+}
+
+void CheckedFile::transferDirect( char *buffer, uint64_t offset, size_t size, bool write )
+{
+   constexpr uint64_t alignmentMask = directIOAlignment - 1;
+
+   const uint64_t alignedStart = ( offset + alignmentMask ) & ~alignmentMask;
+   const uint64_t alignedEnd = ( offset + size ) & ~alignmentMask;
+
+   if ( alignedEnd <= alignedStart )
+   {
+      transferAt( fd_, buffer, offset, size, write );
+      return;
+   }
+
+   // The unaligned ends go through the page cache
+   const auto head = static_cast<size_t>( alignedStart - offset );
+   const auto tail = static_cast<size_t>( offset + size - alignedEnd );
+
+   if ( head > 0 )
+   {
+      transferAt( fd_, buffer, offset, head, write );
+   }
+
+   char *middle = buffer + head;
+   const auto middleSize = static_cast<size_t>( alignedEnd - alignedStart );
+
+   if ( ( reinterpret_cast<uintptr_t>( middle ) & alignmentMask ) == 0 )
+   {
+      transferAt( directFd_, middle, alignedStart, middleSize, write );
+   }
+   else
+   {
+      // Our pages are only aligned to physicalPageSize, so copy through an aligned buffer
+      const size_t bounceSize = std::min( middleSize, directIOBounceSize );
+
+      std::vector<char> bounce( bounceSize + directIOAlignment );
+
+      const auto address = reinterpret_cast<uintptr_t>( bounce.data() );
+      char *aligned = bounce.data() + ( ( directIOAlignment - ( address & alignmentMask ) ) &
+                                        alignmentMask );
+
+      for ( size_t done = 0; done < middleSize; done += bounceSize )
+      {
+         const size_t n = std::min( bounceSize, middleSize - done );
+
+         if ( write )
+         {
+            memcpy( aligned, middle + done, n );
+            transferAt( directFd_, aligned, alignedStart + done, n, true );
+         }
+         else
+         {
+            transferAt( directFd_, aligned, alignedStart + done, n, false );
+            memcpy( middle + done, aligned, n );
+         }
+      }
+   }
+
+   if ( tail > 0 )
+   {
+      transferAt( fd_, buffer + size - tail, alignedEnd, tail, write );
+   }
+}
+
+void CheckedFile::readFromIO( char *buffer, uint64_t offset, size_t size )
+{
+   size_t total = 0;
+
+   while ( total < size )
+   {
+      size_t result = 0;
+
+      try
+      {
+         result = io_->readAt( offset + total, buffer + total, size - total );
+      }
+      catch ( const E57Exception & )
+      {
+         throw;
+      }
+      catch ( const std::exception &e )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ + " offset=" +
+                                                   toString( offset + total ) +
+                                                   " error=" + e.what() );
+      }
+
+      // The file must contain whole pages, so running out of data is an error too
+      if ( ( result == 0 ) || ( result > size - total ) )
+      {
+         throw E57_EXCEPTION2( ErrorReadFailed, "fileName=" + fileName_ + " result=" +
+                                                   toString( result ) + " offset=" +
+                                                   toString( offset + total ) );
+      }
+
+      total += result;
+   }
+}
+
+void CheckedFile::writeToIO( const char *buffer, uint64_t offset, size_t size )
+{
+   size_t total = 0;
+
+   while ( total < size )
+   {
+      size_t result = 0;
+
+      try
+      {
+         result = io_->writeAt( offset + total, buffer + total, size - total );
+      }
+      catch ( const E57Exception & )
+      {
+         throw;
+      }
+      catch ( const std::exception &e )
+      {
+         throw E57_EXCEPTION2( ErrorWriteFailed, "fileName=" + fileName_ + " offset=" +
+                                                    toString( offset + total ) +
+                                                    " error=" + e.what() );
+      }
+
+      if ( ( result == 0 ) || ( result > size - total ) )
+      {
+         throw E57_EXCEPTION2( ErrorWriteFailed, "fileName=" + fileName_ + " result=" +
+                                                    toString( result ) + " offset=" +
+                                                    toString( offset + total ) );
+      }
+
+      total += result;
+   }
+}
+
+void CheckedFile::mapFile()
+{
+   if ( ( physicalLength_ == 0 ) || ( physicalLength_ > std::numeric_limits<size_t>::max() ) )
+   {
+      return;
+   }
+
+   const auto mapLength = static_cast<size_t>( physicalLength_ );
+
+#if defined( _WIN32 )
+   const auto fileHandle = reinterpret_cast<HANDLE>( ::_get_osfhandle( fd_ ) );
+
+   if ( fileHandle == INVALID_HANDLE_VALUE )
+   {
+      return;
+   }
+
+   HANDLE mapping = ::CreateFileMappingW( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+   if ( mapping == nullptr )
+   {
+      return;
+   }
+
+   void *view = ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, mapLength );
+
+   // The view holds its own reference to the mapping
+   ::CloseHandle( mapping );
+
+   if ( view == nullptr )
+   {
+      return;
+   }
+#else
+   void *view = ::mmap( nullptr, mapLength, PROT_READ, MAP_SHARED, fd_, 0 );
+
+   if ( view == MAP_FAILED )
+   {
+      return;
+   }
+#endif
+
+   mappedView_ = view;
+   mappedLength_ = mapLength;
+
+   bufView_ = new BufferView( static_cast<const char *>( mappedView_ ), physicalLength_ );
+}
+
+void CheckedFile::unmapFile()
+{
+   if ( mappedView_ == nullptr )
    {
-      throw E57_EXCEPTION2( ErrorWriteFailed,
-                            "fileName=" + fileName_ + " result=" + toString( result ) );
+      return;
    }
+
+#if defined( _WIN32 )
+   ::UnmapViewOfFile( mappedView_ );
+#else
+   ::munmap( mappedView_, mappedLength_ );
+#endif
+
+   mappedView_ = nullptr;
+   mappedLength_ = 0;
 }
@@ -28,8 +28,16 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 
 #include "Common.h"
+#include "IOBuffer.h"
+#include "MemoryUsage.h"
 
 namespace e57
 {
@@ -38,6 +46,28 @@ namespace e57
    //
    // WARNING: pointer input is handled by user!
    class BufferView;
+   class ThreadPool;
+   struct StatisticsCounters;
+   class Tracer;
+
+   // A large read of physical pages made ahead of time for CheckedFile::planRangeReads()
+   struct RangeRead
+   {
+      uint64_t firstPage = 0;
+      size_t pageCount = 0;
+      IOBuffer buffer;
+      MemoryReservation memory; // counts buffer
+      std::shared_future<void> done;
+   };
+
+   // The range reads of a section which is being read in order
+   struct RangePlan
+   {
+      uint64_t endPage = 0;  // one past the last page of the section
+      uint64_t nextPage = 0; // first page which hasn't been requested yet
+      uint64_t frontier = 0; // furthest page planned from so far
+      std::deque<std::shared_ptr<RangeRead>> reads; // requested, in order
+   };
 
    class CheckedFile
    {
@@ -48,11 +78,47 @@ namespace e57
       static constexpr uint64_t physicalPageSizeMask = physicalPageSize - 1;
       static constexpr size_t logicalPageSize = physicalPageSize - 4;
 
+      // maximum number of physical pages fetched from the file by a single read
+      static constexpr size_t maxPagesPerRead = 256;
+
+      // maximum number of physical pages read straight into the caller's buffer at a time
+      static constexpr size_t maxPagesPerDirectRead = 4096;
+
+      // maximum number of physical pages collected before they are written to the file
+      static constexpr size_t maxPagesPerWrite = 1024;
+
+      // amount of text collected by operator<< before it is written
+      static constexpr size_t textBufferSize = 64 * 1024;
+
+      // reads of at least this many pages have their checksums verified in parallel (if enabled)
+      static constexpr size_t minPagesForParallelVerify = 128;
+
+      // defaults for setRangeReads()
+      static constexpr size_t defaultRangeReadSize = 8 * 1024 * 1024;
+      static constexpr unsigned defaultRangeReadsInFlight = 4;
+
+      // maximum number of sections with range reads planned at once (see planRangeReads())
+      static constexpr size_t maxRangePlans = 4;
+
+      // with direct I/O (see setDirectIO()), the alignment of file offsets, sizes, and buffers
+      // which bypass the page cache, and the size of the buffer used when ours aren't aligned
+      static constexpr size_t directIOAlignment = 4096;
+      static constexpr size_t directIOBounceSize = 1024 * 1024;
+
    public:
       enum Mode
       {
          Read,
          Write,
+         Update, ///< an existing file which is read and written to
+      };
+
+      /// How a range of the file is going to be read (see advise())
+      enum Advice
+      {
+         Sequential,
+         WillNeed,
+         DontNeed
       };
 
       enum OffsetMode
@@ -63,11 +129,44 @@ namespace e57
 
       CheckedFile( const e57::ustring &fileName, Mode mode, ReadChecksumPolicy policy );
       CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy policy );
+      CheckedFile( std::shared_ptr<ImageFileIO> io, Mode mode, ReadChecksumPolicy policy );
       ~CheckedFile();
 
       void read( char *buf, size_t nRead, size_t bufSize = 0 );
+
+      /// Read nRead bytes starting at logicalOffset. This doesn't use or change the current
+      /// position. When the file is open for reading, any number of threads may call this at
+      /// once. When it is open for writing, calls are serialized.
+      void readAt( uint64_t logicalOffset, char *buf, size_t nRead );
+
+      /// Read a record (e.g. a packet) whose length is only known from its first headerSize
+      /// bytes. The rest of the first page is read, recordLength() is called on buf to get the
+      /// length, and then the remaining pages are read, so each page is read and verified once.
+      /// buf must hold the record and the rest of the first page. recordLength() should throw if
+      /// the length is too big for buf.
+      /// @returns the length of the record
+      size_t readRecordAt( uint64_t logicalOffset, char *buf, size_t headerSize,
+                           const std::function<size_t( const char *header )> &recordLength );
+
+      /// @returns true if the whole file open for reading is in memory (mapped, or given as a
+      /// buffer), so pageInMemory() can be used
+      bool isInMemory() const
+      {
+         return readOnly_ && ( bufView_ != nullptr );
+      }
+
+      /// Find a physical page of a file which isInMemory() and verify its checksum if the policy
+      /// asks for it and it hasn't been already. Any number of threads may call this at once.
+      /// @returns the page in place, which stays valid until the file is closed
+      /// @throw ::ErrorBadChecksum
+      const char *pageInMemory( uint64_t page );
+
       void write( const char *buf, size_t nWrite );
+
+      /// Text (e.g. the XML section) is collected in a buffer and written in large pieces. It is
+      /// written out before anything else uses the file, including position() and length().
       CheckedFile &operator<<( const e57::ustring &s );
+      CheckedFile &operator<<( const char *s );
       CheckedFile &operator<<( int64_t i );
       CheckedFile &operator<<( uint64_t i );
       CheckedFile &operator<<( float f );
@@ -77,6 +176,12 @@ namespace e57
       uint64_t length( OffsetMode omode = Logical );
       void extend( uint64_t newLength, OffsetMode omode = Logical );
 
+      /// Ask the file system to reserve space for a file of at least physicalLength bytes, so
+      /// that it can be laid out in one piece. Whatever isn't used is given back when the file
+      /// is closed. This is only a hint: it does nothing where it isn't supported.
+      /// @throw ::ErrorFileReadOnly
+      void preallocate( uint64_t physicalLength );
+
       e57::ustring fileName() const
       {
          return fileName_;
@@ -85,30 +190,211 @@ namespace e57
       void close();
       void unlink();
 
+      /// Drop whatever hasn't been written yet, cut the file back to physicalLength, and close
+      /// it. This undoes the writes made to a file opened with Update since it was physicalLength
+      /// long. Files written through an ImageFileIO are closed without being cut.
+      void truncateAndClose( uint64_t physicalLength );
+
+      /// Read every page of a file open for reading and verify its checksum, whatever the
+      /// checksum policy, sharing runs of pages between the calling thread and pool (if it isn't
+      /// null). Each thread reads its own part of the file in order.
+      /// @returns the number of pages verified
+      /// @throw ::ErrorBadChecksum
+      uint64_t verifyAllPages( ThreadPool *pool );
+
+      /// Set the number of threads (including the reading thread) used to verify the checksums
+      /// of large reads. 1 verifies on the reading thread only. 0 uses one per hardware thread
+      /// (or the executor's concurrency). The work is run on executor if it isn't null.
+      void setChecksumThreadCount( unsigned int threadCount,
+                                   std::shared_ptr<Executor> executor = nullptr );
+
+      /// Run task on a background thread owned by this file. Any tasks which are still queued or
+      /// running when the file is closed are finished first.
+      std::future<void> runInBackground( std::function<void()> task );
+
+      /// When enabled, full write buffers are checksummed and written out by the background
+      /// thread while the next one is filled. Any error is thrown by a later write or close().
+      void setBackgroundWrites( bool enable );
+
+      /// When the file is read through an ImageFileIO, read [logicalStart, logicalEnd) ahead of
+      /// time in large requests (see setRangeReads()), several of them at once. This is meant for
+      /// the data packets of a section, which are mostly read in order. Calling it again with the
+      /// same end moves the plan along. Reads of pages which have been requested this way wait
+      /// for the request and copy from it. It does nothing for other files.
+      void planRangeReads( uint64_t logicalStart, uint64_t logicalEnd );
+
+      /// Set the size of the requests made for planRangeReads() and how many of them are kept in
+      /// flight for each section. A count of 0 turns range reads off. With a memory budget (see
+      /// setMemoryUsage()), fewer or smaller requests are made so that those of all the sections
+      /// being read take at most a quarter of it.
+      void setRangeReads( size_t requestSize, unsigned requestsInFlight );
+
+      /// Read and write the pages of the file with direct I/O, bypassing the OS's page cache, so
+      /// that reading or writing a huge file doesn't push everything else out of it. With
+      /// O_DIRECT (Linux), the parts of a transfer which aren't aligned to directIOAlignment
+      /// still go through the page cache. On macOS this uses F_NOCACHE. A file opened for reading
+      /// is no longer memory mapped. It does nothing elsewhere, for files read through an
+      /// ImageFileIO or from memory, or if the file system doesn't support it.
+      void setDirectIO( bool enable );
+
+      /// Turn on the hints given to the OS by advise(). Off by default.
+      void setAccessHints( bool enable );
+
+      /// Tell the OS how [logicalStart, logicalEnd) is going to be read (posix_fadvise()), so it
+      /// can read it ahead of time or drop pages which we are done with from its cache. This is
+      /// only a hint. It does nothing unless turned on with setAccessHints(), for files which
+      /// aren't read through a file descriptor, or where it isn't supported.
+      void advise( uint64_t logicalStart, uint64_t logicalEnd, Advice advice );
+
+      /// Add what is read and verified to statistics (see ImageFile::statistics()), which must
+      /// outlive the file. Null turns it off.
+      void setStatistics( StatisticsCounters *statistics )
+      {
+         statistics_ = statistics;
+      }
+
+      StatisticsCounters *statistics() const
+      {
+         return statistics_;
+      }
+
+      /// Report the spans of bulk reads and writes to tracer (see Tracer), which must outlive the
+      /// file. Null turns it off.
+      void setTracer( Tracer *tracer )
+      {
+         tracer_ = tracer;
+      }
+
+      Tracer *tracer() const
+      {
+         return tracer_;
+      }
+
+      /// Take the page buffers, and those of the file's other parts which ask for it (e.g. the
+      /// packet cache), from allocator. Null takes them from the heap.
+      void setBufferAllocator( std::shared_ptr<BufferAllocator> allocator );
+
+      const std::shared_ptr<BufferAllocator> &bufferAllocator() const
+      {
+         return bufferAllocator_;
+      }
+
+      /// Count the file's range reads in usage, whose budget setRangeReads() fits them to (see
+      /// ImageFile::memoryUsage()). It must outlive the file. Null turns counting off.
+      void setMemoryUsage( MemoryUsage *usage )
+      {
+         memoryUsage_ = usage;
+      }
+
+      MemoryUsage *memoryUsage() const
+      {
+         return memoryUsage_;
+      }
+
       static inline uint64_t logicalToPhysical( uint64_t logicalOffset );
       static inline uint64_t physicalToLogical( uint64_t physicalOffset );
 
    private:
-      void verifyChecksum( char *page_buffer, uint64_t page );
+      void initVerifiedPages();
+      bool shouldVerifyPage( uint64_t page ) const;
+      void verifyPages( const char *pages, uint64_t firstPage, size_t pageCount );
+      void verifyChecksum( const char *page_buffer, uint64_t page );
 
       template <class FTYPE> CheckedFile &writeFloatingPoint( FTYPE value, int precision );
+      void appendText( const char *text, size_t length );
+      void flushText();
 
       void getCurrentPageAndOffset( uint64_t &page, size_t &pageOffset,
                                     OffsetMode omode = Logical );
-      void readPhysicalPage( char *page_buffer, uint64_t page );
-      void writePhysicalPage( char *page_buffer, uint64_t page );
+      void readPhysicalPages( char *page_buffer, uint64_t page, size_t pageCount );
+      const char *physicalPages( uint64_t page, uint64_t pagesWanted, size_t &pageCount,
+                                 IOBuffer &buffer );
+      void writePhysicalPages( char *page_buffer, uint64_t page, size_t pageCount );
+      void readFromIO( char *buffer, uint64_t offset, size_t size );
+      bool readFromRangePlans( char *page_buffer, uint64_t page, size_t pageCount );
+      void requestRangeReads( RangePlan &plan );
+      void writeToIO( const char *buffer, uint64_t offset, size_t size );
+      void transferAt( int fd, char *buffer, uint64_t offset, size_t size, bool write );
+      void transferDirect( char *buffer, uint64_t offset, size_t size, bool write );
+      char *writablePage( uint64_t page );
+      void flushWriteBuffer( bool keepLastPage = false );
+      void waitForPendingWrite();
       int open64( const e57::ustring &fileName, int flags, int mode );
       uint64_t lseek64( int64_t offset, int whence );
 
+      void mapFile();
+      void unmapFile();
+
       e57::ustring fileName_;
       uint64_t logicalLength_ = 0;
       uint64_t physicalLength_ = 0;
 
       ReadChecksumPolicy checkSumPolicy_ = ChecksumPolicy::ChecksumAll;
 
+      // When reading, one bit per physical page which is set once its checksum has been verified
+      // (64 pages per word). Several threads may be reading, so the words are atomic.
+      std::vector<std::atomic<uint64_t>> verifiedPages_;
+
       int fd_ = -1;
+      std::shared_ptr<ImageFileIO> io_; // used instead of fd_ if set
+      int directFd_ = -1;               // the file opened again with O_DIRECT (see setDirectIO())
       BufferView *bufView_ = nullptr;
       bool readOnly_ = false;
+      bool accessHints_ = false; // see setAccessHints()
+
+      StatisticsCounters *statistics_ = nullptr; // see setStatistics()
+      Tracer *tracer_ = nullptr;                 // see setTracer()
+      std::shared_ptr<BufferAllocator> bufferAllocator_; // see setBufferAllocator()
+      MemoryUsage *memoryUsage_ = nullptr;       // see setMemoryUsage()
+
+      // Physical length reserved by preallocate(), which may be more than we write
+      uint64_t preallocatedLength_ = 0;
+
+      // Current physical position. We track this ourselves so that readAt() can use positional
+      // reads without disturbing it.
+      uint64_t position_ = 0;
+
+      // Serializes readAt() when writing, since it shares the write buffer
+      std::mutex readMutex_;
+
+      // Reusable buffer for reading runs of pages when the file is not in memory. A read which
+      // finds it in use by another thread uses a buffer of its own.
+      IOBuffer readBuffer_;
+      std::mutex readBufferMutex_;
+
+      // Optional pool used to verify the checksums of large reads
+      std::unique_ptr<ThreadPool> verifyPool_;
+
+      // Thread used by runInBackground(), started the first time it is needed
+      std::unique_ptr<ThreadPool> backgroundPool_;
+
+      // Range reads requested by planRangeReads(), most recently planned section last. Reads
+      // which have been dropped from their plan are skipped if they haven't started yet.
+      std::mutex rangeMutex_;
+      std::vector<RangePlan> rangePlans_;
+      size_t rangeReadPages_ = defaultRangeReadSize / physicalPageSize;
+      unsigned rangeReadsInFlight_ = defaultRangeReadsInFlight;
+      std::unique_ptr<ThreadPool> rangePool_; // one thread per read in flight
+
+      // Pages waiting to be written: writeBufferPageCount_ contiguous pages starting at
+      // writeBufferFirstPage_. Checksums are calculated when they are written out.
+      IOBuffer writeBuffer_;
+      uint64_t writeBufferFirstPage_ = 0;
+      size_t writeBufferPageCount_ = 0;
+
+      // Text written with operator<< which hasn't been passed to write() yet, and the buffer it
+      // is swapped with while it is
+      std::string textBuffer_;
+      std::string textWriteBuffer_;
+
+      // With background writes, the buffer being written out while writeBuffer_ is filled
+      bool backgroundWrites_ = false;
+      IOBuffer pendingWriteBuffer_;
+      std::future<void> pendingWrite_;
+
+      // Read-only view of the whole file (if it could be mapped) which backs bufView_
+      void *mappedView_ = nullptr;
+      size_t mappedLength_ = 0;
    };
 
    inline uint64_t CheckedFile::logicalToPhysical( uint64_t logicalOffset )
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define E57_CRC32C_X86
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#include <nmmintrin.h>
+#elif ( defined( __aarch64__ ) || defined( _M_ARM64 ) ) && defined( __ARM_FEATURE_CRC32 )
+// We only use the ARM instructions if the compiler has been told they are available
+// (e.g. -march=armv8-a+crc, or any Apple Silicon target).
+#define E57_CRC32C_ARM
+#include <arm_acle.h>
+#endif
+
+// This is fixed in a newer version of CRCpp.
+//    https://github.com/d-bahr/CRCpp/issues/17
+// TODO: Remove when new CRCpp is released.
+#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
+// Disable warning about "conditional expression is constant".
+#pragma warning( push )
+#pragma warning( disable : 4127 )
+#endif
+#include "CRC.h"
+#if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
+#pragma warning( pop )
+#endif
+
+#include "Checksum.h"
+
+namespace
+{
+   using CRC32CFunction = uint32_t ( * )( const char *, size_t );
+
+#if defined( E57_CRC32C_X86 )
+   bool cpuHasSSE42()
+   {
+#if defined( _MSC_VER )
+      int info[4] = {};
+      __cpuid( info, 1 );
+
+      // CPUID.01H:ECX.SSE4_2[bit 20]
+      return ( info[2] & ( 1 << 20 ) ) != 0;
+#elif defined( __GNUC__ )
+      return __builtin_cpu_supports( "sse4.2" ) != 0;
+#else
+      return false;
+#endif
+   }
+
+// Allow use of the SSE 4.2 instructions in this function only so the rest of the
+// library still runs on CPUs without them.
+#if defined( __GNUC__ )
+   __attribute__( ( target( "sse4.2" ) ) )
+#endif
+   uint32_t crc32cSSE42( const char *buf, size_t size )
+   {
+      uint32_t crc = 0xFFFFFFFF;
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+      uint64_t crc64 = crc;
+
+      while ( size >= sizeof( uint64_t ) )
+      {
+         uint64_t value;
+         memcpy( &value, buf, sizeof( value ) );
+
+         crc64 = _mm_crc32_u64( crc64, value );
+
+         buf += sizeof( value );
+         size -= sizeof( value );
+      }
+
+      crc = static_cast<uint32_t>( crc64 );
+#endif
+
+      while ( size >= sizeof( uint32_t ) )
+      {
+         uint32_t value;
+         memcpy( &value, buf, sizeof( value ) );
+
+         crc = _mm_crc32_u32( crc, value );
+
+         buf += sizeof( value );
+         size -= sizeof( value );
+      }
+
+      while ( size > 0 )
+      {
+         crc = _mm_crc32_u8( crc, static_cast<uint8_t>( *buf ) );
+
+         ++buf;
+         --size;
+      }
+
+      return ~crc;
+   }
+#endif
+
+#if defined( E57_CRC32C_ARM )
+   uint32_t crc32cARMv8( const char *buf, size_t size )
+   {
+      uint32_t crc = 0xFFFFFFFF;
+
+      while ( size >= sizeof( uint64_t ) )
+      {
+         uint64_t value;
+         memcpy( &value, buf, sizeof( value ) );
+
+         crc = __crc32cd( crc, value );
+
+         buf += sizeof( value );
+         size -= sizeof( value );
+      }
+
+      while ( size > 0 )
+      {
+         crc = __crc32cb( crc, static_cast<uint8_t>( *buf ) );
+
+         ++buf;
+         --size;
+      }
+
+      return ~crc;
+   }
+#endif
+
+   struct CRC32CImplementation
+   {
+      CRC32CFunction function;
+      const char *name;
+   };
+
+   CRC32CImplementation selectImplementation()
+   {
+#if defined( E57_CRC32C_X86 )
+      if ( cpuHasSSE42() )
+      {
+         return { crc32cSSE42, "sse4.2" };
+      }
+#elif defined( E57_CRC32C_ARM )
+      return { crc32cARMv8, "armv8" };
+#endif
+
+      return { e57::crc32cSoftware, "software" };
+   }
+
+   const CRC32CImplementation &implementation()
+   {
+      static const CRC32CImplementation sImplementation = selectImplementation();
+
+      return sImplementation;
+   }
+}
+
+namespace e57
+{
+   uint32_t crc32c( const char *buf, size_t size )
+   {
+      return implementation().function( buf, size );
+   }
+
+   uint32_t crc32cSoftware( const char *buf, size_t size )
+   {
+      static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{ 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF,
+                                                                 true, true };
+
+      static const CRC::Table<crcpp_uint32, 32> sCRCTable = sCRCParams.MakeTable();
+
+      return CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   }
+
+   const char *crc32cImplementation()
+   {
+      return implementation().name;
+   }
+}
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace e57
+{
+   /// @brief Calculate the CRC32C (Castagnoli) of a buffer.
+   /// @details Uses the SSE 4.2 or ARMv8 CRC32 instructions if the CPU supports them, otherwise
+   /// falls back to a table-driven software implementation. The implementation is chosen once,
+   /// the first time this is called.
+   uint32_t crc32c( const char *buf, size_t size );
+
+   /// @brief Calculate the CRC32C of a buffer using the table-driven software implementation.
+   uint32_t crc32cSoftware( const char *buf, size_t size );
+
+   /// @brief Name of the CRC32C implementation selected for this CPU.
+   /// @returns "sse4.2", "armv8", or "software"
+   const char *crc32cImplementation();
+}
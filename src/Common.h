@@ -45,7 +45,8 @@
 // Used to mark unused parameters to indicate intent and suppress warnings.
 #define UNUSED( expr ) (void)( expr )
 
-// For readability of preprocessor using E57_VALIDATION_LEVEL
+// For readability of preprocessor using E57_VALIDATION_LEVEL, which only covers the internal
+// consistency checks. The data in files is checked according to ValidationLevel.
 #define VALIDATION_OFF 0
 #define VALIDATION_BASIC 1
 #define VALIDATION_DEEP 2
@@ -74,9 +75,20 @@ namespace e57
    using NodeImplSharedPtr = std::shared_ptr<class NodeImpl>;
    using NodeImplWeakPtr = std::weak_ptr<class NodeImpl>;
 
+   /// An element name shared by all the nodes of an ImageFile with that name (see
+   /// ImageFileImpl::internElementName())
+   using InternedName = std::shared_ptr<const std::string>;
+
    using StringList = std::vector<std::string>;
    using StringSet = std::set<std::string>;
 
+   /// Byte range of an element in the XML section of a file
+   struct E57XmlRange
+   {
+      uint64_t begin = 0;
+      uint64_t end = 0;
+   };
+
    /// generates a new random GUID
    std::string generateRandomGUID();
 }
@@ -412,13 +412,21 @@ the same terminal node in the prototype.
 It is an error to call this function if the CompressedVectorNode already has any records (i.e. a
 CompressedVectorNode cannot be set twice).
 
+Writers of different CompressedVectorNodes of the same ImageFile may be open at once, and each may
+be used on its own thread. A binary section must be contiguous in the file, so the first one
+writes its data packets straight into the file. The others hold theirs back in a temporary file
+(::ErrorOpenFailed is thrown if one can't be created), which is copied in once the end of the file
+is free. Nothing else may use the ImageFile or its nodes while the writers are being used on other
+threads. If a section held back fails to be written after its writer was closed,
+ImageFile::close throws ::ErrorWriteFailed naming it.
+
 @pre @a sbufs can't be empty (i.e. sbufs.length() > 0).
 @pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre The @a destImageFile must have been opened in write mode (i.e. destImageFile.isWritable()).
-@pre The destination ImageFile can't have any readers or writers open
-(destImageFile().readerCount()==0 && destImageFile().writerCount()==0)
+@pre The destination ImageFile can't have any readers open (destImageFile().readerCount()==0)
 @pre This CompressedVectorNode must be attached (i.e. isAttached()).
 @pre This CompressedVectorNode must have no records (i.e. childCount() == 0).
+@pre This CompressedVectorNode can't have another writer whose section is not written yet.
 
 @return A smart CompressedVectorWriter handle referencing the underlying iterator object.
 
@@ -427,6 +435,7 @@ CompressedVectorNode cannot be set twice).
 @throw ::ErrorFileReadOnly
 @throw ::ErrorSetTwice
 @throw ::ErrorTooManyWriters
+@throw ::ErrorOpenFailed
 @throw ::ErrorTooManyReaders
 @throw ::ErrorNodeUnattached
 @throw ::ErrorPathUndefined
@@ -443,6 +452,56 @@ CompressedVectorWriter CompressedVectorNode::writer( std::vector<SourceDestBuffe
    return CompressedVectorWriter( impl_->writer( sbufs ) );
 }
 
+/*!
+@brief Write the records of another CompressedVectorNode into this one without decoding them.
+
+@param [in] source The CompressedVectorNode to copy, usually from another ImageFile.
+
+@details
+The data packets of @a source are copied as they are, so extracting scans from a file or merging
+several files into one runs at the speed of the disk rather than that of the codecs. Only the
+index packets are written anew, pointing to the same records as those of @a source (if it has any).
+
+For this to work, the prototype of this CompressedVectorNode must have the same fields as that of @a
+source, in the same order and with the same types and limits (see CompressedVectorNode for the
+prototype), and their codecs must be identical. Build them as they were built for @a source, or
+from its prototype() and codecs(). The field names of extensions also need their prefixes declared
+in this ImageFile (see ImageFile::extensionsAdd).
+
+This behaves like writing all the records of @a source with a CompressedVectorWriter, which is
+closed before this returns.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre The destination ImageFile must have been opened in write mode (i.e.
+destImageFile.isWritable()).
+@pre The destination ImageFile can't have any readers open (destImageFile().readerCount()==0)
+@pre The ImageFile of @a source must be open.
+@pre This CompressedVectorNode must be attached (i.e. isAttached()).
+@pre This CompressedVectorNode must have no records (i.e. childCount() == 0).
+@pre @a source must have been written.
+@post childCount() == source.childCount()
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorSetTwice
+@throw ::ErrorTooManyReaders
+@throw ::ErrorNodeUnattached
+@throw ::ErrorBadPrototype
+@throw ::ErrorBadCodecs
+@throw ::ErrorBadCVHeader
+@throw ::ErrorBadCVPacket
+@throw ::ErrorReadFailed
+@throw ::ErrorWriteFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorNode::writer, CompressedVectorNode::prototype, CompressedVectorNode::codecs
+*/
+void CompressedVectorNode::copyPacketsFrom( const CompressedVectorNode &source )
+{
+   impl_->copyPacketsFrom( source.impl_ );
+}
+
 /*!
 @brief Create an iterator object for reading a series of blocks of data from a CompressedVectorNode.
 
@@ -453,6 +512,7 @@ The pathNames in the @a dbufs must identify terminal nodes (i.e. node that can h
 IntegerNode, ScaledIntegerNode, FloatNode, StringNode) in this CompressedVectorNode's prototype. It
 is an error for two SourceDestBuffers in @a dbufs to identify the same terminal node in the
 prototype. It is not an error to create a CompressedVectorReader for an empty CompressedVectorNode.
+Several CompressedVectorReaders of the same ImageFile may be open at once.
 
 @pre @a dbufs can't be empty
 @pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
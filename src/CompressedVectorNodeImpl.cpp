@@ -29,12 +29,101 @@
 #include "CheckedFile.h"
 #include "CompressedVectorReaderImpl.h"
 #include "CompressedVectorWriterImpl.h"
+#include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "ScaledIntegerNodeImpl.h"
 #include "StringFunctions.h"
+#include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
 #include "VectorNodeImpl.h"
 
 namespace e57
 {
+   namespace
+   {
+      // @returns true if the values of two leaves of the same type match
+      bool _sameValue( const NodeImplSharedPtr &a, const NodeImplSharedPtr &b )
+      {
+         switch ( a->type() )
+         {
+            case TypeInteger:
+               return std::static_pointer_cast<IntegerNodeImpl>( a )->value() ==
+                      std::static_pointer_cast<IntegerNodeImpl>( b )->value();
+
+            case TypeScaledInteger:
+               return std::static_pointer_cast<ScaledIntegerNodeImpl>( a )->rawValue() ==
+                      std::static_pointer_cast<ScaledIntegerNodeImpl>( b )->rawValue();
+
+            case TypeFloat:
+               return std::static_pointer_cast<FloatNodeImpl>( a )->value() ==
+                      std::static_pointer_cast<FloatNodeImpl>( b )->value();
+
+            case TypeString:
+               return std::static_pointer_cast<StringNodeImpl>( a )->value() ==
+                      std::static_pointer_cast<StringNodeImpl>( b )->value();
+
+            default:
+               return false;
+         }
+      }
+
+      // @returns true if a and b have the same children, with the same names in the same order,
+      // and equivalent leaves (see NodeImpl::isTypeEquivalent()). This is what makes the data
+      // packets of two CompressedVectors interchangeable. If compareValues is set, the values of
+      // the leaves have to match too.
+      bool _sameTree( const NodeImplSharedPtr &a, const NodeImplSharedPtr &b, bool compareValues )
+      {
+         if ( a->type() != b->type() )
+         {
+            return false;
+         }
+
+         if ( ( a->type() == TypeVector ) &&
+              ( std::static_pointer_cast<VectorNodeImpl>( a )->allowHeteroChildren() !=
+                std::static_pointer_cast<VectorNodeImpl>( b )->allowHeteroChildren() ) )
+         {
+            return false;
+         }
+
+         switch ( a->type() )
+         {
+            case TypeStructure:
+            case TypeVector:
+            {
+               auto sa = std::static_pointer_cast<StructureNodeImpl>( a );
+               auto sb = std::static_pointer_cast<StructureNodeImpl>( b );
+
+               if ( sa->childCount() != sb->childCount() )
+               {
+                  return false;
+               }
+
+               for ( int64_t i = 0; i < sa->childCount(); ++i )
+               {
+                  const NodeImplSharedPtr childA = sa->get( i );
+                  const NodeImplSharedPtr childB = sb->get( i );
+
+                  if ( ( childA->elementName() != childB->elementName() ) ||
+                       !_sameTree( childA, childB, compareValues ) )
+                  {
+                     return false;
+                  }
+               }
+
+               return true;
+            }
+
+            case TypeCompressedVector:
+            case TypeBlob:
+               return false;
+
+            default:
+               return a->isTypeEquivalent( b ) && ( !compareValues || _sameValue( a, b ) );
+         }
+      }
+   }
+
    CompressedVectorNodeImpl::CompressedVectorNodeImpl( ImageFileImplWeakPtr destImageFile ) :
       NodeImpl( destImageFile )
    {
@@ -129,6 +218,72 @@ namespace e57
       return ( codecs_ ); //??? check defined
    }
 
+   std::shared_ptr<StructureNodeImpl> CompressedVectorNodeImpl::findCodec(
+      const char *uri, const ustring &localName, const ustring &fieldPath ) const
+   {
+      ImageFileImplSharedPtr imf( destImageFile_ );
+
+      ustring prefix;
+
+      if ( !codecs_ || !imf->extensionsLookupUri( uri, prefix ) )
+      {
+         return nullptr;
+      }
+
+      const ustring codecName = prefix + ":" + localName;
+
+      // Inputs name fields relative to the prototype
+      const ustring fieldName =
+         ( !fieldPath.empty() && fieldPath[0] == '/' ) ? fieldPath.substr( 1 ) : fieldPath;
+
+      for ( int64_t i = 0; i < codecs_->childCount(); ++i )
+      {
+         const auto codec = std::dynamic_pointer_cast<StructureNodeImpl>( codecs_->get( i ) );
+
+         if ( !codec || !codec->isDefined( codecName ) )
+         {
+            continue;
+         }
+
+         const auto parameters =
+            std::dynamic_pointer_cast<StructureNodeImpl>( codec->get( codecName ) );
+
+         if ( !parameters )
+         {
+            throw E57_EXCEPTION2( ErrorBadCodecs, "codecName=" + codecName );
+         }
+
+         if ( fieldName.empty() || !codec->isDefined( "inputs" ) )
+         {
+            return parameters;
+         }
+
+         const auto inputs = std::dynamic_pointer_cast<VectorNodeImpl>( codec->get( "inputs" ) );
+
+         if ( !inputs )
+         {
+            throw E57_EXCEPTION2( ErrorBadCodecs, "codecName=" + codecName );
+         }
+
+         for ( int64_t j = 0; j < inputs->childCount(); ++j )
+         {
+            const auto input = std::dynamic_pointer_cast<StringNodeImpl>( inputs->get( j ) );
+
+            if ( !input )
+            {
+               throw E57_EXCEPTION2( ErrorBadCodecs, "codecName=" + codecName );
+            }
+
+            if ( input->value() == fieldName )
+            {
+               return parameters;
+            }
+         }
+      }
+
+      return nullptr;
+   }
+
    bool CompressedVectorNodeImpl::isTypeEquivalent( NodeImplSharedPtr ni )
    {
       // don't checkImageFileOpen
@@ -215,7 +370,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       uint64_t physicalStart = cf.logicalToPhysical( binarySectionLogicalStart_ );
@@ -272,14 +427,8 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      // Check don't have any writers/readers open for this ImageFile
-      if ( destImageFile->writerCount() > 0 )
-      {
-         throw E57_EXCEPTION2( ErrorTooManyWriters,
-                               "fileName=" + destImageFile->fileName() +
-                                  " writerCount=" + toString( destImageFile->writerCount() ) +
-                                  " readerCount=" + toString( destImageFile->readerCount() ) );
-      }
+      // Check don't have any readers open for this ImageFile. There may be several writers, one
+      // for each CompressedVector (see ImageFileImpl::claimFileEnd()).
       if ( destImageFile->readerCount() > 0 )
       {
          throw E57_EXCEPTION2( ErrorTooManyReaders,
@@ -294,7 +443,11 @@ namespace e57
          throw E57_EXCEPTION2( ErrorBadAPIArgument, "fileName=" + destImageFile->fileName() );
       }
 
-      if ( !destImageFile->isWriter() )
+      // A CompressedVector which was already in an updated file can't be written again
+      const bool existing = ( binarySectionLogicalStart_ != 0 ) &&
+                            destImageFile->isExistingData( binarySectionLogicalStart_ );
+
+      if ( !destImageFile->isWriter() || existing )
       {
          throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + destImageFile->fileName() );
       }
@@ -304,6 +457,15 @@ namespace e57
          throw E57_EXCEPTION2( ErrorNodeUnattached, "fileName=" + destImageFile->fileName() );
       }
 
+      // Only one writer per CompressedVector, until its section has been written
+      if ( writerOpen_ )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + destImageFile->fileName() +
+                                  " pathName=" + this->pathName() +
+                                  " writerCount=" + toString( destImageFile->writerCount() ) );
+      }
+
       // Get pointer to me (really shared_ptr<CompressedVectorNodeImpl>)
       NodeImplSharedPtr ni( shared_from_this() );
 
@@ -314,27 +476,83 @@ namespace e57
       // Return a shared_ptr to new object
       std::shared_ptr<CompressedVectorWriterImpl> cvwi(
          new CompressedVectorWriterImpl( cai, sbufs ) );
+      writerOpen_ = true;
       return ( cvwi );
    }
 
-   std::shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(
-      std::vector<SourceDestBuffer> dbufs )
+   void CompressedVectorNodeImpl::copyPacketsFrom(
+      const std::shared_ptr<CompressedVectorNodeImpl> &source )
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      source->checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      // Check don't have any writers/readers open for this ImageFile
-      if ( destImageFile->writerCount() > 0 )
+      if ( destImageFile->readerCount() > 0 )
       {
-         throw E57_EXCEPTION2( ErrorTooManyWriters,
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
                                "fileName=" + destImageFile->fileName() +
                                   " writerCount=" + toString( destImageFile->writerCount() ) +
                                   " readerCount=" + toString( destImageFile->readerCount() ) );
       }
-      if ( destImageFile->readerCount() > 0 )
+
+      if ( !destImageFile->isWriter() )
       {
-         throw E57_EXCEPTION2( ErrorTooManyReaders,
+         throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + destImageFile->fileName() );
+      }
+
+      if ( !isAttached() )
+      {
+         throw E57_EXCEPTION2( ErrorNodeUnattached, "fileName=" + destImageFile->fileName() );
+      }
+
+      if ( ( binarySectionLogicalStart_ != 0 ) || ( recordCount_ != 0 ) )
+      {
+         throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() );
+      }
+
+      // The source must have been written
+      if ( source->binarySectionLogicalStart_ == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "source->pathName=" + source->pathName() );
+      }
+
+      checkSameLayout( *source );
+
+      CompressedVectorWriterImpl writer(
+         std::static_pointer_cast<CompressedVectorNodeImpl>( shared_from_this() ) );
+
+      writer.copyPackets( *source );
+      writer.close();
+   }
+
+   void CompressedVectorNodeImpl::checkSameLayout( const CompressedVectorNodeImpl &other ) const
+   {
+      if ( !_sameTree( prototype_, other.prototype_, false ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadPrototype, "this->pathName=" + this->pathName() +
+                                                     " other.pathName=" + other.pathName() );
+      }
+
+      if ( !_sameTree( codecs_, other.codecs_, true ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadCodecs, "this->pathName=" + this->pathName() +
+                                                  " other.pathName=" + other.pathName() );
+      }
+   }
+
+   std::shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(
+      std::vector<SourceDestBuffer> dbufs )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      ImageFileImplSharedPtr destImageFile( destImageFile_ );
+
+      // Check don't have any writers open for this ImageFile. Readers don't use the file's
+      // position and share its packet cache, so there may be several of them.
+      if ( destImageFile->writerCount() > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
                                "fileName=" + destImageFile->fileName() +
                                   " writerCount=" + toString( destImageFile->writerCount() ) +
                                   " readerCount=" + toString( destImageFile->readerCount() ) );
@@ -50,6 +50,13 @@ namespace e57
       void setCodecs( const std::shared_ptr<VectorNodeImpl> &codecs );
       std::shared_ptr<VectorNodeImpl> getCodecs() const;
 
+      /// Find an extension codec (a child named localName in the namespace uri) among the codecs.
+      /// If fieldPath isn't empty, the codec must also list it in its inputs (or have none).
+      /// @returns the codec's parameters, or null if there isn't one
+      /// @throw ::ErrorBadCodecs
+      std::shared_ptr<StructureNodeImpl> findCodec( const char *uri, const ustring &localName,
+                                                    const ustring &fieldPath ) const;
+
       int64_t childCount() const;
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
@@ -61,6 +68,14 @@ namespace e57
       std::shared_ptr<CompressedVectorWriterImpl> writer( std::vector<SourceDestBuffer> sbufs );
       std::shared_ptr<CompressedVectorReaderImpl> reader( std::vector<SourceDestBuffer> dbufs );
 
+      /// Write the data packets of source's binary section into a new one for this node as they
+      /// are (see CompressedVectorNode::copyPacketsFrom())
+      void copyPacketsFrom( const std::shared_ptr<CompressedVectorNodeImpl> &source );
+
+      /// Throw unless other has the same prototype and codecs, so that its data packets are laid
+      /// out the same way as ours
+      void checkSameLayout( const CompressedVectorNodeImpl &other ) const;
+
       int64_t getRecordCount() const
       {
          return ( recordCount_ );
@@ -87,11 +102,15 @@ namespace e57
 
    private:
       friend class CompressedVectorReaderImpl;
+      friend class CompressedVectorWriterImpl;
 
       NodeImplSharedPtr prototype_;
       std::shared_ptr<VectorNodeImpl> codecs_;
 
       int64_t recordCount_ = 0;
       uint64_t binarySectionLogicalStart_ = 0;
+
+      // Set from writer() until the writer's section has been written (or has failed)
+      bool writerOpen_ = false;
    };
 }
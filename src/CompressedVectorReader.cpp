@@ -254,6 +254,171 @@ unsigned CompressedVectorReader::read( std::vector<SourceDestBuffer> &dbufs )
    return impl_->read( dbufs );
 }
 
+/*!
+@brief Start a transfer of a block of data into the given destination buffers on a background
+thread.
+
+@param [in] dbufs The buffers to receive the next block of records, with the same requirements as
+for CompressedVectorReader::read(std::vector<SourceDestBuffer>&).
+
+@details
+This does what CompressedVectorReader::read(std::vector<SourceDestBuffer>&) does, but returns
+straight away. The records are decoded on a thread owned by this CompressedVectorReader while the
+caller gets on with something else. Several reads may be started at once. They are done one after
+the other, in the order they were started, so each gets the block of records following the one
+before it.
+
+This allows double buffering: with two sets of buffers, start reading into the second set before
+processing the records in the first set, then start reading into the first set again once it has
+been processed.
+
+The buffers of a read must not be used until its future is ready. Any other call on this
+CompressedVectorReader (including read() and close()) first waits for all the reads which have
+been started to finish. Since the buffers are given here, the conversions done by the Simple API
+for the buffers it set up are not applied.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return A future which holds the number of records read, or the exception thrown by the read
+(see CompressedVectorReader::read(std::vector<SourceDestBuffer>&)).
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+
+@see CompressedVectorReader::read(std::vector<SourceDestBuffer>&)
+*/
+std::future<unsigned> CompressedVectorReader::readAsync( std::vector<SourceDestBuffer> &dbufs )
+{
+   return impl_->readAsync( dbufs );
+}
+
+/*!
+@brief Check a set of destination buffers once, so that reading into them later costs nothing.
+
+@param [in] dbufs The buffers, with the same requirements as for
+CompressedVectorReader::read(std::vector<SourceDestBuffer>&).
+
+@details
+Each time CompressedVectorReader::read(std::vector<SourceDestBuffer>&) is given buffers, they are
+checked against the prototype and against the buffers used before, and their handles are copied.
+When the same few sets of buffers are used over and over (e.g. reading into one set while the
+records in the other are processed), register each set once with this and switch between them
+with CompressedVectorReader::useBufferSet(), which only swaps pointers.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@return The number of the buffer set, counting from 0.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorPathUndefined
+@throw ::ErrorBufferSizeMismatch
+@throw ::ErrorBufferDuplicatePathName
+@throw ::ErrorBuffersNotCompatible
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::useBufferSet()
+*/
+unsigned CompressedVectorReader::addBufferSet( std::vector<SourceDestBuffer> &dbufs )
+{
+   return impl_->addBufferSet( dbufs );
+}
+
+/*!
+@brief Make CompressedVectorReader::read() fill a buffer set registered by
+CompressedVectorReader::addBufferSet().
+
+@param [in] bufferSet The number returned by CompressedVectorReader::addBufferSet().
+
+@details
+The buffers aren't checked again. As with
+CompressedVectorReader::read(std::vector<SourceDestBuffer>&), the conversions done by the Simple API
+for the buffers it set up are not applied to them.
+
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorBadAPIArgument If there is no such buffer set.
+
+@see CompressedVectorReader::addBufferSet(), CompressedVectorReader::read()
+*/
+void CompressedVectorReader::useBufferSet( unsigned bufferSet )
+{
+   impl_->useBufferSet( bufferSet );
+}
+
+/*!
+@brief Only return the records whose fields are within the given ranges from read().
+
+@param [in] filters The conditions a record must meet, all of which apply. An empty list returns
+every record again.
+
+@details
+Each filter names a field of the prototype, which must be one of the buffers given to the reader,
+and the smallest and largest values (inclusive) to keep. The values are compared as they are stored
+in the buffer, i.e. after any conversion and scaling. A NaN is never in range. For example, a
+range of 0 to 0 on "cartesianInvalidState" drops the points with invalid coordinates.
+
+Records are checked as they are decoded, and the rejected ones are overwritten in the buffers by the
+following records, so read() still fills the buffers (except at the end of the
+CompressedVectorNode) and returns the number of records kept. A return of 0 still means that there
+are no more records. Record numbers, e.g. for seek(), count all records whether they are kept or
+not.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument A filter names a field without a buffer, or its minimum is greater than
+its maximum.
+@throw ::ErrorExpectingNumeric A filter names a field whose buffer holds strings.
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setRecordFilters( const std::vector<RecordFilter> &filters )
+{
+   impl_->setRecordFilters( filters );
+}
+
+/*!
+@brief Only return every @a stride-th record from read().
+
+@param [in] stride The number of records from one record returned to the next. 1 returns every
+record again.
+
+@details
+The next record is returned (i.e. the one after the last record returned), then the one @a stride
+records after it, and so on. After a seek(), the stride starts over from the record sought to.
+This is for reading a thinned out copy of the points, e.g. for a quick look at a scan, without
+writing every record to the buffers and throwing most of them away.
+
+Fields using the bitPack codec for numbers have records of the same size, so the records stepped
+over are skipped by working out where the next one starts, without decoding them. Other codecs
+(and strings) decode their blocks or runs as before, but only pass on the records returned.
+
+read() still fills the buffers (except at the end of the CompressedVectorNode), and record numbers,
+e.g. for seek(), count all records whether they are returned or not. Record filters (see
+setRecordFilters()) are applied to the records returned.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument @a stride is 0.
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::read(), CompressedVectorReader::seek()
+*/
+void CompressedVectorReader::setRecordStride( unsigned stride )
+{
+   impl_->setRecordStride( stride );
+}
+
 /*!
 @brief Set record number of CompressedVectorNode where next read will start.
 
@@ -265,6 +430,10 @@ This function may be called at any time (as long as ImageFile and CompressedVect
 The next read will start at the given recordNumber. It is not an error to seek to recordNumber =
 childCount() (i.e. to one record past end of CompressedVectorNode).
 
+If the file has index packets (all files written by this library do), the read starts from the
+chunk of records containing recordNumber, otherwise it starts from the first record. Either way,
+the records before recordNumber are then decoded and thrown away.
+
 @pre @a recordNumber <= childCount() of CompressedVectorNode.
 @pre The associated ImageFile must be open.
 @pre This CompressedVectorReader must be open (i.e isOpen())
@@ -285,6 +454,135 @@ void CompressedVectorReader::seek( int64_t recordNumber )
    impl_->seek( recordNumber );
 }
 
+/*!
+@brief Start reading another CompressedVectorNode, keeping everything set up for this one.
+
+@param [in] cv The CompressedVectorNode to read next.
+
+@details
+Setting up a reader checks its buffers against the prototype and makes a decoder for each of them.
+For files with thousands of small scans that takes longer than reading their points. When the scans
+have the same prototype and codecs, read them all with one reader instead: once read() has returned
+0 (or at any other point), this moves the reader to the first record of @a cv.
+
+The buffers, including those registered with addBufferSet(), the decoders, the record filters and
+the conversions done by the Simple API are kept. An index built or read by buildRecordIndex() or
+readRecordIndex() is dropped, as it only fits the CompressedVectorNode it was made for.
+
+The prototype of @a cv must have the same fields as that of this reader's CompressedVectorNode, in
+the same order and with the same types and limits, and their codecs must be identical (as they are
+for the scans of a file written with the same options, see CompressedVectorNode::copyPacketsFrom()).
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+@pre @a cv must be attached to the same ImageFile.
+@post compressedVectorNode() is @a cv
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorDifferentDestImageFile
+@throw ::ErrorNodeUnattached
+@throw ::ErrorBadPrototype
+@throw ::ErrorBadCodecs
+@throw ::ErrorBadCVHeader
+@throw ::ErrorBadCVPacket
+@throw ::ErrorReadFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorNode::reader, CompressedVectorReader::seek
+*/
+void CompressedVectorReader::restart( const CompressedVectorNode &cv )
+{
+   impl_->restart( cv.impl_ );
+}
+
+/*!
+@brief Build an index of where each record is in the data packets, so seek() can go straight to it.
+
+@details
+This reads the header of each data packet in the CompressedVectorNode's binary section, but none of
+their data, so it is much quicker than reading the records. Most files from scanners have no index
+packets, so without this every seek() has to decode all the records before the one it is seeking to.
+
+Once built, seek() uses the index to start reading at the record directly. This works for all
+fields except strings; if the prototype has a string field, seek() falls back to decoding the
+records before recordNumber.
+
+The index can be saved with writeRecordIndex() and loaded in a later session with
+readRecordIndex(), so it only needs to be built once per file.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorBadCVPacket
+@throw ::ErrorSeekFailed
+@throw ::ErrorReadFailed
+@throw ::ErrorBadChecksum
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::seek, CompressedVectorReader::writeRecordIndex
+*/
+void CompressedVectorReader::buildRecordIndex()
+{
+   impl_->buildRecordIndex();
+}
+
+/*!
+@brief Save the index made by buildRecordIndex() to a file.
+
+@param [in] fileName Name of the index file to write. If it already exists, it is overwritten.
+
+@details
+The index file uses the same checksummed pages as an E57 file. It records the length of the E57
+file and where the CompressedVectorNode is in it, so an index can't be used with a different file.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+@pre buildRecordIndex() or readRecordIndex() must have been called.
+
+@throw ::ErrorBadAPIArgument There is no index to write.
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorOpenFailed
+@throw ::ErrorWriteFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::buildRecordIndex, CompressedVectorReader::readRecordIndex
+*/
+void CompressedVectorReader::writeRecordIndex( const ustring &fileName ) const
+{
+   impl_->writeRecordIndex( fileName );
+}
+
+/*!
+@brief Load an index saved by writeRecordIndex(), instead of building it again.
+
+@param [in] fileName Name of the index file to read.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorReader must be open (i.e isOpen())
+
+@throw ::ErrorBadAPIArgument The index was made for a different file or CompressedVectorNode.
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorReaderNotOpen
+@throw ::ErrorOpenFailed
+@throw ::ErrorBadFileSignature
+@throw ::ErrorUnknownFileVersion
+@throw ::ErrorBadFileLength
+@throw ::ErrorSeekFailed
+@throw ::ErrorReadFailed
+@throw ::ErrorBadChecksum
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorReader::buildRecordIndex, CompressedVectorReader::writeRecordIndex
+*/
+void CompressedVectorReader::readRecordIndex( const ustring &fileName )
+{
+   impl_->readRecordIndex( fileName );
+}
+
 /*!
 @brief End the read operation.
 
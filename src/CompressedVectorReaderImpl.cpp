@@ -25,14 +25,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <climits>
+
 #include "CompressedVectorReaderImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
 #include "ImageFileImpl.h"
 #include "Packet.h"
+#include "RecordIndex.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
+#include "Statistics.h"
 #include "StringFunctions.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 namespace e57
 {
@@ -40,7 +47,7 @@ namespace e57
       std::shared_ptr<CompressedVectorNodeImpl> cvi,
       std::vector<SourceDestBuffer> &dbufs ) :
       isOpen_( false ), // set to true when succeed below
-      cVector_( cvi )
+      cVector_( cvi ), imf_( cvi->destImageFile_ )
    {
 #ifdef E57_VERBOSE
       std::cout << "CompressedVectorReaderImpl() called" << std::endl; //???
@@ -91,68 +98,36 @@ namespace e57
       }
 
       recordCount_ = 0;
+      skippingPackets_ = false;
 
       // Get how many records are actually defined
       maxRecordCount_ = cvi->childCount();
 
-      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
-
-      //??? what if fault in this constructor?
-      cache_ = new PacketReadCache( imf->file_, 32 );
-
-      // Read CompressedVector section header
-      CompressedVectorSectionHeader sectionHeader;
-      uint64_t sectionLogicalStart = cVector_->getBinarySectionLogicalStart();
-      if ( sectionLogicalStart == 0 )
-      {
-         //??? should have caught this before got here, in XML read, get this if CV
-         // wasn't written to
-         // by writer.
-         throw E57_EXCEPTION2( ErrorInternal, "imageFileName=" + cVector_->imageFileName() +
-                                                 " cvPathName=" + cVector_->pathName() );
-      }
-      imf->file_->seek( sectionLogicalStart, CheckedFile::Logical );
-      imf->file_->read( reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
-
-#if VALIDATE_BASIC
-      sectionHeader.verify( imf->file_->length( CheckedFile::Physical ) );
-#endif
+      // All readers of the file share its cache
+      cache_ = imf_->packetCache();
 
-      // Pre-calc end of section, so can tell when we are out of packets.
-      sectionEndLogicalOffset_ = sectionLogicalStart + sectionHeader.sectionLogicalLength;
+      // ...and its decoding threads
+      decodePool_ = imf_->decodePool();
 
-      // Convert physical offset to first data packet to logical
-      uint64_t dataLogicalOffset =
-         imf->file_->physicalToLogical( sectionHeader.dataPhysicalOffset );
+      statistics_ = imf_->statisticsCounters();
 
-      // Verify that packet given by dataPhysicalOffset is actually a data packet,
-      // init channels
+      size_t decoderBufferSize = 0;
+      for ( const auto &channel : channels_ )
       {
-         char *anyPacket = nullptr;
-         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset, anyPacket );
+         decoderBufferSize += channel.decoder->bufferSize();
+      }
 
-         auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+      memory_.reset( imf_->memoryUsageCounters(), decoderBufferSize );
 
-         // Double check that have a data packet
-         if ( dpkt->header.packetType != DATA_PACKET )
-         {
-            throw E57_EXCEPTION2( ErrorBadCVPacket,
-                                  "packetType=" + toString( dpkt->header.packetType ) );
-         }
+      openSection();
 
-         // Have good packet, initialize channels
-         for ( auto &channel : channels_ )
-         {
-            channel.currentPacketLogicalOffset = dataLogicalOffset;
-            channel.currentBytestreamBufferIndex = 0;
-            channel.currentBytestreamBufferLength =
-               dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
-         }
-      }
+      // Let the cache know which section we read, for reading ahead
+      cache_->addSectionReader( sectionEndLogicalOffset_ );
+      cacheSectionEndLogicalOffset_ = sectionEndLogicalOffset_;
 
       // Just before return (and can't throw) increment reader count  ??? safer
       // way to assure don't miss close?
-      imf->incrReaderCount();
+      imf_->incrReaderCount();
 
       // If get here, the reader is open
       isOpen_ = true;
@@ -178,6 +153,48 @@ namespace e57
       }
    }
 
+   void CompressedVectorReaderImpl::openSection()
+   {
+      // Read CompressedVector section header
+      CompressedVectorSectionHeader sectionHeader;
+      uint64_t sectionLogicalStart = cVector_->getBinarySectionLogicalStart();
+      if ( sectionLogicalStart == 0 )
+      {
+         //??? should have caught this before got here, in XML read, get this if CV
+         // wasn't written to
+         // by writer.
+         throw E57_EXCEPTION2( ErrorInternal, "imageFileName=" + cVector_->imageFileName() +
+                                                 " cvPathName=" + cVector_->pathName() );
+      }
+      // Don't move the file's position, since other readers may be using the file
+      imf_->file_->readAt( sectionLogicalStart, reinterpret_cast<char *>( &sectionHeader ),
+                           sizeof( sectionHeader ) );
+
+#if VALIDATE_BASIC
+      sectionHeader.verify( imf_->file_->length( CheckedFile::Physical ) );
+#endif
+
+      // Pre-calc end of section, so can tell when we are out of packets.
+      sectionEndLogicalOffset_ = sectionLogicalStart + sectionHeader.sectionLogicalLength;
+
+      // Convert physical offset to first data packet to logical
+      dataLogicalOffset_ = imf_->file_->physicalToLogical( sectionHeader.dataPhysicalOffset );
+
+      // Remember where the index is (if the writer made one) for seek()
+      indexLogicalOffset_ = 0;
+      if ( sectionHeader.indexPhysicalOffset != 0 )
+      {
+         indexLogicalOffset_ = imf_->file_->physicalToLogical( sectionHeader.indexPhysicalOffset );
+      }
+
+      // The section is read front to back, unless the user seeks
+      imf_->file_->advise( dataLogicalOffset_, sectionEndLogicalOffset_, CheckedFile::Sequential );
+
+      // Verify that packet given by dataPhysicalOffset is actually a data packet,
+      // init channels
+      restartChannels( dataLogicalOffset_, 0 );
+   }
+
    void CompressedVectorReaderImpl::setBuffers( std::vector<SourceDestBuffer> &dbufs )
    {
       // don't checkImageFileOpen
@@ -190,28 +207,159 @@ namespace e57
       // incompatible way
       if ( !dbufs_.empty() )
       {
-         if ( dbufs_.size() != dbufs.size() )
+         checkBuffersCompatible( dbufs );
+      }
+
+      dbufs_ = dbufs;
+
+      // The decoders write to the buffers they were given, so point them at the new ones
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         if ( channels_[i].dbuf.impl() != dbufs_[i].impl() )
          {
-            throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                                  "oldSize=" + toString( dbufs_.size() ) +
-                                     " newSize=" + toString( dbufs.size() ) );
+            std::vector<SourceDestBuffer> channelDbufs{ dbufs_[i] };
+
+            channels_[i].dbuf = dbufs_[i];
+            channels_[i].decoder->destBufferSetNew( channelDbufs );
          }
-         for ( size_t i = 0; i < dbufs_.size(); i++ )
-         {
-            std::shared_ptr<SourceDestBufferImpl> oldBuf = dbufs_[i].impl();
-            std::shared_ptr<SourceDestBufferImpl> newBuf = dbufs[i].impl();
+      }
+   }
+
+   void CompressedVectorReaderImpl::checkBuffersCompatible(
+      const std::vector<SourceDestBuffer> &dbufs ) const
+   {
+      if ( dbufs_.size() != dbufs.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                               "oldSize=" + toString( dbufs_.size() ) +
+                                  " newSize=" + toString( dbufs.size() ) );
+      }
+
+      for ( size_t i = 0; i < dbufs_.size(); i++ )
+      {
+         // Throw exception if old and new not compatible
+         dbufs_[i].impl()->checkCompatible( dbufs[i].impl() );
+      }
+   }
+
+   unsigned CompressedVectorReaderImpl::addBufferSet( std::vector<SourceDestBuffer> &dbufs )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // The checks setBuffers() does each time
+      proto_->checkBuffers( dbufs, true );
+      checkBuffersCompatible( dbufs );
+
+      BufferSet bufferSet;
+      bufferSet.buffers = dbufs;
+      bufferSet.channelBuffers.reserve( dbufs.size() );
+
+      for ( const auto &dbuf : dbufs )
+      {
+         bufferSet.channelBuffers.push_back( { dbuf } );
+      }
+
+      bufferSets_.push_back( std::move( bufferSet ) );
+
+      return static_cast<unsigned>( bufferSets_.size() - 1 );
+   }
+
+   void CompressedVectorReaderImpl::useBufferSet( unsigned bufferSet )
+   {
+      waitForAsyncReads();
+
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( bufferSet >= bufferSets_.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "bufferSet=" + toString( bufferSet ) +
+                                  " bufferSetCount=" + toString( bufferSets_.size() ) );
+      }
 
-            // Throw exception if old and new not compatible
-            oldBuf->checkCompatible( newBuf );
+      BufferSet &set = bufferSets_[bufferSet];
+
+      // Same size, so this only assigns the pointers
+      dbufs_ = set.buffers;
+
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         if ( channels_[i].dbuf.impl() != set.buffers[i].impl() )
+         {
+            channels_[i].dbuf = set.buffers[i];
+            channels_[i].decoder->destBufferSetNew( set.channelBuffers[i] );
          }
       }
 
-      dbufs_ = dbufs;
+      // The handler was set up for the old buffers
+      recordsReadHandler_ = nullptr;
    }
 
    unsigned CompressedVectorReaderImpl::read( std::vector<SourceDestBuffer> &dbufs )
    {
-      // don't checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__), read() will
+      waitForAsyncReads();
+
+      return readNext( dbufs );
+   }
+
+   unsigned CompressedVectorReaderImpl::read()
+   {
+      waitForAsyncReads();
+
+      return readNext();
+   }
+
+   std::future<unsigned> CompressedVectorReaderImpl::readAsync(
+      std::vector<SourceDestBuffer> &dbufs )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Forget the reads which are done, their results are in the caller's futures
+      while ( !asyncReads_.empty() && ( asyncReads_.front().wait_for( std::chrono::seconds( 0 ) ) ==
+                                        std::future_status::ready ) )
+      {
+         asyncReads_.pop_front();
+      }
+
+      if ( asyncPool_ == nullptr )
+      {
+         asyncPool_.reset( new ThreadPool( 1 ) );
+      }
+
+      auto result = std::make_shared<std::promise<unsigned>>();
+      std::future<unsigned> future = result->get_future();
+
+      asyncReads_.push_back( asyncPool_->submit( [this, dbufs, result]() mutable {
+         try
+         {
+            result->set_value( readNext( dbufs ) );
+         }
+         catch ( ... )
+         {
+            result->set_exception( std::current_exception() );
+         }
+      } ) );
+
+      return future;
+   }
+
+   /// Wait for the reads started by readAsync() to finish. Their results (and errors) have
+   /// already been passed to their futures.
+   void CompressedVectorReaderImpl::waitForAsyncReads()
+   {
+      for ( auto &asyncRead : asyncReads_ )
+      {
+         asyncRead.wait();
+      }
+
+      asyncReads_.clear();
+   }
+
+   unsigned CompressedVectorReaderImpl::readNext( std::vector<SourceDestBuffer> &dbufs )
+   {
+      // don't checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__), readNext() will
       // do it
 
       checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -219,10 +367,13 @@ namespace e57
       // Check compatible with current dbufs
       setBuffers( dbufs );
 
-      return ( read() );
+      // The handler was set up for the old buffers
+      recordsReadHandler_ = nullptr;
+
+      return ( readNext() );
    }
 
-   unsigned CompressedVectorReaderImpl::read()
+   unsigned CompressedVectorReaderImpl::readNext()
    {
 #ifdef E57_VERBOSE
       std::cout << "CompressedVectorReaderImpl::read() called" << std::endl; //???
@@ -230,44 +381,141 @@ namespace e57
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
+      const unsigned recordCount = readRecords();
+
+      if ( recordsReadHandler_ && ( recordCount > 0 ) )
+      {
+         E57_STATISTICS_TIME( statistics_, conversionNanoseconds );
+
+         recordsReadHandler_( recordCount );
+      }
+
+      return recordCount;
+   }
+
+   unsigned CompressedVectorReaderImpl::readRecords()
+   {
       // Rewind all dbufs so start writing to them at beginning
       for ( auto &dbuf : dbufs_ )
       {
          dbuf.impl()->rewind();
       }
 
-      // Allow decoders to use data they already have in their queue to fill newly
-      // empty dbufs This helps to keep decoder input queues smaller, which
-      // reduces backtracking in the packet cache.
-      for ( auto &channel : channels_ )
+      decodeRecords();
+      adviseReadAhead();
+
+      unsigned outputCount = decodedRecordCount();
+
+      if ( filters_.empty() )
       {
-         channel.decoder->inputProcess( nullptr, 0 );
+         // Return number of records transferred to each dbuf.
+         return outputCount;
       }
 
-      // Loop until every dbuf is full or we have reached end of the binary
-      // section.
+      // The decoders stop when any buffer is full
+      size_t capacity = channels_.front().dbuf.impl()->capacity();
+      for ( const auto &channel : channels_ )
+      {
+         capacity = std::min( capacity, channel.dbuf.impl()->capacity() );
+      }
+
+      // Drop the records which don't pass the filters, then decode more into the space they
+      // leave until the buffers are full again or there are no more records.
+      unsigned keptCount = 0;
+
       while ( true )
       {
-         // Find the earliest packet position for channels that are still hungry
-         // It's important to call inputProcess of the decoders before this call,
-         // so current hungriness level is reflected.
-         uint64_t earliestPacketLogicalOffset = earliestPacketNeededForInput();
+         keptCount = filterRecords( keptCount, outputCount );
 
-         // If nobody's hungry, we are done with the read
-         if ( earliestPacketLogicalOffset == UINT64_MAX )
+         if ( ( keptCount == outputCount ) || ( outputCount < capacity ) )
          {
             break;
          }
 
-         // Feed packet to the hungry decoders
-         feedPacketToDecoders( earliestPacketLogicalOffset );
+         decodeRecords();
+
+         outputCount = decodedRecordCount();
+      }
+
+      return keptCount;
+   }
+
+   void CompressedVectorReaderImpl::setRecordsReadHandler( const RecordsReadHandler &handler )
+   {
+      recordsReadHandler_ = handler;
+   }
+
+   void CompressedVectorReaderImpl::setRecordFilters( const std::vector<RecordFilter> &filters )
+   {
+      waitForAsyncReads();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      std::vector<BufferFilter> bufferFilters;
+      bufferFilters.reserve( filters.size() );
+
+      for ( const RecordFilter &filter : filters )
+      {
+         auto found = std::find_if( dbufs_.begin(), dbufs_.end(),
+                                    [&filter]( const SourceDestBuffer &dbuf ) {
+                                       return dbuf.pathName() == filter.pathName;
+                                    } );
+
+         if ( ( found == dbufs_.end() ) || !( filter.minimum <= filter.maximum ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "pathName=" + filter.pathName +
+                                     " minimum=" + toString( filter.minimum ) +
+                                     " maximum=" + toString( filter.maximum ) +
+                                     " cvPathName=" + cVector_->pathName() );
+         }
+
+         if ( found->memoryRepresentation() == UString )
+         {
+            throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + filter.pathName );
+         }
+
+         bufferFilters.push_back( { static_cast<size_t>( found - dbufs_.begin() ), filter.minimum,
+                                    filter.maximum } );
+      }
+
+      filters_ = std::move( bufferFilters );
+   }
+
+   void CompressedVectorReaderImpl::setRecordStride( uint64_t stride )
+   {
+      waitForAsyncReads();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( stride == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "stride=0 cvPathName=" + cVector_->pathName() );
+      }
+
+      recordStride_ = stride;
+
+      // All channels are at the same record after a read() or seek()
+      setDecoderStrides( recordStride_, channels_.front().decoder->totalRecordsCompleted() );
+   }
+
+   void CompressedVectorReaderImpl::setDecoderStrides( uint64_t stride, uint64_t firstRecord )
+   {
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->setRecordStride( stride, firstRecord );
       }
+   }
 
+   unsigned CompressedVectorReaderImpl::decodedRecordCount() const
+   {
       // Verify that each channel produced the same number of records
       unsigned outputCount = 0;
       for ( unsigned i = 0; i < channels_.size(); i++ )
       {
-         DecodeChannel *chan = &channels_[i];
+         const DecodeChannel *chan = &channels_[i];
          if ( i == 0 )
          {
             outputCount = chan->dbuf.impl()->nextIndex();
@@ -283,162 +531,343 @@ namespace e57
          }
       }
 
-      // Return number of records transferred to each dbuf.
       return outputCount;
    }
 
-   uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
+   /// Move the records from firstRecord to recordCount which pass the filters down to
+   /// firstRecord in each channel's dbuf, and forget the rest.
+   /// @returns the number of records in the dbufs now
+   unsigned CompressedVectorReaderImpl::filterRecords( unsigned firstRecord, unsigned recordCount )
    {
-      uint64_t earliestPacketLogicalOffset = UINT64_MAX;
-#ifdef E57_VERBOSE
-      unsigned earliestChannel = 0;
-#endif
+      unsigned keptCount = firstRecord;
 
-      for ( unsigned i = 0; i < channels_.size(); i++ )
+      for ( unsigned record = firstRecord; record < recordCount; ++record )
       {
-         const DecodeChannel *chan = &channels_[i];
+         bool keep = true;
 
-         // Test if channel needs more input.
-         // Important to call inputProcess just before this, so these tests work.
-         if ( !chan->isOutputBlocked() && !chan->inputFinished )
+         for ( const BufferFilter &filter : filters_ )
          {
-            // Check if earliest so far
-            if ( chan->currentPacketLogicalOffset < earliestPacketLogicalOffset )
+            const double value = channels_[filter.bufferIndex].dbuf.impl()->doubleAt( record );
+
+            // Written so NaNs fail
+            if ( !( ( value >= filter.minimum ) && ( value <= filter.maximum ) ) )
             {
-               earliestPacketLogicalOffset = chan->currentPacketLogicalOffset;
-#ifdef E57_VERBOSE
-               earliestChannel = i;
-#endif
+               keep = false;
+               break;
             }
          }
+
+         if ( !keep )
+         {
+            continue;
+         }
+
+         if ( keptCount != record )
+         {
+            for ( auto &channel : channels_ )
+            {
+               channel.dbuf.impl()->moveElement( record, keptCount );
+            }
+         }
+
+         ++keptCount;
       }
-#ifdef E57_VERBOSE
-      if ( earliestPacketLogicalOffset == UINT64_MAX )
-      {
-         std::cout << "earliestPacketNeededForInput returning none found" << std::endl;
-      }
-      else
+
+      for ( auto &channel : channels_ )
       {
-         std::cout << "earliestPacketNeededForInput returning " << earliestPacketLogicalOffset
-                   << " for channel[" << earliestChannel << "]" << std::endl;
+         channel.dbuf.impl()->truncate( keptCount );
       }
-#endif
-      return earliestPacketLogicalOffset;
+
+      return keptCount;
    }
 
-   DataPacket *CompressedVectorReaderImpl::dataPacket( uint64_t inLogicalOffset ) const
+   void CompressedVectorReaderImpl::decodeRecords()
    {
-      char *packet = nullptr;
+      // Allow decoders to use data they already have in their queue to fill newly
+      // empty dbufs This helps to keep decoder input queues smaller, which
+      // reduces backtracking in the packet cache.
+#ifdef E57_STATISTICS
+      std::vector<size_t> firstIndexes;
 
-      std::unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet );
+      for ( const auto &channel : channels_ )
+      {
+         firstIndexes.push_back( channel.dbuf.impl()->nextIndex() );
+      }
+#endif
 
-      return reinterpret_cast<DataPacket *>( packet );
-   }
+      for ( auto &channel : channels_ )
+      {
+         E57_STATISTICS_TIME( statistics_, decodeNanoseconds );
 
-   inline bool _alreadyReadPacket( const DecodeChannel &channel,
-                                   uint64_t currentPacketLogicalOffset )
-   {
-      return ( ( channel.currentPacketLogicalOffset != currentPacketLogicalOffset ) ||
-               channel.isOutputBlocked() );
-   }
+         channel.decoder->inputProcess( nullptr, 0 );
+      }
 
-   void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLogicalOffset )
-   {
-      // Get packet at currentPacketLogicalOffset into memory.
-      auto dpkt = dataPacket( currentPacketLogicalOffset );
+      // Loop until every dbuf is full or we have reached end of the binary
+      // section. The packet being fed to the channels stays locked until then.
+      try
+      {
+         while ( true )
+         {
+            // Hungry channels skip over packets with nothing in their bytestreams by reading just
+            // the packet headers, so packets which only have data for other bytestreams (e.g.
+            // fields the caller didn't ask for) aren't read into the cache.
+            for ( auto &channel : channels_ )
+            {
+               if ( ( channel.currentBytestreamBufferLength == 0 ) && !channel.inputFinished &&
+                    !channel.isOutputBlocked() )
+               {
+                  skipEmptyBytestreamBuffers( channel );
+               }
+            }
 
-      // Double check that have a data packet.  Should have already determined this.
-      if ( dpkt->header.packetType != DATA_PACKET )
+            // Find the earliest packet position for channels that are still hungry
+            // It's important to call inputProcess of the decoders before this call,
+            // so current hungriness level is reflected.
+            uint64_t earliestPacketLogicalOffset = earliestPacketNeededForInput();
+
+            // If nobody's hungry, we are done with the read
+            if ( earliestPacketLogicalOffset == UINT64_MAX )
+            {
+               break;
+            }
+
+            // Feed packet to the hungry decoders
+            feedPacketToDecoders( earliestPacketLogicalOffset );
+         }
+      }
+      catch ( ... )
       {
-         throw E57_EXCEPTION2( ErrorInternal, "packetType=" + toString( dpkt->header.packetType ) );
+         unlockPacket();
+         throw;
       }
 
-      // Read earliest packet into cache and send data to decoders with unblocked output
+      unlockPacket();
 
-      bool anyChannelHasExhaustedPacket = false;
-      uint64_t nextPacketLogicalOffset = UINT64_MAX;
+#ifdef E57_STATISTICS
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         statistics_->addValuesDecoded( *channels_[i].decoder,
+                                        channels_[i].dbuf.impl()->nextIndex() - firstIndexes[i] );
+      }
+#endif
+   }
 
-      // Feed bytestreams to channels with unblocked output that are reading from this packet
-      for ( DecodeChannel &channel : channels_ )
+   uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
+   {
+      uint64_t earliestPacketLogicalOffset = UINT64_MAX;
+#ifdef E57_VERBOSE
+      unsigned earliestChannel = 0;
+#endif
+
+      for ( unsigned i = 0; i < channels_.size(); i++ )
       {
-         // Skip channels that have already read this packet.
-         if ( _alreadyReadPacket( channel, currentPacketLogicalOffset ) )
+         const DecodeChannel *chan = &channels_[i];
+
+         // Test if channel needs more input.
+         // Important to call inputProcess just before this, so these tests work.
+         if ( !chan->isOutputBlocked() && !chan->inputFinished )
          {
-            continue;
+            // Check if earliest so far
+            if ( chan->currentPacketLogicalOffset < earliestPacketLogicalOffset )
+            {
+               earliestPacketLogicalOffset = chan->currentPacketLogicalOffset;
+#ifdef E57_VERBOSE
+               earliestChannel = i;
+#endif
+            }
          }
+      }
+#ifdef E57_VERBOSE
+      if ( earliestPacketLogicalOffset == UINT64_MAX )
+      {
+         std::cout << "earliestPacketNeededForInput returning none found" << std::endl;
+      }
+      else
+      {
+         std::cout << "earliestPacketNeededForInput returning " << earliestPacketLogicalOffset
+                   << " for channel[" << earliestChannel << "]" << std::endl;
+      }
+#endif
+      return earliestPacketLogicalOffset;
+   }
+
+   /// Lock the packet at packetLogicalOffset in the cache (unless it is the one already locked)
+   /// and find its bytestream buffers if it is a data packet. It stays locked until another
+   /// packet is locked or unlockPacket() is called.
+   const DataPacket *CompressedVectorReaderImpl::lockPacket( uint64_t packetLogicalOffset )
+   {
+      if ( lockedPacket_.logicalOffset == packetLogicalOffset )
+      {
+         return lockedPacket_.packet;
+      }
+
+      // Only hold one packet at a time, so several readers don't run the cache out of entries
+      unlockPacket();
+
+      char *anyPacket = nullptr;
+
+      std::unique_ptr<PacketLock> packetLock =
+         cache_->lock( packetLogicalOffset, anyPacket, readAheadEndLogicalOffset() );
+
+      auto dpkt = reinterpret_cast<const DataPacket *>( anyPacket );
 
-         // Get bytestream buffer for this channel from packet
-         unsigned int bsbLength = 0;
-         const char *bsbStart = dpkt->getBytestream( channel.bytestreamNumber, bsbLength );
+      lockedPacket_.bytestreams.clear();
+      lockedPacket_.bytestreamLengths.clear();
 
-         // Double check we are not off end of buffer
-         if ( channel.currentBytestreamBufferIndex > bsbLength )
+      if ( dpkt->header.packetType == DATA_PACKET )
+      {
+         const unsigned count = dpkt->header.bytestreamCount;
+
+         // Inflated packets may be longer than they were in the file
+         const unsigned packetLength = ( dpkt->header.packetFlags & DATA_PACKET_DEFLATED )
+                                          ? static_cast<unsigned>( DATA_PACKET_MAX )
+                                          : dpkt->header.packetLogicalLengthMinus1 + 1U;
+
+         // The buffers follow their lengths, one after the other
+         auto bsbLength = reinterpret_cast<const uint16_t *>( &dpkt->payload[0] );
+         unsigned position = sizeof( DataPacketHeader ) + 2 * count;
+
+         for ( unsigned i = 0; i < count; ++i )
          {
-            throw E57_EXCEPTION2(
-               ErrorInternal,
-               "currentBytestreamBufferIndex =" + toString( channel.currentBytestreamBufferIndex ) +
-                  " bsbLength=" + toString( bsbLength ) );
+            if ( position + bsbLength[i] > packetLength )
+            {
+               throw E57_EXCEPTION2( ErrorInternal, "bytestreamCount=" + toString( count ) +
+                                                       " bytestreamNumber=" + toString( i ) +
+                                                       " position=" + toString( position ) +
+                                                       " packetLength=" +
+                                                       toString( packetLength ) );
+            }
+
+            lockedPacket_.bytestreams.push_back( anyPacket + position );
+            lockedPacket_.bytestreamLengths.push_back( bsbLength[i] );
+
+            position += bsbLength[i];
          }
+      }
 
-         // Calc where we are in the buffer
-         const char *uneatenStart = &bsbStart[channel.currentBytestreamBufferIndex];
-         const size_t uneatenLength = bsbLength - channel.currentBytestreamBufferIndex;
+      lockedPacket_.logicalOffset = packetLogicalOffset;
+      lockedPacket_.lock = std::move( packetLock );
+      lockedPacket_.packet = dpkt;
+
+      return dpkt;
+   }
+
+   void CompressedVectorReaderImpl::unlockPacket()
+   {
+      lockedPacket_.lock.reset();
+      lockedPacket_.packet = nullptr;
+      lockedPacket_.logicalOffset = 0;
+   }
 
-         if ( &uneatenStart[uneatenLength] > &bsbStart[bsbLength] )
+   inline bool _alreadyReadPacket( const DecodeChannel &channel,
+                                   uint64_t currentPacketLogicalOffset )
+   {
+      return ( ( channel.currentPacketLogicalOffset != currentPacketLogicalOffset ) ||
+               channel.isOutputBlocked() );
+   }
+
+   void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLogicalOffset )
+   {
+      E57_TRACE_SPAN( imf_->tracer(), "decodePacket" );
+
+      bool anyChannelHasExhaustedPacket = false;
+      uint64_t nextPacketLogicalOffset = UINT64_MAX;
+
+      {
+         // Get packet at currentPacketLogicalOffset into memory, and keep it there while the
+         // decoders use it. It was usually locked when the last packet ran out.
+         const DataPacket *dpkt = lockPacket( currentPacketLogicalOffset );
+
+         // Double check that have a data packet.  Should have already determined this.
+         if ( dpkt->header.packetType != DATA_PACKET )
          {
-            throw E57_EXCEPTION2( ErrorInternal, "uneatenLength=" + toString( uneatenLength ) +
-                                                    " bsbLength=" + toString( bsbLength ) );
+            throw E57_EXCEPTION2( ErrorInternal,
+                                  "packetType=" + toString( dpkt->header.packetType ) );
          }
 
-         // Feed into decoder
-         const size_t bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
+         E57_STATISTICS_ADD( statistics_, dataPacketsDecoded, 1 );
+         E57_TRACE_BYTES( dpkt->header.packetLogicalLengthMinus1 + 1U );
 
-#ifdef E57_VERBOSE
-         std::cout << "  stream[" << channel.bytestreamNumber << "]: feeding decoder "
-                   << uneatenLength << " bytes" << std::endl;
+         // Find the channels with unblocked output that are reading from this packet
+         std::vector<DecodeChannel *> hungryChannels;
 
-         if ( uneatenLength == 0 )
+         for ( DecodeChannel &channel : channels_ )
          {
-            channel.dump( 8 );
+            // Skip channels that have already read this packet.
+            if ( !_alreadyReadPacket( channel, currentPacketLogicalOffset ) )
+            {
+               hungryChannels.push_back( &channel );
+            }
          }
 
-         std::cout << "  stream[" << channel.bytestreamNumber
-                   << "]: bytesProcessed=" << bytesProcessed << std::endl;
-#endif
-
-         // Adjust counts of bytestream location
-         channel.currentBytestreamBufferIndex += bytesProcessed;
+         // Each channel has its own decoder and dbuf, so they can be fed at the same time
+         if ( ( decodePool_ != nullptr ) && ( hungryChannels.size() > 1 ) )
+         {
+            decodePool_->parallelFor( hungryChannels.size(), [&]( size_t i ) {
+               feedBytestreamToDecoder( *hungryChannels[i] );
+            } );
+         }
+         else
+         {
+            for ( DecodeChannel *channel : hungryChannels )
+            {
+               feedBytestreamToDecoder( *channel );
+            }
+         }
 
-         // Check if this channel has exhausted its bytestream buffer in this
-         // packet
-         if ( channel.isInputBlocked() )
+         // Check if any channel has exhausted its bytestream buffer in this packet
+         for ( const DecodeChannel *channel : hungryChannels )
          {
+            if ( channel->isInputBlocked() )
+            {
 #ifdef E57_VERBOSE
-            std::cout << "  stream[" << channel.bytestreamNumber
-                      << "] has exhausted its input in current packet" << std::endl;
+               std::cout << "  stream[" << channel->bytestreamNumber
+                         << "] has exhausted its input in current packet" << std::endl;
 #endif
-            anyChannelHasExhaustedPacket = true;
-            nextPacketLogicalOffset =
-               currentPacketLogicalOffset + dpkt->header.packetLogicalLengthMinus1 + 1;
+               anyChannelHasExhaustedPacket = true;
+               nextPacketLogicalOffset =
+                  currentPacketLogicalOffset + dpkt->header.packetLogicalLengthMinus1 + 1;
+            }
          }
       }
 
-      // Skip over any index or empty packets to next data packet.
-      nextPacketLogicalOffset = findNextDataPacket( nextPacketLogicalOffset );
-
       // If no channel is exhausted, we're done
       if ( !anyChannelHasExhaustedPacket )
       {
          return;
       }
 
+      // Once packets are being skipped, the next one may not have anything for the exhausted
+      // channels either, so leave skipEmptyBytestreamBuffers() to find the one they need rather
+      // than reading it here.
+      if ( skippingPackets_ )
+      {
+         for ( DecodeChannel &channel : channels_ )
+         {
+            if ( _alreadyReadPacket( channel, currentPacketLogicalOffset ) )
+            {
+               continue;
+            }
+
+            channel.currentPacketLogicalOffset = nextPacketLogicalOffset;
+            channel.currentBytestreamBufferIndex = 0;
+            channel.currentBytestreamBufferLength = 0;
+            channel.inputFinished = ( nextPacketLogicalOffset >= sectionEndLogicalOffset_ );
+         }
+
+         return;
+      }
+
+      // Skip over any index or empty packets to next data packet.
+      nextPacketLogicalOffset = findNextDataPacket( nextPacketLogicalOffset );
+
       // Some channel has exhausted this packet, so find next data packet and
       // update currentPacketLogicalOffset for all interested channels.
 
       if ( nextPacketLogicalOffset < UINT64_MAX )
-      { //??? huh?
-         // Get packet at nextPacketLogicalOffset into memory.
-         dpkt = dataPacket( nextPacketLogicalOffset );
+      {
+         // findNextDataPacket() left the packet locked, and the channels are fed from it next
+         const DataPacket *dpkt = lockPacket( nextPacketLogicalOffset );
 
          // Got a data packet, update the channels with exhausted input
          for ( DecodeChannel &channel : channels_ )
@@ -454,8 +883,16 @@ namespace e57
 
             // It is OK if the next packet doesn't contain any data for this
             // channel, will skip packet on next iter of loop
+            if ( channel.bytestreamNumber >= dpkt->header.bytestreamCount )
+            {
+               throw E57_EXCEPTION2( ErrorInternal,
+                                     "bytestreamNumber=" + toString( channel.bytestreamNumber ) +
+                                        " bytestreamCount=" +
+                                        toString( dpkt->header.bytestreamCount ) );
+            }
+
             channel.currentBytestreamBufferLength =
-               dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+               lockedPacket_.bytestreamLengths[channel.bytestreamNumber];
 
 #ifdef E57_VERBOSE
             std::cout << "  set new stream buffer for channel[" << channel.bytestreamNumber
@@ -491,6 +928,163 @@ namespace e57
       }
    }
 
+   uint64_t CompressedVectorReaderImpl::readAheadEndLogicalOffset() const
+   {
+      // Once we are skipping packets, the ones following a packet aren't necessarily needed, so
+      // don't have the cache read ahead (it does when given the end of the section).
+      return skippingPackets_ ? 0 : sectionEndLogicalOffset_;
+   }
+
+   void CompressedVectorReaderImpl::adviseReadAhead()
+   {
+      // Everything before the packet needed by the channel furthest behind has been used
+      uint64_t cursor = sectionEndLogicalOffset_;
+
+      for ( const auto &channel : channels_ )
+      {
+         if ( !channel.inputFinished )
+         {
+            cursor = std::min( cursor, channel.currentPacketLogicalOffset );
+         }
+      }
+
+      if ( cursor > releasedLogicalOffset_ )
+      {
+         imf_->file_->advise( releasedLogicalOffset_, cursor, CheckedFile::DontNeed );
+         releasedLogicalOffset_ = cursor;
+      }
+
+      // Ask for the next window once we are half way through the last one
+      if ( ( advisedLogicalOffset_ < sectionEndLogicalOffset_ ) &&
+           ( advisedLogicalOffset_ < cursor + READ_AHEAD_HINT_SIZE / 2 ) )
+      {
+         const uint64_t start = std::max( advisedLogicalOffset_, cursor );
+         const uint64_t end =
+            std::min( cursor + READ_AHEAD_HINT_SIZE, sectionEndLogicalOffset_ );
+
+         imf_->file_->advise( start, end, CheckedFile::WillNeed );
+         advisedLogicalOffset_ = end;
+      }
+   }
+
+   void CompressedVectorReaderImpl::skipEmptyBytestreamBuffers( DecodeChannel &channel )
+   {
+      DataPacketHeader header;
+
+      uint64_t packetLogicalOffset = channel.currentPacketLogicalOffset;
+
+      while ( packetLogicalOffset + sizeof( header ) <= sectionEndLogicalOffset_ )
+      {
+         imf_->file_->readAt( packetLogicalOffset, reinterpret_cast<char *>( &header ),
+                              sizeof( header ) );
+
+         // All packets have length in same place, so can use the field to skip to next packet
+         const uint64_t packetLength = header.packetLogicalLengthMinus1 + 1U;
+
+         if ( header.packetType == DATA_PACKET )
+         {
+            const uint64_t lengthOffset =
+               sizeof( header ) + channel.bytestreamNumber * sizeof( uint16_t );
+
+            if ( ( channel.bytestreamNumber >= header.bytestreamCount ) ||
+                 ( packetLength < lengthOffset + sizeof( uint16_t ) ) )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                     "bytestreamCount=" + toString( header.bytestreamCount ) +
+                                        " bytestreamNumber=" +
+                                        toString( channel.bytestreamNumber ) +
+                                        " packetLength=" + toString( packetLength ) );
+            }
+
+            uint16_t bufferLength = 0;
+
+            imf_->file_->readAt( packetLogicalOffset + lengthOffset,
+                                 reinterpret_cast<char *>( &bufferLength ),
+                                 sizeof( bufferLength ) );
+
+            if ( bufferLength == 0 )
+            {
+               skippingPackets_ = true;
+            }
+            else
+            {
+#ifdef E57_VERBOSE
+               std::cout << "  stream[" << channel.bytestreamNumber
+                         << "]: skipped to packet at " << packetLogicalOffset << std::endl;
+#endif
+               channel.currentPacketLogicalOffset = packetLogicalOffset;
+               channel.currentBytestreamBufferIndex = 0;
+               channel.currentBytestreamBufferLength = bufferLength;
+               return;
+            }
+         }
+
+         packetLogicalOffset += packetLength;
+      }
+
+      // Nothing more for this bytestream in the section
+      channel.inputFinished = true;
+   }
+
+   void CompressedVectorReaderImpl::feedBytestreamToDecoder( DecodeChannel &channel )
+   {
+      // Get bytestream buffer for this channel from the locked packet
+      if ( channel.bytestreamNumber >= lockedPacket_.bytestreams.size() )
+      {
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "bytestreamNumber=" + toString( channel.bytestreamNumber ) +
+                                  " bytestreamCount=" +
+                                  toString( lockedPacket_.bytestreams.size() ) );
+      }
+
+      const unsigned bsbLength = lockedPacket_.bytestreamLengths[channel.bytestreamNumber];
+      const char *bsbStart = lockedPacket_.bytestreams[channel.bytestreamNumber];
+
+      // Double check we are not off end of buffer
+      if ( channel.currentBytestreamBufferIndex > bsbLength )
+      {
+         throw E57_EXCEPTION2(
+            ErrorInternal,
+            "currentBytestreamBufferIndex =" + toString( channel.currentBytestreamBufferIndex ) +
+               " bsbLength=" + toString( bsbLength ) );
+      }
+
+      // Calc where we are in the buffer
+      const char *uneatenStart = &bsbStart[channel.currentBytestreamBufferIndex];
+      const size_t uneatenLength = bsbLength - channel.currentBytestreamBufferIndex;
+
+      if ( &uneatenStart[uneatenLength] > &bsbStart[bsbLength] )
+      {
+         throw E57_EXCEPTION2( ErrorInternal, "uneatenLength=" + toString( uneatenLength ) +
+                                                 " bsbLength=" + toString( bsbLength ) );
+      }
+
+      // Feed into decoder
+      size_t bytesProcessed = 0;
+
+      {
+         E57_STATISTICS_TIME( statistics_, decodeNanoseconds );
+
+         bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
+      }
+
+#ifdef E57_VERBOSE
+      std::cout << "  stream[" << channel.bytestreamNumber << "]: feeding decoder "
+                << uneatenLength << " bytes" << std::endl;
+
+      if ( uneatenLength == 0 )
+      {
+         channel.dump( 8 );
+      }
+
+      std::cout << "  stream[" << channel.bytestreamNumber
+                << "]: bytesProcessed=" << bytesProcessed << std::endl;
+#endif
+
+      // Adjust counts of bytestream location
+      channel.currentBytestreamBufferIndex += bytesProcessed;
+   }
+
    uint64_t CompressedVectorReaderImpl::findNextDataPacket( uint64_t nextPacketLogicalOffset )
    {
 #ifdef E57_VERBOSE
@@ -503,13 +1097,9 @@ namespace e57
       // hit end of binary section.
       while ( nextPacketLogicalOffset < sectionEndLogicalOffset_ )
       {
-         char *anyPacket = nullptr;
-
-         std::unique_ptr<PacketLock> packetLock =
-            cache_->lock( nextPacketLogicalOffset, anyPacket );
-
-         // Guess it's a data packet, if not continue to next packet
-         auto dpkt = reinterpret_cast<const DataPacket *>( anyPacket );
+         // Guess it's a data packet, if not continue to next packet. A data packet stays locked
+         // for feeding to the channels.
+         const DataPacket *dpkt = lockPacket( nextPacketLogicalOffset );
 
          if ( dpkt->header.packetType == DATA_PACKET )
          {
@@ -529,12 +1119,509 @@ namespace e57
       return UINT64_MAX;
    }
 
-   void CompressedVectorReaderImpl::seek( uint64_t /*recordNumber*/ )
+   void CompressedVectorReaderImpl::restart( std::shared_ptr<CompressedVectorNodeImpl> cvi )
+   {
+      waitForAsyncReads();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      ImageFileImplSharedPtr cviImf( cvi->destImageFile_ );
+
+      if ( cviImf != imf_ )
+      {
+         throw E57_EXCEPTION2( ErrorDifferentDestImageFile,
+                               "imageFileName=" + cVector_->imageFileName() +
+                                  " cvi->imageFileName=" + cvi->imageFileName() );
+      }
+
+      if ( !cvi->isAttached() )
+      {
+         throw E57_EXCEPTION2( ErrorNodeUnattached, "imageFileName=" + imf_->fileName() +
+                                                       " cvi->pathName=" + cvi->pathName() );
+      }
+
+      // The buffers were checked against our prototype and the decoders made for our codecs
+      cVector_->checkSameLayout( *cvi );
+
+      unlockPacket();
+
+      cVector_ = cvi;
+      proto_ = cVector_->getPrototype();
+
+      maxRecordCount_ = cVector_->childCount();
+
+      for ( auto &channel : channels_ )
+      {
+         channel.maxRecordCount = maxRecordCount_;
+         channel.decoder->setMaxRecordCount( maxRecordCount_ );
+         channel.decoder->setRecordStride( recordStride_, 0 );
+      }
+
+      // An index only fits the CompressedVector it was made for
+      recordIndex_ = nullptr;
+
+      recordCount_ = 0;
+      skippingPackets_ = false;
+
+      openSection();
+
+      if ( sectionEndLogicalOffset_ != cacheSectionEndLogicalOffset_ )
+      {
+         cache_->removeSectionReader( cacheSectionEndLogicalOffset_ );
+         cache_->addSectionReader( sectionEndLogicalOffset_ );
+         cacheSectionEndLogicalOffset_ = sectionEndLogicalOffset_;
+      }
+   }
+
+   void CompressedVectorReaderImpl::seek( uint64_t recordNumber )
    {
+      waitForAsyncReads();
+
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // It's OK to seek to one past the last record
+      if ( recordNumber > maxRecordCount_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "recordNumber=" + toString( recordNumber ) +
+                                  " maxRecordCount=" + toString( maxRecordCount_ ) +
+                                  " imageFileName=" + cVector_->imageFileName() +
+                                  " cvPathName=" + cVector_->pathName() );
+      }
+
+      // Step over the records before recordNumber one by one, then start the stride from it
+      setDecoderStrides( 1, 0 );
+      seekRecord( recordNumber );
+      setDecoderStrides( recordStride_, recordNumber );
+   }
+
+   void CompressedVectorReaderImpl::seekRecord( uint64_t recordNumber )
+   {
+      // A record index can start each bytestream at the record directly
+      if ( recordIndex_ && seekUsingRecordIndex( recordNumber ) )
+      {
+         return;
+      }
+
+      // Find the chunk the record is in. Without an index, the only chunk we know the start of
+      // is the whole section.
+      uint64_t chunkRecordNumber = 0;
+      uint64_t chunkLogicalOffset = dataLogicalOffset_;
+
+      if ( indexLogicalOffset_ != 0 )
+      {
+         findChunk( recordNumber, chunkRecordNumber, chunkLogicalOffset );
+      }
+
+      // All channels are at the same record after a read(), so if that is in the same chunk and
+      // not past the record, keep decoding from there rather than from the start of the chunk.
+      const uint64_t currentRecordNumber = channels_.front().decoder->totalRecordsCompleted();
+
+      if ( currentRecordNumber <= recordNumber && chunkRecordNumber <= currentRecordNumber )
+      {
+         skipRecords( recordNumber - currentRecordNumber );
+         return;
+      }
+
+      restartChannels( chunkLogicalOffset, chunkRecordNumber );
+
+      skipRecords( recordNumber - chunkRecordNumber );
+   }
+
+   void CompressedVectorReaderImpl::restartChannels( uint64_t dataLogicalOffset,
+                                                     uint64_t recordNumber )
+   {
+      char *anyPacket = nullptr;
+      std::unique_ptr<PacketLock> packetLock =
+         cache_->lock( dataLogicalOffset, anyPacket, sectionEndLogicalOffset_ );
+
+      auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
+
+      // Double check that have a data packet
+      if ( dpkt->header.packetType != DATA_PACKET )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket,
+                               "packetType=" + toString( dpkt->header.packetType ) );
+      }
+
+      // Have good packet, initialize channels
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->stateReset( recordNumber, 0 );
+
+         channel.currentPacketLogicalOffset = dataLogicalOffset;
+         channel.currentBytestreamBufferIndex = 0;
+         channel.currentBytestreamBufferLength =
+            dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+         channel.inputFinished = false;
+      }
+
+      // Start the hints over from here
+      advisedLogicalOffset_ = dataLogicalOffset;
+      releasedLogicalOffset_ = dataLogicalOffset;
+   }
 
-      // !!! implement
-      throw E57_EXCEPTION1( ErrorNotImplemented );
+   void CompressedVectorReaderImpl::findChunk( uint64_t recordNumber, uint64_t &chunkRecordNumber,
+                                               uint64_t &chunkLogicalOffset )
+   {
+      uint64_t packetLogicalOffset = indexLogicalOffset_;
+
+      // Walk down from the top level index packet to the last chunk starting at or before
+      // recordNumber. The top level is limited by IndexPacket::verify(), which the cache has
+      // done, and each level must be lower than the one above so this ends.
+      unsigned parentIndexLevel = UINT_MAX;
+
+      while ( true )
+      {
+         char *anyPacket = nullptr;
+         std::unique_ptr<PacketLock> packetLock =
+            cache_->lock( packetLogicalOffset, anyPacket, sectionEndLogicalOffset_ );
+
+         auto ipkt = reinterpret_cast<const IndexPacket *>( anyPacket );
+
+         if ( ipkt->packetType != INDEX_PACKET )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "packetType=" + toString( ipkt->packetType ) );
+         }
+
+         if ( ipkt->indexLevel >= parentIndexLevel )
+         {
+            const unsigned indexLevel = ipkt->indexLevel;
+
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "indexLevel=" + toString( indexLevel ) +
+                                     " parentIndexLevel=" + toString( parentIndexLevel ) );
+         }
+
+         parentIndexLevel = ipkt->indexLevel;
+
+         const IndexPacket::IndexPacketEntry *begin = ipkt->entries;
+         const IndexPacket::IndexPacketEntry *end = ipkt->entries + ipkt->entryCount;
+
+         auto next = std::upper_bound(
+            begin, end, recordNumber,
+            []( uint64_t record, const IndexPacket::IndexPacketEntry &entry ) {
+               return record < entry.chunkRecordNumber;
+            } );
+
+         // If the index doesn't cover the record, fall back to the start of the section
+         if ( next == begin )
+         {
+            return;
+         }
+
+         const IndexPacket::IndexPacketEntry &entry = *( next - 1 );
+         const uint64_t entryLogicalOffset =
+            imf_->file_->physicalToLogical( entry.chunkPhysicalOffset );
+
+         if ( ipkt->indexLevel == 0 )
+         {
+            chunkRecordNumber = entry.chunkRecordNumber;
+            chunkLogicalOffset = entryLogicalOffset;
+            return;
+         }
+
+         // Index packets must point into the section
+         if ( entryLogicalOffset >= sectionEndLogicalOffset_ )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "chunkPhysicalOffset=" + toString( entry.chunkPhysicalOffset ) );
+         }
+
+         packetLogicalOffset = entryLogicalOffset;
+      }
+   }
+
+   void CompressedVectorReaderImpl::skipRecords( uint64_t recordCount )
+   {
+      if ( recordCount == 0 )
+      {
+         return;
+      }
+
+      // Decode the records into scratch buffers, a batch at a time, then put the user's buffers
+      // back.
+      constexpr size_t SKIP_BATCH_SIZE = 4096;
+
+      ImageFile imf = Node( cVector_ ).destImageFile();
+
+      std::vector<double> numbers( SKIP_BATCH_SIZE * channels_.size() );
+      std::vector<std::vector<ustring>> strings( channels_.size() );
+
+      std::vector<SourceDestBuffer> savedDbufs;
+      savedDbufs.reserve( channels_.size() );
+
+      for ( const DecodeChannel &channel : channels_ )
+      {
+         savedDbufs.push_back( channel.dbuf );
+      }
+
+      auto setChannelBuffer = [this]( size_t i, const SourceDestBuffer &dbuf ) {
+         std::vector<SourceDestBuffer> dbufs{ dbuf };
+
+         channels_[i].dbuf = dbuf;
+         channels_[i].decoder->destBufferSetNew( dbufs );
+      };
+
+      try
+      {
+         while ( recordCount > 0 )
+         {
+            const size_t batchSize =
+               static_cast<size_t>( std::min<uint64_t>( recordCount, SKIP_BATCH_SIZE ) );
+
+            for ( size_t i = 0; i < channels_.size(); ++i )
+            {
+               const ustring pathName = savedDbufs[i].pathName();
+
+               if ( savedDbufs[i].memoryRepresentation() == UString )
+               {
+                  strings[i].resize( batchSize );
+                  setChannelBuffer( i, SourceDestBuffer( imf, pathName, &strings[i] ) );
+               }
+               else
+               {
+                  setChannelBuffer( i, SourceDestBuffer( imf, pathName,
+                                                         &numbers[i * SKIP_BATCH_SIZE],
+                                                         batchSize, true ) );
+               }
+            }
+
+            decodeRecords();
+
+            // Running out of data before reaching the record means the section is bad
+            for ( const DecodeChannel &channel : channels_ )
+            {
+               if ( channel.dbuf.impl()->nextIndex() != batchSize )
+               {
+                  throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                        "recordsDecoded=" +
+                                           toString( channel.dbuf.impl()->nextIndex() ) +
+                                           " expected=" + toString( batchSize ) );
+               }
+            }
+
+            recordCount -= batchSize;
+         }
+      }
+      catch ( ... )
+      {
+         for ( size_t i = 0; i < channels_.size(); ++i )
+         {
+            setChannelBuffer( i, savedDbufs[i] );
+         }
+
+         throw;
+      }
+
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         setChannelBuffer( i, savedDbufs[i] );
+      }
+   }
+
+   bool CompressedVectorReaderImpl::seekUsingRecordIndex( uint64_t recordNumber )
+   {
+      struct ChannelPosition
+      {
+         uint64_t packetLogicalOffset;
+         size_t bufferIndex;
+         size_t bufferLength;
+         unsigned firstBit;
+      };
+
+      std::vector<ChannelPosition> positions( channels_.size() );
+
+      // Find every channel's position before changing any of them, so we can still fall back
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         const DecodeChannel &channel = channels_[i];
+         ChannelPosition &position = positions[i];
+
+         uint64_t byteOffset = 0;
+         uint64_t endByteOffset = 0;
+         unsigned endFirstBit = 0;
+
+         if ( !channel.decoder->recordPosition( recordNumber, byteOffset, position.firstBit ) ||
+              !channel.decoder->recordPosition( maxRecordCount_, endByteOffset, endFirstBit ) )
+         {
+            return false;
+         }
+
+         // The records must fill the bytestream, or they aren't where we calculated. Allow for
+         // the last partly filled word.
+         const uint64_t length = recordIndex_->bytestreamLength( channel.bytestreamNumber );
+
+         if ( ( length < endByteOffset ) || ( length - endByteOffset > sizeof( uint64_t ) ) )
+         {
+            return false;
+         }
+
+         if ( !recordIndex_->find( channel.bytestreamNumber, byteOffset,
+                                   position.packetLogicalOffset, position.bufferIndex,
+                                   position.bufferLength ) )
+         {
+            return false;
+         }
+      }
+
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         DecodeChannel &channel = channels_[i];
+         const ChannelPosition &position = positions[i];
+
+         channel.decoder->stateReset( recordNumber, position.firstBit );
+
+         channel.currentPacketLogicalOffset = position.packetLogicalOffset;
+         channel.currentBytestreamBufferIndex = position.bufferIndex;
+         channel.currentBytestreamBufferLength = position.bufferLength;
+         channel.inputFinished = false;
+      }
+
+      return true;
+   }
+
+   unsigned CompressedVectorReaderImpl::bytestreamCount() const
+   {
+      char *anyPacket = nullptr;
+      std::unique_ptr<PacketLock> packetLock =
+         cache_->lock( dataLogicalOffset_, anyPacket, sectionEndLogicalOffset_ );
+
+      return reinterpret_cast<const DataPacket *>( anyPacket )->header.bytestreamCount;
+   }
+
+   void CompressedVectorReaderImpl::buildRecordIndex()
+   {
+      waitForAsyncReads();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      const unsigned count = bytestreamCount();
+
+      std::unique_ptr<RecordIndex> index(
+         new RecordIndex( imf_->file_->length( CheckedFile::Physical ),
+                          cVector_->getBinarySectionLogicalStart(), maxRecordCount_, count ) );
+
+      // Only the packet headers and bytestream lengths are needed, so read those directly
+      // rather than pulling every packet through the cache.
+      DataPacketHeader header;
+      std::vector<uint16_t> bufferLengths16( count );
+      std::vector<unsigned> bufferLengths( count );
+
+      const uint64_t lengthsSize = count * sizeof( uint16_t );
+
+      uint64_t packetLogicalOffset = dataLogicalOffset_;
+
+      while ( packetLogicalOffset < sectionEndLogicalOffset_ )
+      {
+         if ( packetLogicalOffset + sizeof( header ) > sectionEndLogicalOffset_ )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "packetLogicalOffset=" + toString( packetLogicalOffset ) +
+                                     " sectionEndLogicalOffset=" +
+                                     toString( sectionEndLogicalOffset_ ) );
+         }
+
+         imf_->file_->readAt( packetLogicalOffset, reinterpret_cast<char *>( &header ),
+                              sizeof( header ) );
+
+         // All packets have length in same place, so can use the field to skip to next packet
+         const uint64_t packetLength = header.packetLogicalLengthMinus1 + 1U;
+
+         if ( header.packetType == DATA_PACKET )
+         {
+            if ( header.bytestreamCount != count ||
+                 packetLength < sizeof( header ) + lengthsSize )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                     "bytestreamCount=" + toString( header.bytestreamCount ) +
+                                        " expected=" + toString( count ) +
+                                        " packetLength=" + toString( packetLength ) );
+            }
+
+            uint64_t totalLength = sizeof( header ) + lengthsSize;
+
+            if ( count > 0 )
+            {
+               imf_->file_->readAt( packetLogicalOffset + sizeof( header ),
+                                    reinterpret_cast<char *>( bufferLengths16.data() ),
+                                    static_cast<size_t>( lengthsSize ) );
+            }
+
+            for ( unsigned i = 0; i < count; ++i )
+            {
+               bufferLengths[i] = bufferLengths16[i];
+               totalLength += bufferLengths16[i];
+            }
+
+            if ( totalLength > packetLength )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                     "totalLength=" + toString( totalLength ) +
+                                        " packetLength=" + toString( packetLength ) );
+            }
+
+            index->addPacket( packetLogicalOffset, bufferLengths );
+         }
+
+         packetLogicalOffset += packetLength;
+      }
+
+      recordIndex_ = std::move( index );
+   }
+
+   void CompressedVectorReaderImpl::writeRecordIndex( const ustring &fileName ) const
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( !recordIndex_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "fileName=" + fileName + " imageFileName=" +
+                                  cVector_->imageFileName() +
+                                  " cvPathName=" + cVector_->pathName() );
+      }
+
+      recordIndex_->write( fileName );
+   }
+
+   void CompressedVectorReaderImpl::readRecordIndex( const ustring &fileName )
+   {
+      waitForAsyncReads();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      std::unique_ptr<RecordIndex> index = RecordIndex::read( fileName );
+
+      // The index must have been built for this CompressedVector in this version of the file
+      if ( !index->matches( imf_->file_->length( CheckedFile::Physical ),
+                            cVector_->getBinarySectionLogicalStart(), maxRecordCount_,
+                            bytestreamCount() ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "fileName=" + fileName + " imageFileName=" +
+                                  cVector_->imageFileName() +
+                                  " cvPathName=" + cVector_->pathName() );
+      }
+
+      recordIndex_ = std::move( index );
+   }
+
+   std::shared_ptr<const RecordIndex> CompressedVectorReaderImpl::recordIndex() const
+   {
+      return recordIndex_;
+   }
+
+   void CompressedVectorReaderImpl::setRecordIndex( std::shared_ptr<const RecordIndex> index )
+   {
+      waitForAsyncReads();
+
+      recordIndex_ = std::move( index );
    }
 
    bool CompressedVectorReaderImpl::isOpen() const
@@ -552,9 +1639,10 @@ namespace e57
 
    void CompressedVectorReaderImpl::close()
    {
+      waitForAsyncReads();
+
       // Before anything that can throw, decrement reader count
-      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
-      imf->decrReaderCount();
+      imf_->decrReaderCount();
 
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
@@ -566,8 +1654,12 @@ namespace e57
 
       // Destroy decoders
       channels_.clear();
+      memory_.reset();
+
+      unlockPacket();
 
-      delete cache_;
+      // The cache belongs to the ImageFile
+      cache_->removeSectionReader( cacheSectionEndLogicalOffset_ );
       cache_ = nullptr;
 
       isOpen_ = false;
@@ -26,12 +26,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <deque>
+#include <functional>
+#include <future>
+
 #include "DecodeChannel.h"
+#include "MemoryUsage.h"
 
 namespace e57
 {
    class DataPacket;
+   class PacketLock;
    class PacketReadCache;
+   class RecordIndex;
+   class ThreadPool;
+   struct StatisticsCounters;
 
    class CompressedVectorReaderImpl
    {
@@ -42,7 +51,36 @@ namespace e57
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
+      std::future<unsigned> readAsync( std::vector<SourceDestBuffer> &dbufs );
+
+      /// Check a set of buffers once, to be switched to with useBufferSet() without checking
+      /// them again
+      /// @returns its number (counting from 0)
+      unsigned addBufferSet( std::vector<SourceDestBuffer> &dbufs );
+      void useBufferSet( unsigned bufferSet );
+
+      void setRecordFilters( const std::vector<RecordFilter> &filters );
+      void setRecordStride( uint64_t stride );
+
+      /// Called by read() with the number of records it has put in the buffers, before returning
+      /// them. Used by the Simple API to convert the records in place.
+      using RecordsReadHandler = std::function<void( unsigned recordCount )>;
+
+      /// Set (or clear) the handler. It is cleared when read() is given other buffers.
+      void setRecordsReadHandler( const RecordsReadHandler &handler );
+
+      /// Go on reading cvi (of the same file, prototype and codecs) from its first record with
+      /// the decoders, buffers and handler we already have
+      void restart( std::shared_ptr<CompressedVectorNodeImpl> cvi );
       void seek( uint64_t recordNumber );
+      void buildRecordIndex();
+      void writeRecordIndex( const ustring &fileName ) const;
+      void readRecordIndex( const ustring &fileName );
+
+      /// The index built or read by the calls above (null if there isn't one), and giving it to
+      /// another reader of the same CompressedVector so it doesn't have to build its own
+      std::shared_ptr<const RecordIndex> recordIndex() const;
+      void setRecordIndex( std::shared_ptr<const RecordIndex> index );
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
       void close();
@@ -57,23 +95,108 @@ namespace e57
       void checkReaderOpen( const char *srcFileName, int srcLineNumber,
                             const char *srcFunctionName ) const;
       void setBuffers( std::vector<SourceDestBuffer> &dbufs ); //???needed?
+      void checkBuffersCompatible( const std::vector<SourceDestBuffer> &dbufs ) const;
+      void openSection();
+      unsigned readNext();
+      unsigned readNext( std::vector<SourceDestBuffer> &dbufs );
+      void waitForAsyncReads();
       uint64_t earliestPacketNeededForInput() const;
+      unsigned readRecords();
+      unsigned decodedRecordCount() const;
+      unsigned filterRecords( unsigned firstRecord, unsigned recordCount );
 
-      DataPacket *dataPacket( uint64_t inLogicalOffset ) const;
+      const DataPacket *lockPacket( uint64_t packetLogicalOffset );
+      void unlockPacket();
       void feedPacketToDecoders( uint64_t currentPacketLogicalOffset );
+      void feedBytestreamToDecoder( DecodeChannel &channel );
+      void skipEmptyBytestreamBuffers( DecodeChannel &channel );
+      uint64_t readAheadEndLogicalOffset() const;
+      void adviseReadAhead();
       uint64_t findNextDataPacket( uint64_t nextPacketLogicalOffset );
+      void decodeRecords();
+
+      void restartChannels( uint64_t dataLogicalOffset, uint64_t recordNumber );
+      void findChunk( uint64_t recordNumber, uint64_t &chunkRecordNumber,
+                      uint64_t &chunkLogicalOffset );
+      void seekRecord( uint64_t recordNumber );
+      void skipRecords( uint64_t recordCount );
+      void setDecoderStrides( uint64_t stride, uint64_t firstRecord );
+      bool seekUsingRecordIndex( uint64_t recordNumber );
+      unsigned bytestreamCount() const;
 
       //??? no default ctor, copy, assignment?
 
       bool isOpen_;
       std::vector<SourceDestBuffer> dbufs_;
+
+      /// The buffers registered by addBufferSet(). Each buffer is also kept on its own, as its
+      /// channel's decoder takes it, so switching to a set only swaps pointers.
+      struct BufferSet
+      {
+         std::vector<SourceDestBuffer> buffers;
+         std::vector<std::vector<SourceDestBuffer>> channelBuffers;
+      };
+      std::vector<BufferSet> bufferSets_;
+
       std::shared_ptr<CompressedVectorNodeImpl> cVector_;
+      ImageFileImplSharedPtr imf_; /// cVector_'s file, held so reads don't lock its weak pointer
       NodeImplSharedPtr proto_;
       std::vector<DecodeChannel> channels_;
       PacketReadCache *cache_;
+      ThreadPool *decodePool_; /// null if the channels are decoded on the reading thread
+      StatisticsCounters *statistics_; /// the file's, see ImageFile::statistics()
+      MemoryReservation memory_;        /// counts the decoders' buffers in the file's memory usage
 
       uint64_t recordCount_; /// number of records written so far
       uint64_t maxRecordCount_;
       uint64_t sectionEndLogicalOffset_;
+      uint64_t cacheSectionEndLogicalOffset_ = 0; /// the section cache_ was told we read
+      uint64_t dataLogicalOffset_;  /// first data packet
+      uint64_t indexLogicalOffset_; /// top level index packet, 0 if there is no index
+      bool skippingPackets_; /// some packets had nothing for our bytestreams, so were skipped
+
+      /// With access hints (see CheckedFile::advise()), the end of the part of the section the
+      /// OS has been told we will need, and the start of the part it hasn't been told we are done
+      /// with
+      uint64_t advisedLogicalOffset_;
+      uint64_t releasedLogicalOffset_;
+
+      std::shared_ptr<const RecordIndex> recordIndex_; /// built or read by the user, may be null
+
+      /// The packet the channels are being fed from, see lockPacket(). It stays locked in the
+      /// cache while decodeRecords() moves from one channel to the next and on to the following
+      /// packet, so it is looked up (and its bytestream buffers found) once rather than each time
+      /// a channel needs it.
+      struct LockedPacket
+      {
+         uint64_t logicalOffset = 0; /// 0 if no packet is locked
+         std::unique_ptr<PacketLock> lock;
+         const DataPacket *packet = nullptr;
+
+         /// Where each bytestream buffer of a data packet starts, and its length
+         std::vector<const char *> bytestreams;
+         std::vector<unsigned> bytestreamLengths;
+      };
+
+      LockedPacket lockedPacket_;
+
+      /// A RecordFilter with the index of its buffer in dbufs_ (and of its channel)
+      struct BufferFilter
+      {
+         size_t bufferIndex;
+         double minimum;
+         double maximum;
+      };
+
+      std::vector<BufferFilter> filters_; /// empty if read() returns every record
+
+      uint64_t recordStride_ = 1; /// see setRecordStride()
+
+      RecordsReadHandler recordsReadHandler_; /// may be empty
+
+      /// Thread running the reads started by readAsync() one after the other, and their results.
+      /// Everything else waits for them to finish first.
+      std::unique_ptr<ThreadPool> asyncPool_;
+      std::deque<std::future<void>> asyncReads_;
    };
 }
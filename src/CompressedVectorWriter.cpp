@@ -70,8 +70,14 @@ void CompressedVectorWriter::checkInvariant( bool /*doRecurse*/ )
       throw E57_EXCEPTION1( ErrorInvarianceViolation );
    }
 
-   // Dest ImageFile must have exactly 1 writer (this one)
-   if ( imf.writerCount() != 1 )
+   // Dest ImageFile must have at least 1 writer (this one)
+   if ( imf.writerCount() < 1 )
+   {
+      throw E57_EXCEPTION1( ErrorInvarianceViolation );
+   }
+
+   // Must either write at the end of the file or hold the data packets back, not both
+   if ( impl_->holdsFileEnd() == impl_->isSpooling() )
    {
       throw E57_EXCEPTION1( ErrorInvarianceViolation );
    }
@@ -253,6 +259,102 @@ void CompressedVectorWriter::write( std::vector<SourceDestBuffer> &sbufs, const
    impl_->write( sbufs, recordCount );
 }
 
+/*!
+@brief Start a transfer of a block of data from the given source buffers on a background thread.
+
+@param [in] sbufs The buffers holding the records to write, with the same requirements as for
+CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t).
+@param [in] recordCount Number of records to write.
+
+@details
+This does what CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t) does, but
+returns straight away. The records are encoded, and their data packets written to the file, on a
+thread owned by this CompressedVectorWriter while the caller gets on with something else. Several
+writes may be started at once. They are done one after the other, in the order they were started.
+
+This allows double buffering: with two sets of buffers, start writing the first set, fill the
+second set while it is encoded, then start writing the second set and fill the first set again
+once its future is ready.
+
+The buffers of a write must not be changed until its future is ready. Any other call on this
+CompressedVectorWriter (including write() and close()) first waits for all the writes which have
+been started to finish. Since the buffers are given here, the Simple API doesn't gather statistics
+(e.g. bounds) about the records in them.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@return A future which is ready once the records have been written, or holds the exception thrown
+by the write (see CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t)).
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorWriterNotOpen
+
+@see CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t)
+*/
+std::future<void> CompressedVectorWriter::writeAsync( std::vector<SourceDestBuffer> &sbufs,
+                                                      const size_t recordCount )
+{
+   return impl_->writeAsync( sbufs, recordCount );
+}
+
+/*!
+@brief Check a set of source buffers once, so that writing from them later costs nothing.
+
+@param [in] sbufs The buffers, with the same requirements as for
+CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t).
+
+@details
+Each time CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t) is given buffers,
+they are checked against the prototype and against the buffers used before, and their handles are
+copied. When the same few sets of buffers are used over and over (e.g. filling one set while the
+records in the other are written), register each set once with this and switch between them with
+CompressedVectorWriter::useBufferSet(), which only swaps pointers.
+
+@pre The associated ImageFile must be open.
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@return The number of the buffer set, counting from 0.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorWriterNotOpen
+@throw ::ErrorPathUndefined
+@throw ::ErrorNoBufferForElement
+@throw ::ErrorBufferSizeMismatch
+@throw ::ErrorBufferDuplicatePathName
+@throw ::ErrorBuffersNotCompatible
+@throw ::ErrorInternal All objects in undocumented state
+
+@see CompressedVectorWriter::useBufferSet()
+*/
+unsigned CompressedVectorWriter::addBufferSet( std::vector<SourceDestBuffer> &sbufs )
+{
+   return impl_->addBufferSet( sbufs );
+}
+
+/*!
+@brief Make CompressedVectorWriter::write(size_t) take the records from a buffer set registered
+by CompressedVectorWriter::addBufferSet().
+
+@param [in] bufferSet The number returned by CompressedVectorWriter::addBufferSet().
+
+@details
+The buffers aren't checked again. As with
+CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, size_t), the Simple API doesn't
+gather statistics (e.g. bounds) about the records in them.
+
+@pre This CompressedVectorWriter must be open (i.e isOpen())
+
+@throw ::ErrorWriterNotOpen
+@throw ::ErrorBadAPIArgument If there is no such buffer set.
+
+@see CompressedVectorWriter::addBufferSet(), CompressedVectorWriter::write(size_t)
+*/
+void CompressedVectorWriter::useBufferSet( unsigned bufferSet )
+{
+   impl_->useBufferSet( bufferSet );
+}
+
 /*!
 @brief End the write operation.
 
@@ -25,19 +25,40 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <numeric>
 
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
 #include "CompressedVectorWriterImpl.h"
 #include "ImageFileImpl.h"
+#include "IntegerNodeImpl.h"
+#include "PacketSpool.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
 #include "StringFunctions.h"
+#include "StructureNodeImpl.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 namespace e57
 {
+   // Approximate amount of record data in each chunk (the unit the index points to). Seeking
+   // decodes up to this much to get from the start of a chunk to the requested record.
+   constexpr uint64_t CHUNK_TARGET_SIZE = 4 * DATA_PACKET_MAX;
+
+   // Chunks start on a multiple of this many records. Every bytestream is then on a word
+   // boundary, so a chunk can start in a new data packet without padding any of them.
+   constexpr uint64_t CHUNK_RECORD_ALIGNMENT = 64;
+
+   // When encoding in parallel, the least number of records each bytestream encodes at a time
+   constexpr uint64_t PARALLEL_MIN_RECORD_COUNT = 64;
+
+   // The smallest output buffer given to an encoder to fit a memory budget
+   constexpr uint64_t BUDGET_MIN_ENCODER_BUFFER_SIZE = 1024;
+
    struct SortByBytestreamNumber
    {
       bool operator()( const std::shared_ptr<Encoder> &lhs,
@@ -47,9 +68,464 @@ namespace e57
       }
    };
 
+   // Deflate level asked for by the codecs of a CompressedVector (see DEFLATE_CODEC_URI), or 0
+   int _deflateLevel( const CompressedVectorNodeImpl &cVector )
+   {
+      const auto deflateCodec = cVector.findCodec( DEFLATE_CODEC_URI, "deflateCodec", "" );
+
+      if ( !deflateCodec )
+      {
+         return 0;
+      }
+
+      if ( !DataPacket::deflateAvailable() )
+      {
+         throw E57_EXCEPTION2( ErrorNotImplemented,
+                               "deflateCodec (built without E57_WITH_ZLIB)" );
+      }
+
+      int64_t level = 6;
+
+      if ( deflateCodec->isDefined( "level" ) )
+      {
+         const auto levelNode =
+            std::dynamic_pointer_cast<IntegerNodeImpl>( deflateCodec->get( "level" ) );
+
+         if ( !levelNode )
+         {
+            throw E57_EXCEPTION2( ErrorBadCodecs, "deflateCodec/level" );
+         }
+
+         level = levelNode->value();
+      }
+
+      if ( level < 1 || level > 9 )
+      {
+         throw E57_EXCEPTION2( ErrorBadCodecs, "level=" + toString( level ) );
+      }
+
+      return static_cast<int>( level );
+   }
+
+   size_t _outputAvailable( const std::vector<std::shared_ptr<Encoder>> &encoders )
+   {
+      size_t total = 0;
+
+      for ( const auto &encoder : encoders )
+      {
+         total += encoder->outputAvailable();
+      }
+
+      return total;
+   }
+
+   size_t _packetSize( const std::vector<std::shared_ptr<Encoder>> &encoders )
+   {
+      return ( sizeof( DataPacketHeader ) + encoders.size() * sizeof( uint16_t ) +
+               _outputAvailable( encoders ) );
+   }
+
+   /// @returns the bytes of the encoders' output buffers, for the file's memory usage
+   uint64_t _outputMaxSize( const std::vector<std::shared_ptr<Encoder>> &encoders )
+   {
+      uint64_t total = 0;
+      for ( const auto &encoder : encoders )
+      {
+         total += encoder->outputGetMaxSize();
+      }
+
+      return total;
+   }
+
+   void _flush( std::vector<std::shared_ptr<Encoder>> &encoders )
+   {
+      for ( auto &encoder : encoders )
+      {
+         encoder->registerFlushToOutput();
+      }
+   }
+
+   /// Choose how many bytes of each encoder's output to put in a packet with room for
+   /// payloadBytes, so that all of them stop at the same record as far as their output allows
+   /// (see PacketPackingRecordAligned). Where each output starts and ends is estimated from the
+   /// encoder's bits per record, which is exact for bitPack numbers and an average for the
+   /// others.
+   /// @returns false if that would leave most of the packet empty, e.g. because a bytestream of
+   /// long strings is far behind the others
+   bool _recordAlignedCounts( const std::vector<std::shared_ptr<Encoder>> &encoders,
+                              size_t payloadBytes, std::vector<size_t> &count )
+   {
+      const size_t cNumByteStreams = encoders.size();
+
+      std::vector<size_t> available( cNumByteStreams );
+      std::vector<double> bytesPerRecord( cNumByteStreams, 0.0 );
+      std::vector<double> firstRecord( cNumByteStreams, 0.0 );
+
+      double lowest = std::numeric_limits<double>::max();
+      double highest = 0.0;
+
+      for ( size_t i = 0; i < cNumByteStreams; ++i )
+      {
+         available[i] = encoders[i]->outputAvailable();
+
+         if ( available[i] == 0 )
+         {
+            continue;
+         }
+
+         bytesPerRecord[i] = encoders[i]->bitsPerRecord() / 8.0;
+
+         if ( !( bytesPerRecord[i] > 0.0 ) )
+         {
+            return false;
+         }
+
+         // The output ends at about the last record given to the encoder
+         const auto lastRecord = static_cast<double>( encoders[i]->currentRecordIndex() );
+         firstRecord[i] = lastRecord - static_cast<double>( available[i] ) / bytesPerRecord[i];
+
+         lowest = std::min( lowest, firstRecord[i] );
+         highest = std::max( highest, lastRecord );
+      }
+
+      // Bytes each bytestream sends to get up to record
+      std::vector<size_t> trial( cNumByteStreams );
+
+      const auto countsUpTo = [&]( double record ) {
+         size_t total = 0;
+
+         for ( size_t i = 0; i < cNumByteStreams; ++i )
+         {
+            const double bytes =
+               std::floor( std::max( record - firstRecord[i], 0.0 ) * bytesPerRecord[i] );
+
+            trial[i] = std::min( available[i], static_cast<size_t>( bytes ) );
+            total += trial[i];
+         }
+
+         return total;
+      };
+
+      // The bytes sent only grow with the record, so search for the last one that still fits
+      size_t bestTotal = 0;
+
+      for ( int step = 0; ( step < 64 ) && ( lowest < highest ); ++step )
+      {
+         const double middle = lowest + ( highest - lowest ) / 2.0;
+         const size_t total = countsUpTo( middle );
+
+         if ( total <= payloadBytes )
+         {
+            lowest = middle;
+
+            if ( total >= bestTotal )
+            {
+               bestTotal = total;
+               count = trial;
+            }
+         }
+         else
+         {
+            highest = middle;
+         }
+      }
+
+      return bestTotal * 2 >= payloadBytes;
+   }
+
+   /// Fill dataPacket with as much of the encoders' output as fits, sharing it between them as
+   /// packing says
+   /// @returns the length of the packet
+   unsigned _fillDataPacket( std::vector<std::shared_ptr<Encoder>> &encoders,
+                             PacketPacking packing, DataPacket &dataPacket )
+   {
+      const size_t cTotalOutput = _outputAvailable( encoders );
+      const auto &cStreams = encoders;
+      const auto cNumByteStreams = cStreams.size();
+
+      // Calc maximum number of bytestream values can put in data packet.
+      const size_t cPacketMaxPayloadBytes =
+         DATA_PACKET_MAX - sizeof( DataPacketHeader ) - cNumByteStreams * sizeof( uint16_t );
+
+#ifdef E57_VERBOSE
+      std::cout << "  totalOutput=" << totalOutput << std::endl;
+      std::cout << "  cNumByteStreams=" << cNumByteStreams << std::endl;
+      std::cout << "  packetMaxPayloadBytes=" << packetMaxPayloadBytes << std::endl;
+#endif
+
+      // Allocate vector for number of bytes that each bytestream will write to file.
+      std::vector<size_t> count( cNumByteStreams );
+
+      // See if we can fit into a single data packet
+      if ( cTotalOutput < cPacketMaxPayloadBytes )
+      {
+         // We can fit everything in one packet
+         for ( unsigned i = 0; i < cNumByteStreams; ++i )
+         {
+            count.at( i ) = cStreams.at( i )->outputAvailable();
+         }
+      }
+      else if ( ( packing != PacketPackingRecordAligned ) ||
+                !_recordAlignedCounts( cStreams, cPacketMaxPayloadBytes, count ) )
+      {
+         // We have too much data for one packet.  Send proportional amounts from
+         // each bytestream. Adjust packetMaxPayloadBytes down by one so have a
+         // little slack for floating point weirdness.
+         const float cFractionToSend =
+            ( cPacketMaxPayloadBytes - 1 ) / static_cast<float>( cTotalOutput );
+         for ( unsigned i = 0; i < cNumByteStreams; ++i )
+         {
+            // Round down here so sum <= packetMaxPayloadBytes
+            count.at( i ) = static_cast<unsigned>(
+               std::floor( cFractionToSend * cStreams.at( i )->outputAvailable() ) );
+         }
+      }
+
+#ifdef E57_VERBOSE
+      for ( unsigned i = 0; i < cNumByteStreams; ++i )
+      {
+         std::cout << "  count[" << i << "]=" << count.at( i ) << std::endl;
+      }
+#endif
+
+#if VALIDATE_BASIC
+      // Double check sum of count is <= packetMaxPayloadBytes
+      const size_t cTotalByteCount =
+         std::accumulate( count.begin(), count.end(), static_cast<size_t>( 0 ) );
+
+      if ( cTotalByteCount > cPacketMaxPayloadBytes )
+      {
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "totalByteCount=" + toString( cTotalByteCount ) +
+                                  " packetMaxPayloadBytes=" + toString( cPacketMaxPayloadBytes ) );
+      }
+#endif
+
+      char *packet = reinterpret_cast<char *>( &dataPacket );
+
+      // To be safe, clear header part of packet
+      dataPacket.header.reset();
+
+      // Write bytestreamBufferLength[bytestreamCount] after header, in dataPacket
+      auto bsbLength = reinterpret_cast<uint16_t *>( &packet[sizeof( DataPacketHeader )] );
+#ifdef E57_VERBOSE
+      std::cout << "  packet=" << static_cast<void *>( packet ) << std::endl; //???
+      std::cout << "  bsbLength=" << bsbLength << std::endl;                  //???
+#endif
+      for ( unsigned i = 0; i < cNumByteStreams; ++i )
+      {
+         bsbLength[i] = static_cast<uint16_t>( count.at( i ) ); // %%% Truncation
+#ifdef E57_VERBOSE
+         std::cout << "  Writing " << bsbLength[i] << " bytes into bytestream " << i
+                   << std::endl; //???
+#endif
+      }
+
+      // Get pointer to end of data so far
+      auto *p = reinterpret_cast<char *>( &bsbLength[cNumByteStreams] );
+#ifdef E57_VERBOSE
+      std::cout << "  after bsbLength, p=" << static_cast<void *>( p ) << std::endl; //???
+#endif
+
+      // Write contents of each bytestream in dataPacket
+      for ( size_t i = 0; i < cNumByteStreams; ++i )
+      {
+         size_t n = count.at( i );
+
+#if VALIDATE_BASIC
+         // Double check we aren't accidentally going to write off end of vector<char>
+         if ( &p[n] > &packet[DATA_PACKET_MAX] )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "n=" + toString( n ) );
+         }
+#endif
+
+         // Read from encoder output into packet
+         cStreams.at( i )->outputRead( p, n );
+
+         // Move pointer to end of current data
+         p += n;
+      }
+
+      // Length of packet is difference in beginning pointer and ending pointer
+      auto packetLength = static_cast<unsigned>( p - packet ); //??? pointer diff portable?
+#ifdef E57_VERBOSE
+      std::cout << "  packetLength=" << packetLength << std::endl; //???
+#endif
+
+#if VALIDATE_BASIC
+      // Double check that packetLength is what we expect
+      if ( packetLength !=
+           sizeof( DataPacketHeader ) + cNumByteStreams * sizeof( uint16_t ) + cTotalByteCount )
+      {
+         throw E57_EXCEPTION2( ErrorInternal, "packetLength=" + toString( packetLength ) +
+                                                 " bytestreamSize=" +
+                                                 toString( cNumByteStreams * sizeof( uint16_t ) ) +
+                                                 " totalByteCount=" + toString( cTotalByteCount ) );
+      }
+#endif
+
+      // packetLength must be multiple of 4, if not, add some zero padding
+      while ( packetLength % 4 )
+      {
+         // Double check we aren't accidentally going to write off end of
+         // vector<char>
+         if ( p >= &packet[DATA_PACKET_MAX] )
+         {
+            throw E57_EXCEPTION1( ErrorInternal );
+         }
+         *p++ = 0;
+         packetLength++;
+#ifdef E57_VERBOSE
+         std::cout << "  padding with zero byte, new packetLength=" << packetLength
+                   << std::endl; //???
+#endif
+      }
+
+      // Prepare header in dataPacket, now that we are sure of packetLength
+      dataPacket.header.packetLogicalLengthMinus1 =
+         static_cast<uint16_t>( packetLength - 1 ); // %%% Truncation
+      dataPacket.header.bytestreamCount =
+         static_cast<uint16_t>( cNumByteStreams ); // %%% Truncation
+
+      // Double check that data packet is well formed
+      dataPacket.verify( packetLength );
+
+      return packetLength;
+   }
+
+   /// The data packets of a chunk encoded by _encodeChunk(), ready to be written in order
+   struct EncodedChunk
+   {
+      uint64_t firstRecordIndex = 0;
+      std::vector<char> packets; /// one after the other
+      std::vector<unsigned> packetLengths;
+   };
+
+   /// Encode recordCount records using encoders of their own, fed from buffers holding just
+   /// those records. The packets come out exactly as CompressedVectorWriterImpl::write() would
+   /// make them for a chunk, so they can be encoded at the same time as other chunks.
+   void _encodeChunk( std::vector<std::shared_ptr<Encoder>> &encoders, uint64_t recordCount,
+                      size_t packetFillTarget, PacketPacking packing, int deflateLevel,
+                      EncodedChunk &chunk )
+   {
+      std::unique_ptr<DataPacket> dataPacket( new DataPacket );
+      std::unique_ptr<DataPacket> deflatedPacket;
+
+      if ( deflateLevel > 0 )
+      {
+         deflatedPacket.reset( new DataPacket );
+      }
+
+      auto emitPacket = [&]() {
+         unsigned packetLength = _fillDataPacket( encoders, packing, *dataPacket );
+         const char *packet = reinterpret_cast<const char *>( dataPacket.get() );
+
+         if ( deflatedPacket )
+         {
+            const unsigned deflatedLength =
+               dataPacket->deflate( packetLength, deflateLevel, *deflatedPacket );
+
+            if ( deflatedLength > 0 )
+            {
+               packet = reinterpret_cast<const char *>( deflatedPacket.get() );
+               packetLength = deflatedLength;
+            }
+         }
+
+         chunk.packets.insert( chunk.packets.end(), packet, packet + packetLength );
+         chunk.packetLengths.push_back( packetLength );
+      };
+
+      // The same steps as write(), then close()
+      while ( true )
+      {
+         bool allDone = true;
+         for ( auto &encoder : encoders )
+         {
+            if ( encoder->currentRecordIndex() < recordCount )
+            {
+               allDone = false;
+               break;
+            }
+         }
+
+         if ( allDone )
+         {
+            break;
+         }
+
+         if ( _packetSize( encoders ) >= packetFillTarget )
+         {
+            emitPacket();
+            continue;
+         }
+
+         for ( auto &encoder : encoders )
+         {
+            if ( encoder->currentRecordIndex() < recordCount )
+            {
+               const uint64_t count =
+                  std::min<uint64_t>( recordCount - encoder->currentRecordIndex(), 64 );
+               encoder->processRecords( static_cast<unsigned>( count ) );
+            }
+         }
+      }
+
+      _flush( encoders );
+      while ( _outputAvailable( encoders ) > 0 )
+      {
+         emitPacket();
+         _flush( encoders );
+      }
+   }
+
+   template <typename T>
+   SourceDestBuffer _sliceBufferAs( const ImageFile &imf, const SourceDestBufferImpl &sbuf,
+                                    size_t first, size_t count )
+   {
+      char *base = static_cast<char *>( sbuf.base() ) + first * sbuf.stride();
+
+      return SourceDestBuffer( imf, sbuf.pathName(), reinterpret_cast<T *>( base ), count,
+                               sbuf.doConversion(), sbuf.doScaling(), sbuf.stride() );
+   }
+
+   /// A buffer for count of the elements of the numeric buffer sbuf, starting at first
+   SourceDestBuffer _sliceBuffer( const ImageFile &imf, const SourceDestBuffer &sbuf,
+                                  size_t first, size_t count )
+   {
+      const SourceDestBufferImpl &impl = *sbuf.impl();
+
+      switch ( impl.memoryRepresentation() )
+      {
+         case Int8:
+            return _sliceBufferAs<int8_t>( imf, impl, first, count );
+         case UInt8:
+            return _sliceBufferAs<uint8_t>( imf, impl, first, count );
+         case Int16:
+            return _sliceBufferAs<int16_t>( imf, impl, first, count );
+         case UInt16:
+            return _sliceBufferAs<uint16_t>( imf, impl, first, count );
+         case Int32:
+            return _sliceBufferAs<int32_t>( imf, impl, first, count );
+         case UInt32:
+            return _sliceBufferAs<uint32_t>( imf, impl, first, count );
+         case Int64:
+            return _sliceBufferAs<int64_t>( imf, impl, first, count );
+         case Bool:
+            return _sliceBufferAs<bool>( imf, impl, first, count );
+         case Real32:
+            return _sliceBufferAs<float>( imf, impl, first, count );
+         case Real64:
+            return _sliceBufferAs<double>( imf, impl, first, count );
+         default:
+            throw E57_EXCEPTION2( ErrorInternal, "pathName=" + impl.pathName() );
+      }
+   }
+
    CompressedVectorWriterImpl::CompressedVectorWriterImpl(
       std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer> &sbufs ) :
-      cVector_( ni ),
+      cVector_( ni ), imf_( ni->destImageFile_ ),
       isOpen_( false ) // set to true when succeed below
    {
       //???  check if cvector already been written (can't write twice)
@@ -68,68 +544,261 @@ namespace e57
       // Check sbufs well formed (matches proto exactly)
       setBuffers( sbufs ); //??? copy code here?
 
+      encodePool_ = imf_->encodePool();
+      packetFillTarget_ = imf_->packetFillTarget();
+      encoderBufferSize_ = imf_->encoderBufferSize();
+      packetPacking_ = imf_->packetPacking();
+
+      // Under a memory budget, the encoders' output buffers share half of it (the chunks
+      // encoded in parallel get the other half). Packets are then sent once they have as much
+      // as one buffer holds.
+      if ( const uint64_t budget = imf_->memoryBudget() )
+      {
+         const uint64_t bufferSize =
+            ( budget / 2 / sbufs_.size() ) / sizeof( uint64_t ) * sizeof( uint64_t );
+
+         encoderBufferSize_ = static_cast<unsigned>(
+            std::max<uint64_t>( std::min<uint64_t>( bufferSize, encoderBufferSize_ ),
+                                BUDGET_MIN_ENCODER_BUFFER_SIZE ) );
+         packetFillTarget_ = std::min<size_t>( packetFillTarget_, encoderBufferSize_ );
+      }
+
       // For each individual sbuf, create an appropriate Encoder based on the
       // cVector_ attributes
-      for ( unsigned i = 0; i < sbufs_.size(); i++ )
-      {
-         // Create vector of single sbuf  ??? for now, may have groups later
-         std::vector<SourceDestBuffer> vTemp;
-         vTemp.push_back( sbufs_.at( i ) );
+      bytestreams_ = makeEncoders( sbufs_ );
 
-         ustring codecPath = sbufs_.at( i ).pathName();
+      // The encoders are in bytestream order, so find out which buffer each of them takes
+      bytestreamBuffers_.resize( sbufs_.size() );
 
-         // Calc which stream the given path belongs to.  This depends on position
-         // of the node in the proto tree.
-         NodeImplSharedPtr readNode = proto_->get( sbufs.at( i ).pathName() );
+      for ( size_t i = 0; i < sbufs_.size(); ++i )
+      {
          uint64_t bytestreamNumber = 0;
-         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         proto_->findTerminalPosition( proto_->get( sbufs_[i].pathName() ), bytestreamNumber );
+
+         bytestreamBuffers_.at( static_cast<size_t>( bytestreamNumber ) ) = i;
+      }
+
+      // Compress the data packets if one of the codecs asks for it
+      deflateLevel_ = _deflateLevel( *cVector_ );
+
+      if ( deflateLevel_ > 0 )
+      {
+         deflatedPacket_.reset( new DataPacket );
+      }
+
+      memory_.reset( imf_->memoryUsageCounters(),
+                     _outputMaxSize( bytestreams_ ) +
+                        sizeof( DataPacket ) * ( ( deflatedPacket_ != nullptr ) ? 2 : 1 ) );
+
+      open();
+   }
+
+   CompressedVectorWriterImpl::CompressedVectorWriterImpl(
+      std::shared_ptr<CompressedVectorNodeImpl> ni ) :
+      cVector_( ni ), imf_( ni->destImageFile_ ),
+      isOpen_( false ) // set to true by open()
+   {
+      proto_ = cVector_->getPrototype();
+
+      // The packets are given to us whole, so we don't need any of the encoding state
+      encodePool_ = nullptr;
+      packetFillTarget_ = imf_->packetFillTarget();
+      encoderBufferSize_ = imf_->encoderBufferSize();
+      packetPacking_ = imf_->packetPacking();
+      deflateLevel_ = 0;
+
+      open();
+   }
+
+   void CompressedVectorWriterImpl::open()
+   {
+      // Reserve space for CompressedVector binary section header, record location
+      // so can save to when writer closes. Request that file be extended with
+      // zeros since we will write to it at a later time (when writer closes).
+      // If another writer has the end of the file, hold the data packets back until we get it.
+      if ( imf_->claimFileEnd( this ) )
+      {
+         sectionHeaderLogicalStart_ =
+            imf_->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+      }
+      else
+      {
+         sectionHeaderLogicalStart_ = 0;
+         spool_ = std::make_shared<PacketSpool>();
+      }
+
+      sectionLogicalLength_ = 0;
+      dataPhysicalOffset_ = 0;
+      topIndexPhysicalOffset_ = 0;
+      recordCount_ = 0;
+      dataPacketsCount_ = 0;
+      indexPacketsCount_ = 0;
+
+      // Pick the chunk length from the expected size of a record
+      float totalBitsPerRecord = 0;
+      for ( auto &bytestream : bytestreams_ )
+      {
+         totalBitsPerRecord += bytestream->bitsPerRecord();
+      }
+
+      const auto recordsPerChunk = static_cast<uint64_t>(
+         ( CHUNK_TARGET_SIZE * 8 ) / std::max( totalBitsPerRecord, 1.0F ) );
+
+      recordsPerChunk_ =
+         std::max( recordsPerChunk / CHUNK_RECORD_ALIGNMENT * CHUNK_RECORD_ALIGNMENT,
+                   CHUNK_RECORD_ALIGNMENT );
+      nextChunkRecordIndex_ = recordsPerChunk_;
+
+      // The first data packet starts the first chunk
+      chunkStartRecordIndex_ = 0;
+      chunkStartPending_ = true;
+
+      // Just before return (and can't throw) increment writer count  ??? safer
+      // way to assure don't miss close?
+      imf_->incrWriterCount();
+
+      // If get here, the writer is open
+      isOpen_ = true;
+   }
+
+   void CompressedVectorWriterImpl::copyPackets( const CompressedVectorNodeImpl &source )
+   {
+      waitForAsyncWrites();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( !bytestreams_.empty() || ( recordCount_ > 0 ) || ( dataPacketsCount_ > 0 ) )
+      {
+         throw E57_EXCEPTION2( ErrorInternal, "imageFileName=" + cVector_->imageFileName() +
+                                                 " cvPathName=" + cVector_->pathName() );
+      }
+
+      ImageFileImplSharedPtr sourceImf( source.destImageFile_ );
+      CheckedFile *sourceFile = sourceImf->file_;
+
+      CompressedVectorSectionHeader sectionHeader;
+      const uint64_t sectionLogicalStart = source.binarySectionLogicalStart_;
+
+      sourceFile->readAt( sectionLogicalStart, reinterpret_cast<char *>( &sectionHeader ),
+                          sizeof( sectionHeader ) );
+      sectionHeader.verify( sourceFile->length( CheckedFile::Physical ) );
+
+      const uint64_t sectionEnd = sectionLogicalStart + sectionHeader.sectionLogicalLength;
+      const uint64_t dataStart = sourceFile->physicalToLogical( sectionHeader.dataPhysicalOffset );
+
+      // Every packet starts with its type and length
+      struct PacketPrefix
+      {
+         uint8_t packetType;
+         uint8_t packetFlags;
+         uint16_t packetLogicalLengthMinus1;
+      };
+
+      auto readPrefix = [&]( uint64_t packetLogicalOffset ) {
+         PacketPrefix prefix{};
+
+         if ( packetLogicalOffset + sizeof( prefix ) > sectionEnd )
          {
-            throw E57_EXCEPTION2( ErrorInternal, "sbufIndex=" + toString( i ) );
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "packetLogicalOffset=" + toString( packetLogicalOffset ) +
+                                     " sectionEnd=" + toString( sectionEnd ) );
          }
 
-         // EncoderFactory picks the appropriate encoder to match type declared in
-         // prototype
-         bytestreams_.push_back( Encoder::EncoderFactory( static_cast<unsigned>( bytestreamNumber ),
-                                                          cVector_, vTemp, codecPath ) );
-      }
+         sourceFile->readAt( packetLogicalOffset, reinterpret_cast<char *>( &prefix ),
+                             sizeof( prefix ) );
 
-      // The bytestreams_ vector must be ordered by bytestreamNumber, not by order
-      // called specified sbufs, so sort it.
-      sort( bytestreams_.begin(), bytestreams_.end(), SortByBytestreamNumber() );
-#if ( E57_VALIDATION_LEVEL == VALIDATION_DEEP )
-      // Double check that all bytestreams are specified
-      for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+         const uint64_t packetEnd =
+            packetLogicalOffset + uint64_t{ prefix.packetLogicalLengthMinus1 } + 1;
+
+         if ( packetEnd > sectionEnd )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "packetLogicalOffset=" + toString( packetLogicalOffset ) +
+                                     " packetEnd=" + toString( packetEnd ) +
+                                     " sectionEnd=" + toString( sectionEnd ) );
+         }
+
+         return prefix;
+      };
+
+      // The data packets don't say which records they hold, so the chunks of the new index are
+      // taken from the bottom level of the source's index (if it has one)
+      std::vector<IndexPacket::IndexPacketEntry> sourceChunks;
+      std::unique_ptr<IndexPacket> indexPacket( new IndexPacket );
+
+      for ( uint64_t offset = dataStart; offset < sectionEnd; )
       {
-         if ( bytestreams_.at( i )->bytestreamNumber() != i )
+         const PacketPrefix prefix = readPrefix( offset );
+         const unsigned packetLength = prefix.packetLogicalLengthMinus1 + 1U;
+
+         if ( prefix.packetType == INDEX_PACKET )
          {
-            throw E57_EXCEPTION2( ErrorInternal,
-                                  "bytestreamIndex=" + toString( i ) + " bytestreamNumber=" +
-                                     toString( bytestreams_.at( i )->bytestreamNumber() ) );
+            sourceFile->readAt( offset, reinterpret_cast<char *>( indexPacket.get() ),
+                                std::min<size_t>( packetLength, sizeof( IndexPacket ) ) );
+            indexPacket->verify( packetLength, static_cast<uint64_t>( source.recordCount_ ) );
+
+            if ( indexPacket->indexLevel == 0 )
+            {
+               sourceChunks.insert( sourceChunks.end(), indexPacket->entries,
+                                    indexPacket->entries + indexPacket->entryCount );
+            }
+         }
+         else if ( ( prefix.packetType != DATA_PACKET ) && ( prefix.packetType != EMPTY_PACKET ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "packetType=" + toString( unsigned{ prefix.packetType } ) +
+                                     " packetLogicalOffset=" + toString( offset ) );
          }
+
+         offset += packetLength;
       }
-#endif
 
-      ImageFileImplSharedPtr imf( ni->destImageFile_ );
+      std::sort( sourceChunks.begin(), sourceChunks.end(),
+                 []( const IndexPacket::IndexPacketEntry &a,
+                     const IndexPacket::IndexPacketEntry &b ) {
+                    return a.chunkPhysicalOffset < b.chunkPhysicalOffset;
+                 } );
+
+      // Copy the data packets in order. writePacket() adds the ones which start a chunk to
+      // chunkIndex_ at their new offsets.
+      chunkStartPending_ = false;
+
+      auto nextChunk = sourceChunks.cbegin();
+      std::vector<char> packet( DATA_PACKET_MAX );
+
+      for ( uint64_t offset = dataStart; offset < sectionEnd; )
+      {
+         const PacketPrefix prefix = readPrefix( offset );
+         const unsigned packetLength = prefix.packetLogicalLengthMinus1 + 1U;
+
+         if ( prefix.packetType == DATA_PACKET )
+         {
+            const uint64_t physicalOffset = sourceFile->logicalToPhysical( offset );
+
+            while ( ( nextChunk != sourceChunks.cend() ) &&
+                    ( nextChunk->chunkPhysicalOffset < physicalOffset ) )
+            {
+               ++nextChunk;
+            }
 
-      // Reserve space for CompressedVector binary section header, record location
-      // so can save to when writer closes. Request that file be extended with
-      // zeros since we will write to it at a later time (when writer closes).
-      sectionHeaderLogicalStart_ =
-         imf->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+            if ( ( nextChunk != sourceChunks.cend() ) &&
+                 ( nextChunk->chunkPhysicalOffset == physicalOffset ) )
+            {
+               chunkStartPending_ = true;
+               chunkStartRecordIndex_ = nextChunk->chunkRecordNumber;
+            }
 
-      sectionLogicalLength_ = 0;
-      dataPhysicalOffset_ = 0;
-      topIndexPhysicalOffset_ = 0;
-      recordCount_ = 0;
-      dataPacketsCount_ = 0;
-      indexPacketsCount_ = 0;
+            sourceFile->readAt( offset, packet.data(), packetLength );
+            writePacket( packet.data(), packetLength );
 
-      // Just before return (and can't throw) increment writer count  ??? safer
-      // way to assure don't miss close?
-      imf->incrWriterCount();
+            chunkStartPending_ = false;
+         }
 
-      // If get here, the writer is open
-      isOpen_ = true;
+         offset += packetLength;
+      }
+
+      recordCount_ = static_cast<uint64_t>( source.recordCount_ );
    }
 
    CompressedVectorWriterImpl::~CompressedVectorWriterImpl()
@@ -138,6 +807,9 @@ namespace e57
       std::cout << "~CompressedVectorWriterImpl() called" << std::endl; //???
 #endif
 
+      // Their tasks use this object
+      waitForAsyncWrites();
+
       try
       {
          if ( isOpen_ )
@@ -156,10 +828,10 @@ namespace e57
 #ifdef E57_VERBOSE
       std::cout << "CompressedVectorWriterImpl::close() called" << std::endl; //???
 #endif
-      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+      waitForAsyncWrites();
 
       // Before anything that can throw, decrement writer count
-      imf->decrWriterCount();
+      imf_->decrWriterCount();
 
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       // don't call checkWriterOpen();
@@ -177,53 +849,179 @@ namespace e57
       // Write all remaining ioBuffers and internal encoder register cache into
       // file. Know we are done when totalOutputAvailable() returns 0 after a
       // flush().
-      flush();
-      while ( totalOutputAvailable() > 0 )
+      try
       {
-         packetWrite();
          flush();
+         while ( totalOutputAvailable() > 0 )
+         {
+            packetWrite();
+            flush();
+         }
+      }
+      catch ( ... )
+      {
+         // Don't keep the other writers from finishing
+         imf_->releaseFileEnd( this );
+         cVector_->writerOpen_ = false;
+         throw;
       }
 
-      // Compute length of whole section we just wrote (from section start to
-      // current start of free space).
-      sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
-#ifdef E57_VERBOSE
-      std::cout << "  sectionLogicalLength_=" << sectionLogicalLength_ << std::endl; //???
-#endif
+      // Free channels
+      bytestreams_.clear();
+      memory_.reset();
 
-      // Prepare CompressedVectorSectionHeader
-      CompressedVectorSectionHeader header;
-      header.sectionLogicalLength = sectionLogicalLength_;
-      header.dataPhysicalOffset =
-         dataPhysicalOffset_; //??? can be zero, if no data written ???not set yet
-      header.indexPhysicalOffset =
-         topIndexPhysicalOffset_; //??? can be zero, if no data written ???not set
-                                  // yet
-#ifdef E57_VERBOSE
-      std::cout << "  CompressedVectorSectionHeader:" << std::endl;
-      header.dump( 4 ); //???
-#endif
+      if ( spool_ && !imf_->claimFileEnd( this ) )
+      {
+         // Another writer has the end of the file, so it writes this section once it is done
+         queueSpooledSection();
+      }
+      else
+      {
+         try
+         {
+            if ( spool_ )
+            {
+               placeSpool();
+            }
 
-#if VALIDATE_BASIC
-      // Verify OK before write it.
-      header.verify( imf->file_->length( CheckedFile::Physical ) );
-#endif
+            // Write index of the chunks after the data, so readers can seek
+            uint64_t indexPacketsCount = 0;
+            topIndexPhysicalOffset_ = writeIndexPackets( *imf_, chunkIndex_, indexPacketsCount );
+            indexPacketsCount_ += indexPacketsCount;
 
-      // Write header at beginning of section, previously allocated
-      imf->file_->seek( sectionHeaderLogicalStart_ );
-      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+            sectionLogicalLength_ = writeSectionHeader( *imf_, sectionHeaderLogicalStart_,
+                                                         dataPhysicalOffset_,
+                                                         topIndexPhysicalOffset_ );
+         }
+         catch ( ... )
+         {
+            imf_->releaseFileEnd( this );
+            cVector_->writerOpen_ = false;
+            throw;
+         }
 
-      // Set address and size of associated CompressedVector
-      cVector_->setRecordCount( recordCount_ );
-      cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+         // Let the next writer have the end of the file
+         imf_->releaseFileEnd( this );
 
-      // Free channels
-      bytestreams_.clear();
+         // Set address and size of associated CompressedVector
+         std::lock_guard<std::recursive_mutex> lock( imf_->writersMutex() );
+
+         cVector_->setRecordCount( recordCount_ );
+         cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+         cVector_->writerOpen_ = false;
+      }
 
 #ifdef E57_VERBOSE
       std::cout << "  CompressedVectorWriter:" << std::endl;
       dump( 4 );
 #endif
+
+      if ( closedHandler_ )
+      {
+         std::lock_guard<std::recursive_mutex> lock( imf_->writersMutex() );
+
+         closedHandler_();
+      }
+   }
+
+   bool CompressedVectorWriterImpl::holdsFileEnd() const
+   {
+      return imf_->ownsFileEnd( this );
+   }
+
+   bool CompressedVectorWriterImpl::isSpooling() const
+   {
+      return ( spool_ != nullptr );
+   }
+
+   void CompressedVectorWriterImpl::placeSpool()
+   {
+      copySpool( *imf_, *spool_, chunkIndex_, sectionHeaderLogicalStart_ );
+
+      if ( dataPacketsCount_ > 0 )
+      {
+         dataPhysicalOffset_ = chunkIndex_.front().chunkPhysicalOffset;
+      }
+
+      spool_.reset();
+   }
+
+   void CompressedVectorWriterImpl::queueSpooledSection()
+   {
+      // Copies of what is needed to write the section, since this writer may be gone by then
+      std::shared_ptr<PacketSpool> spool = spool_;
+      std::vector<IndexPacket::IndexPacketEntry> chunkIndex = chunkIndex_;
+      std::shared_ptr<CompressedVectorNodeImpl> cVector = cVector_;
+      const uint64_t recordCount = recordCount_;
+
+      spool_.reset();
+
+      const auto writeSection = [spool, chunkIndex, cVector, recordCount]() mutable {
+         ImageFileImplSharedPtr destImageFile( cVector->destImageFile_ );
+
+         uint64_t sectionHeaderLogicalStart = 0;
+         try
+         {
+            copySpool( *destImageFile, *spool, chunkIndex, sectionHeaderLogicalStart );
+
+            const uint64_t dataPhysicalOffset =
+               chunkIndex.empty() ? 0 : chunkIndex.front().chunkPhysicalOffset;
+
+            uint64_t indexPacketsCount = 0;
+            const uint64_t topIndexPhysicalOffset =
+               writeIndexPackets( *destImageFile, chunkIndex, indexPacketsCount );
+
+            writeSectionHeader( *destImageFile, sectionHeaderLogicalStart, dataPhysicalOffset,
+                                 topIndexPhysicalOffset );
+         }
+         catch ( ... )
+         {
+            cVector->writerOpen_ = false;
+            throw;
+         }
+
+         std::lock_guard<std::recursive_mutex> lock( destImageFile->writersMutex() );
+
+         cVector->setRecordCount( recordCount );
+         cVector->setBinarySectionLogicalStart( sectionHeaderLogicalStart );
+         cVector->writerOpen_ = false;
+      };
+
+      imf_->queueSection( writeSection, cVector_->pathName() );
+   }
+
+   void CompressedVectorWriterImpl::addHandlers( const RecordsWrittenHandler &recordsWritten,
+                                                 const ClosedHandler &closed )
+   {
+      waitForAsyncWrites();
+
+      if ( !recordsWrittenHandler_ )
+      {
+         recordsWrittenHandler_ = recordsWritten;
+      }
+      else if ( recordsWritten )
+      {
+         const RecordsWrittenHandler before = recordsWrittenHandler_;
+
+         recordsWrittenHandler_ = [=]( size_t recordCount ) {
+            before( recordCount );
+            recordsWritten( recordCount );
+         };
+      }
+
+      if ( !closedHandler_ )
+      {
+         closedHandler_ = closed;
+      }
+      else if ( closed )
+      {
+         const ClosedHandler before = closedHandler_;
+
+         closedHandler_ = [=]() {
+            before();
+            closed();
+         };
+      }
    }
 
    bool CompressedVectorWriterImpl::isOpen() const
@@ -247,21 +1045,7 @@ namespace e57
       // incompatible way
       if ( !sbufs_.empty() )
       {
-         if ( sbufs_.size() != sbufs.size() )
-         {
-            throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                                  "oldSize=" + toString( sbufs_.size() ) +
-                                     " newSize=" + toString( sbufs.size() ) );
-         }
-
-         for ( size_t i = 0; i < sbufs_.size(); ++i )
-         {
-            std::shared_ptr<SourceDestBufferImpl> oldbuf = sbufs_[i].impl();
-            std::shared_ptr<SourceDestBufferImpl> newBuf = sbufs[i].impl();
-
-            // Throw exception if old and new not compatible
-            oldbuf->checkCompatible( newBuf );
-         }
+         checkBuffersCompatible( sbufs );
       }
 
       // Check sbufs well formed: no dups, no missing, no extra
@@ -269,20 +1053,234 @@ namespace e57
       // at same time.
       proto_->checkBuffers( sbufs, false );
 
+      // Half precision and normalized buffers are only converted as they are read into
+      for ( const SourceDestBuffer &sbuf : sbufs )
+      {
+         if ( sbuf.impl()->isEncoded() )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "pathName=" + sbuf.pathName() + " memoryRepresentation=" +
+                                     toString( sbuf.memoryRepresentation() ) +
+                                     " normalized=" + toString( sbuf.impl()->normalized() ) );
+         }
+      }
+
       sbufs_ = sbufs;
+
+      // The encoders read from the buffers they were given, so point them at the new ones
+      if ( !bytestreams_.empty() )
+      {
+         bindEncoders();
+      }
+   }
+
+   void CompressedVectorWriterImpl::checkBuffersCompatible(
+      const std::vector<SourceDestBuffer> &sbufs ) const
+   {
+      if ( sbufs_.size() != sbufs.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                               "oldSize=" + toString( sbufs_.size() ) +
+                                  " newSize=" + toString( sbufs.size() ) );
+      }
+
+      for ( size_t i = 0; i < sbufs_.size(); ++i )
+      {
+         // Throw exception if old and new not compatible
+         sbufs_[i].impl()->checkCompatible( sbufs[i].impl() );
+      }
+   }
+
+   void CompressedVectorWriterImpl::bindEncoders()
+   {
+      for ( size_t i = 0; i < bytestreams_.size(); ++i )
+      {
+         std::vector<SourceDestBuffer> bytestreamSbufs{ sbufs_[bytestreamBuffers_[i]] };
+
+         bytestreams_[i]->sourceBufferSetNew( bytestreamSbufs );
+      }
+   }
+
+   unsigned CompressedVectorWriterImpl::addBufferSet( std::vector<SourceDestBuffer> &sbufs )
+   {
+      waitForAsyncWrites();
+
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // The checks setBuffers() does each time
+      checkBuffersCompatible( sbufs );
+      proto_->checkBuffers( sbufs, false );
+
+      BufferSet bufferSet;
+      bufferSet.buffers = sbufs;
+      bufferSet.bytestreamBuffers.reserve( sbufs.size() );
+
+      for ( const size_t bufferIndex : bytestreamBuffers_ )
+      {
+         bufferSet.bytestreamBuffers.push_back( { sbufs[bufferIndex] } );
+      }
+
+      bufferSets_.push_back( std::move( bufferSet ) );
+
+      return static_cast<unsigned>( bufferSets_.size() - 1 );
+   }
+
+   void CompressedVectorWriterImpl::useBufferSet( unsigned bufferSet )
+   {
+      waitForAsyncWrites();
+
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( bufferSet >= bufferSets_.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "bufferSet=" + toString( bufferSet ) +
+                                  " bufferSetCount=" + toString( bufferSets_.size() ) );
+      }
+
+      BufferSet &set = bufferSets_[bufferSet];
+
+      // Same size, so this only assigns the pointers
+      sbufs_ = set.buffers;
+
+      for ( size_t i = 0; i < bytestreams_.size(); ++i )
+      {
+         bytestreams_[i]->sourceBufferSetNew( set.bytestreamBuffers[i] );
+      }
+
+      // The handler was set up for the old buffers
+      recordsWrittenHandler_ = nullptr;
+   }
+
+   std::vector<std::shared_ptr<Encoder>> CompressedVectorWriterImpl::makeEncoders(
+      std::vector<SourceDestBuffer> &sbufs )
+   {
+      std::vector<std::shared_ptr<Encoder>> encoders;
+
+      for ( unsigned i = 0; i < sbufs.size(); i++ )
+      {
+         // Create vector of single sbuf  ??? for now, may have groups later
+         std::vector<SourceDestBuffer> vTemp;
+         vTemp.push_back( sbufs.at( i ) );
+
+         ustring codecPath = sbufs.at( i ).pathName();
+
+         // Calc which stream the given path belongs to.  This depends on position
+         // of the node in the proto tree.
+         NodeImplSharedPtr readNode = proto_->get( sbufs.at( i ).pathName() );
+         uint64_t bytestreamNumber = 0;
+         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "sbufIndex=" + toString( i ) );
+         }
+
+         // EncoderFactory picks the appropriate encoder to match type declared in
+         // prototype
+         encoders.push_back( Encoder::EncoderFactory( static_cast<unsigned>( bytestreamNumber ),
+                                                      cVector_, vTemp, codecPath,
+                                                      encoderBufferSize_ ) );
+      }
+
+      // The encoders vector must be ordered by bytestreamNumber, not by order
+      // called specified sbufs, so sort it.
+      sort( encoders.begin(), encoders.end(), SortByBytestreamNumber() );
+#if ( E57_VALIDATION_LEVEL == VALIDATION_DEEP )
+      // Double check that all bytestreams are specified
+      for ( unsigned i = 0; i < encoders.size(); i++ )
+      {
+         if ( encoders.at( i )->bytestreamNumber() != i )
+         {
+            throw E57_EXCEPTION2( ErrorInternal,
+                                  "bytestreamIndex=" + toString( i ) + " bytestreamNumber=" +
+                                     toString( encoders.at( i )->bytestreamNumber() ) );
+         }
+      }
+#endif
+
+      return encoders;
    }
 
    void CompressedVectorWriterImpl::write( std::vector<SourceDestBuffer> &sbufs,
                                            const size_t requestedRecordCount )
    {
-      // don't checkImageFileOpen, write(unsigned) will do it
-      // don't checkWriterOpen(), write(unsigned) will do it
+      waitForAsyncWrites();
 
-      setBuffers( sbufs );
-      write( requestedRecordCount );
+      writeNext( sbufs, requestedRecordCount );
    }
 
    void CompressedVectorWriterImpl::write( const size_t requestedRecordCount )
+   {
+      waitForAsyncWrites();
+
+      writeNext( requestedRecordCount );
+   }
+
+   std::future<void> CompressedVectorWriterImpl::writeAsync( std::vector<SourceDestBuffer> &sbufs,
+                                                             const size_t requestedRecordCount )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkWriterOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Forget the writes which are done, their results are in the caller's futures
+      while ( !asyncWrites_.empty() &&
+              ( asyncWrites_.front().wait_for( std::chrono::seconds( 0 ) ) ==
+                std::future_status::ready ) )
+      {
+         asyncWrites_.pop_front();
+      }
+
+      if ( asyncPool_ == nullptr )
+      {
+         asyncPool_.reset( new ThreadPool( 1 ) );
+      }
+
+      auto result = std::make_shared<std::promise<void>>();
+      std::future<void> future = result->get_future();
+
+      asyncWrites_.push_back(
+         asyncPool_->submit( [this, sbufs, requestedRecordCount, result]() mutable {
+            try
+            {
+               writeNext( sbufs, requestedRecordCount );
+               result->set_value();
+            }
+            catch ( ... )
+            {
+               result->set_exception( std::current_exception() );
+            }
+         } ) );
+
+      return future;
+   }
+
+   /// Wait for the writes started by writeAsync() to finish. Their errors have already been
+   /// passed to their futures.
+   void CompressedVectorWriterImpl::waitForAsyncWrites()
+   {
+      for ( auto &asyncWrite : asyncWrites_ )
+      {
+         asyncWrite.wait();
+      }
+
+      asyncWrites_.clear();
+   }
+
+   void CompressedVectorWriterImpl::writeNext( std::vector<SourceDestBuffer> &sbufs,
+                                               const size_t requestedRecordCount )
+   {
+      // don't checkImageFileOpen, writeNext(size_t) will do it
+      // don't checkWriterOpen(), writeNext(size_t) will do it
+
+      setBuffers( sbufs );
+
+      // The handler was set up for the old buffers
+      recordsWrittenHandler_ = nullptr;
+
+      writeNext( requestedRecordCount );
+   }
+
+   void CompressedVectorWriterImpl::writeNext( const size_t requestedRecordCount )
    {
 #ifdef E57_VERBOSE
       std::cout << "CompressedVectorWriterImpl::write() called" << std::endl; //???
@@ -300,16 +1298,62 @@ namespace e57
                                   " cvPathName=" + cVector_->pathName() );
       }
 
-      // Rewind all sbufs so start reading from beginning
-      for ( auto &sbuf : sbufs_ )
-      {
-         sbuf.impl()->rewind();
-      }
+      // Rewind all sbufs so start reading from beginning
+      for ( auto &sbuf : sbufs_ )
+      {
+         sbuf.impl()->rewind();
+      }
+
+      // Loop until all channels have completed requestedRecordCount transfers
+      uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
+      while ( true )
+      {
+         // When every bytestream has reached the end of the current chunk, write out everything
+         // before it so the next chunk starts in a new data packet. The chunk ends on a word
+         // boundary in every bitpacked bytestream, but encoders which gather records (e.g. into
+         // runs) are flushed so the next chunk can be decoded on its own.
+         if ( nextChunkRecordIndex_ < endRecordIndex )
+         {
+            bool chunkComplete = true;
+            for ( auto &bytestream : bytestreams_ )
+            {
+               if ( bytestream->currentRecordIndex() != nextChunkRecordIndex_ )
+               {
+                  chunkComplete = false;
+                  break;
+               }
+            }
+
+            if ( chunkComplete )
+            {
+               flush();
+               while ( totalOutputAvailable() > 0 )
+               {
+                  packetWrite();
+                  flush();
+               }
+
+               chunkStartRecordIndex_ = nextChunkRecordIndex_;
+               chunkStartPending_ = true;
+
+               nextChunkRecordIndex_ += recordsPerChunk_;
+            }
+         }
+
+         // At the start of a chunk with at least two whole chunks to go, encode the whole ones
+         // at the same time
+         if ( encodePool_ != nullptr && chunkStartPending_ && totalOutputAvailable() == 0 )
+         {
+            const uint64_t chunkCount =
+               ( endRecordIndex - chunkStartRecordIndex_ ) / recordsPerChunk_;
+
+            if ( chunkCount >= 2 && canWriteChunksInParallel() )
+            {
+               writeChunksInParallel( chunkCount );
+               continue;
+            }
+         }
 
-      // Loop until all channels have completed requestedRecordCount transfers
-      uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
-      while ( true )
-      {
          // Calc remaining record counts for all channels
          uint64_t totalRecordCount = 0;
          for ( auto &bytestream : bytestreams_ )
@@ -339,14 +1383,8 @@ namespace e57
          std::cout << "  currentPacketSize()=" << currentPacketSize() << std::endl; //???
 #endif
 
-#ifdef E57_WRITE_CRAZY_PACKET_MODE
-         //??? depends on number of streams
-         constexpr size_t E57_TARGET_PACKET_SIZE = 500;
-#else
-         constexpr size_t E57_TARGET_PACKET_SIZE = ( DATA_PACKET_MAX * 3 / 4 );
-#endif
          // If have more than target fraction of packet, send it now
-         if ( currentPacketSize() >= E57_TARGET_PACKET_SIZE )
+         if ( currentPacketSize() >= packetFillTarget_ )
          { //???
             packetWrite();
             continue; // restart loop so recalc statistics (packet size may not be
@@ -373,219 +1411,276 @@ namespace e57
          // Process channels that are furthest behind first. ???
 
          // !!!! For now just process one record per loop until packet is full
-         // enough, or completed request
+         // enough, or completed request. Don't go past the end of the current chunk.
+         const uint64_t chunkEndRecordIndex = std::min( endRecordIndex, nextChunkRecordIndex_ );
+
+         if ( encodePool_ != nullptr )
+         {
+            encodeInParallel( chunkEndRecordIndex );
+            continue;
+         }
+
          for ( auto &bytestream : bytestreams_ )
          {
-            if ( bytestream->currentRecordIndex() < endRecordIndex )
+            if ( bytestream->currentRecordIndex() < chunkEndRecordIndex )
             {
-               // !!! For now, process up to 50 records at a time
-               uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
-               recordCount =
-                  ( recordCount < 50ULL ) ? recordCount : 50ULL; // min(recordCount, 50ULL);
+               // !!! For now, process up to 64 records at a time. This is a multiple of every
+               // register size, so integer encoders can keep packing whole blocks.
+               uint64_t recordCount = chunkEndRecordIndex - bytestream->currentRecordIndex();
+               recordCount = std::min<uint64_t>( recordCount, 64 );
                bytestream->processRecords( static_cast<unsigned>( recordCount ) );
             }
          }
       }
 
+      // Only records which have been encoded count, so a write which throws (e.g. on a value out
+      // of range) doesn't leave them in the bounds
+      if ( recordsWrittenHandler_ && ( requestedRecordCount > 0 ) )
+      {
+         recordsWrittenHandler_( requestedRecordCount );
+      }
+
       recordCount_ += requestedRecordCount;
 
       // When we leave this function, will likely still have data in channel
       // ioBuffers as well as partial words in Encoder registers.
    }
 
-   size_t CompressedVectorWriterImpl::totalOutputAvailable() const
+   void CompressedVectorWriterImpl::encodeInParallel( uint64_t endRecordIndex )
    {
-      size_t total = 0;
+      // Encode about enough records to fill the rest of the packet in one go, so each thread
+      // has a worthwhile amount of work
+      float totalBitsPerRecord = 0;
+      for ( auto &bytestream : bytestreams_ )
+      {
+         totalBitsPerRecord += bytestream->bitsPerRecord();
+      }
 
-      for ( const auto &bytestream : bytestreams_ )
+      const float totalBytesPerRecord = std::max( totalBitsPerRecord / 8, 0.1F );
+      const size_t packetSize = currentPacketSize();
+      const size_t spaceLeft =
+         ( packetSize < packetFillTarget_ ) ? packetFillTarget_ - packetSize : 0;
+      const uint64_t batchRecordCount =
+         std::max( static_cast<uint64_t>( static_cast<float>( spaceLeft ) / totalBytesPerRecord ),
+                   PARALLEL_MIN_RECORD_COUNT );
+
+      std::vector<Encoder *> encoders;
+      for ( auto &bytestream : bytestreams_ )
       {
-         total += bytestream->outputAvailable();
+         if ( bytestream->currentRecordIndex() < endRecordIndex )
+         {
+            encoders.push_back( bytestream.get() );
+         }
       }
 
-      return total;
-   }
+      // Each encoder has its own source buffer and output buffer, so they don't share anything.
+      // Any which fill their output buffer stop early, and the packet is written before the
+      // next batch.
+      auto encode = [&]( size_t i ) {
+         Encoder *encoder = encoders[i];
+         const uint64_t recordCount =
+            std::min( endRecordIndex - encoder->currentRecordIndex(), batchRecordCount );
 
-   size_t CompressedVectorWriterImpl::currentPacketSize() const
-   {
-      // Calc current packet size
-      return ( sizeof( DataPacketHeader ) + bytestreams_.size() * sizeof( uint16_t ) +
-               totalOutputAvailable() );
+         encoder->processRecords( static_cast<size_t>( recordCount ) );
+      };
+
+      if ( encoders.size() > 1 )
+      {
+         encodePool_->parallelFor( encoders.size(), encode );
+      }
+      else if ( encoders.size() == 1 )
+      {
+         encode( 0 );
+      }
    }
 
-   uint64_t CompressedVectorWriterImpl::packetWrite()
+   bool CompressedVectorWriterImpl::canWriteChunksInParallel() const
    {
-#ifdef E57_VERBOSE
-      std::cout << "CompressedVectorWriterImpl::packetWrite() called" << std::endl; //???
-#endif
+      // String buffers can't be split up, and every bytestream must be at the start of the
+      // chunk with nothing left in its register
+      for ( auto &sbuf : sbufs_ )
+      {
+         if ( sbuf.impl()->memoryRepresentation() == UString )
+         {
+            return false;
+         }
+      }
 
-      // Double check that we have work to do
-      const size_t cTotalOutput = totalOutputAvailable();
-      if ( cTotalOutput == 0 )
+      for ( auto &bytestream : bytestreams_ )
       {
-         return ( 0 );
+         if ( bytestream->currentRecordIndex() != chunkStartRecordIndex_ )
+         {
+            return false;
+         }
       }
 
-      // const bytestreams_ so it's clear it isn't modified in this function
-      const auto &cStreams = bytestreams_;
-      const auto cNumByteStreams = cStreams.size();
+      // Under a memory budget, there must be room for at least one chunk at a time
+      const uint64_t budget = imf_->memoryBudget();
 
-      // Calc maximum number of bytestream values can put in data packet.
-      const size_t cPacketMaxPayloadBytes =
-         DATA_PACKET_MAX - sizeof( DataPacketHeader ) - cNumByteStreams * sizeof( uint16_t );
+      return ( budget == 0 ) || ( budget / 2 >= chunkMemorySize() );
+   }
 
-#ifdef E57_VERBOSE
-      std::cout << "  totalOutput=" << totalOutput << std::endl;
-      std::cout << "  cNumByteStreams=" << cNumByteStreams << std::endl;
-      std::cout << "  packetMaxPayloadBytes=" << packetMaxPayloadBytes << std::endl;
-#endif
+   /// @returns the bytes held for each chunk encoded by writeChunksInParallel(): its encoders'
+   /// output buffers, and its packets
+   uint64_t CompressedVectorWriterImpl::chunkMemorySize() const
+   {
+      return _outputMaxSize( bytestreams_ ) + CHUNK_TARGET_SIZE + DATA_PACKET_MAX;
+   }
 
-      // Allocate vector for number of bytes that each bytestream will write to file.
-      std::vector<size_t> count( cNumByteStreams );
+   void CompressedVectorWriterImpl::writeChunksInParallel( uint64_t chunkCount )
+   {
+      const ImageFile imf = Node( cVector_ ).destImageFile();
 
-      // See if we can fit into a single data packet
-      if ( cTotalOutput < cPacketMaxPayloadBytes )
+      // Enough chunks at a time to keep every thread busy, without holding on to too many
+      // encoded packets. Under a memory budget, they share the half of it the writer's own
+      // encoders don't take.
+      uint64_t batchChunkCount = ( encodePool_->threadCount() + 1 ) * 4;
+      const uint64_t firstRecordIndex = chunkStartRecordIndex_;
+
+      const uint64_t chunkMemory = chunkMemorySize();
+      MemoryUsage *memoryUsage = imf_->memoryUsageCounters();
+
+      if ( const uint64_t budget = imf_->memoryBudget() )
       {
-         // We can fit everything in one packet
-         for ( unsigned i = 0; i < cNumByteStreams; ++i )
-         {
-            count.at( i ) = cStreams.at( i )->outputAvailable();
-         }
+         batchChunkCount = std::max<uint64_t>(
+            std::min<uint64_t>( batchChunkCount, budget / 2 / chunkMemory ), 1 );
       }
-      else
+
+      for ( uint64_t firstChunk = 0; firstChunk < chunkCount; firstChunk += batchChunkCount )
       {
-         // We have too much data for one packet.  Send proportional amounts from
-         // each bytestream. Adjust packetMaxPayloadBytes down by one so have a
-         // little slack for floating point weirdness.
-         const float cFractionToSend =
-            ( cPacketMaxPayloadBytes - 1 ) / static_cast<float>( cTotalOutput );
-         for ( unsigned i = 0; i < cNumByteStreams; ++i )
+         const auto batchCount =
+            static_cast<size_t>( std::min( chunkCount - firstChunk, batchChunkCount ) );
+
+         // Looking up the nodes isn't thread safe, so the encoders are made here
+         std::vector<std::vector<std::shared_ptr<Encoder>>> encoders( batchCount );
+         std::vector<EncodedChunk> chunks( batchCount );
+
+         const MemoryReservation batchMemory( memoryUsage, batchCount * chunkMemory );
+
+         for ( size_t i = 0; i < batchCount; ++i )
          {
-            // Round down here so sum <= packetMaxPayloadBytes
-            count.at( i ) = static_cast<unsigned>(
-               std::floor( cFractionToSend * cStreams.at( i )->outputAvailable() ) );
+            chunks[i].firstRecordIndex = firstRecordIndex + ( firstChunk + i ) * recordsPerChunk_;
+
+            // The buffers hold the records from recordCount_ on
+            std::vector<SourceDestBuffer> sbufs;
+            for ( auto &sbuf : sbufs_ )
+            {
+               sbufs.push_back(
+                  _sliceBuffer( imf, sbuf, chunks[i].firstRecordIndex - recordCount_,
+                                recordsPerChunk_ ) );
+            }
+
+            encoders[i] = makeEncoders( sbufs );
          }
-      }
 
-#ifdef E57_VERBOSE
-      for ( unsigned i = 0; i < cNumByteStreams; ++i )
-      {
-         std::cout << "  count[" << i << "]=" << count.at( i ) << std::endl;
-      }
-#endif
+         encodePool_->parallelFor( batchCount, [&]( size_t i ) {
+            _encodeChunk( encoders[i], recordsPerChunk_, packetFillTarget_, packetPacking_,
+                          deflateLevel_, chunks[i] );
+         } );
 
-#if VALIDATE_BASIC
-      // Double check sum of count is <= packetMaxPayloadBytes
-      const size_t cTotalByteCount =
-         std::accumulate( count.begin(), count.end(), static_cast<size_t>( 0 ) );
+         // Write them out in order, each starting a chunk
+         for ( const auto &chunk : chunks )
+         {
+            chunkStartRecordIndex_ = chunk.firstRecordIndex;
+            chunkStartPending_ = true;
 
-      if ( cTotalByteCount > cPacketMaxPayloadBytes )
+            const char *packet = chunk.packets.data();
+            for ( const unsigned packetLength : chunk.packetLengths )
+            {
+               writePacket( packet, packetLength );
+               packet += packetLength;
+            }
+         }
+      }
+
+      // Carry on after them with the writer's own encoders
+      const uint64_t recordCount = chunkCount * recordsPerChunk_;
+      for ( auto &bytestream : bytestreams_ )
       {
-         throw E57_EXCEPTION2( ErrorInternal,
-                               "totalByteCount=" + toString( cTotalByteCount ) +
-                                  " packetMaxPayloadBytes=" + toString( cPacketMaxPayloadBytes ) );
+         bytestream->skipRecords( static_cast<size_t>( recordCount ) );
       }
-#endif
 
-      // Get smart pointer to ImageFileImpl from associated CompressedVector
-      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+      chunkStartRecordIndex_ = firstRecordIndex + recordCount;
+      chunkStartPending_ = true;
+      nextChunkRecordIndex_ = chunkStartRecordIndex_ + recordsPerChunk_;
+   }
 
-      // Use temp buf in object (is 64KBytes long) instead of allocating each time here
-      char *packet = reinterpret_cast<char *>( &dataPacket_ );
+   size_t CompressedVectorWriterImpl::totalOutputAvailable() const
+   {
+      return _outputAvailable( bytestreams_ );
+   }
 
-      // To be safe, clear header part of packet
-      dataPacket_.header.reset();
+   size_t CompressedVectorWriterImpl::currentPacketSize() const
+   {
+      return _packetSize( bytestreams_ );
+   }
 
-      // Write bytestreamBufferLength[bytestreamCount] after header, in dataPacket_
-      auto bsbLength = reinterpret_cast<uint16_t *>( &packet[sizeof( DataPacketHeader )] );
+   uint64_t CompressedVectorWriterImpl::packetWrite()
+   {
 #ifdef E57_VERBOSE
-      std::cout << "  packet=" << static_cast<void *>( packet ) << std::endl; //???
-      std::cout << "  bsbLength=" << bsbLength << std::endl;                  //???
+      std::cout << "CompressedVectorWriterImpl::packetWrite() called" << std::endl; //???
 #endif
-      for ( unsigned i = 0; i < cNumByteStreams; ++i )
+
+      // Double check that we have work to do
+      const size_t cTotalOutput = totalOutputAvailable();
+      if ( cTotalOutput == 0 )
       {
-         bsbLength[i] = static_cast<uint16_t>( count.at( i ) ); // %%% Truncation
-#ifdef E57_VERBOSE
-         std::cout << "  Writing " << bsbLength[i] << " bytes into bytestream " << i
-                   << std::endl; //???
-#endif
+         return ( 0 );
       }
 
-      // Get pointer to end of data so far
-      auto *p = reinterpret_cast<char *>( &bsbLength[cNumByteStreams] );
-#ifdef E57_VERBOSE
-      std::cout << "  after bsbLength, p=" << static_cast<void *>( p ) << std::endl; //???
-#endif
+      unsigned packetLength = _fillDataPacket( bytestreams_, packetPacking_, dataPacket_ );
+      const char *packet = reinterpret_cast<const char *>( &dataPacket_ );
 
-      // Write contents of each bytestream in dataPacket_
-      for ( size_t i = 0; i < cNumByteStreams; ++i )
+      // Write the deflated packet instead if it is shorter
+      if ( deflatedPacket_ )
       {
-         size_t n = count.at( i );
+         const unsigned deflatedLength =
+            dataPacket_.deflate( packetLength, deflateLevel_, *deflatedPacket_ );
 
-#if VALIDATE_BASIC
-         // Double check we aren't accidentally going to write off end of vector<char>
-         if ( &p[n] > &packet[DATA_PACKET_MAX] )
+         if ( deflatedLength > 0 )
          {
-            throw E57_EXCEPTION2( ErrorInternal, "n=" + toString( n ) );
+            packet = reinterpret_cast<const char *>( deflatedPacket_.get() );
+            packetLength = deflatedLength;
          }
-#endif
-
-         // Read from encoder output into packet
-         cStreams.at( i )->outputRead( p, n );
-
-         // Move pointer to end of current data
-         p += n;
       }
 
-      // Length of packet is difference in beginning pointer and ending pointer
-      auto packetLength = static_cast<unsigned>( p - packet ); //??? pointer diff portable?
-#ifdef E57_VERBOSE
-      std::cout << "  packetLength=" << packetLength << std::endl; //???
-#endif
+      return writePacket( packet, packetLength );
+   }
 
-#if VALIDATE_BASIC
-      // Double check that packetLength is what we expect
-      if ( packetLength !=
-           sizeof( DataPacketHeader ) + cNumByteStreams * sizeof( uint16_t ) + cTotalByteCount )
+   uint64_t CompressedVectorWriterImpl::writePacket( const char *packet, unsigned packetLength )
+   {
+      E57_TRACE_SPAN( imf_->tracer(), "writePacket" );
+      E57_TRACE_BYTES( packetLength );
+
+      // Copy the packets held back into the file as soon as we have the end of it
+      if ( spool_ && imf_->claimFileEnd( this ) )
       {
-         throw E57_EXCEPTION2( ErrorInternal, "packetLength=" + toString( packetLength ) +
-                                                 " bytestreamSize=" +
-                                                 toString( cNumByteStreams * sizeof( uint16_t ) ) +
-                                                 " totalByteCount=" + toString( cTotalByteCount ) );
+         placeSpool();
       }
-#endif
 
-      // packetLength must be multiple of 4, if not, add some zero padding
-      while ( packetLength % 4 )
+      if ( spool_ )
       {
-         // Double check we aren't accidentally going to write off end of
-         // vector<char>
-         if ( p >= &packet[DATA_PACKET_MAX - 1] )
+         // Until then, the index entries are offsets in the spool
+         const uint64_t spoolOffset = spool_->size();
+         spool_->append( packet, packetLength );
+
+         dataPacketsCount_++;
+
+         if ( chunkStartPending_ )
          {
-            throw E57_EXCEPTION1( ErrorInternal );
+            chunkIndex_.push_back( { chunkStartRecordIndex_, spoolOffset } );
+            chunkStartPending_ = false;
          }
-         *p++ = 0;
-         packetLength++;
-#ifdef E57_VERBOSE
-         std::cout << "  padding with zero byte, new packetLength=" << packetLength
-                   << std::endl; //???
-#endif
-      }
-
-      // Prepare header in dataPacket_, now that we are sure of packetLength
-      dataPacket_.header.packetLogicalLengthMinus1 =
-         static_cast<uint16_t>( packetLength - 1 ); // %%% Truncation
-      dataPacket_.header.bytestreamCount =
-         static_cast<uint16_t>( cNumByteStreams ); // %%% Truncation
 
-      // Double check that data packet is well formed
-      dataPacket_.verify( packetLength );
+         return 0;
+      }
 
       // Write whole data packet at beginning of free space in file
-      uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
-      uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
-      imf->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
+      uint64_t packetLogicalOffset = imf_->allocateSpace( packetLength, false );
+      uint64_t packetPhysicalOffset = imf_->file_->logicalToPhysical( packetLogicalOffset );
+      imf_->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
                                                // more explicit
-      imf->file_->write( packet, packetLength );
+      imf_->file_->write( packet, packetLength );
 
 #ifdef E57_VERBOSE
 //  std::cout << "data packet:" << std::endl;
@@ -604,7 +1699,12 @@ namespace e57
       }
       dataPacketsCount_++;
 
-      // !!! update seekIndex here? if started new chunk?
+      // Add the packet to the index if it starts a chunk
+      if ( chunkStartPending_ )
+      {
+         chunkIndex_.push_back( { chunkStartRecordIndex_, packetPhysicalOffset } );
+         chunkStartPending_ = false;
+      }
 
       // Return physical offset of data packet for potential use in seekIndex
       return ( packetPhysicalOffset ); //??? needed
@@ -612,9 +1712,131 @@ namespace e57
 
    void CompressedVectorWriterImpl::flush()
    {
-      for ( auto &bytestream : bytestreams_ )
+      _flush( bytestreams_ );
+   }
+
+   uint64_t CompressedVectorWriterImpl::writeIndexPackets(
+      ImageFileImpl &imf, const std::vector<IndexPacket::IndexPacketEntry> &chunkIndex,
+      uint64_t &indexPacketsCount )
+   {
+      // With a single chunk the index would only point to the first data packet, which the
+      // section header already does, so readers seek from there without one.
+      if ( chunkIndex.size() < 2 )
+      {
+         return 0;
+      }
+
+      // Write a level of index packets pointing to the chunks, then levels pointing to the
+      // packets of the level below until a single packet covers everything.
+      std::vector<IndexPacket::IndexPacketEntry> entries = chunkIndex;
+      uint8_t indexLevel = 0;
+
+      while ( !entries.empty() )
+      {
+         std::vector<IndexPacket::IndexPacketEntry> parentEntries;
+
+         for ( size_t first = 0; first < entries.size(); first += IndexPacket::MAX_ENTRIES )
+         {
+            const size_t entryCount =
+               std::min<size_t>( entries.size() - first, IndexPacket::MAX_ENTRIES );
+
+            // Zero-filled, so the unused entries are the padding
+            std::unique_ptr<IndexPacket> packet( new IndexPacket );
+
+            // Always write full-size packets since older versions of this library reject
+            // shorter ones.
+            constexpr unsigned packetLength = sizeof( IndexPacket );
+
+            packet->packetLogicalLengthMinus1 = static_cast<uint16_t>( packetLength - 1 );
+            packet->entryCount = static_cast<uint16_t>( entryCount );
+            packet->indexLevel = indexLevel;
+
+            std::copy( entries.begin() + first, entries.begin() + first + entryCount,
+                       packet->entries );
+
+            // Double check that index packet is well formed
+            packet->verify( packetLength, 0, 0, imf.validationLevel() );
+
+            uint64_t packetLogicalOffset = imf.allocateSpace( packetLength, false );
+            uint64_t packetPhysicalOffset = imf.file_->logicalToPhysical( packetLogicalOffset );
+            imf.file_->seek( packetLogicalOffset );
+            imf.file_->write( reinterpret_cast<char *>( packet.get() ), packetLength );
+
+            indexPacketsCount++;
+
+            parentEntries.push_back( { entries.at( first ).chunkRecordNumber,
+                                       packetPhysicalOffset } );
+         }
+
+         if ( parentEntries.size() == 1 )
+         {
+            return parentEntries.front().chunkPhysicalOffset;
+         }
+
+         entries = std::move( parentEntries );
+         ++indexLevel;
+      }
+
+      return 0;
+   }
+
+   uint64_t CompressedVectorWriterImpl::writeSectionHeader( ImageFileImpl &imf,
+                                                            uint64_t sectionHeaderLogicalStart,
+                                                            uint64_t dataPhysicalOffset,
+                                                            uint64_t indexPhysicalOffset )
+   {
+      // Compute length of whole section we just wrote (from section start to
+      // current start of free space).
+      const uint64_t sectionLogicalLength = imf.unusedLogicalStart_ - sectionHeaderLogicalStart;
+#ifdef E57_VERBOSE
+      std::cout << "  sectionLogicalLength=" << sectionLogicalLength << std::endl; //???
+#endif
+
+      // Prepare CompressedVectorSectionHeader
+      CompressedVectorSectionHeader header;
+      header.sectionLogicalLength = sectionLogicalLength;
+      header.dataPhysicalOffset =
+         dataPhysicalOffset; //??? can be zero, if no data written ???not set yet
+      header.indexPhysicalOffset =
+         indexPhysicalOffset; //??? can be zero, if no data written ???not set
+                              // yet
+#ifdef E57_VERBOSE
+      std::cout << "  CompressedVectorSectionHeader:" << std::endl;
+      header.dump( 4 ); //???
+#endif
+
+#if VALIDATE_BASIC
+      // Verify OK before write it.
+      header.verify( imf.file_->length( CheckedFile::Physical ) );
+#endif
+
+      // Write header at beginning of section, previously allocated
+      imf.file_->seek( sectionHeaderLogicalStart );
+      imf.file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+      return sectionLogicalLength;
+   }
+
+   void CompressedVectorWriterImpl::copySpool(
+      ImageFileImpl &imf, PacketSpool &spool,
+      std::vector<IndexPacket::IndexPacketEntry> &chunkIndex, uint64_t &sectionHeaderLogicalStart )
+   {
+      sectionHeaderLogicalStart =
+         imf.allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+
+      // The packets go one after the other, just as they would have been written
+      const uint64_t dataLogicalStart = imf.allocateSpace( spool.size(), false );
+
+      imf.file_->seek( dataLogicalStart );
+      spool.readBack( [&imf]( const char *data, size_t length ) {
+         imf.file_->write( data, length );
+      } );
+
+      // The index entries held the packets' offsets in the spool
+      for ( auto &entry : chunkIndex )
       {
-         bytestream->registerFlushToOutput();
+         entry.chunkPhysicalOffset =
+            imf.file_->logicalToPhysical( dataLogicalStart + entry.chunkPhysicalOffset );
       }
    }
 
@@ -683,6 +1905,8 @@ namespace e57
       os << space( indent ) << "recordCount:               " << recordCount_ << std::endl;
       os << space( indent ) << "dataPacketsCount:          " << dataPacketsCount_ << std::endl;
       os << space( indent ) << "indexPacketsCount:         " << indexPacketsCount_ << std::endl;
+      os << space( indent ) << "recordsPerChunk:           " << recordsPerChunk_ << std::endl;
+      os << space( indent ) << "chunkCount:                " << chunkIndex_.size() << std::endl;
    }
 #endif
 }
@@ -26,24 +26,65 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+
 #include "Encoder.h"
+#include "MemoryUsage.h"
 #include "Packet.h"
 
 namespace e57
 {
+   class PacketSpool;
+   class ThreadPool;
+
    class CompressedVectorWriterImpl
    {
    public:
       CompressedVectorWriterImpl( std::shared_ptr<CompressedVectorNodeImpl> ni,
                                   std::vector<SourceDestBuffer> &sbufs );
+
+      /// Open a writer without any buffers, which is only given whole data packets by
+      /// copyPackets()
+      explicit CompressedVectorWriterImpl( std::shared_ptr<CompressedVectorNodeImpl> ni );
       ~CompressedVectorWriterImpl();
 
       void write( size_t requestedRecordCount );
       void write( std::vector<SourceDestBuffer> &sbufs, size_t requestedRecordCount );
+      std::future<void> writeAsync( std::vector<SourceDestBuffer> &sbufs,
+                                    size_t requestedRecordCount );
+
+      /// Check a set of buffers once, to be switched to with useBufferSet() without checking
+      /// them again
+      /// @returns its number (counting from 0)
+      unsigned addBufferSet( std::vector<SourceDestBuffer> &sbufs );
+      void useBufferSet( unsigned bufferSet );
+
+      /// Write the data packets of source (whose prototype and codecs must match ours) as they
+      /// are, and an index pointing to the same records as its index
+      void copyPackets( const CompressedVectorNodeImpl &source );
+
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
+
+      /// An open writer either has the end of the file or holds its data packets back until it
+      /// gets it (see ImageFileImpl::claimFileEnd())
+      bool holdsFileEnd() const;
+      bool isSpooling() const;
       void close();
 
+      /// Called by write() with the number of records it has encoded from the buffers, and by
+      /// close() once they have all been written. Used by the Simple API to gather statistics
+      /// about the records while they are in cache.
+      using RecordsWrittenHandler = std::function<void( size_t recordCount )>;
+      using ClosedHandler = std::function<void()>;
+
+      /// Add handlers, called after those added before. Either may be empty. The records handlers
+      /// are cleared when write() is given other buffers.
+      void addHandlers( const RecordsWrittenHandler &recordsWritten, const ClosedHandler &closed );
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout );
 #endif
@@ -53,18 +94,74 @@ namespace e57
                                const char *srcFunctionName ) const;
       void checkWriterOpen( const char *srcFileName, int srcLineNumber,
                             const char *srcFunctionName ) const;
+      void open();
+      void waitForAsyncWrites();
+      void writeNext( std::vector<SourceDestBuffer> &sbufs, size_t requestedRecordCount );
+      void writeNext( size_t requestedRecordCount );
       void setBuffers( std::vector<SourceDestBuffer> &sbufs ); //???needed?
+      void checkBuffersCompatible( const std::vector<SourceDestBuffer> &sbufs ) const;
+      void bindEncoders();
+      std::vector<std::shared_ptr<Encoder>> makeEncoders( std::vector<SourceDestBuffer> &sbufs );
+      void encodeInParallel( uint64_t endRecordIndex );
+      bool canWriteChunksInParallel() const;
+      uint64_t chunkMemorySize() const;
+      void writeChunksInParallel( uint64_t chunkCount );
       size_t totalOutputAvailable() const;
       size_t currentPacketSize() const;
       uint64_t packetWrite();
+      uint64_t writePacket( const char *packet, unsigned packetLength );
       void flush();
+      void placeSpool();
+      void queueSpooledSection();
+
+      /// @returns the physical offset of the top index packet (0 if there is at most one chunk)
+      static uint64_t
+         writeIndexPackets( ImageFileImpl &imf,
+                            const std::vector<IndexPacket::IndexPacketEntry> &chunkIndex,
+                            uint64_t &indexPacketsCount );
+
+      /// @returns the section's logical length
+      static uint64_t writeSectionHeader( ImageFileImpl &imf, uint64_t sectionHeaderLogicalStart,
+                                          uint64_t dataPhysicalOffset,
+                                          uint64_t indexPhysicalOffset );
+
+      /// Copy the packets held back in spool to the end of the file, after a new section header,
+      /// and turn the offsets in chunkIndex from the spool's into the file's
+      static void copySpool( ImageFileImpl &imf, PacketSpool &spool,
+                             std::vector<IndexPacket::IndexPacketEntry> &chunkIndex,
+                             uint64_t &sectionHeaderLogicalStart );
 
       std::vector<SourceDestBuffer> sbufs_;
+
+      /// The buffers registered by addBufferSet(). Each buffer is also kept on its own, in the
+      /// order of bytestreams_, as the encoders take them.
+      struct BufferSet
+      {
+         std::vector<SourceDestBuffer> buffers;
+         std::vector<std::vector<SourceDestBuffer>> bytestreamBuffers;
+      };
+      std::vector<BufferSet> bufferSets_;
+
+      /// Index in sbufs_ of the buffer each of bytestreams_ encodes
+      std::vector<size_t> bytestreamBuffers_;
+
       std::shared_ptr<CompressedVectorNodeImpl> cVector_;
+      ImageFileImplSharedPtr imf_; /// cVector_'s file, held so writes don't lock its weak pointer
       NodeImplSharedPtr proto_;
 
       std::vector<std::shared_ptr<Encoder>> bytestreams_;
       DataPacket dataPacket_;
+      ThreadPool *encodePool_; /// null if the bytestreams are encoded on the writing thread
+      size_t packetFillTarget_; /// a data packet is written once it has at least this much data
+      unsigned encoderBufferSize_; /// size of each encoder's output buffer
+      PacketPacking packetPacking_; /// how the bytestreams share a full data packet
+      MemoryReservation memory_;   /// counts the encoders and packets in the file's memory usage
+      int deflateLevel_; /// 0 unless the codecs ask for the data packets to be deflated
+      std::unique_ptr<DataPacket> deflatedPacket_; /// scratch packet if deflateLevel_ is set
+
+      /// Data packets held back while another writer has the end of the file, null once this
+      /// one has it. While there is one, the offsets in chunkIndex_ are the spool's.
+      std::shared_ptr<PacketSpool> spool_;
 
       bool isOpen_;
       uint64_t sectionHeaderLogicalStart_; /// start of CompressedVector binary section
@@ -74,5 +171,21 @@ namespace e57
       uint64_t recordCount_;               /// number of records written so far
       uint64_t dataPacketsCount_;          /// number of data packets written so far
       uint64_t indexPacketsCount_;         /// number of index packets written so far
+
+      uint64_t recordsPerChunk_;       /// number of records between index entries
+      uint64_t nextChunkRecordIndex_;  /// record the next chunk will start at
+      uint64_t chunkStartRecordIndex_; /// record the chunk started by the next data packet is at
+      bool chunkStartPending_;         /// true if the next data packet starts a chunk
+
+      /// first record and data packet of each chunk written so far
+      std::vector<IndexPacket::IndexPacketEntry> chunkIndex_;
+
+      RecordsWrittenHandler recordsWrittenHandler_; /// may be empty
+      ClosedHandler closedHandler_;                 /// may be empty
+
+      /// Thread running the writes started by writeAsync() one after the other, and their
+      /// results. Everything else waits for them to finish first.
+      std::unique_ptr<ThreadPool> asyncPool_;
+      std::deque<std::future<void>> asyncWrites_;
    };
 }
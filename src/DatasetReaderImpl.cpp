@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cctype>
+
+#if !defined( _WIN32 )
+#include <sys/stat.h>
+#endif
+
+#include "DatasetReaderImpl.h"
+#include "StringFunctions.h"
+#include "ThreadPool.h"
+
+namespace e57
+{
+   namespace
+   {
+      // The executor shared by the files of a DatasetReader which weren't given one
+      class PoolExecutor : public Executor
+      {
+      public:
+         explicit PoolExecutor( unsigned int threadCount ) : pool_( threadCount )
+         {
+         }
+
+         void submit( std::function<void()> task ) override
+         {
+            pool_.submit( std::move( task ) );
+         }
+
+         unsigned int concurrency() const override
+         {
+            return static_cast<unsigned int>( pool_.threadCount() );
+         }
+
+      private:
+         ThreadPool pool_;
+      };
+
+      // Identifies the device a file is on, 0 if it isn't known
+      uint64_t deviceOf( const ustring &path )
+      {
+#if defined( _WIN32 )
+         // Files are grouped by drive letter
+         if ( ( path.size() >= 2 ) && ( path[1] == ':' ) )
+         {
+            return static_cast<uint64_t>( std::toupper( static_cast<unsigned char>( path[0] ) ) );
+         }
+
+         return 0;
+#else
+         struct stat status;
+
+         if ( ::stat( path.c_str(), &status ) != 0 )
+         {
+            return 0;
+         }
+
+         return static_cast<uint64_t>( status.st_dev );
+#endif
+      }
+   }
+
+   DatasetReaderImpl::DatasetReaderImpl( const std::vector<ustring> &filePaths,
+                                         const DatasetOptions &options ) :
+      readerOptions_( options.readerOptions ), maxOpenFiles_( options.maxOpenFiles ),
+      readsPerDevice_( options.readsPerDevice )
+   {
+      if ( readsPerDevice_ == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "readsPerDevice=" + toString( options.readsPerDevice ) );
+      }
+
+      if ( !readerOptions_.executor &&
+           ( ( readerOptions_.checksumThreadCount != 1 ) ||
+             ( readerOptions_.decodeThreadCount != 1 ) ) )
+      {
+         executor_ = std::make_shared<PoolExecutor>( ThreadPool::defaultThreadCount( nullptr ) );
+         readerOptions_.executor = executor_;
+      }
+
+      if ( options.memoryBudget > 0 )
+      {
+         const uint64_t shares =
+            ( maxOpenFiles_ > 0 ) ? maxOpenFiles_ : std::max<uint64_t>( filePaths.size(), 1 );
+
+         // A budget of 0 would turn it off
+         readerOptions_.memoryBudget = std::max<uint64_t>( options.memoryBudget / shares, 1 );
+      }
+
+      files_.resize( filePaths.size() );
+
+      for ( size_t i = 0; i < filePaths.size(); ++i )
+      {
+         files_[i].path = filePaths[i];
+         files_[i].device = deviceOf( filePaths[i] );
+      }
+
+      const unsigned int threadCount = ( options.threadCount > 0 )
+                                          ? options.threadCount
+                                          : ThreadPool::defaultThreadCount( nullptr );
+
+      threads_.reserve( threadCount );
+
+      for ( unsigned int i = 0; i < threadCount; ++i )
+      {
+         threads_.emplace_back( &DatasetReaderImpl::workerLoop, this );
+      }
+   }
+
+   DatasetReaderImpl::~DatasetReaderImpl()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         stopping_ = true;
+      }
+
+      condition_.notify_all();
+
+      for ( auto &thread : threads_ )
+      {
+         thread.join();
+      }
+
+      // The promises of the requests which are left are broken as they are destroyed
+   }
+
+   size_t DatasetReaderImpl::fileCount() const
+   {
+      return files_.size();
+   }
+
+   ustring DatasetReaderImpl::filePath( size_t fileIndex ) const
+   {
+      checkFileIndex( fileIndex );
+
+      return files_[fileIndex].path;
+   }
+
+   size_t DatasetReaderImpl::openFileCount() const
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      return static_cast<size_t>(
+         std::count_if( files_.begin(), files_.end(),
+                        []( const File &file ) { return file.reader != nullptr; } ) );
+   }
+
+   std::shared_ptr<Reader> DatasetReaderImpl::reader( size_t fileIndex )
+   {
+      checkFileIndex( fileIndex );
+
+      File &file = files_[fileIndex];
+
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      condition_.wait( lock, [&file] { return !file.opening; } );
+
+      file.lastUsed = ++useCount_;
+
+      if ( file.reader )
+      {
+         return file.reader;
+      }
+
+      // Open it without holding the lock, so that other files can be used meanwhile
+      file.opening = true;
+      lock.unlock();
+
+      std::shared_ptr<Reader> reader;
+
+      try
+      {
+         reader = std::make_shared<Reader>( file.path, readerOptions_ );
+      }
+      catch ( ... )
+      {
+         lock.lock();
+         file.opening = false;
+         lock.unlock();
+
+         condition_.notify_all();
+
+         throw;
+      }
+
+      lock.lock();
+      file.reader = reader;
+      file.opening = false;
+
+      std::vector<std::shared_ptr<Reader>> closed = closeUnused();
+      lock.unlock();
+
+      condition_.notify_all();
+
+      return reader;
+   }
+
+   std::future<void> DatasetReaderImpl::submit( size_t fileIndex, DatasetReader::Task task,
+                                                int priority )
+   {
+      checkFileIndex( fileIndex );
+
+      Request request;
+      request.fileIndex = fileIndex;
+      request.priority = priority;
+      request.task = std::move( task );
+
+      std::future<void> future = request.promise.get_future();
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         request.sequence = requestCount_++;
+         requests_.push_back( std::move( request ) );
+      }
+
+      condition_.notify_all();
+
+      return future;
+   }
+
+   void DatasetReaderImpl::checkFileIndex( size_t fileIndex ) const
+   {
+      if ( fileIndex >= files_.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "fileIndex=" + toString( fileIndex ) +
+                                                       " fileCount=" + toString( files_.size() ) );
+      }
+   }
+
+   std::vector<std::shared_ptr<Reader>> DatasetReaderImpl::closeUnused()
+   {
+      std::vector<std::shared_ptr<Reader>> closed;
+
+      if ( maxOpenFiles_ == 0 )
+      {
+         return closed;
+      }
+
+      size_t openCount = static_cast<size_t>(
+         std::count_if( files_.begin(), files_.end(),
+                        []( const File &file ) { return file.reader != nullptr; } ) );
+
+      while ( openCount > maxOpenFiles_ )
+      {
+         File *leastRecent = nullptr;
+
+         // Copies of the Readers are only made while holding the lock, so one which is only held
+         // here can't be taken while it is closed
+         for ( File &file : files_ )
+         {
+            if ( file.reader && ( file.reader.use_count() == 1 ) &&
+                 ( ( leastRecent == nullptr ) || ( file.lastUsed < leastRecent->lastUsed ) ) )
+            {
+               leastRecent = &file;
+            }
+         }
+
+         // The rest are being read, and are closed later
+         if ( leastRecent == nullptr )
+         {
+            break;
+         }
+
+         closed.push_back( std::move( leastRecent->reader ) );
+         leastRecent->reader = nullptr;
+         --openCount;
+      }
+
+      return closed;
+   }
+
+   void DatasetReaderImpl::workerLoop()
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      while ( !stopping_ )
+      {
+         // The highest priority request whose device has room for it
+         auto next = requests_.end();
+
+         for ( auto request = requests_.begin(); request != requests_.end(); ++request )
+         {
+            const uint64_t device = files_[request->fileIndex].device;
+
+            if ( deviceReads_[device] >= readsPerDevice_ )
+            {
+               continue;
+            }
+
+            if ( ( next == requests_.end() ) || ( request->priority > next->priority ) ||
+                 ( ( request->priority == next->priority ) &&
+                   ( request->sequence < next->sequence ) ) )
+            {
+               next = request;
+            }
+         }
+
+         if ( next == requests_.end() )
+         {
+            condition_.wait( lock );
+            continue;
+         }
+
+         Request request = std::move( *next );
+         requests_.erase( next );
+
+         const uint64_t device = files_[request.fileIndex].device;
+         ++deviceReads_[device];
+
+         lock.unlock();
+
+         try
+         {
+            request.task( *reader( request.fileIndex ) );
+            request.promise.set_value();
+         }
+         catch ( ... )
+         {
+            request.promise.set_exception( std::current_exception() );
+         }
+
+         lock.lock();
+         --deviceReads_[device];
+
+         // Close what went over maxOpenFiles while it was being read
+         std::vector<std::shared_ptr<Reader>> closed = closeUnused();
+
+         lock.unlock();
+         closed.clear();
+         condition_.notify_all();
+         lock.lock();
+      }
+   }
+}
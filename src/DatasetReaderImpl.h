@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "Common.h"
+#include "E57SimpleReader.h"
+
+namespace e57
+{
+   /// @brief Behind DatasetReader: the files, the Readers of those which are open, and the
+   /// queue of reads with the threads running them.
+   class DatasetReaderImpl
+   {
+   public:
+      DatasetReaderImpl( const std::vector<ustring> &filePaths, const DatasetOptions &options );
+      ~DatasetReaderImpl();
+
+      DatasetReaderImpl( const DatasetReaderImpl & ) = delete;
+      DatasetReaderImpl &operator=( const DatasetReaderImpl & ) = delete;
+
+      size_t fileCount() const;
+      ustring filePath( size_t fileIndex ) const;
+      size_t openFileCount() const;
+
+      std::shared_ptr<Reader> reader( size_t fileIndex );
+
+      std::future<void> submit( size_t fileIndex, DatasetReader::Task task, int priority );
+
+   private:
+      struct File
+      {
+         ustring path;
+
+         /// Files with the same device share DatasetOptions::readsPerDevice
+         uint64_t device = 0;
+
+         std::shared_ptr<Reader> reader;
+
+         /// Set while a thread opens the file, so that others wait for it instead
+         bool opening = false;
+
+         /// Value of useCount_ when it was last used, to find the least recently used file
+         uint64_t lastUsed = 0;
+      };
+
+      struct Request
+      {
+         size_t fileIndex = 0;
+         int priority = 0;
+
+         /// Order in which it was submitted, to run those of the same priority in that order
+         uint64_t sequence = 0;
+
+         DatasetReader::Task task;
+         std::promise<void> promise;
+      };
+
+      void checkFileIndex( size_t fileIndex ) const;
+      /// @returns the Readers taken from the least recently used files, so that they can be
+      /// closed after unlocking mutex_
+      std::vector<std::shared_ptr<Reader>> closeUnused();
+      void workerLoop();
+
+      ReaderOptions readerOptions_;
+      unsigned int maxOpenFiles_;
+      unsigned int readsPerDevice_;
+
+      /// Runs the files' checksum and decode work if they don't have an executor of their own
+      std::shared_ptr<Executor> executor_;
+
+      mutable std::mutex mutex_;
+      std::condition_variable condition_;
+      std::vector<File> files_;
+      uint64_t useCount_ = 0;
+
+      std::vector<Request> requests_;
+      uint64_t requestCount_ = 0;
+
+      /// Reads running on each device
+      std::map<uint64_t, unsigned int> deviceReads_;
+
+      bool stopping_ = false;
+      std::vector<std::thread> threads_;
+   };
+}
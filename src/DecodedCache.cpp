@@ -0,0 +1,439 @@
+// SPDX-License-Identifier: MIT
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if defined( _WIN32 )
+#if !defined( NOMINMAX )
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "DecodedCache.h"
+#include "StringFunctions.h"
+
+namespace
+{
+   constexpr char DECODED_CACHE_SIGNATURE[8] = { 'E', '5', '7', 'D', 'C', 'O', 'L', '\0' };
+   constexpr uint32_t DECODED_CACHE_VERSION = 2;
+
+   // Each column starts on a multiple of this, so it can be read with aligned loads when mapped
+   constexpr uint64_t DECODED_CACHE_ALIGNMENT = 64;
+
+   // Start of a cache file. It is followed by the GUID of the E57 file, the columns, then the
+   // values of each column.
+   struct DecodedCacheHeader
+   {
+      char signature[8] = {};
+      uint32_t version = 0;
+      uint32_t columnCount = 0;
+      uint64_t fileLength = 0;
+      uint64_t fileModified = 0;
+      uint64_t sectionLogicalStart = 0;
+      uint64_t pointCount = 0;
+      uint32_t coordinateType = 0;
+      uint32_t flags = 0;
+      uint32_t guidLength = 0;
+      uint32_t xmlChecksum = 0;
+   };
+
+   static_assert( sizeof( DecodedCacheHeader ) == 64, "Unexpected DecodedCacheHeader size" );
+
+   struct DecodedCacheColumn
+   {
+      char name[32] = {};
+      uint64_t elementSize = 0;
+      uint64_t offset = 0;
+   };
+
+   static_assert( sizeof( DecodedCacheColumn ) == 48, "Unexpected DecodedCacheColumn size" );
+
+   uint64_t alignUp( uint64_t offset )
+   {
+      return ( offset + DECODED_CACHE_ALIGNMENT - 1 ) / DECODED_CACHE_ALIGNMENT *
+             DECODED_CACHE_ALIGNMENT;
+   }
+
+#if defined( _WIN32 )
+   std::wstring widePath( const e57::ustring &fileName )
+   {
+      const int length =
+         ::MultiByteToWideChar( CP_UTF8, 0, fileName.c_str(), -1, nullptr, 0 );
+
+      if ( length <= 0 )
+      {
+         return {};
+      }
+
+      std::wstring path( static_cast<size_t>( length ), L'\0' );
+      ::MultiByteToWideChar( CP_UTF8, 0, fileName.c_str(), -1, &path[0], length );
+      path.resize( static_cast<size_t>( length - 1 ) );
+
+      return path;
+   }
+#endif
+
+   // A whole file mapped read-only, empty if it can't be
+   class MappedFile
+   {
+   public:
+      explicit MappedFile( const e57::ustring &fileName )
+      {
+#if defined( _WIN32 )
+         HANDLE file = ::CreateFileW( widePath( fileName ).c_str(), GENERIC_READ,
+                                      FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr );
+
+         if ( file == INVALID_HANDLE_VALUE )
+         {
+            return;
+         }
+
+         LARGE_INTEGER length;
+
+         if ( ::GetFileSizeEx( file, &length ) && ( length.QuadPart > 0 ) &&
+              ( static_cast<uint64_t>( length.QuadPart ) <= SIZE_MAX ) )
+         {
+            HANDLE mapping = ::CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+            if ( mapping != nullptr )
+            {
+               view_ = ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+
+               // The view holds its own reference to the mapping
+               ::CloseHandle( mapping );
+
+               if ( view_ != nullptr )
+               {
+                  size_ = static_cast<size_t>( length.QuadPart );
+               }
+            }
+         }
+
+         ::CloseHandle( file );
+#else
+         const int fd = ::open( fileName.c_str(), O_RDONLY );
+
+         if ( fd < 0 )
+         {
+            return;
+         }
+
+         struct stat status;
+
+         if ( ( ::fstat( fd, &status ) == 0 ) && ( status.st_size > 0 ) &&
+              ( static_cast<uint64_t>( status.st_size ) <= SIZE_MAX ) )
+         {
+            const auto length = static_cast<size_t>( status.st_size );
+            void *view = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, fd, 0 );
+
+            if ( view != MAP_FAILED )
+            {
+               view_ = view;
+               size_ = length;
+            }
+         }
+
+         ::close( fd );
+#endif
+      }
+
+      ~MappedFile()
+      {
+         if ( view_ == nullptr )
+         {
+            return;
+         }
+
+#if defined( _WIN32 )
+         ::UnmapViewOfFile( view_ );
+#else
+         ::munmap( view_, size_ );
+#endif
+      }
+
+      MappedFile( const MappedFile & ) = delete;
+      MappedFile &operator=( const MappedFile & ) = delete;
+
+      const char *data() const
+      {
+         return static_cast<const char *>( view_ );
+      }
+
+      size_t size() const
+      {
+         return size_;
+      }
+
+   private:
+      void *view_ = nullptr;
+      size_t size_ = 0;
+   };
+
+   std::FILE *openForWriting( const e57::ustring &fileName )
+   {
+#if defined( _WIN32 )
+      return ::_wfopen( widePath( fileName ).c_str(), L"wb" );
+#else
+      return std::fopen( fileName.c_str(), "wb" );
+#endif
+   }
+
+   void removeFile( const e57::ustring &fileName )
+   {
+#if defined( _WIN32 )
+      ::DeleteFileW( widePath( fileName ).c_str() );
+#else
+      std::remove( fileName.c_str() );
+#endif
+   }
+
+   bool replaceFile( const e57::ustring &from, const e57::ustring &to )
+   {
+#if defined( _WIN32 )
+      return ::MoveFileExW( widePath( from ).c_str(), widePath( to ).c_str(),
+                            MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+      return std::rename( from.c_str(), to.c_str() ) == 0;
+#endif
+   }
+}
+
+namespace e57
+{
+   uint64_t DecodedCache::fileModified( const ustring &fileName )
+   {
+#if defined( _WIN32 )
+      WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+      if ( !::GetFileAttributesExW( widePath( fileName ).c_str(), GetFileExInfoStandard,
+                                    &attributes ) )
+      {
+         return 0;
+      }
+
+      // In 100 nanosecond intervals
+      const uint64_t modified = ( uint64_t{ attributes.ftLastWriteTime.dwHighDateTime } << 32 ) |
+                                attributes.ftLastWriteTime.dwLowDateTime;
+
+      return modified * 100;
+#else
+      struct stat status;
+
+      if ( ::stat( fileName.c_str(), &status ) != 0 )
+      {
+         return 0;
+      }
+
+#if defined( __APPLE__ )
+      const struct timespec &modified = status.st_mtimespec;
+#else
+      const struct timespec &modified = status.st_mtim;
+#endif
+
+      return static_cast<uint64_t>( modified.tv_sec ) * 1'000'000'000 +
+             static_cast<uint64_t>( modified.tv_nsec );
+#endif
+   }
+
+   ustring DecodedCache::fileName( const ustring &directory, const Key &key )
+   {
+      ustring name = directory;
+
+      if ( !name.empty() && ( name.back() != '/' ) && ( name.back() != '\\' ) )
+      {
+         name += '/';
+      }
+
+      // GUIDs are usually made of letters, digits, and dashes, but may be anything
+      for ( const char c : key.fileGuid )
+      {
+         const bool safe = ( ( c >= '0' ) && ( c <= '9' ) ) || ( ( c >= 'a' ) && ( c <= 'z' ) ) ||
+                           ( ( c >= 'A' ) && ( c <= 'Z' ) ) || ( c == '-' );
+
+         name += safe ? c : '_';
+      }
+
+      char suffix[64];
+      std::snprintf( suffix, sizeof( suffix ), "-%016" PRIx64 "-%03" PRIx32 "-%" PRIx32,
+                     key.sectionLogicalStart, key.coordinateType, key.flags );
+
+      return name + suffix + ".e57cache";
+   }
+
+   bool DecodedCache::read( const ustring &fileName, const Key &key,
+                            const std::vector<Column> &columns )
+   {
+      const MappedFile file( fileName );
+
+      DecodedCacheHeader header;
+
+      if ( file.size() < sizeof( header ) )
+      {
+         return false;
+      }
+
+      memcpy( &header, file.data(), sizeof( header ) );
+
+      const bool signatureMatches =
+         memcmp( header.signature, DECODED_CACHE_SIGNATURE, sizeof( header.signature ) ) == 0;
+
+      if ( !signatureMatches || ( header.version != DECODED_CACHE_VERSION ) ||
+           ( header.fileLength != key.fileLength ) ||
+           ( header.fileModified != key.fileModified ) ||
+           ( header.xmlChecksum != key.xmlChecksum ) ||
+           ( header.sectionLogicalStart != key.sectionLogicalStart ) ||
+           ( header.pointCount != key.pointCount ) ||
+           ( header.coordinateType != key.coordinateType ) || ( header.flags != key.flags ) ||
+           ( header.guidLength != key.fileGuid.size() ) )
+      {
+         return false;
+      }
+
+      const uint64_t columnsStart = sizeof( header ) + header.guidLength;
+      const uint64_t columnsEnd =
+         columnsStart + uint64_t{ header.columnCount } * sizeof( DecodedCacheColumn );
+
+      if ( ( columnsEnd > file.size() ) ||
+           ( key.fileGuid.compare( 0, ustring::npos, file.data() + sizeof( header ),
+                                   header.guidLength ) != 0 ) )
+      {
+         return false;
+      }
+
+      // Find all the columns before copying any of them
+      std::vector<const char *> sources;
+      sources.reserve( columns.size() );
+
+      for ( const Column &column : columns )
+      {
+         const char *source = nullptr;
+
+         for ( uint32_t i = 0; i < header.columnCount; ++i )
+         {
+            DecodedCacheColumn stored;
+            memcpy( &stored, file.data() + columnsStart + i * sizeof( stored ), sizeof( stored ) );
+
+            if ( ( strncmp( stored.name, column.name.c_str(), sizeof( stored.name ) ) != 0 ) ||
+                 ( stored.elementSize != column.elementSize ) )
+            {
+               continue;
+            }
+
+            // The division keeps this from overflowing for a damaged file
+            if ( ( stored.offset <= file.size() ) && ( stored.elementSize > 0 ) &&
+                 ( ( file.size() - stored.offset ) / stored.elementSize >= key.pointCount ) )
+            {
+               source = file.data() + stored.offset;
+            }
+
+            break;
+         }
+
+         if ( source == nullptr )
+         {
+            return false;
+         }
+
+         sources.push_back( source );
+      }
+
+      for ( size_t i = 0; i < columns.size(); ++i )
+      {
+         memcpy( columns[i].data, sources[i],
+                 static_cast<size_t>( key.pointCount ) * columns[i].elementSize );
+      }
+
+      return true;
+   }
+
+   bool DecodedCache::write( const ustring &fileName, const Key &key,
+                             const std::vector<Column> &columns )
+   {
+      DecodedCacheHeader header;
+      memcpy( header.signature, DECODED_CACHE_SIGNATURE, sizeof( header.signature ) );
+      header.version = DECODED_CACHE_VERSION;
+      header.columnCount = static_cast<uint32_t>( columns.size() );
+      header.fileLength = key.fileLength;
+      header.fileModified = key.fileModified;
+      header.xmlChecksum = key.xmlChecksum;
+      header.sectionLogicalStart = key.sectionLogicalStart;
+      header.pointCount = key.pointCount;
+      header.coordinateType = key.coordinateType;
+      header.flags = key.flags;
+      header.guidLength = static_cast<uint32_t>( key.fileGuid.size() );
+
+      std::vector<DecodedCacheColumn> stored( columns.size() );
+      uint64_t offset = sizeof( header ) + header.guidLength + stored.size() * sizeof( stored[0] );
+
+      for ( size_t i = 0; i < columns.size(); ++i )
+      {
+         if ( columns[i].name.size() >= sizeof( stored[i].name ) )
+         {
+            return false;
+         }
+
+         memcpy( stored[i].name, columns[i].name.c_str(), columns[i].name.size() );
+         stored[i].elementSize = columns[i].elementSize;
+         stored[i].offset = alignUp( offset );
+
+         offset = stored[i].offset + key.pointCount * columns[i].elementSize;
+      }
+
+      // Readers of the same block on other threads or in other processes may be writing it too
+      const ustring tempName =
+         fileName + "." + toString( std::hash<std::thread::id>()( std::this_thread::get_id() ) ) +
+         ".tmp";
+
+      std::FILE *file = openForWriting( tempName );
+
+      if ( file == nullptr )
+      {
+         return false;
+      }
+
+      uint64_t position = 0;
+
+      const auto put = [file, &position]( const void *data, uint64_t length ) {
+         if ( length == 0 )
+         {
+            return true;
+         }
+
+         position += length;
+
+         return std::fwrite( data, 1, static_cast<size_t>( length ), file ) == length;
+      };
+
+      const char padding[DECODED_CACHE_ALIGNMENT] = {};
+
+      bool written = put( &header, sizeof( header ) ) &&
+                     put( key.fileGuid.data(), key.fileGuid.size() ) &&
+                     put( stored.data(), stored.size() * sizeof( stored[0] ) );
+
+      for ( size_t i = 0; written && ( i < columns.size() ); ++i )
+      {
+         written = put( padding, stored[i].offset - position ) &&
+                   put( columns[i].data, key.pointCount * columns[i].elementSize );
+      }
+
+      written = ( std::fclose( file ) == 0 ) && written;
+
+      if ( !written || !replaceFile( tempName, fileName ) )
+      {
+         removeFile( tempName );
+         return false;
+      }
+
+      return true;
+   }
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// @brief The decoded points of a Data3D block, kept in a sidecar file for later reads.
+   /// @details Each column (one per point field) is stored as the values of the buffer it was
+   /// read into, aligned so that the file can be memory mapped and copied from as it is. The
+   /// file is named after the GUID of the E57 file and the start of the block's binary section
+   /// (see ReaderOptions::decodedCacheDirectory).
+   class DecodedCache
+   {
+   public:
+      /// What the values in a cache file depend on. A file made for another key isn't used.
+      struct Key
+      {
+         /// guid of the E57 file's root
+         ustring fileGuid;
+
+         /// Physical length, modification time (see fileModified()) and CRC32C of the XML
+         /// section of the E57 file, to tell if it has changed
+         uint64_t fileLength = 0;
+         uint64_t fileModified = 0;
+         uint32_t xmlChecksum = 0;
+
+         /// Start of the block's binary section
+         uint64_t sectionLogicalStart = 0;
+
+         uint64_t pointCount = 0;
+
+         /// Size of the coordinate type, + 0x100 if it is floating point
+         uint32_t coordinateType = 0;
+
+         /// Conversions applied to the points as they were read (see ReaderImpl)
+         uint32_t flags = 0;
+      };
+
+      /// A buffer of pointCount values of elementSize bytes
+      struct Column
+      {
+         ustring name;
+         void *data = nullptr;
+         size_t elementSize = 0;
+      };
+
+      /// @returns the modification time of fileName in nanoseconds, or 0 if it can't be found
+      static uint64_t fileModified( const ustring &fileName );
+
+      /// @returns the name of the cache file for key in directory
+      static ustring fileName( const ustring &directory, const Key &key );
+
+      /// Copy the columns from the cache file fileName, if it was made for key and has all of
+      /// them.
+      /// @returns false (having copied nothing) otherwise, or if it can't be read
+      static bool read( const ustring &fileName, const Key &key,
+                        const std::vector<Column> &columns );
+
+      /// Write the columns to the cache file fileName, replacing any there is. It is written
+      /// under another name first, so a reader never sees it half written.
+      /// @returns false if it couldn't be written
+      static bool write( const ustring &fileName, const Key &key,
+                         const std::vector<Column> &columns );
+   };
+}
@@ -26,10 +26,14 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <cstring>
+#include <utility>
 
 #include "CompressedVectorNodeImpl.h"
 #include "Decoder.h"
+#include "DeltaCodec.h"
+#include "RunLengthCodec.h"
 #include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
 #include "IntegerNodeImpl.h"
@@ -83,6 +87,24 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
             return decoder;
          }
 
+         // E57_EXT_delta_codec
+         if ( const auto deltaCodec = cVector->findCodec( DELTA_CODEC_URI, "deltaCodec", path ) )
+         {
+            std::shared_ptr<Decoder> decoder( new DeltaIntegerDecoder(
+               false, bytestreamNumber, dbufs.at( 0 ), ini->minimum(), ini->maximum(), 1.0, 0.0,
+               deltaCodecOrder( *deltaCodec ), maxRecordCount ) );
+            return decoder;
+         }
+
+         // E57_EXT_run_length_codec
+         if ( cVector->findCodec( RUN_LENGTH_CODEC_URI, "runLengthCodec", path ) )
+         {
+            std::shared_ptr<Decoder> decoder( new RunLengthIntegerDecoder(
+               false, bytestreamNumber, dbufs.at( 0 ), ini->minimum(), ini->maximum(), 1.0, 0.0,
+               maxRecordCount ) );
+            return decoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Decoder> decoder( new BitpackIntegerDecoder<uint8_t>(
@@ -138,6 +160,24 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
             return decoder;
          }
 
+         // E57_EXT_delta_codec
+         if ( const auto deltaCodec = cVector->findCodec( DELTA_CODEC_URI, "deltaCodec", path ) )
+         {
+            std::shared_ptr<Decoder> decoder( new DeltaIntegerDecoder(
+               true, bytestreamNumber, dbufs.at( 0 ), sini->minimum(), sini->maximum(),
+               sini->scale(), sini->offset(), deltaCodecOrder( *deltaCodec ), maxRecordCount ) );
+            return decoder;
+         }
+
+         // E57_EXT_run_length_codec
+         if ( cVector->findCodec( RUN_LENGTH_CODEC_URI, "runLengthCodec", path ) )
+         {
+            std::shared_ptr<Decoder> decoder( new RunLengthIntegerDecoder(
+               true, bytestreamNumber, dbufs.at( 0 ), sini->minimum(), sini->maximum(),
+               sini->scale(), sini->offset(), maxRecordCount ) );
+            return decoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Decoder> decoder( new BitpackIntegerDecoder<uint8_t>(
@@ -193,15 +233,57 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
    }
 }
 
-Decoder::Decoder( unsigned bytestreamNumber ) : bytestreamNumber_( bytestreamNumber )
+Decoder::Decoder( unsigned bytestreamNumber, uint64_t maxRecordCount ) :
+   bytestreamNumber_( bytestreamNumber ), maxRecordCount_( maxRecordCount )
+{
+}
+
+uint64_t Decoder::recordsToSkip( uint64_t recordIndex ) const
+{
+   if ( recordIndex < strideFirstRecord_ )
+   {
+      return strideFirstRecord_ - recordIndex;
+   }
+
+   const uint64_t phase = ( recordIndex - strideFirstRecord_ ) % recordStride_;
+
+   return ( phase == 0 ) ? 0 : recordStride_ - phase;
+}
+
+uint64_t Decoder::recordsKept( uint64_t recordIndex, uint64_t count, uint64_t roomCount,
+                               uint64_t &consumedCount ) const
 {
+   // Stop where the buffer filled, so all the channels stop at the same record
+   if ( roomCount == 0 )
+   {
+      consumedCount = 0;
+      return 0;
+   }
+
+   const uint64_t skipCount = recordsToSkip( recordIndex );
+
+   if ( skipCount >= count )
+   {
+      consumedCount = count;
+      return 0;
+   }
+
+   const uint64_t keptCount = 1 + ( count - skipCount - 1 ) / recordStride_;
+
+   if ( keptCount <= roomCount )
+   {
+      consumedCount = count;
+      return keptCount;
+   }
+
+   consumedCount = skipCount + ( roomCount - 1 ) * recordStride_ + 1;
+   return roomCount;
 }
 
 BitpackDecoder::BitpackDecoder( unsigned bytestreamNumber, SourceDestBuffer &dbuf,
                                 unsigned alignmentSize, uint64_t maxRecordCount ) :
-   Decoder( bytestreamNumber ),
-   maxRecordCount_( maxRecordCount ), destBuffer_( dbuf.impl() ),
-   inBuffer_( 1024 ), // !!! need to pick smarter channel buffer sizes
+   Decoder( bytestreamNumber, maxRecordCount ), destBuffer_( dbuf.impl() ),
+   inBuffer_( 1024 ), // only holds what straddles two inputs, the rest is decoded in place
    inBufferAlignmentSize_( alignmentSize ), bitsPerWord_( 8 * alignmentSize ),
    bytesPerWord_( alignmentSize )
 {
@@ -223,6 +305,58 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
    std::cout << "BitpackDecoder::inputprocess() called, source=" << ( source ? source : "none" )
              << " availableByteCount=" << availableByteCount << std::endl;
 #endif
+   if ( !canProcessInPlace( source ) )
+   {
+      return inputProcessBuffered( source, availableByteCount );
+   }
+
+   const size_t bytesEaten = inputProcessInPlace( source, availableByteCount );
+
+   if ( ( bytesEaten == availableByteCount ) || isOutputFull() )
+   {
+      return bytesEaten;
+   }
+
+   // What's left doesn't hold a whole record (or ends in part of a word), so save it until the
+   // next input arrives
+   return bytesEaten + inputProcessBuffered( source + bytesEaten, availableByteCount - bytesEaten );
+}
+
+bool BitpackDecoder::canProcessInPlace( const char *source ) const
+{
+   // Only if nothing is left over from earlier input
+   return ( source != nullptr ) && ( inBufferEndByte_ == 0 ) &&
+          ( reinterpret_cast<uintptr_t>( source ) % inPlaceAlignment_ == 0 );
+}
+
+size_t BitpackDecoder::inputProcessInPlace( const char *source, size_t availableByteCount )
+{
+   // Only whole words, since the derived classes may read all of the word a record ends in
+   const size_t endBit = ( availableByteCount / bytesPerWord_ ) * bitsPerWord_;
+
+   size_t bitsEaten = 0;
+   if ( endBit > inBufferFirstBit_ )
+   {
+      bitsEaten = inputProcessAligned( source, inBufferFirstBit_, endBit );
+   }
+
+   inBufferFirstBit_ += bitsEaten;
+
+   // Leave the word holding the next bit with the caller, as if it was the start of new input
+   const size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
+   inBufferFirstBit_ %= bitsPerWord_;
+
+   return firstWord * bytesPerWord_;
+}
+
+bool BitpackDecoder::isOutputFull() const
+{
+   return ( currentRecordIndex_ >= maxRecordCount_ ) ||
+          ( destBuffer_->nextIndex() == destBuffer_->capacity() );
+}
+
+size_t BitpackDecoder::inputProcessBuffered( const char *source, const size_t availableByteCount )
+{
    size_t bytesUnsaved = availableByteCount;
    size_t bitsEaten = 0;
    do
@@ -273,9 +407,14 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
       std::cout << "  feeding aligned decoder " << endBit - inBufferFirstBit_ << " bits."
                 << std::endl;
 #endif
-      bitsEaten =
-         inputProcessAligned( &inBuffer_[firstWord * bytesPerWord_],
-                              inBufferFirstBit_ - firstNaturalBit, endBit - firstNaturalBit );
+      // After a stateReset() part way into a word, we may not have input up to the first bit yet
+      bitsEaten = 0;
+      if ( endBit > inBufferFirstBit_ )
+      {
+         bitsEaten =
+            inputProcessAligned( &inBuffer_[firstWord * bytesPerWord_],
+                                 inBufferFirstBit_ - firstNaturalBit, endBit - firstNaturalBit );
+      }
 #ifdef E57_VERBOSE
       std::cout << "  bitsEaten=" << bitsEaten << " firstWord=" << firstWord
                 << " firstNaturalBit=" << firstNaturalBit << " endBit=" << endBit << std::endl;
@@ -291,6 +430,27 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
 #endif
       inBufferFirstBit_ += bitsEaten;
 
+      // If all that is left in inBuffer_ was copied from source just now, give it back and
+      // decode the rest of source in place
+      const size_t firstNaturalByte = ( inBufferFirstBit_ / bitsPerWord_ ) * bytesPerWord_;
+      const size_t leftoverByteCount = inBufferEndByte_ - firstNaturalByte;
+
+      if ( ( source != nullptr ) && ( leftoverByteCount < byteCount ) )
+      {
+         inBufferEndByte_ = 0;
+
+         if ( canProcessInPlace( source - leftoverByteCount ) )
+         {
+            inBufferFirstBit_ %= bitsPerWord_;
+            bytesUnsaved += leftoverByteCount;
+
+            const size_t bytesSaved = availableByteCount - bytesUnsaved;
+            return bytesSaved + inputProcess( source - leftoverByteCount, bytesUnsaved );
+         }
+
+         inBufferEndByte_ = firstNaturalByte + leftoverByteCount;
+      }
+
       // Shift uneaten data to beginning of inBuffer_, keep on natural word
       // boundaries.
       inBufferShiftDown();
@@ -303,9 +463,10 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
    return ( availableByteCount - bytesUnsaved );
 }
 
-void BitpackDecoder::stateReset()
+void BitpackDecoder::stateReset( uint64_t recordIndex, unsigned firstBit )
 {
-   inBufferFirstBit_ = 0;
+   currentRecordIndex_ = recordIndex;
+   inBufferFirstBit_ = firstBit;
    inBufferEndByte_ = 0;
 }
 
@@ -373,6 +534,8 @@ BitpackFloatDecoder::BitpackFloatDecoder( unsigned bytestreamNumber, SourceDestB
                    maxRecordCount ),
    precision_( precision )
 {
+   // The values are passed on as arrays of float or double
+   inPlaceAlignment_ = bytesPerWord_;
 }
 
 size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t firstBit,
@@ -426,39 +589,42 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    std::cout << "  n:" << n << std::endl; //???
 #endif
 
+   if ( recordStride_ > 1 )
+   {
+      const uint64_t recordsLeft = maxRecordCount_ - currentRecordIndex_;
+
+      return inputProcessStrided( inbuf, std::min<uint64_t>( maxInputRecords, recordsLeft ) );
+   }
+
    if ( precision_ == PrecisionSingle )
    {
       // Form the starting address for first data location in inBuffer
       auto inp = reinterpret_cast<const float *>( inbuf );
 
-      // Copy floats from inbuf to destBuffer_
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < n; i++ )
       {
-         float value = *inp;
-
-#ifdef E57_VERBOSE
-         std::cout << "  got float value=" << value << std::endl;
-#endif
-         destBuffer_->setNextFloat( value );
-         inp++;
+         std::cout << "  got float value=" << inp[i] << std::endl;
       }
+#endif
+
+      // Copy floats from inbuf to destBuffer_
+      destBuffer_->setNextFloatBlock( inp, n );
    }
    else
    { // Double precision
       // Form the starting address for first data location in inBuffer
       auto inp = reinterpret_cast<const double *>( inbuf );
 
-      // Copy doubles from inbuf to destBuffer_
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < n; i++ )
       {
-         double value = *inp;
-
-#ifdef E57_VERBOSE
-         std::cout << "  got double value=" << value << std::endl;
-#endif
-         destBuffer_->setNextDouble( value );
-         inp++;
+         std::cout << "  got double value=" << inp[i] << std::endl;
       }
+#endif
+
+      // Copy doubles from inbuf to destBuffer_
+      destBuffer_->setNextDoubleBlock( inp, n );
    }
 
    // Update counts of records processed
@@ -468,6 +634,64 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    return ( n * 8 * typeSize );
 }
 
+size_t BitpackFloatDecoder::inputProcessStrided( const char *inbuf, uint64_t recordCount )
+{
+   const size_t typeSize = ( precision_ == PrecisionSingle ) ? sizeof( float ) : sizeof( double );
+
+   uint64_t record = 0;
+
+   // Records are all the same size, so the ones stepped over are never looked at
+   while ( record < recordCount )
+   {
+      uint64_t consumedCount = 0;
+      const uint64_t keptCount =
+         recordsKept( currentRecordIndex_ + record, recordCount - record,
+                      destBuffer_->capacity() - destBuffer_->nextIndex(), consumedCount );
+
+      if ( keptCount == 0 )
+      {
+         record += consumedCount;
+         break;
+      }
+
+      // The first record kept, then every recordStride_ records
+      const uint64_t first = record + recordsToSkip( currentRecordIndex_ + record );
+
+      for ( uint64_t k = 0; k < keptCount; ++k )
+      {
+         const char *p = inbuf + ( first + k * recordStride_ ) * typeSize;
+
+         if ( precision_ == PrecisionSingle )
+         {
+            float value;
+            memcpy( &value, p, sizeof( value ) );
+            destBuffer_->setNextFloat( value );
+         }
+         else
+         {
+            double value;
+            memcpy( &value, p, sizeof( value ) );
+            destBuffer_->setNextDouble( value );
+         }
+      }
+
+      record += consumedCount;
+   }
+
+   currentRecordIndex_ += record;
+
+   return static_cast<size_t>( record * 8 * typeSize );
+}
+
+bool BitpackFloatDecoder::recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                                          unsigned &firstBit ) const
+{
+   byteOffset = recordIndex * bytesPerWord_;
+   firstBit = 0;
+
+   return true;
+}
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 void BitpackFloatDecoder::dump( int indent, std::ostream &os )
 {
@@ -513,9 +737,9 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
    size_t nBytesAvailable = ( endBit - firstBit ) >> 3;
    size_t nBytesRead = 0;
 
-   // Loop until we've finished all the records, or ran out of input currently
-   // available
-   while ( currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable )
+   // Loop until we've finished all the records, filled the dest buffer, or ran out of input
+   // currently available
+   while ( !isOutputFull() && nBytesRead < nBytesAvailable )
    {
 #ifdef E57_VERBOSE
       std::cout << "read string loop1: readingPrefix=" << readingPrefix_
@@ -583,7 +807,7 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
             prefixLength_ = 1;
             memset( prefixBytes_, 0, sizeof( prefixBytes_ ) );
             nBytesPrefixRead_ = 0;
-            currentString_ = "";
+            currentString_.clear();
             nBytesStringRead_ = 0;
          }
 #ifdef E57_VERBOSE
@@ -607,17 +831,33 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
             nBytesProcess = static_cast<unsigned>( nBytesNeeded );
          }
 
-         // Append to current string and update counts
-         currentString_ += ustring( inbuf, nBytesProcess );
+         const bool keep = ( recordsToSkip( currentRecordIndex_ ) == 0 );
+         const bool complete = ( nBytesStringRead_ + nBytesProcess == stringLength_ );
+
+         if ( keep && complete && nBytesStringRead_ == 0 )
+         {
+            // The whole string is in the input, so store it from there without copying it
+            destBuffer_->setNextString( inbuf, nBytesProcess );
+         }
+         else if ( keep )
+         {
+            // Append to current string, which keeps its memory from one string to the next
+            currentString_.append( inbuf, nBytesProcess );
+
+            if ( complete )
+            {
+               destBuffer_->setNextString( currentString_ );
+            }
+         }
+
+         // Update counts
          inbuf += nBytesProcess;
          nBytesRead += nBytesProcess;
          nBytesStringRead_ += nBytesProcess;
 
          // Check if completed reading the string contents
-         if ( nBytesStringRead_ == stringLength_ )
+         if ( complete )
          {
-            // Save accumulated string to dest buffer
-            destBuffer_->setNextString( currentString_ );
             currentRecordIndex_++;
 
             // Get ready to read next prefix
@@ -626,7 +866,7 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
             memset( prefixBytes_, 0, sizeof( prefixBytes_ ) );
             nBytesPrefixRead_ = 0;
             stringLength_ = 0;
-            currentString_ = "";
+            currentString_.clear();
             nBytesStringRead_ = 0;
          }
       }
@@ -636,6 +876,27 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
    return ( nBytesRead * 8 );
 }
 
+void BitpackStringDecoder::stateReset( uint64_t recordIndex, unsigned firstBit )
+{
+   BitpackDecoder::stateReset( recordIndex, firstBit );
+
+   // Forget any partly read string
+   readingPrefix_ = true;
+   prefixLength_ = 1;
+   memset( prefixBytes_, 0, sizeof( prefixBytes_ ) );
+   nBytesPrefixRead_ = 0;
+   stringLength_ = 0;
+   currentString_.clear();
+   nBytesStringRead_ = 0;
+}
+
+bool BitpackStringDecoder::recordPosition( uint64_t /*recordIndex*/, uint64_t & /*byteOffset*/,
+                                           unsigned & /*firstBit*/ ) const
+{
+   // Strings vary in length, so we'd have to read all the ones before
+   return false;
+}
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 void BitpackStringDecoder::dump( int indent, std::ostream &os )
 {
@@ -663,6 +924,71 @@ void BitpackStringDecoder::dump( int indent, std::ostream &os )
 
 //================================================================
 
+namespace
+{
+   // Get word index of inp. Decoders may work straight on packet memory, where a bytestream need
+   // not be aligned, so words are copied out rather than dereferenced.
+   template <typename RegisterT> inline RegisterT loadWord( const char *inp, size_t index )
+   {
+      RegisterT w;
+      memcpy( &w, inp + index * sizeof( RegisterT ), sizeof( RegisterT ) );
+      return w;
+   }
+
+   // Unpack one block of records of a fixed bit width. A block is as many records as a word has
+   // bits, so it fills exactly Bits words and the next block starts on a word boundary again.
+   // With Bits known at compile time, the word and shift for each record are constants and the
+   // loop unrolls without any branches, which is what makes this faster than the general loop.
+   template <typename RegisterT, unsigned Bits>
+   void unpackBlock( const char *inp, int64_t minimum, int64_t *values )
+   {
+      constexpr unsigned RegisterBits = sizeof( RegisterT ) * 8;
+      constexpr RegisterT Mask =
+         static_cast<RegisterT>( ( Bits == 64 ) ? ~0ULL : ( 1ULL << ( Bits % 64 ) ) - 1 );
+
+      for ( unsigned i = 0; i < RegisterBits; ++i )
+      {
+         const unsigned bit = i * Bits;
+         const unsigned word = bit / RegisterBits;
+         const unsigned shift = bit % RegisterBits;
+
+         RegisterT w = static_cast<RegisterT>( loadWord<RegisterT>( inp, word ) >> shift );
+
+         // The record spills into the next word (shift can't be 0 here)
+         if ( shift + Bits > RegisterBits )
+         {
+            w |= static_cast<RegisterT>( loadWord<RegisterT>( inp, word + 1 )
+                                         << ( RegisterBits - shift ) );
+         }
+
+         // In unsigned arithmetic, since the sum only fits in int64_t once wrapped
+         values[i] = static_cast<int64_t>( static_cast<uint64_t>( minimum ) + ( w & Mask ) );
+      }
+   }
+
+   // Table of unpackBlock() for every bit width from 1 to the size of RegisterT
+   template <typename RegisterT> struct BlockUnpackers
+   {
+      using Unpacker = void ( * )( const char *, int64_t, int64_t * );
+
+      static constexpr size_t RegisterBits = sizeof( RegisterT ) * 8;
+
+      template <size_t... I>
+      static constexpr std::array<Unpacker, RegisterBits> makeTable( std::index_sequence<I...> )
+      {
+         return { { &unpackBlock<RegisterT, I + 1>... } };
+      }
+
+      static constexpr std::array<Unpacker, RegisterBits> table =
+         makeTable( std::make_index_sequence<RegisterBits>() );
+   };
+
+   template <typename RegisterT>
+   constexpr std::array<typename BlockUnpackers<RegisterT>::Unpacker,
+                        BlockUnpackers<RegisterT>::RegisterBits>
+      BlockUnpackers<RegisterT>::table;
+}
+
 template <typename RegisterT>
 BitpackIntegerDecoder<RegisterT>::BitpackIntegerDecoder( bool isScaledInteger,
                                                          unsigned bytestreamNumber,
@@ -680,6 +1006,14 @@ BitpackIntegerDecoder<RegisterT>::BitpackIntegerDecoder( bool isScaledInteger,
    bitsPerRecord_ = imf->bitsNeeded( minimum_, maximum_ );
    destBitMask_ =
       ( bitsPerRecord_ == 64 ) ? ~0 : static_cast<RegisterT>( 1ULL << bitsPerRecord_ ) - 1;
+
+   // The factory only makes us for records which fit in RegisterT
+   if ( bitsPerRecord_ == 0 || bitsPerRecord_ > RegisterBits )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "bitsPerRecord=" + toString( bitsPerRecord_ ) );
+   }
+
+   unpackBlock_ = BlockUnpackers<RegisterT>::table[bitsPerRecord_ - 1];
 }
 
 template <typename RegisterT>
@@ -731,7 +1065,13 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    std::cout << "  recordCount=" << recordCount << std::endl;
 #endif
 
-   auto inp = reinterpret_cast<const RegisterT *>( inbuf );
+   if ( recordStride_ > 1 )
+   {
+      return inputProcessStrided( inbuf, firstBit,
+                                  std::min<uint64_t>( maxInputRecords,
+                                                      maxRecordCount_ - currentRecordIndex_ ) );
+   }
+
    unsigned wordPosition = 0; // The index in inbuf of the word we are currently working on.
 
    // clang-format off
@@ -748,10 +1088,74 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
 
    size_t bitOffset = firstBit;
 
-   for ( size_t i = 0; i < recordCount; i++ )
+   // Values are stored in the user's dest buffer a block at a time.
+   // The parameter isScaledInteger_ determines which version of
+   // setNextInt64Block gets called
+   int64_t block[RegisterBits];
+   size_t blockCount = 0;
+
+   // The bits of a record can hold values past maximum_, which only a deep check catches
+   const bool checkLimits = ( destBuffer_->validationLevel() == ValidationDeep );
+
+   auto storeBlock = [this, &block, &blockCount, checkLimits]() {
+      if ( checkLimits )
+      {
+         for ( size_t j = 0; j < blockCount; ++j )
+         {
+            if ( block[j] < minimum_ || maximum_ < block[j] )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket, "rawValue=" + toString( block[j] ) +
+                                                          " minimum=" + toString( minimum_ ) +
+                                                          " maximum=" + toString( maximum_ ) );
+            }
+         }
+      }
+
+      if ( isScaledInteger_ )
+      {
+         destBuffer_->setNextInt64Block( block, blockCount, scale_, offset_ );
+      }
+      else
+      {
+         destBuffer_->setNextInt64Block( block, blockCount );
+      }
+
+      blockCount = 0;
+   };
+
+   auto storeValue = [&]( int64_t value ) {
+      block[blockCount++] = value;
+
+      if ( blockCount == RegisterBits )
+      {
+         storeBlock();
+      }
+   };
+
+   size_t i = 0;
+   while ( i < recordCount )
    {
+      // Once a record starts on a word boundary, unpack whole blocks. The records of a block
+      // fill exactly bitsPerRecord_ words, so the next block is aligned too.
+      if ( ( bitOffset == 0 ) && ( recordCount - i >= RegisterBits ) )
+      {
+         // Keep the values in order
+         if ( blockCount > 0 )
+         {
+            storeBlock();
+         }
+
+         unpackBlock_( inbuf + wordPosition * sizeof( RegisterT ), minimum_, block );
+         blockCount = RegisterBits;
+         storeBlock();
+
+         wordPosition += bitsPerRecord_;
+         i += RegisterBits;
+         continue;
+      }
+
       // Get lower word (contains at least the LSbit of the value),
-      RegisterT low = inp[wordPosition];
+      RegisterT low = loadWord<RegisterT>( inbuf, wordPosition );
 
 #ifdef E57_VERBOSE
       std::cout << "  bitOffset: " << bitOffset << std::endl;
@@ -774,7 +1178,7 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
       else
       {
          // Get upper word (may or may not contain interesting bits),
-         RegisterT high = inp[wordPosition + 1];
+         RegisterT high = loadWord<RegisterT>( inbuf, wordPosition + 1 );
 
 #ifdef E57_VERBOSE
          std::cout << "  high:" << binaryString( high ) << std::endl;
@@ -800,18 +1204,7 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
       std::cout << "  Storing value=" << value << std::endl;
 #endif
 
-      // The parameter isScaledInteger_ determines which version of
-      // setNextInt64 gets called
-      if ( isScaledInteger_ )
-      {
-         destBuffer_->setNextInt64( value, scale_, offset_ );
-      }
-      else
-      {
-         destBuffer_->setNextInt64( value );
-      }
-
-      // Store the result in next available position in the user's dest buffer
+      storeValue( value );
 
       // Calc next bit alignment and which word it starts in
       bitOffset += bitsPerRecord_;
@@ -820,13 +1213,21 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
          bitOffset -= 8 * sizeof( RegisterT );
          wordPosition++;
       }
+
+      i++;
+
 #ifdef E57_VERBOSE
-      std::cout << "  Processed " << i + 1 << " records, wordPosition=" << wordPosition
+      std::cout << "  Processed " << i << " records, wordPosition=" << wordPosition
                 << " decoder:" << std::endl;
       dump( 4 );
 #endif
    }
 
+   if ( blockCount > 0 )
+   {
+      storeBlock();
+   }
+
    // Update counts of records processed
    currentRecordIndex_ += recordCount;
 
@@ -834,6 +1235,90 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    return ( recordCount * bitsPerRecord_ );
 }
 
+template <typename RegisterT>
+size_t BitpackIntegerDecoder<RegisterT>::inputProcessStrided( const char *inbuf,
+                                                              size_t firstBit,
+                                                              uint64_t recordCount )
+{
+   const bool checkLimits = ( destBuffer_->validationLevel() == ValidationDeep );
+
+   uint64_t record = 0;
+
+   // Records are all bitsPerRecord_ long, so the ones stepped over are never looked at
+   while ( record < recordCount )
+   {
+      uint64_t consumedCount = 0;
+      const uint64_t keptCount =
+         recordsKept( currentRecordIndex_ + record, recordCount - record,
+                      destBuffer_->capacity() - destBuffer_->nextIndex(), consumedCount );
+
+      if ( keptCount == 0 )
+      {
+         record += consumedCount;
+         break;
+      }
+
+      // The first record kept, then every recordStride_ records
+      const uint64_t first = record + recordsToSkip( currentRecordIndex_ + record );
+
+      for ( uint64_t k = 0; k < keptCount; ++k )
+      {
+         const uint64_t bit = firstBit + ( first + k * recordStride_ ) * bitsPerRecord_;
+         const auto wordPosition = static_cast<unsigned>( bit / RegisterBits );
+         const auto bitOffset = static_cast<size_t>( bit % RegisterBits );
+
+         RegisterT w = loadWord<RegisterT>( inbuf, wordPosition );
+
+         if ( bitOffset + bitsPerRecord_ > RegisterBits )
+         {
+            const RegisterT high = loadWord<RegisterT>( inbuf, wordPosition + 1 );
+            w = ( high << ( RegisterBits - bitOffset ) ) | ( w >> bitOffset );
+         }
+         else if ( bitOffset != 0 )
+         {
+            w >>= bitOffset;
+         }
+
+         const int64_t value = minimum_ + static_cast<uint64_t>( w & destBitMask_ );
+
+         if ( checkLimits && ( value < minimum_ || maximum_ < value ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "rawValue=" + toString( value ) +
+                                                       " minimum=" + toString( minimum_ ) +
+                                                       " maximum=" + toString( maximum_ ) );
+         }
+
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64( value, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64( value );
+         }
+      }
+
+      record += consumedCount;
+   }
+
+   currentRecordIndex_ += record;
+
+   return static_cast<size_t>( record * bitsPerRecord_ );
+}
+
+template <typename RegisterT>
+bool BitpackIntegerDecoder<RegisterT>::recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                                                       unsigned &firstBit ) const
+{
+   // Records are packed into words without padding
+   const uint64_t bitOffset = recordIndex * bitsPerRecord_;
+
+   byteOffset = ( bitOffset / RegisterBits ) * sizeof( RegisterT );
+   firstBit = static_cast<unsigned>( bitOffset % RegisterBits );
+
+   return true;
+}
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 template <typename RegisterT>
 void BitpackIntegerDecoder<RegisterT>::dump( int indent, std::ostream &os )
@@ -850,14 +1335,450 @@ void BitpackIntegerDecoder<RegisterT>::dump( int indent, std::ostream &os )
 }
 #endif
 
+DeltaIntegerDecoder::DeltaIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber,
+                                          SourceDestBuffer &dbuf, int64_t minimum, int64_t maximum,
+                                          double scale, double offset, unsigned order,
+                                          uint64_t maxRecordCount ) :
+   Decoder( bytestreamNumber, maxRecordCount ), destBuffer_( dbuf.impl() ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), maximum_( maximum ), scale_( scale ),
+   offset_( offset ), order_( order ), baseSize_( deltaBaseSize( minimum, maximum ) )
+{
+   static_assert( sizeof( values_ ) / sizeof( values_[0] ) == DELTA_BLOCK_SIZE,
+                  "Unexpected delta block size" );
+
+   inBuffer_.reserve( DELTA_BLOCK_MAX_SIZE );
+}
+
+void DeltaIntegerDecoder::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
+{
+   if ( dbufs.size() != 1 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "dbufsSize=" + toString( dbufs.size() ) );
+   }
+
+   destBuffer_ = dbufs.at( 0 ).impl();
+}
+
+size_t DeltaIntegerDecoder::inputProcess( const char *source, const size_t availableByteCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "DeltaIntegerDecoder::inputprocess() called, source=" << (void *)( source )
+             << " availableByteCount=" << availableByteCount << std::endl;
+#endif
+
+   size_t consumed = 0;
+
+   while ( true )
+   {
+      outputValues();
+
+      // Stop once the caller's buffer is full, or we have all the records
+      if ( ( valueNext_ < valueCount_ ) || ( currentRecordIndex_ >= maxRecordCount_ ) )
+      {
+         break;
+      }
+
+      const size_t available = availableByteCount - consumed;
+
+      if ( available == 0 )
+      {
+         break;
+      }
+
+      // Decode whole blocks straight from the input
+      if ( inBuffer_.empty() && ( available >= DELTA_BLOCK_HEADER_SIZE ) )
+      {
+         const size_t length = blockLength( &source[consumed] );
+
+         if ( available >= length )
+         {
+            decodeBlock( &source[consumed] );
+            consumed += length;
+            continue;
+         }
+      }
+
+      // Otherwise gather the block in inBuffer_, starting with its header to find its length
+      const size_t needed = ( inBuffer_.size() < DELTA_BLOCK_HEADER_SIZE )
+                               ? DELTA_BLOCK_HEADER_SIZE
+                               : blockLength( inBuffer_.data() );
+      const size_t count = std::min( needed - inBuffer_.size(), available );
+
+      inBuffer_.insert( inBuffer_.end(), &source[consumed], &source[consumed + count] );
+      consumed += count;
+
+      if ( ( inBuffer_.size() >= DELTA_BLOCK_HEADER_SIZE ) &&
+           ( inBuffer_.size() == blockLength( inBuffer_.data() ) ) )
+      {
+         decodeBlock( inBuffer_.data() );
+         inBuffer_.clear();
+      }
+   }
+
+   return consumed;
+}
+
+size_t DeltaIntegerDecoder::blockLength( const char *block ) const
+{
+   const auto header = reinterpret_cast<const uint8_t *>( block );
+   const unsigned recordCount = header[0] + 1U;
+   const unsigned width = header[1];
+
+   if ( width > 64 )
+   {
+      throw E57_EXCEPTION2( ErrorBadCVPacket, "width=" + toString( width ) );
+   }
+
+   return DELTA_BLOCK_HEADER_SIZE + baseSize_ + ( ( recordCount - 1 ) * width + 7 ) / 8;
+}
+
+void DeltaIntegerDecoder::decodeBlock( const char *block )
+{
+   auto inp = reinterpret_cast<const uint8_t *>( block );
+
+   valueCount_ = *inp++ + 1U;
+   valueNext_ = 0;
+
+   const unsigned width = *inp++;
+
+   uint64_t values[DELTA_BLOCK_SIZE];
+
+   values[0] = 0;
+   for ( unsigned b = 0; b < baseSize_; b++ )
+   {
+      values[0] |= static_cast<uint64_t>( *inp++ ) << ( 8 * b );
+   }
+
+   // Unpack up to 32 bits at a time so they always fit in the register with what is left in it
+   uint64_t bitRegister = 0;
+   unsigned bitsAvailable = 0;
+
+   auto getBits = [&]( unsigned bitCount ) {
+      while ( bitsAvailable < bitCount )
+      {
+         bitRegister |= static_cast<uint64_t>( *inp++ ) << bitsAvailable;
+         bitsAvailable += 8;
+      }
+
+      const uint64_t value =
+         ( bitCount == 0 ) ? 0 : bitRegister & ( ~uint64_t{ 0 } >> ( 64 - bitCount ) );
+
+      bitRegister >>= bitCount;
+      bitsAvailable -= bitCount;
+
+      return value;
+   };
+
+   for ( size_t i = 1; i < valueCount_; i++ )
+   {
+      uint64_t residual = 0;
+
+      if ( width > 32 )
+      {
+         residual = getBits( 32 );
+         residual |= getBits( width - 32 ) << 32;
+      }
+      else
+      {
+         residual = getBits( width );
+      }
+
+      values[i] = deltaPrediction( order_, values, i ) + deltaUnzigzag( residual );
+   }
+
+   const bool checkLimits = ( destBuffer_->validationLevel() != ValidationNone );
+
+   for ( size_t i = 0; i < valueCount_; i++ )
+   {
+      const auto rawValue =
+         static_cast<int64_t>( values[i] + static_cast<uint64_t>( minimum_ ) );
+
+      if ( checkLimits && ( rawValue < minimum_ || maximum_ < rawValue ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "rawValue=" + toString( rawValue ) +
+                                                    " minimum=" + toString( minimum_ ) +
+                                                    " maximum=" + toString( maximum_ ) );
+      }
+
+      values_[i] = rawValue;
+   }
+}
+
+void DeltaIntegerDecoder::outputValues()
+{
+   const uint64_t remainingRecordCount =
+      maxRecordCount_ - std::min( currentRecordIndex_, maxRecordCount_ );
+
+   if ( recordStride_ > 1 )
+   {
+      uint64_t consumedCount = 0;
+      const uint64_t count = std::min<uint64_t>( valueCount_ - valueNext_, remainingRecordCount );
+      const uint64_t keptCount =
+         recordsKept( currentRecordIndex_, count,
+                      destBuffer_->capacity() - destBuffer_->nextIndex(), consumedCount );
+      const uint64_t first = valueNext_ + recordsToSkip( currentRecordIndex_ );
+
+      for ( uint64_t k = 0; k < keptCount; ++k )
+      {
+         const int64_t value = values_[first + k * recordStride_];
+
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64( value, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64( value );
+         }
+      }
+
+      valueNext_ += static_cast<size_t>( consumedCount );
+      currentRecordIndex_ += consumedCount;
+      return;
+   }
+
+   size_t count = std::min( valueCount_ - valueNext_,
+                            destBuffer_->capacity() - destBuffer_->nextIndex() );
+
+   count = static_cast<size_t>( std::min<uint64_t>( count, remainingRecordCount ) );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   if ( isScaledInteger_ )
+   {
+      destBuffer_->setNextInt64Block( &values_[valueNext_], count, scale_, offset_ );
+   }
+   else
+   {
+      destBuffer_->setNextInt64Block( &values_[valueNext_], count );
+   }
+
+   valueNext_ += count;
+   currentRecordIndex_ += count;
+}
+
+void DeltaIntegerDecoder::stateReset( uint64_t recordIndex, unsigned /*firstBit*/ )
+{
+   currentRecordIndex_ = recordIndex;
+   valueCount_ = 0;
+   valueNext_ = 0;
+   inBuffer_.clear();
+}
+
+bool DeltaIntegerDecoder::recordPosition( uint64_t /*recordIndex*/, uint64_t & /*byteOffset*/,
+                                          unsigned & /*firstBit*/ ) const
+{
+   // Blocks vary in size
+   return false;
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void DeltaIntegerDecoder::dump( int indent, std::ostream &os )
+{
+   os << space( indent ) << "bytestreamNumber:   " << bytestreamNumber_ << std::endl;
+   os << space( indent ) << "currentRecordIndex: " << currentRecordIndex_ << std::endl;
+   os << space( indent ) << "maxRecordCount:     " << maxRecordCount_ << std::endl;
+   os << space( indent ) << "isScaledInteger:    " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:            " << minimum_ << std::endl;
+   os << space( indent ) << "maximum:            " << maximum_ << std::endl;
+   os << space( indent ) << "order:              " << order_ << std::endl;
+   os << space( indent ) << "valueCount:         " << valueCount_ << std::endl;
+   os << space( indent ) << "valueNext:          " << valueNext_ << std::endl;
+   os << space( indent ) << "destBuffer:" << std::endl;
+   destBuffer_->dump( indent + 4, os );
+}
+#endif
+
+//================================================================
+
+RunLengthIntegerDecoder::RunLengthIntegerDecoder( bool isScaledInteger,
+                                                  unsigned bytestreamNumber,
+                                                  SourceDestBuffer &dbuf, int64_t minimum,
+                                                  int64_t maximum, double scale, double offset,
+                                                  uint64_t maxRecordCount ) :
+   Decoder( bytestreamNumber, maxRecordCount ), destBuffer_( dbuf.impl() ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), maximum_( maximum ), scale_( scale ),
+   offset_( offset ), valueSize_( runLengthValueSize( minimum, maximum ) )
+{
+   inBuffer_.reserve( RUN_LENGTH_RUN_MAX_SIZE );
+}
+
+void RunLengthIntegerDecoder::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
+{
+   if ( dbufs.size() != 1 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "dbufsSize=" + toString( dbufs.size() ) );
+   }
+
+   destBuffer_ = dbufs.at( 0 ).impl();
+}
+
+size_t RunLengthIntegerDecoder::inputProcess( const char *source,
+                                              const size_t availableByteCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "RunLengthIntegerDecoder::inputprocess() called, source=" << (void *)( source )
+             << " availableByteCount=" << availableByteCount << std::endl;
+#endif
+
+   size_t consumed = 0;
+
+   while ( true )
+   {
+      outputRun();
+
+      // Stop once the caller's buffer is full, or we have all the records
+      if ( ( runRemaining_ > 0 ) || ( currentRecordIndex_ >= maxRecordCount_ ) )
+      {
+         break;
+      }
+
+      const size_t available = availableByteCount - consumed;
+
+      if ( available == 0 )
+      {
+         break;
+      }
+
+      uint64_t recordCount = 0;
+      uint64_t value = 0;
+
+      // Read whole runs straight from the input
+      if ( inBuffer_.empty() )
+      {
+         const size_t runSize =
+            runLengthReadRun( &source[consumed], available, valueSize_, recordCount, value );
+
+         if ( runSize > 0 )
+         {
+            startRun( recordCount, value );
+            consumed += runSize;
+            continue;
+         }
+      }
+
+      // Otherwise gather the run in inBuffer_ a byte at a time, since we don't know its length
+      inBuffer_.push_back( source[consumed++] );
+
+      if ( runLengthReadRun( inBuffer_.data(), inBuffer_.size(), valueSize_, recordCount,
+                             value ) > 0 )
+      {
+         startRun( recordCount, value );
+         inBuffer_.clear();
+      }
+   }
+
+   return consumed;
+}
+
+void RunLengthIntegerDecoder::startRun( uint64_t recordCount, uint64_t value )
+{
+   const auto rawValue = static_cast<int64_t>( value + static_cast<uint64_t>( minimum_ ) );
+
+   if ( destBuffer_->validationLevel() != ValidationNone &&
+        ( rawValue < minimum_ || maximum_ < rawValue ) )
+   {
+      throw E57_EXCEPTION2( ErrorBadCVPacket, "rawValue=" + toString( rawValue ) +
+                                                 " minimum=" + toString( minimum_ ) +
+                                                 " maximum=" + toString( maximum_ ) );
+   }
+
+   runValue_ = rawValue;
+   runRemaining_ = recordCount;
+}
+
+void RunLengthIntegerDecoder::outputRun()
+{
+   const uint64_t remainingRecordCount =
+      maxRecordCount_ - std::min( currentRecordIndex_, maxRecordCount_ );
+
+   uint64_t count = std::min( runRemaining_, remainingRecordCount );
+
+   if ( recordStride_ > 1 )
+   {
+      uint64_t consumedCount = 0;
+      const uint64_t keptCount =
+         recordsKept( currentRecordIndex_, count,
+                      destBuffer_->capacity() - destBuffer_->nextIndex(), consumedCount );
+
+      if ( isScaledInteger_ )
+      {
+         destBuffer_->setNextInt64Fill( runValue_, static_cast<size_t>( keptCount ), scale_,
+                                        offset_ );
+      }
+      else
+      {
+         destBuffer_->setNextInt64Fill( runValue_, static_cast<size_t>( keptCount ) );
+      }
+
+      runRemaining_ -= consumedCount;
+      currentRecordIndex_ += consumedCount;
+      return;
+   }
+
+   count = std::min<uint64_t>( count, destBuffer_->capacity() - destBuffer_->nextIndex() );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   if ( isScaledInteger_ )
+   {
+      destBuffer_->setNextInt64Fill( runValue_, static_cast<size_t>( count ), scale_, offset_ );
+   }
+   else
+   {
+      destBuffer_->setNextInt64Fill( runValue_, static_cast<size_t>( count ) );
+   }
+
+   runRemaining_ -= count;
+   currentRecordIndex_ += count;
+}
+
+void RunLengthIntegerDecoder::stateReset( uint64_t recordIndex, unsigned /*firstBit*/ )
+{
+   currentRecordIndex_ = recordIndex;
+   runRemaining_ = 0;
+   inBuffer_.clear();
+}
+
+bool RunLengthIntegerDecoder::recordPosition( uint64_t /*recordIndex*/,
+                                              uint64_t & /*byteOffset*/,
+                                              unsigned & /*firstBit*/ ) const
+{
+   // Runs vary in size
+   return false;
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void RunLengthIntegerDecoder::dump( int indent, std::ostream &os )
+{
+   os << space( indent ) << "bytestreamNumber:   " << bytestreamNumber_ << std::endl;
+   os << space( indent ) << "currentRecordIndex: " << currentRecordIndex_ << std::endl;
+   os << space( indent ) << "maxRecordCount:     " << maxRecordCount_ << std::endl;
+   os << space( indent ) << "isScaledInteger:    " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:            " << minimum_ << std::endl;
+   os << space( indent ) << "maximum:            " << maximum_ << std::endl;
+   os << space( indent ) << "runValue:           " << runValue_ << std::endl;
+   os << space( indent ) << "runRemaining:       " << runRemaining_ << std::endl;
+   os << space( indent ) << "destBuffer:" << std::endl;
+   destBuffer_->dump( indent + 4, os );
+}
+#endif
+
+//================================================================
+
 //================================================================
 
 ConstantIntegerDecoder::ConstantIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber,
                                                 SourceDestBuffer &dbuf, int64_t minimum,
                                                 double scale, double offset,
                                                 uint64_t maxRecordCount ) :
-   Decoder( bytestreamNumber ),
-   maxRecordCount_( maxRecordCount ), destBuffer_( dbuf.impl() ),
+   Decoder( bytestreamNumber, maxRecordCount ), destBuffer_( dbuf.impl() ),
    isScaledInteger_( isScaledInteger ), minimum_( minimum ), scale_( scale ), offset_( offset )
 {
 }
@@ -888,7 +1809,15 @@ size_t ConstantIntegerDecoder::inputProcess( const char *source, const size_t av
    // Fill dest buffer unless get to maxRecordCount
    size_t count = destBuffer_->capacity() - destBuffer_->nextIndex();
    uint64_t remainingRecordCount = maxRecordCount_ - currentRecordIndex_;
-   if ( static_cast<uint64_t>( count ) > remainingRecordCount )
+
+   uint64_t consumedCount = 0;
+
+   if ( recordStride_ > 1 )
+   {
+      count = static_cast<size_t>(
+         recordsKept( currentRecordIndex_, remainingRecordCount, count, consumedCount ) );
+   }
+   else if ( static_cast<uint64_t>( count ) > remainingRecordCount )
    {
       count = static_cast<unsigned>( remainingRecordCount );
    }
@@ -907,12 +1836,23 @@ size_t ConstantIntegerDecoder::inputProcess( const char *source, const size_t av
          destBuffer_->setNextInt64( minimum_ );
       }
    }
-   currentRecordIndex_ += count;
+   currentRecordIndex_ += ( recordStride_ > 1 ) ? consumedCount : count;
    return ( count );
 }
 
-void ConstantIntegerDecoder::stateReset()
+void ConstantIntegerDecoder::stateReset( uint64_t recordIndex, unsigned /*firstBit*/ )
 {
+   currentRecordIndex_ = recordIndex;
+}
+
+bool ConstantIntegerDecoder::recordPosition( uint64_t /*recordIndex*/, uint64_t &byteOffset,
+                                             unsigned &firstBit ) const
+{
+   // Nothing is stored in the bytestream
+   byteOffset = 0;
+   firstBit = 0;
+
+   return true;
 }
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
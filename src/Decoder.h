@@ -44,21 +44,67 @@ namespace e57
       virtual void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) = 0;
       virtual uint64_t totalRecordsCompleted() = 0;
       virtual size_t inputProcess( const char *source, size_t count ) = 0;
-      virtual void stateReset() = 0;
+
+      /// Discard any buffered input and partly decoded record so decoding can restart at the
+      /// beginning of recordIndex (e.g. at the start of a chunk after a seek). The record starts
+      /// at firstBit of the first word of the next input.
+      virtual void stateReset( uint64_t recordIndex, unsigned firstBit ) = 0;
+
+      /// If every record takes the same number of bits in the bytestream, get the offset of the
+      /// word recordIndex starts in, and the bit it starts at in that word.
+      /// @returns false if records vary in size (e.g. strings)
+      virtual bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                                   unsigned &firstBit ) const = 0;
 
       unsigned bytestreamNumber() const
       {
          return bytestreamNumber_;
       }
 
+      /// Bytes of input the decoder can hold on to between calls to inputProcess(), counted in
+      /// the file's memory usage (see ImageFile::memoryUsage())
+      virtual size_t bufferSize() const
+      {
+         return 0;
+      }
+
+      /// Decode another CompressedVector of the same layout, which has maxRecordCount records.
+      /// Followed by a stateReset().
+      void setMaxRecordCount( uint64_t maxRecordCount )
+      {
+         maxRecordCount_ = maxRecordCount;
+      }
+
+      /// Only pass every stride-th record on to the dest buffer, starting with firstRecord, and
+      /// step over the others (see CompressedVectorReader::setRecordStride()). A stride of 1 passes
+      /// on every record again.
+      void setRecordStride( uint64_t stride, uint64_t firstRecord )
+      {
+         recordStride_ = stride;
+         strideFirstRecord_ = firstRecord;
+      }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       virtual void dump( int indent = 0, std::ostream &os = std::cout ) = 0;
 #endif
 
    protected:
-      explicit Decoder( unsigned bytestreamNumber );
+      Decoder( unsigned bytestreamNumber, uint64_t maxRecordCount );
+
+      /// Number of records from recordIndex on to step over before the next one passed on
+      uint64_t recordsToSkip( uint64_t recordIndex ) const;
+
+      /// Number of the count records from recordIndex on which are passed on, with room for no
+      /// more than roomCount of them in the dest buffer
+      /// @param [out] consumedCount records that takes: all count, unless the dest buffer fills, in
+      /// which case up to just after the last one passed on
+      uint64_t recordsKept( uint64_t recordIndex, uint64_t count, uint64_t roomCount,
+                            uint64_t &consumedCount ) const;
 
       unsigned int bytestreamNumber_;
+      uint64_t maxRecordCount_;
+      uint64_t recordStride_ = 1;
+      uint64_t strideFirstRecord_ = 0;
    };
 
    class BitpackDecoder : public Decoder
@@ -74,7 +120,12 @@ namespace e57
       size_t inputProcess( const char *source, size_t availableByteCount ) override;
       virtual size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) = 0;
 
-      void stateReset() override;
+      void stateReset( uint64_t recordIndex, unsigned firstBit ) override;
+
+      size_t bufferSize() const override
+      {
+         return inBuffer_.size();
+      }
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
@@ -84,19 +135,28 @@ namespace e57
       BitpackDecoder( unsigned bytestreamNumber, SourceDestBuffer &dbuf, unsigned alignmentSize,
                       uint64_t maxRecordCount );
 
+      bool canProcessInPlace( const char *source ) const;
+      size_t inputProcessInPlace( const char *source, size_t availableByteCount );
+      size_t inputProcessBuffered( const char *source, size_t availableByteCount );
+      bool isOutputFull() const;
       void inBufferShiftDown();
 
       uint64_t currentRecordIndex_ = 0;
-      uint64_t maxRecordCount_ = 0;
 
       std::shared_ptr<SourceDestBufferImpl> destBuffer_;
 
+      // Input is decoded straight from the caller's memory unless some is left over from before.
+      // inBuffer_ holds what is left over (e.g. a record which straddles two packets) together
+      // with enough of the next input to finish it.
       std::vector<char> inBuffer_;
       size_t inBufferFirstBit_ = 0;
       size_t inBufferEndByte_ = 0;
       unsigned int inBufferAlignmentSize_;
       unsigned int bitsPerWord_;
       unsigned int bytesPerWord_;
+
+      // Alignment inputProcessAligned() needs to work on the caller's memory
+      unsigned int inPlaceAlignment_ = 1;
    };
 
    class BitpackFloatDecoder : public BitpackDecoder
@@ -107,11 +167,17 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
 
    protected:
+      /// inputProcessAligned() with a record stride, for the recordCount records in inbuf
+      size_t inputProcessStrided( const char *inbuf, uint64_t recordCount );
+
       FloatPrecision precision_ = PrecisionSingle;
    };
 
@@ -123,6 +189,11 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      void stateReset( uint64_t recordIndex, unsigned firstBit ) override;
+
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -146,11 +217,17 @@ namespace e57
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
 
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
 
    protected:
+      /// inputProcessAligned() with a record stride, for the recordCount records from firstBit
+      size_t inputProcessStrided( const char *inbuf, size_t firstBit, uint64_t recordCount );
+
       bool isScaledInteger_;
       int64_t minimum_;
       int64_t maximum_;
@@ -159,6 +236,117 @@ namespace e57
       unsigned bitsPerRecord_;
       RegisterT destBitMask_;
       static constexpr size_t RegisterBits = sizeof( RegisterT ) * 8;
+
+      /// Unpacks RegisterBits records starting at the first bit of inp (which fill exactly
+      /// bitsPerRecord_ words, not necessarily aligned) into values, adding minimum. Chosen for
+      /// bitsPerRecord_ in the ctor.
+      using BlockUnpacker = void ( * )( const char *inp, int64_t minimum, int64_t *values );
+      BlockUnpacker unpackBlock_;
+   };
+
+   /// Integers stored with the delta codec extension (see DeltaCodec.h)
+   class DeltaIntegerDecoder : public Decoder
+   {
+   public:
+      DeltaIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &dbuf,
+                           int64_t minimum, int64_t maximum, double scale, double offset,
+                           unsigned order, uint64_t maxRecordCount );
+      void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
+
+      uint64_t totalRecordsCompleted() override
+      {
+         return currentRecordIndex_;
+      }
+
+      size_t inputProcess( const char *source, size_t availableByteCount ) override;
+      void stateReset( uint64_t recordIndex, unsigned firstBit ) override;
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
+
+      size_t bufferSize() const override
+      {
+         return inBuffer_.capacity();
+      }
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) override;
+#endif
+
+   protected:
+      size_t blockLength( const char *block ) const;
+      void decodeBlock( const char *block );
+      void outputValues();
+
+      uint64_t currentRecordIndex_ = 0;
+
+      std::shared_ptr<SourceDestBufferImpl> destBuffer_;
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      int64_t maximum_;
+      double scale_;
+      double offset_;
+      unsigned order_;
+      unsigned baseSize_;
+
+      // Values of the last block decoded, from valueNext_ on still to go to destBuffer_
+      int64_t values_[64] = {};
+      size_t valueCount_ = 0;
+      size_t valueNext_ = 0;
+
+      // Input of a block which straddles two inputs
+      std::vector<char> inBuffer_;
+   };
+
+   /// Integers stored with the run-length codec extension (see RunLengthCodec.h)
+   class RunLengthIntegerDecoder : public Decoder
+   {
+   public:
+      RunLengthIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber,
+                               SourceDestBuffer &dbuf, int64_t minimum, int64_t maximum,
+                               double scale, double offset, uint64_t maxRecordCount );
+      void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
+
+      uint64_t totalRecordsCompleted() override
+      {
+         return currentRecordIndex_;
+      }
+
+      size_t inputProcess( const char *source, size_t availableByteCount ) override;
+      void stateReset( uint64_t recordIndex, unsigned firstBit ) override;
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
+
+      size_t bufferSize() const override
+      {
+         return inBuffer_.capacity();
+      }
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) override;
+#endif
+
+   protected:
+      void startRun( uint64_t recordCount, uint64_t value );
+      void outputRun();
+
+      uint64_t currentRecordIndex_ = 0;
+
+      std::shared_ptr<SourceDestBufferImpl> destBuffer_;
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      int64_t maximum_;
+      double scale_;
+      double offset_;
+      unsigned valueSize_;
+
+      // Value of the last run read, and how many of its records are still to go to destBuffer_
+      int64_t runValue_ = 0;
+      uint64_t runRemaining_ = 0;
+
+      // Input of a run which straddles two inputs
+      std::vector<char> inBuffer_;
    };
 
    class ConstantIntegerDecoder : public Decoder
@@ -175,7 +363,9 @@ namespace e57
       }
 
       size_t inputProcess( const char *source, size_t availableByteCount ) override;
-      void stateReset() override;
+      void stateReset( uint64_t recordIndex, unsigned firstBit ) override;
+      bool recordPosition( uint64_t recordIndex, uint64_t &byteOffset,
+                           unsigned &firstBit ) const override;
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
@@ -183,7 +373,6 @@ namespace e57
 
    protected:
       uint64_t currentRecordIndex_ = 0;
-      uint64_t maxRecordCount_;
 
       std::shared_ptr<SourceDestBufferImpl> destBuffer_;
 
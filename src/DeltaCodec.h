@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IntegerNodeImpl.h"
+#include "StringFunctions.h"
+#include "StructureNodeImpl.h"
+
+namespace e57
+{
+   // Layout of bytestreams written with the delta codec extension (see DELTA_CODEC_URI).
+   //
+   // The values are stored in blocks of up to DELTA_BLOCK_SIZE records. Only the last block may
+   // be shorter, so blocks start on a multiple of DELTA_BLOCK_SIZE records, and so does every
+   // chunk (see CHUNK_RECORD_ALIGNMENT). Each block is:
+   //    uint8    number of records - 1
+   //    uint8    bits per residual (0 to 64)
+   //    base     first value - minimum, in as few bytes as hold maximum - minimum (little endian)
+   //    packed   residuals of the other records, least significant bit first, padded to a byte
+   // A residual is the zigzag encoded difference between value - minimum and its prediction from
+   // the previous value (order 1) or the previous two (order 2), modulo 2^64.
+   constexpr unsigned DELTA_BLOCK_SIZE = 64;
+   constexpr unsigned DELTA_BLOCK_HEADER_SIZE = 2;
+   constexpr unsigned DELTA_BLOCK_MAX_SIZE =
+      DELTA_BLOCK_HEADER_SIZE + 8 + ( DELTA_BLOCK_SIZE - 1 ) * 8;
+
+   inline uint64_t deltaZigzag( uint64_t residual )
+   {
+      return ( residual << 1 ) ^ ( uint64_t{ 0 } - ( residual >> 63 ) );
+   }
+
+   inline uint64_t deltaUnzigzag( uint64_t value )
+   {
+      return ( value >> 1 ) ^ ( uint64_t{ 0 } - ( value & 1 ) );
+   }
+
+   /// Prediction of values[index] (index > 0) from the ones before it in its block
+   inline uint64_t deltaPrediction( unsigned order, const uint64_t *values, size_t index )
+   {
+      if ( order == 2 && index > 1 )
+      {
+         return 2 * values[index - 1] - values[index - 2];
+      }
+
+      return values[index - 1];
+   }
+
+   /// Number of bytes holding the base of a block
+   inline unsigned deltaBaseSize( int64_t minimum, int64_t maximum )
+   {
+      const auto range = static_cast<uint64_t>( maximum ) - static_cast<uint64_t>( minimum );
+
+      unsigned bytes = 1;
+      while ( bytes < 8 && ( range >> ( 8 * bytes ) ) != 0 )
+      {
+         ++bytes;
+      }
+
+      return bytes;
+   }
+
+   /// Prediction order given by the parameters of a deltaCodec
+   /// @throw ::ErrorBadCodecs
+   inline unsigned deltaCodecOrder( StructureNodeImpl &deltaCodec )
+   {
+      if ( !deltaCodec.isDefined( "order" ) )
+      {
+         return 1;
+      }
+
+      const auto order = std::dynamic_pointer_cast<IntegerNodeImpl>( deltaCodec.get( "order" ) );
+
+      if ( !order || order->value() < 1 || order->value() > 2 )
+      {
+         throw E57_EXCEPTION2( ErrorBadCodecs, "deltaCodec/order" );
+      }
+
+      return static_cast<unsigned>( order->value() );
+   }
+}
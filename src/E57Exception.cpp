@@ -358,6 +358,8 @@ namespace e57
             return "an invalid node type was passed in Data3D pointFields";
          case ErrorInvalidData3DValue:
             return "an invalid value was passed in Data3D pointFields";
+         case ErrorBadBlobHeader:
+            return "a Blob binary section header was bad (ErrorBadBlobHeader)";
 
          default:
             return "unknown error (" + std::to_string( ecode ) + ")";
@@ -7,6 +7,7 @@
 // NOLINTNEXTLINE(bugprone-reserved-identifier,cert-dcl37-c)
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstdint>
 
 #include "E57SimpleData.h"
 
@@ -49,13 +50,34 @@ namespace e57
       elevationMaximum = HALF_PI;
    }
 
-   template <typename COORDTYPE>
-   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D ) : _selfAllocated( true )
+   /// Validates a Data3D and adjusts its fields for the COORDTYPE buffers being allocated.
+   template <typename COORDTYPE> void _prepareData3D( Data3D &data3D )
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
-
       _validateData3D( data3D );
 
+      // Raw coordinates are only kept for ScaledIntegers
+      if ( std::is_integral<COORDTYPE>::value )
+      {
+         const PointStandardizedFieldsAvailable &fields = data3D.pointFields;
+
+         if ( ( fields.cartesianXField || fields.cartesianYField || fields.cartesianZField ||
+                fields.sphericalRangeField ) &&
+              ( fields.pointRangeNodeType != NumericalNodeType::ScaledInteger ) )
+         {
+            throw E57_EXCEPTION2( ErrorInvalidNodeType,
+                                  "pointRangeNodeType must be ScaledInteger for int32_t buffers" );
+         }
+
+         if ( ( fields.sphericalAzimuthField || fields.sphericalElevationField ) &&
+              ( fields.angleNodeType != NumericalNodeType::ScaledInteger ) )
+         {
+            throw E57_EXCEPTION2( ErrorInvalidNodeType,
+                                  "angleNodeType must be ScaledInteger for int32_t buffers" );
+         }
+
+         return;
+      }
+
       constexpr bool cIsFloat = std::is_same<COORDTYPE, float>::value;
 
       // We need to adjust min/max for floats.
@@ -84,6 +106,13 @@ namespace e57
          data3D.pointFields.angleNodeType =
             ( cIsFloat ? NumericalNodeType::Float : NumericalNodeType::Double );
       }
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D ) : _selfAllocated( true )
+   {
+
+      _prepareData3D<COORDTYPE>( data3D );
 
       const auto cPointCount = data3D.pointCount;
 
@@ -203,15 +232,100 @@ namespace e57
       }
    }
 
+   /// Calls function( buffer, used ) for each buffer of points, where used is true if the field
+   /// is in fields.
+   template <typename COORDTYPE, typename Function>
+   void _forEachBuffer( Data3DPointsData_t<COORDTYPE> &points,
+                        const PointStandardizedFieldsAvailable &fields, Function function )
+   {
+      function( points.cartesianX, fields.cartesianXField );
+      function( points.cartesianY, fields.cartesianYField );
+      function( points.cartesianZ, fields.cartesianZField );
+      function( points.cartesianInvalidState, fields.cartesianInvalidStateField );
+
+      function( points.intensity, fields.intensityField );
+      function( points.isIntensityInvalid, fields.isIntensityInvalidField );
+
+      function( points.colorRed, fields.colorRedField );
+      function( points.colorGreen, fields.colorGreenField );
+      function( points.colorBlue, fields.colorBlueField );
+      function( points.isColorInvalid, fields.isColorInvalidField );
+
+      function( points.sphericalRange, fields.sphericalRangeField );
+      function( points.sphericalAzimuth, fields.sphericalAzimuthField );
+      function( points.sphericalElevation, fields.sphericalElevationField );
+      function( points.sphericalInvalidState, fields.sphericalInvalidStateField );
+
+      function( points.rowIndex, fields.rowIndexField );
+      function( points.columnIndex, fields.columnIndexField );
+
+      function( points.returnIndex, fields.returnIndexField );
+      function( points.returnCount, fields.returnCountField );
+
+      function( points.timeStamp, fields.timeStampField );
+      function( points.isTimeStampInvalid, fields.isTimeStampInvalidField );
+
+      function( points.normalX, fields.normalXField );
+      function( points.normalY, fields.normalYField );
+      function( points.normalZ, fields.normalZField );
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsData_t<COORDTYPE>::Data3DPointsData_t( Data3D &data3D,
+                                                      Data3DPointsAllocator &allocator ) :
+      _selfAllocated( true ), _allocator( &allocator )
+   {
+
+      _prepareData3D<COORDTYPE>( data3D );
+
+      const auto cPointCount = data3D.pointCount;
+
+      // Lay the buffers out one after the other, each starting on an aligned boundary
+      auto alignedSize = []( size_t size ) {
+         return ( size + DATA3D_POINTS_ALIGNMENT - 1 ) / DATA3D_POINTS_ALIGNMENT *
+                DATA3D_POINTS_ALIGNMENT;
+      };
+
+      size_t blockSize = 0;
+
+      _forEachBuffer( *this, data3D.pointFields, [&]( auto *&buffer, bool used ) {
+         if ( used )
+         {
+            blockSize += alignedSize( cPointCount * sizeof( *buffer ) );
+         }
+      } );
+
+      _block = allocator.allocate( blockSize );
+      _blockSize = blockSize;
+
+      auto next = static_cast<char *>( _block );
+
+      _forEachBuffer( *this, data3D.pointFields, [&]( auto *&buffer, bool used ) {
+         if ( used )
+         {
+            buffer = reinterpret_cast<std::remove_reference_t<decltype( buffer )>>( next );
+            next += alignedSize( cPointCount * sizeof( *buffer ) );
+         }
+      } );
+   }
+
    template <typename COORDTYPE> Data3DPointsData_t<COORDTYPE>::~Data3DPointsData_t()
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
 
       if ( !_selfAllocated )
       {
          return;
       }
 
+      if ( _allocator != nullptr )
+      {
+         _allocator->deallocate( _block, _blockSize );
+
+         // Set them all to nullptr.
+         *this = Data3DPointsData_t<COORDTYPE>();
+         return;
+      }
+
       delete[] cartesianX;
       delete[] cartesianY;
       delete[] cartesianZ;
@@ -247,11 +361,103 @@ namespace e57
       *this = Data3DPointsData_t<COORDTYPE>();
    }
 
+   void *Data3DPointsAllocator::allocate( size_t size )
+   {
+      // Keep the address of the allocation just before the aligned memory we return
+      const size_t cExtra = DATA3D_POINTS_ALIGNMENT - 1 + sizeof( void * );
+
+      auto allocation = static_cast<char *>( ::operator new( size + cExtra ) );
+
+      const auto cAddress = reinterpret_cast<uintptr_t>( allocation + sizeof( void * ) );
+      const auto cAligned = ( cAddress + DATA3D_POINTS_ALIGNMENT - 1 ) &
+                            ~static_cast<uintptr_t>( DATA3D_POINTS_ALIGNMENT - 1 );
+
+      auto memory = reinterpret_cast<char *>( cAligned );
+
+      reinterpret_cast<void **>( memory )[-1] = allocation;
+
+      return memory;
+   }
+
+   void Data3DPointsAllocator::deallocate( void *memory, size_t size )
+   {
+      UNUSED( size );
+
+      if ( memory != nullptr )
+      {
+         ::operator delete( static_cast<void **>( memory )[-1] );
+      }
+   }
+
+   Data3DPointsPool::~Data3DPointsPool()
+   {
+      clear();
+   }
+
+   void *Data3DPointsPool::allocate( size_t size )
+   {
+      // Use the smallest free block the request fits in
+      auto best = freeBlocks_.end();
+
+      for ( auto block = freeBlocks_.begin(); block != freeBlocks_.end(); ++block )
+      {
+         if ( ( block->size >= size ) &&
+              ( ( best == freeBlocks_.end() ) || ( block->size < best->size ) ) )
+         {
+            best = block;
+         }
+      }
+
+      if ( best == freeBlocks_.end() )
+      {
+         return Data3DPointsAllocator::allocate( size );
+      }
+
+      void *memory = best->memory;
+
+      freeBlocks_.erase( best );
+
+      return memory;
+   }
+
+   void Data3DPointsPool::deallocate( void *memory, size_t size )
+   {
+      if ( memory != nullptr )
+      {
+         freeBlocks_.push_back( { memory, size } );
+      }
+   }
+
+   void Data3DPointsPool::clear()
+   {
+      for ( const Block &block : freeBlocks_ )
+      {
+         Data3DPointsAllocator::deallocate( block.memory, block.size );
+      }
+
+      freeBlocks_.clear();
+   }
+
+   const Data3DPointColumn *Data3DPointBlock::column( const ustring &name ) const
+   {
+      for ( const Data3DPointColumn &column : columns )
+      {
+         if ( column.name == name )
+         {
+            return &column;
+         }
+      }
+
+      return nullptr;
+   }
+
 #if defined( WIN32 ) || defined( _WIN32 ) || defined( WINCE )
    template struct E57_DLL Data3DPointsData_t<float>;
    template struct E57_DLL Data3DPointsData_t<double>;
+   template struct E57_DLL Data3DPointsData_t<int32_t>;
 #else
    template struct Data3DPointsData_t<float>;
    template struct Data3DPointsData_t<double>;
+   template struct Data3DPointsData_t<int32_t>;
 #endif
 } // end namespace e57
@@ -27,15 +27,95 @@
  */
 
 #include "E57SimpleReader.h"
+#include "DatasetReaderImpl.h"
 #include "ReaderImpl.h"
 
 namespace e57
 {
+   namespace
+   {
+      // A MetadataReader always parses its blocks on demand
+      ReaderOptions lazyOptions( const ReaderOptions &options )
+      {
+         ReaderOptions lazy( options );
+         lazy.lazyLoad = true;
+
+         return lazy;
+      }
+
+      template <typename BUFFERS>
+      DatasetReader::Task readData3DTask( int64_t dataIndex, BUFFERS &buffers )
+      {
+         return [dataIndex, &buffers]( Reader &reader ) {
+            reader.ReadData3DPointsData( { dataIndex }, { &buffers }, 1 );
+         };
+      }
+   }
+
+   Data3DPointBlocks::Data3DPointBlocks( std::shared_ptr<Data3DPointBlocksImpl> impl ) :
+      impl_( std::move( impl ) )
+   {
+   }
+
+   bool Data3DPointBlocks::next()
+   {
+      return impl_->next();
+   }
+
+   const Data3DPointBlock &Data3DPointBlocks::block() const
+   {
+      return impl_->block();
+   }
+
+   Data3DPointBlocks::Iterator Data3DPointBlocks::begin()
+   {
+      if ( !impl_->started() )
+      {
+         next();
+      }
+
+      return impl_->finished() ? end() : Iterator( this );
+   }
+
+   Data3DPointBlocks::Iterator Data3DPointBlocks::end()
+   {
+      return Iterator();
+   }
+
+   Data3DPointBlocks::Iterator::Iterator( Data3DPointBlocks *blocks ) : blocks_( blocks )
+   {
+   }
+
+   Data3DPointBlocks::Iterator::reference Data3DPointBlocks::Iterator::operator*() const
+   {
+      return blocks_->block();
+   }
+
+   Data3DPointBlocks::Iterator::pointer Data3DPointBlocks::Iterator::operator->() const
+   {
+      return &blocks_->block();
+   }
+
+   Data3DPointBlocks::Iterator &Data3DPointBlocks::Iterator::operator++()
+   {
+      if ( !blocks_->next() )
+      {
+         blocks_ = nullptr;
+      }
+
+      return *this;
+   }
+
    Reader::Reader( const ustring &filePath, const ReaderOptions &options ) :
       impl_( new ReaderImpl( filePath, options ) )
    {
    }
 
+   Reader::Reader( std::shared_ptr<ImageFileIO> io, const ReaderOptions &options ) :
+      impl_( new ReaderImpl( std::move( io ), options ) )
+   {
+   }
+
    // Note that this constructor is deprecated (see header).
    Reader::Reader( const ustring &filePath ) : Reader( filePath, {} )
    {
@@ -88,6 +168,18 @@ namespace e57
       return static_cast<int64_t>( read );
    }
 
+   BlobView Reader::GetImage2DView( int64_t imageIndex, Image2DProjection imageProjection,
+                                    Image2DType imageType ) const
+   {
+      return impl_->GetImage2DView( imageIndex, imageProjection, imageType );
+   }
+
+   bool Reader::ReadImage2DDataParallel( std::vector<Image2DRead> &reads,
+                                         unsigned int threadCount ) const
+   {
+      return impl_->ReadImage2DDataParallel( reads, threadCount );
+   }
+
    int64_t Reader::GetData3DCount() const
    {
       return impl_->GetData3DCount();
@@ -133,6 +225,12 @@ namespace e57
                                           pointCount );
    }
 
+   bool Reader::GetData3DScaling( int64_t dataIndex, const ustring &fieldName, double &scale,
+                                  double &offset ) const
+   {
+      return impl_->GetData3DScaling( dataIndex, fieldName, scale, offset );
+   }
+
    CompressedVectorReader Reader::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                          const Data3DPointsFloat &buffers ) const
    {
@@ -144,4 +242,208 @@ namespace e57
    {
       return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
    }
+
+   CompressedVectorReader Reader::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                         const Data3DPointsInt32 &buffers ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
+   }
+
+   CompressedVectorReader Reader::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsInterleaved &buffers ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
+   }
+
+   void Reader::RestartData3DPointsData( int64_t dataIndex, CompressedVectorReader &reader ) const
+   {
+      impl_->RestartData3DPointsData( dataIndex, reader );
+   }
+
+   bool Reader::ReadData3DZones( int64_t dataIndex, std::vector<Data3DZone> &zones ) const
+   {
+      return impl_->ReadData3DZones( dataIndex, zones );
+   }
+
+   std::vector<Data3DZone> Reader::FindData3DZones( int64_t dataIndex,
+                                                    const CartesianBounds &box ) const
+   {
+      return impl_->FindData3DZones( dataIndex, box );
+   }
+
+   Data3DPointBlocks Reader::ReadData3DPointBlocks( int64_t dataIndex,
+                                                    const std::vector<ustring> &fields,
+                                                    size_t blockSize ) const
+   {
+      return impl_->ReadData3DPointBlocks( dataIndex, fields, blockSize );
+   }
+
+   bool Reader::ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                      const std::vector<Data3DPointsFloat *> &buffers,
+                                      unsigned int threadCount,
+                                      const Data3DReadCallback &callback ) const
+   {
+      return impl_->ReadData3DPointsData( dataIndices, buffers, threadCount, callback );
+   }
+
+   bool Reader::ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                      const std::vector<Data3DPointsDouble *> &buffers,
+                                      unsigned int threadCount,
+                                      const Data3DReadCallback &callback ) const
+   {
+      return impl_->ReadData3DPointsData( dataIndices, buffers, threadCount, callback );
+   }
+
+   bool Reader::ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                      const std::vector<Data3DPointsInt32 *> &buffers,
+                                      unsigned int threadCount,
+                                      const Data3DReadCallback &callback ) const
+   {
+      return impl_->ReadData3DPointsData( dataIndices, buffers, threadCount, callback );
+   }
+
+   bool Reader::ReadData3DPointsDataParallel( int64_t dataIndex, Data3DPointsFloat &buffers,
+                                              unsigned int threadCount ) const
+   {
+      return impl_->ReadData3DPointsDataParallel( dataIndex, buffers, threadCount );
+   }
+
+   bool Reader::ReadData3DPointsDataParallel( int64_t dataIndex, Data3DPointsDouble &buffers,
+                                              unsigned int threadCount ) const
+   {
+      return impl_->ReadData3DPointsDataParallel( dataIndex, buffers, threadCount );
+   }
+
+   int64_t Reader::ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                      Data3DPointsFloat &buffers ) const
+   {
+      return impl_->ReadData3DPreview( dataIndex, maxPointCount, buffers );
+   }
+
+   int64_t Reader::ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                      Data3DPointsDouble &buffers ) const
+   {
+      return impl_->ReadData3DPreview( dataIndex, maxPointCount, buffers );
+   }
+
+   int64_t Reader::ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                     int64_t maxPointCount, Data3DPointsFloat &buffers ) const
+   {
+      return impl_->ReadData3DWindow( dataIndex, window, maxPointCount, buffers );
+   }
+
+   int64_t Reader::ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                     int64_t maxPointCount, Data3DPointsDouble &buffers ) const
+   {
+      return impl_->ReadData3DWindow( dataIndex, window, maxPointCount, buffers );
+   }
+
+   MetadataReader::MetadataReader( const ustring &filePath, const ReaderOptions &options ) :
+      impl_( new ReaderImpl( filePath, lazyOptions( options ) ) )
+   {
+   }
+
+   bool MetadataReader::IsOpen() const
+   {
+      return impl_->IsOpen();
+   }
+
+   bool MetadataReader::Close()
+   {
+      return impl_->Close();
+   }
+
+   bool MetadataReader::GetE57Root( E57Root &fileHeader ) const
+   {
+      return impl_->GetE57Root( fileHeader );
+   }
+
+   int64_t MetadataReader::GetImage2DCount() const
+   {
+      return impl_->GetImage2DCount();
+   }
+
+   bool MetadataReader::ReadImage2D( int64_t imageIndex, Image2D &image2DHeader ) const
+   {
+      const bool result = impl_->ReadImage2D( imageIndex, image2DHeader );
+
+      if ( result )
+      {
+         impl_->ReleaseImage2D( imageIndex );
+      }
+
+      return result;
+   }
+
+   int64_t MetadataReader::GetData3DCount() const
+   {
+      return impl_->GetData3DCount();
+   }
+
+   bool MetadataReader::ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const
+   {
+      const bool result = impl_->ReadData3D( dataIndex, data3DHeader );
+
+      if ( result )
+      {
+         impl_->ReleaseData3D( dataIndex );
+      }
+
+      return result;
+   }
+
+   DatasetReader::DatasetReader( const std::vector<ustring> &filePaths,
+                                 const DatasetOptions &options ) :
+      impl_( new DatasetReaderImpl( filePaths, options ) )
+   {
+   }
+
+   DatasetReader::~DatasetReader() = default;
+
+   size_t DatasetReader::FileCount() const
+   {
+      return impl_->fileCount();
+   }
+
+   ustring DatasetReader::FilePath( size_t fileIndex ) const
+   {
+      return impl_->filePath( fileIndex );
+   }
+
+   size_t DatasetReader::OpenFileCount() const
+   {
+      return impl_->openFileCount();
+   }
+
+   std::shared_ptr<Reader> DatasetReader::GetReader( size_t fileIndex )
+   {
+      return impl_->reader( fileIndex );
+   }
+
+   std::future<void> DatasetReader::Submit( size_t fileIndex, Task task, int priority )
+   {
+      return impl_->submit( fileIndex, std::move( task ), priority );
+   }
+
+   std::future<void> DatasetReader::ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                                          Data3DPointsFloat &buffers,
+                                                          int priority )
+   {
+      return impl_->submit( fileIndex, readData3DTask( dataIndex, buffers ), priority );
+   }
+
+   std::future<void> DatasetReader::ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                                          Data3DPointsDouble &buffers,
+                                                          int priority )
+   {
+      return impl_->submit( fileIndex, readData3DTask( dataIndex, buffers ), priority );
+   }
+
+   std::future<void> DatasetReader::ReadData3DPointsData( size_t fileIndex, int64_t dataIndex,
+                                                          Data3DPointsInt32 &buffers,
+                                                          int priority )
+   {
+      return impl_->submit( fileIndex, readData3DTask( dataIndex, buffers ), priority );
+   }
+
 } // end namespace e57
@@ -38,16 +38,34 @@ namespace
    ///   - spherical points
    ///   - intensity
    ///   - time stamps
+   /// If inFitScaledIntegers is set, the ranges of ScaledInteger fields are replaced by the range
+   /// of the points even if they were set, so they are stored using as few bits as possible.
    template <typename COORDTYPE>
    void _fillMinMaxData( e57::Data3D &ioData3DHeader,
-                         const e57::Data3DPointsData_t<COORDTYPE> &inBuffers )
+                         const e57::Data3DPointsData_t<COORDTYPE> &inBuffers,
+                         bool inFitScaledIntegers )
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
-
       auto &pointFields = ioData3DHeader.pointFields;
 
-      constexpr COORDTYPE cMin = std::numeric_limits<COORDTYPE>::lowest();
-      constexpr COORDTYPE cMax = std::numeric_limits<COORDTYPE>::max();
+      // Raw integer coordinates are compared as the values they are scaled to
+      using Coordinate = typename std::conditional<std::is_floating_point<COORDTYPE>::value,
+                                                   COORDTYPE, double>::type;
+
+      constexpr Coordinate cMin = std::numeric_limits<Coordinate>::lowest();
+      constexpr Coordinate cMax = std::numeric_limits<Coordinate>::max();
+
+      const double rangeScale =
+         std::is_floating_point<COORDTYPE>::value ? 1.0 : pointFields.pointRangeScale;
+      const double angleScale =
+         std::is_floating_point<COORDTYPE>::value ? 1.0 : pointFields.angleScale;
+
+      auto range = [rangeScale]( COORDTYPE value ) {
+         return static_cast<Coordinate>( value * rangeScale );
+      };
+
+      auto angle = [angleScale]( COORDTYPE value ) {
+         return static_cast<Coordinate>( value * angleScale );
+      };
 
       // IF we are using scaled ints for cartesian points
       // AND we haven't set either min or max
@@ -57,7 +75,9 @@ namespace
 
       const bool writePointRange =
          ( pointFields.pointRangeNodeType == e57::NumericalNodeType::ScaledInteger ) &&
-         ( pointFields.pointRangeMinimum == cMin ) && ( pointFields.pointRangeMaximum == cMax );
+         ( inFitScaledIntegers ||
+           ( ( pointFields.pointRangeMinimum == cMin ) &&
+             ( pointFields.pointRangeMaximum == cMax ) ) );
 
       // IF we are using scaled ints for spherical angles
       // AND we haven't set either min or max
@@ -67,7 +87,8 @@ namespace
 
       const bool writeAngle =
          ( pointFields.angleNodeType == e57::NumericalNodeType::ScaledInteger ) &&
-         ( pointFields.angleMinimum == cMin ) && ( pointFields.angleMaximum == cMax );
+         ( inFitScaledIntegers ||
+           ( ( pointFields.angleMinimum == cMin ) && ( pointFields.angleMaximum == cMax ) ) );
 
       // IF we are using intensity
       // AND we haven't set either min or max
@@ -75,8 +96,12 @@ namespace
       double intensityMinimum = std::numeric_limits<double>::max();
       double intensityMaximum = std::numeric_limits<double>::lowest();
 
+      // Integer intensity limits also say how to scale intensities, so only fit ScaledIntegers
       const bool writeIntensity =
-         pointFields.intensityField && ( ioData3DHeader.intensityLimits == e57::IntensityLimits{} );
+         pointFields.intensityField &&
+         ( ( ioData3DHeader.intensityLimits == e57::IntensityLimits{} ) ||
+           ( inFitScaledIntegers &&
+             ( pointFields.intensityNodeType == e57::NumericalNodeType::ScaledInteger ) ) );
 
       // IF we are using scaled ints for timestamps
       // AND we haven't set either min or max
@@ -87,20 +112,21 @@ namespace
       const bool writeTimeStamp =
          pointFields.timeStampField &&
          ( pointFields.timeNodeType == e57::NumericalNodeType::ScaledInteger ) &&
-         ( pointFields.timeMinimum == cMin ) && ( pointFields.timeMaximum == cMax );
+         ( inFitScaledIntegers ||
+           ( ( pointFields.timeMinimum == cMin ) && ( pointFields.timeMaximum == cMax ) ) );
 
       // Now run through the points and set the things we need to
       for ( size_t i = 0; i < ioData3DHeader.pointCount; ++i )
       {
          if ( writePointRange && pointFields.cartesianXField )
          {
-            pointRangeMinimum = std::min( inBuffers.cartesianX[i], pointRangeMinimum );
-            pointRangeMinimum = std::min( inBuffers.cartesianY[i], pointRangeMinimum );
-            pointRangeMinimum = std::min( inBuffers.cartesianZ[i], pointRangeMinimum );
+            pointRangeMinimum = std::min( range( inBuffers.cartesianX[i] ), pointRangeMinimum );
+            pointRangeMinimum = std::min( range( inBuffers.cartesianY[i] ), pointRangeMinimum );
+            pointRangeMinimum = std::min( range( inBuffers.cartesianZ[i] ), pointRangeMinimum );
 
-            pointRangeMaximum = std::max( inBuffers.cartesianX[i], pointRangeMaximum );
-            pointRangeMaximum = std::max( inBuffers.cartesianY[i], pointRangeMaximum );
-            pointRangeMaximum = std::max( inBuffers.cartesianZ[i], pointRangeMaximum );
+            pointRangeMaximum = std::max( range( inBuffers.cartesianX[i] ), pointRangeMaximum );
+            pointRangeMaximum = std::max( range( inBuffers.cartesianY[i] ), pointRangeMaximum );
+            pointRangeMaximum = std::max( range( inBuffers.cartesianZ[i] ), pointRangeMaximum );
          }
 
          if ( writePointRange && pointFields.sphericalRangeField )
@@ -108,17 +134,17 @@ namespace
             // Note that the writer code uses pointRangeMinimum/pointRangeMaximum
             // (see WriterImpl::NewData3D()) instead of using the sphericalBounds which has
             // rangeMinimum and rangeMaximum.
-            pointRangeMinimum = std::min( inBuffers.sphericalRange[i], pointRangeMinimum );
-            pointRangeMaximum = std::max( inBuffers.sphericalRange[i], pointRangeMaximum );
+            pointRangeMinimum = std::min( range( inBuffers.sphericalRange[i] ), pointRangeMinimum );
+            pointRangeMaximum = std::max( range( inBuffers.sphericalRange[i] ), pointRangeMaximum );
          }
 
          if ( writeAngle )
          {
-            angleMinimum = std::min( inBuffers.sphericalAzimuth[i], angleMinimum );
-            angleMinimum = std::min( inBuffers.sphericalElevation[i], angleMinimum );
+            angleMinimum = std::min( angle( inBuffers.sphericalAzimuth[i] ), angleMinimum );
+            angleMinimum = std::min( angle( inBuffers.sphericalElevation[i] ), angleMinimum );
 
-            angleMaximum = std::max( inBuffers.sphericalAzimuth[i], angleMaximum );
-            angleMaximum = std::max( inBuffers.sphericalElevation[i], angleMaximum );
+            angleMaximum = std::max( angle( inBuffers.sphericalAzimuth[i] ), angleMaximum );
+            angleMaximum = std::max( angle( inBuffers.sphericalElevation[i] ), angleMaximum );
          }
 
          if ( writeIntensity )
@@ -159,9 +185,14 @@ namespace
       }
    }
    template void _fillMinMaxData( e57::Data3D &ioData3DHeader,
-                                  const e57::Data3DPointsFloat &inBuffers );
+                                  const e57::Data3DPointsFloat &inBuffers,
+                                  bool inFitScaledIntegers );
    template void _fillMinMaxData( e57::Data3D &ioData3DHeader,
-                                  const e57::Data3DPointsDouble &inBuffers );
+                                  const e57::Data3DPointsDouble &inBuffers,
+                                  bool inFitScaledIntegers );
+   template void _fillMinMaxData( e57::Data3D &ioData3DHeader,
+                                  const e57::Data3DPointsInt32 &inBuffers,
+                                  bool inFitScaledIntegers );
 }
 
 namespace e57
@@ -171,6 +202,11 @@ namespace e57
    {
    }
 
+   Writer::Writer( std::shared_ptr<ImageFileIO> io, const WriterOptions &options ) :
+      impl_( new WriterImpl( std::move( io ), options ) )
+   {
+   }
+
    // Note that this constructor is deprecated (see header).
    Writer::Writer( const ustring &filePath, const ustring &coordinateMetadata ) :
       Writer( filePath, WriterOptions{ {}, coordinateMetadata } )
@@ -222,32 +258,41 @@ namespace e57
 
    int64_t Writer::WriteData3DData( Data3D &data3DHeader, const Data3DPointsFloat &buffers )
    {
-      _fillMinMaxData( data3DHeader, buffers );
-
-      const int64_t scanIndex = impl_->NewData3D( data3DHeader );
+      _fillMinMaxData( data3DHeader, buffers, impl_->FitsScaledIntegerRanges() );
 
-      e57::CompressedVectorWriter dataWriter =
-         impl_->SetUpData3DPointsData( scanIndex, data3DHeader.pointCount, buffers );
+      return impl_->WriteData3DData( data3DHeader, buffers );
+   }
 
-      dataWriter.write( data3DHeader.pointCount );
-      dataWriter.close();
+   int64_t Writer::WriteData3DData( Data3D &data3DHeader, const Data3DPointsDouble &buffers )
+   {
+      _fillMinMaxData( data3DHeader, buffers, impl_->FitsScaledIntegerRanges() );
 
-      return scanIndex;
+      return impl_->WriteData3DData( data3DHeader, buffers );
    }
 
-   int64_t Writer::WriteData3DData( Data3D &data3DHeader, const Data3DPointsDouble &buffers )
+   int64_t Writer::WriteData3DData( Data3D &data3DHeader, const Data3DPointsInt32 &buffers )
    {
-      _fillMinMaxData( data3DHeader, buffers );
+      _fillMinMaxData( data3DHeader, buffers, impl_->FitsScaledIntegerRanges() );
 
-      const int64_t scanIndex = impl_->NewData3D( data3DHeader );
+      return impl_->WriteData3DData( data3DHeader, buffers );
+   }
 
-      e57::CompressedVectorWriter dataWriter =
-         impl_->SetUpData3DPointsData( scanIndex, data3DHeader.pointCount, buffers );
+   int64_t Writer::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                    const Data3DPointsProducer<float> &producer )
+   {
+      return impl_->WriteData3DData( data3DHeader, blockSize, producer );
+   }
 
-      dataWriter.write( data3DHeader.pointCount );
-      dataWriter.close();
+   int64_t Writer::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                    const Data3DPointsProducer<double> &producer )
+   {
+      return impl_->WriteData3DData( data3DHeader, blockSize, producer );
+   }
 
-      return scanIndex;
+   int64_t Writer::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                    const Data3DPointsProducer<int32_t> &producer )
+   {
+      return impl_->WriteData3DData( data3DHeader, blockSize, producer );
    }
 
    int64_t Writer::NewData3D( Data3D &data3DHeader )
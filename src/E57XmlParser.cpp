@@ -25,16 +25,11 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstring>
 #include <limits>
 #include <locale>
 #include <sstream>
 
-#include <xercesc/sax2/Attributes.hpp>
-#include <xercesc/sax2/XMLReaderFactory.hpp>
-
-#include <xercesc/util/BinInputStream.hpp>
-#include <xercesc/util/TransService.hpp>
-
 #include "BlobNodeImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
@@ -48,37 +43,19 @@
 #include "VectorNodeImpl.h"
 
 using namespace e57;
-using namespace XERCES_CPP_NAMESPACE;
 
 // define convenient constants for the attribute names
-static const XMLCh att_minimum[] = { chLatin_m, chLatin_i, chLatin_n, chLatin_i,
-                                     chLatin_m, chLatin_u, chLatin_m, chNull };
-static const XMLCh att_maximum[] = { chLatin_m, chLatin_a, chLatin_x, chLatin_i,
-                                     chLatin_m, chLatin_u, chLatin_m, chNull };
-static const XMLCh att_scale[] = { chLatin_s, chLatin_c, chLatin_a, chLatin_l, chLatin_e, chNull };
-static const XMLCh att_offset[] = { chLatin_o, chLatin_f, chLatin_f, chLatin_s,
-                                    chLatin_e, chLatin_t, chNull };
-static const XMLCh att_precision[] = { chLatin_p, chLatin_r, chLatin_e, chLatin_c, chLatin_i,
-                                       chLatin_s, chLatin_i, chLatin_o, chLatin_n, chNull };
-static const XMLCh att_allowHeterogeneousChildren[] = {
-   chLatin_a, chLatin_l, chLatin_l, chLatin_o, chLatin_w, chLatin_H, chLatin_e,
-   chLatin_t, chLatin_e, chLatin_r, chLatin_o, chLatin_g, chLatin_e, chLatin_n,
-   chLatin_e, chLatin_o, chLatin_u, chLatin_s, chLatin_C, chLatin_h, chLatin_i,
-   chLatin_l, chLatin_d, chLatin_r, chLatin_e, chLatin_n, chNull
-};
-static const XMLCh att_fileOffset[] = { chLatin_f, chLatin_i, chLatin_l, chLatin_e,
-                                        chLatin_O, chLatin_f, chLatin_f, chLatin_s,
-                                        chLatin_e, chLatin_t, chNull };
-
-static const XMLCh att_type[] = { chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull };
-static const XMLCh att_length[] = { chLatin_l, chLatin_e, chLatin_n, chLatin_g,
-                                    chLatin_t, chLatin_h, chNull };
-static const XMLCh att_recordCount[] = { chLatin_r, chLatin_e, chLatin_c, chLatin_o,
-                                         chLatin_r, chLatin_d, chLatin_C, chLatin_o,
-                                         chLatin_u, chLatin_n, chLatin_t, chNull };
-
-static_assert( std::is_same<size_t, XMLSize_t>::value,
-               "size_t and XMLSize_t should be the same type" );
+static const char att_minimum[] = "minimum";
+static const char att_maximum[] = "maximum";
+static const char att_scale[] = "scale";
+static const char att_offset[] = "offset";
+static const char att_precision[] = "precision";
+static const char att_allowHeterogeneousChildren[] = "allowHeterogeneousChildren";
+static const char att_fileOffset[] = "fileOffset";
+
+static const char att_type[] = "type";
+static const char att_length[] = "length";
+static const char att_recordCount[] = "recordCount";
 
 namespace
 {
@@ -93,139 +70,269 @@ namespace
 #endif
    }
 
-   ustring toUString( const XMLCh *const xml_str )
-   {
-      ustring u_str;
-      if ( ( xml_str != nullptr ) && *xml_str )
-      {
-         TranscodeToStr UTF8Transcoder( xml_str, "UTF-8" );
-         u_str = ustring( reinterpret_cast<const char *>( UTF8Transcoder.str() ) );
-      }
-      return ( u_str );
-   }
-
-   ustring lookupAttribute( const Attributes &attributes, const XMLCh *attribute_name )
+   ustring lookupAttribute( const E57XmlAttributes &attributes, const char *attribute_name )
    {
-      XMLSize_t attr_index;
-      if ( !attributes.getIndex( attribute_name, attr_index ) )
+      ustring value;
+      if ( !attributes.find( attribute_name, value ) )
       {
-         throw E57_EXCEPTION2( ErrorBadXMLFormat, "attributeName=" + toUString( attribute_name ) );
+         throw E57_EXCEPTION2( ErrorBadXMLFormat, "attributeName=" + ustring( attribute_name ) );
       }
-      return ( toUString( attributes.getValue( attr_index ) ) );
+      return ( value );
    }
 
-   bool isAttributeDefined( const Attributes &attributes, const XMLCh *attribute_name )
+   bool isAttributeDefined( const E57XmlAttributes &attributes, const char *attribute_name )
    {
-      XMLSize_t attr_index;
-      return ( attributes.getIndex( attribute_name, attr_index ) );
+      ustring value;
+      return ( attributes.find( attribute_name, value ) );
    }
 }
 
 //=============================================================================
-// E57FileInputStream
+// E57XmlOutline
 
-class E57FileInputStream : public BinInputStream
+namespace
 {
-public:
-   E57FileInputStream( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength );
-   ~E57FileInputStream() override = default;
-
-   E57FileInputStream( const E57FileInputStream & ) = delete;
-   E57FileInputStream &operator=( const E57FileInputStream & ) = delete;
-
-   XMLFilePos curPos() const override
+   bool isNameEnd( char c )
    {
-      return ( logicalPosition_ );
+      return ( c == ' ' ) || ( c == '\t' ) || ( c == '\n' ) || ( c == '\r' ) || ( c == '/' ) ||
+             ( c == '>' );
    }
 
-   XMLSize_t readBytes( XMLByte *toFill, XMLSize_t maxToRead ) override;
-
-   const XMLCh *getContentType() const override
+   // Element name of the tag starting at tagBegin
+   ustring tagName( const ustring &xml, size_t tagBegin, size_t tagEnd )
    {
-      return nullptr;
-   }
+      size_t nameEnd = tagBegin + 1;
 
-private:
-   //??? lifetime of cf_ must be longer than this object!
-   CheckedFile *cf_;
-   uint64_t logicalStart_;
-   uint64_t logicalLength_;
-   uint64_t logicalPosition_;
-};
-
-E57FileInputStream::E57FileInputStream( CheckedFile *cf, uint64_t logicalStart,
-                                        uint64_t logicalLength ) :
-   cf_( cf ),
-   logicalStart_( logicalStart ), logicalLength_( logicalLength ), logicalPosition_( logicalStart )
-{
-}
+      while ( ( nameEnd < tagEnd ) && !isNameEnd( xml[nameEnd] ) )
+      {
+         ++nameEnd;
+      }
 
-XMLSize_t E57FileInputStream::readBytes( XMLByte *const toFill, const XMLSize_t maxToRead )
-{
-   if ( logicalPosition_ > logicalStart_ + logicalLength_ )
-   {
-      return ( 0 );
+      return xml.substr( tagBegin + 1, nameEnd - tagBegin - 1 );
    }
 
-   int64_t available = logicalStart_ + logicalLength_ - logicalPosition_;
-   if ( available <= 0 )
+   // Find the '>' ending the tag starting at tagBegin, skipping any in quoted attribute values.
+   size_t findTagEnd( const ustring &xml, size_t tagBegin )
    {
-      return ( 0 );
-   }
+      char quote = '\0';
 
-   size_t maxToRead_size = maxToRead;
+      for ( size_t i = tagBegin + 1; i < xml.size(); ++i )
+      {
+         const char c = xml[i];
 
-   // Be careful if size_t is smaller than int64_t
-   size_t available_size;
+         if ( quote != '\0' )
+         {
+            if ( c == quote )
+            {
+               quote = '\0';
+            }
+         }
+         else if ( ( c == '"' ) || ( c == '\'' ) )
+         {
+            quote = c;
+         }
+         else if ( c == '>' )
+         {
+            return i;
+         }
+      }
 
-   // Assign to var to avoid MSVC warning
-   // This section can be simplified in C++17 using a "constexpr if".
-   constexpr bool cSizeCheck = ( sizeof( size_t ) >= sizeof( int64_t ) );
-   if ( cSizeCheck )
+      return ustring::npos;
+   }
+
+   // Value of an attribute of a start tag, or an empty string if it isn't there
+   ustring tagAttribute( const ustring &tag, const ustring &name )
    {
-      // size_t is at least as big as int64_t
-      available_size = static_cast<size_t>( available );
+      const char *whitespace = " \t\n\r";
+
+      size_t i = tagName( tag, 0, tag.size() ).size() + 1;
+
+      while ( i < tag.size() )
+      {
+         const size_t nameBegin = tag.find_first_not_of( whitespace, i );
+         const size_t equals = tag.find( '=', i );
+         const size_t quoteBegin = tag.find_first_of( "\"'", i );
+
+         if ( ( quoteBegin == ustring::npos ) || ( equals > quoteBegin ) )
+         {
+            break;
+         }
+
+         const size_t quoteEnd = tag.find( tag[quoteBegin], quoteBegin + 1 );
+
+         if ( quoteEnd == ustring::npos )
+         {
+            break;
+         }
+
+         const size_t nameEnd = tag.find_last_not_of( whitespace, equals - 1 ) + 1;
+
+         if ( tag.compare( nameBegin, nameEnd - nameBegin, name ) == 0 )
+         {
+            return tag.substr( quoteBegin + 1, quoteEnd - quoteBegin - 1 );
+         }
+
+         i = quoteEnd + 1;
+      }
+
+      return {};
    }
-   else
+}
+
+bool E57XmlOutline::scan( const ustring &xml )
+{
+   prologueLength = 0;
+   rootName.clear();
+   vectors.clear();
+
+   // Number of elements open, and the vector whose children are being collected (if any)
+   size_t level = 0;
+   DeferredVector *vector = nullptr;
+   uint64_t childBegin = 0;
+
+   size_t pos = 0;
+
+   while ( ( pos = xml.find( '<', pos ) ) != ustring::npos )
    {
-      // size_t is smaller than int64_t, Calc max that size_t can hold
-      const int64_t size_max = std::numeric_limits<size_t>::max();
+      // Skip comments, CDATA sections, processing instructions and declarations
+      const char *skipEnd = nullptr;
 
-      // read smaller of size_max, available
-      //??? redo
-      if ( size_max < available )
+      if ( xml.compare( pos, 4, "<!--" ) == 0 )
+      {
+         skipEnd = "-->";
+      }
+      else if ( xml.compare( pos, 9, "<![CDATA[" ) == 0 )
+      {
+         skipEnd = "]]>";
+      }
+      else if ( xml.compare( pos, 2, "<?" ) == 0 )
       {
-         available_size = static_cast<size_t>( size_max );
+         skipEnd = "?>";
+      }
+      else if ( xml.compare( pos, 2, "<!" ) == 0 )
+      {
+         // A DOCTYPE with an internal subset could declare entities holding markup
+         const size_t declEnd = xml.find( '>', pos );
+
+         if ( ( declEnd == ustring::npos ) || ( xml.find( '[', pos ) < declEnd ) )
+         {
+            return false;
+         }
+
+         pos = declEnd + 1;
+         continue;
+      }
+
+      if ( skipEnd != nullptr )
+      {
+         const size_t end = xml.find( skipEnd, pos );
+
+         if ( end == ustring::npos )
+         {
+            return false;
+         }
+
+         pos = end + strlen( skipEnd );
+         continue;
+      }
+
+      const size_t tagEnd = findTagEnd( xml, pos );
+
+      if ( tagEnd == ustring::npos )
+      {
+         return false;
+      }
+
+      if ( xml[pos + 1] == '/' )
+      {
+         if ( level == 0 )
+         {
+            return false;
+         }
+
+         --level;
+
+         if ( level == 0 )
+         {
+            break;
+         }
+
+         if ( vector != nullptr )
+         {
+            if ( level == 2 )
+            {
+               vector->children.push_back( { childBegin, tagEnd + 1 } );
+            }
+            else if ( level == 1 )
+            {
+               vector = nullptr;
+            }
+         }
       }
       else
       {
-         available_size = static_cast<size_t>( available );
+         const bool isEmptyElement = ( xml[tagEnd - 1] == '/' );
+
+         if ( level == 0 )
+         {
+            rootName = tagName( xml, pos, tagEnd );
+            prologueLength = tagEnd + 1;
+
+            if ( isEmptyElement )
+            {
+               break;
+            }
+         }
+         else if ( level == 1 )
+         {
+            const ustring name = tagName( xml, pos, tagEnd );
+
+            if ( ( ( name == "data3D" ) || ( name == "images2D" ) ) && !isEmptyElement &&
+                 ( tagAttribute( xml.substr( pos, tagEnd + 1 - pos ), "type" ) == "Vector" ) )
+            {
+               vectors.push_back( { name, {} } );
+               vector = &vectors.back();
+            }
+         }
+         else if ( ( level == 2 ) && ( vector != nullptr ) )
+         {
+            childBegin = pos;
+
+            if ( isEmptyElement )
+            {
+               vector->children.push_back( { childBegin, tagEnd + 1 } );
+            }
+         }
+
+         if ( !isEmptyElement )
+         {
+            ++level;
+         }
       }
-   }
 
-   size_t readCount = std::min( maxToRead_size, available_size );
+      pos = tagEnd + 1;
+   }
 
-   cf_->seek( logicalPosition_ );
-   cf_->read( reinterpret_cast<char *>( toFill ), readCount ); //??? cast ok?
-   logicalPosition_ += readCount;
-   return ( readCount );
+   return !rootName.empty();
 }
 
-//=============================================================================
-// E57XmlFileInputSource
-
-E57XmlFileInputSource::E57XmlFileInputSource( CheckedFile *cf, uint64_t logicalStart,
-                                              uint64_t logicalLength ) :
-   InputSource( "E57File",
-                XMLPlatformUtils::fgMemoryManager ), //??? what if want to use our own memory
-                                                     // manager?, what bufid is good?
-   cf_( cf ), logicalStart_( logicalStart ), logicalLength_( logicalLength )
+ustring E57XmlOutline::skeleton( const ustring &xml ) const
 {
-}
+   ustring result;
+   size_t pos = 0;
 
-BinInputStream *E57XmlFileInputSource::makeStream() const
-{
-   return new E57FileInputStream( cf_, logicalStart_, logicalLength_ );
+   for ( const auto &vector : vectors )
+   {
+      for ( const auto &child : vector.children )
+      {
+         result.append( xml, pos, static_cast<size_t>( child.begin ) - pos );
+         pos = static_cast<size_t>( child.end );
+      }
+   }
+
+   result.append( xml, pos, ustring::npos );
+
+   return result;
 }
 
 //=============================================================================
@@ -267,76 +374,49 @@ void E57XmlParser::ParseInfo::dump( int indent, std::ostream &os ) const
 //=============================================================================
 // E57XmlParser
 
-E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf ) : imf_( imf ), xmlReader( nullptr )
+E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf, bool fragment ) :
+   imf_( imf ), fragment_( fragment )
 {
 }
 
-E57XmlParser::~E57XmlParser()
-{
-   delete xmlReader;
-
-   xmlReader = nullptr;
-
-   XMLPlatformUtils::Terminate();
-}
+E57XmlParser::~E57XmlParser() = default;
 
 void E57XmlParser::init()
 {
-   // Initialize the XML4C2 system
-   try
-   {
-      XMLPlatformUtils::Initialize();
-   }
-   catch ( const XMLException &ex )
-   {
-      // Turn parser exception into E57Exception
-      throw E57_EXCEPTION2( ErrorXMLParserInit,
-                            "parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-   }
-
-   xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
-
-   if ( xmlReader == nullptr )
-   {
-      throw E57_EXCEPTION2( ErrorXMLParserInit, "could not create the xml reader" );
-   }
+   xmlReader.reset( new E57XmlReader( *this ) );
+}
 
-   //??? check these are right
-   xmlReader->setFeature( XMLUni::fgSAX2CoreValidation, true );
-   xmlReader->setFeature( XMLUni::fgXercesDynamic, true );
-   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpaces, true );
-   xmlReader->setFeature( XMLUni::fgXercesSchema, true );
-   xmlReader->setFeature( XMLUni::fgXercesSchemaFullChecking, true );
-   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpacePrefixes, true );
+void E57XmlParser::parse( CheckedFile *file, uint64_t logicalStart, uint64_t logicalLength )
+{
+   xmlReader->parse( file, logicalStart, logicalLength );
+}
 
-   xmlReader->setContentHandler( this );
-   xmlReader->setErrorHandler( this );
+void E57XmlParser::parse( const ustring &xml )
+{
+   xmlReader->parse( xml.data(), xml.size() );
 }
 
-void E57XmlParser::parse( InputSource &inputSource )
+std::shared_ptr<StructureNodeImpl> E57XmlParser::fragmentRoot() const
 {
-   xmlReader->parse( inputSource );
+   return fragmentRoot_;
 }
 
-void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const localName,
-                                 const XMLCh *const qName, const Attributes &attributes )
+void E57XmlParser::startElement( const ustring &uri, const ustring &localName,
+                                 const ustring &qName, const E57XmlAttributes &attributes )
 {
 #ifdef E57_VERBOSE
    std::cout << "startElement" << std::endl;
-   std::cout << space( 2 ) << "URI:       " << toUString( uri ) << std::endl;
-   std::cout << space( 2 ) << "localName: " << toUString( localName ) << std::endl;
-   std::cout << space( 2 ) << "qName:     " << toUString( qName ) << std::endl;
+   std::cout << space( 2 ) << "URI:       " << uri << std::endl;
+   std::cout << space( 2 ) << "localName: " << localName << std::endl;
+   std::cout << space( 2 ) << "qName:     " << qName << std::endl;
 
-   for ( size_t i = 0; i < attributes.getLength(); i++ )
+   for ( size_t i = 0; i < attributes.length(); i++ )
    {
       std::cout << space( 2 ) << "Attribute[" << i << "]" << std::endl;
-      std::cout << space( 4 ) << "URI:       " << toUString( attributes.getURI( i ) ) << std::endl;
-      std::cout << space( 4 ) << "localName: " << toUString( attributes.getLocalName( i ) )
-                << std::endl;
-      std::cout << space( 4 ) << "qName:     " << toUString( attributes.getQName( i ) )
-                << std::endl;
-      std::cout << space( 4 ) << "value:     " << toUString( attributes.getValue( i ) )
-                << std::endl;
+      std::cout << space( 4 ) << "URI:       " << attributes.uri( i ) << std::endl;
+      std::cout << space( 4 ) << "localName: " << attributes.localName( i ) << std::endl;
+      std::cout << space( 4 ) << "qName:     " << attributes.qName( i ) << std::endl;
+      std::cout << space( 4 ) << "value:     " << attributes.value( i ) << std::endl;
    }
 #endif
    // Get Type attribute
@@ -458,9 +538,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          {
             throw E57_EXCEPTION2( ErrorBadXMLFormat, "precisionString=" + precision_str +
                                                         " fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+                                                        " uri=" + uri +
+                                                        " localName=" + localName +
+                                                        " qName=" + qName );
          }
       }
       else
@@ -544,34 +624,35 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
 #endif
       pi.nodeType = TypeStructure;
 
-      // Read name space decls, if e57Root element
-      if ( toUString( localName ) == "e57Root" )
+      // Read name space decls, if e57Root element. A fragment's root repeats them, but they have
+      // already been read.
+      if ( !fragment_ && localName == "e57Root" )
       {
          // Search attributes for namespace declarations (only allowed in E57Root structure)
          bool gotDefault = false;
-         for ( size_t i = 0; i < attributes.getLength(); i++ )
+         for ( size_t i = 0; i < attributes.length(); i++ )
          {
             // Check if declaring the default namespace
-            if ( toUString( attributes.getQName( i ) ) == "xmlns" )
+            if ( attributes.qName( i ) == "xmlns" )
             {
 #ifdef E57_VERBOSE
                std::cout << "declared default namespace, URI="
-                         << toUString( attributes.getValue( i ) ) << std::endl;
+                         << attributes.value( i ) << std::endl;
 #endif
-               imf_->extensionsAdd( "", toUString( attributes.getValue( i ) ) );
+               imf_->extensionsAdd( "", attributes.value( i ) );
                gotDefault = true;
             }
 
             // Check if declaring a namespace
-            if ( toUString( attributes.getURI( i ) ) == "http://www.w3.org/2000/xmlns/" )
+            if ( attributes.uri( i ) == "http://www.w3.org/2000/xmlns/" )
             {
 #ifdef E57_VERBOSE
                std::cout << "declared extension, prefix="
-                         << toUString( attributes.getLocalName( i ) )
-                         << " URI=" << toUString( attributes.getValue( i ) ) << std::endl;
+                         << attributes.localName( i )
+                         << " URI=" << attributes.value( i ) << std::endl;
 #endif
-               imf_->extensionsAdd( toUString( attributes.getLocalName( i ) ),
-                                    toUString( attributes.getValue( i ) ) );
+               imf_->extensionsAdd( attributes.localName( i ),
+                                    attributes.value( i ) );
             }
          }
 
@@ -579,19 +660,19 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          if ( !gotDefault )
          {
             throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+                                                        " uri=" + uri +
+                                                        " localName=" + localName +
+                                                        " qName=" + qName );
          }
       }
 
       // Create container now, so can hold children
-      std::shared_ptr<StructureNodeImpl> s_ni( new StructureNodeImpl( imf_ ) );
+      auto s_ni = imf_->newNode<StructureNodeImpl>( imf_ );
       pi.container_ni = s_ni;
 
       // After have Structure, check again if E57Root, if so mark attached so all children will be
-      // attached when added
-      if ( toUString( localName ) == "e57Root" )
+      // attached when added. A fragment's children are attached when they are moved into the tree.
+      if ( !fragment_ && localName == "e57Root" )
       {
          s_ni->setAttachedRecursive();
       }
@@ -623,9 +704,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          {
             throw E57_EXCEPTION2( ErrorBadXMLFormat,
                                   "allowHeterogeneousChildren=" + toString( i64 ) +
-                                     "fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                     " localName=" + toUString( localName ) +
-                                     " qName=" + toUString( qName ) );
+                                     "fileName=" + imf_->fileName() + " uri=" + uri +
+                                     " localName=" + localName +
+                                     " qName=" + qName );
          }
       }
       else
@@ -635,8 +716,7 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       }
 
       // Create container now, so can hold children
-      std::shared_ptr<VectorNodeImpl> v_ni(
-         new VectorNodeImpl( imf_, pi.allowHeterogeneousChildren ) );
+      auto v_ni = imf_->newNode<VectorNodeImpl>( imf_, pi.allowHeterogeneousChildren );
       pi.container_ni = v_ni;
 
       stack_.push( pi );
@@ -659,7 +739,7 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       pi.recordCount = convertStrToLL( recordCount_str );
 
       // Create container now, so can hold children
-      std::shared_ptr<CompressedVectorNodeImpl> cv_ni( new CompressedVectorNodeImpl( imf_ ) );
+      auto cv_ni = imf_->newNode<CompressedVectorNodeImpl>( imf_ );
       cv_ni->setRecordCount( pi.recordCount );
       cv_ni->setBinarySectionLogicalStart(
          imf_->file_->physicalToLogical( pi.fileOffset ) ); //??? what if file_ is NULL?
@@ -671,16 +751,16 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
    {
       throw E57_EXCEPTION2( ErrorBadXMLFormat,
                             "nodeType=" + node_type + " fileName=" + imf_->fileName() +
-                               " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                               " qName=" + toUString( qName ) );
+                               " uri=" + uri + " localName=" + localName +
+                               " qName=" + qName );
    }
 #ifdef E57_VERBOSE
    pi.dump( 4 );
 #endif
 }
 
-void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localName,
-                               const XMLCh *const qName )
+void E57XmlParser::endElement( const ustring &uri, const ustring &localName,
+                               const ustring &qName )
 {
 #ifdef E57_VERBOSE
    std::cout << "endElement" << std::endl;
@@ -721,8 +801,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          {
             intValue = 0;
          }
-         std::shared_ptr<IntegerNodeImpl> i_ni(
-            new IntegerNodeImpl( imf_, intValue, pi.minimum, pi.maximum ) );
+         auto i_ni = imf_->newNode<IntegerNodeImpl>( imf_, intValue, pi.minimum, pi.maximum );
          current_ni = i_ni;
       }
       break;
@@ -738,8 +817,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          {
             intValue = 0;
          }
-         std::shared_ptr<ScaledIntegerNodeImpl> si_ni( new ScaledIntegerNodeImpl(
-            imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset ) );
+         auto si_ni = imf_->newNode<ScaledIntegerNodeImpl>( imf_, intValue, pi.minimum, pi.maximum,
+                                                             pi.scale, pi.offset );
          current_ni = si_ni;
       }
       break;
@@ -755,28 +834,28 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          {
             floatValue = 0.0;
          }
-         std::shared_ptr<FloatNodeImpl> f_ni(
-            new FloatNodeImpl( imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum ) );
+         auto f_ni = imf_->newNode<FloatNodeImpl>( imf_, floatValue, pi.precision, pi.floatMinimum,
+                                                    pi.floatMaximum );
          current_ni = f_ni;
       }
       break;
       case TypeString:
       {
-         std::shared_ptr<StringNodeImpl> s_ni( new StringNodeImpl( imf_, pi.childText ) );
+         auto s_ni = imf_->newNode<StringNodeImpl>( imf_, pi.childText );
          current_ni = s_ni;
       }
       break;
       case TypeBlob:
       {
-         std::shared_ptr<BlobNodeImpl> b_ni( new BlobNodeImpl( imf_, pi.fileOffset, pi.length ) );
+         auto b_ni = imf_->newNode<BlobNodeImpl>( imf_, pi.fileOffset, pi.length );
          current_ni = b_ni;
       }
       break;
       default:
          throw E57_EXCEPTION2(
             ErrorInternal, "nodeType=" + toString( pi.nodeType ) + " fileName=" + imf_->fileName() +
-                              " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                              " qName=" + toUString( qName ) );
+                              " uri=" + uri + " localName=" + localName +
+                              " qName=" + qName );
    }
 #ifdef E57_VERBOSE
    current_ni->dump( 4 );
@@ -790,11 +869,18 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
       {
          throw E57_EXCEPTION2( ErrorBadXMLFormat, "currentType=" + toString( current_ni->type() ) +
                                                      " fileName=" + imf_->fileName() +
-                                                     " uri=" + toUString( uri ) +
-                                                     " localName=" + toUString( localName ) +
-                                                     " qName=" + toUString( qName ) );
+                                                     " uri=" + uri +
+                                                     " localName=" + localName +
+                                                     " qName=" + qName );
+      }
+      if ( fragment_ )
+      {
+         fragmentRoot_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
+      }
+      else
+      {
+         imf_->root_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
       }
-      imf_->root_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
       return;
    }
 
@@ -804,9 +890,9 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
    if ( !parent_ni )
    {
       throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + imf_->fileName() +
-                                                  " uri=" + toUString( uri ) +
-                                                  " localName=" + toUString( localName ) +
-                                                  " qName=" + toUString( qName ) );
+                                                  " uri=" + uri +
+                                                  " localName=" + localName +
+                                                  " qName=" + qName );
    }
 
    // Add current node into parent at top of stack
@@ -818,7 +904,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
             std::static_pointer_cast<StructureNodeImpl>( parent_ni );
 
          // Add named child to structure
-         struct_ni->set( toUString( qName ), current_ni );
+         struct_ni->set( qName, current_ni );
       }
       break;
       case TypeVector:
@@ -834,7 +920,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
       {
          std::shared_ptr<CompressedVectorNodeImpl> cv_ni =
             std::static_pointer_cast<CompressedVectorNodeImpl>( parent_ni );
-         ustring uQName = toUString( qName );
+         ustring uQName = qName;
 
          // n can be either prototype or codecs
          if ( uQName == "prototype" )
@@ -848,8 +934,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
                throw E57_EXCEPTION2(
                   ErrorBadXMLFormat,
                   "currentType=" + toString( current_ni->type() ) +
-                     " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+                     " fileName=" + imf_->fileName() + " uri=" + uri +
+                     " localName=" + localName + " qName=" + qName );
             }
             std::shared_ptr<VectorNodeImpl> vi =
                std::static_pointer_cast<VectorNodeImpl>( current_ni );
@@ -860,8 +946,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
                throw E57_EXCEPTION2(
                   ErrorBadXMLFormat,
                   "currentType=" + toString( current_ni->type() ) +
-                     " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+                     " fileName=" + imf_->fileName() + " uri=" + uri +
+                     " localName=" + localName + " qName=" + qName );
             }
 
             cv_ni->setCodecs( vi );
@@ -870,9 +956,9 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          {
             // Found unknown XML child element of CompressedVector, not prototype or codecs
             throw E57_EXCEPTION2( ErrorBadXMLFormat, +"fileName=" + imf_->fileName() +
-                                                        " uri=" + toUString( uri ) +
-                                                        " localName=" + toUString( localName ) +
-                                                        " qName=" + toUString( qName ) );
+                                                        " uri=" + uri +
+                                                        " localName=" + localName +
+                                                        " qName=" + qName );
          }
       }
       break;
@@ -880,19 +966,17 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          // Have bad XML nesting, parent should have been a container.
          throw E57_EXCEPTION2( ErrorBadXMLFormat, "parentType=" + toString( parent_ni->type() ) +
                                                      " fileName=" + imf_->fileName() +
-                                                     " uri=" + toUString( uri ) +
-                                                     " localName=" + toUString( localName ) +
-                                                     " qName=" + toUString( qName ) );
+                                                     " uri=" + uri +
+                                                     " localName=" + localName +
+                                                     " qName=" + qName );
    }
 }
 
-void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length )
+void E57XmlParser::characters( const char *chars, size_t length )
 {
-//??? use length to make ustring
 #ifdef E57_VERBOSE
-   std::cout << "characters, chars=\"" << toUString( chars ) << "\" length=" << length << std::endl;
-#else
-   UNUSED( length );
+   std::cout << "characters, chars=\"" << ustring( chars, length ) << "\" length=" << length
+             << std::endl;
 #endif
 
    // Get active element
@@ -907,44 +991,15 @@ void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length
       case TypeBlob:
       {
          // If characters aren't whitespace, have an error, else ignore
-         ustring s = toUString( chars );
+         ustring s( chars, length );
          if ( s.find_first_not_of( " \t\n\r" ) != std::string::npos )
          {
-            throw E57_EXCEPTION2( ErrorBadXMLFormat, "chars=" + toUString( chars ) );
+            throw E57_EXCEPTION2( ErrorBadXMLFormat, "chars=" + s );
          }
       }
       break;
       default:
          // Append to any previous characters
-         pi.childText += toUString( chars );
+         pi.childText.append( chars, length );
    }
 }
-
-void E57XmlParser::error( const SAXParseException &ex )
-{
-   throw E57_EXCEPTION2(
-      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
-                         " xmlLine=" + toString( ex.getLineNumber() ) +
-                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
-                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-}
-
-void E57XmlParser::fatalError( const SAXParseException &ex )
-{
-   throw E57_EXCEPTION2(
-      ErrorXMLParser, "systemId=" + ustring( XMLString::transcode( ex.getSystemId() ) ) +
-                         " xmlLine=" + toString( ex.getLineNumber() ) +
-                         " xmlColumn=" + toString( ex.getColumnNumber() ) +
-                         " parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
-}
-
-void E57XmlParser::warning( const SAXParseException &ex )
-{
-   // Don't take any action on warning from parser, just report
-   std::cerr << "**** XML parser warning: " << ustring( XMLString::transcode( ex.getMessage() ) )
-             << std::endl;
-   std::cerr << "  Debug info:" << std::endl;
-   std::cerr << "    systemId=" << XMLString::transcode( ex.getSystemId() ) << std::endl;
-   std::cerr << ",   xmlLine=" << ex.getLineNumber() << std::endl;
-   std::cerr << ",   xmlColumn=" << ex.getColumnNumber() << std::endl;
-}
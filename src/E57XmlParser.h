@@ -29,45 +29,69 @@
 
 #include <stack>
 
-#include <xercesc/sax/InputSource.hpp>
-#include <xercesc/sax2/DefaultHandler.hpp>
-
-#include "Common.h"
-
-using namespace XERCES_CPP_NAMESPACE;
-
-namespace XERCES_CPP_NAMESPACE
-{
-   class SAX2XMLReader;
-}
+#include "E57XmlReader.h"
 
 namespace e57
 {
    class CheckedFile;
 
-   class E57XmlParser : public DefaultHandler
+   /// @brief Where the children of the root's data3D and images2D vectors are in an XML section.
+   /// @details A lazy open parses the XML without these children, then parses each of them on its
+   /// own the first time it is accessed (see StructureNodeImpl::deferChildren()).
+   struct E57XmlOutline
+   {
+      struct DeferredVector
+      {
+         ustring elementName;
+         std::vector<E57XmlRange> children;
+      };
+
+      /// Length of everything before the end of the root element's start tag (inclusive)
+      size_t prologueLength = 0;
+
+      /// Qualified name of the root element
+      ustring rootName;
+
+      std::vector<DeferredVector> vectors;
+
+      /// Scan xml for the children of the root's data3D and images2D vectors. This only looks at
+      /// the markup, so a badly-formed section is reported by the parser, not here.
+      /// @returns false if the section uses something the scan doesn't handle (e.g. a DTD
+      /// internal subset), so it should be parsed in one go
+      bool scan( const ustring &xml );
+
+      /// @returns xml without the deferred children
+      ustring skeleton( const ustring &xml ) const;
+   };
+
+   class E57XmlParser : public E57XmlHandler
    {
    public:
-      explicit E57XmlParser( ImageFileImplSharedPtr imf );
+      /// @param [in] imf image file the nodes are created for
+      /// @param [in] fragment true if this parses the root element of a fragment for a deferred
+      /// element (see ImageFileImpl::parseDeferredElement()) rather than the whole XML section
+      explicit E57XmlParser( ImageFileImplSharedPtr imf, bool fragment = false );
       ~E57XmlParser() override;
 
       void init();
 
-      void parse( InputSource &inputSource );
+      void parse( CheckedFile *file, uint64_t logicalStart, uint64_t logicalLength );
+      void parse( const ustring &xml );
 
-   private:
-      /// SAX interface
-      void startElement( const XMLCh *uri, const XMLCh *localName, const XMLCh *qName,
-                         const Attributes &attributes ) override;
-      void endElement( const XMLCh *uri, const XMLCh *localName, const XMLCh *qName ) override;
-      void characters( const XMLCh *chars, XMLSize_t length ) override;
+      /// @returns the root element of a fragment once it has been parsed
+      std::shared_ptr<StructureNodeImpl> fragmentRoot() const;
 
-      /// SAX error interface
-      void warning( const SAXParseException &ex ) override;
-      void error( const SAXParseException &ex ) override;
-      void fatalError( const SAXParseException &ex ) override;
+   private:
+      /// E57XmlHandler interface
+      void startElement( const ustring &uri, const ustring &localName, const ustring &qName,
+                         const E57XmlAttributes &attributes ) override;
+      void endElement( const ustring &uri, const ustring &localName,
+                       const ustring &qName ) override;
+      void characters( const char *chars, size_t length ) override;
 
       ImageFileImplSharedPtr imf_; /// Image file we are reading
+      bool fragment_;              /// true if parsing a fragment for a deferred element
+      std::shared_ptr<StructureNodeImpl> fragmentRoot_;
 
       struct ParseInfo
       {
@@ -99,24 +123,6 @@ namespace e57
 
       std::stack<ParseInfo> stack_; /// Stores the current path in tree we are reading
 
-      SAX2XMLReader *xmlReader;
-   };
-
-   class E57XmlFileInputSource : public InputSource
-   {
-   public:
-      E57XmlFileInputSource( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength );
-      ~E57XmlFileInputSource() override = default;
-
-      E57XmlFileInputSource( const E57XmlFileInputSource & ) = delete;
-      E57XmlFileInputSource &operator=( const E57XmlFileInputSource & ) = delete;
-
-      BinInputStream *makeStream() const override;
-
-   private:
-      //??? lifetime of cf_ must be longer than this object!
-      CheckedFile *cf_;
-      uint64_t logicalStart_;
-      uint64_t logicalLength_;
+      std::unique_ptr<E57XmlReader> xmlReader;
    };
 }
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <memory>
+
+#include "Common.h"
+
+namespace e57
+{
+   class CheckedFile;
+
+   /// Attributes of a start tag, as given to an E57XmlHandler
+   class E57XmlAttributes
+   {
+   public:
+      virtual ~E57XmlAttributes() = default;
+
+      virtual size_t length() const = 0;
+
+      virtual ustring qName( size_t index ) const = 0;
+      virtual ustring localName( size_t index ) const = 0;
+      virtual ustring uri( size_t index ) const = 0;
+      virtual ustring value( size_t index ) const = 0;
+
+      /// Look up an attribute by its qualified name.
+      /// @returns false if the tag doesn't have it
+      virtual bool find( const char *qName, ustring &value ) const = 0;
+   };
+
+   /// Receives the contents of an XML document from an E57XmlReader
+   class E57XmlHandler
+   {
+   public:
+      virtual ~E57XmlHandler() = default;
+
+      virtual void startElement( const ustring &uri, const ustring &localName,
+                                 const ustring &qName, const E57XmlAttributes &attributes ) = 0;
+      virtual void endElement( const ustring &uri, const ustring &localName,
+                               const ustring &qName ) = 0;
+
+      /// Text between tags (UTF-8), which may come in several pieces
+      virtual void characters( const char *chars, size_t length ) = 0;
+   };
+
+   /// @brief Parses an XML document and passes its contents to an E57XmlHandler.
+   /// @details The parser is chosen when the library is built (see E57_XML_PARSER in
+   /// CMakeLists.txt). It is either Xerces-C's SAX2 parser, or an internal one which only handles
+   /// the XML used by E57 files: UTF-8 documents without DTDs.
+   class E57XmlReader
+   {
+   public:
+      /// @throw ::ErrorXMLParserInit
+      explicit E57XmlReader( E57XmlHandler &handler );
+      ~E57XmlReader();
+
+      E57XmlReader( const E57XmlReader & ) = delete;
+      E57XmlReader &operator=( const E57XmlReader & ) = delete;
+
+      /// Parse a section of a file (e.g. the XML section of an E57 file)
+      /// @throw ::ErrorXMLParser
+      void parse( CheckedFile *file, uint64_t logicalStart, uint64_t logicalLength );
+
+      /// @throw ::ErrorXMLParser
+      void parse( const char *xml, size_t length );
+
+   private:
+      class Impl;
+      std::unique_ptr<Impl> impl_;
+   };
+}
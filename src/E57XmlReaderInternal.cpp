@@ -0,0 +1,777 @@
+// SPDX-License-Identifier: MIT
+
+// E57XmlReader using an internal parser for the XML used by E57 files. It works directly on the
+// UTF-8 bytes of the document: names, attribute values and text are handed on as they are in the
+// buffer, and only copied when they have references or line breaks to replace. DTDs are not
+// supported (E57 files don't have them), and the UTF-8 isn't validated.
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "CheckedFile.h"
+#include "E57XmlReader.h"
+#include "StringFunctions.h"
+
+using namespace e57;
+
+namespace
+{
+   constexpr char XML_NAMESPACE_URI[] = "http://www.w3.org/XML/1998/namespace";
+   constexpr char XMLNS_NAMESPACE_URI[] = "http://www.w3.org/2000/xmlns/";
+
+   bool isWhitespace( char c )
+   {
+      return ( c == ' ' ) || ( c == '\t' ) || ( c == '\n' ) || ( c == '\r' );
+   }
+
+   bool isNameChar( char c )
+   {
+      return !isWhitespace( c ) && ( strchr( "<>/=\"'&;!?", c ) == nullptr );
+   }
+
+   // Prefix of a qualified name (empty if none). The local name starts after the colon.
+   size_t prefixLength( const char *qName, size_t length )
+   {
+      const auto *colon = static_cast<const char *>( memchr( qName, ':', length ) );
+      return ( colon != nullptr ) ? static_cast<size_t>( colon - qName ) : 0;
+   }
+
+   void appendUtf8( ustring &s, uint32_t c )
+   {
+      if ( c < 0x80 )
+      {
+         s += static_cast<char>( c );
+      }
+      else if ( c < 0x800 )
+      {
+         s += static_cast<char>( 0xC0 | ( c >> 6 ) );
+         s += static_cast<char>( 0x80 | ( c & 0x3F ) );
+      }
+      else if ( c < 0x10000 )
+      {
+         s += static_cast<char>( 0xE0 | ( c >> 12 ) );
+         s += static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+         s += static_cast<char>( 0x80 | ( c & 0x3F ) );
+      }
+      else
+      {
+         s += static_cast<char>( 0xF0 | ( c >> 18 ) );
+         s += static_cast<char>( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+         s += static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+         s += static_cast<char>( 0x80 | ( c & 0x3F ) );
+      }
+   }
+
+   struct RawAttribute
+   {
+      const char *qName;
+      size_t qNameLength;
+      size_t prefixLength;
+      const char *value;
+      size_t valueLength;
+      const ustring *uri;
+   };
+}
+
+class E57XmlReader::Impl
+{
+public:
+   explicit Impl( E57XmlHandler &handler );
+
+   void parse( const char *xml, size_t length );
+
+   /// Replace references (and normalize whitespace in attribute values) in some of the document
+   void decode( const char *text, size_t length, bool isAttribute, ustring &result ) const;
+
+private:
+   class Attributes;
+
+   struct OpenElement
+   {
+      ustring qName;
+      ustring localName;
+      const ustring *uri = nullptr;
+      size_t bindingCount = 0; /// number of bindings before this element's declarations
+   };
+
+   struct Binding
+   {
+      ustring prefix;
+      ustring uri;
+   };
+
+   [[noreturn]] void fail( const char *at, const ustring &message ) const;
+
+   bool startsWith( const char *s ) const;
+   bool skipWhitespace();
+   void skipPast( const char *terminator, const char *what );
+   const char *readName();
+   const ustring *lookupNamespace( const char *prefix, size_t length, const char *at ) const;
+
+   void parseDeclaration();
+   void parseMisc();
+   void parseStartTag();
+   void parseEndTag();
+   void parseText();
+   void text( const char *chars, size_t length, bool isCData );
+
+   E57XmlHandler &handler_;
+
+   const char *begin_ = nullptr;
+   const char *end_ = nullptr;
+   const char *p_ = nullptr;
+
+   /// Elements which are open. Only the first depth_ are used, so their strings are reused.
+   std::vector<OpenElement> elements_;
+   size_t depth_ = 0;
+
+   std::vector<Binding> bindings_;
+   std::vector<RawAttribute> attributes_;
+
+   ustring scratch_; /// decoded text or attribute value
+   const ustring emptyUri_;
+   const ustring xmlUri_ = XML_NAMESPACE_URI;
+   const ustring xmlnsUri_ = XMLNS_NAMESPACE_URI;
+};
+
+class E57XmlReader::Impl::Attributes : public E57XmlAttributes
+{
+public:
+   Attributes( const Impl &reader, const std::vector<RawAttribute> &attributes ) :
+      reader_( reader ), attributes_( attributes )
+   {
+   }
+
+   size_t length() const override
+   {
+      return attributes_.size();
+   }
+
+   ustring qName( size_t index ) const override
+   {
+      const RawAttribute &a = attributes_.at( index );
+      return ustring( a.qName, a.qNameLength );
+   }
+
+   ustring localName( size_t index ) const override
+   {
+      const RawAttribute &a = attributes_.at( index );
+      const size_t skip = ( a.prefixLength > 0 ) ? a.prefixLength + 1 : 0;
+      return ustring( a.qName + skip, a.qNameLength - skip );
+   }
+
+   ustring uri( size_t index ) const override
+   {
+      return *attributes_.at( index ).uri;
+   }
+
+   ustring value( size_t index ) const override
+   {
+      const RawAttribute &a = attributes_.at( index );
+
+      ustring result;
+      reader_.decode( a.value, a.valueLength, true, result );
+      return result;
+   }
+
+   bool find( const char *qName, ustring &value ) const override
+   {
+      const size_t length = strlen( qName );
+
+      for ( const auto &a : attributes_ )
+      {
+         if ( ( a.qNameLength == length ) && ( memcmp( a.qName, qName, length ) == 0 ) )
+         {
+            reader_.decode( a.value, a.valueLength, true, value );
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+private:
+   const Impl &reader_;
+   const std::vector<RawAttribute> &attributes_;
+};
+
+E57XmlReader::Impl::Impl( E57XmlHandler &handler ) : handler_( handler )
+{
+}
+
+void E57XmlReader::Impl::fail( const char *at, const ustring &message ) const
+{
+   // Work out where we are for the message
+   size_t line = 1;
+   size_t column = 1;
+
+   for ( const char *c = begin_; c < at && c < end_; ++c )
+   {
+      if ( *c == '\n' )
+      {
+         ++line;
+         column = 1;
+      }
+      else if ( ( static_cast<unsigned char>( *c ) & 0xC0 ) != 0x80 )
+      {
+         ++column;
+      }
+   }
+
+   throw E57_EXCEPTION2( ErrorXMLParser, "xmlLine=" + toString( line ) + " xmlColumn=" +
+                                            toString( column ) + " parserMessage=" + message );
+}
+
+bool E57XmlReader::Impl::startsWith( const char *s ) const
+{
+   const size_t length = strlen( s );
+   return ( static_cast<size_t>( end_ - p_ ) >= length ) && ( memcmp( p_, s, length ) == 0 );
+}
+
+bool E57XmlReader::Impl::skipWhitespace()
+{
+   const char *start = p_;
+
+   while ( ( p_ < end_ ) && isWhitespace( *p_ ) )
+   {
+      ++p_;
+   }
+
+   return p_ != start;
+}
+
+void E57XmlReader::Impl::skipPast( const char *terminator, const char *what )
+{
+   const size_t length = strlen( terminator );
+
+   for ( const char *c = p_; static_cast<size_t>( end_ - c ) >= length; ++c )
+   {
+      if ( memcmp( c, terminator, length ) == 0 )
+      {
+         p_ = c + length;
+         return;
+      }
+   }
+
+   fail( p_, ustring( "unterminated " ) + what );
+}
+
+const char *E57XmlReader::Impl::readName()
+{
+   const char *start = p_;
+
+   while ( ( p_ < end_ ) && isNameChar( *p_ ) )
+   {
+      ++p_;
+   }
+
+   if ( ( p_ == start ) || ( strchr( "-.0123456789:", *start ) != nullptr ) )
+   {
+      fail( start, "expected a name" );
+   }
+
+   return start;
+}
+
+const ustring *E57XmlReader::Impl::lookupNamespace( const char *prefix, size_t length,
+                                                    const char *at ) const
+{
+   if ( ( length == 3 ) && ( memcmp( prefix, "xml", 3 ) == 0 ) )
+   {
+      return &xmlUri_;
+   }
+
+   for ( auto binding = bindings_.rbegin(); binding != bindings_.rend(); ++binding )
+   {
+      if ( ( binding->prefix.size() == length ) &&
+           ( memcmp( binding->prefix.data(), prefix, length ) == 0 ) )
+      {
+         return binding->uri.empty() ? &emptyUri_ : &binding->uri;
+      }
+   }
+
+   if ( length > 0 )
+   {
+      fail( at, "undeclared namespace prefix " + ustring( prefix, length ) );
+   }
+
+   return &emptyUri_;
+}
+
+void E57XmlReader::Impl::decode( const char *text, size_t length, bool isAttribute,
+                                 ustring &result ) const
+{
+   result.clear();
+
+   const char *end = text + length;
+
+   for ( const char *c = text; c < end; ++c )
+   {
+      if ( *c == '\r' )
+      {
+         // Line breaks are normalized to \n ("\r\n" becomes one)
+         if ( ( c + 1 < end ) && ( c[1] == '\n' ) )
+         {
+            ++c;
+         }
+
+         result += isAttribute ? ' ' : '\n';
+      }
+      else if ( isAttribute && isWhitespace( *c ) )
+      {
+         result += ' ';
+      }
+      else if ( *c == '&' )
+      {
+         const char *semicolon = static_cast<const char *>( memchr( c, ';', end - c ) );
+
+         if ( semicolon == nullptr )
+         {
+            fail( c, "unterminated reference" );
+         }
+
+         const ustring name( c + 1, semicolon - c - 1 );
+
+         if ( name == "lt" )
+         {
+            result += '<';
+         }
+         else if ( name == "gt" )
+         {
+            result += '>';
+         }
+         else if ( name == "amp" )
+         {
+            result += '&';
+         }
+         else if ( name == "quot" )
+         {
+            result += '"';
+         }
+         else if ( name == "apos" )
+         {
+            result += '\'';
+         }
+         else if ( ( name.size() > 1 ) && ( name[0] == '#' ) )
+         {
+            const bool isHex = ( name[1] == 'x' );
+            const ustring digits = name.substr( isHex ? 2 : 1 );
+
+            if ( digits.empty() ||
+                 ( digits.find_first_not_of( isHex ? "0123456789abcdefABCDEF" : "0123456789" ) !=
+                   ustring::npos ) )
+            {
+               fail( c, "bad character reference &" + name + ";" );
+            }
+
+            const unsigned long code = strtoul( digits.c_str(), nullptr, isHex ? 16 : 10 );
+
+            if ( ( code == 0 ) || ( code > 0x10FFFF ) ||
+                 ( ( code >= 0xD800 ) && ( code < 0xE000 ) ) )
+            {
+               fail( c, "bad character reference &" + name + ";" );
+            }
+
+            appendUtf8( result, static_cast<uint32_t>( code ) );
+         }
+         else
+         {
+            fail( c, "undefined entity &" + name + ";" );
+         }
+
+         c = semicolon;
+      }
+      else
+      {
+         result += *c;
+      }
+   }
+}
+
+void E57XmlReader::Impl::parseDeclaration()
+{
+   // <?xml version="1.0" encoding="UTF-8"?>
+   const char *start = p_;
+   skipPast( "?>", "XML declaration" );
+
+   const ustring declaration( start, p_ - start );
+   const size_t encoding = declaration.find( "encoding" );
+
+   if ( encoding != ustring::npos )
+   {
+      const size_t quote = declaration.find_first_of( "\"'", encoding );
+      const size_t quoteEnd = ( quote == ustring::npos )
+                                 ? ustring::npos
+                                 : declaration.find( declaration[quote], quote + 1 );
+
+      if ( quoteEnd == ustring::npos )
+      {
+         fail( start, "bad XML declaration" );
+      }
+
+      ustring name = declaration.substr( quote + 1, quoteEnd - quote - 1 );
+
+      for ( auto &c : name )
+      {
+         c = static_cast<char>( toupper( static_cast<unsigned char>( c ) ) );
+      }
+
+      if ( ( name != "UTF-8" ) && ( name != "UTF8" ) && ( name != "US-ASCII" ) )
+      {
+         fail( start, "unsupported encoding " + name );
+      }
+   }
+}
+
+void E57XmlReader::Impl::parseMisc()
+{
+   // Comments, processing instructions and whitespace before or after the root element
+   while ( p_ < end_ )
+   {
+      if ( skipWhitespace() )
+      {
+         continue;
+      }
+
+      if ( startsWith( "<!--" ) )
+      {
+         skipPast( "-->", "comment" );
+      }
+      else if ( startsWith( "<?" ) )
+      {
+         skipPast( "?>", "processing instruction" );
+      }
+      else if ( startsWith( "<!DOCTYPE" ) )
+      {
+         fail( p_, "DTDs are not supported" );
+      }
+      else
+      {
+         return;
+      }
+   }
+}
+
+void E57XmlReader::Impl::parseStartTag()
+{
+   const char *tagStart = p_++;
+
+   const char *qName = readName();
+   const size_t qNameLength = p_ - qName;
+
+   attributes_.clear();
+
+   const size_t bindingCount = bindings_.size();
+   bool isEmptyElement = false;
+
+   for ( ;; )
+   {
+      const bool hadWhitespace = skipWhitespace();
+
+      if ( p_ >= end_ )
+      {
+         fail( tagStart, "unterminated start tag" );
+      }
+
+      if ( *p_ == '>' )
+      {
+         ++p_;
+         break;
+      }
+
+      if ( startsWith( "/>" ) )
+      {
+         p_ += 2;
+         isEmptyElement = true;
+         break;
+      }
+
+      if ( !hadWhitespace )
+      {
+         fail( p_, "expected whitespace before attribute" );
+      }
+
+      RawAttribute attribute{};
+      attribute.qName = readName();
+      attribute.qNameLength = p_ - attribute.qName;
+      attribute.prefixLength = prefixLength( attribute.qName, attribute.qNameLength );
+
+      skipWhitespace();
+
+      if ( ( p_ >= end_ ) || ( *p_ != '=' ) )
+      {
+         fail( p_, "expected = after attribute name" );
+      }
+
+      ++p_;
+      skipWhitespace();
+
+      if ( ( p_ >= end_ ) || ( ( *p_ != '"' ) && ( *p_ != '\'' ) ) )
+      {
+         fail( p_, "expected quoted attribute value" );
+      }
+
+      const char quote = *p_++;
+      const char *valueEnd = static_cast<const char *>( memchr( p_, quote, end_ - p_ ) );
+
+      if ( ( valueEnd == nullptr ) || ( memchr( p_, '<', valueEnd - p_ ) != nullptr ) )
+      {
+         fail( p_, "bad attribute value" );
+      }
+
+      attribute.value = p_;
+      attribute.valueLength = valueEnd - p_;
+      p_ = valueEnd + 1;
+
+      for ( const auto &other : attributes_ )
+      {
+         if ( ( other.qNameLength == attribute.qNameLength ) &&
+              ( memcmp( other.qName, attribute.qName, attribute.qNameLength ) == 0 ) )
+         {
+            fail( attribute.qName, "duplicate attribute" );
+         }
+      }
+
+      // Namespace declarations apply to the element they are on
+      const ustring name( attribute.qName, attribute.qNameLength );
+
+      if ( name == "xmlns" )
+      {
+         bindings_.push_back( Binding{ "", "" } );
+         decode( attribute.value, attribute.valueLength, true, bindings_.back().uri );
+      }
+      else if ( ( attribute.prefixLength == 5 ) && ( name.compare( 0, 5, "xmlns" ) == 0 ) )
+      {
+         bindings_.push_back( Binding{ name.substr( 6 ), "" } );
+         decode( attribute.value, attribute.valueLength, true, bindings_.back().uri );
+      }
+
+      attributes_.push_back( attribute );
+   }
+
+   // Now all the declarations are known, give the names their namespaces
+   for ( auto &attribute : attributes_ )
+   {
+      if ( ( attribute.prefixLength == 5 ) && ( memcmp( attribute.qName, "xmlns", 5 ) == 0 ) )
+      {
+         attribute.uri = &xmlnsUri_;
+      }
+      else if ( attribute.prefixLength > 0 )
+      {
+         attribute.uri =
+            lookupNamespace( attribute.qName, attribute.prefixLength, attribute.qName );
+      }
+      else
+      {
+         attribute.uri = &emptyUri_;
+      }
+   }
+
+   if ( elements_.size() <= depth_ )
+   {
+      elements_.resize( depth_ + 1 );
+   }
+
+   OpenElement &element = elements_[depth_];
+   const size_t elementPrefixLength = prefixLength( qName, qNameLength );
+   const size_t localNameSkip = ( elementPrefixLength > 0 ) ? elementPrefixLength + 1 : 0;
+
+   element.qName.assign( qName, qNameLength );
+   element.localName.assign( qName + localNameSkip, qNameLength - localNameSkip );
+   element.uri = lookupNamespace( qName, elementPrefixLength, qName );
+   element.bindingCount = bindingCount;
+
+   ++depth_;
+
+   handler_.startElement( *element.uri, element.localName, element.qName,
+                          Attributes( *this, attributes_ ) );
+
+   if ( isEmptyElement )
+   {
+      --depth_;
+      handler_.endElement( *element.uri, element.localName, element.qName );
+      bindings_.resize( element.bindingCount );
+   }
+}
+
+void E57XmlReader::Impl::parseEndTag()
+{
+   const char *tagStart = p_;
+   p_ += 2;
+
+   const char *qName = readName();
+   const size_t qNameLength = p_ - qName;
+
+   skipWhitespace();
+
+   if ( ( p_ >= end_ ) || ( *p_ != '>' ) )
+   {
+      fail( tagStart, "unterminated end tag" );
+   }
+
+   ++p_;
+
+   const OpenElement &element = elements_[depth_ - 1];
+
+   if ( ( element.qName.size() != qNameLength ) ||
+        ( memcmp( element.qName.data(), qName, qNameLength ) != 0 ) )
+   {
+      fail( tagStart, "end tag " + ustring( qName, qNameLength ) +
+                         " doesn't match start tag " + element.qName );
+   }
+
+   --depth_;
+
+   handler_.endElement( *element.uri, element.localName, element.qName );
+
+   bindings_.resize( element.bindingCount );
+}
+
+void E57XmlReader::Impl::text( const char *chars, size_t length, bool isCData )
+{
+   // Only copy the text if something in it has to be replaced
+   const bool hasReference = !isCData && ( memchr( chars, '&', length ) != nullptr );
+
+   if ( hasReference || ( memchr( chars, '\r', length ) != nullptr ) )
+   {
+      if ( isCData )
+      {
+         // A CDATA section's only replacements are its line breaks
+         scratch_.clear();
+
+         for ( size_t i = 0; i < length; ++i )
+         {
+            if ( chars[i] != '\r' )
+            {
+               scratch_ += chars[i];
+            }
+            else if ( ( i + 1 == length ) || ( chars[i + 1] != '\n' ) )
+            {
+               scratch_ += '\n';
+            }
+         }
+      }
+      else
+      {
+         decode( chars, length, false, scratch_ );
+      }
+
+      handler_.characters( scratch_.data(), scratch_.size() );
+   }
+   else if ( length > 0 )
+   {
+      handler_.characters( chars, length );
+   }
+}
+
+void E57XmlReader::Impl::parseText()
+{
+   const char *start = p_;
+   const char *next = static_cast<const char *>( memchr( p_, '<', end_ - p_ ) );
+
+   p_ = ( next != nullptr ) ? next : end_;
+
+   text( start, p_ - start, false );
+}
+
+void E57XmlReader::Impl::parse( const char *xml, size_t length )
+{
+   begin_ = xml;
+   end_ = xml + length;
+   p_ = xml;
+   depth_ = 0;
+   bindings_.clear();
+
+   // UTF-8 byte order mark
+   if ( startsWith( "\xEF\xBB\xBF" ) )
+   {
+      p_ += 3;
+   }
+
+   if ( startsWith( "<?xml" ) && ( end_ - p_ > 5 ) && isWhitespace( p_[5] ) )
+   {
+      parseDeclaration();
+   }
+
+   parseMisc();
+
+   if ( ( p_ >= end_ ) || ( *p_ != '<' ) )
+   {
+      fail( p_, "expected the root element" );
+   }
+
+   parseStartTag();
+
+   while ( depth_ > 0 )
+   {
+      if ( p_ >= end_ )
+      {
+         fail( p_, "unterminated element " + elements_[depth_ - 1].qName );
+      }
+
+      if ( *p_ != '<' )
+      {
+         parseText();
+      }
+      else if ( startsWith( "</" ) )
+      {
+         parseEndTag();
+      }
+      else if ( startsWith( "<!--" ) )
+      {
+         skipPast( "-->", "comment" );
+      }
+      else if ( startsWith( "<![CDATA[" ) )
+      {
+         const char *start = p_ + 9;
+         p_ = start;
+         skipPast( "]]>", "CDATA section" );
+
+         text( start, p_ - 3 - start, true );
+      }
+      else if ( startsWith( "<?" ) )
+      {
+         skipPast( "?>", "processing instruction" );
+      }
+      else if ( startsWith( "<!" ) )
+      {
+         fail( p_, "unexpected markup" );
+      }
+      else
+      {
+         parseStartTag();
+      }
+   }
+
+   parseMisc();
+
+   if ( p_ < end_ )
+   {
+      fail( p_, "unexpected content after the root element" );
+   }
+}
+
+E57XmlReader::E57XmlReader( E57XmlHandler &handler ) : impl_( new Impl( handler ) )
+{
+}
+
+E57XmlReader::~E57XmlReader() = default;
+
+void E57XmlReader::parse( CheckedFile *file, uint64_t logicalStart, uint64_t logicalLength )
+{
+   // The section is parsed in memory, so read it in one go
+   ustring xml( static_cast<size_t>( logicalLength ), '\0' );
+
+   if ( !xml.empty() )
+   {
+      file->readAt( logicalStart, &xml[0], xml.size() );
+   }
+
+   impl_->parse( xml.data(), xml.size() );
+}
+
+void E57XmlReader::parse( const char *xml, size_t length )
+{
+   impl_->parse( xml, length );
+}
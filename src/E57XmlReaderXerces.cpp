@@ -0,0 +1,390 @@
+/*
+ * Original work Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ * Modified work Copyright 2018 - 2020 Andy Maloney <asmaloney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+// E57XmlReader using Xerces-C's SAX2 parser
+
+#include <limits>
+
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/sax/InputSource.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/util/BinInputStream.hpp>
+#include <xercesc/util/TransService.hpp>
+
+#include "CheckedFile.h"
+#include "E57XmlReader.h"
+#include "StringFunctions.h"
+
+using namespace e57;
+using namespace XERCES_CPP_NAMESPACE;
+
+static_assert( std::is_same<size_t, XMLSize_t>::value,
+               "size_t and XMLSize_t should be the same type" );
+
+namespace
+{
+   ustring toUString( const XMLCh *const xml_str )
+   {
+      ustring u_str;
+      if ( ( xml_str != nullptr ) && *xml_str )
+      {
+         TranscodeToStr UTF8Transcoder( xml_str, "UTF-8" );
+         u_str = ustring( reinterpret_cast<const char *>( UTF8Transcoder.str() ) );
+      }
+      return ( u_str );
+   }
+
+   ustring exceptionContext( const SAXParseException &ex )
+   {
+      return "systemId=" + toUString( ex.getSystemId() ) +
+             " xmlLine=" + toString( ex.getLineNumber() ) +
+             " xmlColumn=" + toString( ex.getColumnNumber() ) +
+             " parserMessage=" + toUString( ex.getMessage() );
+   }
+
+   class XercesAttributes : public E57XmlAttributes
+   {
+   public:
+      explicit XercesAttributes( const Attributes &attributes ) : attributes_( attributes )
+      {
+      }
+
+      size_t length() const override
+      {
+         return attributes_.getLength();
+      }
+
+      ustring qName( size_t index ) const override
+      {
+         return toUString( attributes_.getQName( index ) );
+      }
+
+      ustring localName( size_t index ) const override
+      {
+         return toUString( attributes_.getLocalName( index ) );
+      }
+
+      ustring uri( size_t index ) const override
+      {
+         return toUString( attributes_.getURI( index ) );
+      }
+
+      ustring value( size_t index ) const override
+      {
+         return toUString( attributes_.getValue( index ) );
+      }
+
+      bool find( const char *qName, ustring &value ) const override
+      {
+         XMLCh *xmlName = XMLString::transcode( qName );
+
+         XMLSize_t index;
+         const bool found = attributes_.getIndex( xmlName, index );
+
+         XMLString::release( &xmlName );
+
+         if ( found )
+         {
+            value = toUString( attributes_.getValue( index ) );
+         }
+
+         return found;
+      }
+
+   private:
+      const Attributes &attributes_;
+   };
+}
+
+//=============================================================================
+// E57FileInputStream
+
+class E57FileInputStream : public BinInputStream
+{
+public:
+   E57FileInputStream( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength );
+   ~E57FileInputStream() override = default;
+
+   E57FileInputStream( const E57FileInputStream & ) = delete;
+   E57FileInputStream &operator=( const E57FileInputStream & ) = delete;
+
+   XMLFilePos curPos() const override
+   {
+      return ( logicalPosition_ );
+   }
+
+   XMLSize_t readBytes( XMLByte *toFill, XMLSize_t maxToRead ) override;
+
+   const XMLCh *getContentType() const override
+   {
+      return nullptr;
+   }
+
+private:
+   //??? lifetime of cf_ must be longer than this object!
+   CheckedFile *cf_;
+   uint64_t logicalStart_;
+   uint64_t logicalLength_;
+   uint64_t logicalPosition_;
+};
+
+E57FileInputStream::E57FileInputStream( CheckedFile *cf, uint64_t logicalStart,
+                                        uint64_t logicalLength ) :
+   cf_( cf ),
+   logicalStart_( logicalStart ), logicalLength_( logicalLength ), logicalPosition_( logicalStart )
+{
+}
+
+XMLSize_t E57FileInputStream::readBytes( XMLByte *const toFill, const XMLSize_t maxToRead )
+{
+   if ( logicalPosition_ > logicalStart_ + logicalLength_ )
+   {
+      return ( 0 );
+   }
+
+   int64_t available = logicalStart_ + logicalLength_ - logicalPosition_;
+   if ( available <= 0 )
+   {
+      return ( 0 );
+   }
+
+   size_t maxToRead_size = maxToRead;
+
+   // Be careful if size_t is smaller than int64_t
+   size_t available_size;
+
+   // Assign to var to avoid MSVC warning
+   // This section can be simplified in C++17 using a "constexpr if".
+   constexpr bool cSizeCheck = ( sizeof( size_t ) >= sizeof( int64_t ) );
+   if ( cSizeCheck )
+   {
+      // size_t is at least as big as int64_t
+      available_size = static_cast<size_t>( available );
+   }
+   else
+   {
+      // size_t is smaller than int64_t, Calc max that size_t can hold
+      const int64_t size_max = std::numeric_limits<size_t>::max();
+
+      // read smaller of size_max, available
+      //??? redo
+      if ( size_max < available )
+      {
+         available_size = static_cast<size_t>( size_max );
+      }
+      else
+      {
+         available_size = static_cast<size_t>( available );
+      }
+   }
+
+   size_t readCount = std::min( maxToRead_size, available_size );
+
+   cf_->seek( logicalPosition_ );
+   cf_->read( reinterpret_cast<char *>( toFill ), readCount ); //??? cast ok?
+   logicalPosition_ += readCount;
+   return ( readCount );
+}
+
+//=============================================================================
+// E57XmlFileInputSource
+
+class E57XmlFileInputSource : public InputSource
+{
+public:
+   E57XmlFileInputSource( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength );
+   ~E57XmlFileInputSource() override = default;
+
+   E57XmlFileInputSource( const E57XmlFileInputSource & ) = delete;
+   E57XmlFileInputSource &operator=( const E57XmlFileInputSource & ) = delete;
+
+   BinInputStream *makeStream() const override;
+
+private:
+   //??? lifetime of cf_ must be longer than this object!
+   CheckedFile *cf_;
+   uint64_t logicalStart_;
+   uint64_t logicalLength_;
+};
+
+E57XmlFileInputSource::E57XmlFileInputSource( CheckedFile *cf, uint64_t logicalStart,
+                                              uint64_t logicalLength ) :
+   InputSource( "E57File",
+                XMLPlatformUtils::fgMemoryManager ), //??? what if want to use our own memory
+                                                     // manager?, what bufid is good?
+   cf_( cf ), logicalStart_( logicalStart ), logicalLength_( logicalLength )
+{
+}
+
+BinInputStream *E57XmlFileInputSource::makeStream() const
+{
+   return new E57FileInputStream( cf_, logicalStart_, logicalLength_ );
+}
+
+//=============================================================================
+// E57XmlReader
+
+class E57XmlReader::Impl : public DefaultHandler
+{
+public:
+   explicit Impl( E57XmlHandler &handler );
+   ~Impl() override;
+
+   void parse( const InputSource &inputSource );
+
+private:
+   /// SAX interface
+   void startElement( const XMLCh *uri, const XMLCh *localName, const XMLCh *qName,
+                      const Attributes &attributes ) override;
+   void endElement( const XMLCh *uri, const XMLCh *localName, const XMLCh *qName ) override;
+   void characters( const XMLCh *chars, XMLSize_t length ) override;
+
+   /// SAX error interface
+   void warning( const SAXParseException &ex ) override;
+   void error( const SAXParseException &ex ) override;
+   void fatalError( const SAXParseException &ex ) override;
+
+   E57XmlHandler &handler_;
+   SAX2XMLReader *xmlReader;
+};
+
+E57XmlReader::Impl::Impl( E57XmlHandler &handler ) : handler_( handler ), xmlReader( nullptr )
+{
+   // Initialize the XML4C2 system
+   try
+   {
+      XMLPlatformUtils::Initialize();
+   }
+   catch ( const XMLException &ex )
+   {
+      // Turn parser exception into E57Exception
+      throw E57_EXCEPTION2( ErrorXMLParserInit,
+                            "parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
+   }
+
+   xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
+
+   if ( xmlReader == nullptr )
+   {
+      XMLPlatformUtils::Terminate();
+
+      throw E57_EXCEPTION2( ErrorXMLParserInit, "could not create the xml reader" );
+   }
+
+   //??? check these are right
+   xmlReader->setFeature( XMLUni::fgSAX2CoreValidation, true );
+   xmlReader->setFeature( XMLUni::fgXercesDynamic, true );
+   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpaces, true );
+   xmlReader->setFeature( XMLUni::fgXercesSchema, true );
+   xmlReader->setFeature( XMLUni::fgXercesSchemaFullChecking, true );
+   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpacePrefixes, true );
+
+   xmlReader->setContentHandler( this );
+   xmlReader->setErrorHandler( this );
+}
+
+E57XmlReader::Impl::~Impl()
+{
+   delete xmlReader;
+
+   xmlReader = nullptr;
+
+   XMLPlatformUtils::Terminate();
+}
+
+void E57XmlReader::Impl::parse( const InputSource &inputSource )
+{
+   xmlReader->parse( inputSource );
+}
+
+void E57XmlReader::Impl::startElement( const XMLCh *const uri, const XMLCh *const localName,
+                                       const XMLCh *const qName, const Attributes &attributes )
+{
+   handler_.startElement( toUString( uri ), toUString( localName ), toUString( qName ),
+                          XercesAttributes( attributes ) );
+}
+
+void E57XmlReader::Impl::endElement( const XMLCh *const uri, const XMLCh *const localName,
+                                     const XMLCh *const qName )
+{
+   handler_.endElement( toUString( uri ), toUString( localName ), toUString( qName ) );
+}
+
+void E57XmlReader::Impl::characters( const XMLCh *const chars, const XMLSize_t length )
+{
+   //??? use length to make ustring
+   UNUSED( length );
+
+   const ustring text = toUString( chars );
+
+   handler_.characters( text.data(), text.size() );
+}
+
+void E57XmlReader::Impl::error( const SAXParseException &ex )
+{
+   throw E57_EXCEPTION2( ErrorXMLParser, exceptionContext( ex ) );
+}
+
+void E57XmlReader::Impl::fatalError( const SAXParseException &ex )
+{
+   throw E57_EXCEPTION2( ErrorXMLParser, exceptionContext( ex ) );
+}
+
+void E57XmlReader::Impl::warning( const SAXParseException &ex )
+{
+   // Don't take any action on warning from parser, just report
+   std::cerr << "**** XML parser warning: " << toUString( ex.getMessage() ) << std::endl;
+   std::cerr << "  Debug info:" << std::endl;
+   std::cerr << "    systemId=" << toUString( ex.getSystemId() ) << std::endl;
+   std::cerr << ",   xmlLine=" << ex.getLineNumber() << std::endl;
+   std::cerr << ",   xmlColumn=" << ex.getColumnNumber() << std::endl;
+}
+
+E57XmlReader::E57XmlReader( E57XmlHandler &handler ) : impl_( new Impl( handler ) )
+{
+}
+
+E57XmlReader::~E57XmlReader() = default;
+
+void E57XmlReader::parse( CheckedFile *file, uint64_t logicalStart, uint64_t logicalLength )
+{
+   // Create input source (XML section of E57 file turned into a stream).
+   E57XmlFileInputSource xmlSection( file, logicalStart, logicalLength );
+
+   impl_->parse( xmlSection );
+}
+
+void E57XmlReader::parse( const char *xml, size_t length )
+{
+   MemBufInputSource xmlSection( reinterpret_cast<const XMLByte *>( xml ), length, "E57File" );
+
+   impl_->parse( xmlSection );
+}
@@ -26,9 +26,13 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <cstring>
+#include <utility>
 
 #include "CompressedVectorNodeImpl.h"
+#include "DeltaCodec.h"
+#include "RunLengthCodec.h"
 #include "Encoder.h"
 #include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
@@ -40,10 +44,21 @@
 
 using namespace e57;
 
+namespace
+{
+   /// The BufferAllocator of the file sbuf is written to
+   std::shared_ptr<BufferAllocator> bufferAllocator( const SourceDestBuffer &sbuf )
+   {
+      const ImageFileImplSharedPtr imf( sbuf.impl()->destImageFile().lock() );
+
+      return ( imf != nullptr ) ? imf->bufferAllocator() : nullptr;
+   }
+}
+
 std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
                                                   std::shared_ptr<CompressedVectorNodeImpl> cVector,
                                                   std::vector<SourceDestBuffer> &sbufs,
-                                                  ustring & /*codecPath*/ )
+                                                  ustring & /*codecPath*/, unsigned outputMaxSize )
 {
    //??? For now, only handle one input
    if ( sbufs.size() != 1 )
@@ -88,10 +103,28 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
             return encoder;
          }
 
+         // E57_EXT_delta_codec
+         if ( const auto deltaCodec = cVector->findCodec( DELTA_CODEC_URI, "deltaCodec", path ) )
+         {
+            std::shared_ptr<Encoder> encoder( new DeltaIntegerEncoder(
+               false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(), ini->maximum(), 1.0,
+               0.0, deltaCodecOrder( *deltaCodec ) ) );
+            return encoder;
+         }
+
+         // E57_EXT_run_length_codec
+         if ( cVector->findCodec( RUN_LENGTH_CODEC_URI, "runLengthCodec", path ) )
+         {
+            std::shared_ptr<Encoder> encoder( new RunLengthIntegerEncoder(
+               false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(), ini->maximum(), 1.0,
+               0.0 ) );
+            return encoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint8_t>(
-               false, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, ini->minimum(),
+               false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(),
                ini->maximum(), 1.0, 0.0 ) );
             return encoder;
          }
@@ -99,7 +132,7 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
          if ( bitsPerRecord <= 16 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint16_t>(
-               false, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, ini->minimum(),
+               false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(),
                ini->maximum(), 1.0, 0.0 ) );
             return encoder;
          }
@@ -107,13 +140,13 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
          if ( bitsPerRecord <= 32 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint32_t>(
-               false, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, ini->minimum(),
+               false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(),
                ini->maximum(), 1.0, 0.0 ) );
             return encoder;
          }
 
          std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint64_t>(
-            false, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, ini->minimum(), ini->maximum(),
+            false, bytestreamNumber, sbuf, outputMaxSize, ini->minimum(), ini->maximum(),
             1.0, 0.0 ) );
          return encoder;
       }
@@ -143,10 +176,28 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
             return encoder;
          }
 
+         // E57_EXT_delta_codec
+         if ( const auto deltaCodec = cVector->findCodec( DELTA_CODEC_URI, "deltaCodec", path ) )
+         {
+            std::shared_ptr<Encoder> encoder( new DeltaIntegerEncoder(
+               true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(), sini->maximum(),
+               sini->scale(), sini->offset(), deltaCodecOrder( *deltaCodec ) ) );
+            return encoder;
+         }
+
+         // E57_EXT_run_length_codec
+         if ( cVector->findCodec( RUN_LENGTH_CODEC_URI, "runLengthCodec", path ) )
+         {
+            std::shared_ptr<Encoder> encoder( new RunLengthIntegerEncoder(
+               true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(), sini->maximum(),
+               sini->scale(), sini->offset() ) );
+            return encoder;
+         }
+
          if ( bitsPerRecord <= 8 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint8_t>(
-               true, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, sini->minimum(),
+               true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(),
                sini->maximum(), sini->scale(), sini->offset() ) );
             return encoder;
          }
@@ -154,7 +205,7 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
          if ( bitsPerRecord <= 16 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint16_t>(
-               true, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, sini->minimum(),
+               true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(),
                sini->maximum(), sini->scale(), sini->offset() ) );
             return encoder;
          }
@@ -162,13 +213,13 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
          if ( bitsPerRecord <= 32 )
          {
             std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint32_t>(
-               true, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, sini->minimum(),
+               true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(),
                sini->maximum(), sini->scale(), sini->offset() ) );
             return encoder;
          }
 
          std::shared_ptr<Encoder> encoder( new BitpackIntegerEncoder<uint64_t>(
-            true, bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, sini->minimum(), sini->maximum(),
+            true, bytestreamNumber, sbuf, outputMaxSize, sini->minimum(), sini->maximum(),
             sini->scale(), sini->offset() ) );
          return encoder;
       }
@@ -180,14 +231,14 @@ std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
 
          // !!! need to pick smarter channel buffer sizes, here and elsewhere
          std::shared_ptr<Encoder> encoder( new BitpackFloatEncoder(
-            bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/, fni->precision() ) );
+            bytestreamNumber, sbuf, outputMaxSize, fni->precision() ) );
          return encoder;
       }
 
       case TypeString:
       {
          std::shared_ptr<Encoder> encoder(
-            new BitpackStringEncoder( bytestreamNumber, sbuf, DATA_PACKET_MAX /*!!!*/ ) );
+            new BitpackStringEncoder( bytestreamNumber, sbuf, outputMaxSize ) );
 
          return encoder;
       }
@@ -215,7 +266,8 @@ void Encoder::dump( int indent, std::ostream &os ) const
 BitpackEncoder::BitpackEncoder( unsigned bytestreamNumber, SourceDestBuffer &sbuf,
                                 unsigned outputMaxSize, unsigned alignmentSize ) :
    Encoder( bytestreamNumber ),
-   sourceBuffer_( sbuf.impl() ), outBuffer_( outputMaxSize ), outBufferFirst_( 0 ),
+   sourceBuffer_( sbuf.impl() ), outBuffer_( bufferAllocator( sbuf ), outputMaxSize ),
+   outBufferFirst_( 0 ),
    outBufferEnd_( 0 ), outBufferAlignmentSize_( alignmentSize ), currentRecordIndex_( 0 )
 {
 }
@@ -230,6 +282,12 @@ uint64_t BitpackEncoder::currentRecordIndex()
    return ( currentRecordIndex_ );
 }
 
+void BitpackEncoder::skipRecords( size_t recordCount )
+{
+   sourceBuffer_->skip( recordCount );
+   currentRecordIndex_ += recordCount;
+}
+
 size_t BitpackEncoder::outputAvailable() const
 {
    return outBufferEnd_ - outBufferFirst_;
@@ -375,7 +433,7 @@ void BitpackEncoder::dump( int indent, std::ostream &os ) const
    for ( i = 0; i < outBuffer_.size() && i < 20; i++ )
    {
       os << space( indent + 4 ) << "outBuffer[" << i
-         << "]: " << static_cast<unsigned>( static_cast<unsigned char>( outBuffer_.at( i ) ) )
+         << "]: " << static_cast<unsigned>( static_cast<unsigned char>( outBuffer_[i] ) )
          << std::endl;
    }
    if ( i < outBuffer_.size() )
@@ -433,13 +491,13 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       auto outp = reinterpret_cast<float *>( &outBuffer_[outBufferEnd_] );
 
       // Copy floats from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextFloatBlock( outp, recordCount );
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextFloat();
-#ifdef E57_VERBOSE
          std::cout << "encoding float: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
    else
    {
@@ -448,13 +506,13 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       auto outp = reinterpret_cast<double *>( &outBuffer_[outBufferEnd_] );
 
       // Copy doubles from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextDoubleBlock( outp, recordCount );
+#ifdef E57_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextDouble();
-#ifdef E57_VERBOSE
          std::cout << "encoding double: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
 
    // Update end of outBuffer
@@ -526,14 +584,14 @@ uint64_t BitpackStringEncoder::processRecords( size_t recordCount )
       if ( isStringActive_ && !prefixComplete_ )
       {
          // Calc the length prefix, either 1 byte or 8 bytes
-         size_t len = currentString_.length();
+         size_t len = currentLength_;
          if ( len <= 127 )
          {
 #ifdef E57_VERBOSE
             std::cout << "encoding short string: (len=" << len
                       << ") "
                          ""
-                      << currentString_
+                      << ustring( currentChars_, currentLength_ )
                       << ""
                          ""
                       << std::endl;
@@ -556,7 +614,7 @@ uint64_t BitpackStringEncoder::processRecords( size_t recordCount )
             std::cout << "encoding long string: (len=" << len
                       << ") "
                          ""
-                      << currentString_
+                      << ustring( currentChars_, currentLength_ )
                       << ""
                          ""
                       << std::endl;
@@ -580,20 +638,17 @@ uint64_t BitpackStringEncoder::processRecords( size_t recordCount )
       if ( isStringActive_ )
       {
          // Copy as much string as will fit in outBuffer
-         size_t bytesToProcess =
-            std::min( currentString_.length() - currentCharPosition_, bytesFree );
+         size_t bytesToProcess = std::min( currentLength_ - currentCharPosition_, bytesFree );
 
-         for ( size_t i = 0; i < bytesToProcess; i++ )
-         {
-            *outp++ = currentString_[currentCharPosition_ + i];
-         }
+         memcpy( outp, currentChars_ + currentCharPosition_, bytesToProcess );
+         outp += bytesToProcess;
 
          currentCharPosition_ += bytesToProcess;
          totalBytesProcessed_ += bytesToProcess;
          bytesFree -= bytesToProcess;
 
          // Check if finished string
-         if ( currentCharPosition_ == currentString_.length() )
+         if ( currentCharPosition_ == currentLength_ )
          {
             isStringActive_ = false;
             recordsProcessed++;
@@ -601,13 +656,14 @@ uint64_t BitpackStringEncoder::processRecords( size_t recordCount )
       }
       if ( !isStringActive_ && recordsProcessed < recordCount )
       {
-         // Get next string from sourceBuffer
-         currentString_ = sourceBuffer_->getNextString();
+         // Get next string from sourceBuffer, in place. All the records of a write are processed
+         // before it returns, so the string stays valid while it is being copied.
+         sourceBuffer_->getNextString( currentChars_, currentLength_ );
          isStringActive_ = true;
          prefixComplete_ = false;
          currentCharPosition_ = 0;
 #ifdef E57_VERBOSE
-         std::cout << "getting next string, length=" << currentString_.length() << std::endl;
+         std::cout << "getting next string, length=" << currentLength_ << std::endl;
 #endif
       }
    }
@@ -646,13 +702,74 @@ void BitpackStringEncoder::dump( int indent, std::ostream &os ) const
    os << space( indent ) << "totalBytesProcessed:    " << totalBytesProcessed_ << std::endl;
    os << space( indent ) << "isStringActive:         " << isStringActive_ << std::endl;
    os << space( indent ) << "prefixComplete:         " << prefixComplete_ << std::endl;
-   os << space( indent ) << "currentString:          " << currentString_ << std::endl;
+   os << space( indent ) << "currentString:          " << ustring( currentChars_, currentLength_ )
+      << std::endl;
    os << space( indent ) << "currentCharPosition:    " << currentCharPosition_ << std::endl;
 }
 #endif
 
 //================================================================
 
+namespace
+{
+   // Pack one block of records of a fixed bit width, the mirror of unpackBlock() in Decoder.cpp.
+   // A block is as many records as a word has bits, so it fills exactly Bits words. The values
+   // must already be range checked. With Bits known at compile time, the word and shift for each
+   // record are constants and the loop unrolls without any branches.
+   template <typename RegisterT, unsigned Bits>
+   void packBlock( const int64_t *values, int64_t minimum, RegisterT *outp )
+   {
+      constexpr unsigned RegisterBits = sizeof( RegisterT ) * 8;
+      constexpr uint64_t Mask = ( Bits == 64 ) ? ~0ULL : ( 1ULL << ( Bits % 64 ) ) - 1;
+
+      // Build the words locally so the compiler can keep them in registers
+      RegisterT words[Bits] = {};
+
+      for ( unsigned i = 0; i < RegisterBits; ++i )
+      {
+         const unsigned bit = i * Bits;
+         const unsigned word = bit / RegisterBits;
+         const unsigned shift = bit % RegisterBits;
+
+         // Subtract as unsigned so a full 64 bit range can't overflow
+         const auto uValue = static_cast<RegisterT>(
+            ( static_cast<uint64_t>( values[i] ) - static_cast<uint64_t>( minimum ) ) & Mask );
+
+         words[word] |= static_cast<RegisterT>( uValue << shift );
+
+         // The record spills into the next word (shift can't be 0 here)
+         if ( shift + Bits > RegisterBits )
+         {
+            words[word + 1] |= static_cast<RegisterT>( uValue >> ( RegisterBits - shift ) );
+         }
+      }
+
+      memcpy( outp, words, sizeof( words ) );
+   }
+
+   // Table of packBlock() for every bit width from 1 to the size of RegisterT
+   template <typename RegisterT> struct BlockPackers
+   {
+      using Packer = void ( * )( const int64_t *, int64_t, RegisterT * );
+
+      static constexpr size_t RegisterBits = sizeof( RegisterT ) * 8;
+
+      template <size_t... I>
+      static constexpr std::array<Packer, RegisterBits> makeTable( std::index_sequence<I...> )
+      {
+         return { { &packBlock<RegisterT, I + 1>... } };
+      }
+
+      static constexpr std::array<Packer, RegisterBits> table =
+         makeTable( std::make_index_sequence<RegisterBits>() );
+   };
+
+   template <typename RegisterT>
+   constexpr std::array<typename BlockPackers<RegisterT>::Packer,
+                        BlockPackers<RegisterT>::RegisterBits>
+      BlockPackers<RegisterT>::table;
+}
+
 template <typename RegisterT>
 BitpackIntegerEncoder<RegisterT>::BitpackIntegerEncoder(
    bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &sbuf, unsigned outputMaxSize,
@@ -671,6 +788,14 @@ BitpackIntegerEncoder<RegisterT>::BitpackIntegerEncoder(
    sourceBitMask_ = ( bitsPerRecord_ == 64 ) ? ~0 : ( 1ULL << bitsPerRecord_ ) - 1;
    registerBitsUsed_ = 0;
    register_ = 0;
+
+   // The factory only makes us for records which fit in RegisterT
+   if ( bitsPerRecord_ == 0 || bitsPerRecord_ > RegisterBits )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "bitsPerRecord=" + toString( bitsPerRecord_ ) );
+   }
+
+   packBlock_ = BlockPackers<RegisterT>::table[bitsPerRecord_ - 1];
 }
 
 template <typename RegisterT>
@@ -724,103 +849,174 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords( size_t recordCount )
    auto outp = reinterpret_cast<RegisterT *>( &outBuffer_[outBufferEnd_] );
    unsigned outTransferred = 0;
 
+   // Source values are fetched a block at a time. SourceBlockSize is a multiple of RegisterBits.
+   constexpr size_t SourceBlockSize = 64;
+   int64_t sourceBlock[SourceBlockSize];
+
    // Copy bits from sourceBuffer_ to outBuffer_
-   for ( unsigned i = 0; i < recordCount; i++ )
+   size_t i = 0;
+   while ( i < recordCount )
    {
-      int64_t rawValue;
+      // While the register is empty, whole blocks of RegisterBits records are packed straight
+      // into the output. Otherwise only fetch enough records to empty it so that the next fetch
+      // starts a block. It always empties within SourceBlockSize records.
+      size_t fetchCount = SourceBlockSize;
 
-      // The parameter isScaledInteger_ determines which version of getNextInt64 gets called
+      if ( registerBitsUsed_ != 0 )
+      {
+         unsigned bitsUsed = registerBitsUsed_;
+
+         for ( fetchCount = 0; ( bitsUsed != 0 ) && ( fetchCount < SourceBlockSize ); ++fetchCount )
+         {
+            bitsUsed = ( bitsUsed + bitsPerRecord_ ) % RegisterBits;
+         }
+      }
+
+      const size_t blockCount = std::min( fetchCount, recordCount - i );
+
+      // The parameter isScaledInteger_ determines which version of getNextInt64Block gets
+      // called
       if ( isScaledInteger_ )
       {
-         rawValue = sourceBuffer_->getNextInt64( scale_, offset_ );
+         sourceBuffer_->getNextInt64Block( sourceBlock, blockCount, scale_, offset_ );
       }
       else
       {
-         rawValue = sourceBuffer_->getNextInt64();
+         sourceBuffer_->getNextInt64Block( sourceBlock, blockCount );
       }
 
-      // Enforce min/max specification on value
-      if ( rawValue < minimum_ || maximum_ < rawValue )
+      // Enforce min/max specification on values (unless the writer trusts them). Check the
+      // whole block without branching, and only look for the value which is out of bounds if
+      // there is one.
+      bool inBounds = true;
+      if ( sourceBuffer_->validationLevel() != ValidationNone )
       {
-         throw E57_EXCEPTION2( ErrorValueOutOfBounds, "rawValue=" + toString( rawValue ) +
-                                                         " minimum=" + toString( minimum_ ) +
-                                                         " maximum=" + toString( maximum_ ) );
+         for ( size_t j = 0; j < blockCount; j++ )
+         {
+            inBounds &= ( minimum_ <= sourceBlock[j] ) & ( sourceBlock[j] <= maximum_ );
+         }
       }
 
-      auto uValue = static_cast<uint64_t>( rawValue - minimum_ );
-
-#ifdef E57_VERBOSE
-      std::cout << "encoding integer rawValue=" << binaryString( rawValue ) << " = "
-                << hexString( rawValue ) << std::endl;
-      std::cout << "                 uValue  =" << binaryString( uValue ) << " = "
-                << hexString( uValue ) << std::endl;
-#endif
-#ifdef VALIDATE_BASIC
-      // Double check that no bits outside of the mask are set
-      if ( uValue & ~static_cast<uint64_t>( sourceBitMask_ ) )
+      if ( !inBounds )
       {
-         throw E57_EXCEPTION2( ErrorInternal, "uValue=" + toString( uValue ) );
+         for ( size_t j = 0; j < blockCount; j++ )
+         {
+            const int64_t rawValue = sourceBlock[j];
+
+            if ( rawValue < minimum_ || maximum_ < rawValue )
+            {
+               throw E57_EXCEPTION2( ErrorValueOutOfBounds,
+                                     "rawValue=" + toString( rawValue ) +
+                                        " minimum=" + toString( minimum_ ) +
+                                        " maximum=" + toString( maximum_ ) );
+            }
+         }
       }
+
+      size_t j = 0;
+
+      if ( registerBitsUsed_ == 0 )
+      {
+         // The records of a block fill exactly bitsPerRecord_ words, so the register is still
+         // empty afterwards
+         for ( ; blockCount - j >= RegisterBits; j += RegisterBits )
+         {
+#ifdef VALIDATE_BASIC
+            // Before transfer, double check address within bounds
+            if ( outTransferred + bitsPerRecord_ > transferMax )
+            {
+               throw E57_EXCEPTION2( ErrorInternal,
+                                     "outTransferred=" + toString( outTransferred ) +
+                                        " transferMax" + toString( transferMax ) );
+            }
 #endif
-      // Mask off upper bits (just in case)
-      uValue &= static_cast<uint64_t>( sourceBitMask_ );
+            packBlock_( &sourceBlock[j], minimum_, &outp[outTransferred] );
+            outTransferred += bitsPerRecord_;
+         }
+      }
+
+      for ( ; j < blockCount; j++ )
+      {
+         const int64_t rawValue = sourceBlock[j];
+
+         // Subtract as unsigned so a full 64 bit range can't overflow
+         uint64_t uValue = static_cast<uint64_t>( rawValue ) - static_cast<uint64_t>( minimum_ );
 
-      // See if uValue bits will fit in register
-      unsigned newRegisterBitsUsed = registerBitsUsed_ + bitsPerRecord_;
 #ifdef E57_VERBOSE
-      std::cout << "  registerBitsUsed=" << registerBitsUsed_
-                << "  newRegisterBitsUsed=" << newRegisterBitsUsed << std::endl;
+         std::cout << "encoding integer rawValue=" << binaryString( rawValue ) << " = "
+                   << hexString( rawValue ) << std::endl;
+         std::cout << "                 uValue  =" << binaryString( uValue ) << " = "
+                   << hexString( uValue ) << std::endl;
 #endif
-      if ( newRegisterBitsUsed > 8 * sizeof( RegisterT ) )
-      {
-         // Have more than one registers worth, fill register, transfer, then fill some more
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
 #ifdef VALIDATE_BASIC
-         // Before transfer, double check address within bounds
-         if ( outTransferred >= transferMax )
+         // Double check that no bits outside of the mask are set
+         if ( uValue & ~static_cast<uint64_t>( sourceBitMask_ ) )
          {
-            throw E57_EXCEPTION2( ErrorInternal, "outTransferred=" + toString( outTransferred ) +
-                                                    " transferMax" + toString( transferMax ) );
+            throw E57_EXCEPTION2( ErrorInternal, "uValue=" + toString( uValue ) );
          }
 #endif
-         outp[outTransferred] = register_;
-
-         outTransferred++;
+         // Mask off upper bits (just in case)
+         uValue &= static_cast<uint64_t>( sourceBitMask_ );
 
-         register_ =
-            static_cast<RegisterT>( uValue ) >> ( 8 * sizeof( RegisterT ) - registerBitsUsed_ );
-         registerBitsUsed_ = newRegisterBitsUsed - 8 * sizeof( RegisterT );
-      }
-      else if ( newRegisterBitsUsed == 8 * sizeof( RegisterT ) )
-      {
-         // Input will exactly fill register, insert value, then transfer
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
-#ifdef VALIDATE_BASIC
-         // Before transfer, double check address within bounds
-         if ( outTransferred >= transferMax )
+         // See if uValue bits will fit in register
+         unsigned newRegisterBitsUsed = registerBitsUsed_ + bitsPerRecord_;
+#ifdef E57_VERBOSE
+         std::cout << "  registerBitsUsed=" << registerBitsUsed_
+                   << "  newRegisterBitsUsed=" << newRegisterBitsUsed << std::endl;
+#endif
+         if ( newRegisterBitsUsed > 8 * sizeof( RegisterT ) )
          {
-            throw E57_EXCEPTION2( ErrorInternal, "outTransferred=" + toString( outTransferred ) +
-                                                    " transferMax" + toString( transferMax ) );
+            // Have more than one registers worth, fill register, transfer, then fill some more
+            register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
+#ifdef VALIDATE_BASIC
+            // Before transfer, double check address within bounds
+            if ( outTransferred >= transferMax )
+            {
+               throw E57_EXCEPTION2( ErrorInternal, "outTransferred=" + toString( outTransferred ) +
+                                                       " transferMax" + toString( transferMax ) );
+            }
+#endif
+            outp[outTransferred] = register_;
+
+            outTransferred++;
+
+            register_ =
+               static_cast<RegisterT>( uValue ) >> ( 8 * sizeof( RegisterT ) - registerBitsUsed_ );
+            registerBitsUsed_ = newRegisterBitsUsed - 8 * sizeof( RegisterT );
          }
+         else if ( newRegisterBitsUsed == 8 * sizeof( RegisterT ) )
+         {
+            // Input will exactly fill register, insert value, then transfer
+            register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
+#ifdef VALIDATE_BASIC
+            // Before transfer, double check address within bounds
+            if ( outTransferred >= transferMax )
+            {
+               throw E57_EXCEPTION2( ErrorInternal, "outTransferred=" + toString( outTransferred ) +
+                                                       " transferMax" + toString( transferMax ) );
+            }
 #endif
-         outp[outTransferred] = register_;
+            outp[outTransferred] = register_;
 
-         outTransferred++;
+            outTransferred++;
 
-         register_ = 0;
-         registerBitsUsed_ = 0;
-      }
-      else
-      {
-         // There is extra room in register, insert value, but don't do transfer yet
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
-         registerBitsUsed_ = newRegisterBitsUsed;
-      }
+            register_ = 0;
+            registerBitsUsed_ = 0;
+         }
+         else
+         {
+            // There is extra room in register, insert value, but don't do transfer yet
+            register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
+            registerBitsUsed_ = newRegisterBitsUsed;
+         }
 #ifdef E57_VERBOSE
-      std::cout << "  After " << outTransferred << " transfers and " << i + 1
-                << " records, encoder:" << std::endl;
-      dump( 4 );
+         std::cout << "  After " << outTransferred << " transfers and " << i + j + 1
+                   << " records, encoder:" << std::endl;
+         dump( 4 );
 #endif
+      }
+
+      i += blockCount;
    }
 
    // Update tail of output buffer
@@ -894,6 +1090,323 @@ void BitpackIntegerEncoder<RegisterT>::dump( int indent, std::ostream &os ) cons
 
 //================================================================
 
+DeltaIntegerEncoder::DeltaIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber,
+                                          SourceDestBuffer &sbuf, unsigned outputMaxSize,
+                                          int64_t minimum, int64_t maximum, double scale,
+                                          double offset, unsigned order ) :
+   BitpackEncoder( bytestreamNumber, sbuf, outputMaxSize + DELTA_BLOCK_MAX_SIZE, 1 ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), maximum_( maximum ), scale_( scale ),
+   offset_( offset ), order_( order ), baseSize_( deltaBaseSize( minimum, maximum ) )
+{
+   static_assert( sizeof( block_ ) / sizeof( block_[0] ) == DELTA_BLOCK_SIZE,
+                  "Unexpected delta block size" );
+}
+
+uint64_t DeltaIntegerEncoder::processRecords( size_t recordCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "DeltaIntegerEncoder::processRecords() called, recordCount=" << recordCount
+             << std::endl;
+#endif
+
+   outBufferShiftDown();
+
+   int64_t sourceBlock[DELTA_BLOCK_SIZE];
+   const bool checkLimits = ( sourceBuffer_->validationLevel() != ValidationNone );
+
+   size_t i = 0;
+   while ( i < recordCount )
+   {
+      // Only take records while a whole block fits in the output, so a block can always be
+      // written as soon as it is full. The buffer has room for one more block than the output
+      // size, so it is never short of room without a packet's worth of output.
+      if ( outBuffer_.size() - outBufferEnd_ < DELTA_BLOCK_MAX_SIZE )
+      {
+         break;
+      }
+
+      const size_t count = std::min( DELTA_BLOCK_SIZE - blockCount_, recordCount - i );
+
+      if ( isScaledInteger_ )
+      {
+         sourceBuffer_->getNextInt64Block( sourceBlock, count, scale_, offset_ );
+      }
+      else
+      {
+         sourceBuffer_->getNextInt64Block( sourceBlock, count );
+      }
+
+      for ( size_t j = 0; j < count; j++ )
+      {
+         const int64_t rawValue = sourceBlock[j];
+
+         if ( checkLimits && ( rawValue < minimum_ || maximum_ < rawValue ) )
+         {
+            throw E57_EXCEPTION2( ErrorValueOutOfBounds, "rawValue=" + toString( rawValue ) +
+                                                            " minimum=" + toString( minimum_ ) +
+                                                            " maximum=" + toString( maximum_ ) );
+         }
+
+         block_[blockCount_++] =
+            static_cast<uint64_t>( rawValue ) - static_cast<uint64_t>( minimum_ );
+      }
+
+      if ( blockCount_ == DELTA_BLOCK_SIZE )
+      {
+         writeBlock();
+      }
+
+      i += count;
+   }
+
+   currentRecordIndex_ += i;
+
+   return currentRecordIndex_;
+}
+
+void DeltaIntegerEncoder::writeBlock()
+{
+   // Zigzag encoded residuals of the records after the first, and the bits they need
+   uint64_t residuals[DELTA_BLOCK_SIZE] = {};
+   uint64_t allBits = 0;
+
+   for ( size_t i = 1; i < blockCount_; i++ )
+   {
+      residuals[i] = deltaZigzag( block_[i] - deltaPrediction( order_, block_, i ) );
+      allBits |= residuals[i];
+   }
+
+   unsigned width = 0;
+   while ( width < 64 && ( allBits >> width ) != 0 )
+   {
+      ++width;
+   }
+
+   auto outp = reinterpret_cast<uint8_t *>( &outBuffer_[outBufferEnd_] );
+
+   *outp++ = static_cast<uint8_t>( blockCount_ - 1 );
+   *outp++ = static_cast<uint8_t>( width );
+
+   for ( unsigned b = 0; b < baseSize_; b++ )
+   {
+      *outp++ = static_cast<uint8_t>( block_[0] >> ( 8 * b ) );
+   }
+
+   // Pack up to 32 bits at a time so they always fit in the register with what is left in it
+   uint64_t bitRegister = 0;
+   unsigned bitsUsed = 0;
+
+   auto putBits = [&]( uint64_t value, unsigned bitCount ) {
+      bitRegister |= value << bitsUsed;
+      bitsUsed += bitCount;
+
+      while ( bitsUsed >= 8 )
+      {
+         *outp++ = static_cast<uint8_t>( bitRegister );
+         bitRegister >>= 8;
+         bitsUsed -= 8;
+      }
+   };
+
+   for ( size_t i = 1; i < blockCount_; i++ )
+   {
+      if ( width > 32 )
+      {
+         putBits( residuals[i] & 0xFFFFFFFF, 32 );
+         putBits( residuals[i] >> 32, width - 32 );
+      }
+      else
+      {
+         putBits( residuals[i], width );
+      }
+   }
+
+   if ( bitsUsed > 0 )
+   {
+      *outp++ = static_cast<uint8_t>( bitRegister );
+   }
+
+   const auto blockSize = static_cast<size_t>( outp - reinterpret_cast<uint8_t *>(
+                                                         &outBuffer_[outBufferEnd_] ) );
+
+   outBufferEnd_ += blockSize;
+   bytesWritten_ += blockSize;
+   blockCount_ = 0;
+}
+
+bool DeltaIntegerEncoder::registerFlushToOutput()
+{
+   if ( blockCount_ > 0 )
+   {
+      if ( outBuffer_.size() - outBufferEnd_ < DELTA_BLOCK_MAX_SIZE )
+      {
+         return false; // flush didn't complete (not enough room).
+      }
+
+      writeBlock();
+   }
+
+   return true;
+}
+
+float DeltaIntegerEncoder::bitsPerRecord()
+{
+   // Until some blocks are written, assume the worst case of storing each value as is
+   if ( bytesWritten_ == 0 )
+   {
+      return static_cast<float>( 8 * baseSize_ );
+   }
+
+   return static_cast<float>( bytesWritten_ * 8 ) / static_cast<float>( currentRecordIndex_ );
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void DeltaIntegerEncoder::dump( int indent, std::ostream &os ) const
+{
+   BitpackEncoder::dump( indent, os );
+   os << space( indent ) << "isScaledInteger:  " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:          " << minimum_ << std::endl;
+   os << space( indent ) << "maximum:          " << maximum_ << std::endl;
+   os << space( indent ) << "scale:            " << scale_ << std::endl;
+   os << space( indent ) << "offset:           " << offset_ << std::endl;
+   os << space( indent ) << "order:            " << order_ << std::endl;
+   os << space( indent ) << "blockCount:       " << blockCount_ << std::endl;
+}
+#endif
+
+//================================================================
+
+RunLengthIntegerEncoder::RunLengthIntegerEncoder( bool isScaledInteger,
+                                                  unsigned bytestreamNumber,
+                                                  SourceDestBuffer &sbuf, unsigned outputMaxSize,
+                                                  int64_t minimum, int64_t maximum, double scale,
+                                                  double offset ) :
+   BitpackEncoder( bytestreamNumber, sbuf,
+                   outputMaxSize + RUN_LENGTH_BLOCK_SIZE * RUN_LENGTH_RUN_MAX_SIZE, 1 ),
+   isScaledInteger_( isScaledInteger ), minimum_( minimum ), maximum_( maximum ), scale_( scale ),
+   offset_( offset ), valueSize_( runLengthValueSize( minimum, maximum ) )
+{
+}
+
+uint64_t RunLengthIntegerEncoder::processRecords( size_t recordCount )
+{
+#ifdef E57_VERBOSE
+   std::cout << "RunLengthIntegerEncoder::processRecords() called, recordCount=" << recordCount
+             << std::endl;
+#endif
+
+   outBufferShiftDown();
+
+   int64_t sourceBlock[RUN_LENGTH_BLOCK_SIZE];
+   const bool checkLimits = ( sourceBuffer_->validationLevel() != ValidationNone );
+
+   size_t i = 0;
+   while ( i < recordCount )
+   {
+      // Only take a block of records while every one of them can end a run. The buffer has room
+      // for a block's worth of runs more than the output size, so it is never short of room
+      // without a packet's worth of output.
+      if ( outBuffer_.size() - outBufferEnd_ < RUN_LENGTH_BLOCK_SIZE * RUN_LENGTH_RUN_MAX_SIZE )
+      {
+         break;
+      }
+
+      const size_t count = std::min<size_t>( RUN_LENGTH_BLOCK_SIZE, recordCount - i );
+
+      if ( isScaledInteger_ )
+      {
+         sourceBuffer_->getNextInt64Block( sourceBlock, count, scale_, offset_ );
+      }
+      else
+      {
+         sourceBuffer_->getNextInt64Block( sourceBlock, count );
+      }
+
+      for ( size_t j = 0; j < count; j++ )
+      {
+         const int64_t rawValue = sourceBlock[j];
+
+         if ( checkLimits && ( rawValue < minimum_ || maximum_ < rawValue ) )
+         {
+            throw E57_EXCEPTION2( ErrorValueOutOfBounds, "rawValue=" + toString( rawValue ) +
+                                                            " minimum=" + toString( minimum_ ) +
+                                                            " maximum=" + toString( maximum_ ) );
+         }
+
+         const uint64_t value =
+            static_cast<uint64_t>( rawValue ) - static_cast<uint64_t>( minimum_ );
+
+         if ( runLength_ > 0 && value != runValue_ )
+         {
+            writeRun();
+         }
+
+         runValue_ = value;
+         ++runLength_;
+      }
+
+      i += count;
+   }
+
+   currentRecordIndex_ += i;
+
+   return currentRecordIndex_;
+}
+
+void RunLengthIntegerEncoder::writeRun()
+{
+   const size_t runSize =
+      runLengthWriteRun( &outBuffer_[outBufferEnd_], runLength_, runValue_, valueSize_ );
+
+   outBufferEnd_ += runSize;
+   bytesWritten_ += runSize;
+   runLength_ = 0;
+}
+
+bool RunLengthIntegerEncoder::registerFlushToOutput()
+{
+   if ( runLength_ > 0 )
+   {
+      if ( outBuffer_.size() - outBufferEnd_ < RUN_LENGTH_RUN_MAX_SIZE )
+      {
+         return false; // flush didn't complete (not enough room).
+      }
+
+      writeRun();
+   }
+
+   return true;
+}
+
+float RunLengthIntegerEncoder::bitsPerRecord()
+{
+   // Count the run being extended as if it ended now
+   const uint64_t bytes = bytesWritten_ + ( ( runLength_ > 0 ) ? 1 + valueSize_ : 0 );
+
+   if ( currentRecordIndex_ == 0 )
+   {
+      return static_cast<float>( 8 * ( 1 + valueSize_ ) );
+   }
+
+   return static_cast<float>( bytes * 8 ) / static_cast<float>( currentRecordIndex_ );
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void RunLengthIntegerEncoder::dump( int indent, std::ostream &os ) const
+{
+   BitpackEncoder::dump( indent, os );
+   os << space( indent ) << "isScaledInteger:  " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "minimum:          " << minimum_ << std::endl;
+   os << space( indent ) << "maximum:          " << maximum_ << std::endl;
+   os << space( indent ) << "scale:            " << scale_ << std::endl;
+   os << space( indent ) << "offset:           " << offset_ << std::endl;
+   os << space( indent ) << "runValue:         " << runValue_ << std::endl;
+   os << space( indent ) << "runLength:        " << runLength_ << std::endl;
+}
+#endif
+
+//================================================================
+
 ConstantIntegerEncoder::ConstantIntegerEncoder( unsigned bytestreamNumber, SourceDestBuffer &sbuf,
                                                 int64_t minimum ) :
    Encoder( bytestreamNumber ),
@@ -936,6 +1449,12 @@ uint64_t ConstantIntegerEncoder::currentRecordIndex()
    return ( currentRecordIndex_ );
 }
 
+void ConstantIntegerEncoder::skipRecords( size_t recordCount )
+{
+   sourceBuffer_->skip( recordCount );
+   currentRecordIndex_ += recordCount;
+}
+
 float ConstantIntegerEncoder::bitsPerRecord()
 {
    // We don't produce any output
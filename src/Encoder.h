@@ -28,15 +28,17 @@
 #pragma once
 
 #include "Common.h"
+#include "IOBuffer.h"
 
 namespace e57
 {
    class Encoder
    {
    public:
+      /// @param [in] outputMaxSize size in bytes of the encoder's output buffer
       static std::shared_ptr<Encoder> EncoderFactory(
          unsigned bytestreamNumber, std::shared_ptr<CompressedVectorNodeImpl> cVector,
-         std::vector<SourceDestBuffer> &sbuf, ustring &codecPath );
+         std::vector<SourceDestBuffer> &sbuf, ustring &codecPath, unsigned outputMaxSize );
 
       virtual ~Encoder() = default;
 
@@ -46,6 +48,10 @@ namespace e57
       virtual float bitsPerRecord() = 0;
       virtual bool registerFlushToOutput() = 0;
 
+      /// Pass over recordCount records without encoding them, e.g. because they were encoded
+      /// by another encoder. Must only be called when the output is empty and flushed.
+      virtual void skipRecords( size_t recordCount ) = 0;
+
       virtual size_t outputAvailable() const = 0; /// number of bytes that can be read
       virtual void outputRead( char *dest, size_t byteCount ) = 0; /// get data from encoder
       virtual void outputClear() = 0;
@@ -77,6 +83,7 @@ namespace e57
       uint64_t currentRecordIndex() override;
       float bitsPerRecord() override = 0;
       bool registerFlushToOutput() override = 0;
+      void skipRecords( size_t recordCount ) override;
 
       size_t outputAvailable() const override;                  /// number of bytes that can be read
       void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
@@ -98,7 +105,7 @@ namespace e57
 
       std::shared_ptr<SourceDestBufferImpl> sourceBuffer_;
 
-      std::vector<char> outBuffer_;
+      IOBuffer outBuffer_; // from the file's BufferAllocator
       size_t outBufferFirst_;
       size_t outBufferEnd_;
       size_t outBufferAlignmentSize_;
@@ -142,7 +149,8 @@ namespace e57
       uint64_t totalBytesProcessed_;
       bool isStringActive_;
       bool prefixComplete_;
-      ustring currentString_;
+      const char *currentChars_ = nullptr;
+      size_t currentLength_ = 0;
       size_t currentCharPosition_;
    };
 
@@ -171,6 +179,77 @@ namespace e57
       uint64_t sourceBitMask_;
       unsigned registerBitsUsed_;
       RegisterT register_;
+      static constexpr size_t RegisterBits = sizeof( RegisterT ) * 8;
+
+      /// Packs RegisterBits range checked values into exactly bitsPerRecord_ words at outp,
+      /// subtracting minimum. Chosen for bitsPerRecord_ in the ctor.
+      using BlockPacker = void ( * )( const int64_t *values, int64_t minimum, RegisterT *outp );
+      BlockPacker packBlock_;
+   };
+
+   /// Integers stored with the delta codec extension (see DeltaCodec.h)
+   class DeltaIntegerEncoder : public BitpackEncoder
+   {
+   public:
+      DeltaIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &sbuf,
+                           unsigned outputMaxSize, int64_t minimum, int64_t maximum, double scale,
+                           double offset, unsigned order );
+
+      uint64_t processRecords( size_t recordCount ) override;
+      bool registerFlushToOutput() override;
+      float bitsPerRecord() override;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const override;
+#endif
+
+   protected:
+      void writeBlock();
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      int64_t maximum_;
+      double scale_;
+      double offset_;
+      unsigned order_;
+      unsigned baseSize_;
+      uint64_t bytesWritten_ = 0;
+
+      // Values (minus minimum_) of the block being filled
+      uint64_t block_[64] = {};
+      size_t blockCount_ = 0;
+   };
+
+   /// Integers stored with the run-length codec extension (see RunLengthCodec.h)
+   class RunLengthIntegerEncoder : public BitpackEncoder
+   {
+   public:
+      RunLengthIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber,
+                               SourceDestBuffer &sbuf, unsigned outputMaxSize, int64_t minimum,
+                               int64_t maximum, double scale, double offset );
+
+      uint64_t processRecords( size_t recordCount ) override;
+      bool registerFlushToOutput() override;
+      float bitsPerRecord() override;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const override;
+#endif
+
+   protected:
+      void writeRun();
+
+      bool isScaledInteger_;
+      int64_t minimum_;
+      int64_t maximum_;
+      double scale_;
+      double offset_;
+      unsigned valueSize_;
+      uint64_t bytesWritten_ = 0;
+
+      // Value (minus minimum_) and length of the run being extended
+      uint64_t runValue_ = 0;
+      uint64_t runLength_ = 0;
    };
 
    class ConstantIntegerEncoder : public Encoder
@@ -182,6 +261,7 @@ namespace e57
       uint64_t currentRecordIndex() override;
       float bitsPerRecord() override;
       bool registerFlushToOutput() override;
+      void skipRecords( size_t recordCount ) override;
 
       size_t outputAvailable() const override;                  /// number of bytes that can be read
       void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
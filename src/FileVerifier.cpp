@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: MIT
+
+#include <memory>
+#include <vector>
+
+#include "BlobNodeImpl.h"
+#include "CheckedFile.h"
+#include "CompressedVectorNodeImpl.h"
+#include "FileVerifier.h"
+#include "ImageFileImpl.h"
+#include "Packet.h"
+#include "SectionHeaders.h"
+#include "StringFunctions.h"
+#include "StructureNodeImpl.h"
+#include "ThreadPool.h"
+
+namespace e57
+{
+   namespace
+   {
+      // Collect the Blobs and CompressedVectors at or below node. The prototypes and codecs of
+      // CompressedVectors can't have binary sections, so they aren't searched.
+      void findSections( const NodeImplSharedPtr &node, std::vector<NodeImplSharedPtr> &sections )
+      {
+         switch ( node->type() )
+         {
+            case TypeStructure:
+            case TypeVector:
+            {
+               auto structure = std::static_pointer_cast<StructureNodeImpl>( node );
+
+               for ( int64_t i = 0; i < structure->childCount(); ++i )
+               {
+                  findSections( structure->get( i ), sections );
+               }
+               break;
+            }
+
+            case TypeBlob:
+            case TypeCompressedVector:
+               sections.push_back( node );
+               break;
+
+            default:
+               break;
+         }
+      }
+
+      void verifyBlobSection( CheckedFile &file, BlobNodeImpl &blob )
+      {
+         const uint64_t sectionStart = blob.getBinarySectionLogicalStart();
+
+         BlobSectionHeader header;
+         file.readAt( sectionStart, reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         header.verify( static_cast<uint64_t>( blob.byteCount() ),
+                        file.length( CheckedFile::Physical ) );
+
+         if ( sectionStart + header.sectionLogicalLength > file.length( CheckedFile::Logical ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadBlobHeader,
+                                  "sectionLogicalStart=" + toString( sectionStart ) +
+                                     " sectionLogicalLength=" +
+                                     toString( header.sectionLogicalLength ) );
+         }
+      }
+
+      // Check the header of the data packet at offset, and that its bytestream buffers fill it
+      // the way they are checked when it is read (see DataPacket::verify() and inflate()).
+      // bytestreamCount is set by the first packet of a section, and the others must match it.
+      void verifyDataPacket( CheckedFile &file, uint64_t offset, unsigned packetLength,
+                             unsigned &bytestreamCount, std::vector<uint16_t> &lengths )
+      {
+         if ( packetLength < sizeof( DataPacketHeader ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( packetLength ) );
+         }
+
+         DataPacketHeader header;
+         file.readAt( offset, reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         header.verify( packetLength );
+
+         const unsigned count = header.bytestreamCount;
+
+         if ( bytestreamCount == 0 )
+         {
+            bytestreamCount = count;
+         }
+         else if ( count != bytestreamCount )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "bytestreamCount=" + toString( count ) +
+                                                       " expected=" +
+                                                       toString( bytestreamCount ) );
+         }
+
+         // A deflated packet has the compressed lengths after the lengths
+         const bool deflated = ( header.packetFlags & DATA_PACKET_DEFLATED ) != 0;
+         const unsigned lengthCount = deflated ? 2 * count : count;
+
+         unsigned needed = sizeof( header ) + 2 * lengthCount;
+
+         if ( needed > packetLength )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "needed=" + toString( needed ) +
+                                                       " packetLength=" +
+                                                       toString( packetLength ) );
+         }
+
+         lengths.resize( lengthCount );
+         file.readAt( offset + sizeof( header ), reinterpret_cast<char *>( lengths.data() ),
+                      2 * lengthCount );
+
+         unsigned inflatedTotal = 0;
+
+         for ( unsigned i = 0; i < count; ++i )
+         {
+            if ( deflated && ( lengths[count + i] > lengths[i] ) )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket, "bytestreamNumber=" + toString( i ) +
+                                                          " deflatedLength=" +
+                                                          toString( lengths[count + i] ) );
+            }
+
+            inflatedTotal += lengths[i];
+            needed += deflated ? lengths[count + i] : lengths[i];
+         }
+
+         if ( needed > packetLength || needed + 3 < packetLength )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "needed=" + toString( needed ) +
+                                                       " packetLength=" +
+                                                       toString( packetLength ) );
+         }
+
+         if ( sizeof( header ) + 2 * count + inflatedTotal > DATA_PACKET_MAX )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "inflatedTotal=" + toString( inflatedTotal ) );
+         }
+      }
+
+      // @returns the number of packets in the section
+      uint64_t verifyCompressedVectorSection( CheckedFile &file,
+                                              const CompressedVectorNodeImpl &cv )
+      {
+         const uint64_t sectionStart = cv.getBinarySectionLogicalStart();
+         const uint64_t filePhysicalSize = file.length( CheckedFile::Physical );
+
+         CompressedVectorSectionHeader header;
+         file.readAt( sectionStart, reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         if ( header.sectionId != COMPRESSED_VECTOR_SECTION )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVHeader, "sectionId=" + toString( header.sectionId ) );
+         }
+
+         header.verify( filePhysicalSize );
+
+         const uint64_t sectionEnd = sectionStart + header.sectionLogicalLength;
+
+         if ( header.sectionLogicalLength < sizeof( header ) ||
+              sectionEnd > file.length( CheckedFile::Logical ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVHeader,
+                                  "sectionLogicalStart=" + toString( sectionStart ) +
+                                     " sectionLogicalLength=" +
+                                     toString( header.sectionLogicalLength ) );
+         }
+
+         // The first data and index packets (if there are any) must be packets of the section
+         const uint64_t dataOffset = ( header.dataPhysicalOffset != 0 )
+                                        ? file.physicalToLogical( header.dataPhysicalOffset )
+                                        : 0;
+         const uint64_t indexOffset = ( header.indexPhysicalOffset != 0 )
+                                         ? file.physicalToLogical( header.indexPhysicalOffset )
+                                         : 0;
+
+         bool dataFound = ( dataOffset == 0 );
+         bool indexFound = ( indexOffset == 0 );
+
+         unsigned bytestreamCount = 0;
+         std::vector<uint16_t> lengths;
+         std::unique_ptr<IndexPacket> indexPacket;
+
+         uint64_t packetCount = 0;
+
+         // The packets fill the rest of the section
+         for ( uint64_t offset = sectionStart + sizeof( header ); offset < sectionEnd;
+               ++packetCount )
+         {
+            // All packets start with their type and length, like an empty packet
+            EmptyPacketHeader prefix;
+
+            if ( offset + sizeof( prefix ) > sectionEnd )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLogicalOffset=" + toString( offset ) +
+                                                          " sectionEndLogicalOffset=" +
+                                                          toString( sectionEnd ) );
+            }
+
+            file.readAt( offset, reinterpret_cast<char *>( &prefix ), sizeof( prefix ) );
+
+            const unsigned packetLength = prefix.packetLogicalLengthMinus1 + 1U;
+
+            if ( offset + packetLength > sectionEnd )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                     "packetLogicalOffset=" + toString( offset ) +
+                                        " packetLength=" + toString( packetLength ) +
+                                        " sectionEndLogicalOffset=" + toString( sectionEnd ) );
+            }
+
+            switch ( prefix.packetType )
+            {
+               case DATA_PACKET:
+                  verifyDataPacket( file, offset, packetLength, bytestreamCount, lengths );
+                  dataFound = dataFound || ( offset == dataOffset );
+                  break;
+
+               case INDEX_PACKET:
+                  if ( packetLength > sizeof( IndexPacket ) )
+                  {
+                     throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                           "packetLength=" + toString( packetLength ) );
+                  }
+
+                  if ( !indexPacket )
+                  {
+                     indexPacket.reset( new IndexPacket );
+                  }
+
+                  file.readAt( offset, reinterpret_cast<char *>( indexPacket.get() ),
+                               packetLength );
+                  indexPacket->verify( packetLength, 0, filePhysicalSize );
+                  indexFound = indexFound || ( offset == indexOffset );
+                  break;
+
+               case EMPTY_PACKET:
+                  prefix.verify( packetLength );
+                  break;
+
+               default:
+                  throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                        "packetType=" + toString( prefix.packetType ) );
+            }
+
+            offset += packetLength;
+         }
+
+         if ( !dataFound )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVHeader,
+                                  "dataPhysicalOffset=" + toString( header.dataPhysicalOffset ) );
+         }
+
+         if ( !indexFound )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVHeader, "indexPhysicalOffset=" +
+                                                       toString( header.indexPhysicalOffset ) );
+         }
+
+         return packetCount;
+      }
+   }
+
+   ImageFileVerification verifyImageFile( ImageFileImpl &imf, unsigned threadCount )
+   {
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( imf.executor() );
+      }
+
+      // The calling thread does some of the work, so we only need threadCount - 1 more
+      std::unique_ptr<ThreadPool> pool;
+
+      if ( threadCount > 1 )
+      {
+         pool.reset( new ThreadPool( threadCount - 1, imf.executor() ) );
+      }
+
+      CheckedFile &file = *imf.file();
+
+      ImageFileVerification verification;
+      verification.pageCount = file.verifyAllPages( pool.get() );
+
+      // The pages are good, so the section and packet headers are read without checking them
+      // again. Each section is checked by one thread.
+      std::vector<NodeImplSharedPtr> sections;
+      findSections( imf.root(), sections );
+
+      std::vector<uint64_t> packetCounts( sections.size(), 0 );
+
+      const auto verifySection = [&]( size_t i ) {
+         if ( sections[i]->type() == TypeBlob )
+         {
+            verifyBlobSection( file, static_cast<BlobNodeImpl &>( *sections[i] ) );
+         }
+         else
+         {
+            packetCounts[i] = verifyCompressedVectorSection(
+               file, static_cast<const CompressedVectorNodeImpl &>( *sections[i] ) );
+         }
+      };
+
+      if ( pool )
+      {
+         pool->parallelFor( sections.size(), verifySection );
+      }
+      else
+      {
+         for ( size_t i = 0; i < sections.size(); ++i )
+         {
+            verifySection( i );
+         }
+      }
+
+      verification.sectionCount = sections.size();
+
+      for ( const uint64_t count : packetCounts )
+      {
+         verification.packetCount += count;
+      }
+
+      return verification;
+   }
+}
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "E57Format.h"
+
+namespace e57
+{
+   class ImageFileImpl;
+
+   /// Verify the checksum of every page of imf, which is open for reading, then the headers of
+   /// its binary sections and their packets, using threadCount threads (0 for one per hardware
+   /// thread). See ImageFile::verify().
+   ImageFileVerification verifyImageFile( ImageFileImpl &imf, unsigned threadCount );
+}
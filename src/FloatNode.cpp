@@ -231,6 +231,36 @@ double FloatNode::value() const
    return impl_->value();
 }
 
+/*!
+@brief Change the IEEE floating point value stored.
+
+@details
+This is meant for correcting the metadata of a file which has already been written, e.g. the pose
+of a scan after registration. Open the file in update mode (see ImageFile::ImageFile), change the
+values, and close it. Only the XML section and the file header are written again, the binary
+sections (e.g. the points) are left where they are.
+
+@param [in] value The new value. If precision is ::PrecisionSingle, it is written to the file with
+single precision.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre The destination ImageFile must have been opened in write or update mode (i.e.
+destImageFile().isWritable()).
+@pre minimum() <= value <= maximum()
+@post value() returns @a value.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorValueOutOfBounds
+@throw ::ErrorInternal All objects in undocumented state
+
+@see FloatNode::value, IntegerNode::setValue, StringNode::setValue
+*/
+void FloatNode::setValue( double value )
+{
+   impl_->setValue( value );
+}
+
 /*!
 @brief Get declared precision of the floating point number.
 
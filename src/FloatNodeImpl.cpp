@@ -113,6 +113,21 @@ namespace e57
       return value_;
    }
 
+   void FloatNodeImpl::setValue( double value )
+   {
+      checkValueWritable();
+
+      if ( value < minimum_ || maximum_ < value )
+      {
+         throw E57_EXCEPTION2( ErrorValueOutOfBounds, "this->pathName=" + this->pathName() +
+                                                         " value=" + toString( value ) +
+                                                         " minimum=" + toString( minimum_ ) +
+                                                         " maximum=" + toString( maximum_ ) );
+      }
+
+      value_ = value;
+   }
+
    FloatPrecision FloatNodeImpl::precision() const
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -155,7 +170,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       cf << space( indent ) << "<" << fieldName << " type=\"Float\"";
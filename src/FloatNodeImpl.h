@@ -47,6 +47,7 @@ namespace e57
       bool isDefined( const ustring &pathName ) override;
 
       double value() const;
+      void setValue( double value );
       FloatPrecision precision() const;
       double minimum() const;
       double maximum() const;
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace e57
+{
+   // Conversions between float and IEEE 754 half precision (binary16), stored in a uint16_t (see
+   // Real16). They use only integer and float arithmetic on the bits, with no tables, so loops of
+   // them can be vectorized by the compiler.
+
+   /// Largest finite half precision value
+   constexpr double HALF_MAX = 65504.0;
+
+   /// Convert a float to the nearest half precision value (ties to even). Values too large
+   /// become infinity, NaN stays NaN.
+   inline uint16_t floatToHalf( float value )
+   {
+      constexpr uint32_t cInfinity = 255u << 23;
+      constexpr uint32_t cHalfOverflow = ( 127u + 16u ) << 23;
+      constexpr uint32_t cSubnormalLimit = 113u << 23;
+      constexpr uint32_t cSubnormalMagicBits = ( ( 127u - 15u ) + ( 23u - 10u ) + 1u ) << 23;
+
+      uint32_t bits;
+      memcpy( &bits, &value, sizeof( bits ) );
+
+      const uint32_t sign = bits & 0x80000000u;
+      bits ^= sign;
+
+      uint16_t half;
+
+      if ( bits >= cHalfOverflow )
+      {
+         half = ( bits > cInfinity ) ? 0x7e00 : 0x7c00;
+      }
+      else if ( bits < cSubnormalLimit )
+      {
+         // Adding the magic number lines the 10 bits of the subnormal mantissa up at the bottom,
+         // rounded by the float addition
+         float magic;
+         memcpy( &magic, &cSubnormalMagicBits, sizeof( magic ) );
+
+         float absolute;
+         memcpy( &absolute, &bits, sizeof( absolute ) );
+         absolute += magic;
+         memcpy( &bits, &absolute, sizeof( bits ) );
+
+         half = static_cast<uint16_t>( bits - cSubnormalMagicBits );
+      }
+      else
+      {
+         const uint32_t mantissaOdd = ( bits >> 13 ) & 1u;
+
+         // Rebias the exponent and round to nearest even
+         bits += ( ( 15u - 127u ) << 23 ) + 0xfffu + mantissaOdd;
+         half = static_cast<uint16_t>( bits >> 13 );
+      }
+
+      return static_cast<uint16_t>( half | ( sign >> 16 ) );
+   }
+
+   /// Convert a half precision value to float, which holds it exactly
+   inline float halfToFloat( uint16_t half )
+   {
+      constexpr uint32_t cShiftedExponent = 0x7c00u << 13;
+      constexpr uint32_t cSubnormalMagicBits = 113u << 23;
+
+      uint32_t bits = ( half & 0x7fffu ) << 13;
+      const uint32_t exponent = bits & cShiftedExponent;
+
+      bits += ( 127u - 15u ) << 23;
+
+      if ( exponent == cShiftedExponent )
+      {
+         // Infinity or NaN
+         bits += ( 128u - 16u ) << 23;
+      }
+      else if ( exponent == 0 )
+      {
+         // Zero or subnormal: renormalize
+         float magic;
+         memcpy( &magic, &cSubnormalMagicBits, sizeof( magic ) );
+
+         bits += 1u << 23;
+
+         float value;
+         memcpy( &value, &bits, sizeof( value ) );
+         value -= magic;
+         memcpy( &bits, &value, sizeof( bits ) );
+      }
+
+      bits |= static_cast<uint32_t>( half & 0x8000u ) << 16;
+
+      float value;
+      memcpy( &value, &bits, sizeof( value ) );
+
+      return value;
+   }
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cstring>
+
+#include "IOBuffer.h"
+
+namespace e57
+{
+   IOBuffer::IOBuffer( std::shared_ptr<BufferAllocator> allocator, size_t size ) :
+      allocator_( std::move( allocator ) )
+   {
+      resize( size );
+   }
+
+   IOBuffer::~IOBuffer()
+   {
+      resize( 0 );
+   }
+
+   IOBuffer::IOBuffer( IOBuffer &&other ) noexcept :
+      allocator_( std::move( other.allocator_ ) ), data_( other.data_ ), size_( other.size_ )
+   {
+      other.data_ = nullptr;
+      other.size_ = 0;
+   }
+
+   IOBuffer &IOBuffer::operator=( IOBuffer &&other ) noexcept
+   {
+      if ( this != &other )
+      {
+         resize( 0 );
+
+         allocator_ = std::move( other.allocator_ );
+         data_ = other.data_;
+         size_ = other.size_;
+
+         other.data_ = nullptr;
+         other.size_ = 0;
+      }
+
+      return *this;
+   }
+
+   void IOBuffer::resize( size_t size )
+   {
+      if ( size == size_ )
+      {
+         return;
+      }
+
+      char *data = nullptr;
+
+      if ( size > 0 )
+      {
+         data = static_cast<char *>( allocator().allocate( size ) );
+
+         const size_t kept = std::min( size, size_ );
+
+         if ( kept > 0 )
+         {
+            memcpy( data, data_, kept );
+         }
+
+         memset( data + kept, 0, size - kept );
+      }
+
+      if ( data_ != nullptr )
+      {
+         allocator().deallocate( data_, size_ );
+      }
+
+      data_ = data;
+      size_ = size;
+   }
+
+   void IOBuffer::setAllocator( std::shared_ptr<BufferAllocator> allocator )
+   {
+      IOBuffer moved( std::move( allocator ) );
+
+      moved.resize( size_ );
+
+      if ( size_ > 0 )
+      {
+         memcpy( moved.data_, data_, size_ );
+      }
+
+      *this = std::move( moved );
+   }
+
+   BufferAllocator &IOBuffer::allocator() const
+   {
+      static BufferAllocator heap;
+
+      return ( allocator_ != nullptr ) ? *allocator_ : heap;
+   }
+}
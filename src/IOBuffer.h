@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "E57Format.h"
+
+namespace e57
+{
+   /// @brief Bytes from a BufferAllocator (from the heap if it is null), used instead of a
+   /// std::vector<char> for the larger internal buffers (see ReaderOptions::bufferAllocator).
+   /// @details The memory starts on a BUFFER_ALIGNMENT boundary, and bytes added by resize()
+   /// are zero as they would be in a vector.
+   class IOBuffer
+   {
+   public:
+      IOBuffer() = default;
+      explicit IOBuffer( std::shared_ptr<BufferAllocator> allocator, size_t size = 0 );
+      ~IOBuffer();
+
+      IOBuffer( IOBuffer &&other ) noexcept;
+      IOBuffer &operator=( IOBuffer &&other ) noexcept;
+
+      IOBuffer( const IOBuffer & ) = delete;
+      IOBuffer &operator=( const IOBuffer & ) = delete;
+
+      bool empty() const
+      {
+         return size_ == 0;
+      }
+
+      size_t size() const
+      {
+         return size_;
+      }
+
+      char *data()
+      {
+         return data_;
+      }
+
+      const char *data() const
+      {
+         return data_;
+      }
+
+      char &operator[]( size_t index )
+      {
+         return data_[index];
+      }
+
+      const char &operator[]( size_t index ) const
+      {
+         return data_[index];
+      }
+
+      /// Change the size, keeping the bytes which fit
+      void resize( size_t size );
+
+      /// Move the bytes to memory from allocator, which is used from now on
+      void setAllocator( std::shared_ptr<BufferAllocator> allocator );
+
+   private:
+      BufferAllocator &allocator() const;
+
+      std::shared_ptr<BufferAllocator> allocator_;
+      char *data_ = nullptr;
+      size_t size_ = 0;
+   };
+}
@@ -33,6 +33,16 @@
 
 using namespace e57;
 
+size_t ImageFileIO::writeAt( uint64_t /*offset*/, const void * /*buffer*/, size_t /*count*/ )
+{
+   throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + name() );
+}
+
+ustring ImageFileIO::name() const
+{
+   return "<ImageFileIO>";
+}
+
 // Put this function first so we can reference the code in doxygen using @skip
 /*!
 @brief Check whether ImageFile class invariant is true
@@ -90,12 +100,6 @@ void ImageFile::checkInvariant( bool doRecurse ) const
       throw E57_EXCEPTION1( ErrorInvarianceViolation );
    }
 
-   // Can't have more than one writer
-   if ( 1 < wCount )
-   {
-      throw E57_EXCEPTION1( ErrorInvarianceViolation );
-   }
-
    // If have writer
    if ( wCount > 0 )
    {
@@ -111,6 +115,14 @@ void ImageFile::checkInvariant( bool doRecurse ) const
          throw E57_EXCEPTION1( ErrorInvarianceViolation );
       }
    }
+   else
+   {
+      // Without writers, nobody can have the end of the file or sections waiting for it
+      if ( !impl_->isFileEndFree() )
+      {
+         throw E57_EXCEPTION1( ErrorInvarianceViolation );
+      }
+   }
 
    // Extension prefixes and URIs are unique
    const size_t eCount = extensionsCount();
@@ -170,7 +182,7 @@ void ImageFile::checkInvariant( bool doRecurse ) const
 @section imagefile_ClassOverview Class overview
 The ImageFile class represents the state of an ASTM E57 format data file. An ImageFile may be
 created from an E57 file on the disk (read mode). An new ImageFile may be created to write an E57
-file to disk (write mode).
+file to disk (write mode). An existing E57 file may be opened to add to it (update mode).
 
 E57 files are organized in a tree structure.
 Each ImageFile object has a predefined root node (of type StructureNode). In a write mode ImageFile,
@@ -223,6 +235,19 @@ to two sets of readers: the old readers that will understand the information in
 and the new-fangled readers that will be able to read the base format and the extra information
 stored in element names in the extended namespace.
 
+@section imagefile_Threads Using an ImageFile from several threads
+An ImageFile opened in read mode may be used from several threads at once, with these limits:
+- Nodes may be looked up and their values read (e.g. StructureNode::get, IntegerNode::value) on any
+thread. The node tree must not be changed.
+- Each thread may create, use and close its own CompressedVectorReaders. A reader must only be used
+by one thread at a time. All the readers share the file's packet cache.
+- BlobNode::read may be called on any thread.
+- ImageFile::close, ImageFile::cancel and destroying the ImageFile must only happen once all other
+threads are finished with it.
+
+None of the file's data is read using a shared position, so these don't interfere with each
+other. An ImageFile opened in write mode must only be used by one thread at a time.
+
 @section ImageFile_invariant Class Invariant
 A class invariant is a list of statements about an object that are always true before and after any
 operation on the object. An invariant is useful for testing correct operation of an implementation.
@@ -246,9 +271,12 @@ that files that meet all of the requirements for a legal ASTM E57 file format us
 ".e57". It is recommended that files that utilize the low-level E57 element data types, but do not
 have all the required element names required by ASTM E57 file format standard use the file extension
 @c "._e57".
-@param [in] mode Either "w" for writing or "r" for reading.
+@param [in] mode Either "w" for writing, "r" for reading, or "a" for updating.
 @param [in] checksumPolicy The percentage of checksums we compute and verify as an int. Clamped to
 0-100.
+@param [in] lazyLoad In read mode, leave each child of the /data3D and /images2D vectors to be
+parsed from the XML section when it is first accessed (see Lazy Loading below). Ignored in write
+and update modes.
 
 @par Write Mode
 In write mode, the file cannot be already open.
@@ -261,7 +289,27 @@ API operations are legal for an ImageFile opened in write mode.
 @par Read Mode
 Read mode files may be shared.
 Write API operations are not legal for an ImageFile opened in read mode (i.e. the ImageFile is
-read-only). There is no API support for appending data onto an existing E57 data file.
+read-only).
+
+@par Update Mode
+In update mode, the file must already exist. Its tree is read as in read mode, and can then be added
+to as in write mode (e.g. appending a new scan to /data3D and writing its points). The data already
+in the file is left where it is: new binary sections are written after it, then ImageFile::close
+writes the XML section after those and patches the file header last, so the cost is proportional to
+what is added. The CompressedVectors and Blobs which were already in the file cannot be written to.
+ImageFile::cancel cuts the file back to the length it had when it was opened. The old XML section
+stays in the file, unused.
+
+Existing values can be changed with FloatNode::setValue, IntegerNode::setValue and
+StringNode::setValue. If nothing else is added, closing the file writes only the XML section and the
+header, however large its binary sections are.
+
+@par Lazy Loading
+Opening a file builds the whole tree of nodes described by its XML section. For files with many
+Data3D and Image2D blocks, most of this is in the children of /data3D and /images2D. With @a
+lazyLoad set, only the positions of these children in the XML section are recorded when opening.
+Each one is parsed the first time it (or a node beneath it) is accessed. Apart from when errors in
+these children are reported, the file behaves the same either way.
 
 @post Resulting ImageFile is in @c open state if constructor succeeds (no exception thrown).
 
@@ -284,13 +332,48 @@ read-only). There is no API support for appending data onto an existing E57 data
 CompressedVectorNode, E57Exception, E57Utilities::E57Utilities
 */
 ImageFile::ImageFile( const ustring &fname, const ustring &mode,
-                      ReadChecksumPolicy checksumPolicy ) :
-   impl_( new ImageFileImpl( checksumPolicy ) )
+                      ReadChecksumPolicy checksumPolicy, bool lazyLoad ) :
+   impl_( new ImageFileImpl( checksumPolicy, lazyLoad ) )
 {
    // Do second phase of construction, now that ImageFile object is complete.
    impl_->construct2( fname, mode );
 }
 
+/*!
+@brief Open an ImageFile whose data is read or written through an ImageFileIO.
+
+@details This works like ImageFile(const ustring &, const ustring &, ReadChecksumPolicy, bool),
+except that the data is read or written with @a io instead of a local file. The ImageFile keeps a
+reference to @a io until it is closed and destroyed.
+
+@param [in] io The backend which reads and writes the data.
+@param [in] mode Either "w" for writing, "r" for reading, or "a" for updating.
+@param [in] checksumPolicy The percentage of checksums we compute and verify as an int.
+@param [in] lazyLoad When reading, parse each Data3D and Image2D block when it is first accessed.
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorOpenFailed
+@throw ::ErrorReadFailed
+@throw ::ErrorWriteFailed
+@throw ::ErrorBadChecksum
+@throw ::ErrorInternal All objects in undocumented state
+
+@see ImageFileIO
+*/
+ImageFile::ImageFile( std::shared_ptr<ImageFileIO> io, const ustring &mode,
+                      ReadChecksumPolicy checksumPolicy, bool lazyLoad ) :
+   impl_( new ImageFileImpl( checksumPolicy, lazyLoad ) )
+{
+   if ( io == nullptr )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument, "io=nullptr" );
+   }
+
+   const ustring name = io->name();
+
+   impl_->construct2( name, mode, std::move( io ) );
+}
+
 ImageFile::ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy checksumPolicy ) :
    impl_( new ImageFileImpl( checksumPolicy ) )
 {
@@ -358,7 +441,8 @@ void ImageFile::close()
 
 @details
 If the ImageFile is write mode, the associated file on the disk is closed and deleted, and the
-ImageFile goes to the closed state. If the ImageFile is read mode, the behavior is same as calling
+ImageFile goes to the closed state. In update mode, the file is closed and cut back to what it was
+when it was opened. If the ImageFile is read mode, the behavior is same as calling
 ImageFile::close, but no exceptions are thrown. It is not an error if ImageFile is already closed.
 
 @post ImageFile is in @c closed state.
@@ -393,7 +477,7 @@ bool ImageFile::isOpen() const
 
 @post No visible state is modified.
 
-@return true if ImageFile was opened in write mode.
+@return true if ImageFile was opened in write or update mode.
 
 @throw No E57Exceptions.
 
@@ -464,6 +548,78 @@ int ImageFile::readerCount() const
    return impl_->readerCount();
 }
 
+/*!
+@brief Get a snapshot of the counters of the work done reading the ImageFile.
+
+@details
+The counters are only kept if the library was built with the E57_STATISTICS CMake option.
+Otherwise they are all 0 and ImageFileStatistics::enabled is false. They cover every reader of
+the file since it was opened, and may still be read after it is closed.
+
+@post No visible state is modified.
+
+@return The current values of the counters.
+
+@see ImageFileStatistics
+*/
+ImageFileStatistics ImageFile::statistics() const
+{
+   return impl_->statistics();
+}
+
+/*!
+@brief Get the number of bytes held by the larger working buffers of the ImageFile.
+
+@details
+This covers the packet cache, the packets read ahead of it, the range reads made through an
+ImageFileIO, and the buffers of the encoders and decoders, for every reader and writer of the
+file since it was opened. The peak can be compared with the budget they were sized to fit (see
+ReaderOptions::memoryBudget and WriterOptions::memoryBudget), which is also reported. Like the
+statistics, it may still be read after the file is closed.
+
+@post No visible state is modified.
+
+@return The budget, and the current and peak number of bytes.
+
+@see ImageFileMemoryUsage
+*/
+ImageFileMemoryUsage ImageFile::memoryUsage() const
+{
+   return impl_->memoryUsage();
+}
+
+/*!
+@brief Check that an ImageFile opened for reading is intact, without decoding any points.
+
+@details
+The checksum of every physical page of the file is verified, whatever ReadChecksumPolicy it was
+opened with. Then the header of every binary section in the tree is checked, and for the
+sections of CompressedVectors, the header of every packet. Large files are checked much faster
+with several threads, which share the pages and then the sections between them.
+
+@param [in] threadCount The number of threads (including the calling thread) to use. 0 uses one
+per hardware thread.
+
+@pre This ImageFile must be open (i.e. isOpen()) and must have been opened for reading.
+
+@return How many pages, sections, and packets were checked.
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorBadChecksum
+@throw ::ErrorBadCVHeader
+@throw ::ErrorBadCVPacket
+@throw ::ErrorBadBlobHeader
+@throw ::ErrorReadFailed
+@throw ::ErrorInternal All objects in undocumented state
+
+@see ImageFileVerification
+*/
+ImageFileVerification ImageFile::verify( unsigned threadCount ) const
+{
+   return impl_->verify( threadCount );
+}
+
 /*!
 @brief Declare the use of an E57 extension in an ImageFile being written.
 
@@ -25,15 +25,26 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstring>
+
 #include "ImageFileImpl.h"
 #include "ASTMVersion.h"
 #include "CheckedFile.h"
+#include "Checksum.h"
 #include "E57XmlParser.h"
+#include "FileVerifier.h"
+#include "Packet.h"
 #include "StringFunctions.h"
 #include "StructureNodeImpl.h"
+#include "ThreadPool.h"
+#include "VectorNodeImpl.h"
 
 namespace e57
 {
+   // The metadata of a single Data3D or Image2D block is a few KiB, so a deferred element's
+   // arena uses smaller blocks than the file's
+   constexpr size_t DEFERRED_ARENA_BLOCK_SIZE = 4 * 1024;
+
    struct NameSpace
    {
       ustring prefix;
@@ -74,18 +85,23 @@ namespace e57
    }
 #endif
 
-   ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy ) :
+   ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy, bool lazyLoad ) :
       isWriter_( false ), writerCount_( 0 ), readerCount_( 0 ),
       checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ), file_( nullptr ),
-      xmlLogicalOffset_( 0 ), xmlLogicalLength_( 0 ), unusedLogicalStart_( 0 )
+      packetCacheSize_( PACKET_CACHE_DEFAULT_COUNT ),
+      packetFillTarget_( DATA_PACKET_DEFAULT_TARGET ), encoderBufferSize_( DATA_PACKET_MAX ),
+      xmlLogicalOffset_( 0 ), xmlLogicalLength_( 0 ), lazyLoad_( lazyLoad ),
+      unusedLogicalStart_( 0 )
    {
       // First phase of construction, can't do much until have the ImageFile object. See
       // ImageFileImpl::construct2() for second phase.
    }
 
-   void ImageFileImpl::construct2( const ustring &fileName, const ustring &mode )
+   void ImageFileImpl::construct2( const ustring &fileName, const ustring &mode,
+                                   std::shared_ptr<ImageFileIO> io )
    {
       // Second phase of construction, now we have a well-formed ImageFile object.
+      E57_TRACE_SPAN( &tracer_, "open" );
 
 #ifdef E57_VERBOSE
       std::cout << "ImageFileImpl() called, fileName=" << fileName << " mode=" << mode << std::endl;
@@ -96,8 +112,9 @@ namespace e57
       // Get shared_ptr to this object
       ImageFileImplSharedPtr imf = shared_from_this();
 
-      // Accept "w" or "r" modes
-      isWriter_ = ( mode == "w" );
+      // Accept "w", "r" or "a" (update) modes
+      isUpdate_ = ( mode == "a" );
+      isWriter_ = ( mode == "w" ) || isUpdate_;
 
       if ( !isWriter_ && ( mode != "r" ) )
       {
@@ -107,12 +124,17 @@ namespace e57
       file_ = nullptr;
 
       // Writing
-      if ( isWriter_ )
+      if ( isWriter_ && !isUpdate_ )
       {
          try
          {
             // Open file for writing, truncate if already exists.
-            file_ = new CheckedFile( fileName_, CheckedFile::Write, checksumPolicy );
+            file_ = ( io != nullptr )
+                       ? new CheckedFile( std::move( io ), CheckedFile::Write, checksumPolicy )
+                       : new CheckedFile( fileName_, CheckedFile::Write, checksumPolicy );
+            file_->setStatistics( &statistics_ );
+            file_->setMemoryUsage( &memoryUsage_ );
+            file_->setTracer( &tracer_ );
 
             std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
             root_ = root;
@@ -133,11 +155,23 @@ namespace e57
          return;
       }
 
-      // Reading
+      // Reading or updating
+      const CheckedFile::Mode fileMode = isUpdate_ ? CheckedFile::Update : CheckedFile::Read;
+
+      // close() writes the whole tree out again, so it can't be left to be parsed later
+      if ( isUpdate_ )
+      {
+         lazyLoad_ = false;
+      }
+
       try
       {
          // Open file for reading.
-         file_ = new CheckedFile( fileName_, CheckedFile::Read, checksumPolicy );
+         file_ = ( io != nullptr ) ? new CheckedFile( std::move( io ), fileMode, checksumPolicy )
+                                   : new CheckedFile( fileName_, fileMode, checksumPolicy );
+         file_->setStatistics( &statistics_ );
+         file_->setMemoryUsage( &memoryUsage_ );
+         file_->setTracer( &tracer_ );
 
          std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
          root_ = root;
@@ -159,18 +193,7 @@ namespace e57
 
       try
       {
-         // Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
-
-         parser.init();
-
-         // Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
-
-         unusedLogicalStart_ = sizeof( E57FileHeader );
-
-         // Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         parseXml();
       }
       catch ( ... )
       {
@@ -179,11 +202,20 @@ namespace e57
 
          throw;
       }
+
+      // New sections go after everything which is already in the file, which is left as it is.
+      // The file is made of whole pages, so this is a multiple of 4 too.
+      if ( isUpdate_ )
+      {
+         unusedLogicalStart_ = file_->length( CheckedFile::Logical );
+         existingLogicalLength_ = unusedLogicalStart_;
+      }
    }
 
    void ImageFileImpl::construct2( const char *input, const uint64_t size )
    {
       // Second phase of construction, now we have a well-formed ImageFile object.
+      E57_TRACE_SPAN( &tracer_, "open" );
 
 #ifdef E57_VERBOSE
       std::cout << "ImageFileImpl() called, fileName=<StreamBuffer> mode=r" << std::endl;
@@ -201,6 +233,9 @@ namespace e57
       {
          // Open file for reading.
          file_ = new CheckedFile( input, size, checksumPolicy );
+         file_->setStatistics( &statistics_ );
+         file_->setMemoryUsage( &memoryUsage_ );
+         file_->setTracer( &tracer_ );
 
          std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
          root_ = root;
@@ -222,26 +257,138 @@ namespace e57
 
       try
       {
-         // Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
+         parseXml();
+      }
+      catch ( ... )
+      {
+         delete file_;
+         file_ = nullptr;
 
-         parser.init();
+         throw;
+      }
+   }
 
-         // Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+   void ImageFileImpl::parseXml()
+   {
+      E57_TRACE_SPAN( &tracer_, "parseXml" );
 
-         unusedLogicalStart_ = sizeof( E57FileHeader );
+      unusedLogicalStart_ = sizeof( E57FileHeader );
+
+      // The tree of a file being read lives until the file is closed, so allocate its nodes
+      // together
+      nodeArena_ = std::make_shared<NodeArena>();
+
+      // Create parser state, attach its event handers to the SAX2 reader
+      E57XmlParser parser( shared_from_this() );
+
+      parser.init();
 
+      if ( !lazyLoad_ )
+      {
          // Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         parser.parse( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+         return;
       }
-      catch ( ... )
+
+      // Parse the section without the children of the data3D and images2D vectors, which are
+      // parsed when they are first accessed.
+      ustring xml( static_cast<size_t>( xmlLogicalLength_ ), '\0' );
+
+      if ( !xml.empty() )
       {
-         delete file_;
-         file_ = nullptr;
+         file_->readAt( xmlLogicalOffset_, &xml[0], xml.size() );
+      }
+
+      E57XmlOutline outline;
+
+      if ( !outline.scan( xml ) )
+      {
+         outline.vectors.clear();
+      }
+
+      if ( outline.vectors.empty() )
+      {
+         parser.parse( xml );
+         return;
+      }
+
+      parser.parse( outline.skeleton( xml ) );
+
+      xmlPrologue_ = xml.substr( 0, outline.prologueLength );
+      xmlRootName_ = outline.rootName;
+
+      for ( const auto &deferred : outline.vectors )
+      {
+         NodeImplSharedPtr ni( root_->get( deferred.elementName ) );
+
+         if ( ni->type() != TypeVector )
+         {
+            throw E57_EXCEPTION2( ErrorInternal, "elementName=" + deferred.elementName +
+                                                    " type=" + toString( ni->type() ) );
+         }
+
+         std::shared_ptr<VectorNodeImpl> vector( std::static_pointer_cast<VectorNodeImpl>( ni ) );
+
+         // The children of a homogeneous vector have to be checked against each other, so parse
+         // them now.
+         if ( vector->allowHeteroChildren() )
+         {
+            vector->deferChildren( deferred.children );
+         }
+         else
+         {
+            for ( const auto &range : deferred.children )
+            {
+               vector->append( parseDeferredElement( range ) );
+            }
+         }
+      }
+   }
+
+   NodeImplSharedPtr ImageFileImpl::parseDeferredElement( const E57XmlRange &range )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      const auto elementLength = static_cast<size_t>( range.end - range.begin );
+
+      ustring fragment( xmlPrologue_ );
+      fragment.resize( xmlPrologue_.size() + elementLength );
+      file_->readAt( xmlLogicalOffset_ + range.begin, &fragment[xmlPrologue_.size()],
+                     elementLength );
+      fragment += "</" + xmlRootName_ + ">";
 
+      std::shared_ptr<StructureNodeImpl> fragmentRoot;
+
+      // Each element gets an arena of its own, so its memory is freed with it if it is released
+      // again (see StructureNodeImpl::releaseChild())
+      std::shared_ptr<NodeArena> fileArena( std::move( nodeArena_ ) );
+      nodeArena_ = std::make_shared<NodeArena>( DEFERRED_ARENA_BLOCK_SIZE );
+
+      try
+      {
+         E57XmlParser parser( shared_from_this(), true );
+
+         parser.init();
+         parser.parse( fragment );
+
+         fragmentRoot = parser.fragmentRoot();
+      }
+      catch ( ... )
+      {
+         nodeArena_ = std::move( fileArena );
          throw;
       }
+
+      nodeArena_ = std::move( fileArena );
+
+      if ( !fragmentRoot || ( fragmentRoot->childCount() != 1 ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadXMLFormat, "fileName=" + fileName_ +
+                                                     " xmlOffset=" + toString( range.begin ) );
+      }
+
+      // Only the element is kept, so it can be given its parent in the tree
+      return fragmentRoot->get( 0 );
    }
 
    std::shared_ptr<StructureNodeImpl> ImageFileImpl::root()
@@ -259,8 +406,25 @@ namespace e57
          return;
       }
 
+      E57_TRACE_SPAN( &tracer_, "close" );
+
       if ( isWriter_ )
       {
+         writeQueuedSections();
+
+         // Don't write a file missing sections whose writers were closed without an error
+         if ( !failedSections_.empty() )
+         {
+            ustring sections;
+            for ( const ustring &section : failedSections_ )
+            {
+               sections += ( sections.empty() ? "" : ", " ) + section;
+            }
+
+            throw E57_EXCEPTION2( ErrorWriteFailed,
+                                  "fileName=" + fileName_ + " failedSections=" + sections );
+         }
+
          // Go to end of file, note physical position
          xmlLogicalOffset_ = unusedLogicalStart_;
          file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
@@ -294,15 +458,33 @@ namespace e57
          header.dump();
 #endif
 
-         // Write header at beginning of file
+         // Write header at beginning of file. This page is not next to the last one written, so
+         // everything else goes out first and an updated file keeps its old header until then.
          file_->seek( 0 );
          file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
 
          file_->close();
       }
 
+      // The cache may be reading from file_ in the background
+      packetCache_.reset();
+
       delete file_;
       file_ = nullptr;
+
+      releaseReadTree();
+   }
+
+   void ImageFileImpl::releaseReadTree()
+   {
+      if ( isWriter_ )
+      {
+         return;
+      }
+
+      // Nodes still held by the caller keep the arena until they are released
+      root_.reset();
+      nodeArena_.reset();
    }
 
    void ImageFileImpl::cancel()
@@ -314,8 +496,13 @@ namespace e57
       }
 
       // Close the file and ulink (delete) it.
-      // It is legal to cancel a read file, but file isn't deleted.
-      if ( isWriter_ )
+      // It is legal to cancel a read file, but file isn't deleted. A file being updated is put
+      // back the way it was.
+      if ( isUpdate_ )
+      {
+         file_->truncateAndClose( CheckedFile::logicalToPhysical( existingLogicalLength_ ) );
+      }
+      else if ( isWriter_ )
       {
          file_->unlink();
       }
@@ -324,8 +511,13 @@ namespace e57
          file_->close();
       }
 
+      // The cache may be reading from file_ in the background
+      packetCache_.reset();
+
       delete file_;
       file_ = nullptr;
+
+      releaseReadTree();
    }
 
    bool ImageFileImpl::isOpen() const
@@ -338,6 +530,16 @@ namespace e57
       return isWriter_;
    }
 
+   bool ImageFileImpl::isUpdate() const
+   {
+      return isUpdate_;
+   }
+
+   bool ImageFileImpl::isExistingData( uint64_t logicalOffset ) const
+   {
+      return logicalOffset < existingLogicalLength_;
+   }
+
    int ImageFileImpl::writerCount() const
    {
       return writerCount_;
@@ -348,6 +550,49 @@ namespace e57
       return readerCount_;
    }
 
+   ImageFileStatistics ImageFileImpl::statistics() const
+   {
+      return statistics_.snapshot();
+   }
+
+   StatisticsCounters *ImageFileImpl::statisticsCounters()
+   {
+      return &statistics_;
+   }
+
+   void ImageFileImpl::setTraceHandler( TraceHandler handler )
+   {
+      tracer_.setHandler( std::move( handler ) );
+   }
+
+   Tracer *ImageFileImpl::tracer()
+   {
+      return &tracer_;
+   }
+
+   ImageFileMemoryUsage ImageFileImpl::memoryUsage() const
+   {
+      return memoryUsage_.snapshot();
+   }
+
+   MemoryUsage *ImageFileImpl::memoryUsageCounters()
+   {
+      return &memoryUsage_;
+   }
+
+   ImageFileVerification ImageFileImpl::verify( unsigned int threadCount )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // The sections of a file being written aren't finished
+      if ( isWriter_ )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "fileName=" + fileName_ );
+      }
+
+      return verifyImageFile( *this, threadCount );
+   }
+
    ImageFileImpl::~ImageFileImpl()
    {
       // Try to cancel if not already closed, but don't allow any exceptions to propagate to caller
@@ -362,10 +607,349 @@ namespace e57
       };
 
       // Just in case cancel failed without freeing file_, do free here.
+      packetCache_.reset();
+
       delete file_;
       file_ = nullptr;
    }
 
+   void ImageFileImpl::setExecutor( std::shared_ptr<Executor> executor )
+   {
+      executor_ = std::move( executor );
+   }
+
+   std::shared_ptr<Executor> ImageFileImpl::executor() const
+   {
+      return executor_;
+   }
+
+   void ImageFileImpl::setChecksumThreadCount( unsigned int threadCount )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      file_->setChecksumThreadCount( threadCount, executor_ );
+   }
+
+   void ImageFileImpl::setRangeReads( size_t requestSize, unsigned int requestsInFlight )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      file_->setRangeReads( requestSize, requestsInFlight );
+   }
+
+   void ImageFileImpl::setDirectIO( bool enable )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      file_->setDirectIO( enable );
+   }
+
+   void ImageFileImpl::setAccessHints( bool enable )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      file_->setAccessHints( enable );
+   }
+
+   void ImageFileImpl::setDecodeThreadCount( unsigned int threadCount )
+   {
+      // Readers use the pool directly, so we can't replace it while there are any
+      if ( readerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
+                               "fileName=" + fileName_ +
+                                  " readerCount=" + toString( readerCount_.load() ) );
+      }
+
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( executor_ );
+      }
+
+      // The reading thread decodes one of the bytestreams itself, so we only need
+      // threadCount - 1 more
+      if ( threadCount > 1 )
+      {
+         decodePool_.reset( new ThreadPool( threadCount - 1, executor_ ) );
+      }
+      else
+      {
+         decodePool_.reset();
+      }
+   }
+
+   ThreadPool *ImageFileImpl::decodePool() const
+   {
+      return decodePool_.get();
+   }
+
+   void ImageFileImpl::setEncodeThreadCount( unsigned int threadCount )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Writers use the pool directly, so we can't replace it while there are any
+      if ( writerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) );
+      }
+
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( executor_ );
+      }
+
+      // The writing thread encodes one of the bytestreams itself, so we only need
+      // threadCount - 1 more. Pages are then written out by the file's background thread while
+      // the next ones are filled.
+      if ( threadCount > 1 )
+      {
+         encodePool_.reset( new ThreadPool( threadCount - 1, executor_ ) );
+      }
+      else
+      {
+         encodePool_.reset();
+      }
+
+      file_->setBackgroundWrites( encodePool_ != nullptr );
+   }
+
+   ThreadPool *ImageFileImpl::encodePool() const
+   {
+      return encodePool_.get();
+   }
+
+   void ImageFileImpl::setPacketSizes( unsigned int packetFillTarget,
+                                       unsigned int encoderBufferSize )
+   {
+      // Writers pick up the sizes when they are created, so don't change them under any
+      if ( writerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) );
+      }
+
+      if ( packetFillTarget == 0 )
+      {
+         packetFillTarget = DATA_PACKET_DEFAULT_TARGET;
+      }
+
+      if ( encoderBufferSize == 0 )
+      {
+         encoderBufferSize = DATA_PACKET_MAX;
+      }
+
+      // No packet can be larger than the format allows. Each encoder must be able to hold a
+      // whole packet's worth, otherwise the writer could be left waiting for a packet to fill
+      // which never will.
+      if ( packetFillTarget > DATA_PACKET_MAX || encoderBufferSize < packetFillTarget )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "packetFillTarget=" + toString( packetFillTarget ) +
+                                  " encoderBufferSize=" + toString( encoderBufferSize ) );
+      }
+
+      packetFillTarget_ = packetFillTarget;
+      encoderBufferSize_ = encoderBufferSize;
+   }
+
+   unsigned int ImageFileImpl::packetFillTarget() const
+   {
+      return packetFillTarget_;
+   }
+
+   unsigned int ImageFileImpl::encoderBufferSize() const
+   {
+      return encoderBufferSize_;
+   }
+
+   void ImageFileImpl::setPacketPacking( PacketPacking packing )
+   {
+      if ( packing < PacketPackingProportional || packing > PacketPackingRecordAligned )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "packetPacking=" + toString( packing ) );
+      }
+
+      packetPacking_ = packing;
+   }
+
+   PacketPacking ImageFileImpl::packetPacking() const
+   {
+      return packetPacking_;
+   }
+
+   void ImageFileImpl::setValidationLevel( ValidationLevel level )
+   {
+      if ( level < ValidationNone || level > ValidationDeep )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "validationLevel=" + toString( level ) );
+      }
+
+      // Readers have already made their decoders and locked packets into the cache
+      if ( readerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
+                               "fileName=" + fileName_ +
+                                  " readerCount=" + toString( readerCount_.load() ) );
+      }
+
+      validationLevel_ = level;
+
+      std::lock_guard<std::mutex> lock( packetCacheMutex_ );
+
+      if ( packetCache_ != nullptr )
+      {
+         packetCache_->setValidationLevel( level );
+      }
+   }
+
+   ValidationLevel ImageFileImpl::validationLevel() const
+   {
+      return validationLevel_;
+   }
+
+   void ImageFileImpl::setMemoryBudget( uint64_t bytes )
+   {
+      // Readers and writers have already made their buffers
+      if ( readerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
+                               "fileName=" + fileName_ +
+                                  " readerCount=" + toString( readerCount_.load() ) );
+      }
+
+      if ( writerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) );
+      }
+
+      memoryUsage_.setBudget( bytes );
+
+      // Recreated to fit when it is next needed
+      std::lock_guard<std::mutex> lock( packetCacheMutex_ );
+      packetCache_.reset();
+   }
+
+   void ImageFileImpl::setBufferAllocator( std::shared_ptr<BufferAllocator> allocator )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Readers and writers have already made their buffers
+      if ( readerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
+                               "fileName=" + fileName_ +
+                                  " readerCount=" + toString( readerCount_.load() ) );
+      }
+
+      if ( writerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyWriters,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) );
+      }
+
+      file_->setBufferAllocator( allocator );
+      bufferAllocator_ = std::move( allocator );
+
+      // Recreated from the allocator when it is next needed
+      std::lock_guard<std::mutex> lock( packetCacheMutex_ );
+      packetCache_.reset();
+   }
+
+   const std::shared_ptr<BufferAllocator> &ImageFileImpl::bufferAllocator() const
+   {
+      return bufferAllocator_;
+   }
+
+   uint64_t ImageFileImpl::memoryBudget() const
+   {
+      return memoryUsage_.budget();
+   }
+
+   /// Get the number of packets to cache and to read ahead. With a memory budget, they share
+   /// what the range reads don't take (a quarter, see CheckedFile::setRangeReads()), with one
+   /// packet in eight read ahead.
+   void ImageFileImpl::packetCounts( unsigned &cacheCount, unsigned &prefetchCount ) const
+   {
+      cacheCount = packetCacheSize_;
+      prefetchCount = PACKET_PREFETCH_COUNT;
+
+      const uint64_t budget = memoryUsage_.budget();
+
+      if ( budget == 0 )
+      {
+         return;
+      }
+
+      const uint64_t packetCount = ( budget - budget / 4 ) / DATA_PACKET_MAX;
+
+      prefetchCount = static_cast<unsigned>( std::min<uint64_t>( prefetchCount, packetCount / 8 ) );
+      cacheCount = static_cast<unsigned>(
+         std::max<uint64_t>( std::min<uint64_t>( cacheCount, packetCount - prefetchCount ), 1 ) );
+   }
+
+   void ImageFileImpl::setPacketCacheSize( unsigned int packetCount )
+   {
+      if ( packetCount == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "packetCacheSize=" + toString( packetCount ) );
+      }
+
+      // Readers use the cache directly, so we can't replace it while there are any
+      if ( readerCount_ > 0 )
+      {
+         throw E57_EXCEPTION2( ErrorTooManyReaders,
+                               "fileName=" + fileName_ +
+                                  " readerCount=" + toString( readerCount_.load() ) );
+      }
+
+      packetCacheSize_ = packetCount;
+
+      // Recreated with the new size when it is next needed
+      packetCache_.reset();
+   }
+
+   unsigned int ImageFileImpl::packetCacheSize() const
+   {
+      unsigned cacheCount = 0;
+      unsigned prefetchCount = 0;
+      packetCounts( cacheCount, prefetchCount );
+
+      return cacheCount;
+   }
+
+   PacketReadCache *ImageFileImpl::packetCache()
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      // Readers may be created on several threads at once
+      std::lock_guard<std::mutex> lock( packetCacheMutex_ );
+
+      if ( packetCache_ == nullptr )
+      {
+         unsigned cacheCount = 0;
+         unsigned prefetchCount = 0;
+         packetCounts( cacheCount, prefetchCount );
+
+         packetCache_.reset( new PacketReadCache( file_, cacheCount ) );
+         packetCache_->setValidationLevel( validationLevel_ );
+
+         // When the file is open for reading nothing else can change it, so we can read ahead
+         // and decode one packet while the next ones are being read
+         if ( !isWriter_ && ( prefetchCount > 0 ) )
+         {
+            packetCache_->enablePrefetch( prefetchCount );
+         }
+      }
+
+      return packetCache_.get();
+   }
+
    uint64_t ImageFileImpl::allocateSpace( uint64_t byteCount, bool doExtendNow )
    {
       uint64_t oldLogicalStart = unusedLogicalStart_;
@@ -383,6 +967,21 @@ namespace e57
       return oldLogicalStart;
    }
 
+   void ImageFileImpl::reserveSpace( uint64_t byteCount )
+   {
+      if ( !isWriter_ )
+      {
+         throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + fileName_ );
+      }
+
+      const uint64_t physicalEnd = file_->logicalToPhysical( unusedLogicalStart_ + byteCount );
+
+      // Whole pages, since that is how the file is written
+      const uint64_t pageMask = CheckedFile::physicalPageSize - 1;
+
+      file_->preallocate( ( physicalEnd + pageMask ) & ~pageMask );
+   }
+
    CheckedFile *ImageFileImpl::file() const
    {
       return file_;
@@ -394,6 +993,20 @@ namespace e57
       return fileName_;
    }
 
+   uint32_t ImageFileImpl::xmlChecksum() const
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      std::vector<char> xml( static_cast<size_t>( xmlLogicalLength_ ) );
+
+      if ( !xml.empty() )
+      {
+         file_->readAt( xmlLogicalOffset_, xml.data(), xml.size() );
+      }
+
+      return crc32c( xml.data(), xml.size() );
+   }
+
    void ImageFileImpl::extensionsAdd( const ustring &prefix, const ustring &uri )
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -477,6 +1090,21 @@ namespace e57
       return nameSpaces_[index].uri; //??? throw e57 exception here if out of bounds?
    }
 
+   InternedName ImageFileImpl::internElementName( const ustring &elementName )
+   {
+      // Nodes may be given parents while another thread parses a deferred element
+      std::lock_guard<std::mutex> lock( elementNamesMutex_ );
+
+      InternedName &name = elementNames_[elementName];
+
+      if ( !name )
+      {
+         name = std::make_shared<const ustring>( elementName );
+      }
+
+      return name;
+   }
+
    bool ImageFileImpl::isElementNameExtended( const ustring &elementName )
    {
       // don't checkImageFileOpen
@@ -674,13 +1302,130 @@ namespace e57
 #if ( E57_VALIDATION_LEVEL == VALIDATION_DEEP )
       if ( writerCount_ < 0 )
       {
-         throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ +
-                                                 " writerCount=" + toString( writerCount_ ) +
-                                                 " readerCount=" + toString( readerCount_ ) );
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) +
+                                  " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
 
+   bool ImageFileImpl::claimFileEnd( const void *writer )
+   {
+      std::lock_guard<std::mutex> lock( fileEndMutex_ );
+
+      if ( fileEndOwner_ == nullptr )
+      {
+         fileEndOwner_ = writer;
+      }
+
+      return ( fileEndOwner_ == writer );
+   }
+
+   void ImageFileImpl::releaseFileEnd( const void *writer )
+   {
+      std::unique_lock<std::mutex> lock( fileEndMutex_ );
+
+      if ( fileEndOwner_ != writer )
+      {
+         return;
+      }
+
+      // Keep the end of the file while writing the queued sections, so the writers still open
+      // carry on holding their packets back instead of waiting for the lock. Their writers have
+      // already been closed, so a failure is kept for close() to report.
+      while ( !queuedSections_.empty() )
+      {
+         const QueuedSection section = std::move( queuedSections_.front() );
+         queuedSections_.pop_front();
+
+         lock.unlock();
+
+         ustring error;
+         try
+         {
+            section.write();
+         }
+         catch ( E57Exception &ex )
+         {
+            error = ex.errorStr() + " " + ex.context();
+         }
+         catch ( std::exception &ex )
+         {
+            error = ex.what();
+         }
+         catch ( ... )
+         {
+            error = "unknown exception";
+         }
+
+         lock.lock();
+
+         if ( !error.empty() )
+         {
+            failedSections_.push_back( section.name + " (" + error + ")" );
+         }
+      }
+
+      fileEndOwner_ = nullptr;
+   }
+
+   void ImageFileImpl::queueSection( const std::function<void()> &writeSection,
+                                     const ustring &sectionName )
+   {
+      {
+         std::lock_guard<std::mutex> lock( fileEndMutex_ );
+
+         queuedSections_.push_back( { writeSection, sectionName } );
+
+         if ( fileEndOwner_ != nullptr )
+         {
+            return;
+         }
+
+         fileEndOwner_ = &queuedSections_;
+      }
+
+      // Nobody had the end of the file, so write it now as if we had it
+      releaseFileEnd( &queuedSections_ );
+   }
+
+   bool ImageFileImpl::ownsFileEnd( const void *writer ) const
+   {
+      std::lock_guard<std::mutex> lock( fileEndMutex_ );
+
+      return ( fileEndOwner_ == writer );
+   }
+
+   bool ImageFileImpl::isFileEndFree() const
+   {
+      std::lock_guard<std::mutex> lock( fileEndMutex_ );
+
+      return ( fileEndOwner_ == nullptr ) && queuedSections_.empty();
+   }
+
+   void ImageFileImpl::writeQueuedSections()
+   {
+      {
+         std::lock_guard<std::mutex> lock( fileEndMutex_ );
+
+         if ( queuedSections_.empty() )
+         {
+            return;
+         }
+
+         // The writer which has the end of the file can't write any more once it is closed
+         fileEndOwner_ = &queuedSections_;
+      }
+
+      releaseFileEnd( &queuedSections_ );
+   }
+
+   std::recursive_mutex &ImageFileImpl::writersMutex()
+   {
+      return writersMutex_;
+   }
+
    void ImageFileImpl::incrReaderCount()
    {
       readerCount_++;
@@ -693,9 +1438,10 @@ namespace e57
 #if ( E57_VALIDATION_LEVEL == VALIDATION_DEEP )
       if ( readerCount_ < 0 )
       {
-         throw E57_EXCEPTION2( ErrorInternal, "fileName=" + fileName_ +
-                                                 " writerCount=" + toString( writerCount_ ) +
-                                                 " readerCount=" + toString( readerCount_ ) );
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "fileName=" + fileName_ +
+                                  " writerCount=" + toString( writerCount_.load() ) +
+                                  " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
@@ -813,7 +1559,8 @@ namespace e57
       // position of the first 1 (from left) in the binary form of stateCountMinus1.
       //??? move to E57Utility?
 
-      uint64_t stateCountMinus1 = maximum - minimum;
+      uint64_t stateCountMinus1 =
+         static_cast<uint64_t>( maximum ) - static_cast<uint64_t>( minimum );
 
       unsigned log2 = 0;
 
@@ -869,13 +1616,17 @@ namespace e57
       os << space( indent ) << "writerCount: " << writerCount_ << std::endl;
       os << space( indent ) << "readerCount: " << readerCount_ << std::endl;
       os << space( indent ) << "isWriter:    " << isWriter_ << std::endl;
+      os << space( indent ) << "isUpdate:    " << isUpdate_ << std::endl;
       for ( size_t i = 0; i < extensionsCount(); i++ )
       {
          os << space( indent ) << "nameSpace[" << i << "]: prefix=" << extensionsPrefix( i )
             << " uri=" << extensionsUri( i ) << std::endl;
       }
       os << space( indent ) << "root:      " << std::endl;
-      root_->dump( indent + 2, os );
+      if ( root_ )
+      {
+         root_->dump( indent + 2, os );
+      }
    }
 #endif
 
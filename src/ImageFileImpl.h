@@ -27,13 +27,24 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "Common.h"
+#include "MemoryUsage.h"
+#include "NodeArena.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 namespace e57
 {
    class CheckedFile;
+   class PacketReadCache;
+   class ThreadPool;
 
    struct E57FileHeader;
    struct NameSpace;
@@ -41,9 +52,10 @@ namespace e57
    class ImageFileImpl : public std::enable_shared_from_this<ImageFileImpl>
    {
    public:
-      explicit ImageFileImpl( ReadChecksumPolicy policy );
+      explicit ImageFileImpl( ReadChecksumPolicy policy, bool lazyLoad = false );
 
-      void construct2( const ustring &fileName, const ustring &mode );
+      void construct2( const ustring &fileName, const ustring &mode,
+                       std::shared_ptr<ImageFileIO> io = nullptr );
       void construct2( const char *input, uint64_t size );
 
       std::shared_ptr<StructureNodeImpl> root();
@@ -52,14 +64,89 @@ namespace e57
       void cancel();
       bool isOpen() const;
       bool isWriter() const;
+
+      /// @returns true if an existing file was opened with "a" to be added to
+      bool isUpdate() const;
+
+      /// @returns true if logicalOffset is in what was already in a file opened for update. This
+      /// is never written to.
+      bool isExistingData( uint64_t logicalOffset ) const;
       int writerCount() const;
       int readerCount() const;
+      ImageFileStatistics statistics() const;
+      StatisticsCounters *statisticsCounters();
+      ImageFileMemoryUsage memoryUsage() const;
+      MemoryUsage *memoryUsageCounters();
+
+      /// Report the spans of work done on the file to handler (see ReaderOptions::traceHandler),
+      /// including those of opening it. Set it before the file is used by other threads.
+      void setTraceHandler( TraceHandler handler );
+      Tracer *tracer();
+
+      /// See ImageFile::verify()
+      ImageFileVerification verify( unsigned int threadCount );
+
       ~ImageFileImpl();
 
+      /// Run the work of the pools made by the thread count setters below on executor, null for
+      /// threads of their own. Set it before them.
+      void setExecutor( std::shared_ptr<Executor> executor );
+      std::shared_ptr<Executor> executor() const;
+
+      void setChecksumThreadCount( unsigned int threadCount );
+      void setRangeReads( size_t requestSize, unsigned int requestsInFlight );
+      void setDirectIO( bool enable );
+      void setAccessHints( bool enable );
+
+      void setDecodeThreadCount( unsigned int threadCount );
+      ThreadPool *decodePool() const;
+
+      void setEncodeThreadCount( unsigned int threadCount );
+      ThreadPool *encodePool() const;
+
+      void setPacketSizes( unsigned int packetFillTarget, unsigned int encoderBufferSize );
+      unsigned int packetFillTarget() const;
+      unsigned int encoderBufferSize() const;
+
+      /// How writers made after this fill their data packets (see WriterOptions::packetPacking)
+      void setPacketPacking( PacketPacking packing );
+      PacketPacking packetPacking() const;
+
+      /// How thoroughly the packets and values are checked (see ValidationLevel). This applies
+      /// to the SourceDestBuffers made after it is set, so set it before making any.
+      void setValidationLevel( ValidationLevel level );
+      ValidationLevel validationLevel() const;
+
+      /// Size the packet cache, read-ahead, range reads, and encoder buffers made after this to
+      /// fit in bytes (see ReaderOptions::memoryBudget). 0 turns the budget off. Set it before
+      /// setRangeReads().
+      void setMemoryBudget( uint64_t bytes );
+      uint64_t memoryBudget() const;
+
+      /// Take the packet cache, page, and encoder buffers from allocator (see
+      /// ReaderOptions::bufferAllocator), null for the heap. Set it before any readers or writers
+      /// are made.
+      void setBufferAllocator( std::shared_ptr<BufferAllocator> allocator );
+      const std::shared_ptr<BufferAllocator> &bufferAllocator() const;
+
+      void setPacketCacheSize( unsigned int packetCount );
+
+      /// @returns the number of packets in the cache, which may be fewer than were asked for to
+      /// fit in the memory budget
+      unsigned int packetCacheSize() const;
+      PacketReadCache *packetCache();
+
       uint64_t allocateSpace( uint64_t byteCount, bool doExtendNow );
+
+      /// Ask for byteCount more bytes after what has been allocated so far to be set aside on disk
+      /// (see CheckedFile::preallocate())
+      void reserveSpace( uint64_t byteCount );
       CheckedFile *file() const;
       ustring fileName() const;
 
+      /// @returns the CRC32C of the XML section, read again from the file
+      uint32_t xmlChecksum() const;
+
       /// Manipulate registered extensions in the file
       void extensionsAdd( const ustring &prefix, const ustring &uri );
       bool extensionsLookupPrefix( const ustring &prefix, ustring &uri ) const;
@@ -68,6 +155,9 @@ namespace e57
       ustring extensionsPrefix( size_t index ) const;
       ustring extensionsUri( size_t index ) const;
 
+      /// @returns the copy of elementName shared by the nodes of this file
+      InternedName internElementName( const ustring &elementName );
+
       /// Utility functions:
       bool isElementNameExtended( const ustring &elementName );
       bool isElementNameLegal( const ustring &elementName, bool allowNumber = true );
@@ -79,6 +169,30 @@ namespace e57
 
       void incrWriterCount();
       void decrWriterCount();
+
+      /// Several CompressedVectorWriters may be open at once, but a binary section must be
+      /// contiguous, so only one of them at a time writes at the end of the file. The others hold
+      /// their data packets back until they get it.
+      /// @returns true if writer has the end of the file to itself (now or already)
+      bool claimFileEnd( const void *writer );
+
+      /// Let the next writer have the end of the file, after running the sections queued by
+      /// queueSection() while writer had it. A section which fails doesn't keep the others from
+      /// being written, it makes close() fail instead.
+      void releaseFileEnd( const void *writer );
+
+      /// Run writeSection once no other writer has the end of the file, now if none has it.
+      /// @param sectionName Names the section if it fails to be written
+      void queueSection( const std::function<void()> &writeSection, const ustring &sectionName );
+
+      /// @returns true if writer has the end of the file
+      bool ownsFileEnd( const void *writer ) const;
+
+      /// @returns true if nobody has the end of the file and no sections wait for it
+      bool isFileEndFree() const;
+
+      /// Held while the writers update the tree, which they may close on different threads
+      std::recursive_mutex &writersMutex();
       void incrReaderCount();
       void decrReaderCount();
 
@@ -96,34 +210,129 @@ namespace e57
    private:
       friend class E57XmlParser;
       friend class BlobNodeImpl;
+      friend class BlobViewImpl;
+      friend class StructureNodeImpl;
       friend class CompressedVectorWriterImpl;
       friend class CompressedVectorReaderImpl;
 
       static void readFileHeader( CheckedFile *file, E57FileHeader &header );
 
+      void parseXml();
+      void releaseReadTree();
+      NodeImplSharedPtr parseDeferredElement( const E57XmlRange &range );
+
+      /// Create a node of the tree being read, in nodeArena_ if there is one
+      template <typename T, typename... Args> std::shared_ptr<T> newNode( Args &&...args )
+      {
+         if ( nodeArena_ )
+         {
+            return std::allocate_shared<T>( NodeArenaAllocator<T>( nodeArena_ ),
+                                            std::forward<Args>( args )... );
+         }
+
+         return std::make_shared<T>( std::forward<Args>( args )... );
+      }
+
       void checkImageFileOpen( const char *srcFileName, int srcLineNumber,
                                const char *srcFunctionName ) const;
 
+      void packetCounts( unsigned &cacheCount, unsigned &prefetchCount ) const;
+
       ustring fileName_;
       bool isWriter_;
-      int writerCount_;
-      int readerCount_;
+
+      // An updated file is a writer too, which only writes after existingLogicalLength_ (and the
+      // header once it is closed)
+      bool isUpdate_ = false;
+      uint64_t existingLogicalLength_ = 0;
+      std::atomic<int> writerCount_;
+      std::atomic<int> readerCount_;
+
+      /// Write out the sections queued behind a writer that was never closed
+      void writeQueuedSections();
+
+      struct QueuedSection
+      {
+         std::function<void()> write;
+         ustring name;
+      };
+
+      // The CompressedVectorWriter which has the end of the file (null if none), the sections of
+      // those which closed while another had it, and those which then failed to be written (with
+      // their errors). See claimFileEnd().
+      mutable std::mutex fileEndMutex_;
+      const void *fileEndOwner_ = nullptr;
+      std::deque<QueuedSection> queuedSections_;
+      std::vector<ustring> failedSections_;
+      std::recursive_mutex writersMutex_;
 
       ReadChecksumPolicy checksumPolicy;
 
       CheckedFile *file_;
 
+      // Shared with file_, see ImageFile::statistics()
+      StatisticsCounters statistics_;
+
+      // Shared with file_, see ImageFile::memoryUsage() and setMemoryBudget()
+      MemoryUsage memoryUsage_;
+
+      // Supplies the larger buffers, the heap if it is null (see setBufferAllocator())
+      std::shared_ptr<BufferAllocator> bufferAllocator_;
+
+      // Shared with file_, see setTraceHandler()
+      Tracer tracer_;
+
+      // Packets read by all the CompressedVectorReaders, created when first needed
+      std::unique_ptr<PacketReadCache> packetCache_;
+      std::mutex packetCacheMutex_;
+      unsigned int packetCacheSize_;
+
+      ValidationLevel validationLevel_ = ValidationBasic;
+
+      // Runs the work of the pools below (and of the file's checksum pool) if it isn't null
+      std::shared_ptr<Executor> executor_;
+
+      // Workers which decode the bytestreams of a packet in parallel, null if they are decoded
+      // on the reading thread
+      std::unique_ptr<ThreadPool> decodePool_;
+
+      // Workers which encode the bytestreams of a CompressedVector in parallel, null if they are
+      // encoded on the writing thread
+      std::unique_ptr<ThreadPool> encodePool_;
+
+      // Writers send a data packet once it has at least packetFillTarget_ bytes. Each of their
+      // encoders has an output buffer of encoderBufferSize_ bytes.
+      unsigned int packetFillTarget_;
+      unsigned int encoderBufferSize_;
+      PacketPacking packetPacking_ = PacketPackingProportional;
+
       // Read file attributes
       uint64_t xmlLogicalOffset_;
       uint64_t xmlLogicalLength_;
 
+      // If lazyLoad_ is set, the children of the data3D and images2D vectors are parsed when first
+      // accessed. Each is parsed as a fragment: the prologue of the XML section (up to the end of
+      // the root's start tag), the element, then the root's end tag.
+      bool lazyLoad_;
+      ustring xmlPrologue_;
+      ustring xmlRootName_;
+      std::mutex deferredXmlMutex_;
+
       // Write file attributes
       uint64_t unusedLogicalStart_;
 
       /// Bidirectional map from namespace prefix to uri
       std::vector<NameSpace> nameSpaces_;
 
+      /// Element names of the nodes, so each distinct name is stored once
+      std::unordered_map<ustring, InternedName> elementNames_;
+      std::mutex elementNamesMutex_;
+
       /// Smart pointer to metadata tree
       std::shared_ptr<StructureNodeImpl> root_;
+
+      /// Memory for the nodes parsed from a file opened for reading (null when writing). Nodes
+      /// keep it alive, so it is freed in one go once the last of them is released.
+      std::shared_ptr<NodeArena> nodeArena_;
    };
 }
@@ -220,6 +220,33 @@ int64_t IntegerNode::value() const
    return impl_->value();
 }
 
+/*!
+@brief Change the integer value stored.
+
+@details
+In a file opened in update mode, this changes the value without writing anything but the XML section
+and the file header again (see FloatNode::setValue).
+
+@param [in] value The new value.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre The destination ImageFile must have been opened in write or update mode (i.e.
+destImageFile().isWritable()).
+@pre minimum() <= value <= maximum()
+@post value() returns @a value.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorValueOutOfBounds
+@throw ::ErrorInternal All objects in undocumented state
+
+@see IntegerNode::value, IntegerNode::minimum, IntegerNode::maximum
+*/
+void IntegerNode::setValue( int64_t value )
+{
+   impl_->setValue( value );
+}
+
 /*!
 @brief Get the declared minimum that the value may take.
 
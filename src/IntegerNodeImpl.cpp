@@ -93,6 +93,21 @@ namespace e57
       return ( value_ );
    }
 
+   void IntegerNodeImpl::setValue( int64_t value )
+   {
+      checkValueWritable();
+
+      if ( value < minimum_ || maximum_ < value )
+      {
+         throw E57_EXCEPTION2( ErrorValueOutOfBounds, "this->pathName=" + this->pathName() +
+                                                         " value=" + toString( value ) +
+                                                         " minimum=" + toString( minimum_ ) +
+                                                         " maximum=" + toString( maximum_ ) );
+      }
+
+      value_ = value;
+   }
+
    int64_t IntegerNodeImpl::minimum()
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -128,7 +143,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       cf << space( indent ) << "<" << fieldName << " type=\"Integer\"";
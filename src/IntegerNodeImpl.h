@@ -46,6 +46,7 @@ namespace e57
       bool isDefined( const ustring &pathName ) override;
 
       int64_t value();
+      void setValue( int64_t value );
       int64_t minimum();
       int64_t maximum();
 
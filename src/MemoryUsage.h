@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+
+#include "E57Format.h"
+
+namespace e57
+{
+   /// @brief Bytes held by an ImageFile's larger buffers, behind ImageFile::memoryUsage().
+   /// @details One of these is owned by each ImageFileImpl and shared with its CheckedFile, so
+   /// the buffers made on any thread can be counted. The budget is only used to size the buffers
+   /// when they are made; nothing is refused for going over it.
+   class MemoryUsage
+   {
+   public:
+      /// Set the number of bytes the buffers are sized to fit in, 0 for no budget
+      void setBudget( uint64_t bytes )
+      {
+         budget_ = bytes;
+      }
+
+      uint64_t budget() const
+      {
+         return budget_;
+      }
+
+      void add( uint64_t bytes )
+      {
+         const uint64_t current = current_ += bytes;
+         uint64_t peak = peak_;
+
+         while ( ( current > peak ) && !peak_.compare_exchange_weak( peak, current ) )
+         {
+         }
+      }
+
+      void release( uint64_t bytes )
+      {
+         current_ -= bytes;
+      }
+
+      ImageFileMemoryUsage snapshot() const
+      {
+         ImageFileMemoryUsage usage;
+         usage.budget = budget_;
+         usage.current = current_;
+         usage.peak = peak_;
+
+         return usage;
+      }
+
+   private:
+      std::atomic<uint64_t> budget_{ 0 };
+      std::atomic<uint64_t> current_{ 0 };
+      std::atomic<uint64_t> peak_{ 0 };
+   };
+
+   /// Counts some bytes in a MemoryUsage (if it isn't null) until it is reset or destroyed
+   class MemoryReservation
+   {
+   public:
+      MemoryReservation() = default;
+
+      MemoryReservation( MemoryUsage *usage, uint64_t bytes )
+      {
+         reset( usage, bytes );
+      }
+
+      ~MemoryReservation()
+      {
+         reset();
+      }
+
+      MemoryReservation( const MemoryReservation & ) = delete;
+      MemoryReservation &operator=( const MemoryReservation & ) = delete;
+
+      /// Release what was counted before, then count bytes in usage
+      void reset( MemoryUsage *usage = nullptr, uint64_t bytes = 0 )
+      {
+         if ( usage_ != nullptr )
+         {
+            usage_->release( bytes_ );
+         }
+
+         usage_ = usage;
+         bytes_ = ( usage != nullptr ) ? bytes : 0;
+
+         if ( usage_ != nullptr )
+         {
+            usage_->add( bytes_ );
+         }
+      }
+
+   private:
+      MemoryUsage *usage_ = nullptr;
+      uint64_t bytes_ = 0;
+   };
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+
+#include "NodeArena.h"
+
+namespace e57
+{
+   NodeArena::NodeArena( size_t blockSize ) : blockSize_( blockSize )
+   {
+   }
+
+   void *NodeArena::allocate( size_t size, size_t alignment )
+   {
+      const size_t padding = ( alignment - reinterpret_cast<uintptr_t>( next_ ) % alignment ) %
+                             alignment;
+
+      if ( ( next_ == nullptr ) || ( padding + size > available_ ) )
+      {
+         // Large requests get a block of their own, so the current block can still be used
+         if ( size > blockSize_ / 4 )
+         {
+            std::unique_ptr<char[]> block( new char[size] );
+            blocks_.push_back( std::move( block ) );
+
+            return blocks_.back().get();
+         }
+
+         std::unique_ptr<char[]> block( new char[blockSize_] );
+         blocks_.push_back( std::move( block ) );
+
+         next_ = blocks_.back().get();
+         available_ = blockSize_;
+
+         return allocate( size, alignment );
+      }
+
+      char *p = next_ + padding;
+
+      next_ = p + size;
+      available_ -= padding + size;
+
+      return p;
+   }
+}
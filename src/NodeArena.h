@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace e57
+{
+   /// @brief Monotonic memory for the nodes of a file opened for reading.
+   /// @details Memory comes from large blocks and is never given back one allocation at a time.
+   /// All of it is freed at once when the arena is destroyed, i.e. once the last node allocated
+   /// from it (see NodeArenaAllocator) is gone.
+   /// @warning Not thread-safe. Nodes are only allocated while parsing the XML section, which is
+   /// done when the file is opened or under the file's deferredXmlMutex_.
+   class NodeArena
+   {
+   public:
+      explicit NodeArena( size_t blockSize = 64 * 1024 );
+
+      NodeArena( const NodeArena & ) = delete;
+      NodeArena &operator=( const NodeArena & ) = delete;
+
+      void *allocate( size_t size, size_t alignment );
+
+   private:
+      size_t blockSize_;
+      std::vector<std::unique_ptr<char[]>> blocks_;
+      char *next_ = nullptr; /// next free byte in the current block
+      size_t available_ = 0; /// bytes left after next_
+   };
+
+   /// Allocator for std::allocate_shared() which takes its memory from a NodeArena. Each copy
+   /// (e.g. the one kept with the shared_ptr control block) keeps the arena alive.
+   template <typename T> class NodeArenaAllocator
+   {
+   public:
+      using value_type = T;
+
+      explicit NodeArenaAllocator( std::shared_ptr<NodeArena> arena ) : arena_( std::move( arena ) )
+      {
+      }
+
+      template <typename U>
+      NodeArenaAllocator( const NodeArenaAllocator<U> &other ) : arena_( other.arena_ )
+      {
+      }
+
+      T *allocate( size_t n )
+      {
+         return static_cast<T *>( arena_->allocate( n * sizeof( T ), alignof( T ) ) );
+      }
+
+      void deallocate( T *, size_t )
+      {
+         // The memory is freed with the arena
+      }
+
+      template <typename U> bool operator==( const NodeArenaAllocator<U> &other ) const
+      {
+         return arena_ == other.arena_;
+      }
+
+      template <typename U> bool operator!=( const NodeArenaAllocator<U> &other ) const
+      {
+         return arena_ != other.arena_;
+      }
+
+   private:
+      template <typename U> friend class NodeArenaAllocator;
+
+      std::shared_ptr<NodeArena> arena_;
+   };
+}
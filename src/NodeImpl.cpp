@@ -33,8 +33,19 @@
 
 using namespace e57;
 
+namespace
+{
+   // Name of nodes which haven't been given a parent yet
+   const InternedName &noElementName()
+   {
+      static const InternedName name = std::make_shared<const ustring>();
+
+      return name;
+   }
+}
+
 NodeImpl::NodeImpl( ImageFileImplWeakPtr destImageFile ) :
-   destImageFile_( destImageFile ), isAttached_( false )
+   destImageFile_( destImageFile ), elementName_( noElementName() ), isAttached_( false )
 {
    checkImageFileOpen(
       __FILE__, __LINE__,
@@ -53,6 +64,19 @@ void NodeImpl::checkImageFileOpen( const char *srcFileName, int srcLineNumber,
    }
 }
 
+void NodeImpl::checkValueWritable() const
+{
+   checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+   ImageFileImplSharedPtr destImageFile( destImageFile_ );
+
+   if ( !destImageFile->isWriter() )
+   {
+      throw E57_EXCEPTION2( ErrorFileReadOnly, "fileName=" + destImageFile->fileName() +
+                                                  " this->pathName=" + this->pathName() );
+   }
+}
+
 bool NodeImpl::isRoot() const
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -88,10 +112,10 @@ ustring NodeImpl::pathName() const
 
    if ( p->isRoot() )
    {
-      return ( "/" + elementName_ );
+      return ( "/" + *elementName_ );
    }
 
-   return ( p->pathName() + "/" + elementName_ );
+   return ( p->pathName() + "/" + *elementName_ );
 }
 
 ustring NodeImpl::relativePathName( const NodeImplSharedPtr &origin, ustring childPathName ) const
@@ -114,17 +138,33 @@ ustring NodeImpl::relativePathName( const NodeImplSharedPtr &origin, ustring chi
 
    if ( childPathName.empty() )
    {
-      return p->relativePathName( origin, elementName_ );
+      return p->relativePathName( origin, *elementName_ );
    }
 
-   return p->relativePathName( origin, elementName_ + "/" + childPathName );
+   return p->relativePathName( origin, *elementName_ + "/" + childPathName );
 }
 
 ustring NodeImpl::elementName() const
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
-   return elementName_;
+   return *elementName_;
+}
+
+bool NodeImpl::hasSameElementName( const NodeImpl &other ) const
+{
+   // don't checkImageFileOpen
+
+   if ( elementName_ == other.elementName_ )
+   {
+      return true;
+   }
+
+   // Names interned by the same file are only equal if they are the same string
+   const bool sameFile = !destImageFile_.owner_before( other.destImageFile_ ) &&
+                         !other.destImageFile_.owner_before( destImageFile_ );
+
+   return !sameFile && ( *elementName_ == *other.elementName_ );
 }
 
 ImageFileImplSharedPtr NodeImpl::destImageFile()
@@ -176,7 +216,7 @@ void NodeImpl::setParent( NodeImplSharedPtr parent, const ustring &elementName )
    }
 
    parent_ = parent;
-   elementName_ = elementName;
+   elementName_ = ImageFileImplSharedPtr( destImageFile_ )->internElementName( elementName );
 
    // If parent is attached then we are attached (and all of our children)
    if ( parent->isAttached() )
@@ -385,7 +425,7 @@ bool NodeImpl::findTerminalPosition( const NodeImplSharedPtr &target, uint64_t &
 void NodeImpl::dump( int indent, std::ostream &os ) const
 {
    // don't checkImageFileOpen
-   os << space( indent ) << "elementName: " << elementName_ << std::endl;
+   os << space( indent ) << "elementName: " << *elementName_ << std::endl;
    os << space( indent ) << "isAttached:  " << isAttached_ << std::endl;
    os << space( indent ) << "path:        " << pathName() << std::endl;
 }
@@ -39,6 +39,10 @@ namespace e57
       virtual NodeType type() const = 0;
       void checkImageFileOpen( const char *srcFileName, int srcLineNumber,
                                const char *srcFunctionName ) const;
+
+      /// Throw ::ErrorFileReadOnly unless the value of this node may be changed (see e.g.
+      /// FloatNode::setValue)
+      void checkValueWritable() const;
       virtual bool isTypeEquivalent( NodeImplSharedPtr ni ) = 0;
 
       bool isRoot() const;
@@ -47,6 +51,7 @@ namespace e57
       ustring relativePathName( const NodeImplSharedPtr &origin,
                                 ustring childPathName = ustring() ) const;
       ustring elementName() const;
+      bool hasSameElementName( const NodeImpl &other ) const;
       ImageFileImplSharedPtr destImageFile();
 
       ustring imageFileName() const;
@@ -100,7 +105,7 @@ namespace e57
 
       ImageFileImplWeakPtr destImageFile_;
       NodeImplWeakPtr parent_;
-      ustring elementName_;
+      InternedName elementName_; /// never null
       bool isAttached_;
    };
 }
@@ -25,79 +25,93 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
+
+#ifdef E57_WITH_ZLIB
+#include <zlib.h>
+#endif
 
 #include "CheckedFile.h"
 #include "Packet.h"
+#include "Statistics.h"
 #include "StringFunctions.h"
+#include "Trace.h"
 
 using namespace e57;
 
-struct IndexPacket
-{
-   static constexpr unsigned MAX_ENTRIES = 2048;
+//=============================================================================
+// PacketReadCache
 
-   const uint8_t packetType = INDEX_PACKET;
+PacketReadCache::PacketReadCache( CheckedFile *cFile, unsigned packetCount ) :
+   cFile_( cFile ), entries_( packetCount ),
+   entryBuffers_( cFile->bufferAllocator(), packetCount * size_t( DATA_PACKET_MAX ) )
+{
+   if ( packetCount == 0 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "packetCount=" + toString( packetCount ) );
+   }
 
-   uint8_t packetFlags = 0; // flag bitfields
-   uint16_t packetLogicalLengthMinus1 = 0;
-   uint16_t entryCount = 0;
-   uint8_t indexLevel = 0;
-   uint8_t reserved1[9] = {}; // must be zero
+   index_.reserve( packetCount );
 
-   struct IndexPacketEntry
+   // Start with the entries in index order, so entry 0 is the least recently used
+   for ( unsigned i = 0; i < packetCount; ++i )
    {
-      uint64_t chunkRecordNumber = 0;
-      uint64_t chunkPhysicalOffset = 0;
-   } entries[MAX_ENTRIES];
+      entries_[i].newer_ = ( i + 1 ) % packetCount;
+      entries_[i].older_ = ( i + packetCount - 1 ) % packetCount;
+      entries_[i].buffer_ = entryBuffers_.data() + i * size_t( DATA_PACKET_MAX );
+   }
 
-   void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0,
-                uint64_t fileSize = 0 ) const;
+   newest_ = packetCount - 1;
 
-#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
-   void dump( int indent = 0, std::ostream &os = std::cout ) const;
-#endif
-};
+   memory_.reset( cFile_->memoryUsage(),
+                  packetCount * ( sizeof( CacheEntry ) + uint64_t( DATA_PACKET_MAX ) ) );
+}
 
-struct EmptyPacketHeader
+PacketReadCache::~PacketReadCache()
 {
-   const uint8_t packetType = EMPTY_PACKET;
-
-   uint8_t reserved1 = 0; // must be zero
-   uint16_t packetLogicalLengthMinus1 = 0;
+   // The background task uses this object, so stop it and wait for it to finish
+   {
+      std::lock_guard<std::mutex> guard( prefetchMutex_ );
+      prefetchStopping_ = true;
+   }
 
-   void verify( unsigned bufferLength = 0 ) const; //???use
+   if ( prefetchTask_.valid() )
+   {
+      prefetchTask_.wait();
+   }
+}
 
-#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
-   void dump( int indent = 0, std::ostream &os = std::cout ) const;
-#endif
-};
+void PacketReadCache::enablePrefetch( unsigned packetCount )
+{
+   std::lock_guard<std::mutex> guard( prefetchMutex_ );
 
-//=============================================================================
-// PacketReadCache
+   prefetched_.resize( packetCount );
+   prefetchBuffers_ =
+      IOBuffer( cFile_->bufferAllocator(), packetCount * size_t( DATA_PACKET_MAX ) );
 
-PacketReadCache::PacketReadCache( CheckedFile *cFile, unsigned packetCount ) :
-   cFile_( cFile ), entries_( packetCount )
-{
-   if ( packetCount == 0 )
+   for ( size_t i = 0; i < prefetched_.size(); ++i )
    {
-      throw E57_EXCEPTION2( ErrorInternal, "packetCount=" + toString( packetCount ) );
+      prefetched_[i].buffer_ = prefetchBuffers_.data() + i * DATA_PACKET_MAX;
    }
+
+   prefetchMemory_.reset( cFile_->memoryUsage(), packetCount * uint64_t( DATA_PACKET_MAX ) );
+}
+
+void PacketReadCache::setValidationLevel( ValidationLevel level )
+{
+   validationLevel_ = level;
 }
 
-std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char *&pkt )
+std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char *&pkt,
+                                                   uint64_t sectionEndLogicalOffset )
 {
 #ifdef E57_VERBOSE
    std::cout << "PacketReadCache::lock() called, packetLogicalOffset=" << packetLogicalOffset
              << std::endl;
 #endif
 
-   // Only allow one locked packet at a time.
-   if ( lockCount_ > 0 )
-   {
-      throw E57_EXCEPTION2( ErrorInternal, "lockCount=" + toString( lockCount_ ) );
-   }
-
    // Offset can't be 0
    if ( packetLogicalOffset == 0 )
    {
@@ -105,81 +119,190 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
                             "packetLogicalOffset=" + toString( packetLogicalOffset ) );
    }
 
-   // Linear scan for matching packet offset in cache
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   std::unique_lock<std::mutex> guard( mutex_ );
+
+   auto found = index_.find( packetLogicalOffset );
+
+   // Another reader is reading it, so wait for it rather than reading it again ourselves. If
+   // that fails the packet is gone from the index, and we try to read it.
+   while ( ( found != index_.end() ) && entries_[found->second].loading_ )
+   {
+      entryCondition_.wait( guard );
+      found = index_.find( packetLogicalOffset );
+   }
+
+   if ( found != index_.end() )
    {
+      const unsigned i = found->second;
       auto &entry = entries_[i];
 
-      if ( packetLogicalOffset == entry.logicalOffset_ )
-      {
-         // Found a match, so don't have to read anything
+      // Found a match, so don't have to read anything
 #ifdef E57_VERBOSE
-         std::cout << "  Found matching cache entry, index=" << i << std::endl;
+      std::cout << "  Found matching cache entry, index=" << i << std::endl;
 #endif
-         // Mark entry with current useCount (keeps track of age of entry).
-         entry.lastUsed_ = ++useCount_;
+      E57_STATISTICS_ADD( cFile_->statistics(), packetCacheHits, 1 );
+      touch( i );
 
-         // Publish buffer address to caller
-         pkt = entry.buffer_;
+      // Publish buffer address to caller
+      pkt = entry.buffer_;
 
-         // Create lock so we are sure that we will be unlocked when use is finished.
-         std::unique_ptr<PacketLock> plock( new PacketLock( this, i ) );
+      // Create lock so we are sure that we will be unlocked when use is finished.
+      std::unique_ptr<PacketLock> plock( new PacketLock( this, i ) );
 
-         // Increment cache lock just before return
-         ++lockCount_;
+      // Increment entry lock just before return
+      ++entry.lockCount_;
 
-         return plock;
+      guard.unlock();
+
+      if ( !prefetched_.empty() && ( sectionEndLogicalOffset != 0 ) )
+      {
+         const auto header = reinterpret_cast<const EmptyPacketHeader *>( pkt );
+
+         schedulePrefetch( packetLogicalOffset, header->packetLogicalLengthMinus1 + 1u,
+                           sectionEndLogicalOffset, false );
       }
+
+      return plock;
    }
    // Get here if didn't find a match already in cache.
+   E57_STATISTICS_ADD( cFile_->statistics(), packetCacheMisses, 1 );
 
-   // Find least recently used (LRU) packet buffer
-   unsigned oldestEntry = 0;
-   unsigned oldestUsed = entries_.at( 0 ).lastUsed_;
+   // Reuse the least recently used (LRU) packet buffer which isn't locked
+   unsigned oldestEntry = entries_[newest_].newer_;
 
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   for ( size_t i = 0; entries_[oldestEntry].lockCount_ > 0; ++i )
    {
-      const auto &entry = entries_[i];
-
-      if ( entry.lastUsed_ < oldestUsed )
+      if ( i == entries_.size() )
       {
-         oldestEntry = i;
-         oldestUsed = entry.lastUsed_;
+         throw E57_EXCEPTION2( ErrorInternal, "all " + toString( entries_.size() ) +
+                                                 " packet cache entries are locked" );
       }
+
+      oldestEntry = entries_[oldestEntry].newer_;
    }
+
 #ifdef E57_VERBOSE
-   std::cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << std::endl;
+   std::cout << "  Oldest entry=" << oldestEntry << std::endl;
 #endif
 
-   readPacket( oldestEntry, packetLogicalOffset );
+   auto &oldest = entries_[oldestEntry];
 
-   // Publish buffer address to caller
-   pkt = entries_[oldestEntry].buffer_;
+   if ( oldest.logicalOffset_ != 0 )
+   {
+      index_.erase( oldest.logicalOffset_ );
+   }
 
-   // Create lock so we are sure we will be unlocked when use is finished.
+   // Reserve the entry for the packet, locked so it isn't reused, and read it without holding
+   // the cache so the other readers can go on using it
+   oldest.logicalOffset_ = packetLogicalOffset;
+   oldest.loading_ = true;
+   ++oldest.lockCount_;
+   index_[packetLogicalOffset] = oldestEntry;
+   touch( oldestEntry );
+
+   guard.unlock();
+
+   // Create lock so we are sure we will be unlocked when use is finished, or if reading fails.
    std::unique_ptr<PacketLock> plock( new PacketLock( this, oldestEntry ) );
 
-   // Increment cache lock just before return
-   ++lockCount_;
+   bool prefetched = false;
+
+   try
+   {
+      // Let the file read the rest of the section in large requests, e.g. from a remote store
+      if ( sectionEndLogicalOffset != 0 )
+      {
+         cFile_->planRangeReads( packetLogicalOffset, sectionEndLogicalOffset );
+      }
+
+      // Use the packet if it has been read ahead, otherwise we have to read it now
+      prefetched = takePrefetchedPacket( oldestEntry, packetLogicalOffset );
+
+      if ( !prefetched )
+      {
+         readPacket( oldestEntry, packetLogicalOffset );
+      }
+   }
+   catch ( ... )
+   {
+      // Forget it, so we don't find a half-read packet
+      guard.lock();
+
+      index_.erase( packetLogicalOffset );
+      oldest.logicalOffset_ = 0;
+      oldest.loading_ = false;
+
+      guard.unlock();
+      entryCondition_.notify_all();
+
+      throw;
+   }
+
+   guard.lock();
+   oldest.loading_ = false;
+   guard.unlock();
+   entryCondition_.notify_all();
+
+   // Publish buffer address to caller
+   pkt = oldest.buffer_;
+
+   if ( !prefetched_.empty() && ( sectionEndLogicalOffset != 0 ) )
+   {
+      const auto header = reinterpret_cast<const EmptyPacketHeader *>( pkt );
+
+      schedulePrefetch( packetLogicalOffset, header->packetLogicalLengthMinus1 + 1u,
+                        sectionEndLogicalOffset, !prefetched );
+   }
 
    return plock;
 }
 
 void PacketReadCache::unlock( unsigned cacheIndex )
 {
-   //??? why lockedEntry not used?
 #ifdef E57_VERBOSE
    std::cout << "PacketReadCache::unlock() called, cacheIndex=" << cacheIndex << std::endl;
-#else
-   UNUSED( cacheIndex );
 #endif
 
-   if ( lockCount_ != 1 )
+   std::lock_guard<std::mutex> guard( mutex_ );
+
+   auto &entry = entries_.at( cacheIndex );
+
+   if ( entry.lockCount_ == 0 )
    {
-      throw E57_EXCEPTION2( ErrorInternal, "lockCount=" + toString( lockCount_ ) );
+      throw E57_EXCEPTION2( ErrorInternal, "cacheIndex=" + toString( cacheIndex ) +
+                                              " lockCount=" + toString( entry.lockCount_ ) );
    }
 
-   --lockCount_;
+   --entry.lockCount_;
+}
+
+/// Make entries_[cacheIndex] the most recently used entry.
+void PacketReadCache::touch( unsigned cacheIndex )
+{
+   if ( cacheIndex == newest_ )
+   {
+      return;
+   }
+
+   const unsigned oldestEntry = entries_[newest_].newer_;
+
+   // The oldest entry is already next to the newest, so it just needs to become the newest.
+   // Otherwise move it there.
+   if ( cacheIndex != oldestEntry )
+   {
+      auto &entry = entries_[cacheIndex];
+
+      entries_[entry.older_].newer_ = entry.newer_;
+      entries_[entry.newer_].older_ = entry.older_;
+
+      entry.older_ = newest_;
+      entry.newer_ = oldestEntry;
+
+      entries_[newest_].newer_ = cacheIndex;
+      entries_[oldestEntry].older_ = cacheIndex;
+   }
+
+   newest_ = cacheIndex;
 }
 
 void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset )
@@ -189,36 +312,60 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
              << " packetLogicalOffset=" << packetLogicalOffset << std::endl;
 #endif
 
-   // Read header of packet first to get length.  Use EmptyPacketHeader since  it has the fields
-   // common to all packets.
-   EmptyPacketHeader header;
+   fetchPacket( packetLogicalOffset, entries_.at( oldestEntry ).buffer_ );
+}
+
+/// Read and verify the packet at packetLogicalOffset into buffer (which must hold
+/// DATA_PACKET_MAX bytes). This is also used by the background task, so it may only use the
+/// file through CheckedFile::readAt().
+/// @returns the length of the packet
+unsigned PacketReadCache::fetchPacket( uint64_t packetLogicalOffset, char *buffer )
+{
+   E57_TRACE_SPAN( cFile_->tracer(), "readPacket" );
 
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+   // Read the packet in one pass, getting its length from the header on the way. Use
+   // EmptyPacketHeader since it has the fields common to all packets.
+   uint8_t packetType = 0;
 
-   // Can't verify packet header here, because it is not really an EmptyPacketHeader.
-   unsigned packetLength = header.packetLogicalLengthMinus1 + 1;
+   const auto packetLength = static_cast<unsigned>( cFile_->readRecordAt(
+      packetLogicalOffset, buffer, sizeof( EmptyPacketHeader ),
+      [&packetType]( const char *start ) {
+         // Can't verify packet header here, because it is not really an EmptyPacketHeader.
+         auto header = reinterpret_cast<const EmptyPacketHeader *>( start );
 
-   // Be paranoid about packetLength before read
-   if ( packetLength > DATA_PACKET_MAX )
-   {
-      throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( packetLength ) );
-   }
+         packetType = header->packetType;
 
-   auto &entry = entries_.at( oldestEntry );
+         const size_t length = header->packetLogicalLengthMinus1 + 1;
 
-   // Now read in whole packet into preallocated buffer_.  Note buffer is
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( entry.buffer_, packetLength );
+         // Be paranoid about packetLength before reading the rest
+         if ( length > DATA_PACKET_MAX )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( length ) );
+         }
+
+         return length;
+      } ) );
+
+   E57_TRACE_BYTES( packetLength );
+   E57_STATISTICS_TIME( cFile_->statistics(), packetParseNanoseconds );
 
    // Verify that packet is good.
-   switch ( header.packetType )
+   switch ( packetType )
    {
       case DATA_PACKET:
       {
-         auto dpkt = reinterpret_cast<DataPacket *>( entry.buffer_ );
+         auto dpkt = reinterpret_cast<DataPacket *>( buffer );
 
-         dpkt->verify( packetLength );
+         if ( dpkt->header.packetFlags & DATA_PACKET_DEFLATED )
+         {
+            dpkt->inflate( packetLength );
+         }
+
+         // getBytestream() still keeps each bytestream within the packet
+         if ( validationLevel_ != ValidationNone )
+         {
+            dpkt->verify( packetLength );
+         }
 #ifdef E57_VERBOSE
          std::cout << "  data packet:" << std::endl;
          dpkt->dump( 4 ); //???
@@ -227,9 +374,9 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       break;
       case INDEX_PACKET:
       {
-         auto ipkt = reinterpret_cast<IndexPacket *>( entry.buffer_ );
+         auto ipkt = reinterpret_cast<IndexPacket *>( buffer );
 
-         ipkt->verify( packetLength );
+         ipkt->verify( packetLength, 0, 0, validationLevel_ );
 #ifdef E57_VERBOSE
          std::cout << "  index packet:" << std::endl;
          ipkt->dump( 4 ); //???
@@ -238,7 +385,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       break;
       case EMPTY_PACKET:
       {
-         auto hp = reinterpret_cast<EmptyPacketHeader *>( entry.buffer_ );
+         auto hp = reinterpret_cast<EmptyPacketHeader *>( buffer );
 
          hp->verify( packetLength );
 #ifdef E57_VERBOSE
@@ -248,27 +395,239 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       }
       break;
       default:
-         throw E57_EXCEPTION2( ErrorInternal, "packetType=" + toString( header.packetType ) );
+         throw E57_EXCEPTION2( ErrorInternal, "packetType=" + toString( packetType ) );
+   }
+
+   return packetLength;
+}
+
+/// If the packet at packetLogicalOffset has been read ahead, move it into entries_[oldestEntry].
+/// @returns false if it hasn't been read ahead
+bool PacketReadCache::takePrefetchedPacket( unsigned oldestEntry, uint64_t packetLogicalOffset )
+{
+   if ( prefetched_.empty() )
+   {
+      return false;
+   }
+
+   std::unique_lock<std::mutex> guard( prefetchMutex_ );
+
+   // If it is being read right now, wait for it rather than reading it again ourselves
+   prefetchCondition_.wait( guard,
+                            [&] { return loadingLogicalOffset_ != packetLogicalOffset; } );
+
+   for ( auto &prefetch : prefetched_ )
+   {
+      if ( prefetch.logicalOffset_ == packetLogicalOffset )
+      {
+         auto &entry = entries_.at( oldestEntry );
+
+         // Inflated data packets are longer in memory than in the file
+         const auto header = reinterpret_cast<const DataPacketHeader *>( prefetch.buffer_ );
+         const bool inflated =
+            ( header->packetType == DATA_PACKET ) && ( header->packetFlags & DATA_PACKET_DEFLATED );
+
+         memcpy( entry.buffer_, prefetch.buffer_,
+                 inflated ? static_cast<unsigned>( DATA_PACKET_MAX ) : prefetch.length_ );
+
+         // Let the background task reuse it
+         prefetch.logicalOffset_ = 0;
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void PacketReadCache::addSectionReader( uint64_t sectionEndLogicalOffset )
+{
+   std::lock_guard<std::mutex> guard( prefetchMutex_ );
+
+   ++sectionReaders_[sectionEndLogicalOffset];
+
+   if ( sectionReaders_.size() > 1 )
+   {
+      // Stop reading ahead. If the background task is reading something now, the generation
+      // tells it to throw that away.
+      for ( auto &prefetch : prefetched_ )
+      {
+         prefetch.logicalOffset_ = 0;
+      }
+
+      prefetchEndLogicalOffset_ = 0;
+      ++prefetchGeneration_;
    }
+}
 
-   entry.logicalOffset_ = packetLogicalOffset;
+void PacketReadCache::removeSectionReader( uint64_t sectionEndLogicalOffset )
+{
+   std::lock_guard<std::mutex> guard( prefetchMutex_ );
+
+   const auto found = sectionReaders_.find( sectionEndLogicalOffset );
 
-   // Mark entry with current useCount (keeps track of age of entry).
-   // This is a cache, so a small hiccup when useCount_ overflows won't hurt.
-   entry.lastUsed_ = ++useCount_;
+   if ( ( found != sectionReaders_.end() ) && ( --found->second == 0 ) )
+   {
+      sectionReaders_.erase( found );
+   }
+}
+
+/// Called each time a packet is locked to keep the packets following it coming.
+/// @param [in] restart true if the packet had to be read by the caller, in which case the
+/// reader has moved somewhere we weren't reading ahead of
+void PacketReadCache::schedulePrefetch( uint64_t packetLogicalOffset, unsigned packetLength,
+                                        uint64_t sectionEndLogicalOffset, bool restart )
+{
+   std::lock_guard<std::mutex> guard( prefetchMutex_ );
+
+   // Readers of several sections are open (see addSectionReader())
+   if ( prefetchStopping_ || ( sectionReaders_.size() > 1 ) )
+   {
+      return;
+   }
+
+   // The reader of another section is using the cache now
+   if ( sectionEndLogicalOffset != prefetchEndLogicalOffset_ )
+   {
+      prefetchEndLogicalOffset_ = sectionEndLogicalOffset;
+      restart = true;
+   }
+
+   const uint64_t nextLogicalOffset = packetLogicalOffset + packetLength;
+
+   // Several bytestreams may be reading from different packets, so only move forward
+   if ( !restart && ( nextLogicalOffset <= prefetchFrontier_ ) )
+   {
+      return;
+   }
+
+   // Still reading ahead of this packet?
+   bool following = ( nextPrefetchLogicalOffset_ == nextLogicalOffset ) ||
+                    ( loadingLogicalOffset_ == nextLogicalOffset );
+
+   for ( auto &prefetch : prefetched_ )
+   {
+      if ( prefetch.logicalOffset_ == nextLogicalOffset )
+      {
+         following = true;
+      }
+      else if ( prefetch.logicalOffset_ < nextLogicalOffset )
+      {
+         // Skipped over, so make room for more
+         prefetch.logicalOffset_ = 0;
+      }
+   }
+
+   if ( !following )
+   {
+      // Start again right after this packet. If the background task is reading something now,
+      // the generation tells it to throw that away.
+      for ( auto &prefetch : prefetched_ )
+      {
+         prefetch.logicalOffset_ = 0;
+      }
+
+      nextPrefetchLogicalOffset_ = nextLogicalOffset;
+      ++prefetchGeneration_;
+   }
+
+   prefetchFrontier_ = nextLogicalOffset;
+
+   if ( prefetchRunning_ || ( nextPrefetchLogicalOffset_ >= prefetchEndLogicalOffset_ ) )
+   {
+      return;
+   }
+
+   prefetchRunning_ = true;
+   prefetchTask_ = cFile_->runInBackground( [this] { prefetchPackets(); } );
+}
+
+/// Background task which reads packets until all of prefetched_ is full or the end of the
+/// section is reached.
+void PacketReadCache::prefetchPackets()
+{
+   for ( ;; )
+   {
+      uint64_t packetLogicalOffset = 0;
+      unsigned generation = 0;
+      PrefetchEntry *freeEntry = nullptr;
+
+      {
+         std::lock_guard<std::mutex> guard( prefetchMutex_ );
+
+         if ( !prefetchStopping_ && ( nextPrefetchLogicalOffset_ < prefetchEndLogicalOffset_ ) )
+         {
+            for ( auto &prefetch : prefetched_ )
+            {
+               if ( prefetch.logicalOffset_ == 0 )
+               {
+                  freeEntry = &prefetch;
+                  break;
+               }
+            }
+         }
+
+         if ( freeEntry == nullptr )
+         {
+            prefetchRunning_ = false;
+            return;
+         }
+
+         packetLogicalOffset = nextPrefetchLogicalOffset_;
+         generation = prefetchGeneration_;
+         loadingLogicalOffset_ = packetLogicalOffset;
+      }
+
+      // Nobody else touches freeEntry while its offset is 0 and we are running
+      unsigned packetLength = 0;
+
+      try
+      {
+         packetLength = fetchPacket( packetLogicalOffset, freeEntry->buffer_ );
+      }
+      catch ( ... )
+      {
+         // Leave it for the reader to find the problem (and report it) when it reads the packet
+      }
+
+      {
+         std::lock_guard<std::mutex> guard( prefetchMutex_ );
+
+         loadingLogicalOffset_ = 0;
+
+         if ( generation == prefetchGeneration_ )
+         {
+            if ( packetLength == 0 )
+            {
+               // Without a good packet we don't know where the next one starts
+               prefetchRunning_ = false;
+               prefetchCondition_.notify_all();
+               return;
+            }
+
+            freeEntry->logicalOffset_ = packetLogicalOffset;
+            freeEntry->length_ = packetLength;
+
+            nextPrefetchLogicalOffset_ = packetLogicalOffset + packetLength;
+         }
+      }
+
+      prefetchCondition_.notify_all();
+   }
 }
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 void PacketReadCache::dump( int indent, std::ostream &os )
 {
-   os << space( indent ) << "lockCount: " << lockCount_ << std::endl;
-   os << space( indent ) << "useCount:  " << useCount_ << std::endl;
+   os << space( indent ) << "newest:    " << newest_ << std::endl;
    os << space( indent ) << "entries:" << std::endl;
    for ( unsigned i = 0; i < entries_.size(); i++ )
    {
       os << space( indent ) << "entry[" << i << "]:" << std::endl;
       os << space( indent + 4 ) << "logicalOffset:  " << entries_[i].logicalOffset_ << std::endl;
-      os << space( indent + 4 ) << "lastUsed:        " << entries_[i].lastUsed_ << std::endl;
+      os << space( indent + 4 ) << "lockCount:      " << entries_[i].lockCount_ << std::endl;
+      os << space( indent + 4 ) << "newer:          " << entries_[i].newer_ << std::endl;
+      os << space( indent + 4 ) << "older:          " << entries_[i].older_ << std::endl;
       if ( entries_[i].logicalOffset_ != 0 )
       {
          os << space( indent + 4 ) << "packet:" << std::endl;
@@ -441,6 +800,17 @@ void DataPacket::verify( unsigned bufferLength ) const
    std::cout << "needed=" << needed << " actual=" << packetLength << std::endl; //???
 #endif
 
+   // An inflated packet only has to fit in memory, and is followed by whatever was in the buffer
+   if ( header.packetFlags & DATA_PACKET_DEFLATED )
+   {
+      if ( needed > DATA_PACKET_MAX )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "needed=" + toString( needed ) );
+      }
+
+      return;
+   }
+
    // If needed is not with 3 bytes of actual packet size, have an error
    if ( needed > packetLength || needed + 3 < packetLength )
    {
@@ -492,8 +862,12 @@ char *DataPacket::getBytestream( unsigned bytestreamNumber, unsigned &byteCount
    byteCount = bsbLength[bytestreamNumber];
 
    // Double check buffer is completely within packet
+   const unsigned packetLength = ( header.packetFlags & DATA_PACKET_DEFLATED )
+                                    ? static_cast<unsigned>( DATA_PACKET_MAX )
+                                    : header.packetLogicalLengthMinus1 + 1U;
+
    if ( ( sizeof( DataPacketHeader ) + 2 * header.bytestreamCount + totalPreceding + byteCount ) >
-        header.packetLogicalLengthMinus1 + 1U )
+        packetLength )
    {
       throw E57_EXCEPTION2( ErrorInternal, "bytestreamCount=" + toString( header.bytestreamCount ) +
                                               " totalPreceding=" + toString( totalPreceding ) +
@@ -514,6 +888,172 @@ unsigned DataPacket::getBytestreamBufferLength( unsigned bytestreamNumber )
    return ( byteCount );
 }
 
+unsigned DataPacket::deflate( unsigned packetLength, int level, DataPacket &deflated ) const
+{
+#ifdef E57_WITH_ZLIB
+   const unsigned count = header.bytestreamCount;
+
+   auto bsbLength = reinterpret_cast<const uint16_t *>( &payload[0] );
+   auto in = reinterpret_cast<const Bytef *>( &bsbLength[count] );
+
+   auto deflatedBsbLength = reinterpret_cast<uint16_t *>( &deflated.payload[0] );
+   auto deflatedLength = &deflatedBsbLength[count];
+   auto out = reinterpret_cast<Bytef *>( &deflatedLength[count] );
+
+   // Only worth it if the deflated packet is shorter
+   unsigned length = sizeof( DataPacketHeader ) + 4 * count;
+
+   for ( unsigned i = 0; i < count; i++ )
+   {
+      if ( length >= packetLength )
+      {
+         return 0;
+      }
+
+      const unsigned byteCount = bsbLength[i];
+      const unsigned available = packetLength - length;
+
+      deflatedBsbLength[i] = bsbLength[i];
+
+      // Deflating fails if it doesn't make the buffer smaller, so then store it as is
+      uLongf outLength = std::min( byteCount, available ) - 1;
+
+      if ( ( byteCount == 0 ) ||
+           ( compress2( out, &outLength, in, byteCount, level ) != Z_OK ) )
+      {
+         if ( byteCount >= available )
+         {
+            return 0;
+         }
+
+         memcpy( out, in, byteCount );
+         outLength = byteCount;
+      }
+
+      deflatedLength[i] = static_cast<uint16_t>( outLength );
+
+      in += byteCount;
+      out += outLength;
+      length += static_cast<unsigned>( outLength );
+   }
+
+   // Pad to a multiple of 4
+   while ( length % 4 )
+   {
+      *out++ = 0;
+      length++;
+   }
+
+   if ( length >= packetLength )
+   {
+      return 0;
+   }
+
+   deflated.header.packetFlags =
+      static_cast<uint8_t>( header.packetFlags | DATA_PACKET_DEFLATED );
+   deflated.header.packetLogicalLengthMinus1 = static_cast<uint16_t>( length - 1 );
+   deflated.header.bytestreamCount = header.bytestreamCount;
+
+   return length;
+#else
+   (void)packetLength;
+   (void)level;
+   (void)deflated;
+
+   throw E57_EXCEPTION2( ErrorNotImplemented, "E57_WITH_ZLIB" );
+#endif
+}
+
+void DataPacket::inflate( unsigned packetLength )
+{
+#ifdef E57_WITH_ZLIB
+   const unsigned count = header.bytestreamCount;
+
+   auto bsbLength = reinterpret_cast<const uint16_t *>( &payload[0] );
+   auto deflatedLength = &bsbLength[count];
+
+   // Check the packet holds what the lengths say it does
+   unsigned inflatedTotal = 0;
+   unsigned deflatedTotal = 0;
+
+   for ( unsigned i = 0; i < count; i++ )
+   {
+      if ( deflatedLength[i] > bsbLength[i] )
+      {
+         throw E57_EXCEPTION2( ErrorBadCVPacket, "bytestreamNumber=" + toString( i ) +
+                                                    " deflatedLength=" +
+                                                    toString( deflatedLength[i] ) );
+      }
+
+      inflatedTotal += bsbLength[i];
+      deflatedTotal += deflatedLength[i];
+   }
+
+   const unsigned needed = sizeof( DataPacketHeader ) + 4 * count + deflatedTotal;
+
+   if ( needed > packetLength || needed + 3 < packetLength )
+   {
+      throw E57_EXCEPTION2( ErrorBadCVPacket, "needed=" + toString( needed ) +
+                                                 " packetLength=" + toString( packetLength ) );
+   }
+
+   if ( sizeof( DataPacketHeader ) + 2 * count + inflatedTotal > DATA_PACKET_MAX )
+   {
+      throw E57_EXCEPTION2( ErrorBadCVPacket, "inflatedTotal=" + toString( inflatedTotal ) );
+   }
+
+   // The buffers are inflated over the compressed lengths and data, so move those out of the way
+   thread_local std::vector<char> deflatedBuffers;
+
+   auto deflatedStart = reinterpret_cast<const char *>( deflatedLength );
+   deflatedBuffers.assign( deflatedStart, deflatedStart + 2 * count + deflatedTotal );
+
+   deflatedLength = reinterpret_cast<const uint16_t *>( deflatedBuffers.data() );
+
+   auto in = reinterpret_cast<const Bytef *>( &deflatedLength[count] );
+   auto out = reinterpret_cast<Bytef *>( &payload[2 * count] );
+
+   for ( unsigned i = 0; i < count; i++ )
+   {
+      const unsigned byteCount = bsbLength[i];
+
+      if ( deflatedLength[i] == byteCount )
+      {
+         memcpy( out, in, byteCount );
+      }
+      else
+      {
+         uLongf outLength = byteCount;
+
+         if ( ( uncompress( out, &outLength, in, deflatedLength[i] ) != Z_OK ) ||
+              ( outLength != byteCount ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "bytestreamNumber=" + toString( i ) );
+         }
+      }
+
+      in += deflatedLength[i];
+      out += byteCount;
+   }
+#else
+   (void)packetLength;
+
+   const unsigned flags = header.packetFlags;
+
+   throw E57_EXCEPTION2( ErrorBadCVPacket,
+                         "packetFlags=" + toString( flags ) + " (built without E57_WITH_ZLIB)" );
+#endif
+}
+
+bool DataPacket::deflateAvailable()
+{
+#ifdef E57_WITH_ZLIB
+   return true;
+#else
+   return false;
+#endif
+}
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
 void DataPacket::dump( int indent, std::ostream &os ) const
 {
@@ -551,14 +1091,9 @@ void DataPacket::dump( int indent, std::ostream &os ) const
 //=============================================================================
 // IndexPacket
 
-void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount,
-                          uint64_t fileSize ) const
+void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount, uint64_t fileSize,
+                          ValidationLevel level ) const
 {
-#if ( E57_VALIDATION_LEVEL < VALIDATION_DEEP )
-   UNUSED( totalRecordCount );
-   UNUSED( fileSize );
-#endif
-
    //??? do all packets need versions?  how extend without breaking older
    // checking?  need to check
    // file version#?
@@ -571,7 +1106,7 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount,
 
    // Check packetLength is at least large enough to hold header
    unsigned packetLength = packetLogicalLengthMinus1 + 1;
-   if ( packetLength < sizeof( *this ) )
+   if ( packetLength < HEADER_SIZE )
    {
       throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( packetLength ) );
    }
@@ -628,14 +1163,18 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount,
    }
 
    // Check if entries will fit in space provided
-   unsigned neededLength = 16 + 8 * entryCount;
+   unsigned neededLength = HEADER_SIZE + sizeof( IndexPacketEntry ) * entryCount;
    if ( packetLength < neededLength )
    {
       throw E57_EXCEPTION2( ErrorBadCVPacket, "packetLength=" + toString( packetLength ) +
                                                  " neededLength=" + toString( neededLength ) );
    }
 
-#if VALIDATE_DEEP
+   if ( level < ValidationDeep )
+   {
+      return;
+   }
+
    // Verify padding at end is zero.
    const char *p = reinterpret_cast<const char *>( this );
    for ( unsigned i = neededLength; i < packetLength; i++ )
@@ -685,7 +1224,6 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount,
                " currentChunkPhysicalOffset=" + toString( entries[i].chunkPhysicalOffset ) );
       }
    }
-#endif
 }
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
@@ -27,10 +27,16 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "Common.h"
+#include "IOBuffer.h"
+#include "MemoryUsage.h"
 
 namespace e57
 {
@@ -48,13 +54,65 @@ namespace e57
    // Maximum size of CompressedVector binary data packet
    constexpr int DATA_PACKET_MAX = ( 64 * 1024 );
 
+   // Set in the packetFlags of a data packet whose bytestream buffers are compressed with deflate
+   // (see DEFLATE_CODEC_URI). Its bytestreamBufferLength array holds the uncompressed lengths. It
+   // is followed by the compressed length of each buffer, and then the compressed buffers. A
+   // buffer whose compressed length equals its length is stored as is. These packets are inflated
+   // as they are read, so in memory they may be longer than packetLogicalLengthMinus1 + 1.
+   constexpr uint8_t DATA_PACKET_DEFLATED = 0x80;
+
+   // Default size at which the writer sends a data packet. Efficient packet length is >= 75% of
+   // maximum packet length.
+#ifdef E57_WRITE_CRAZY_PACKET_MODE
+   //??? depends on number of streams
+   constexpr unsigned DATA_PACKET_DEFAULT_TARGET = 500;
+#else
+   constexpr unsigned DATA_PACKET_DEFAULT_TARGET = ( DATA_PACKET_MAX * 3 / 4 );
+#endif
+
+   // Default number of packets in an ImageFile's packet cache
+   constexpr unsigned PACKET_CACHE_DEFAULT_COUNT = 32;
+
+   // Number of packets read ahead of the ones being decoded when reading a CompressedVector
+   constexpr unsigned PACKET_PREFETCH_COUNT = 4;
+
+   // Number of bytes of a CompressedVector section the OS is told we will need soon, when access
+   // hints are enabled (see CheckedFile::setAccessHints())
+   constexpr uint64_t READ_AHEAD_HINT_SIZE = 16 * 1024 * 1024;
+
+   /// @brief Cache of CompressedVector packets read from a file.
+   /// @details One of these is shared by all the readers of an ImageFile. It may be used from
+   /// several threads. Packets stay in the cache while they are locked.
    class PacketReadCache
    {
    public:
       PacketReadCache( CheckedFile *cFile, unsigned packetCount );
+      ~PacketReadCache();
+
+      PacketReadCache( const PacketReadCache & ) = delete;
+      PacketReadCache &operator=( const PacketReadCache & ) = delete;
+
+      /// Read ahead of the packets which are locked. Once a packet is locked, up to packetCount
+      /// of the packets following it are read and verified on a background thread so they are
+      /// ready when they are needed.
+      void enablePrefetch( unsigned packetCount );
 
+      /// Set how thoroughly the packets are verified once they have been read. This must be set
+      /// before any packets are locked.
+      void setValidationLevel( ValidationLevel level );
+
+      /// Tell the cache a reader of the section ending at sectionEndLogicalOffset has opened
+      /// (or closed). It only reads ahead while the open readers are all in one section, since
+      /// readers of several sections would keep throwing away what was read for the others.
+      void addSectionReader( uint64_t sectionEndLogicalOffset );
+      void removeSectionReader( uint64_t sectionEndLogicalOffset );
+
+      /// Lock the packet at packetLogicalOffset into the cache (reading it if necessary).
+      /// @param [in] sectionEndLogicalOffset if not 0, the end of the section the packet is in,
+      /// which limits how far we read ahead
       std::unique_ptr<PacketLock> lock( uint64_t packetLogicalOffset,
-                                        char *&pkt ); //??? pkt could be const
+                                        char *&pkt, //??? pkt could be const
+                                        uint64_t sectionEndLogicalOffset = 0 );
 
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout );
@@ -66,20 +124,80 @@ namespace e57
       // Only PacketLock can unlock the cache
       void unlock( unsigned cacheIndex );
 
+      void touch( unsigned cacheIndex );
+
       void readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset );
+      unsigned fetchPacket( uint64_t packetLogicalOffset, char *buffer );
+
+      bool takePrefetchedPacket( unsigned oldestEntry, uint64_t packetLogicalOffset );
+      void schedulePrefetch( uint64_t packetLogicalOffset, unsigned packetLength,
+                             uint64_t sectionEndLogicalOffset, bool restart );
+      void prefetchPackets();
 
       struct CacheEntry
       {
-         uint64_t logicalOffset_ = 0;
-         char buffer_[DATA_PACKET_MAX]; // No need to init since it's a data buffer
-         unsigned lastUsed_ = 0;
+         uint64_t logicalOffset_ = 0; // 0 if this entry is empty
+
+         // Number of PacketLocks on this entry. It can't be reused while this is non-zero.
+         unsigned lockCount_ = 0;
+
+         // Set while the reader which locked it first reads the packet (without mutex_)
+         bool loading_ = false;
+
+         // Neighbours in the circular LRU list (see newest_)
+         unsigned newer_ = 0;
+         unsigned older_ = 0;
+
+         char *buffer_ = nullptr; // DATA_PACKET_MAX bytes of entryBuffers_
       };
 
-      unsigned lockCount_ = 0;
-      unsigned useCount_ = 0;
       CheckedFile *cFile_ = nullptr;
 
+      ValidationLevel validationLevel_ = ValidationBasic;
+
+      // Guards the entries and their index. It isn't held while packets are read, so readers
+      // of a packet being read by someone else wait on entryCondition_ instead.
+      std::mutex mutex_;
+      std::condition_variable entryCondition_;
+
       std::vector<CacheEntry> entries_;
+      IOBuffer entryBuffers_; // from the file's BufferAllocator
+
+      // Index into entries_ of each packet offset in the cache
+      std::unordered_map<uint64_t, unsigned> index_;
+
+      // All entries are kept in a circular list in order of use. This is the most recently used;
+      // the one after it (entries_[newest_].newer_) is the least recently used.
+      unsigned newest_ = 0;
+
+      // Counts the entries, and the buffers of prefetched_, in the file's memory usage
+      MemoryReservation memory_;
+      MemoryReservation prefetchMemory_;
+
+      // Packets read ahead by the background task. They are moved into entries_ when locked.
+      struct PrefetchEntry
+      {
+         uint64_t logicalOffset_ = 0; // 0 if this entry is free
+         unsigned length_ = 0;
+         char *buffer_ = nullptr; // DATA_PACKET_MAX bytes of prefetchBuffers_
+      };
+
+      // Everything below is shared with the background task and guarded by prefetchMutex_
+      std::mutex prefetchMutex_;
+      std::condition_variable prefetchCondition_;
+      std::vector<PrefetchEntry> prefetched_;
+      IOBuffer prefetchBuffers_;
+      uint64_t prefetchEndLogicalOffset_ = 0;
+      uint64_t prefetchFrontier_ = 0;          // end of the furthest packet locked so far
+      uint64_t nextPrefetchLogicalOffset_ = 0; // next packet the background task will read
+      uint64_t loadingLogicalOffset_ = 0;      // packet the background task is reading now
+      unsigned prefetchGeneration_ = 0;        // changed whenever read-ahead is restarted
+      bool prefetchRunning_ = false;
+      bool prefetchStopping_ = false;
+      std::future<void> prefetchTask_;
+
+      // Number of open readers of each section, by the end of the section
+      std::unordered_map<uint64_t, unsigned> sectionReaders_;
    };
 
    class PacketLock
@@ -120,6 +238,20 @@ namespace e57
       uint16_t bytestreamCount = 0;
    };
 
+   struct EmptyPacketHeader
+   {
+      const uint8_t packetType = EMPTY_PACKET;
+
+      uint8_t reserved1 = 0; // must be zero
+      uint16_t packetLogicalLengthMinus1 = 0;
+
+      void verify( unsigned bufferLength = 0 ) const; //???use
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const;
+#endif
+   };
+
    class DataPacket
    {
    public:
@@ -129,6 +261,18 @@ namespace e57
       char *getBytestream( unsigned bytestreamNumber, unsigned &byteCount );
       unsigned getBytestreamBufferLength( unsigned bytestreamNumber );
 
+      /// Compress the bytestream buffers of this packet (of packetLength bytes) into deflated.
+      /// @returns the length of the deflated packet, or 0 if it wouldn't be shorter
+      /// @throw ::ErrorNotImplemented if the library was built without zlib
+      unsigned deflate( unsigned packetLength, int level, DataPacket &deflated ) const;
+
+      /// Expand a packet read with DATA_PACKET_DEFLATED set (of packetLength bytes) in place.
+      /// @throw ::ErrorBadCVPacket
+      void inflate( unsigned packetLength );
+
+      /// @returns true if the library was built with zlib, so deflate() and inflate() work
+      static bool deflateAvailable();
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
 #endif
@@ -139,4 +283,35 @@ namespace e57
 
       uint8_t payload[PayloadSize]; // No need to init since it's a data buffer
    };
+
+   struct IndexPacket
+   {
+      static constexpr unsigned MAX_ENTRIES = 2048;
+
+      // Size of the fields before entries. A packet only needs room for entryCount entries.
+      static constexpr unsigned HEADER_SIZE = 16;
+
+      const uint8_t packetType = INDEX_PACKET;
+
+      uint8_t packetFlags = 0; // flag bitfields
+      uint16_t packetLogicalLengthMinus1 = 0;
+      uint16_t entryCount = 0;
+      uint8_t indexLevel = 0;
+      uint8_t reserved1[9] = {}; // must be zero
+
+      struct IndexPacketEntry
+      {
+         uint64_t chunkRecordNumber = 0;
+         uint64_t chunkPhysicalOffset = 0;
+      } entries[MAX_ENTRIES];
+
+      /// With ValidationDeep, also check the padding and that the entries are in order (and
+      /// within totalRecordCount and fileSize if they aren't 0).
+      void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0,
+                   uint64_t fileSize = 0, ValidationLevel level = ValidationBasic ) const;
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+      void dump( int indent = 0, std::ostream &os = std::cout ) const;
+#endif
+   };
 }
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+
+#include "PacketSpool.h"
+#include "StringFunctions.h"
+
+namespace e57
+{
+   // Size of the blocks read back from the temporary file
+   constexpr size_t SPOOL_BLOCK_SIZE = 1024 * 1024;
+
+   PacketSpool::PacketSpool() : file_( std::tmpfile() )
+   {
+      // Keeping the packets in memory instead could take any amount of it
+      if ( file_ == nullptr )
+      {
+         throw E57_EXCEPTION2( ErrorOpenFailed, "tmpfile errno=" + toString( errno ) );
+      }
+   }
+
+   PacketSpool::~PacketSpool()
+   {
+      std::fclose( file_ );
+   }
+
+   void PacketSpool::append( const char *data, size_t length )
+   {
+      if ( std::fwrite( data, 1, length, file_ ) != length )
+      {
+         throw E57_EXCEPTION2( ErrorWriteFailed,
+                               "spoolSize=" + toString( size_ ) + " length=" + toString( length ) );
+      }
+
+      size_ += length;
+   }
+
+   void PacketSpool::readBack(
+      const std::function<void( const char *data, size_t length )> &consume )
+   {
+      std::rewind( file_ );
+
+      std::unique_ptr<char[]> block( new char[SPOOL_BLOCK_SIZE] );
+      uint64_t remaining = size_;
+
+      while ( remaining > 0 )
+      {
+         const auto length =
+            static_cast<size_t>( std::min<uint64_t>( remaining, SPOOL_BLOCK_SIZE ) );
+
+         if ( std::fread( block.get(), 1, length, file_ ) != length )
+         {
+            throw E57_EXCEPTION2( ErrorReadFailed, "spoolSize=" + toString( size_ ) +
+                                                      " remaining=" + toString( remaining ) );
+         }
+
+         consume( block.get(), length );
+         remaining -= length;
+      }
+
+      // Further packets go after these
+      if ( std::fseek( file_, 0, SEEK_END ) != 0 )
+      {
+         throw E57_EXCEPTION2( ErrorSeekFailed, "spoolSize=" + toString( size_ ) );
+      }
+   }
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// @brief Data packets held back until they can be copied into the file.
+   /// @details The packets go to a temporary file. They are read back in order, the way they
+   /// were appended.
+   class PacketSpool
+   {
+   public:
+      /// @throw ::ErrorOpenFailed if the temporary file can't be created
+      PacketSpool();
+      ~PacketSpool();
+
+      PacketSpool( const PacketSpool & ) = delete;
+      PacketSpool &operator=( const PacketSpool & ) = delete;
+
+      /// Number of bytes appended so far
+      uint64_t size() const
+      {
+         return size_;
+      }
+
+      void append( const char *data, size_t length );
+
+      /// Call consume( data, length ) for everything appended, in order, a block at a time
+      void readBack( const std::function<void( const char *data, size_t length )> &consume );
+
+   private:
+      std::FILE *file_ = nullptr;
+      uint64_t size_ = 0;
+   };
+}
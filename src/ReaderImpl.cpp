@@ -26,62 +26,185 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
 #include "ReaderImpl.h"
+#include "CheckedFile.h"
 #include "Common.h"
+#include "CompressedVectorNodeImpl.h"
+#include "CompressedVectorReaderImpl.h"
+#include "ImageFileImpl.h"
 #include "StringFunctions.h"
+#include "ThreadPool.h"
+#include "VectorNodeImpl.h"
 
 namespace e57
 {
+   /// Read the pose of a Data3D or Image2D node, if it has one
+   void _readPose( const StructureNode &node, RigidBodyTransform &transform )
+   {
+      if ( !node.isDefined( "pose" ) )
+      {
+         return;
+      }
+
+      const StructureNode pose( node.get( "pose" ) );
+
+      if ( pose.isDefined( "rotation" ) )
+      {
+         const StructureNode rotation( pose.get( "rotation" ) );
+
+         transform.rotation.w = FloatNode( rotation.get( "w" ) ).value();
+         transform.rotation.x = FloatNode( rotation.get( "x" ) ).value();
+         transform.rotation.y = FloatNode( rotation.get( "y" ) ).value();
+         transform.rotation.z = FloatNode( rotation.get( "z" ) ).value();
+      }
+
+      if ( pose.isDefined( "translation" ) )
+      {
+         const StructureNode translation( pose.get( "translation" ) );
+
+         transform.translation.x = FloatNode( translation.get( "x" ) ).value();
+         transform.translation.y = FloatNode( translation.get( "y" ) ).value();
+         transform.translation.z = FloatNode( translation.get( "z" ) ).value();
+      }
+   }
+
+   /// Apply a rigid body transform to points, in double precision
+   template <typename COORDTYPE>
+   void _transformPoints( const RigidBodyTransform &transform, COORDTYPE *x, COORDTYPE *y,
+                          COORDTYPE *z, size_t count )
+   {
+      // Rotation matrix of the (normalized) quaternion
+      const Quaternion &q = transform.rotation;
+      const double cNorm = q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+      const double s = ( cNorm > 0.0 ) ? 2.0 / cNorm : 0.0;
+
+      const double r00 = 1.0 - s * ( q.y * q.y + q.z * q.z );
+      const double r01 = s * ( q.x * q.y - q.w * q.z );
+      const double r02 = s * ( q.x * q.z + q.w * q.y );
+      const double r10 = s * ( q.x * q.y + q.w * q.z );
+      const double r11 = 1.0 - s * ( q.x * q.x + q.z * q.z );
+      const double r12 = s * ( q.y * q.z - q.w * q.x );
+      const double r20 = s * ( q.x * q.z - q.w * q.y );
+      const double r21 = s * ( q.y * q.z + q.w * q.x );
+      const double r22 = 1.0 - s * ( q.x * q.x + q.y * q.y );
+
+      const Translation &t = transform.translation;
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double cX = x[i];
+         const double cY = y[i];
+         const double cZ = z[i];
+
+         x[i] = static_cast<COORDTYPE>( r00 * cX + r01 * cY + r02 * cZ + t.x );
+         y[i] = static_cast<COORDTYPE>( r10 * cX + r11 * cY + r12 * cZ + t.y );
+         z[i] = static_cast<COORDTYPE>( r20 * cX + r21 * cY + r22 * cZ + t.z );
+      }
+   }
+
+   /// @returns the buffer of the coordinate field name, or nullptr if it isn't a coordinate
+   template <typename COORDTYPE>
+   const COORDTYPE *_coordinateBuffer( const Data3DPointsData_t<COORDTYPE> &buffers,
+                                       const ustring &name )
+   {
+      const std::pair<const char *, const COORDTYPE *> coordinates[] = {
+         { "cartesianX", buffers.cartesianX },
+         { "cartesianY", buffers.cartesianY },
+         { "cartesianZ", buffers.cartesianZ },
+         { "sphericalRange", buffers.sphericalRange },
+         { "sphericalAzimuth", buffers.sphericalAzimuth },
+         { "sphericalElevation", buffers.sphericalElevation },
+      };
+
+      for ( const auto &coordinate : coordinates )
+      {
+         if ( name == coordinate.first )
+         {
+            return coordinate.second;
+         }
+      }
+
+      return nullptr;
+   }
+
+   /// @returns true if the points of a Data3D only have spherical coordinates
+   bool _convertsSphericalToCartesian( const StructureNode &proto )
+   {
+      return !proto.isDefined( "cartesianX" ) && !proto.isDefined( "cartesianY" ) &&
+             !proto.isDefined( "cartesianZ" ) && proto.isDefined( "sphericalRange" ) &&
+             proto.isDefined( "sphericalAzimuth" ) && proto.isDefined( "sphericalElevation" );
+   }
+
+   /// Compute cartesian coordinates from spherical ones. Any of x, y, and z may be null.
+   template <typename COORDTYPE>
+   void _sphericalToCartesian( const COORDTYPE *range, const COORDTYPE *azimuth,
+                               const COORDTYPE *elevation, COORDTYPE *x, COORDTYPE *y,
+                               COORDTYPE *z, size_t count )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double cRange = range[i];
+         const double cAzimuth = azimuth[i];
+         const double cElevation = elevation[i];
+         const double cProjected = cRange * std::cos( cElevation );
+
+         if ( x != nullptr )
+         {
+            x[i] = static_cast<COORDTYPE>( cProjected * std::cos( cAzimuth ) );
+         }
+
+         if ( y != nullptr )
+         {
+            y[i] = static_cast<COORDTYPE>( cProjected * std::sin( cAzimuth ) );
+         }
+
+         if ( z != nullptr )
+         {
+            z[i] = static_cast<COORDTYPE>( cRange * std::sin( cElevation ) );
+         }
+      }
+   }
+
    /*!
-   @brief Reads the data out of a given image node
+   @brief Finds the blob of an image node
 
    @param [in] image 1 of 3 projects or the visual
    @param [in] imageType identifies the image format desired.
-   @param [out] pBuffer pointer the buffer
-   @param [out] start position in the block to start reading
-   @param [out] count size of desired chunk or buffer size
 
-   @return number of bytes read
+   @return the blob, null if the image doesn't have one of imageType
    */
-   size_t _readImage2DNode( const StructureNode &image, Image2DType imageType, uint8_t *pBuffer,
-                            int64_t start, size_t count )
+   std::unique_ptr<BlobNode> _findImage2DBlob( const StructureNode &image, Image2DType imageType )
    {
-      size_t transferred = 0;
+      const char *blobName = nullptr;
 
       switch ( imageType )
       {
          case ImageNone:
-            return 0;
+            return nullptr;
 
          case ImageJPEG:
-            if ( image.isDefined( "jpegImage" ) )
-            {
-               BlobNode jpegImage( image.get( "jpegImage" ) );
-               jpegImage.read( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "jpegImage";
             break;
 
          case ImagePNG:
-            if ( image.isDefined( "pngImage" ) )
-            {
-               BlobNode pngImage( image.get( "pngImage" ) );
-               pngImage.read( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "pngImage";
             break;
 
          case ImageMaskPNG:
-            if ( image.isDefined( "imageMask" ) )
-            {
-               BlobNode imageMask( image.get( "imageMask" ) );
-               imageMask.read( pBuffer, start, count );
-               transferred = count;
-            }
+            blobName = "imageMask";
             break;
       }
 
-      return transferred;
+      if ( ( blobName == nullptr ) || !image.isDefined( blobName ) )
+      {
+         return nullptr;
+      }
+
+      return std::unique_ptr<BlobNode>( new BlobNode( image.get( blobName ) ) );
    }
 
    /*!
@@ -189,10 +312,41 @@ namespace e57
    }
 
    ReaderImpl::ReaderImpl( const ustring &filePath, const ReaderOptions &options ) :
-      imf_( filePath, "r", options.checksumPolicy ), root_( imf_.root() ),
+      ReaderImpl( ImageFile( filePath, "r", options.checksumPolicy, options.lazyLoad ), options )
+   {
+   }
+
+   ReaderImpl::ReaderImpl( std::shared_ptr<ImageFileIO> io, const ReaderOptions &options ) :
+      ReaderImpl( ImageFile( std::move( io ), "r", options.checksumPolicy, options.lazyLoad ),
+                  options )
+   {
+   }
+
+   ReaderImpl::ReaderImpl( const ImageFile &imf, const ReaderOptions &options ) :
+      imf_( imf ), root_( imf_.root() ),
       data3D_( root_.get( "/data3D" ) ),
-      images2D_( root_.isDefined( "/images2D" ) ? root_.get( "/images2D" ) : VectorNode( imf_ ) )
+      images2D_( root_.isDefined( "/images2D" ) ? root_.get( "/images2D" ) : VectorNode( imf_ ) ),
+      sphericalToCartesian_( options.sphericalToCartesian ), applyPose_( options.applyPose ),
+      decodedCacheDirectory_( options.decodedCacheDirectory )
    {
+      imf_.impl()->setTraceHandler( options.traceHandler );
+      imf_.impl()->setBufferAllocator( options.bufferAllocator );
+      imf_.impl()->setMemoryBudget( options.memoryBudget );
+      imf_.impl()->setExecutor( options.executor );
+      imf_.impl()->setChecksumThreadCount( options.checksumThreadCount );
+      imf_.impl()->setRangeReads( options.rangeReadSize, options.rangeReadsInFlight );
+      imf_.impl()->setDirectIO( options.directIO );
+      imf_.impl()->setAccessHints( options.accessHints );
+      imf_.impl()->setPacketCacheSize( options.packetCacheSize );
+      imf_.impl()->setDecodeThreadCount( options.decodeThreadCount );
+      imf_.impl()->setValidationLevel( options.validationLevel );
+
+      // The sidecars are only used while the file is as it was when they were made
+      if ( !decodedCacheDirectory_.empty() )
+      {
+         decodedCacheFileModified_ = DecodedCache::fileModified( imf_.fileName() );
+         decodedCacheXmlChecksum_ = imf_.impl()->xmlChecksum();
+      }
    }
 
    ReaderImpl::~ReaderImpl()
@@ -332,28 +486,7 @@ namespace e57
       }
 
       // Get pose structure for scan.
-      if ( image.isDefined( "pose" ) )
-      {
-         const StructureNode pose( image.get( "pose" ) );
-
-         if ( pose.isDefined( "rotation" ) )
-         {
-            const StructureNode rotation( pose.get( "rotation" ) );
-
-            image2DHeader.pose.rotation.w = FloatNode( rotation.get( "w" ) ).value();
-            image2DHeader.pose.rotation.x = FloatNode( rotation.get( "x" ) ).value();
-            image2DHeader.pose.rotation.y = FloatNode( rotation.get( "y" ) ).value();
-            image2DHeader.pose.rotation.z = FloatNode( rotation.get( "z" ) ).value();
-         }
-         if ( pose.isDefined( "translation" ) )
-         {
-            const StructureNode translation( pose.get( "translation" ) );
-
-            image2DHeader.pose.translation.x = FloatNode( translation.get( "x" ) ).value();
-            image2DHeader.pose.translation.y = FloatNode( translation.get( "y" ) ).value();
-            image2DHeader.pose.translation.z = FloatNode( translation.get( "z" ) ).value();
-         }
-      }
+      _readPose( image, image2DHeader.pose );
 
       if ( image.isDefined( "visualReferenceRepresentation" ) )
       {
@@ -552,65 +685,141 @@ namespace e57
    }
 
    // Reads the image data block
-   size_t ReaderImpl::ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
-                                       Image2DType imageType, uint8_t *pBuffer, int64_t start,
-                                       size_t count ) const
+   std::unique_ptr<BlobNode> ReaderImpl::findImage2DBlob( int64_t imageIndex,
+                                                          Image2DProjection imageProjection,
+                                                          Image2DType imageType ) const
    {
       if ( ( imageIndex < 0 ) || ( imageIndex >= images2D_.childCount() ) )
       {
-         return 0;
+         return nullptr;
       }
 
       const StructureNode image( images2D_.get( imageIndex ) );
 
+      const char *representationName = nullptr;
+
       switch ( imageProjection )
       {
          case ProjectionNone:
-            return 0;
+            return nullptr;
 
          case ProjectionVisual:
-            if ( image.isDefined( "visualReferenceRepresentation" ) )
-            {
-               const StructureNode visualReferenceRepresentation(
-                  image.get( "visualReferenceRepresentation" ) );
-
-               return _readImage2DNode( visualReferenceRepresentation, imageType, pBuffer, start,
-                                        count );
-            }
+            representationName = "visualReferenceRepresentation";
             break;
 
          case ProjectionPinhole:
-            if ( image.isDefined( "pinholeRepresentation" ) )
-            {
-               const StructureNode pinholeRepresentation( image.get( "pinholeRepresentation" ) );
-
-               return _readImage2DNode( pinholeRepresentation, imageType, pBuffer, start, count );
-            }
+            representationName = "pinholeRepresentation";
             break;
 
          case ProjectionSpherical:
-            if ( image.isDefined( "sphericalRepresentation" ) )
-            {
-               const StructureNode sphericalRepresentation(
-                  image.get( "sphericalRepresentation" ) );
-
-               return _readImage2DNode( sphericalRepresentation, imageType, pBuffer, start, count );
-            }
+            representationName = "sphericalRepresentation";
             break;
 
          case ProjectionCylindrical:
-            if ( image.isDefined( "cylindricalRepresentation" ) )
-            {
-               const StructureNode cylindricalRepresentation(
-                  image.get( "cylindricalRepresentation" ) );
-
-               return _readImage2DNode( cylindricalRepresentation, imageType, pBuffer, start,
-                                        count );
-            }
+            representationName = "cylindricalRepresentation";
             break;
       }
 
-      return 0;
+      if ( ( representationName == nullptr ) || !image.isDefined( representationName ) )
+      {
+         return nullptr;
+      }
+
+      return _findImage2DBlob( StructureNode( image.get( representationName ) ), imageType );
+   }
+
+   size_t ReaderImpl::ReadImage2DData( int64_t imageIndex, Image2DProjection imageProjection,
+                                       Image2DType imageType, uint8_t *pBuffer, int64_t start,
+                                       size_t count ) const
+   {
+      const std::unique_ptr<BlobNode> blob =
+         findImage2DBlob( imageIndex, imageProjection, imageType );
+
+      if ( blob == nullptr )
+      {
+         return 0;
+      }
+
+      blob->read( pBuffer, start, count );
+
+      return count;
+   }
+
+   BlobView ReaderImpl::GetImage2DView( int64_t imageIndex, Image2DProjection imageProjection,
+                                        Image2DType imageType ) const
+   {
+      const std::unique_ptr<BlobNode> blob =
+         findImage2DBlob( imageIndex, imageProjection, imageType );
+
+      if ( blob == nullptr )
+      {
+         return {};
+      }
+
+      return blob->view( 0, static_cast<size_t>( blob->byteCount() ) );
+   }
+
+   bool ReaderImpl::ReadImage2DDataParallel( std::vector<Image2DRead> &reads,
+                                             unsigned int threadCount ) const
+   {
+      // Looking up the nodes isn't thread safe, so the blobs are found here
+      std::vector<std::unique_ptr<BlobNode>> blobs;
+      blobs.reserve( reads.size() );
+
+      for ( Image2DRead &read : reads )
+      {
+         read.transferred = 0;
+
+         if ( read.count < 0 )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "imageIndex=" + toString( read.imageIndex ) +
+                                                          " count=" + toString( read.count ) );
+         }
+
+         blobs.push_back(
+            findImage2DBlob( read.imageIndex, read.imageProjection, read.imageType ) );
+      }
+
+      if ( reads.empty() )
+      {
+         return true;
+      }
+
+      // The file is open for reading, so its blobs can be read by several threads at once
+      auto readImage = [&]( size_t i ) {
+         Image2DRead &read = reads[i];
+
+         if ( blobs[i] != nullptr )
+         {
+            blobs[i]->read( static_cast<uint8_t *>( read.buffer ), read.start,
+                            static_cast<size_t>( read.count ) );
+            read.transferred = read.count;
+         }
+      };
+
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( imf_.impl()->executor() );
+      }
+
+      const size_t workerCount = std::min<size_t>( threadCount, reads.size() ) - 1;
+
+      if ( workerCount > 0 )
+      {
+         // The calling thread reads too
+         ThreadPool pool( workerCount, imf_.impl()->executor() );
+
+         pool.parallelFor( reads.size(), readImage );
+      }
+      else
+      {
+         for ( size_t i = 0; i < reads.size(); ++i )
+         {
+            readImage( i );
+         }
+      }
+
+      return true;
    }
 
    bool ReaderImpl::ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const
@@ -849,28 +1058,12 @@ namespace e57
       }
 
       // Get pose structure from scan.
-      if ( scan.isDefined( "pose" ) )
-      {
-         const StructureNode pose( scan.get( "pose" ) );
+      _readPose( scan, data3DHeader.pose );
 
-         if ( pose.isDefined( "rotation" ) )
-         {
-            const StructureNode rotation( pose.get( "rotation" ) );
-
-            data3DHeader.pose.rotation.w = FloatNode( rotation.get( "w" ) ).value();
-            data3DHeader.pose.rotation.x = FloatNode( rotation.get( "x" ) ).value();
-            data3DHeader.pose.rotation.y = FloatNode( rotation.get( "y" ) ).value();
-            data3DHeader.pose.rotation.z = FloatNode( rotation.get( "z" ) ).value();
-         }
-
-         if ( pose.isDefined( "translation" ) )
-         {
-            const StructureNode translation( pose.get( "translation" ) );
-
-            data3DHeader.pose.translation.x = FloatNode( translation.get( "x" ) ).value();
-            data3DHeader.pose.translation.y = FloatNode( translation.get( "y" ) ).value();
-            data3DHeader.pose.translation.z = FloatNode( translation.get( "z" ) ).value();
-         }
+      // The points are given in the file's coordinates
+      if ( applyPose_ )
+      {
+         data3DHeader.pose = RigidBodyTransform::identity();
       }
 
       // Get start/stop acquisition times from scan.
@@ -1035,6 +1228,15 @@ namespace e57
       data3DHeader.pointFields.sphericalInvalidStateField =
          proto.isDefined( "sphericalInvalidState" );
 
+      if ( sphericalToCartesian_ && _convertsSphericalToCartesian( proto ) )
+      {
+         data3DHeader.pointFields.cartesianXField = true;
+         data3DHeader.pointFields.cartesianYField = true;
+         data3DHeader.pointFields.cartesianZField = true;
+         data3DHeader.pointFields.cartesianInvalidStateField =
+            data3DHeader.pointFields.sphericalInvalidStateField;
+      }
+
       data3DHeader.pointFields.angleMinimum = 0.0;
       data3DHeader.pointFields.angleMaximum = 0.0;
 
@@ -1558,14 +1760,57 @@ namespace e57
       return true;
    }
 
+   bool ReaderImpl::GetData3DScaling( int64_t dataIndex, const ustring &fieldName, double &scale,
+                                      double &offset ) const
+   {
+      if ( ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) )
+      {
+         return false;
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      const StructureNode proto( CompressedVectorNode( scan.get( "points" ) ).prototype() );
+
+      // The normals are the one extension field of Data3DPointsData_t
+      ustring name = fieldName;
+
+      if ( ( name == "normalX" ) || ( name == "normalY" ) || ( name == "normalZ" ) )
+      {
+         name = "nor:" + name;
+      }
+
+      if ( !proto.isDefined( name ) || ( proto.get( name ).type() != TypeScaledInteger ) )
+      {
+         return false;
+      }
+
+      const ScaledIntegerNode field( proto.get( name ) );
+
+      scale = field.scale();
+      offset = field.offset();
+
+      return true;
+   }
+
    template <typename COORDTYPE>
    CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
       int64_t dataIndex, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers ) const
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
+      const StructureNode scan( data3D_.get( dataIndex ) );
+
+      return setUpPointsReader( dataIndex, CompressedVectorNode( scan.get( "points" ) ), count,
+                                buffers );
+   }
+
+   template <typename COORDTYPE>
+   CompressedVectorReader ReaderImpl::setUpPointsReader(
+      int64_t dataIndex, CompressedVectorNode points, size_t count,
+      const Data3DPointsData_t<COORDTYPE> &buffers ) const
+   {
+      // int32_t coordinates are the raw integers of ScaledIntegers
+      constexpr bool cRawCoordinates = std::is_integral<COORDTYPE>::value;
 
       const StructureNode scan( data3D_.get( dataIndex ) );
-      CompressedVectorNode points( scan.get( "points" ) );
       const StructureNode proto( points.prototype() );
       const int64_t protoCount = proto.childCount();
       std::vector<SourceDestBuffer> destBuffers;
@@ -1575,6 +1820,14 @@ namespace e57
          const ustring name = proto.get( protoIndex ).elementName();
          const NodeType type = proto.get( protoIndex ).type();
          const bool scaled = ( type == TypeScaledInteger );
+         const bool coordinateScaled = scaled && !cRawCoordinates;
+
+         if ( cRawCoordinates && !scaled && ( _coordinateBuffer( buffers, name ) != nullptr ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "field is not a ScaledInteger fieldName=" + name +
+                                     " dataIndex=" + toString( dataIndex ) );
+         }
 
          // E57_EXT_surface_normals
          ustring norExtUri;
@@ -1583,17 +1836,20 @@ namespace e57
          if ( ( name == "cartesianX" ) && proto.isDefined( "cartesianX" ) &&
               ( buffers.cartesianX != nullptr ) )
          {
-            destBuffers.emplace_back( imf_, "cartesianX", buffers.cartesianX, count, true, scaled );
+            destBuffers.emplace_back( imf_, "cartesianX", buffers.cartesianX, count, true,
+                                      coordinateScaled );
          }
          else if ( ( name == "cartesianY" ) && proto.isDefined( "cartesianY" ) &&
                    ( buffers.cartesianY != nullptr ) )
          {
-            destBuffers.emplace_back( imf_, "cartesianY", buffers.cartesianY, count, true, scaled );
+            destBuffers.emplace_back( imf_, "cartesianY", buffers.cartesianY, count, true,
+                                      coordinateScaled );
          }
          else if ( ( name == "cartesianZ" ) && proto.isDefined( "cartesianZ" ) &&
                    ( buffers.cartesianZ != nullptr ) )
          {
-            destBuffers.emplace_back( imf_, "cartesianZ", buffers.cartesianZ, count, true, scaled );
+            destBuffers.emplace_back( imf_, "cartesianZ", buffers.cartesianZ, count, true,
+                                      coordinateScaled );
          }
          else if ( ( name == "cartesianInvalidState" ) &&
                    proto.isDefined( "cartesianInvalidState" ) &&
@@ -1606,19 +1862,21 @@ namespace e57
                    ( buffers.sphericalRange != nullptr ) )
          {
             destBuffers.emplace_back( imf_, "sphericalRange", buffers.sphericalRange, count, true,
-                                      scaled );
+                                      coordinateScaled );
          }
          else if ( ( name == "sphericalAzimuth" ) && proto.isDefined( "sphericalAzimuth" ) &&
                    ( buffers.sphericalAzimuth != nullptr ) )
          {
             destBuffers.emplace_back( imf_, "sphericalAzimuth", buffers.sphericalAzimuth, count,
-                                      true, scaled );
+                                      true,
+                                      coordinateScaled );
          }
          else if ( ( name == "sphericalElevation" ) && proto.isDefined( "sphericalElevation" ) &&
                    ( buffers.sphericalElevation != nullptr ) )
          {
             destBuffers.emplace_back( imf_, "sphericalElevation", buffers.sphericalElevation, count,
-                                      true, scaled );
+                                      true,
+                                      coordinateScaled );
          }
          else if ( ( name == "sphericalInvalidState" ) &&
                    proto.isDefined( "sphericalInvalidState" ) &&
@@ -1706,41 +1964,1346 @@ namespace e57
          }
       }
 
+      CompressedVectorReaderImpl::RecordsReadHandler handler;
+
+      // Raw coordinates are returned as they are stored
+      if ( !cRawCoordinates && sphericalToCartesian_ && _convertsSphericalToCartesian( proto ) &&
+           ( ( buffers.cartesianX != nullptr ) || ( buffers.cartesianY != nullptr ) ||
+             ( buffers.cartesianZ != nullptr ) || ( buffers.cartesianInvalidState != nullptr ) ) )
+      {
+         handler = sphericalToCartesianHandler( proto, count, buffers, destBuffers );
+      }
+
+      RigidBodyTransform pose;
+      _readPose( scan, pose );
+
+      if ( !cRawCoordinates && applyPose_ && ( pose != RigidBodyTransform::identity() ) &&
+           ( ( buffers.cartesianX != nullptr ) || ( buffers.cartesianY != nullptr ) ||
+             ( buffers.cartesianZ != nullptr ) ) )
+      {
+         if ( ( buffers.cartesianX == nullptr ) || ( buffers.cartesianY == nullptr ) ||
+              ( buffers.cartesianZ == nullptr ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "applyPose needs all cartesian coordinates dataIndex=" +
+                                     toString( dataIndex ) );
+         }
+
+         COORDTYPE *x = buffers.cartesianX;
+         COORDTYPE *y = buffers.cartesianY;
+         COORDTYPE *z = buffers.cartesianZ;
+
+         // Transform the points once they are in cartesian coordinates
+         const auto convert = handler;
+
+         handler = [=]( unsigned recordCount ) {
+            if ( convert )
+            {
+               convert( recordCount );
+            }
+
+            _transformPoints( pose, x, y, z, recordCount );
+         };
+      }
+
       CompressedVectorReader reader = points.reader( destBuffers );
 
+      if ( handler )
+      {
+         reader.impl()->setRecordsReadHandler( handler );
+      }
+
       return reader;
    }
 
-   int64_t ReaderImpl::GetData3DCount() const
+   void ReaderImpl::RestartData3DPointsData( int64_t dataIndex,
+                                             CompressedVectorReader &reader ) const
    {
-      return data3D_.childCount();
-   }
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
 
-   StructureNode ReaderImpl::GetRawE57Root() const
-   {
-      return root_;
-   }
+      // The transform done by the reader is that of the scan it was set up for
+      if ( applyPose_ )
+      {
+         const StructureNode readerScan( reader.compressedVectorNode().parent() );
 
-   VectorNode ReaderImpl::GetRawData3D() const
-   {
-      return data3D_;
-   }
+         RigidBodyTransform readerPose;
+         _readPose( readerScan, readerPose );
 
-   VectorNode ReaderImpl::GetRawImages2D() const
-   {
-      return images2D_;
+         RigidBodyTransform pose;
+         _readPose( scan, pose );
+
+         if ( pose != readerPose )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "applyPose needs the same pose dataIndex=" +
+                                     toString( dataIndex ) );
+         }
+      }
+
+      reader.restart( points );
    }
 
-   ImageFile ReaderImpl::GetRawIMF() const
+   bool ReaderImpl::ReadData3DZones( int64_t dataIndex, std::vector<Data3DZone> &zones ) const
    {
-      return imf_;
-   }
+      zones.clear();
 
-   // Explicit template instantiation
-   template CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
-      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<float> &buffers ) const;
+      const StructureNode scan( data3D_.get( dataIndex ) );
 
-   template CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
-      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<double> &buffers ) const;
+      ustring prefix;
+
+      if ( !imf_.extensionsLookupUri( ZONE_MAP_URI, prefix ) ||
+           !scan.isDefined( prefix + ":zoneMap" ) )
+      {
+         return false;
+      }
+
+      const StructureNode zoneMap( scan.get( prefix + ":zoneMap" ) );
+      const int64_t zonePointCount = IntegerNode( zoneMap.get( "pointCount" ) ).value();
+      CompressedVectorNode zonesNode( zoneMap.get( "zones" ) );
+      const StructureNode proto( zonesNode.prototype() );
+
+      const int64_t pointCount = CompressedVectorNode( scan.get( "points" ) ).childCount();
+      const auto zoneCount = static_cast<size_t>( zonesNode.childCount() );
+
+      if ( ( zonePointCount <= 0 ) ||
+           ( ( pointCount + zonePointCount - 1 ) / zonePointCount !=
+             static_cast<int64_t>( zoneCount ) ) )
+      {
+         throw E57_EXCEPTION2( ErrorValueOutOfBounds,
+                               "dataIndex=" + toString( dataIndex ) +
+                                  " zonePointCount=" + toString( zonePointCount ) +
+                                  " zoneCount=" + toString( zoneCount ) );
+      }
+
+      zones.resize( zoneCount );
+
+      std::vector<std::vector<double>> columns;
+      std::vector<SourceDestBuffer> destBuffers;
+
+      // Keep the columns from moving once buffers point at them
+      columns.reserve( 10 );
+
+      auto column = [&]( const char *name, std::vector<double> *&values ) {
+         values = nullptr;
+
+         if ( proto.isDefined( name ) )
+         {
+            columns.emplace_back( zoneCount );
+            values = &columns.back();
+            destBuffers.emplace_back( imf_, name, values->data(), zoneCount, true );
+         }
+      };
+
+      std::vector<double> *xMinimum, *xMaximum, *yMinimum, *yMaximum, *zMinimum, *zMaximum;
+      std::vector<double> *intensityMinimum, *intensityMaximum;
+      std::vector<double> *timeStampMinimum, *timeStampMaximum;
+
+      column( "xMinimum", xMinimum );
+      column( "xMaximum", xMaximum );
+      column( "yMinimum", yMinimum );
+      column( "yMaximum", yMaximum );
+      column( "zMinimum", zMinimum );
+      column( "zMaximum", zMaximum );
+      column( "intensityMinimum", intensityMinimum );
+      column( "intensityMaximum", intensityMaximum );
+      column( "timeStampMinimum", timeStampMinimum );
+      column( "timeStampMaximum", timeStampMaximum );
+
+      if ( !xMinimum || !xMaximum || !yMinimum || !yMaximum || !zMinimum || !zMaximum )
+      {
+         throw E57_EXCEPTION2( ErrorBadPrototype, "zones without cartesian bounds dataIndex=" +
+                                                     toString( dataIndex ) );
+      }
+
+      if ( zoneCount > 0 )
+      {
+         CompressedVectorReader reader = zonesNode.reader( destBuffers );
+         reader.read();
+         reader.close();
+      }
+
+      for ( size_t i = 0; i < zoneCount; ++i )
+      {
+         Data3DZone &zone = zones[i];
+
+         zone.firstPoint = static_cast<int64_t>( i ) * zonePointCount;
+         zone.pointCount = std::min( zonePointCount, pointCount - zone.firstPoint );
+
+         zone.cartesianBounds.xMinimum = ( *xMinimum )[i];
+         zone.cartesianBounds.xMaximum = ( *xMaximum )[i];
+         zone.cartesianBounds.yMinimum = ( *yMinimum )[i];
+         zone.cartesianBounds.yMaximum = ( *yMaximum )[i];
+         zone.cartesianBounds.zMinimum = ( *zMinimum )[i];
+         zone.cartesianBounds.zMaximum = ( *zMaximum )[i];
+
+         if ( intensityMinimum && intensityMaximum )
+         {
+            zone.intensityMinimum = ( *intensityMinimum )[i];
+            zone.intensityMaximum = ( *intensityMaximum )[i];
+         }
+
+         if ( timeStampMinimum && timeStampMaximum )
+         {
+            zone.timeStampMinimum = ( *timeStampMinimum )[i];
+            zone.timeStampMaximum = ( *timeStampMaximum )[i];
+         }
+      }
+
+      return true;
+   }
+
+   std::vector<Data3DZone> ReaderImpl::FindData3DZones( int64_t dataIndex,
+                                                        const CartesianBounds &box ) const
+   {
+      std::vector<Data3DZone> zones;
+
+      if ( !ReadData3DZones( dataIndex, zones ) )
+      {
+         // All the points may be in the box
+         Data3DZone zone;
+         zone.pointCount =
+            CompressedVectorNode( StructureNode( data3D_.get( dataIndex ) ).get( "points" ) )
+               .childCount();
+
+         return { zone };
+      }
+
+      auto overlaps = [&box]( const Data3DZone &zone ) {
+         const CartesianBounds &c = zone.cartesianBounds;
+
+         return ( c.xMinimum <= box.xMaximum ) && ( c.xMaximum >= box.xMinimum ) &&
+                ( c.yMinimum <= box.yMaximum ) && ( c.yMaximum >= box.yMinimum ) &&
+                ( c.zMinimum <= box.zMaximum ) && ( c.zMaximum >= box.zMinimum );
+      };
+
+      zones.erase( std::remove_if( zones.begin(), zones.end(),
+                                   [&]( const Data3DZone &zone ) { return !overlaps( zone ); } ),
+                   zones.end() );
+
+      return zones;
+   }
+
+   template <typename COORDTYPE>
+   std::function<void( unsigned )> ReaderImpl::sphericalToCartesianHandler(
+      const StructureNode &proto, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers,
+      std::vector<SourceDestBuffer> &destBuffers ) const
+   {
+
+      // Read the spherical coordinates which weren't asked for into our own buffers
+      struct Spherical
+      {
+         std::vector<COORDTYPE> range;
+         std::vector<COORDTYPE> azimuth;
+         std::vector<COORDTYPE> elevation;
+         std::vector<int8_t> invalidState;
+      };
+
+      auto spherical = std::make_shared<Spherical>();
+
+      auto addBuffer = [&]( const char *name, const COORDTYPE *buffer,
+                            std::vector<COORDTYPE> &ownBuffer ) {
+         if ( buffer != nullptr )
+         {
+            return buffer;
+         }
+
+         ownBuffer.resize( count );
+
+         const bool scaled = ( proto.get( name ).type() == TypeScaledInteger );
+         destBuffers.emplace_back( imf_, name, ownBuffer.data(), count, true, scaled );
+
+         return static_cast<const COORDTYPE *>( ownBuffer.data() );
+      };
+
+      const COORDTYPE *range = addBuffer( "sphericalRange", buffers.sphericalRange,
+                                          spherical->range );
+      const COORDTYPE *azimuth = addBuffer( "sphericalAzimuth", buffers.sphericalAzimuth,
+                                            spherical->azimuth );
+      const COORDTYPE *elevation = addBuffer( "sphericalElevation", buffers.sphericalElevation,
+                                              spherical->elevation );
+
+      // cartesianInvalidState has the same values as sphericalInvalidState. Read straight into
+      // it unless the sphericalInvalidState is being read too.
+      const int8_t *invalidState = nullptr;
+
+      if ( ( buffers.cartesianInvalidState != nullptr ) &&
+           proto.isDefined( "sphericalInvalidState" ) )
+      {
+         if ( buffers.sphericalInvalidState != nullptr )
+         {
+            invalidState = buffers.sphericalInvalidState;
+         }
+         else
+         {
+            destBuffers.emplace_back( imf_, "sphericalInvalidState",
+                                      buffers.cartesianInvalidState, count, true );
+         }
+      }
+
+      COORDTYPE *x = buffers.cartesianX;
+      COORDTYPE *y = buffers.cartesianY;
+      COORDTYPE *z = buffers.cartesianZ;
+      int8_t *cartesianInvalidState = buffers.cartesianInvalidState;
+
+      return [=]( unsigned recordCount ) {
+         _sphericalToCartesian( range, azimuth, elevation, x, y, z, recordCount );
+
+         if ( invalidState != nullptr )
+         {
+            std::copy( invalidState, invalidState + recordCount, cartesianInvalidState );
+         }
+
+         // Keep our buffers for as long as the reader has them
+         UNUSED( spherical );
+      };
+   }
+
+   /// Names of the fields which can be read into a Data3DPointsInterleaved or Data3DPointBlocks
+   const std::vector<ustring> &_pointFieldNames()
+   {
+      static const std::vector<ustring> cFieldNames = {
+         "cartesianX",       "cartesianY",         "cartesianZ",         "cartesianInvalidState",
+         "sphericalRange",   "sphericalAzimuth",   "sphericalElevation", "sphericalInvalidState",
+         "rowIndex",         "columnIndex",        "returnIndex",        "returnCount",
+         "timeStamp",        "isTimeStampInvalid", "intensity",          "isIntensityInvalid",
+         "colorRed",         "colorGreen",         "colorBlue",          "isColorInvalid",
+         "normalX",          "normalY",            "normalZ",
+      };
+
+      return cFieldNames;
+   }
+
+   /// Size of a value of the given type in bytes, or 0 for UString
+   size_t _memoryRepresentationSize( MemoryRepresentation memoryRepresentation )
+   {
+      switch ( memoryRepresentation )
+      {
+         case Int8:
+         case UInt8:
+            return 1;
+         case Int16:
+         case UInt16:
+         case Real16:
+            return 2;
+         case Int32:
+         case UInt32:
+         case Real32:
+            return 4;
+         case Int64:
+         case Real64:
+            return 8;
+         case Bool:
+            return sizeof( bool );
+         default:
+            return 0;
+      }
+   }
+
+   /// The memoryRepresentation which holds the values of a field without converting them. For
+   /// a ScaledInteger this is Real64 with the scale and offset applied.
+   MemoryRepresentation _exactMemoryRepresentation( const Node &node )
+   {
+      switch ( node.type() )
+      {
+         case TypeInteger:
+         {
+            const IntegerNode integer( node );
+            const int64_t minimum = integer.minimum();
+            const int64_t maximum = integer.maximum();
+
+            if ( minimum >= 0 )
+            {
+               if ( maximum <= UINT8_MAX )
+               {
+                  return UInt8;
+               }
+               if ( maximum <= UINT16_MAX )
+               {
+                  return UInt16;
+               }
+               if ( maximum <= UINT32_MAX )
+               {
+                  return UInt32;
+               }
+            }
+            else
+            {
+               if ( ( minimum >= INT8_MIN ) && ( maximum <= INT8_MAX ) )
+               {
+                  return Int8;
+               }
+               if ( ( minimum >= INT16_MIN ) && ( maximum <= INT16_MAX ) )
+               {
+                  return Int16;
+               }
+               if ( ( minimum >= INT32_MIN ) && ( maximum <= INT32_MAX ) )
+               {
+                  return Int32;
+               }
+            }
+
+            return Int64;
+         }
+
+         case TypeFloat:
+            return ( FloatNode( node ).precision() == PrecisionSingle ) ? Real32 : Real64;
+
+         default:
+            return Real64;
+      }
+   }
+
+   /// The limits of a numeric field, scaled for a ScaledInteger
+   void _fieldLimits( const Node &node, double &minimum, double &maximum )
+   {
+      switch ( node.type() )
+      {
+         case TypeInteger:
+         {
+            const IntegerNode integer( node );
+            minimum = static_cast<double>( integer.minimum() );
+            maximum = static_cast<double>( integer.maximum() );
+            break;
+         }
+
+         case TypeScaledInteger:
+         {
+            const ScaledIntegerNode scaledInteger( node );
+            minimum = scaledInteger.scaledMinimum();
+            maximum = scaledInteger.scaledMaximum();
+            break;
+         }
+
+         case TypeFloat:
+         {
+            const FloatNode floatNode( node );
+            minimum = floatNode.minimum();
+            maximum = floatNode.maximum();
+            break;
+         }
+
+         default:
+            throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + node.pathName() );
+      }
+   }
+
+   CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t count, const Data3DPointsInterleaved &buffers ) const
+   {
+      const std::vector<ustring> &cFieldNames = _pointFieldNames();
+
+      if ( buffers.records == nullptr )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "records=nullptr" );
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      const StructureNode proto( points.prototype() );
+
+      // E57_EXT_surface_normals
+      ustring norExtUri;
+      const bool haveNormalsExt = imf_.extensionsLookupPrefix( "nor", norExtUri );
+
+      std::vector<SourceDestBuffer> destBuffers;
+      std::vector<ustring> usedNames;
+
+      for ( const Data3DPointsField &field : buffers.fields )
+      {
+         if ( std::find( cFieldNames.begin(), cFieldNames.end(), field.name ) ==
+              cFieldNames.end() )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "fieldName=" + field.name );
+         }
+
+         if ( std::find( usedNames.begin(), usedNames.end(), field.name ) != usedNames.end() )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "duplicate fieldName=" + field.name );
+         }
+
+         usedNames.push_back( field.name );
+
+         const size_t fieldSize = _memoryRepresentationSize( field.memoryRepresentation );
+
+         if ( ( fieldSize == 0 ) || ( field.offset + fieldSize > buffers.stride ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "fieldName=" + field.name +
+                                     " memoryRepresentation=" +
+                                     toString( field.memoryRepresentation ) +
+                                     " offset=" + toString( field.offset ) +
+                                     " stride=" + toString( buffers.stride ) );
+         }
+
+         ustring pathName = field.name;
+
+         if ( pathName.compare( 0, 6, "normal" ) == 0 )
+         {
+            if ( !haveNormalsExt )
+            {
+               continue;
+            }
+
+            pathName = "nor:" + pathName;
+         }
+
+         if ( !proto.isDefined( pathName ) )
+         {
+            continue;
+         }
+
+         const bool scaled = ( proto.get( pathName ).type() == TypeScaledInteger );
+         char *first = static_cast<char *>( buffers.records ) + field.offset;
+         const size_t stride = buffers.stride;
+
+         switch ( field.memoryRepresentation )
+         {
+            case Int8:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<int8_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case UInt8:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<uint8_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case Int16:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<int16_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case UInt16:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<uint16_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case Int32:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<int32_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case UInt32:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<uint32_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case Int64:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<int64_t *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case Bool:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<bool *>( first ), count,
+                                         true, scaled, stride );
+               break;
+            case Real32:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<float *>( first ),
+                                         count, true, scaled, stride );
+               break;
+            case Real16:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<uint16_t *>( first ),
+                                         count, true, scaled, stride );
+               destBuffers.back().setHalfPrecision();
+               break;
+            default:
+               destBuffers.emplace_back( imf_, pathName, reinterpret_cast<double *>( first ),
+                                         count, true, scaled, stride );
+               break;
+         }
+
+         if ( field.normalized )
+         {
+            double minimum = 0.0;
+            double maximum = 0.0;
+
+            _fieldLimits( proto.get( pathName ), minimum, maximum );
+
+            destBuffers.back().setNormalizedRange( minimum, maximum );
+         }
+      }
+
+      return points.reader( destBuffers );
+   }
+
+   Data3DPointBlocks ReaderImpl::ReadData3DPointBlocks( int64_t dataIndex,
+                                                        const std::vector<ustring> &fields,
+                                                        size_t blockSize ) const
+   {
+      const std::vector<ustring> &cFieldNames = _pointFieldNames();
+
+      if ( blockSize == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "blockSize=0" );
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      const StructureNode proto( points.prototype() );
+
+      // E57_EXT_surface_normals
+      ustring norExtUri;
+      const bool haveNormalsExt = imf_.extensionsLookupPrefix( "nor", norExtUri );
+
+      std::vector<SourceDestBuffer> destBuffers;
+      std::vector<std::vector<uint64_t>> buffers;
+      Data3DPointBlock block;
+      std::vector<ustring> usedNames;
+
+      for ( const ustring &name : fields.empty() ? cFieldNames : fields )
+      {
+         if ( std::find( cFieldNames.begin(), cFieldNames.end(), name ) == cFieldNames.end() )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "fieldName=" + name );
+         }
+
+         if ( std::find( usedNames.begin(), usedNames.end(), name ) != usedNames.end() )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, "duplicate fieldName=" + name );
+         }
+
+         usedNames.push_back( name );
+
+         ustring pathName = name;
+
+         if ( pathName.compare( 0, 6, "normal" ) == 0 )
+         {
+            if ( !haveNormalsExt )
+            {
+               continue;
+            }
+
+            pathName = "nor:" + pathName;
+         }
+
+         if ( !proto.isDefined( pathName ) )
+         {
+            continue;
+         }
+
+         const Node node = proto.get( pathName );
+         const bool scaled = ( node.type() == TypeScaledInteger );
+
+         Data3DPointColumn column;
+         column.name = name;
+         column.memoryRepresentation = _exactMemoryRepresentation( node );
+
+         const size_t valueSize = _memoryRepresentationSize( column.memoryRepresentation );
+         buffers.emplace_back( ( blockSize * valueSize + 7 ) / 8 );
+
+         void *data = buffers.back().data();
+         column.data = data;
+
+         switch ( column.memoryRepresentation )
+         {
+            case Int8:
+               destBuffers.emplace_back( imf_, pathName, static_cast<int8_t *>( data ), blockSize );
+               break;
+            case UInt8:
+               destBuffers.emplace_back( imf_, pathName, static_cast<uint8_t *>( data ),
+                                         blockSize );
+               break;
+            case Int16:
+               destBuffers.emplace_back( imf_, pathName, static_cast<int16_t *>( data ),
+                                         blockSize );
+               break;
+            case UInt16:
+               destBuffers.emplace_back( imf_, pathName, static_cast<uint16_t *>( data ),
+                                         blockSize );
+               break;
+            case Int32:
+               destBuffers.emplace_back( imf_, pathName, static_cast<int32_t *>( data ),
+                                         blockSize );
+               break;
+            case UInt32:
+               destBuffers.emplace_back( imf_, pathName, static_cast<uint32_t *>( data ),
+                                         blockSize );
+               break;
+            case Int64:
+               destBuffers.emplace_back( imf_, pathName, static_cast<int64_t *>( data ),
+                                         blockSize );
+               break;
+            case Real32:
+               destBuffers.emplace_back( imf_, pathName, static_cast<float *>( data ), blockSize );
+               break;
+            default:
+               // A ScaledInteger is the one field which is converted
+               destBuffers.emplace_back( imf_, pathName, static_cast<double *>( data ), blockSize,
+                                         scaled, scaled );
+               break;
+         }
+
+         block.columns.push_back( column );
+      }
+
+      // Moving the buffers doesn't move what they hold, so the columns still point to it
+      return Data3DPointBlocks( std::make_shared<Data3DPointBlocksImpl>(
+         points.reader( destBuffers ), std::move( buffers ), std::move( block ) ) );
+   }
+
+   Data3DPointBlocksImpl::Data3DPointBlocksImpl( const CompressedVectorReader &reader,
+                                                 std::vector<std::vector<uint64_t>> &&buffers,
+                                                 Data3DPointBlock &&block ) :
+      reader_( reader ),
+      buffers_( std::move( buffers ) ), block_( std::move( block ) )
+   {
+   }
+
+   Data3DPointBlocksImpl::~Data3DPointBlocksImpl()
+   {
+      try
+      {
+         if ( reader_.isOpen() )
+         {
+            reader_.close();
+         }
+      }
+      catch ( ... )
+      {
+         // The file may have been closed already
+      }
+   }
+
+   bool Data3DPointBlocksImpl::next()
+   {
+      started_ = true;
+
+      if ( finished_ )
+      {
+         return false;
+      }
+
+      block_.firstPoint = nextPoint_;
+      block_.pointCount = reader_.read();
+
+      nextPoint_ += static_cast<int64_t>( block_.pointCount );
+
+      if ( block_.pointCount == 0 )
+      {
+         finished_ = true;
+         reader_.close();
+      }
+
+      return !finished_;
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::ReadData3DPointsData(
+      const std::vector<int64_t> &dataIndices,
+      const std::vector<Data3DPointsData_t<COORDTYPE> *> &buffers, unsigned int threadCount,
+      const Data3DReadCallback &callback ) const
+   {
+      if ( dataIndices.size() != buffers.size() )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "dataIndices=" + toString( dataIndices.size() ) +
+                                  " buffers=" + toString( buffers.size() ) );
+      }
+
+      // Check everything before reading anything
+      for ( size_t i = 0; i < dataIndices.size(); ++i )
+      {
+         if ( ( dataIndices[i] < 0 ) || ( dataIndices[i] >= data3D_.childCount() ) ||
+              ( buffers[i] == nullptr ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                  "dataIndex=" + toString( dataIndices[i] ) +
+                                     " data3DCount=" + toString( data3D_.childCount() ) );
+         }
+      }
+
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( imf_.impl()->executor() );
+      }
+
+      // Each reader may have one packet locked at a time, so it's no use having more of them
+      // than the cache can hold
+      threadCount = std::min( threadCount, imf_.impl()->packetCacheSize() );
+
+      // The file is open for reading, so each thread can have its own reader (see ImageFile)
+      auto readData3D = [&]( size_t i ) {
+         const int64_t dataIndex = dataIndices[i];
+
+         const StructureNode scan( data3D_.get( dataIndex ) );
+         const CompressedVectorNode points( scan.get( "points" ) );
+
+         auto pointCount = static_cast<size_t>( points.childCount() );
+
+         if ( ( pointCount > 0 ) && !readDecodedCache( dataIndex, *buffers[i] ) )
+         {
+            CompressedVectorReader reader =
+               SetUpData3DPointsData( dataIndex, pointCount, *buffers[i] );
+
+            const size_t recordsRead = reader.read();
+            reader.close();
+
+            if ( recordsRead == pointCount )
+            {
+               writeDecodedCache( dataIndex, *buffers[i] );
+            }
+
+            pointCount = recordsRead;
+         }
+
+         if ( callback )
+         {
+            callback( dataIndex, pointCount );
+         }
+      };
+
+      if ( ( threadCount > 1 ) && ( dataIndices.size() > 1 ) )
+      {
+         // The calling thread reads too
+         ThreadPool pool( std::min<size_t>( threadCount, dataIndices.size() ) - 1,
+                          imf_.impl()->executor() );
+
+         pool.parallelFor( dataIndices.size(), readData3D );
+      }
+      else
+      {
+         for ( size_t i = 0; i < dataIndices.size(); ++i )
+         {
+            readData3D( i );
+         }
+      }
+
+      return true;
+   }
+
+   /// Point the buffers of slice at those of buffers, starting at point first
+   template <typename COORDTYPE>
+   void _sliceBuffers( const Data3DPointsData_t<COORDTYPE> &buffers, size_t first,
+                       Data3DPointsData_t<COORDTYPE> &slice )
+   {
+      const auto offset = [first]( auto *buffer ) {
+         return ( buffer != nullptr ) ? buffer + first : nullptr;
+      };
+
+      slice.cartesianX = offset( buffers.cartesianX );
+      slice.cartesianY = offset( buffers.cartesianY );
+      slice.cartesianZ = offset( buffers.cartesianZ );
+      slice.cartesianInvalidState = offset( buffers.cartesianInvalidState );
+      slice.intensity = offset( buffers.intensity );
+      slice.isIntensityInvalid = offset( buffers.isIntensityInvalid );
+      slice.colorRed = offset( buffers.colorRed );
+      slice.colorGreen = offset( buffers.colorGreen );
+      slice.colorBlue = offset( buffers.colorBlue );
+      slice.isColorInvalid = offset( buffers.isColorInvalid );
+      slice.sphericalRange = offset( buffers.sphericalRange );
+      slice.sphericalAzimuth = offset( buffers.sphericalAzimuth );
+      slice.sphericalElevation = offset( buffers.sphericalElevation );
+      slice.sphericalInvalidState = offset( buffers.sphericalInvalidState );
+      slice.rowIndex = offset( buffers.rowIndex );
+      slice.columnIndex = offset( buffers.columnIndex );
+      slice.returnIndex = offset( buffers.returnIndex );
+      slice.returnCount = offset( buffers.returnCount );
+      slice.timeStamp = offset( buffers.timeStamp );
+      slice.isTimeStampInvalid = offset( buffers.isTimeStampInvalid );
+      slice.normalX = offset( buffers.normalX );
+      slice.normalY = offset( buffers.normalY );
+      slice.normalZ = offset( buffers.normalZ );
+   }
+
+   // Copy record "from" of each buffer to record "to"
+   template <typename COORDTYPE>
+   void _moveRecord( const Data3DPointsData_t<COORDTYPE> &buffers, size_t from, size_t to )
+   {
+      const auto move = [from, to]( auto *buffer ) {
+         if ( buffer != nullptr )
+         {
+            buffer[to] = buffer[from];
+         }
+      };
+
+      move( buffers.cartesianX );
+      move( buffers.cartesianY );
+      move( buffers.cartesianZ );
+      move( buffers.cartesianInvalidState );
+      move( buffers.intensity );
+      move( buffers.isIntensityInvalid );
+      move( buffers.colorRed );
+      move( buffers.colorGreen );
+      move( buffers.colorBlue );
+      move( buffers.isColorInvalid );
+      move( buffers.sphericalRange );
+      move( buffers.sphericalAzimuth );
+      move( buffers.sphericalElevation );
+      move( buffers.sphericalInvalidState );
+      move( buffers.rowIndex );
+      move( buffers.columnIndex );
+      move( buffers.returnIndex );
+      move( buffers.returnCount );
+      move( buffers.timeStamp );
+      move( buffers.isTimeStampInvalid );
+      move( buffers.normalX );
+      move( buffers.normalY );
+      move( buffers.normalZ );
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::ReadData3DPointsDataParallel( int64_t dataIndex,
+                                                  Data3DPointsData_t<COORDTYPE> &buffers,
+                                                  unsigned int threadCount ) const
+   {
+      // Ranges smaller than this aren't worth starting a reader for
+      constexpr size_t minRangeSize = 64 * 1024;
+
+      if ( ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "dataIndex=" + toString( dataIndex ) +
+                                  " data3DCount=" + toString( data3D_.childCount() ) );
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      const CompressedVectorNode points( scan.get( "points" ) );
+
+      const auto pointCount = static_cast<size_t>( points.childCount() );
+
+      if ( ( pointCount == 0 ) || readDecodedCache( dataIndex, buffers ) )
+      {
+         return true;
+      }
+
+      if ( threadCount == 0 )
+      {
+         threadCount = ThreadPool::defaultThreadCount( imf_.impl()->executor() );
+      }
+
+      // Each reader may have one packet locked at a time (see ReadData3DPointsData())
+      threadCount = std::min( threadCount, imf_.impl()->packetCacheSize() );
+
+      const size_t rangeCount =
+         std::max<size_t>( std::min<size_t>( threadCount, pointCount / minRangeSize ), 1 );
+      const size_t rangeSize = ( pointCount + rangeCount - 1 ) / rangeCount;
+
+      // The reader of the first range builds a record index from the packet headers, which lets
+      // the readers of the others start each bytestream at their first record without decoding
+      // the records before it.
+      CompressedVectorReader firstReader =
+         SetUpData3DPointsData( dataIndex, std::min( rangeSize, pointCount ), buffers );
+
+      if ( rangeCount > 1 )
+      {
+         firstReader.buildRecordIndex();
+      }
+
+      const std::shared_ptr<const RecordIndex> index = firstReader.impl()->recordIndex();
+
+      // The file is open for reading, so each thread can have its own reader (see ImageFile)
+      auto readRange = [&]( size_t range ) {
+         const size_t first = range * rangeSize;
+         const size_t count = std::min( rangeSize, pointCount - first );
+
+         CompressedVectorReader reader = firstReader;
+
+         if ( range > 0 )
+         {
+            Data3DPointsData_t<COORDTYPE> slice;
+            _sliceBuffers( buffers, first, slice );
+
+            reader = SetUpData3DPointsData( dataIndex, count, slice );
+            reader.impl()->setRecordIndex( index );
+            reader.seek( static_cast<int64_t>( first ) );
+         }
+
+         const unsigned recordsRead = reader.read();
+         reader.close();
+
+         if ( recordsRead != count )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "recordsRead=" + toString( recordsRead ) +
+                                                       " expected=" + toString( count ) );
+         }
+      };
+
+      if ( rangeCount > 1 )
+      {
+         // The calling thread reads too
+         ThreadPool pool( rangeCount - 1, imf_.impl()->executor() );
+
+         pool.parallelFor( rangeCount, readRange );
+      }
+      else
+      {
+         readRange( 0 );
+      }
+
+      writeDecodedCache( dataIndex, buffers );
+
+      return true;
+   }
+
+   // The buffers of a Data3DPointsData_t which are set, as decoded cache columns
+   template <typename COORDTYPE>
+   std::vector<DecodedCache::Column> _decodedCacheColumns(
+      const Data3DPointsData_t<COORDTYPE> &buffers )
+   {
+      std::vector<DecodedCache::Column> columns;
+
+      const auto add = [&columns]( const char *name, auto *buffer ) {
+         if ( buffer != nullptr )
+         {
+            DecodedCache::Column column;
+            column.name = name;
+            column.data = buffer;
+            column.elementSize = sizeof( *buffer );
+
+            columns.push_back( column );
+         }
+      };
+
+      add( "cartesianX", buffers.cartesianX );
+      add( "cartesianY", buffers.cartesianY );
+      add( "cartesianZ", buffers.cartesianZ );
+      add( "cartesianInvalidState", buffers.cartesianInvalidState );
+      add( "intensity", buffers.intensity );
+      add( "isIntensityInvalid", buffers.isIntensityInvalid );
+      add( "colorRed", buffers.colorRed );
+      add( "colorGreen", buffers.colorGreen );
+      add( "colorBlue", buffers.colorBlue );
+      add( "isColorInvalid", buffers.isColorInvalid );
+      add( "sphericalRange", buffers.sphericalRange );
+      add( "sphericalAzimuth", buffers.sphericalAzimuth );
+      add( "sphericalElevation", buffers.sphericalElevation );
+      add( "sphericalInvalidState", buffers.sphericalInvalidState );
+      add( "rowIndex", buffers.rowIndex );
+      add( "columnIndex", buffers.columnIndex );
+      add( "returnIndex", buffers.returnIndex );
+      add( "returnCount", buffers.returnCount );
+      add( "timeStamp", buffers.timeStamp );
+      add( "isTimeStampInvalid", buffers.isTimeStampInvalid );
+      add( "normalX", buffers.normalX );
+      add( "normalY", buffers.normalY );
+      add( "normalZ", buffers.normalZ );
+
+      return columns;
+   }
+
+   template <typename COORDTYPE>
+   DecodedCache::Key ReaderImpl::decodedCacheKey( int64_t dataIndex ) const
+   {
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      const CompressedVectorNode points( scan.get( "points" ) );
+
+      DecodedCache::Key key;
+
+      if ( root_.isDefined( "guid" ) )
+      {
+         key.fileGuid = StringNode( root_.get( "guid" ) ).value();
+      }
+
+      key.fileLength = imf_.impl()->file()->length( CheckedFile::Physical );
+      key.fileModified = decodedCacheFileModified_;
+      key.xmlChecksum = decodedCacheXmlChecksum_;
+      key.sectionLogicalStart = points.impl()->getBinarySectionLogicalStart();
+      key.pointCount = static_cast<uint64_t>( points.childCount() );
+      key.coordinateType = static_cast<uint32_t>( sizeof( COORDTYPE ) ) +
+                           ( std::is_floating_point<COORDTYPE>::value ? 0x100 : 0 );
+      key.flags = ( sphericalToCartesian_ ? 1 : 0 ) | ( applyPose_ ? 2 : 0 );
+
+      return key;
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::readDecodedCache( int64_t dataIndex,
+                                      const Data3DPointsData_t<COORDTYPE> &buffers ) const
+   {
+      if ( decodedCacheDirectory_.empty() )
+      {
+         return false;
+      }
+
+      const DecodedCache::Key key = decodedCacheKey<COORDTYPE>( dataIndex );
+
+      return DecodedCache::read( DecodedCache::fileName( decodedCacheDirectory_, key ), key,
+                                 _decodedCacheColumns( buffers ) );
+   }
+
+   template <typename COORDTYPE>
+   void ReaderImpl::writeDecodedCache( int64_t dataIndex,
+                                       const Data3DPointsData_t<COORDTYPE> &buffers ) const
+   {
+      if ( decodedCacheDirectory_.empty() )
+      {
+         return;
+      }
+
+      const DecodedCache::Key key = decodedCacheKey<COORDTYPE>( dataIndex );
+
+      // The points have been read, so a cache which can't be written is only slower next time
+      DecodedCache::write( DecodedCache::fileName( decodedCacheDirectory_, key ), key,
+                           _decodedCacheColumns( buffers ) );
+   }
+
+   int64_t ReaderImpl::GetData3DCount() const
+   {
+      return data3D_.childCount();
+   }
+
+   void ReaderImpl::ReleaseData3D( int64_t dataIndex ) const
+   {
+      data3D_.impl()->releaseChild( dataIndex );
+   }
+
+   void ReaderImpl::ReleaseImage2D( int64_t imageIndex ) const
+   {
+      images2D_.impl()->releaseChild( imageIndex );
+   }
+
+   template <typename COORDTYPE>
+   int64_t ReaderImpl::ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                          Data3DPointsData_t<COORDTYPE> &buffers ) const
+   {
+      // Most runs read when sampling, so the runs are spread out but still take whole packets
+      constexpr int64_t maxRunCount = 64;
+
+      if ( ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "dataIndex=" + toString( dataIndex ) +
+                                  " data3DCount=" + toString( data3D_.childCount() ) );
+      }
+
+      if ( maxPointCount < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "maxPointCount=" + toString( maxPointCount ) );
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+
+      ustring prefix;
+
+      if ( imf_.extensionsLookupUri( PREVIEW_URI, prefix ) &&
+           scan.isDefined( prefix + ":preview" ) )
+      {
+         const StructureNode preview( scan.get( prefix + ":preview" ) );
+         const CompressedVectorNode previewPoints( preview.get( "points" ) );
+
+         if ( previewPoints.childCount() > 0 )
+         {
+            points = previewPoints;
+         }
+      }
+
+      const int64_t pointCount = points.childCount();
+
+      if ( ( pointCount == 0 ) || ( maxPointCount == 0 ) )
+      {
+         return 0;
+      }
+
+      // Read all the points, or runs of them spread evenly through the data block
+      int64_t runCount = 1;
+      int64_t runLength = pointCount;
+
+      if ( pointCount > maxPointCount )
+      {
+         runLength = ( maxPointCount + maxRunCount - 1 ) / maxRunCount;
+         runCount = maxPointCount / runLength;
+      }
+
+      int64_t readCount = 0;
+
+      for ( int64_t run = 0; run < runCount; ++run )
+      {
+         Data3DPointsData_t<COORDTYPE> slice;
+         _sliceBuffers( buffers, static_cast<size_t>( readCount ), slice );
+
+         CompressedVectorReader reader =
+            setUpPointsReader( dataIndex, points, static_cast<size_t>( runLength ), slice );
+
+         reader.seek( static_cast<uint64_t>( run * ( pointCount / runCount ) ) );
+         readCount += reader.read();
+         reader.close();
+      }
+
+      return readCount;
+   }
+
+   template <typename COORDTYPE>
+   int64_t ReaderImpl::ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                         int64_t maxPointCount,
+                                         Data3DPointsData_t<COORDTYPE> &buffers ) const
+   {
+      if ( ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "dataIndex=" + toString( dataIndex ) +
+                                  " data3DCount=" + toString( data3D_.childCount() ) );
+      }
+
+      if ( maxPointCount < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "maxPointCount=" + toString( maxPointCount ) );
+      }
+
+      // The indices of the points read decide which are kept
+      if ( ( buffers.rowIndex == nullptr ) || ( buffers.columnIndex == nullptr ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "rowIndex and columnIndex buffers required" );
+      }
+
+      const StructureNode scan( data3D_.get( dataIndex ) );
+      const CompressedVectorNode points( scan.get( "points" ) );
+
+      // The lines to read: the ones in the window if the points are grouped by line, otherwise
+      // all of the points as one line
+      std::vector<int64_t> lineStarts{ 0 };
+      std::vector<int64_t> linePointCounts{ points.childCount() };
+
+      if ( scan.isDefined( "pointGroupingSchemes/groupingByLine" ) )
+      {
+         const StructureNode groupingByLine( scan.get( "pointGroupingSchemes/groupingByLine" ) );
+         const CompressedVectorNode groups( groupingByLine.get( "groups" ) );
+         const StructureNode lineGroupRecord( groups.prototype() );
+
+         if ( lineGroupRecord.isDefined( "idElementValue" ) &&
+              lineGroupRecord.isDefined( "startPointIndex" ) &&
+              lineGroupRecord.isDefined( "pointCount" ) )
+         {
+            const bool columns =
+               ( StringNode( groupingByLine.get( "idElementName" ) ).value() == "columnIndex" );
+            const int64_t lineMinimum = columns ? window.columnMinimum : window.rowMinimum;
+            const int64_t lineMaximum = columns ? window.columnMaximum : window.rowMaximum;
+
+            const auto groupCount = static_cast<size_t>( groups.childCount() );
+
+            std::vector<int64_t> idElementValues( groupCount );
+            std::vector<int64_t> startPointIndices( groupCount );
+            std::vector<int64_t> pointCounts( groupCount );
+
+            ReadData3DGroupsData( dataIndex, groupCount, idElementValues.data(),
+                                  startPointIndices.data(), pointCounts.data() );
+
+            lineStarts.clear();
+            linePointCounts.clear();
+
+            for ( size_t group = 0; group < groupCount; ++group )
+            {
+               if ( ( idElementValues[group] >= lineMinimum ) &&
+                    ( idElementValues[group] <= lineMaximum ) )
+               {
+                  lineStarts.push_back( startPointIndices[group] );
+                  linePointCounts.push_back( pointCounts[group] );
+               }
+            }
+         }
+      }
+
+      const auto inWindow = [&window]( int64_t row, int64_t column ) {
+         return ( row >= window.rowMinimum ) && ( row <= window.rowMaximum ) &&
+                ( column >= window.columnMinimum ) && ( column <= window.columnMaximum );
+      };
+
+      int64_t readCount = 0;
+
+      for ( size_t line = 0; line < lineStarts.size(); ++line )
+      {
+         int64_t next = lineStarts[line];
+         int64_t remaining = linePointCounts[line];
+
+         // Read the line into the free part of the buffers, keeping the points in the window, in
+         // as many parts as it takes to fit
+         while ( ( remaining > 0 ) && ( readCount < maxPointCount ) )
+         {
+            const int64_t count = std::min( remaining, maxPointCount - readCount );
+
+            Data3DPointsData_t<COORDTYPE> slice;
+            _sliceBuffers( buffers, static_cast<size_t>( readCount ), slice );
+
+            CompressedVectorReader reader =
+               setUpPointsReader( dataIndex, points, static_cast<size_t>( count ), slice );
+
+            reader.seek( static_cast<uint64_t>( next ) );
+            const unsigned gotCount = reader.read();
+            reader.close();
+
+            if ( gotCount == 0 )
+            {
+               break;
+            }
+
+            size_t keptCount = 0;
+
+            for ( size_t i = 0; i < gotCount; ++i )
+            {
+               if ( inWindow( slice.rowIndex[i], slice.columnIndex[i] ) )
+               {
+                  _moveRecord( slice, i, keptCount++ );
+               }
+            }
+
+            readCount += static_cast<int64_t>( keptCount );
+            next += gotCount;
+            remaining -= gotCount;
+         }
+      }
+
+      return readCount;
+   }
+
+   StructureNode ReaderImpl::GetRawE57Root() const
+   {
+      return root_;
+   }
+
+   VectorNode ReaderImpl::GetRawData3D() const
+   {
+      return data3D_;
+   }
+
+   VectorNode ReaderImpl::GetRawImages2D() const
+   {
+      return images2D_;
+   }
+
+   ImageFile ReaderImpl::GetRawIMF() const
+   {
+      return imf_;
+   }
+
+   // Explicit template instantiation
+   template CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<float> &buffers ) const;
+
+   template CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<double> &buffers ) const;
+
+   template CompressedVectorReader ReaderImpl::SetUpData3DPointsData(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<int32_t> &buffers ) const;
+
+   template bool ReaderImpl::ReadData3DPointsData(
+      const std::vector<int64_t> &dataIndices,
+      const std::vector<Data3DPointsData_t<float> *> &buffers, unsigned int threadCount,
+      const Data3DReadCallback &callback ) const;
+
+   template bool ReaderImpl::ReadData3DPointsData(
+      const std::vector<int64_t> &dataIndices,
+      const std::vector<Data3DPointsData_t<double> *> &buffers, unsigned int threadCount,
+      const Data3DReadCallback &callback ) const;
+
+   template bool ReaderImpl::ReadData3DPointsData(
+      const std::vector<int64_t> &dataIndices,
+      const std::vector<Data3DPointsData_t<int32_t> *> &buffers, unsigned int threadCount,
+      const Data3DReadCallback &callback ) const;
+
+   template bool ReaderImpl::ReadData3DPointsDataParallel( int64_t dataIndex,
+                                                           Data3DPointsData_t<float> &buffers,
+                                                           unsigned int threadCount ) const;
+
+   template bool ReaderImpl::ReadData3DPointsDataParallel( int64_t dataIndex,
+                                                           Data3DPointsData_t<double> &buffers,
+                                                           unsigned int threadCount ) const;
+
+   template int64_t ReaderImpl::ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                                   Data3DPointsData_t<float> &buffers ) const;
+
+   template int64_t ReaderImpl::ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                                   Data3DPointsData_t<double> &buffers ) const;
+
+   template int64_t ReaderImpl::ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                                  int64_t maxPointCount,
+                                                  Data3DPointsData_t<float> &buffers ) const;
+
+   template int64_t ReaderImpl::ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                                  int64_t maxPointCount,
+                                                  Data3DPointsData_t<double> &buffers ) const;
 
 } // end namespace e57
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include "Common.h"
+#include "DecodedCache.h"
 #include "E57SimpleData.h"
 #include "E57SimpleReader.h"
 
@@ -37,6 +39,7 @@ namespace e57
    {
    public:
       explicit ReaderImpl( const ustring &filePath, const ReaderOptions &options );
+      ReaderImpl( std::shared_ptr<ImageFileIO> io, const ReaderOptions &options );
       ~ReaderImpl();
 
       // disallow copying a ReaderImpl
@@ -64,10 +67,21 @@ namespace e57
                               Image2DType imageType, uint8_t *pBuffer, int64_t start,
                               size_t count ) const;
 
+      BlobView GetImage2DView( int64_t imageIndex, Image2DProjection imageProjection,
+                               Image2DType imageType ) const;
+
+      bool ReadImage2DDataParallel( std::vector<Image2DRead> &reads,
+                                    unsigned int threadCount ) const;
+
       int64_t GetData3DCount() const;
 
       bool ReadData3D( int64_t dataIndex, Data3D &data3DHeader ) const;
 
+      /// Drop the parsed metadata of a block of a lazily opened file (see
+      /// StructureNodeImpl::releaseChild())
+      void ReleaseData3D( int64_t dataIndex ) const;
+      void ReleaseImage2D( int64_t imageIndex ) const;
+
       bool GetData3DSizes( int64_t dataIndex, int64_t &rowMax, int64_t &columnMax,
                            int64_t &pointsSize, int64_t &groupsSize, int64_t &countSize,
                            bool &bColumnIndex ) const;
@@ -75,10 +89,46 @@ namespace e57
       bool ReadData3DGroupsData( int64_t dataIndex, size_t groupCount, int64_t *idElementValue,
                                  int64_t *startPointIndex, int64_t *pointCount ) const;
 
+      bool GetData3DScaling( int64_t dataIndex, const ustring &fieldName, double &scale,
+                             double &offset ) const;
+
       template <typename COORDTYPE>
       CompressedVectorReader SetUpData3DPointsData(
          int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<COORDTYPE> &buffers ) const;
 
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsInterleaved &buffers ) const;
+
+      void RestartData3DPointsData( int64_t dataIndex, CompressedVectorReader &reader ) const;
+
+      bool ReadData3DZones( int64_t dataIndex, std::vector<Data3DZone> &zones ) const;
+
+      std::vector<Data3DZone> FindData3DZones( int64_t dataIndex,
+                                               const CartesianBounds &box ) const;
+
+      Data3DPointBlocks ReadData3DPointBlocks( int64_t dataIndex,
+                                               const std::vector<ustring> &fields,
+                                               size_t blockSize ) const;
+
+      template <typename COORDTYPE>
+      bool ReadData3DPointsData( const std::vector<int64_t> &dataIndices,
+                                 const std::vector<Data3DPointsData_t<COORDTYPE> *> &buffers,
+                                 unsigned int threadCount,
+                                 const Data3DReadCallback &callback ) const;
+
+      template <typename COORDTYPE>
+      bool ReadData3DPointsDataParallel( int64_t dataIndex, Data3DPointsData_t<COORDTYPE> &buffers,
+                                         unsigned int threadCount ) const;
+
+      template <typename COORDTYPE>
+      int64_t ReadData3DPreview( int64_t dataIndex, int64_t maxPointCount,
+                                 Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
+      template <typename COORDTYPE>
+      int64_t ReadData3DWindow( int64_t dataIndex, const IndexBounds &window,
+                                int64_t maxPointCount,
+                                Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
       StructureNode GetRawE57Root() const;
 
       VectorNode GetRawData3D() const;
@@ -88,11 +138,95 @@ namespace e57
       ImageFile GetRawIMF() const;
 
    private:
+      ReaderImpl( const ImageFile &imf, const ReaderOptions &options );
+
+      /// Find the blob of imageType in the imageProjection representation of an image
+      /// @returns the blob, null if there isn't one
+      std::unique_ptr<BlobNode> findImage2DBlob( int64_t imageIndex,
+                                                 Image2DProjection imageProjection,
+                                                 Image2DType imageType ) const;
+
+      /// Set up a reader of the points of data block dataIndex, or of other points with their
+      /// prototype (e.g. its preview)
+      template <typename COORDTYPE>
+      CompressedVectorReader setUpPointsReader(
+         int64_t dataIndex, CompressedVectorNode points, size_t count,
+         const Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
+      template <typename COORDTYPE>
+      std::function<void( unsigned )> sphericalToCartesianHandler(
+         const StructureNode &proto, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers,
+         std::vector<SourceDestBuffer> &destBuffers ) const;
+
+      /// @returns what the decoded cache file of data block dataIndex depends on
+      template <typename COORDTYPE> DecodedCache::Key decodedCacheKey( int64_t dataIndex ) const;
+
+      /// Copy the points of data block dataIndex into buffers from its decoded cache file (see
+      /// ReaderOptions::decodedCacheDirectory)
+      /// @returns false if there is no cache, or no cache file with all of the buffers
+      template <typename COORDTYPE>
+      bool readDecodedCache( int64_t dataIndex,
+                             const Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
+      /// Write the points of data block dataIndex, read into buffers, to its decoded cache file
+      template <typename COORDTYPE>
+      void writeDecodedCache( int64_t dataIndex,
+                              const Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
       ImageFile imf_;
       StructureNode root_;
 
       VectorNode data3D_;
 
       VectorNode images2D_;
+
+      bool sphericalToCartesian_; /// see ReaderOptions::sphericalToCartesian
+      bool applyPose_;            /// see ReaderOptions::applyPose
+
+      ustring decodedCacheDirectory_; /// see ReaderOptions::decodedCacheDirectory
+
+      // Parts of DecodedCache::Key which are the same for every block
+      uint64_t decodedCacheFileModified_ = 0;
+      uint32_t decodedCacheXmlChecksum_ = 0;
    }; // end Reader class
+
+   /// The reader of a Data3DPointBlocks and the buffers it reads each block into
+   class Data3DPointBlocksImpl
+   {
+   public:
+      /// @param [in] buffers the buffers which the columns of block point to
+      Data3DPointBlocksImpl( const CompressedVectorReader &reader,
+                             std::vector<std::vector<uint64_t>> &&buffers,
+                             Data3DPointBlock &&block );
+      ~Data3DPointBlocksImpl();
+
+      Data3DPointBlocksImpl( const Data3DPointBlocksImpl & ) = delete;
+      Data3DPointBlocksImpl &operator=( const Data3DPointBlocksImpl & ) = delete;
+
+      bool next();
+
+      const Data3DPointBlock &block() const
+      {
+         return block_;
+      }
+
+      bool started() const
+      {
+         return started_;
+      }
+
+      bool finished() const
+      {
+         return finished_;
+      }
+
+   private:
+      CompressedVectorReader reader_;
+      std::vector<std::vector<uint64_t>> buffers_; /// 8 byte aligned storage of each column
+      Data3DPointBlock block_;
+
+      int64_t nextPoint_ = 0;
+      bool started_ = false;
+      bool finished_ = false;
+   };
 } // end namespace e57
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cstring>
+
+#include "CheckedFile.h"
+#include "RecordIndex.h"
+#include "StringFunctions.h"
+
+namespace
+{
+   constexpr char RECORD_INDEX_SIGNATURE[8] = { 'E', '5', '7', 'R', 'I', 'D', 'X', '\0' };
+   constexpr uint32_t RECORD_INDEX_VERSION = 1;
+
+   // Start of a record index file. It is followed by the bytestream lengths, the packet offsets,
+   // then the bytestream offsets of each packet (all uint64_t).
+   struct RecordIndexHeader
+   {
+      char signature[8] = {};
+      uint32_t version = 0;
+      uint32_t bytestreamCount = 0;
+      uint64_t fileLength = 0;
+      uint64_t sectionLogicalStart = 0;
+      uint64_t recordCount = 0;
+      uint64_t packetCount = 0;
+   };
+
+   static_assert( sizeof( RecordIndexHeader ) == 48, "Unexpected RecordIndexHeader size" );
+}
+
+namespace e57
+{
+   RecordIndex::RecordIndex( uint64_t fileLength, uint64_t sectionLogicalStart,
+                             uint64_t recordCount, unsigned bytestreamCount ) :
+      fileLength_( fileLength ),
+      sectionLogicalStart_( sectionLogicalStart ), recordCount_( recordCount ),
+      bytestreamCount_( bytestreamCount ), bytestreamLengths_( bytestreamCount, 0 )
+   {
+   }
+
+   void RecordIndex::addPacket( uint64_t packetLogicalOffset,
+                                const std::vector<unsigned> &bufferLengths )
+   {
+      if ( bufferLengths.size() != bytestreamCount_ )
+      {
+         throw E57_EXCEPTION2( ErrorInternal,
+                               "bufferLengths=" + toString( bufferLengths.size() ) +
+                                  " bytestreamCount=" + toString( bytestreamCount_ ) );
+      }
+
+      packetLogicalOffsets_.push_back( packetLogicalOffset );
+
+      for ( unsigned i = 0; i < bytestreamCount_; ++i )
+      {
+         bytestreamOffsets_.push_back( bytestreamLengths_[i] );
+         bytestreamLengths_[i] += bufferLengths[i];
+      }
+   }
+
+   bool RecordIndex::matches( uint64_t fileLength, uint64_t sectionLogicalStart,
+                              uint64_t recordCount, unsigned bytestreamCount ) const
+   {
+      return ( fileLength_ == fileLength ) && ( sectionLogicalStart_ == sectionLogicalStart ) &&
+             ( recordCount_ == recordCount ) && ( bytestreamCount_ == bytestreamCount );
+   }
+
+   uint64_t RecordIndex::bytestreamLength( unsigned bytestreamNumber ) const
+   {
+      return bytestreamLengths_.at( bytestreamNumber );
+   }
+
+   bool RecordIndex::find( unsigned bytestreamNumber, uint64_t byteOffset,
+                           uint64_t &packetLogicalOffset, size_t &bufferIndex,
+                           size_t &bufferLength ) const
+   {
+      if ( bytestreamNumber >= bytestreamCount_ || packetLogicalOffsets_.empty() ||
+           byteOffset > bytestreamLengths_[bytestreamNumber] )
+      {
+         return false;
+      }
+
+      auto packetOffset = [this, bytestreamNumber]( size_t packet ) {
+         return bytestreamOffsets_[packet * bytestreamCount_ + bytestreamNumber];
+      };
+
+      // Binary search for the last packet starting at or before byteOffset. The offsets of a
+      // bytestream never decrease, so any packets without data for it are skipped over.
+      size_t first = 0;
+      size_t count = packetLogicalOffsets_.size();
+
+      while ( count > 0 )
+      {
+         const size_t step = count / 2;
+
+         if ( packetOffset( first + step ) <= byteOffset )
+         {
+            first += step + 1;
+            count -= step + 1;
+         }
+         else
+         {
+            count = step;
+         }
+      }
+
+      // first is now the first packet starting after byteOffset. The offsets of every bytestream
+      // start at 0 (see read()), so it can only be 0 for an index which wasn't checked.
+      if ( first == 0 )
+      {
+         return false;
+      }
+
+      const size_t packet = first - 1;
+      const uint64_t packetEnd = ( first < packetLogicalOffsets_.size() )
+                                    ? packetOffset( first )
+                                    : bytestreamLengths_[bytestreamNumber];
+
+      packetLogicalOffset = packetLogicalOffsets_[packet];
+      bufferIndex = static_cast<size_t>( byteOffset - packetOffset( packet ) );
+      bufferLength = static_cast<size_t>( packetEnd - packetOffset( packet ) );
+
+      return true;
+   }
+
+   void RecordIndex::validate( const ustring &fileName ) const
+   {
+      const size_t packetCount = packetLogicalOffsets_.size();
+
+      // The packets are in the order they are in the section, which is inside the file
+      for ( size_t packet = 0; packet < packetCount; ++packet )
+      {
+         const uint64_t offset = packetLogicalOffsets_[packet];
+         const bool inOrder = ( packet == 0 ) ? ( offset >= sectionLogicalStart_ )
+                                              : ( offset > packetLogicalOffsets_[packet - 1] );
+
+         if ( !inOrder || ( offset >= fileLength_ ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                  "fileName=" + fileName + " packet=" + toString( packet ) +
+                                     " packetLogicalOffset=" + toString( offset ) );
+         }
+      }
+
+      // Each bytestream starts at 0 in the first packet and its offsets never decrease, up to
+      // its length
+      for ( unsigned bytestream = 0; bytestream < bytestreamCount_; ++bytestream )
+      {
+         uint64_t previous = 0;
+
+         for ( size_t packet = 0; packet < packetCount; ++packet )
+         {
+            const uint64_t offset = bytestreamOffsets_[packet * bytestreamCount_ + bytestream];
+
+            if ( ( ( packet == 0 ) && ( offset != 0 ) ) || ( offset < previous ) ||
+                 ( offset > bytestreamLengths_[bytestream] ) )
+            {
+               throw E57_EXCEPTION2( ErrorBadCVPacket,
+                                     "fileName=" + fileName + " packet=" + toString( packet ) +
+                                        " bytestream=" + toString( bytestream ) +
+                                        " bytestreamOffset=" + toString( offset ) );
+            }
+
+            previous = offset;
+         }
+      }
+   }
+
+   void RecordIndex::write( const ustring &fileName ) const
+   {
+      RecordIndexHeader header;
+      memcpy( header.signature, RECORD_INDEX_SIGNATURE, sizeof( header.signature ) );
+      header.version = RECORD_INDEX_VERSION;
+      header.bytestreamCount = bytestreamCount_;
+      header.fileLength = fileLength_;
+      header.sectionLogicalStart = sectionLogicalStart_;
+      header.recordCount = recordCount_;
+      header.packetCount = packetLogicalOffsets_.size();
+
+      CheckedFile file( fileName, CheckedFile::Write, ChecksumAll );
+
+      auto writeVector = [&file]( const std::vector<uint64_t> &values ) {
+         if ( !values.empty() )
+         {
+            file.write( reinterpret_cast<const char *>( values.data() ),
+                        values.size() * sizeof( uint64_t ) );
+         }
+      };
+
+      file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+      writeVector( bytestreamLengths_ );
+      writeVector( packetLogicalOffsets_ );
+      writeVector( bytestreamOffsets_ );
+
+      file.close();
+   }
+
+   std::unique_ptr<RecordIndex> RecordIndex::read( const ustring &fileName )
+   {
+      CheckedFile file( fileName, CheckedFile::Read, ChecksumAll );
+
+      RecordIndexHeader header;
+
+      if ( file.length( CheckedFile::Logical ) < sizeof( header ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadFileLength,
+                               "fileName=" + fileName + " fileLength=" +
+                                  toString( file.length( CheckedFile::Logical ) ) );
+      }
+
+      file.read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+      if ( memcmp( header.signature, RECORD_INDEX_SIGNATURE, sizeof( header.signature ) ) != 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadFileSignature, "fileName=" + fileName );
+      }
+
+      if ( header.version != RECORD_INDEX_VERSION )
+      {
+         throw E57_EXCEPTION2( ErrorUnknownFileVersion,
+                               "fileName=" + fileName + " version=" + toString( header.version ) );
+      }
+
+      // Check the length before allocating anything based on the counts. The file is padded to a
+      // whole number of pages.
+      const uint64_t valueCount = header.bytestreamCount +
+                                  header.packetCount * ( 1 + uint64_t{ header.bytestreamCount } );
+      const uint64_t expectedLength = sizeof( header ) + valueCount * sizeof( uint64_t );
+      const uint64_t fileLength = file.length( CheckedFile::Logical );
+
+      if ( ( header.packetCount > UINT32_MAX ) || ( fileLength < expectedLength ) ||
+           ( fileLength - expectedLength >= CheckedFile::logicalPageSize ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadFileLength,
+                               "fileName=" + fileName + " fileLength=" + toString( fileLength ) +
+                                  " expectedLength=" + toString( expectedLength ) );
+      }
+
+      std::unique_ptr<RecordIndex> index( new RecordIndex( header.fileLength,
+                                                           header.sectionLogicalStart,
+                                                           header.recordCount,
+                                                           header.bytestreamCount ) );
+
+      auto readVector = [&file]( std::vector<uint64_t> &values, uint64_t count ) {
+         values.resize( static_cast<size_t>( count ) );
+
+         if ( count > 0 )
+         {
+            file.read( reinterpret_cast<char *>( values.data() ),
+                       static_cast<size_t>( count * sizeof( uint64_t ) ) );
+         }
+      };
+
+      readVector( index->bytestreamLengths_, header.bytestreamCount );
+      readVector( index->packetLogicalOffsets_, header.packetCount );
+      readVector( index->bytestreamOffsets_, header.packetCount * header.bytestreamCount );
+
+      index->validate( fileName );
+
+      return index;
+   }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// @brief Where the data of each bytestream of a CompressedVector is in its data packets.
+   /// @details This is built from the data packet headers alone, so it can be made for any file,
+   /// with or without index packets. A reader can use it to start a bytestream whose records are
+   /// all the same size (i.e. anything but strings) at any record without decoding the ones
+   /// before it. It can be saved to a sidecar file and read back in a later session.
+   class RecordIndex
+   {
+   public:
+      /// @param [in] fileLength physical length of the E57 file, used to tell if it has changed
+      /// @param [in] sectionLogicalStart start of the CompressedVector's binary section
+      /// @param [in] recordCount number of records in the CompressedVector
+      /// @param [in] bytestreamCount number of bytestreams in each data packet
+      RecordIndex( uint64_t fileLength, uint64_t sectionLogicalStart, uint64_t recordCount,
+                   unsigned bytestreamCount );
+
+      /// Add the next data packet of the section, given the length of each bytestream in it.
+      void addPacket( uint64_t packetLogicalOffset, const std::vector<unsigned> &bufferLengths );
+
+      /// @returns true if this index was made for the given CompressedVector
+      bool matches( uint64_t fileLength, uint64_t sectionLogicalStart, uint64_t recordCount,
+                    unsigned bytestreamCount ) const;
+
+      /// @returns total length of a bytestream in all packets
+      uint64_t bytestreamLength( unsigned bytestreamNumber ) const;
+
+      /// Find the data packet holding byteOffset of a bytestream, where it is in that packet's
+      /// buffer for the bytestream, and how long that buffer is. An offset at the end of the
+      /// bytestream is found at the end of the last packet.
+      /// @returns false if byteOffset is past the end of the bytestream
+      bool find( unsigned bytestreamNumber, uint64_t byteOffset, uint64_t &packetLogicalOffset,
+                 size_t &bufferIndex, size_t &bufferLength ) const;
+
+      /// Write the index to a file. It uses the same checksummed pages as an E57 file.
+      void write( const ustring &fileName ) const;
+
+      /// Read an index written by write().
+      /// @throw ::ErrorBadCVPacket if its offsets aren't those of the packets of a section
+      static std::unique_ptr<RecordIndex> read( const ustring &fileName );
+
+   private:
+      /// Check that the offsets read from fileName can be used by find()
+      void validate( const ustring &fileName ) const;
+
+      uint64_t fileLength_;
+      uint64_t sectionLogicalStart_;
+      uint64_t recordCount_;
+      unsigned bytestreamCount_;
+
+      std::vector<uint64_t> packetLogicalOffsets_;
+
+      // Offset of each packet's data in each bytestream, bytestreamCount_ per packet
+      std::vector<uint64_t> bytestreamOffsets_;
+
+      // Total length of each bytestream so far
+      std::vector<uint64_t> bytestreamLengths_;
+   };
+}
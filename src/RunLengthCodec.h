@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeltaCodec.h"
+
+namespace e57
+{
+   // Layout of bytestreams written with the run-length codec extension (see
+   // RUN_LENGTH_CODEC_URI).
+   //
+   // The values are stored as runs of records with the same value. Every chunk starts with a new
+   // run (see CHUNK_RECORD_ALIGNMENT). Each run is:
+   //    varint   number of records - 1, 7 bits per byte, least significant first, with the top
+   //             bit set in all bytes but the last
+   //    value    value - minimum, in as few bytes as hold maximum - minimum (little endian)
+   //
+   // Encoders take records in blocks of RUN_LENGTH_BLOCK_SIZE, each of which may end as many runs.
+   constexpr unsigned RUN_LENGTH_BLOCK_SIZE = 64;
+   constexpr unsigned RUN_LENGTH_COUNT_MAX_SIZE = 10;
+   constexpr unsigned RUN_LENGTH_RUN_MAX_SIZE = RUN_LENGTH_COUNT_MAX_SIZE + 8;
+
+   /// Number of bytes holding the value of a run (the same as the base of a delta block)
+   inline unsigned runLengthValueSize( int64_t minimum, int64_t maximum )
+   {
+      return deltaBaseSize( minimum, maximum );
+   }
+
+   /// Write a run to output, which must have room for RUN_LENGTH_RUN_MAX_SIZE bytes
+   /// @returns the number of bytes written
+   inline size_t runLengthWriteRun( char *output, uint64_t recordCount, uint64_t value,
+                                    unsigned valueSize )
+   {
+      auto outp = reinterpret_cast<uint8_t *>( output );
+
+      uint64_t count = recordCount - 1;
+      while ( count >= 0x80 )
+      {
+         *outp++ = static_cast<uint8_t>( count | 0x80 );
+         count >>= 7;
+      }
+      *outp++ = static_cast<uint8_t>( count );
+
+      for ( unsigned b = 0; b < valueSize; b++ )
+      {
+         *outp++ = static_cast<uint8_t>( value >> ( 8 * b ) );
+      }
+
+      return static_cast<size_t>( outp - reinterpret_cast<uint8_t *>( output ) );
+   }
+
+   /// Read the run at the start of input
+   /// @returns the number of bytes read, or 0 if the run is longer than availableByteCount
+   /// @throw ::ErrorBadCVPacket
+   inline size_t runLengthReadRun( const char *input, size_t availableByteCount,
+                                   unsigned valueSize, uint64_t &recordCount, uint64_t &value )
+   {
+      auto inp = reinterpret_cast<const uint8_t *>( input );
+
+      uint64_t count = 0;
+      size_t i = 0;
+
+      while ( true )
+      {
+         if ( i == RUN_LENGTH_COUNT_MAX_SIZE )
+         {
+            throw E57_EXCEPTION2( ErrorBadCVPacket, "runLengthCountSize=" + toString( i ) );
+         }
+
+         if ( i == availableByteCount )
+         {
+            return 0;
+         }
+
+         count |= static_cast<uint64_t>( inp[i] & 0x7F ) << ( 7 * i );
+
+         if ( ( inp[i++] & 0x80 ) == 0 )
+         {
+            break;
+         }
+      }
+
+      if ( availableByteCount - i < valueSize )
+      {
+         return 0;
+      }
+
+      value = 0;
+      for ( unsigned b = 0; b < valueSize; b++ )
+      {
+         value |= static_cast<uint64_t>( inp[i++] ) << ( 8 * b );
+      }
+
+      recordCount = count + 1;
+
+      return i;
+   }
+}
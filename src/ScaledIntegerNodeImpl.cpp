@@ -199,7 +199,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       cf << space( indent ) << "<" << fieldName << " type=\"ScaledInteger\"";
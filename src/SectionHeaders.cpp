@@ -30,6 +30,47 @@
 
 namespace e57
 {
+   void BlobSectionHeader::verify( uint64_t blobLogicalLength, uint64_t filePhysicalSize ) const
+   {
+      if ( sectionId != BLOB_SECTION )
+      {
+         throw E57_EXCEPTION2( ErrorBadBlobHeader, "sectionId=" + toString( sectionId ) );
+      }
+
+      // Verify reserved fields are zero
+      for ( unsigned i = 0; i < sizeof( reserved1 ); i++ )
+      {
+         if ( reserved1[i] != 0 )
+         {
+            throw E57_EXCEPTION2( ErrorBadBlobHeader,
+                                  "i=" + toString( i ) + " reserved=" + toString( reserved1[i] ) );
+         }
+      }
+
+      // Check section length is multiple of 4
+      if ( sectionLogicalLength % 4 )
+      {
+         throw E57_EXCEPTION2( ErrorBadBlobHeader,
+                               "sectionLogicalLength=" + toString( sectionLogicalLength ) );
+      }
+
+      // Check the section holds the header and the blob
+      if ( sectionLogicalLength < sizeof( *this ) + blobLogicalLength )
+      {
+         throw E57_EXCEPTION2( ErrorBadBlobHeader,
+                               "sectionLogicalLength=" + toString( sectionLogicalLength ) +
+                                  " blobLogicalLength=" + toString( blobLogicalLength ) );
+      }
+
+      // Check sectionLogicalLength is in bounds
+      if ( filePhysicalSize > 0 && sectionLogicalLength >= filePhysicalSize )
+      {
+         throw E57_EXCEPTION2( ErrorBadBlobHeader,
+                               "sectionLogicalLength=" + toString( sectionLogicalLength ) +
+                                  " filePhysicalSize=" + toString( filePhysicalSize ) );
+      }
+   }
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
    void BlobSectionHeader::dump( int indent, std::ostream &os ) const
    {
@@ -43,6 +43,9 @@ namespace e57
       uint8_t reserved1[7] = {};         // must be zero
       uint64_t sectionLogicalLength = 0; // byte length of whole section
 
+      /// Check the header of a section holding blobLogicalLength bytes
+      void verify( uint64_t blobLogicalLength, uint64_t filePhysicalSize = 0 ) const;
+
 #ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
 #endif
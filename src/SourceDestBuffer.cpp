@@ -48,6 +48,7 @@ void SourceDestBuffer::checkInvariant( bool /*doRecurse*/ ) const
 
          case Int16:
          case UInt16:
+         case Real16:
             return 2;
 
          case Int32:
@@ -302,6 +303,39 @@ SourceDestBuffer::SourceDestBuffer( const ImageFile &destImageFile, const ustrin
 {
 }
 
+/*!
+@brief Designate a column of strings in one block of characters as the source/destination of a
+transfer of strings.
+
+@param [in] destImageFile The ImageFile where the new node will eventually be stored.
+@param [in] pathName The pathname of the field in CompressedVectorNode that will transfer data
+to/from.
+@param [in] b The caller allocated StringColumn.
+@param [in] capacity The largest number of strings transferred at a time.
+
+@details
+This works like the std::vector<ustring> form of the SourceDestBuffer constructor, except that the
+strings are kept in one block of characters, so no string is allocated on its own (e.g. for labels
+of each point). When reading, each CompressedVectorReader::read() replaces the strings in @a b with
+up to @a capacity strings read, reusing its memory. When writing, @a b must hold at least as many
+strings as are written from it.
+
+The memory representation of the SourceDestBuffer is ::UString.
+
+@throw ::ErrorBadAPIArgument
+@throw ::ErrorBadPathName
+@throw ::ErrorBadBuffer
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorInternal All objects in undocumented state
+
+@see SourceDestBuffer::SourceDestBuffer(const ImageFile&, const ustring&, std::vector<ustring>*)
+*/
+SourceDestBuffer::SourceDestBuffer( const ImageFile &destImageFile, const ustring &pathName,
+                                    StringColumn *b, size_t capacity ) :
+   impl_( new SourceDestBufferImpl( destImageFile.impl(), pathName, b, capacity ) )
+{
+}
+
 /*!
 @brief Get path name in prototype that this SourceDestBuffer will transfer data to/from.
 
@@ -460,6 +494,50 @@ size_t SourceDestBuffer::stride() const
    return impl_->stride();
 }
 
+/*!
+@brief Store the values read into a uint16_t buffer as IEEE 754 half precision floats
+
+@details
+The memory representation of the buffer becomes ::Real16. Values are converted from float or double
+(or from integers with doConversion) to the nearest half precision value as they are read, e.g. for
+surface normals, which seldom need more precision. Call this before the buffer is given to a
+CompressedVectorReader. Buffers set up this way can only be read into, not written from.
+
+@throw ::ErrorBadAPIArgument if the buffer isn't a uint16_t buffer
+@throw ::ErrorInternal All objects in undocumented state
+
+@see SourceDestBuffer::setNormalizedRange
+*/
+void SourceDestBuffer::setHalfPrecision()
+{
+   impl_->setHalfPrecision();
+}
+
+/*!
+@brief Store the values read into a uint8_t or uint16_t buffer normalized to the range of its type,
+or into a float or double buffer normalized to 0..1
+
+@param [in] minimum Value stored as 0
+@param [in] maximum Value stored as 255 (uint8_t), 65535 (uint16_t), or 1 (float and double)
+
+@details
+Each value is mapped linearly from @a minimum..@a maximum, rounded for integer buffers, and clamped
+to the range of the type (0..1 for floating point buffers), e.g. for intensities normalized from the
+limits of their field. The values are converted as they are decoded, in the same pass. Call this
+before the buffer is given to a CompressedVectorReader. Buffers set up this way can only be read
+into, not written from.
+
+@throw ::ErrorBadAPIArgument if the buffer isn't a uint8_t, uint16_t, float, or double buffer, or
+@a maximum isn't greater than @a minimum
+@throw ::ErrorInternal All objects in undocumented state
+
+@see SourceDestBuffer::setHalfPrecision
+*/
+void SourceDestBuffer::setNormalizedRange( double minimum, double maximum )
+{
+   impl_->setNormalizedRange( minimum, maximum );
+}
+
 /*!
 @brief Diagnostic function to print internal state of object to output stream in an indented format.
 @copydetails Node::dump()
@@ -26,7 +26,11 @@
  */
 
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
 
+#include "HalfFloat.h"
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
 #include "StringFunctions.h"
@@ -40,6 +44,10 @@ SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile,
    pathName_( pathName ), memoryRepresentation_( Int32 ), capacity_( capacity ),
    doConversion_( doConversion ), doScaling_( doScaling )
 {
+   if ( ImageFileImplSharedPtr imf = destImageFile.lock() )
+   {
+      validationLevel_ = imf->validationLevel();
+   }
 }
 
 template <typename T> void SourceDestBufferImpl::setTypeInfo( T *base, size_t stride )
@@ -107,6 +115,51 @@ template void SourceDestBufferImpl::setTypeInfo<bool>( bool *base, size_t stride
 template void SourceDestBufferImpl::setTypeInfo<float>( float *base, size_t stride );
 template void SourceDestBufferImpl::setTypeInfo<double>( double *base, size_t stride );
 
+void SourceDestBufferImpl::setHalfPrecision()
+{
+   if ( memoryRepresentation_ != UInt16 )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                            "pathName=" + pathName_ +
+                               " memoryRepresentation=" + toString( memoryRepresentation_ ) );
+   }
+
+   memoryRepresentation_ = Real16;
+}
+
+void SourceDestBufferImpl::setNormalizedRange( double minimum, double maximum )
+{
+   if ( memoryRepresentation_ != UInt8 && memoryRepresentation_ != UInt16 &&
+        memoryRepresentation_ != Real32 && memoryRepresentation_ != Real64 )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                            "pathName=" + pathName_ +
+                               " memoryRepresentation=" + toString( memoryRepresentation_ ) );
+   }
+
+   if ( !( minimum < maximum ) || !std::isfinite( maximum - minimum ) )
+   {
+      throw E57_EXCEPTION2( ErrorBadAPIArgument, "pathName=" + pathName_ +
+                                                    " minimum=" + toString( minimum ) +
+                                                    " maximum=" + toString( maximum ) );
+   }
+
+   double largest = 1.0;
+
+   if ( memoryRepresentation_ == UInt8 )
+   {
+      largest = UINT8_MAX;
+   }
+   else if ( memoryRepresentation_ == UInt16 )
+   {
+      largest = UINT16_MAX;
+   }
+
+   normalized_ = true;
+   normalizedMinimum_ = minimum;
+   normalizedFactor_ = largest / ( maximum - minimum );
+}
+
 SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile,
                                             const ustring &pathName, std::vector<ustring> *b ) :
    destImageFile_( destImageFile ),
@@ -129,6 +182,23 @@ SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile,
    /// stored in it.
 }
 
+SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile,
+                                            const ustring &pathName, StringColumn *b,
+                                            size_t capacity ) :
+   destImageFile_( destImageFile ),
+   pathName_( pathName ), memoryRepresentation_( UString ), capacity_( capacity ),
+   stringColumn_( b )
+{
+   /// don't checkImageFileOpen, checkState_ will do it
+
+   if ( b == nullptr )
+   {
+      throw E57_EXCEPTION2( ErrorBadBuffer, "sdbuf.pathName=" + pathName );
+   }
+
+   checkState_();
+}
+
 template <typename T> void SourceDestBufferImpl::_setNextReal( T inValue )
 {
    static_assert( std::is_same<T, double>::value || std::is_same<T, float>::value,
@@ -144,6 +214,12 @@ template <typename T> void SourceDestBufferImpl::_setNextReal( T inValue )
 
    /// Calc start of memory location, index into buffer using stride_ (the
    /// distance between elements).
+   if ( isEncoded() )
+   {
+      setNextEncoded_( static_cast<double>( inValue ) );
+      return;
+   }
+
    char *p = &base_[nextIndex_ * stride_];
 
    switch ( memoryRepresentation_ )
@@ -273,6 +349,9 @@ template <typename T> void SourceDestBufferImpl::_setNextReal( T inValue )
          break;
       case UString:
          throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      case Real16:
+         /// Encoded buffers are set by setNextEncoded_()
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
    nextIndex_++;
@@ -290,8 +369,7 @@ void SourceDestBufferImpl::checkState_() const
 
    /// Check pathName is well formed (can't verify path is defined until
    /// associate sdbuffer with CompressedVector later)
-   ImageFileImplSharedPtr imf( destImageFile_ );
-   imf->pathNameCheckWellFormed( pathName_ );
+   destImageFile->pathNameCheckWellFormed( pathName_ );
 
    if ( memoryRepresentation_ != UString )
    {
@@ -308,7 +386,7 @@ void SourceDestBufferImpl::checkState_() const
    }
    else
    {
-      if ( ustrings_ == nullptr )
+      if ( ustrings_ == nullptr && stringColumn_ == nullptr )
       {
          throw E57_EXCEPTION2( ErrorBadBuffer, "pathName=" + pathName_ );
       }
@@ -709,10 +787,58 @@ ustring SourceDestBufferImpl::getNextString()
       throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
+   if ( stringColumn_ != nullptr )
+   {
+      const char *data = nullptr;
+      size_t length = 0;
+
+      getNextString( data, length );
+
+      return ustring( data, length );
+   }
+
    /// Get ustring from vector
    return ( ( *ustrings_ )[nextIndex_++] );
 }
 
+void SourceDestBufferImpl::getNextString( const char *&data, size_t &length )
+{
+   /// don't checkImageFileOpen
+
+   /// Check have correct type buffer
+   if ( memoryRepresentation_ != UString )
+   {
+      throw E57_EXCEPTION2( ErrorExpectingUString, "pathName=" + pathName_ );
+   }
+
+   /// Verify index is within bounds
+   if ( nextIndex_ >= capacity_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   if ( stringColumn_ == nullptr )
+   {
+      const ustring &value = ( *ustrings_ )[nextIndex_++];
+
+      data = value.data();
+      length = value.length();
+      return;
+   }
+
+   /// The column must hold every string written from it
+   if ( nextIndex_ >= stringColumn_->size() )
+   {
+      throw E57_EXCEPTION2( ErrorBadBuffer, "pathName=" + pathName_ +
+                                               " index=" + toString( nextIndex_ ) +
+                                               " size=" + toString( stringColumn_->size() ) );
+   }
+
+   data = stringColumn_->data( nextIndex_ );
+   length = stringColumn_->length( nextIndex_ );
+   nextIndex_++;
+}
+
 void SourceDestBufferImpl::setNextInt64( int64_t value )
 {
    /// don't checkImageFileOpen
@@ -723,6 +849,17 @@ void SourceDestBufferImpl::setNextInt64( int64_t value )
       throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
+   if ( isEncoded() )
+   {
+      if ( memoryRepresentation_ == Real16 && !doConversion_ )
+      {
+         throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+      }
+
+      setNextEncoded_( static_cast<double>( value ) );
+      return;
+   }
+
    /// Calc start of memory location, index into buffer using stride_ (the
    /// distance between elements).
    char *p = &base_[nextIndex_ * stride_];
@@ -800,6 +937,9 @@ void SourceDestBufferImpl::setNextInt64( int64_t value )
          break;
       case UString:
          throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      case Real16:
+         /// Encoded buffers are set by setNextEncoded_()
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
    nextIndex_++;
@@ -828,6 +968,17 @@ void SourceDestBufferImpl::setNextInt64( int64_t value, double scale, double off
       throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
+   if ( isEncoded() )
+   {
+      if ( memoryRepresentation_ == Real16 && !doConversion_ )
+      {
+         throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+      }
+
+      setNextEncoded_( value * scale + offset );
+      return;
+   }
+
    /// Calc start of memory location, index into buffer using stride_ (the
    /// distance between elements).
    char *p = &base_[nextIndex_ * stride_];
@@ -934,6 +1085,9 @@ void SourceDestBufferImpl::setNextInt64( int64_t value, double scale, double off
          break;
       case UString:
          throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      case Real16:
+         /// Encoded buffers are set by setNextEncoded_()
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
    nextIndex_++;
@@ -950,6 +1104,11 @@ void SourceDestBufferImpl::setNextDouble( double value )
 }
 
 void SourceDestBufferImpl::setNextString( const ustring &value )
+{
+   setNextString( value.data(), value.length() );
+}
+
+void SourceDestBufferImpl::setNextString( const char *data, size_t length )
 {
    /// don't checkImageFileOpen
 
@@ -964,94 +1123,1140 @@ void SourceDestBufferImpl::setNextString( const ustring &value )
       throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
 
-   /// Assign to already initialized element in vector
-   ( *ustrings_ )[nextIndex_] = value;
+   if ( stringColumn_ != nullptr )
+   {
+      /// A read replaces the strings in the column
+      if ( nextIndex_ == 0 )
+      {
+         stringColumn_->clear();
+      }
+
+      stringColumn_->append( data, length );
+      nextIndex_++;
+      return;
+   }
+
+   /// Assign to already initialized element in vector, reusing its memory
+   ( *ustrings_ )[nextIndex_].assign( data, length );
    nextIndex_++;
 }
 
-void SourceDestBufferImpl::checkCompatible(
-   const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const
+double SourceDestBufferImpl::doubleAt( size_t index ) const
 {
-   if ( pathName_ != newBuf->pathName() )
+   if ( index >= nextIndex_ )
    {
-      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                            "pathName=" + pathName_ + " newPathName=" + newBuf->pathName() );
+      throw E57_EXCEPTION2( ErrorInternal,
+                            "pathName=" + pathName_ + " index=" + toString( index ) +
+                               " nextIndex=" + toString( nextIndex_ ) );
    }
-   if ( memoryRepresentation_ != newBuf->memoryRepresentation() )
+
+   return elementAt( index );
+}
+
+double SourceDestBufferImpl::elementAt( size_t index ) const
+{
+   if ( index >= capacity_ )
    {
-      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                            "memoryRepresentation=" + toString( memoryRepresentation_ ) +
-                               " newMemoryType=" + toString( newBuf->memoryRepresentation() ) );
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ + " index=" + toString( index ) +
+                                              " capacity=" + toString( capacity_ ) );
    }
-   if ( capacity_ != newBuf->capacity() )
+
+   const char *p = &base_[index * stride_];
+
+   switch ( memoryRepresentation_ )
    {
-      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                            "capacity=" + toString( capacity_ ) +
-                               " newCapacity=" + toString( newBuf->capacity() ) );
+      case Int8:
+         return static_cast<double>( *reinterpret_cast<const int8_t *>( p ) );
+      case UInt8:
+         return static_cast<double>( *reinterpret_cast<const uint8_t *>( p ) );
+      case Int16:
+         return static_cast<double>( *reinterpret_cast<const int16_t *>( p ) );
+      case UInt16:
+         return static_cast<double>( *reinterpret_cast<const uint16_t *>( p ) );
+      case Int32:
+         return static_cast<double>( *reinterpret_cast<const int32_t *>( p ) );
+      case UInt32:
+         return static_cast<double>( *reinterpret_cast<const uint32_t *>( p ) );
+      case Int64:
+         return static_cast<double>( *reinterpret_cast<const int64_t *>( p ) );
+      case Bool:
+         return *reinterpret_cast<const bool *>( p ) ? 1.0 : 0.0;
+      case Real32:
+         return static_cast<double>( *reinterpret_cast<const float *>( p ) );
+      case Real64:
+         return *reinterpret_cast<const double *>( p );
+      case Real16:
+         return static_cast<double>( halfToFloat( *reinterpret_cast<const uint16_t *>( p ) ) );
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
    }
-   if ( doConversion_ != newBuf->doConversion() )
+
+   throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+}
+
+void SourceDestBufferImpl::moveElement( size_t from, size_t to )
+{
+   if ( ( from >= nextIndex_ ) || ( to >= nextIndex_ ) )
    {
-      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                            "doConversion=" + toString( doConversion_ ) +
-                               "newDoConversion=" + toString( newBuf->doConversion() ) );
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ + " from=" + toString( from ) +
+                                              " to=" + toString( to ) +
+                                              " nextIndex=" + toString( nextIndex_ ) );
    }
-   if ( stride_ != newBuf->stride() )
+
+   if ( stringColumn_ != nullptr )
    {
-      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
-                            "stride=" + toString( stride_ ) +
-                               " newStride=" + toString( newBuf->stride() ) );
+      /// Elements are moved down in order, so the characters only overlap those being replaced
+      StringColumn &column = *stringColumn_;
+      const size_t length = column.length( from );
+      const auto start = static_cast<size_t>( column.offsets[to] );
+
+      memmove( column.chars.data() + start, column.data( from ), length );
+      column.offsets[to + 1] = start + length;
+      return;
+   }
+
+   if ( memoryRepresentation_ == UString )
+   {
+      ( *ustrings_ )[to] = std::move( ( *ustrings_ )[from] );
+      return;
    }
+
+   memcpy( &base_[to * stride_], &base_[from * stride_], elementSize_() );
 }
 
-#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
-void SourceDestBufferImpl::dump( int indent, std::ostream &os )
+size_t SourceDestBufferImpl::elementSize_() const
 {
-   /// don't checkImageFileOpen
-
-   os << space( indent ) << "pathName:             " << pathName_ << std::endl;
-   os << space( indent ) << "memoryRepresentation: ";
    switch ( memoryRepresentation_ )
    {
       case Int8:
-         os << "int8_t" << std::endl;
-         break;
       case UInt8:
-         os << "uint8_t" << std::endl;
-         break;
+         return sizeof( int8_t );
       case Int16:
-         os << "int16_t" << std::endl;
-         break;
       case UInt16:
-         os << "uint16_t" << std::endl;
-         break;
+      case Real16:
+         return sizeof( int16_t );
       case Int32:
-         os << "int32_t" << std::endl;
-         break;
       case UInt32:
-         os << "uint32_t" << std::endl;
-         break;
+         return sizeof( int32_t );
       case Int64:
-         os << "int64_t" << std::endl;
-         break;
+         return sizeof( int64_t );
       case Bool:
-         os << "bool" << std::endl;
-         break;
+         return sizeof( bool );
       case Real32:
-         os << "float" << std::endl;
-         break;
+         return sizeof( float );
       case Real64:
-         os << "double" << std::endl;
-         break;
+         return sizeof( double );
       case UString:
-         os << "ustring" << std::endl;
          break;
-      default:
-         os << "<unknown>" << std::endl;
+   }
+
+   return 0;
+}
+
+template <typename T> void SourceDestBufferImpl::fillNextAs_( size_t count )
+{
+   T element;
+   memcpy( &element, &base_[( nextIndex_ - 1 ) * stride_], sizeof( T ) );
+
+   char *p = &base_[nextIndex_ * stride_];
+
+   if ( stride_ == sizeof( T ) )
+   {
+      std::fill_n( reinterpret_cast<T *>( p ), count, element );
+   }
+   else
+   {
+      for ( size_t i = 0; i < count; ++i, p += stride_ )
+      {
+         memcpy( p, &element, sizeof( T ) );
+      }
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::fillNext_( size_t count )
+{
+   switch ( elementSize_() )
+   {
+      case 1:
+         fillNextAs_<uint8_t>( count );
+         break;
+      case 2:
+         fillNextAs_<uint16_t>( count );
          break;
+      case 4:
+         fillNextAs_<uint32_t>( count );
+         break;
+      case 8:
+         fillNextAs_<uint64_t>( count );
+         break;
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
    }
-   os << space( indent ) << "base:                 " << static_cast<const void *>( base_ )
-      << std::endl;
-   os << space( indent ) << "ustrings:             " << static_cast<const void *>( ustrings_ )
+}
+
+void SourceDestBufferImpl::setNextInt64Fill( int64_t value, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Convert (and check) the value once, then copy it
+   setNextInt64( value );
+   fillNext_( count - 1 );
+}
+
+void SourceDestBufferImpl::setNextInt64Fill( int64_t value, size_t count, double scale,
+                                             double offset )
+{
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Convert (and check) the value once, then copy it
+   setNextInt64( value, scale, offset );
+   fillNext_( count - 1 );
+}
+
+template <typename T> bool SourceDestBufferImpl::isContiguous_() const
+{
+   const MemoryRepresentation representation = std::is_same<T, float>::value ? Real32 : Real64;
+
+   return ( memoryRepresentation_ == representation ) && ( stride_ == sizeof( T ) );
+}
+
+void SourceDestBufferImpl::checkBlockBounds_( size_t count ) const
+{
+   /// Verify the whole block is within bounds
+   if ( count > capacity_ - nextIndex_ )
+   {
+      throw E57_EXCEPTION2( ErrorInternal,
+                            "pathName=" + pathName_ + " count=" + toString( count ) +
+                               " nextIndex=" + toString( nextIndex_ ) );
+   }
+}
+
+template <typename SrcT, typename DstT, typename ConvertT>
+void SourceDestBufferImpl::getNextBlock_( DstT *values, size_t count, ConvertT convert )
+{
+   const char *p = &base_[nextIndex_ * stride_];
+   size_t i = 0;
+
+   try
+   {
+      for ( ; i < count; ++i, p += stride_ )
+      {
+         values[i] = convert( *reinterpret_cast<const SrcT *>( p ) );
+      }
+   }
+   catch ( ... )
+   {
+      /// Count the values before the one that failed, as the single value functions would
+      nextIndex_ += static_cast<unsigned>( i );
+      throw;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename DstT, typename SrcT, typename ConvertT>
+void SourceDestBufferImpl::setNextBlock_( const SrcT *values, size_t count, ConvertT convert )
+{
+   char *p = &base_[nextIndex_ * stride_];
+   size_t i = 0;
+
+   try
+   {
+      for ( ; i < count; ++i, p += stride_ )
+      {
+         *reinterpret_cast<DstT *>( p ) = convert( values[i] );
+      }
+   }
+   catch ( ... )
+   {
+      /// Count the values before the one that failed, as the single value functions would
+      nextIndex_ += static_cast<unsigned>( i );
+      throw;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::getNextInt64Block( int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   auto toInt64 = []( auto value ) { return static_cast<int64_t>( value ); };
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         getNextBlock_<int8_t>( values, count, toInt64 );
+         break;
+      case UInt8:
+         getNextBlock_<uint8_t>( values, count, toInt64 );
+         break;
+      case Int16:
+         getNextBlock_<int16_t>( values, count, toInt64 );
+         break;
+      case UInt16:
+         getNextBlock_<uint16_t>( values, count, toInt64 );
+         break;
+      case Int32:
+         getNextBlock_<int32_t>( values, count, toInt64 );
+         break;
+      case UInt32:
+         getNextBlock_<uint32_t>( values, count, toInt64 );
+         break;
+      case Int64:
+         getNextBlock_<int64_t>( values, count, toInt64 );
+         break;
+      case Bool:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         /// Convert bool to 0/1
+         getNextBlock_<bool>( values, count, []( bool value ) { return value ? 1 : 0; } );
+         break;
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         getNextBlock_<float>( values, count, toInt64 );
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         getNextBlock_<double>( values, count, toInt64 );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::getNextInt64Block( int64_t *values, size_t count, double scale,
+                                              double offset )
+{
+   /// don't checkImageFileOpen
+
+   /// If the user did not request scaling, then we get raw values from user's buffer.
+   if ( !doScaling_ )
+   {
+      getNextInt64Block( values, count );
+      return;
+   }
+
+   /// Double check non-zero scale.  Going to divide by it below.
+   if ( scale == 0 )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure
+   /// is in bounds
+   auto unscale = [this, scale, offset]( auto value ) {
+      const double doubleRawValue = floor( ( value - offset ) / scale + 0.5 );
+
+      if ( doubleRawValue < INT64_MIN || INT64_MAX < doubleRawValue )
+      {
+         throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                               "pathName=" + pathName_ + " value=" + toString( doubleRawValue ) );
+      }
+
+      return static_cast<int64_t>( doubleRawValue );
+   };
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         getNextBlock_<int8_t>( values, count, unscale );
+         break;
+      case UInt8:
+         getNextBlock_<uint8_t>( values, count, unscale );
+         break;
+      case Int16:
+         getNextBlock_<int16_t>( values, count, unscale );
+         break;
+      case UInt16:
+         getNextBlock_<uint16_t>( values, count, unscale );
+         break;
+      case Int32:
+         getNextBlock_<int32_t>( values, count, unscale );
+         break;
+      case UInt32:
+         getNextBlock_<uint32_t>( values, count, unscale );
+         break;
+      case Int64:
+         getNextBlock_<int64_t>( values, count, unscale );
+         break;
+      case Bool:
+         getNextBlock_<bool>( values, count,
+                              [&unscale]( bool value ) { return unscale( value ? 1 : 0 ); } );
+         break;
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         getNextBlock_<float>( values, count, unscale );
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? fault if get special value: NaN, NegInf...
+         getNextBlock_<double>( values, count, unscale );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+template <typename DstT> void SourceDestBufferImpl::getNextRealBlock_( DstT *values, size_t count )
+{
+   static_assert( std::is_same<DstT, double>::value || std::is_same<DstT, float>::value,
+                  "getNextRealBlock_() requires float or double type" );
+
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// Convert from other formats to floating point if requested
+   if ( !doConversion_ && memoryRepresentation_ != Real32 && memoryRepresentation_ != Real64 &&
+        memoryRepresentation_ != UString )
+   {
+      throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+   }
+
+   /// Values stored in the same precision in a plain array are copied as they are
+   if ( isContiguous_<DstT>() )
+   {
+      memcpy( values, &base_[nextIndex_ * stride_], count * sizeof( DstT ) );
+      nextIndex_ += static_cast<unsigned>( count );
+      return;
+   }
+
+   auto toReal = []( auto value ) { return static_cast<DstT>( value ); };
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         getNextBlock_<int8_t>( values, count, toReal );
+         break;
+      case UInt8:
+         getNextBlock_<uint8_t>( values, count, toReal );
+         break;
+      case Int16:
+         getNextBlock_<int16_t>( values, count, toReal );
+         break;
+      case UInt16:
+         getNextBlock_<uint16_t>( values, count, toReal );
+         break;
+      case Int32:
+         getNextBlock_<int32_t>( values, count, toReal );
+         break;
+      case UInt32:
+         getNextBlock_<uint32_t>( values, count, toReal );
+         break;
+      case Int64:
+         getNextBlock_<int64_t>( values, count, toReal );
+         break;
+      case Bool:
+         /// Convert bool to 0/1
+         getNextBlock_<bool>( values, count,
+                              []( bool value ) { return value ? DstT( 1 ) : DstT( 0 ); } );
+         break;
+      case Real32:
+         getNextBlock_<float>( values, count, toReal );
+         break;
+      case Real64:
+         if ( std::is_same<DstT, float>::value )
+         {
+            /// Check that exponent of user's value is not too large for single precision number
+            /// in file.
+            getNextBlock_<double>( values, count, [this]( double value ) {
+               if ( value < DOUBLE_MIN || DOUBLE_MAX < value )
+               {
+                  throw E57_EXCEPTION2( ErrorReal64TooLarge,
+                                        "pathName=" + pathName_ + " value=" + toString( value ) );
+               }
+               return static_cast<DstT>( value );
+            } );
+         }
+         else
+         {
+            getNextBlock_<double>( values, count, toReal );
+         }
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+void SourceDestBufferImpl::getNextFloatBlock( float *values, size_t count )
+{
+   getNextRealBlock_( values, count );
+}
+
+void SourceDestBufferImpl::getNextDoubleBlock( double *values, size_t count )
+{
+   getNextRealBlock_( values, count );
+}
+
+template <typename DstT, typename SrcT>
+void SourceDestBufferImpl::setNextCheckedBlock_( const SrcT *values, size_t count )
+{
+   if ( validationLevel_ == ValidationNone )
+   {
+      setNextBlock_<DstT>( values, count,
+                           []( SrcT value ) { return static_cast<DstT>( value ); } );
+      return;
+   }
+
+   setNextBlock_<DstT>( values, count, [this]( SrcT value ) {
+      if ( value < std::numeric_limits<DstT>::min() || std::numeric_limits<DstT>::max() < value )
+      {
+         throw E57_EXCEPTION2( ErrorValueNotRepresentable,
+                               "pathName=" + pathName_ + " value=" + toString( value ) );
+      }
+
+      return static_cast<DstT>( value );
+   } );
+}
+
+void SourceDestBufferImpl::setNextInt64Block( const int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   if ( isEncoded() )
+   {
+      if ( memoryRepresentation_ == Real16 && !doConversion_ )
+      {
+         throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+      }
+
+      setNextEncodedBlock_( values, count,
+                            []( int64_t value ) { return static_cast<double>( value ); } );
+      return;
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         setNextCheckedBlock_<int8_t>( values, count );
+         break;
+      case UInt8:
+         setNextCheckedBlock_<uint8_t>( values, count );
+         break;
+      case Int16:
+         setNextCheckedBlock_<int16_t>( values, count );
+         break;
+      case UInt16:
+         setNextCheckedBlock_<uint16_t>( values, count );
+         break;
+      case Int32:
+         setNextCheckedBlock_<int32_t>( values, count );
+         break;
+      case UInt32:
+         setNextCheckedBlock_<uint32_t>( values, count );
+         break;
+      case Int64:
+         setNextBlock_<int64_t>( values, count, []( int64_t value ) { return value; } );
+         break;
+      case Bool:
+         setNextBlock_<bool>( values, count, []( int64_t value ) { return !value; } );
+         break;
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         //??? very large integers may lose some lowest bits here. error?
+         setNextBlock_<float>( values, count,
+                               []( int64_t value ) { return static_cast<float>( value ); } );
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         setNextBlock_<double>( values, count,
+                                []( int64_t value ) { return static_cast<double>( value ); } );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+template <typename DstT>
+void SourceDestBufferImpl::setNextScaledBlock_( const int64_t *values, size_t count,
+                                                double scale, double offset )
+{
+   if ( validationLevel_ == ValidationNone )
+   {
+      setNextBlock_<DstT>( values, count, [scale, offset]( int64_t value ) {
+         return static_cast<DstT>( floor( value * scale + offset + 0.5 ) );
+      } );
+      return;
+   }
+
+   /// Round to nearest integer, but keep in floating point until we know that the value is
+   /// representable in the user's buffer.
+   setNextBlock_<DstT>( values, count, [this, scale, offset]( int64_t value ) {
+      const double scaledValue = floor( value * scale + offset + 0.5 );
+
+      if ( scaledValue < std::numeric_limits<DstT>::min() ||
+           std::numeric_limits<DstT>::max() < scaledValue )
+      {
+         throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                               "pathName=" + pathName_ +
+                                  " scaledValue=" + toString( scaledValue ) );
+      }
+
+      return static_cast<DstT>( scaledValue );
+   } );
+}
+
+namespace
+{
+   /// Calc x*scale+offset for a block into a contiguous array. There are no branches in the loop
+   /// so the compiler can vectorize it. Returns false if any result is too big for a float.
+   template <typename DstT>
+   bool scaleContiguousBlock( const int64_t *values, size_t count, double scale, double offset,
+                              DstT *out )
+   {
+      bool representable = true;
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double scaledValue = static_cast<double>( values[i] ) * scale + offset;
+
+         if ( std::is_same<DstT, float>::value )
+         {
+            representable &= !( scaledValue < DOUBLE_MIN ) & !( DOUBLE_MAX < scaledValue );
+         }
+
+         out[i] = static_cast<DstT>( scaledValue );
+      }
+
+      return representable;
+   }
+}
+
+template <typename DstT>
+void SourceDestBufferImpl::setNextScaledRealBlock_( const int64_t *values, size_t count,
+                                                    double scale, double offset )
+{
+   /// Value will be stored in some floating point rep in user's buffer, so keep full resolution.
+   /// Check that exponent of result is not too big for single precision float.
+   auto scaleValue = [this, scale, offset]( int64_t value ) {
+      const double scaledValue = value * scale + offset;
+
+      if ( std::is_same<DstT, float>::value &&
+           ( scaledValue < DOUBLE_MIN || DOUBLE_MAX < scaledValue ) )
+      {
+         throw E57_EXCEPTION2( ErrorScaledValueNotRepresentable,
+                               "pathName=" + pathName_ +
+                                  " scaledValue=" + toString( scaledValue ) );
+      }
+
+      return static_cast<DstT>( scaledValue );
+   };
+
+   if ( stride_ != sizeof( DstT ) )
+   {
+      setNextBlock_<DstT>( values, count, scaleValue );
+      return;
+   }
+
+   /// The user's buffer is a plain array, so convert straight into it
+   auto out = reinterpret_cast<DstT *>( &base_[nextIndex_ * stride_] );
+
+   if ( !scaleContiguousBlock( values, count, scale, offset, out ) )
+   {
+      /// Redo the block with the checks to find the value which doesn't fit
+      setNextBlock_<DstT>( values, count, scaleValue );
+      return;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::setNextInt64Block( const int64_t *values, size_t count, double scale,
+                                              double offset )
+{
+   /// don't checkImageFileOpen
+
+   /// If the user did not request scaling, then we send raw values to user's buffer.
+   if ( !doScaling_ )
+   {
+      setNextInt64Block( values, count );
+      return;
+   }
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   if ( isEncoded() )
+   {
+      if ( memoryRepresentation_ == Real16 && !doConversion_ )
+      {
+         throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+      }
+
+      setNextEncodedBlock_( values, count, [scale, offset]( int64_t value ) {
+         return value * scale + offset;
+      } );
+      return;
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         setNextScaledBlock_<int8_t>( values, count, scale, offset );
+         break;
+      case UInt8:
+         setNextScaledBlock_<uint8_t>( values, count, scale, offset );
+         break;
+      case Int16:
+         setNextScaledBlock_<int16_t>( values, count, scale, offset );
+         break;
+      case UInt16:
+         setNextScaledBlock_<uint16_t>( values, count, scale, offset );
+         break;
+      case Int32:
+         setNextScaledBlock_<int32_t>( values, count, scale, offset );
+         break;
+      case UInt32:
+         setNextScaledBlock_<uint32_t>( values, count, scale, offset );
+         break;
+      case Int64:
+         setNextBlock_<int64_t>( values, count, [scale, offset]( int64_t value ) {
+            return static_cast<int64_t>( floor( value * scale + offset + 0.5 ) );
+         } );
+         break;
+      case Bool:
+         setNextBlock_<bool>( values, count, [scale, offset]( int64_t value ) {
+            return floor( value * scale + offset + 0.5 ) == 0.0;
+         } );
+         break;
+      case Real32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         setNextScaledRealBlock_<float>( values, count, scale, offset );
+         break;
+      case Real64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+         }
+         setNextScaledRealBlock_<double>( values, count, scale, offset );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+template <typename SrcT> void SourceDestBufferImpl::setNextRealBlock_( const SrcT *values,
+                                                                     size_t count )
+{
+   static_assert( std::is_same<SrcT, double>::value || std::is_same<SrcT, float>::value,
+                  "setNextRealBlock_() requires float or double type" );
+
+   /// don't checkImageFileOpen
+
+   checkBlockBounds_( count );
+
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   if ( isEncoded() )
+   {
+      setNextEncodedBlock_( values, count,
+                            []( SrcT value ) { return static_cast<double>( value ); } );
+      return;
+   }
+
+   if ( !doConversion_ && memoryRepresentation_ != Real32 && memoryRepresentation_ != Real64 &&
+        memoryRepresentation_ != UString )
+   {
+      throw E57_EXCEPTION2( ErrorConversionRequired, "pathName=" + pathName_ );
+   }
+
+   /// Values stored in the same precision in a plain array are copied as they are
+   if ( isContiguous_<SrcT>() )
+   {
+      memcpy( &base_[nextIndex_ * stride_], values, count * sizeof( SrcT ) );
+      nextIndex_ += static_cast<unsigned>( count );
+      return;
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      //??? fault if get special value: NaN, NegInf...  (all ints below)
+      case Int8:
+         setNextCheckedBlock_<int8_t>( values, count );
+         break;
+      case UInt8:
+         setNextCheckedBlock_<uint8_t>( values, count );
+         break;
+      case Int16:
+         setNextCheckedBlock_<int16_t>( values, count );
+         break;
+      case UInt16:
+         setNextCheckedBlock_<uint16_t>( values, count );
+         break;
+      case Int32:
+         setNextCheckedBlock_<int32_t>( values, count );
+         break;
+      case UInt32:
+         setNextCheckedBlock_<uint32_t>( values, count );
+         break;
+      case Int64:
+         setNextCheckedBlock_<int64_t>( values, count );
+         break;
+      case Bool:
+         setNextBlock_<bool>( values, count, []( SrcT value ) { return value == 0; } );
+         break;
+      case Real32:
+         if ( std::is_same<SrcT, double>::value )
+         {
+            /// Check for really large exponents that can't fit in a single precision
+            setNextBlock_<float>( values, count, [this]( SrcT value ) {
+               if ( value < DOUBLE_MIN || DOUBLE_MAX < value )
+               {
+                  throw E57_EXCEPTION2( ErrorValueNotRepresentable,
+                                        "pathName=" + pathName_ + " value=" + toString( value ) );
+               }
+               return static_cast<float>( value );
+            } );
+         }
+         else
+         {
+            setNextBlock_<float>( values, count,
+                                  []( SrcT value ) { return static_cast<float>( value ); } );
+         }
+         break;
+      case Real64:
+         setNextBlock_<double>( values, count,
+                                []( SrcT value ) { return static_cast<double>( value ); } );
+         break;
+      case UString:
+         throw E57_EXCEPTION2( ErrorExpectingNumeric, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( ErrorInternal, "pathName=" + pathName_ );
+   }
+}
+
+namespace
+{
+   /// Normalize a value to an integer type, clamping it to the range of the type, or to a
+   /// floating point type, clamping it to 0..1. NaN becomes 0. The selects have no branches, so
+   /// loops of this can be vectorized.
+   template <typename DstT> DstT normalizeValue( double value, double minimum, double factor )
+   {
+      constexpr bool isFloat = std::is_floating_point<DstT>::value;
+      constexpr double largest = isFloat ? 1.0 : std::numeric_limits<DstT>::max();
+
+      const double normalized = ( value - minimum ) * factor;
+      const double clamped =
+         ( normalized > 0.0 ) ? ( ( normalized < largest ) ? normalized : largest ) : 0.0;
+
+      return static_cast<DstT>( isFloat ? clamped : clamped + 0.5 );
+   }
+}
+
+uint16_t SourceDestBufferImpl::halfOf_( double value ) const
+{
+   /// NaN is stored as NaN, like it is for Real32
+   if ( std::fabs( value ) > HALF_MAX )
+   {
+      throw E57_EXCEPTION2( ErrorValueNotRepresentable,
+                            "pathName=" + pathName_ + " value=" + toString( value ) );
+   }
+
+   return floatToHalf( static_cast<float>( value ) );
+}
+
+void SourceDestBufferImpl::setNextEncoded_( double value )
+{
+   char *p = &base_[nextIndex_ * stride_];
+
+   if ( !normalized_ )
+   {
+      *reinterpret_cast<uint16_t *>( p ) = halfOf_( value );
+   }
+   else if ( memoryRepresentation_ == UInt8 )
+   {
+      *reinterpret_cast<uint8_t *>( p ) =
+         normalizeValue<uint8_t>( value, normalizedMinimum_, normalizedFactor_ );
+   }
+   else if ( memoryRepresentation_ == UInt16 )
+   {
+      *reinterpret_cast<uint16_t *>( p ) =
+         normalizeValue<uint16_t>( value, normalizedMinimum_, normalizedFactor_ );
+   }
+   else if ( memoryRepresentation_ == Real32 )
+   {
+      *reinterpret_cast<float *>( p ) =
+         normalizeValue<float>( value, normalizedMinimum_, normalizedFactor_ );
+   }
+   else
+   {
+      *reinterpret_cast<double *>( p ) =
+         normalizeValue<double>( value, normalizedMinimum_, normalizedFactor_ );
+   }
+
+   nextIndex_++;
+}
+
+template <typename DstT, typename SrcT, typename ToDoubleT>
+void SourceDestBufferImpl::setNextNormalizedBlock_( const SrcT *values, size_t count,
+                                                    ToDoubleT toDouble )
+{
+   const double minimum = normalizedMinimum_;
+   const double factor = normalizedFactor_;
+
+   auto normalize = [minimum, factor, toDouble]( SrcT value ) {
+      return normalizeValue<DstT>( toDouble( value ), minimum, factor );
+   };
+
+   if ( stride_ != sizeof( DstT ) )
+   {
+      setNextBlock_<DstT>( values, count, normalize );
+      return;
+   }
+
+   /// The user's buffer is a plain array, so convert straight into it
+   auto out = reinterpret_cast<DstT *>( &base_[nextIndex_ * stride_] );
+
+   for ( size_t i = 0; i < count; ++i )
+   {
+      out[i] = normalize( values[i] );
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename SrcT, typename ToDoubleT>
+void SourceDestBufferImpl::setNextEncodedBlock_( const SrcT *values, size_t count,
+                                                 ToDoubleT toDouble )
+{
+   if ( normalized_ )
+   {
+      switch ( memoryRepresentation_ )
+      {
+         case UInt8:
+            setNextNormalizedBlock_<uint8_t>( values, count, toDouble );
+            break;
+         case UInt16:
+            setNextNormalizedBlock_<uint16_t>( values, count, toDouble );
+            break;
+         case Real32:
+            setNextNormalizedBlock_<float>( values, count, toDouble );
+            break;
+         default:
+            setNextNormalizedBlock_<double>( values, count, toDouble );
+            break;
+      }
+      return;
+   }
+
+   if ( stride_ == sizeof( uint16_t ) )
+   {
+      /// The user's buffer is a plain array, so convert straight into it without checking each
+      /// value
+      auto out = reinterpret_cast<uint16_t *>( &base_[nextIndex_ * stride_] );
+      bool representable = true;
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double value = toDouble( values[i] );
+
+         representable &= !( std::fabs( value ) > HALF_MAX );
+         out[i] = floatToHalf( static_cast<float>( value ) );
+      }
+
+      if ( representable )
+      {
+         nextIndex_ += static_cast<unsigned>( count );
+         return;
+      }
+   }
+
+   /// Redo the block with the checks to find the value which doesn't fit
+   setNextBlock_<uint16_t>( values, count, [this, toDouble]( SrcT value ) {
+      return halfOf_( toDouble( value ) );
+   } );
+}
+
+void SourceDestBufferImpl::setNextFloatBlock( const float *values, size_t count )
+{
+   setNextRealBlock_( values, count );
+}
+
+void SourceDestBufferImpl::setNextDoubleBlock( const double *values, size_t count )
+{
+   setNextRealBlock_( values, count );
+}
+
+void SourceDestBufferImpl::checkCompatible(
+   const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const
+{
+   if ( pathName_ != newBuf->pathName() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "pathName=" + pathName_ + " newPathName=" + newBuf->pathName() );
+   }
+   if ( memoryRepresentation_ != newBuf->memoryRepresentation() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "memoryRepresentation=" + toString( memoryRepresentation_ ) +
+                               " newMemoryType=" + toString( newBuf->memoryRepresentation() ) );
+   }
+   if ( capacity_ != newBuf->capacity() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "capacity=" + toString( capacity_ ) +
+                               " newCapacity=" + toString( newBuf->capacity() ) );
+   }
+   if ( doConversion_ != newBuf->doConversion() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "doConversion=" + toString( doConversion_ ) +
+                               "newDoConversion=" + toString( newBuf->doConversion() ) );
+   }
+   if ( normalized_ != newBuf->normalized() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "normalized=" + toString( normalized_ ) +
+                               " newNormalized=" + toString( newBuf->normalized() ) );
+   }
+   if ( stride_ != newBuf->stride() )
+   {
+      throw E57_EXCEPTION2( ErrorBuffersNotCompatible,
+                            "stride=" + toString( stride_ ) +
+                               " newStride=" + toString( newBuf->stride() ) );
+   }
+}
+
+#ifdef E57_ENABLE_DIAGNOSTIC_OUTPUT
+void SourceDestBufferImpl::dump( int indent, std::ostream &os )
+{
+   /// don't checkImageFileOpen
+
+   os << space( indent ) << "pathName:             " << pathName_ << std::endl;
+   os << space( indent ) << "memoryRepresentation: ";
+   switch ( memoryRepresentation_ )
+   {
+      case Int8:
+         os << "int8_t" << std::endl;
+         break;
+      case UInt8:
+         os << "uint8_t" << std::endl;
+         break;
+      case Int16:
+         os << "int16_t" << std::endl;
+         break;
+      case UInt16:
+         os << "uint16_t" << std::endl;
+         break;
+      case Int32:
+         os << "int32_t" << std::endl;
+         break;
+      case UInt32:
+         os << "uint32_t" << std::endl;
+         break;
+      case Int64:
+         os << "int64_t" << std::endl;
+         break;
+      case Bool:
+         os << "bool" << std::endl;
+         break;
+      case Real32:
+         os << "float" << std::endl;
+         break;
+      case Real64:
+         os << "double" << std::endl;
+         break;
+      case Real16:
+         os << "half" << std::endl;
+         break;
+      case UString:
+         os << "ustring" << std::endl;
+         break;
+      default:
+         os << "<unknown>" << std::endl;
+         break;
+   }
+   os << space( indent ) << "base:                 " << static_cast<const void *>( base_ )
+      << std::endl;
+   os << space( indent ) << "ustrings:             " << static_cast<const void *>( ustrings_ )
+      << std::endl;
+   os << space( indent ) << "stringColumn:         " << static_cast<const void *>( stringColumn_ )
       << std::endl;
    os << space( indent ) << "capacity:             " << capacity_ << std::endl;
    os << space( indent ) << "doConversion:         " << doConversion_ << std::endl;
@@ -44,6 +44,9 @@ namespace e57
       SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile, const ustring &pathName,
                             StringList *b );
 
+      SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile, const ustring &pathName,
+                            StringColumn *b, size_t capacity );
+
       ImageFileImplWeakPtr destImageFile() const
       {
          return destImageFile_;
@@ -69,6 +72,11 @@ namespace e57
          return ustrings_;
       }
 
+      StringColumn *stringColumn() const
+      {
+         return stringColumn_;
+      }
+
       bool doConversion() const
       {
          return doConversion_;
@@ -84,6 +92,32 @@ namespace e57
          return stride_;
       }
 
+      /// Store the values as half precision floats (Real16) in a UInt16 buffer
+      void setHalfPrecision();
+
+      /// Store the values in a UInt8 or UInt16 buffer normalized from minimum..maximum to the
+      /// whole range of the type, or in a Real32 or Real64 buffer normalized to 0..1
+      void setNormalizedRange( double minimum, double maximum );
+
+      bool normalized() const
+      {
+         return normalized_;
+      }
+
+      /// @returns true if the values are converted as they are stored (Real16 or normalized),
+      /// which only buffers being read into support
+      bool isEncoded() const
+      {
+         return ( memoryRepresentation_ == Real16 ) || normalized_;
+      }
+
+      /// Validation level of the file when this buffer was made (see
+      /// ImageFileImpl::setValidationLevel())
+      ValidationLevel validationLevel() const
+      {
+         return validationLevel_;
+      }
+
       size_t capacity() const
       {
          return capacity_;
@@ -99,16 +133,69 @@ namespace e57
          nextIndex_ = 0;
       }
 
+      /// Pass over the next count elements without getting or setting them
+      void skip( size_t count )
+      {
+         nextIndex_ += static_cast<unsigned>( count );
+      }
+
+      /// Forget the elements from index on, e.g. after compacting the buffer with moveElement()
+      void truncate( unsigned index )
+      {
+         if ( index < nextIndex_ )
+         {
+            nextIndex_ = index;
+
+            if ( stringColumn_ != nullptr )
+            {
+               stringColumn_->offsets.resize( index + 1 );
+               stringColumn_->chars.resize( static_cast<size_t>( stringColumn_->offsets.back() ) );
+            }
+         }
+      }
+
+      /// Value of an element already set, whatever its representation
+      /// @throw ::ErrorExpectingNumeric for a ustring buffer
+      double doubleAt( size_t index ) const;
+
+      /// Value of any element, set or not (e.g. one a writer is about to encode)
+      /// @throw ::ErrorExpectingNumeric for a ustring buffer
+      double elementAt( size_t index ) const;
+
+      /// Move the element at index from to index to (both already set)
+      void moveElement( size_t from, size_t to );
+
       int64_t getNextInt64();
       int64_t getNextInt64( double scale, double offset );
       float getNextFloat();
       double getNextDouble();
       ustring getNextString();
+
+      /// Get the next string without copying it. It stays valid until the buffer's strings are
+      /// changed.
+      void getNextString( const char *&data, size_t &length );
       void setNextInt64( int64_t value );
       void setNextInt64( int64_t value, double scale, double offset );
       void setNextFloat( float value );
       void setNextDouble( double value );
       void setNextString( const ustring &value );
+      void setNextString( const char *data, size_t length );
+
+      /// Block versions of the numeric get/set functions above. They convert count values with
+      /// the same checks, but choose the conversion once for the whole block instead of for
+      /// every value.
+      void getNextInt64Block( int64_t *values, size_t count );
+      void getNextInt64Block( int64_t *values, size_t count, double scale, double offset );
+      void getNextFloatBlock( float *values, size_t count );
+      void getNextDoubleBlock( double *values, size_t count );
+      void setNextInt64Block( const int64_t *values, size_t count );
+      void setNextInt64Block( const int64_t *values, size_t count, double scale, double offset );
+      void setNextFloatBlock( const float *values, size_t count );
+      void setNextDoubleBlock( const double *values, size_t count );
+
+      /// Set the next count elements to the same value, which is converted and checked once.
+      void setNextInt64Fill( int64_t value, size_t count );
+      void setNextInt64Fill( int64_t value, size_t count, double scale, double offset );
 
       void checkCompatible( const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const;
 
@@ -119,6 +206,44 @@ namespace e57
    private:
       template <typename T> void _setNextReal( T inValue );
 
+      void checkBlockBounds_( size_t count ) const;
+
+      /// Size of each element in memory (0 for strings)
+      size_t elementSize_() const;
+
+      /// Copy the last element set into the next count elements
+      void fillNext_( size_t count );
+      template <typename T> void fillNextAs_( size_t count );
+
+      /// @returns true if the buffer is a plain array of T, either float or double
+      template <typename T> bool isContiguous_() const;
+
+      template <typename SrcT, typename DstT, typename ConvertT>
+      void getNextBlock_( DstT *values, size_t count, ConvertT convert );
+      template <typename DstT, typename SrcT, typename ConvertT>
+      void setNextBlock_( const SrcT *values, size_t count, ConvertT convert );
+
+      template <typename DstT> void getNextRealBlock_( DstT *values, size_t count );
+      template <typename DstT, typename SrcT> void setNextCheckedBlock_( const SrcT *values,
+                                                                          size_t count );
+      template <typename DstT>
+      void setNextScaledBlock_( const int64_t *values, size_t count, double scale,
+                                double offset );
+      template <typename SrcT> void setNextRealBlock_( const SrcT *values, size_t count );
+      template <typename DstT>
+      void setNextScaledRealBlock_( const int64_t *values, size_t count, double scale,
+                                    double offset );
+
+      /// Set values in an encoded buffer (see isEncoded()), given as doubles by toDouble
+      void setNextEncoded_( double value );
+      template <typename SrcT, typename ToDoubleT>
+      void setNextEncodedBlock_( const SrcT *values, size_t count, ToDoubleT toDouble );
+      template <typename DstT, typename SrcT, typename ToDoubleT>
+      void setNextNormalizedBlock_( const SrcT *values, size_t count, ToDoubleT toDouble );
+
+      /// Half precision bits of a value, throws if it is too large
+      uint16_t halfOf_( double value ) const;
+
       /// Common routine to check that constructor arguments were ok, throws if not
       void checkState_() const;
 
@@ -145,11 +270,23 @@ namespace e57
       /// Distance between each element (different from size_ if elements not contiguous)
       size_t stride_ = 0;
 
+      /// Store values normalized: ( value - normalizedMinimum_ ) * normalizedFactor_, clamped
+      /// to the range of the integer type, or to 0..1 for floating point types
+      bool normalized_ = false;
+      double normalizedMinimum_ = 0.0;
+      double normalizedFactor_ = 1.0;
+
+      /// ValidationNone skips checking that the values read fit the buffer
+      ValidationLevel validationLevel_ = ValidationBasic;
+
       /// Number of elements that have been set (dest buffer) or read (source buffer) since
       /// rewind().
       unsigned nextIndex_ = 0;
 
       /// Optional array of ustrings (used if memoryRepresentation_ == ::UString)
       StringList *ustrings_ = nullptr;
+
+      /// Optional column of strings, used instead of ustrings_
+      StringColumn *stringColumn_ = nullptr;
    };
 }
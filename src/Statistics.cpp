@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MIT
+
+#include "Statistics.h"
+#include "Decoder.h"
+
+namespace e57
+{
+   ImageFileStatistics StatisticsCounters::snapshot() const
+   {
+      ImageFileStatistics statistics;
+
+#ifdef E57_STATISTICS
+      statistics.enabled = true;
+#endif
+
+      statistics.bytesRead = bytesRead;
+      statistics.pagesVerified = pagesVerified;
+      statistics.packetCacheHits = packetCacheHits;
+      statistics.packetCacheMisses = packetCacheMisses;
+      statistics.dataPacketsDecoded = dataPacketsDecoded;
+      statistics.bitpackValuesDecoded = bitpackValuesDecoded;
+      statistics.constantValuesDecoded = constantValuesDecoded;
+      statistics.deltaValuesDecoded = deltaValuesDecoded;
+      statistics.runLengthValuesDecoded = runLengthValuesDecoded;
+      statistics.readNanoseconds = readNanoseconds;
+      statistics.checksumNanoseconds = checksumNanoseconds;
+      statistics.packetParseNanoseconds = packetParseNanoseconds;
+      statistics.decodeNanoseconds = decodeNanoseconds;
+      statistics.conversionNanoseconds = conversionNanoseconds;
+
+      return statistics;
+   }
+
+   void StatisticsCounters::addValuesDecoded( const Decoder &decoder, uint64_t valueCount )
+   {
+      if ( dynamic_cast<const BitpackDecoder *>( &decoder ) != nullptr )
+      {
+         bitpackValuesDecoded += valueCount;
+      }
+      else if ( dynamic_cast<const ConstantIntegerDecoder *>( &decoder ) != nullptr )
+      {
+         constantValuesDecoded += valueCount;
+      }
+      else if ( dynamic_cast<const DeltaIntegerDecoder *>( &decoder ) != nullptr )
+      {
+         deltaValuesDecoded += valueCount;
+      }
+      else if ( dynamic_cast<const RunLengthIntegerDecoder *>( &decoder ) != nullptr )
+      {
+         runLengthValuesDecoded += valueCount;
+      }
+   }
+}
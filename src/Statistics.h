@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "E57Format.h"
+
+namespace e57
+{
+   class Decoder;
+
+   /// @brief Counters behind ImageFile::statistics().
+   /// @details One of these is owned by each ImageFileImpl and shared with its CheckedFile, so
+   /// everything reading the file (on any thread) can add to it. They are only updated if the
+   /// library is built with E57_STATISTICS, through the macros below.
+   struct StatisticsCounters
+   {
+      std::atomic<uint64_t> bytesRead{ 0 };
+      std::atomic<uint64_t> pagesVerified{ 0 };
+      std::atomic<uint64_t> packetCacheHits{ 0 };
+      std::atomic<uint64_t> packetCacheMisses{ 0 };
+      std::atomic<uint64_t> dataPacketsDecoded{ 0 };
+      std::atomic<uint64_t> bitpackValuesDecoded{ 0 };
+      std::atomic<uint64_t> constantValuesDecoded{ 0 };
+      std::atomic<uint64_t> deltaValuesDecoded{ 0 };
+      std::atomic<uint64_t> runLengthValuesDecoded{ 0 };
+      std::atomic<uint64_t> readNanoseconds{ 0 };
+      std::atomic<uint64_t> checksumNanoseconds{ 0 };
+      std::atomic<uint64_t> packetParseNanoseconds{ 0 };
+      std::atomic<uint64_t> decodeNanoseconds{ 0 };
+      std::atomic<uint64_t> conversionNanoseconds{ 0 };
+
+      ImageFileStatistics snapshot() const;
+
+      /// Count the values produced by decoder
+      void addValuesDecoded( const Decoder &decoder, uint64_t valueCount );
+   };
+
+   /// Adds the time from its construction to its destruction to a counter (if it isn't null)
+   class StatisticsTimer
+   {
+   public:
+      explicit StatisticsTimer( std::atomic<uint64_t> *counter ) : counter_( counter )
+      {
+         if ( counter_ != nullptr )
+         {
+            start_ = std::chrono::steady_clock::now();
+         }
+      }
+
+      ~StatisticsTimer()
+      {
+         if ( counter_ != nullptr )
+         {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+
+            *counter_ += static_cast<uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() );
+         }
+      }
+
+      StatisticsTimer( const StatisticsTimer & ) = delete;
+      StatisticsTimer &operator=( const StatisticsTimer & ) = delete;
+
+   private:
+      std::atomic<uint64_t> *counter_;
+      std::chrono::steady_clock::time_point start_;
+   };
+}
+
+// stats is a StatisticsCounters pointer, which may be null
+#ifdef E57_STATISTICS
+#define E57_STATISTICS_ADD( stats, counter, value )                                               \
+   do                                                                                             \
+   {                                                                                              \
+      if ( ( stats ) != nullptr )                                                                 \
+      {                                                                                           \
+         ( stats )->counter += ( value );                                                         \
+      }                                                                                           \
+   } while ( false )
+
+// Time the rest of the enclosing scope
+#define E57_STATISTICS_TIME( stats, counter )                                                     \
+   const e57::StatisticsTimer statisticsTimer_##counter(                                          \
+      ( stats ) != nullptr ? &( stats )->counter : nullptr )
+#else
+#define E57_STATISTICS_ADD( stats, counter, value )                                               \
+   do                                                                                             \
+   {                                                                                              \
+   } while ( false )
+#define E57_STATISTICS_TIME( stats, counter )
+#endif
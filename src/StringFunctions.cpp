@@ -1,61 +1,98 @@
 #include "StringFunctions.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
 #include <locale>
 
 namespace e57
 {
-   template <class FTYPE> std::string floatingPointToStr( FTYPE value, int precision )
+   template <class FTYPE> size_t floatingPointToChars( FTYPE value, int precision, char *buf )
    {
       static_assert( std::is_floating_point<FTYPE>::value, "Floating point type required." );
 
-      std::stringstream ss;
-      ss.imbue( std::locale::classic() );
+      precision = std::min( std::max( precision, 0 ), 100 );
+
+      // e.g. 1.23456000000000000e+005 (the decimal point depends on the C locale)
+      char printed[floatingPointMaxChars];
+      const int printedLength = std::snprintf( printed, sizeof( printed ), "%.*e", precision,
+                                               static_cast<double>( value ) );
+
+      assert( printedLength > 0 && static_cast<size_t>( printedLength ) < sizeof( printed ) );
+
+      const char *inp = printed;
+      const char *const inEnd = printed + printedLength;
+      char *outp = buf;
+
+      if ( *inp == '-' )
+      {
+         *outp++ = *inp++;
+      }
+
+      // inf and nan are written as they are
+      if ( ( inp == inEnd ) || !std::isdigit( static_cast<unsigned char>( *inp ) ) )
+      {
+         std::memcpy( outp, inp, static_cast<size_t>( inEnd - inp ) );
+         return static_cast<size_t>( outp - buf ) + static_cast<size_t>( inEnd - inp );
+      }
+
+      *outp++ = *inp++;
+
+      // Skip the decimal point, whatever it is, and copy the fraction after a '.'
+      while ( ( inp != inEnd ) && ( *inp != 'e' ) &&
+              !std::isdigit( static_cast<unsigned char>( *inp ) ) )
+      {
+         ++inp;
+      }
 
-      ss << std::scientific << std::setprecision( precision ) << value;
+      char *const point = outp;
+      *outp++ = '.';
+
+      while ( ( inp != inEnd ) && std::isdigit( static_cast<unsigned char>( *inp ) ) )
+      {
+         *outp++ = *inp++;
+      }
 
       // Try to remove trailing zeroes and decimal point
       // e.g. 1.23456000000000000e+005  ==> 1.23456e+005
       // e.g. 2.00000000000000000e+005  ==> 2e+005
+      while ( ( outp > point + 1 ) && ( outp[-1] == '0' ) )
+      {
+         --outp;
+      }
 
-      std::string s = ss.str();
-
-      // Split into mantissa and exponent
-      // e.g. 1.23456000000000000e+005  ==> "1.23456000000000000" + "e+005"
-      auto index = s.find_last_of( 'e' );
-      assert( index != std::string::npos ); // should not be possible
+      if ( outp == point + 1 )
+      {
+         --outp;
+      }
 
-      std::string mantissa = s.substr( 0, index );
-      const std::string exponent = s.substr( index );
+      // Drop the exponent if it is zero
+      const auto exponentLength = static_cast<size_t>( inEnd - inp );
 
-      // Double check that we understand the formatting
-      if ( exponent[0] == 'e' )
+      if ( ( ( exponentLength == 4 ) && ( std::memcmp( inp, "e+00", 4 ) == 0 ) ) ||
+           ( ( exponentLength == 5 ) && ( std::memcmp( inp, "e+000", 5 ) == 0 ) ) )
       {
-         // Trim trailing zeros from mantissa
-         while ( mantissa.back() == '0' )
-         {
-            mantissa.pop_back();
-         }
-
-         // Trim trailing decimal point if possible
-         if ( mantissa.back() == '.' )
-         {
-            mantissa.pop_back();
-         }
-
-         // Reassemble whole floating point number
-         // Check if can drop exponent.
-         if ( ( exponent == "e+00" ) || ( exponent == "e+000" ) )
-         {
-            s = mantissa;
-         }
-         else
-         {
-            s = mantissa + exponent;
-         }
+         return static_cast<size_t>( outp - buf );
       }
 
-      return s;
+      std::memcpy( outp, inp, exponentLength );
+
+      return static_cast<size_t>( outp - buf ) + exponentLength;
+   }
+
+   template size_t floatingPointToChars<float>( float value, int precision, char *buf );
+   template size_t floatingPointToChars<double>( double value, int precision, char *buf );
+
+   template <class FTYPE> std::string floatingPointToStr( FTYPE value, int precision )
+   {
+      static_assert( std::is_floating_point<FTYPE>::value, "Floating point type required." );
+
+      char buf[floatingPointMaxChars];
+      const size_t length = floatingPointToChars( value, precision, buf );
+
+      return std::string( buf, length );
    }
 
    template std::string floatingPointToStr<float>( float value, int precision );
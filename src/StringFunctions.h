@@ -200,6 +200,18 @@ namespace e57
    extern template std::string floatingPointToStr<float>( float value, int precision );
    extern template std::string floatingPointToStr<double>( double value, int precision );
 
+   /// Size of the buffer floatingPointToChars() needs
+   constexpr size_t floatingPointMaxChars = 128;
+
+   /// @brief Write the same characters as floatingPointToStr() to buf without allocating.
+   /// @details buf must hold floatingPointMaxChars characters. It isn't null terminated. The
+   /// decimal point is always '.', whatever the current C locale is. Precision is limited to 100.
+   /// @returns The number of characters written.
+   template <class FTYPE> size_t floatingPointToChars( FTYPE value, int precision, char *buf );
+
+   extern template size_t floatingPointToChars<float>( float value, int precision, char *buf );
+   extern template size_t floatingPointToChars<double>( double value, int precision, char *buf );
+
    /// Parse a double according the the classic ("C") locale.
    /// @return The parsed double or 0.0 on error.
    double strToDouble( const std::string &inStr );
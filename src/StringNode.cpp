@@ -185,6 +185,31 @@ ustring StringNode::value() const
    return impl_->value();
 }
 
+/*!
+@brief Change the Unicode character string value stored.
+
+@details
+Used on a file opened in update mode, e.g. to fix a guid or a name, this only writes the XML section
+and the file header again (see FloatNode::setValue).
+
+@param [in] value The new value.
+
+@pre The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre The destination ImageFile must have been opened in write or update mode (i.e.
+destImageFile().isWritable()).
+@post value() returns @a value.
+
+@throw ::ErrorImageFileNotOpen
+@throw ::ErrorFileReadOnly
+@throw ::ErrorInternal All objects in undocumented state
+
+@see StringNode::value
+*/
+void StringNode::setValue( const ustring &value )
+{
+   impl_->setValue( value );
+}
+
 /*!
 @brief Diagnostic function to print internal state of object to output stream in an indented format.
 @copydetails Node::dump()
@@ -67,6 +67,13 @@ namespace e57
       return ( value_ );
    }
 
+   void StringNodeImpl::setValue( const ustring &value )
+   {
+      checkValueWritable();
+
+      value_ = value;
+   }
+
    void StringNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
    {
       // don't checkImageFileOpen
@@ -90,7 +97,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       cf << space( indent ) << "<" << fieldName << " type=\"String\"";
@@ -45,6 +45,7 @@ namespace e57
       bool isDefined( const ustring &pathName ) override;
 
       ustring value();
+      void setValue( const ustring &value );
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
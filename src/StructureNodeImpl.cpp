@@ -25,7 +25,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <climits>
+#include <numeric>
 
 #include "CheckedFile.h"
 #include "ImageFileImpl.h"
@@ -34,6 +36,20 @@
 
 using namespace e57;
 
+namespace
+{
+   // Once a structure has more than this many children, findChild() uses a sorted index of
+   // their names rather than comparing each one.
+   constexpr size_t CHILD_INDEX_THRESHOLD = 8;
+
+   // Compare a child's element name with a name which is not null-terminated (e.g. part of a
+   // path name)
+   int compareName( const ustring &childName, const char *name, size_t length )
+   {
+      return childName.compare( 0, ustring::npos, name, length );
+   }
+}
+
 StructureNodeImpl::StructureNodeImpl( ImageFileImplWeakPtr destImageFile ) :
    NodeImpl( destImageFile )
 {
@@ -69,23 +85,24 @@ bool StructureNodeImpl::isTypeEquivalent( NodeImplSharedPtr ni )
    // Check each child is equivalent
    for ( unsigned i = 0; i < childCount(); i++ )
    { //??? vector iterator?
-      ustring myChildsFieldName = children_.at( i )->elementName();
       // Check if matching field name is in same position (to speed things up)
-      if ( myChildsFieldName == si->children_.at( i )->elementName() )
+      if ( hasSameChildName( i, *si ) )
       {
-         if ( !children_.at( i )->isTypeEquivalent( si->children_.at( i ) ) )
+         if ( !child( i )->isTypeEquivalent( si->child( i ) ) )
          {
             return ( false );
          }
       }
       else
       {
+         const ustring myChildsFieldName = childElementName( i );
+
          // Children in different order, so lookup by name and check if equal to our child
          if ( !si->isDefined( myChildsFieldName ) )
          {
             return ( false );
          }
-         if ( !children_.at( i )->isTypeEquivalent( si->lookup( myChildsFieldName ) ) )
+         if ( !child( i )->isTypeEquivalent( si->lookup( myChildsFieldName ) ) )
          {
             return ( false );
          }
@@ -108,10 +125,14 @@ void StructureNodeImpl::setAttachedRecursive()
    // Mark this node as attached to an ImageFile
    isAttached_ = true;
 
-   // Not a leaf node, so mark all our children
+   // Not a leaf node, so mark all our children. Deferred children are marked when they are
+   // parsed.
    for ( auto &child : children_ )
    {
-      child->setAttachedRecursive();
+      if ( child )
+      {
+         child->setAttachedRecursive();
+      }
    }
 }
 
@@ -131,7 +152,7 @@ NodeImplSharedPtr StructureNodeImpl::get( int64_t index )
                             "this->pathName=" + this->pathName() + " index=" + toString( index ) +
                                " size=" + toString( children_.size() ) );
    }
-   return ( children_.at( static_cast<unsigned>( index ) ) );
+   return child( static_cast<size_t>( index ) );
 }
 
 NodeImplSharedPtr StructureNodeImpl::get( const ustring &pathName )
@@ -150,7 +171,16 @@ NodeImplSharedPtr StructureNodeImpl::get( const ustring &pathName )
 NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
 {
    // don't checkImageFileOpen
-   //??? use lookup(fields, level) instead, for speed.
+
+   // Most lookups are of paths which exist, so try those without splitting up the path. Anything
+   // else goes the long way, which checks the path name and throws if it is bad.
+   NodeImplSharedPtr found( lookupInPlace( pathName ) );
+
+   if ( found )
+   {
+      return found;
+   }
+
    bool isRelative;
    std::vector<ustring> fields;
    ImageFileImplSharedPtr imf( destImageFile_ );
@@ -170,14 +200,8 @@ NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
       }
 
       // Find child with elementName that matches first field in path
-      unsigned i;
-      for ( i = 0; i < children_.size(); i++ )
-      {
-         if ( fields.at( 0 ) == children_.at( i )->elementName() )
-         {
-            break;
-         }
-      }
+      const size_t i = findChild( fields.at( 0 ).data(), fields.at( 0 ).size() );
+
       if ( i == children_.size() )
       {
          return {}; // empty pointer
@@ -185,7 +209,7 @@ NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
 
       if ( fields.size() == 1 )
       {
-         return ( children_.at( i ) );
+         return child( i );
       }
 
       //??? use level here rather than unparse
@@ -193,7 +217,7 @@ NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
       fields.erase( fields.begin() );
 
       // Call lookup on child object with remaining fields in path name
-      return children_.at( i )->lookup( imf->pathNameUnparse( true, fields ) );
+      return child( i )->lookup( imf->pathNameUnparse( true, fields ) );
    }
 
    // Absolute pathname and we aren't at the root
@@ -204,6 +228,69 @@ NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
    return ( root->lookup( pathName ) );
 }
 
+/// Resolve a path whose every element names an existing child, walking the path name in place.
+/// @returns an empty pointer for anything else
+NodeImplSharedPtr StructureNodeImpl::lookupInPlace( const ustring &pathName )
+{
+   if ( pathName.empty() )
+   {
+      return {};
+   }
+
+   size_t start = 0;
+
+   StructureNodeImpl *node = this;
+   std::shared_ptr<StructureNodeImpl> holder; // keeps node alive below the first level
+
+   if ( pathName[0] == '/' )
+   {
+      NodeImplSharedPtr root( getRoot() );
+
+      if ( pathName.size() == 1 )
+      {
+         return root;
+      }
+
+      if ( root->type() != TypeStructure && root->type() != TypeVector )
+      {
+         return {};
+      }
+
+      holder = std::static_pointer_cast<StructureNodeImpl>( root );
+      node = holder.get();
+      start = 1;
+   }
+
+   for ( ;; )
+   {
+      const size_t slash = pathName.find( '/', start );
+      const size_t end = ( slash == ustring::npos ) ? pathName.size() : slash;
+
+      const size_t index = node->findChild( pathName.data() + start, end - start );
+
+      if ( index == node->children_.size() )
+      {
+         return {};
+      }
+
+      NodeImplSharedPtr ni( node->child( index ) );
+
+      if ( slash == ustring::npos )
+      {
+         return ni;
+      }
+
+      if ( ni->type() != TypeStructure && ni->type() != TypeVector )
+      {
+         return {};
+      }
+
+      holder = std::static_pointer_cast<StructureNodeImpl>( ni );
+      node = holder.get();
+      start = slash + 1;
+   }
+}
+
 void StructureNodeImpl::set( int64_t index64, NodeImplSharedPtr ni )
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -245,8 +332,7 @@ void StructureNodeImpl::set( int64_t index64, NodeImplSharedPtr ni )
       throw E57_EXCEPTION2( ErrorHomogeneousViolation, "this->pathName=" + this->pathName() );
    }
 
-   ni->setParent( shared_from_this(), elementName.str() );
-   children_.push_back( ni );
+   addChild( ni, elementName.str() );
 }
 
 void StructureNodeImpl::set( const ustring &pathName, NodeImplSharedPtr ni, bool autoPathCreate )
@@ -302,23 +388,22 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
       throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() + " element=/" );
    }
 
-   // Serial search for matching field name, if find match, have error since can't set twice
-   for ( auto &child : children_ )
+   // Search for matching field name, if find match, have error since can't set twice
+   const size_t i = findChild( fields.at( level ).data(), fields.at( level ).size() );
+
+   if ( i != children_.size() )
    {
-      if ( fields.at( level ) == child->elementName() )
+      if ( level == fields.size() - 1 )
       {
-         if ( level == fields.size() - 1 )
-         {
-            // Enforce "set once" policy, don't allow reset
-            throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() +
-                                                    " element=" + fields[level] );
-         }
+         // Enforce "set once" policy, don't allow reset
+         throw E57_EXCEPTION2( ErrorSetTwice, "this->pathName=" + this->pathName() +
+                                                 " element=" + fields[level] );
+      }
 
-         // Recurse on child
-         child->set( fields, level + 1, ni );
+      // Recurse on child
+      child( i )->set( fields, level + 1, ni );
 
-         return;
-      }
+      return;
    }
    // Didn't find matching field name, so have a new child.
 
@@ -332,8 +417,7 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
    if ( level == fields.size() - 1 )
    {
       // At bottom, so append node at end of children
-      ni->setParent( shared_from_this(), fields.at( level ) );
-      children_.push_back( ni );
+      addChild( ni, fields.at( level ) );
    }
    else
    {
@@ -371,10 +455,167 @@ void StructureNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSh
    // don't checkImageFileOpen
 
    // Not a leaf node, so check all our children
-   for ( auto &child : children_ )
+   for ( size_t i = 0; i < children_.size(); i++ )
+   {
+      child( i )->checkLeavesInSet( pathNames, origin );
+   }
+}
+
+void StructureNodeImpl::deferChildren( const std::vector<E57XmlRange> &ranges )
+{
+   if ( !children_.empty() )
+   {
+      throw E57_EXCEPTION2( ErrorInternal, "this->pathName=" + this->pathName() +
+                                              " childCount=" + toString( children_.size() ) );
+   }
+
+   deferredChildren_ = ranges;
+   children_.resize( ranges.size() );
+}
+
+NodeImplSharedPtr StructureNodeImpl::child( size_t index )
+{
+   if ( deferredChildren_.empty() )
+   {
+      return children_.at( index );
+   }
+
+   // Several threads may be reading the file, so the children are parsed under the file's lock
+   ImageFileImplSharedPtr imf( destImageFile_ );
+   std::lock_guard<std::mutex> lock( imf->deferredXmlMutex_ );
+
+   NodeImplSharedPtr &ni = children_.at( index );
+
+   if ( !ni )
+   {
+      NodeImplSharedPtr parsed = imf->parseDeferredElement( deferredChildren_[index] );
+      parsed->setParent( shared_from_this(), toString( index ) );
+      ni = parsed;
+   }
+
+   return ni;
+}
+
+void StructureNodeImpl::releaseChild( int64_t index )
+{
+   if ( deferredChildren_.empty() )
+   {
+      return;
+   }
+
+   if ( index < 0 || index >= static_cast<int64_t>( children_.size() ) )
+   {
+      throw E57_EXCEPTION2( ErrorChildIndexOutOfBounds,
+                            "this->pathName=" + this->pathName() + " index=" + toString( index ) +
+                               " size=" + toString( children_.size() ) );
+   }
+
+   ImageFileImplSharedPtr imf( destImageFile_ );
+   std::lock_guard<std::mutex> lock( imf->deferredXmlMutex_ );
+
+   children_[static_cast<size_t>( index )].reset();
+}
+
+size_t StructureNodeImpl::findChild( const char *elementName, size_t length ) const
+{
+   const size_t count = children_.size();
+
+   // Deferred children are named by their index (with no leading zeros), and may not have been
+   // parsed yet
+   if ( !deferredChildren_.empty() )
+   {
+      if ( length == 0 || length > 19 || ( elementName[0] == '0' && length > 1 ) )
+      {
+         return count;
+      }
+
+      size_t index = 0;
+
+      for ( size_t i = 0; i < length; ++i )
+      {
+         if ( elementName[i] < '0' || elementName[i] > '9' )
+         {
+            return count;
+         }
+
+         index = index * 10 + static_cast<size_t>( elementName[i] - '0' );
+      }
+
+      return ( index < count ) ? index : count;
+   }
+
+   if ( childIndex_.empty() )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         if ( compareName( *children_[i]->elementName_, elementName, length ) == 0 )
+         {
+            return i;
+         }
+      }
+
+      return count;
+   }
+
+   const auto found =
+      std::lower_bound( childIndex_.begin(), childIndex_.end(), elementName,
+                        [this, length]( size_t index, const char *name ) {
+                           return compareName( *children_[index]->elementName_, name, length ) < 0;
+                        } );
+
+   if ( found != childIndex_.end() &&
+        compareName( *children_[*found]->elementName_, elementName, length ) == 0 )
+   {
+      return *found;
+   }
+
+   return count;
+}
+
+void StructureNodeImpl::addChild( NodeImplSharedPtr ni, const ustring &elementName )
+{
+   ni->setParent( shared_from_this(), elementName );
+   children_.push_back( ni );
+
+   const auto byName = [this]( size_t a, size_t b ) {
+      return *children_[a]->elementName_ < *children_[b]->elementName_;
+   };
+
+   if ( !childIndex_.empty() )
+   {
+      const size_t index = children_.size() - 1;
+
+      childIndex_.insert(
+         std::upper_bound( childIndex_.begin(), childIndex_.end(), index, byName ), index );
+   }
+   else if ( children_.size() > CHILD_INDEX_THRESHOLD )
+   {
+      childIndex_.resize( children_.size() );
+      std::iota( childIndex_.begin(), childIndex_.end(), 0 );
+      std::sort( childIndex_.begin(), childIndex_.end(), byName );
+   }
+}
+
+bool StructureNodeImpl::hasSameChildName( size_t index, const StructureNodeImpl &other ) const
+{
+   // Parsed children's names are interned, so usually this just compares pointers
+   if ( deferredChildren_.empty() && other.deferredChildren_.empty() )
    {
-      child->checkLeavesInSet( pathNames, origin );
+      return children_.at( index )->hasSameElementName( *other.children_.at( index ) );
    }
+
+   return childElementName( index ) == other.childElementName( index );
+}
+
+ustring StructureNodeImpl::childElementName( size_t index ) const
+{
+   // Only vector children are deferred, and they are named by their index
+   if ( !deferredChildren_.empty() )
+   {
+      return toString( index );
+   }
+
+   return children_.at( index )->elementName();
 }
 
 //??? use visitor?
@@ -390,7 +631,7 @@ void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, i
    }
    else
    {
-      fieldName = elementName_;
+      fieldName = *elementName_;
    }
 
    cf << space( indent ) << "<" << fieldName << " type=\"Structure\"";
@@ -460,7 +701,15 @@ void StructureNodeImpl::dump( int indent, std::ostream &os ) const
    for ( unsigned i = 0; i < children_.size(); i++ )
    {
       os << space( indent ) << "child[" << i << "]:" << std::endl;
-      children_.at( i )->dump( indent + 2, os );
+
+      if ( children_.at( i ) )
+      {
+         children_.at( i )->dump( indent + 2, os );
+      }
+      else
+      {
+         os << space( indent + 2 ) << "<not parsed yet>" << std::endl;
+      }
    }
 }
 #endif
@@ -57,6 +57,15 @@ namespace e57
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
+      /// Leave the children to be parsed from the given ranges of the XML section when each is
+      /// first accessed. Used by a lazy open for the (heterogeneous) data3D and images2D vectors,
+      /// whose children are named by their index.
+      void deferChildren( const std::vector<E57XmlRange> &ranges );
+
+      /// Drop a deferred child which has been parsed, so it is parsed again from the XML section
+      /// the next time it is accessed. Does nothing if the children aren't deferred.
+      void releaseChild( int64_t index );
+
       void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
                      const char *forcedFieldName = nullptr ) override;
 
@@ -68,7 +77,26 @@ namespace e57
       friend class CompressedVectorReaderImpl;
 
       NodeImplSharedPtr lookup( const ustring &pathName ) override;
+      NodeImplSharedPtr lookupInPlace( const ustring &pathName );
+
+      /// @returns the index of the child with the given element name, or children_.size() if
+      /// there isn't one
+      size_t findChild( const char *elementName, size_t length ) const;
+      void addChild( NodeImplSharedPtr ni, const ustring &elementName );
+
+      /// @returns a child, parsing it first if it was deferred
+      NodeImplSharedPtr child( size_t index );
+      ustring childElementName( size_t index ) const;
+      bool hasSameChildName( size_t index, const StructureNodeImpl &other ) const;
 
       std::vector<NodeImplSharedPtr> children_;
+
+      // Indices of children_ sorted by element name, kept once there are more than a few
+      // children (see addChild()). Empty if findChild() should just search children_.
+      std::vector<size_t> childIndex_;
+
+      // Where each child is in the XML section if they were deferred (see deferChildren()), else
+      // empty. A deferred child is null in children_ until it has been parsed.
+      std::vector<E57XmlRange> deferredChildren_;
    };
 }
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <atomic>
+
+#include "ThreadPool.h"
+
+namespace e57
+{
+   namespace
+   {
+      // Shared by the calls of one parallelFor(). Workers which start after every index has
+      // been claimed return without touching task, so they may outlive the call.
+      struct ParallelFor
+      {
+         ParallelFor( size_t callCount, const std::function<void( size_t )> &call ) :
+            count( callCount ), task( call ), exceptions( callCount )
+         {
+         }
+
+         // Make the calls for the indices nobody has claimed yet
+         void run()
+         {
+            for ( size_t i = next++; i < count; i = next++ )
+            {
+               try
+               {
+                  task( i );
+               }
+               catch ( ... )
+               {
+                  exceptions[i] = std::current_exception();
+               }
+
+               std::lock_guard<std::mutex> lock( mutex );
+
+               if ( ++finished == count )
+               {
+                  allFinished.notify_all();
+               }
+            }
+         }
+
+         const size_t count;
+         const std::function<void( size_t )> &task;
+
+         // The calling thread makes the call for index 0 itself
+         std::atomic<size_t> next{ 1 };
+
+         std::vector<std::exception_ptr> exceptions;
+
+         std::mutex mutex;
+         std::condition_variable allFinished;
+         size_t finished = 0;
+      };
+   }
+
+   ThreadPool::ThreadPool( size_t threadCount, std::shared_ptr<Executor> executor ) :
+      threadCount_( std::max<size_t>( threadCount, 1 ) ), executor_( std::move( executor ) )
+   {
+      if ( executor_ )
+      {
+         return;
+      }
+
+      threads_.reserve( threadCount_ );
+
+      for ( size_t i = 0; i < threadCount_; ++i )
+      {
+         threads_.emplace_back( &ThreadPool::workerLoop, this );
+      }
+   }
+
+   ThreadPool::~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         stopping_ = true;
+      }
+
+      condition_.notify_all();
+
+      for ( auto &thread : threads_ )
+      {
+         thread.join();
+      }
+   }
+
+   std::future<void> ThreadPool::submit( std::function<void()> task )
+   {
+      auto packagedTask = std::make_shared<std::packaged_task<void()>>( std::move( task ) );
+      std::future<void> result = packagedTask->get_future();
+
+      enqueue( [packagedTask] { ( *packagedTask )(); } );
+
+      return result;
+   }
+
+   void ThreadPool::parallelFor( size_t count, const std::function<void( size_t )> &task )
+   {
+      if ( count == 0 )
+      {
+         return;
+      }
+
+      auto state = std::make_shared<ParallelFor>( count, task );
+
+      // There's no use in asking for more workers than can run at once
+      const size_t workerCount = std::min( count - 1, threadCount_ );
+
+      try
+      {
+         for ( size_t i = 0; i < workerCount; ++i )
+         {
+            enqueue( [state] { state->run(); } );
+         }
+      }
+      catch ( ... )
+      {
+         // Whatever couldn't be queued is done by this thread below
+      }
+
+      // Do the first one ourselves rather than sitting idle, then help with the rest
+      try
+      {
+         task( 0 );
+      }
+      catch ( ... )
+      {
+         state->exceptions[0] = std::current_exception();
+      }
+
+      {
+         std::lock_guard<std::mutex> lock( state->mutex );
+         ++state->finished;
+      }
+
+      state->run();
+
+      // Wait for the calls which workers have started, since they reference task
+      {
+         std::unique_lock<std::mutex> lock( state->mutex );
+         state->allFinished.wait( lock, [&] { return state->finished == count; } );
+      }
+
+      for ( const auto &exception : state->exceptions )
+      {
+         if ( exception )
+         {
+            std::rethrow_exception( exception );
+         }
+      }
+   }
+
+   unsigned int ThreadPool::defaultThreadCount( const std::shared_ptr<Executor> &executor )
+   {
+      return std::max( ( executor != nullptr ) ? executor->concurrency()
+                                               : std::thread::hardware_concurrency(),
+                       1u );
+   }
+
+   void ThreadPool::enqueue( std::function<void()> task )
+   {
+      if ( executor_ )
+      {
+         executor_->submit( std::move( task ) );
+         return;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         queue_.push_back( std::move( task ) );
+      }
+
+      condition_.notify_one();
+   }
+
+   void ThreadPool::workerLoop()
+   {
+      for ( ;; )
+      {
+         std::function<void()> task;
+
+         {
+            std::unique_lock<std::mutex> lock( mutex_ );
+
+            condition_.wait( lock, [this] { return stopping_ || !queue_.empty(); } );
+
+            if ( queue_.empty() )
+            {
+               return;
+            }
+
+            task = std::move( queue_.front() );
+            queue_.pop_front();
+         }
+
+         task();
+      }
+   }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "E57Format.h"
+
+namespace e57
+{
+   /// @brief A small, fixed-size pool of worker threads used internally to spread independent
+   /// pieces of work (e.g. checksum verification) across cores.
+   /// @details When made with an Executor, its tasks are run by the executor instead, and no
+   /// threads are started.
+   class ThreadPool
+   {
+   public:
+      /// @param [in] threadCount number of worker threads to start, or of tasks to give the
+      /// executor at once (at least one)
+      /// @param [in] executor runs the tasks if it isn't null
+      explicit ThreadPool( size_t threadCount, std::shared_ptr<Executor> executor = nullptr );
+      ~ThreadPool();
+
+      ThreadPool( const ThreadPool & ) = delete;
+      ThreadPool &operator=( const ThreadPool & ) = delete;
+
+      size_t threadCount() const
+      {
+         return threadCount_;
+      }
+
+      /// @brief Queue a task to be run on one of the worker threads.
+      /// @returns a future which becomes ready (or holds the exception thrown) when the task is
+      /// done
+      std::future<void> submit( std::function<void()> task );
+
+      /// @brief Call task( i ) for each i in [0, count).
+      /// @details The calls are shared between the worker threads and the calling thread, which
+      /// makes the call for index 0. The calling thread makes any calls which no worker has
+      /// started, so it never waits for a worker to become free, and this may be called from a
+      /// task running on the pool. This blocks until all of them are done, then rethrows the
+      /// first exception (by index) thrown by any of them.
+      void parallelFor( size_t count, const std::function<void( size_t )> &task );
+
+      /// @returns the number of threads a thread count of 0 stands for: the executor's
+      /// concurrency if there is one, otherwise the number of hardware threads
+      static unsigned int defaultThreadCount( const std::shared_ptr<Executor> &executor );
+
+   private:
+      void enqueue( std::function<void()> task );
+      void workerLoop();
+
+      size_t threadCount_;
+      std::shared_ptr<Executor> executor_;
+      std::vector<std::thread> threads_;
+
+      std::mutex mutex_;
+      std::condition_variable condition_;
+      std::deque<std::function<void()>> queue_;
+      bool stopping_ = false;
+   };
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+
+#include <chrono>
+
+#include "Trace.h"
+
+namespace e57
+{
+   void Tracer::setHandler( TraceHandler handler )
+   {
+      std::vector<TraceEvent> pending;
+
+      {
+         std::lock_guard<std::mutex> lock( pendingMutex_ );
+
+         handler_ = std::move( handler );
+         handlerSet_ = true;
+         pending.swap( pending_ );
+      }
+
+      if ( handler_ )
+      {
+         for ( const TraceEvent &event : pending )
+         {
+            handler_( event );
+         }
+      }
+   }
+
+   uint64_t Tracer::now()
+   {
+      const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+
+      return static_cast<uint64_t>(
+         std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() );
+   }
+
+   void Tracer::report( const char *name, uint64_t startNanoseconds, uint64_t bytes )
+   {
+      TraceEvent event;
+      event.name = name;
+      event.startNanoseconds = startNanoseconds;
+      event.durationNanoseconds = now() - startNanoseconds;
+      event.bytes = bytes;
+      event.threadId = std::this_thread::get_id();
+
+      if ( handlerSet_ )
+      {
+         if ( handler_ )
+         {
+            handler_( event );
+         }
+
+         return;
+      }
+
+      std::lock_guard<std::mutex> lock( pendingMutex_ );
+
+      if ( pending_.size() < maxPendingEvents )
+      {
+         pending_.push_back( event );
+      }
+   }
+}
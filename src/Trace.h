@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <mutex>
+
+#include "E57Format.h"
+
+namespace e57
+{
+   /// @brief Reports the spans of work done on an ImageFile to its TraceHandler.
+   /// @details One of these is owned by each ImageFileImpl and shared with its CheckedFile. The
+   /// spans are only made if the library is built with E57_TRACING, through the macros below.
+   /// The file is opened before there is a handler, so the first spans are kept until
+   /// setHandler() is called.
+   class Tracer
+   {
+   public:
+      /// Most spans kept until a handler is set
+      static constexpr size_t maxPendingEvents = 64;
+
+      /// Set the handler (empty for none) and give it the spans kept so far. This must be done
+      /// before the file is used by other threads.
+      void setHandler( TraceHandler handler );
+
+      bool enabled() const
+      {
+         return handlerSet_ ? static_cast<bool>( handler_ ) : true;
+      }
+
+      /// @returns nanoseconds since the epoch of the steady clock
+      static uint64_t now();
+
+      void report( const char *name, uint64_t startNanoseconds, uint64_t bytes );
+
+   private:
+      TraceHandler handler_;
+      bool handlerSet_ = false;
+
+      std::mutex pendingMutex_;
+      std::vector<TraceEvent> pending_; /// spans before setHandler(), up to maxPendingEvents
+   };
+
+   /// Reports the time from its construction to its destruction to a Tracer (if it isn't null)
+   class TraceSpan
+   {
+   public:
+      TraceSpan( Tracer *tracer, const char *name ) :
+         tracer_( ( tracer != nullptr ) && tracer->enabled() ? tracer : nullptr ), name_( name )
+      {
+         if ( tracer_ != nullptr )
+         {
+            start_ = Tracer::now();
+         }
+      }
+
+      ~TraceSpan()
+      {
+         if ( tracer_ != nullptr )
+         {
+            tracer_->report( name_, start_, bytes_ );
+         }
+      }
+
+      TraceSpan( const TraceSpan & ) = delete;
+      TraceSpan &operator=( const TraceSpan & ) = delete;
+
+      void setBytes( uint64_t bytes )
+      {
+         bytes_ = bytes;
+      }
+
+   private:
+      Tracer *tracer_;
+      const char *name_;
+      uint64_t start_ = 0;
+      uint64_t bytes_ = 0;
+   };
+}
+
+// tracer is a Tracer pointer, which may be null. There is one span per scope.
+#ifdef E57_TRACING
+// Trace the rest of the enclosing scope
+#define E57_TRACE_SPAN( tracer, name ) e57::TraceSpan traceSpan( ( tracer ), ( name ) )
+
+// Set the bytes of the span of the enclosing scope
+#define E57_TRACE_BYTES( bytes ) traceSpan.setBytes( bytes )
+#else
+#define E57_TRACE_SPAN( tracer, name )
+#define E57_TRACE_BYTES( bytes )                                                                  \
+   do                                                                                             \
+   {                                                                                              \
+   } while ( false )
+#endif
@@ -64,7 +64,7 @@ namespace e57
       // Check each child, must be in same order
       for ( unsigned i = 0; i < childCount(); i++ )
       {
-         if ( !children_.at( i )->isTypeEquivalent( ai->children_.at( i ) ) )
+         if ( !child( i )->isTypeEquivalent( ai->child( i ) ) )
          {
             return ( false );
          }
@@ -112,7 +112,7 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       cf << space( indent ) << "<" << fieldName << " type=\"Vector\" allowHeterogeneousChildren=\""
@@ -135,7 +135,15 @@ namespace e57
       for ( unsigned i = 0; i < children_.size(); i++ )
       {
          os << space( indent ) << "child[" << i << "]:" << std::endl;
-         children_.at( i )->dump( indent + 2, os );
+
+         if ( children_.at( i ) )
+         {
+            children_.at( i )->dump( indent + 2, os );
+         }
+         else
+         {
+            os << space( indent + 2 ) << "<not parsed yet>" << std::endl;
+         }
       }
    }
 #endif
@@ -26,12 +26,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
 
 #include "WriterImpl.h"
 
 #include "Common.h"
+#include "CompressedVectorWriterImpl.h"
 #include "E57Version.h"
+#include "ImageFileImpl.h"
+#include "SourceDestBufferImpl.h"
+#include "StringFunctions.h"
+#include "ThreadPool.h"
 
 namespace
 {
@@ -75,6 +84,220 @@ namespace
 
 namespace e57
 {
+   /// Bits it takes to store one value of each of the fields in buffers without compression
+   static uint64_t _recordBits( const StructureNode &proto,
+                                const std::vector<SourceDestBuffer> &buffers )
+   {
+      uint64_t bits = 0;
+
+      for ( const auto &buffer : buffers )
+      {
+         const Node node = proto.get( buffer.pathName() );
+
+         int64_t minimum = 0;
+         int64_t maximum = 0;
+
+         switch ( node.type() )
+         {
+            case TypeInteger:
+               minimum = IntegerNode( node ).minimum();
+               maximum = IntegerNode( node ).maximum();
+               break;
+
+            case TypeScaledInteger:
+               minimum = ScaledIntegerNode( node ).minimum();
+               maximum = ScaledIntegerNode( node ).maximum();
+               break;
+
+            case TypeFloat:
+               bits += ( FloatNode( node ).precision() == PrecisionSingle ) ? 32 : 64;
+               continue;
+
+            default:
+               continue;
+         }
+
+         const uint64_t range = static_cast<uint64_t>( maximum ) - static_cast<uint64_t>( minimum );
+
+         for ( uint64_t r = range; r != 0; r >>= 1 )
+         {
+            ++bits;
+         }
+      }
+
+      return bits;
+   }
+
+   /// Call f( fromBuffer, toBuffer ) for each of the buffers of from and the matching one of to
+   template <typename COORDTYPE, typename F>
+   static void _forEachBuffer( const Data3DPointsData_t<COORDTYPE> &from,
+                               Data3DPointsData_t<COORDTYPE> &to, F f )
+   {
+      f( from.cartesianX, to.cartesianX );
+      f( from.cartesianY, to.cartesianY );
+      f( from.cartesianZ, to.cartesianZ );
+      f( from.cartesianInvalidState, to.cartesianInvalidState );
+      f( from.intensity, to.intensity );
+      f( from.isIntensityInvalid, to.isIntensityInvalid );
+      f( from.colorRed, to.colorRed );
+      f( from.colorGreen, to.colorGreen );
+      f( from.colorBlue, to.colorBlue );
+      f( from.isColorInvalid, to.isColorInvalid );
+      f( from.sphericalRange, to.sphericalRange );
+      f( from.sphericalAzimuth, to.sphericalAzimuth );
+      f( from.sphericalElevation, to.sphericalElevation );
+      f( from.sphericalInvalidState, to.sphericalInvalidState );
+      f( from.rowIndex, to.rowIndex );
+      f( from.columnIndex, to.columnIndex );
+      f( from.returnIndex, to.returnIndex );
+      f( from.returnCount, to.returnCount );
+      f( from.timeStamp, to.timeStamp );
+      f( from.isTimeStampInvalid, to.isTimeStampInvalid );
+      f( from.normalX, to.normalX );
+      f( from.normalY, to.normalY );
+      f( from.normalZ, to.normalZ );
+   }
+
+   /// Throw if a coordinate given as raw integers isn't written as a ScaledInteger
+   template <typename COORDTYPE>
+   static void _checkRawCoordinates( const StructureNode &proto,
+                                     const Data3DPointsData_t<COORDTYPE> &buffers )
+   {
+      const std::pair<const char *, const COORDTYPE *> coordinates[] = {
+         { "cartesianX", buffers.cartesianX },
+         { "cartesianY", buffers.cartesianY },
+         { "cartesianZ", buffers.cartesianZ },
+         { "sphericalRange", buffers.sphericalRange },
+         { "sphericalAzimuth", buffers.sphericalAzimuth },
+         { "sphericalElevation", buffers.sphericalElevation },
+      };
+
+      for ( const auto &coordinate : coordinates )
+      {
+         if ( ( coordinate.second != nullptr ) && proto.isDefined( coordinate.first ) &&
+              ( proto.get( coordinate.first ).type() != TypeScaledInteger ) )
+         {
+            throw E57_EXCEPTION2( ErrorBadAPIArgument, std::string( "fieldName=" ) +
+                                                          coordinate.first +
+                                                          " is not a ScaledInteger" );
+         }
+      }
+   }
+
+   /// Maps the coordinates of COORDTYPE buffers to their values: raw integers are scaled like
+   /// their ScaledInteger field, floating point values are used as they are
+   struct CoordinateScaling
+   {
+      double scale = 1.0;
+      double offset = 0.0;
+
+      template <typename COORDTYPE> double operator()( COORDTYPE coordinate ) const
+      {
+         return static_cast<double>( coordinate ) * scale + offset;
+      }
+   };
+
+   template <typename COORDTYPE>
+   static CoordinateScaling _coordinateScaling( const StructureNode &proto, const char *name )
+   {
+      CoordinateScaling scaling;
+
+      if ( std::is_integral<COORDTYPE>::value && proto.isDefined( name ) &&
+           ( proto.get( name ).type() == TypeScaledInteger ) )
+      {
+         const ScaledIntegerNode field( proto.get( name ) );
+
+         scaling.scale = field.scale();
+         scaling.offset = field.offset();
+      }
+
+      return scaling;
+   }
+
+   /// Spread the low 21 bits of value out so there are two 0 bits after each of them
+   static uint64_t _spreadBits( uint64_t value )
+   {
+      value &= 0x1fffff;
+      value = ( value | value << 32 ) & 0x1f00000000ffffULL;
+      value = ( value | value << 16 ) & 0x1f0000ff0000ffULL;
+      value = ( value | value << 8 ) & 0x100f00f00f00f00fULL;
+      value = ( value | value << 4 ) & 0x10c30c30c30c30c3ULL;
+      value = ( value | value << 2 ) & 0x1249249249249249ULL;
+
+      return value;
+   }
+
+   /// Order of the count points starting at first along a Morton curve through their bounding
+   /// box. Points whose cartesian coordinates aren't valid go last, in the order given.
+   template <typename COORDTYPE>
+   static void _mortonOrder( const Data3DPointsData_t<COORDTYPE> &buffers, size_t first,
+                             size_t count, std::vector<size_t> &order )
+   {
+      constexpr double cellCount = 0x1fffff;
+
+      const COORDTYPE *coordinates[3] = { buffers.cartesianX + first, buffers.cartesianY + first,
+                                          buffers.cartesianZ + first };
+
+      auto valid = [&]( size_t i ) {
+         if ( ( buffers.cartesianInvalidState != nullptr ) &&
+              ( buffers.cartesianInvalidState[first + i] != 0 ) )
+         {
+            return false;
+         }
+
+         return std::isfinite( coordinates[0][i] ) && std::isfinite( coordinates[1][i] ) &&
+                std::isfinite( coordinates[2][i] );
+      };
+
+      double minimum[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                            std::numeric_limits<double>::max() };
+      double maximum[3] = { std::numeric_limits<double>::lowest(),
+                            std::numeric_limits<double>::lowest(),
+                            std::numeric_limits<double>::lowest() };
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         if ( valid( i ) )
+         {
+            for ( size_t axis = 0; axis < 3; ++axis )
+            {
+               const auto value = static_cast<double>( coordinates[axis][i] );
+
+               minimum[axis] = std::min( minimum[axis], value );
+               maximum[axis] = std::max( maximum[axis], value );
+            }
+         }
+      }
+
+      std::vector<uint64_t> codes( count, std::numeric_limits<uint64_t>::max() );
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         if ( !valid( i ) )
+         {
+            continue;
+         }
+
+         uint64_t code = 0;
+
+         for ( size_t axis = 0; axis < 3; ++axis )
+         {
+            const double extent = maximum[axis] - minimum[axis];
+            const double offset = coordinates[axis][i] - minimum[axis];
+            const double cell = ( extent > 0.0 ) ? offset / extent * cellCount : 0.0;
+
+            code |= _spreadBits( static_cast<uint64_t>( cell ) ) << axis;
+         }
+
+         codes[i] = code;
+      }
+
+      order.resize( count );
+      std::iota( order.begin(), order.end(), size_t( 0 ) );
+      std::stable_sort( order.begin(), order.end(),
+                        [&codes]( size_t a, size_t b ) { return codes[a] < codes[b]; } );
+   }
+
    /*!
    @brief This function writes the projection image
 
@@ -126,14 +349,77 @@ namespace e57
    }
 
    WriterImpl::WriterImpl( const ustring &filePath, const WriterOptions &options ) :
-      imf_( filePath, "w" ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true )
+      WriterImpl( ImageFile( filePath, "w" ), options )
    {
+   }
+
+   WriterImpl::WriterImpl( std::shared_ptr<ImageFileIO> io, const WriterOptions &options ) :
+      WriterImpl( ImageFile( std::move( io ), "w" ), options )
+   {
+   }
+
+   WriterImpl::WriterImpl( const ImageFile &imf, const WriterOptions &options ) :
+      imf_( imf ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true ),
+      computeBounds_( options.computeBounds ),
+      fitScaledIntegerRanges_( options.fitScaledIntegerRanges ),
+      zoneMapPointCount_( options.zoneMapPointCount ),
+      spatialOrderPointCount_( options.spatialOrderPointCount ),
+      previewPointInterval_( options.previewPointInterval ),
+      deflateLevel_( options.deflateLevel ), deltaCodecFields_( options.deltaCodecFields ),
+      runLengthCodecFields_( options.runLengthCodecFields ),
+      preallocatePointData_( options.preallocatePointData )
+   {
+      if ( deflateLevel_ < 0 || deflateLevel_ > 9 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "deflateLevel=" + toString( deflateLevel_ ) );
+      }
+
+      if ( zoneMapPointCount_ < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "zoneMapPointCount=" + toString( zoneMapPointCount_ ) );
+      }
+
+      if ( spatialOrderPointCount_ < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "spatialOrderPointCount=" + toString( spatialOrderPointCount_ ) );
+      }
+
+      if ( previewPointInterval_ < 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                               "previewPointInterval=" + toString( previewPointInterval_ ) );
+      }
+
+      if ( deflateLevel_ > 0 && !DataPacket::deflateAvailable() )
+      {
+         throw E57_EXCEPTION2( ErrorNotImplemented, "deflateLevel=" + toString( deflateLevel_ ) +
+                                                       " (built without E57_WITH_ZLIB)" );
+      }
+
       // We are using the E57 v1.0 data format standard fieldnames.
       // The standard fieldnames are used without an extension prefix (in the default namespace).
       // We explicitly register it for completeness (the reference implementation would do it for
       // us, if we didn't).
       imf_.extensionsAdd( "", e57::VERSION_1_0_URI );
 
+      imf_.impl()->setTraceHandler( options.traceHandler );
+      imf_.impl()->setBufferAllocator( options.bufferAllocator );
+      imf_.impl()->setMemoryBudget( options.memoryBudget );
+      imf_.impl()->setExecutor( options.executor );
+      imf_.impl()->setEncodeThreadCount( options.encodeThreadCount );
+      imf_.impl()->setPacketSizes( options.packetFillTarget, options.encoderBufferSize );
+      imf_.impl()->setPacketPacking( options.packetPacking );
+      imf_.impl()->setValidationLevel( options.validationLevel );
+
+      imf_.impl()->setDirectIO( options.directIO );
+
+      if ( options.estimatedFileSize > 0 )
+      {
+         imf_.impl()->reserveSpace( options.estimatedFileSize );
+      }
+
       // Set per-file properties.
       // Path names: "/formatName", "/majorVersion", "/minorVersion", "/coordinateMetadata"
       root_.set( "formatName", StringNode( imf_, "ASTM E57 3D Imaging Data File" ) );
@@ -186,6 +472,16 @@ namespace e57
       return imf_.isOpen();
    }
 
+   bool WriterImpl::FitsScaledIntegerRanges() const
+   {
+      return fitScaledIntegerRanges_;
+   }
+
+   std::recursive_mutex &WriterImpl::WritersMutex()
+   {
+      return imf_.impl()->writersMutex();
+   }
+
    bool WriterImpl::Close()
    {
       if ( !IsOpen() )
@@ -1141,12 +1437,102 @@ namespace e57
          proto.set( "nor:normalZ", FloatNode( imf_, 0.0, PrecisionSingle, -1.0, 1.0 ) );
       }
 
-      // Make empty codecs vector for use in creating points CompressedVector.
+      // Make codecs vector for use in creating points CompressedVector.
       // If this vector is empty, it is assumed that all fields will use the BitPack codec.
-      const VectorNode codecs( imf_, true );
+      VectorNode codecs( imf_, true );
+
+      // E57_EXT_deflate_codec
+      // Deflate the bytestreams of all the fields after they are bitpacked.
+      if ( deflateLevel_ > 0 )
+      {
+         if ( !imf_.extensionsLookupPrefix( "deflate" ) )
+         {
+            imf_.extensionsAdd( "deflate", DEFLATE_CODEC_URI );
+         }
+
+         VectorNode inputs( imf_, false );
+
+         for ( int64_t i = 0; i < proto.childCount(); ++i )
+         {
+            inputs.append( StringNode( imf_, proto.get( i ).elementName() ) );
+         }
+
+         StructureNode deflateCodec( imf_ );
+         deflateCodec.set( "level", IntegerNode( imf_, deflateLevel_, 1, 9 ) );
+
+         StructureNode codec( imf_ );
+         codec.set( "inputs", inputs );
+         codec.set( "deflate:deflateCodec", deflateCodec );
+
+         codecs.append( codec );
+      }
+
+      // E57_EXT_delta_codec
+      // Store the integer fields we were asked to as differences.
+      VectorNode deltaInputs( imf_, false );
+
+      for ( const auto &fieldName : deltaCodecFields_ )
+      {
+         if ( proto.isDefined( fieldName ) )
+         {
+            const NodeType type = proto.get( fieldName ).type();
+
+            if ( type == TypeInteger || type == TypeScaledInteger )
+            {
+               deltaInputs.append( StringNode( imf_, fieldName ) );
+            }
+         }
+      }
+
+      if ( deltaInputs.childCount() > 0 )
+      {
+         if ( !imf_.extensionsLookupPrefix( "delta" ) )
+         {
+            imf_.extensionsAdd( "delta", DELTA_CODEC_URI );
+         }
+
+         StructureNode codec( imf_ );
+         codec.set( "inputs", deltaInputs );
+         codec.set( "delta:deltaCodec", StructureNode( imf_ ) );
+
+         codecs.append( codec );
+      }
+
+      // E57_EXT_run_length_codec
+      // Store the integer fields we were asked to as runs, unless they are already differences.
+      VectorNode runLengthInputs( imf_, false );
+
+      for ( const auto &fieldName : runLengthCodecFields_ )
+      {
+         if ( proto.isDefined( fieldName ) &&
+              std::find( deltaCodecFields_.begin(), deltaCodecFields_.end(), fieldName ) ==
+                 deltaCodecFields_.end() )
+         {
+            const NodeType type = proto.get( fieldName ).type();
+
+            if ( type == TypeInteger || type == TypeScaledInteger )
+            {
+               runLengthInputs.append( StringNode( imf_, fieldName ) );
+            }
+         }
+      }
+
+      if ( runLengthInputs.childCount() > 0 )
+      {
+         if ( !imf_.extensionsLookupPrefix( "rle" ) )
+         {
+            imf_.extensionsAdd( "rle", RUN_LENGTH_CODEC_URI );
+         }
+
+         StructureNode codec( imf_ );
+         codec.set( "inputs", runLengthInputs );
+         codec.set( "rle:runLengthCodec", StructureNode( imf_ ) );
+
+         codecs.append( codec );
+      }
 
       // Create CompressedVector for storing points.  Path Name: "/data3D/0/points".
-      // We use the prototype and empty codecs tree from above.
+      // We use the prototype and codecs tree from above.
       // The CompressedVector will be filled by code below.
       const CompressedVectorNode points( imf_, proto, codecs );
 
@@ -1155,48 +1541,302 @@ namespace e57
       return pos;
    }
 
+   template <typename COORDTYPE>
+   int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader,
+                                        const Data3DPointsData_t<COORDTYPE> &buffers )
+   {
+      const auto pointCount = static_cast<size_t>( data3DHeader.pointCount );
+
+      int64_t scanIndex = 0;
+
+      if ( ( spatialOrderPointCount_ == 0 ) || ( pointCount == 0 ) )
+      {
+         // Only the points may be written by several threads at once
+         CompressedVectorWriter dataWriter = [&]() {
+            std::lock_guard<std::recursive_mutex> lock( WritersMutex() );
+
+            scanIndex = NewData3D( data3DHeader );
+            return SetUpData3DPointsData( scanIndex, pointCount, buffers );
+         }();
+
+         dataWriter.write( pointCount );
+         dataWriter.close();
+
+         return scanIndex;
+      }
+
+      if ( ( buffers.cartesianX == nullptr ) || ( buffers.cartesianY == nullptr ) ||
+           ( buffers.cartesianZ == nullptr ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "spatialOrderPointCount needs all cartesian "
+                                                    "coordinates" );
+      }
+
+      const size_t runSize = std::min( static_cast<size_t>( spatialOrderPointCount_ ), pointCount );
+
+      // Each run is copied in its new order to these buffers, which are written from, so the
+      // points given stay as they are
+      Data3DPointsData_t<COORDTYPE> ordered;
+      std::vector<std::shared_ptr<void>> orderedStorage;
+
+      _forEachBuffer( buffers, ordered, [&]( auto *from, auto *&to ) {
+         if ( from != nullptr )
+         {
+            using Value = typename std::remove_reference<decltype( *from )>::type;
+
+            std::shared_ptr<Value> storage( new Value[runSize], std::default_delete<Value[]>() );
+
+            to = storage.get();
+            orderedStorage.push_back( storage );
+         }
+      } );
+
+      CompressedVectorWriter dataWriter = [&]() {
+         std::lock_guard<std::recursive_mutex> lock( WritersMutex() );
+
+         scanIndex = NewData3D( data3DHeader );
+         return SetUpData3DPointsData( scanIndex, runSize, ordered );
+      }();
+
+      std::vector<size_t> order;
+
+      for ( size_t first = 0; first < pointCount; first += runSize )
+      {
+         const size_t count = std::min( runSize, pointCount - first );
+
+         _mortonOrder( buffers, first, count, order );
+
+         _forEachBuffer( buffers, ordered, [&]( auto *from, auto *to ) {
+            if ( from != nullptr )
+            {
+               for ( size_t i = 0; i < count; ++i )
+               {
+                  to[i] = from[first + order[i]];
+               }
+            }
+         } );
+
+         dataWriter.write( count );
+      }
+
+      dataWriter.close();
+
+      return scanIndex;
+   }
+
+   template <typename COORDTYPE>
+   int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                        const Data3DPointsProducer<COORDTYPE> &producer )
+   {
+      if ( blockSize == 0 )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "blockSize=0" );
+      }
+
+      const PointStandardizedFieldsAvailable &given = data3DHeader.pointFields;
+      const bool ordered = ( spatialOrderPointCount_ > 0 );
+
+      if ( ordered &&
+           !( given.cartesianXField && given.cartesianYField && given.cartesianZField ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "spatialOrderPointCount needs all cartesian "
+                                                    "coordinates" );
+      }
+
+      const size_t runSize =
+         ordered ? std::min( static_cast<size_t>( spatialOrderPointCount_ ), blockSize )
+                 : blockSize;
+
+      // The blocks are made as the caller's own buffers would be, which sets the node types and
+      // float ranges in their header. The ranges given for ScaledIntegers are kept.
+      Data3D blockHeader = data3DHeader;
+      blockHeader.pointCount = blockSize;
+
+      Data3DPointsAllocator allocator;
+      Data3DPointsData_t<COORDTYPE> blocks[2] = { { blockHeader, allocator },
+                                                  { blockHeader, allocator } };
+
+      // The points of a block are copied (in their new order) a run at a time to these buffers,
+      // which are written from, so the next block can be filled while they are encoded
+      Data3D runHeader = blockHeader;
+      runHeader.pointCount = runSize;
+
+      Data3DPointsData_t<COORDTYPE> run( runHeader, allocator );
+
+      PointStandardizedFieldsAvailable fields = blockHeader.pointFields;
+
+      if ( given.pointRangeNodeType == NumericalNodeType::ScaledInteger )
+      {
+         fields.pointRangeMinimum = given.pointRangeMinimum;
+         fields.pointRangeMaximum = given.pointRangeMaximum;
+      }
+
+      if ( given.angleNodeType == NumericalNodeType::ScaledInteger )
+      {
+         fields.angleMinimum = given.angleMinimum;
+         fields.angleMaximum = given.angleMaximum;
+      }
+
+      if ( given.timeNodeType == NumericalNodeType::ScaledInteger )
+      {
+         fields.timeMinimum = given.timeMinimum;
+         fields.timeMaximum = given.timeMaximum;
+      }
+
+      data3DHeader.pointFields = fields;
+
+      int64_t scanIndex = 0;
+
+      CompressedVectorWriter dataWriter = [&]() {
+         std::lock_guard<std::recursive_mutex> lock( WritersMutex() );
+
+         scanIndex = NewData3D( data3DHeader );
+         return SetUpData3DPointsData( scanIndex, runSize, run );
+      }();
+
+      std::vector<size_t> order;
+
+      auto writeBlock = [&]( const Data3DPointsData_t<COORDTYPE> &block, size_t count ) {
+         for ( size_t first = 0; first < count; first += runSize )
+         {
+            const size_t runCount = std::min( runSize, count - first );
+
+            if ( ordered )
+            {
+               _mortonOrder( block, first, runCount, order );
+            }
+
+            _forEachBuffer( block, run, [&]( auto *from, auto *to ) {
+               if ( from == nullptr )
+               {
+                  return;
+               }
+
+               if ( ordered )
+               {
+                  for ( size_t i = 0; i < runCount; ++i )
+                  {
+                     to[i] = from[first + order[i]];
+                  }
+               }
+               else
+               {
+                  std::copy( from + first, from + first + runCount, to );
+               }
+            } );
+
+            dataWriter.write( runCount );
+         }
+      };
+
+      // Each block is written on the pool while the producer fills the other one
+      ThreadPool pool( 1, imf_.impl()->executor() );
+      std::future<void> writing;
+      size_t pointCount = 0;
+      size_t next = 0;
+
+      try
+      {
+         for ( ;; )
+         {
+            Data3DPointsData_t<COORDTYPE> &block = blocks[next];
+            const size_t count = producer( block, blockSize );
+
+            if ( count > blockSize )
+            {
+               throw E57_EXCEPTION2( ErrorBadAPIArgument,
+                                     "count=" + toString( count ) +
+                                        " blockSize=" + toString( blockSize ) );
+            }
+
+            // The run buffers are free again once the block before is written
+            if ( writing.valid() )
+            {
+               writing.get();
+            }
+
+            if ( count == 0 )
+            {
+               break;
+            }
+
+            writing = pool.submit( [&writeBlock, &block, count]() { writeBlock( block, count ); } );
+
+            pointCount += count;
+            next = 1 - next;
+         }
+      }
+      catch ( ... )
+      {
+         // Don't free the buffers while they are being written
+         if ( writing.valid() )
+         {
+            writing.wait();
+         }
+
+         throw;
+      }
+
+      dataWriter.close();
+
+      data3DHeader.pointCount = pointCount;
+
+      return scanIndex;
+   }
+
    template <typename COORDTYPE>
    CompressedVectorWriter WriterImpl::SetUpData3DPointsData(
       int64_t dataIndex, size_t count, const Data3DPointsData_t<COORDTYPE> &buffers )
    {
-      static_assert( std::is_floating_point<COORDTYPE>::value, "Floating point type required." );
+      // int32_t coordinates are the raw integers of ScaledIntegers
+      constexpr bool cScaleCoordinates = std::is_floating_point<COORDTYPE>::value;
 
       const StructureNode scan( data3D_.get( dataIndex ) );
       CompressedVectorNode points( scan.get( "points" ) );
       const StructureNode proto( points.prototype() );
       std::vector<SourceDestBuffer> sourceBuffers;
 
+      if ( !cScaleCoordinates )
+      {
+         _checkRawCoordinates( proto, buffers );
+      }
+
       if ( proto.isDefined( "cartesianX" ) && ( buffers.cartesianX != nullptr ) )
       {
-         sourceBuffers.emplace_back( imf_, "cartesianX", buffers.cartesianX, count, true, true );
+         sourceBuffers.emplace_back( imf_, "cartesianX", buffers.cartesianX, count, true,
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "cartesianY" ) && ( buffers.cartesianY != nullptr ) )
       {
-         sourceBuffers.emplace_back( imf_, "cartesianY", buffers.cartesianY, count, true, true );
+         sourceBuffers.emplace_back( imf_, "cartesianY", buffers.cartesianY, count, true,
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "cartesianZ" ) && ( buffers.cartesianZ != nullptr ) )
       {
-         sourceBuffers.emplace_back( imf_, "cartesianZ", buffers.cartesianZ, count, true, true );
+         sourceBuffers.emplace_back( imf_, "cartesianZ", buffers.cartesianZ, count, true,
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "sphericalRange" ) && ( buffers.sphericalRange != nullptr ) )
       {
          sourceBuffers.emplace_back( imf_, "sphericalRange", buffers.sphericalRange, count, true,
-                                     true );
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "sphericalAzimuth" ) && ( buffers.sphericalAzimuth != nullptr ) )
       {
          sourceBuffers.emplace_back( imf_, "sphericalAzimuth", buffers.sphericalAzimuth, count,
-                                     true, true );
+                                     true,
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "sphericalElevation" ) && ( buffers.sphericalElevation != nullptr ) )
       {
          sourceBuffers.emplace_back( imf_, "sphericalElevation", buffers.sphericalElevation, count,
-                                     true, true );
+                                     true,
+                                     cScaleCoordinates );
       }
 
       if ( proto.isDefined( "intensity" ) && ( buffers.intensity != nullptr ) )
@@ -1294,13 +1934,543 @@ namespace e57
          }
       }
 
+      // Reserve room for the points as they would be stored without compression. The file is
+      // cut back to what was written when it is closed.
+      if ( preallocatePointData_ )
+      {
+         const uint64_t bytes = ( count * _recordBits( proto, sourceBuffers ) + 7 ) / 8;
+
+         imf_.impl()->reserveSpace( bytes + bytes / 16 );
+      }
+
       // create the writer, all buffers must be setup before this call
       CompressedVectorWriter writer = points.writer( sourceBuffers );
 
+      if ( computeBounds_ )
+      {
+         setUpBoundsComputation( scan, buffers, writer );
+      }
+
+      if ( zoneMapPointCount_ > 0 )
+      {
+         setUpZoneMap( scan, buffers, writer );
+      }
+
+      if ( previewPointInterval_ > 0 )
+      {
+         setUpPreview( scan, sourceBuffers, writer );
+      }
+
       return writer;
    }
 
+   template <typename COORDTYPE>
+   void WriterImpl::setUpBoundsComputation( const StructureNode &scan,
+                                            const Data3DPointsData_t<COORDTYPE> &buffers,
+                                            CompressedVectorWriter &writer )
+   {
+      const bool cartesian = !scan.isDefined( "cartesianBounds" ) &&
+                             ( buffers.cartesianX != nullptr ) &&
+                             ( buffers.cartesianY != nullptr ) && ( buffers.cartesianZ != nullptr );
+      const bool spherical =
+         !scan.isDefined( "sphericalBounds" ) && ( buffers.sphericalRange != nullptr ) &&
+         ( buffers.sphericalAzimuth != nullptr ) && ( buffers.sphericalElevation != nullptr );
+
+      if ( !cartesian && !spherical )
+      {
+         return;
+      }
+
+      // Only look at the invalid states which are written to the file
+      const StructureNode proto( CompressedVectorNode( scan.get( "points" ) ).prototype() );
+
+      auto written = [&]( const char *name, const int8_t *buffer ) -> const int8_t * {
+         return proto.isDefined( name ) ? buffer : nullptr;
+      };
+
+      struct Bounds
+      {
+         Bounds()
+         {
+            cartesian.xMinimum = cartesian.yMinimum = cartesian.zMinimum = DOUBLE_MAX;
+            cartesian.xMaximum = cartesian.yMaximum = cartesian.zMaximum = -DOUBLE_MAX;
+
+            spherical.rangeMinimum = spherical.elevationMinimum = DOUBLE_MAX;
+            spherical.rangeMaximum = spherical.elevationMaximum = -DOUBLE_MAX;
+            spherical.azimuthStart = DOUBLE_MAX;
+            spherical.azimuthEnd = -DOUBLE_MAX;
+         }
+
+         CartesianBounds cartesian;
+         SphericalBounds spherical;
+         int64_t pointCount = 0;
+         bool haveCartesian = false;
+         bool haveRange = false;
+         bool haveAngles = false;
+      };
+
+      auto bounds = std::make_shared<Bounds>();
+
+      const CoordinateScaling sx = _coordinateScaling<COORDTYPE>( proto, "cartesianX" );
+      const CoordinateScaling sy = _coordinateScaling<COORDTYPE>( proto, "cartesianY" );
+      const CoordinateScaling sz = _coordinateScaling<COORDTYPE>( proto, "cartesianZ" );
+      const CoordinateScaling sRange = _coordinateScaling<COORDTYPE>( proto, "sphericalRange" );
+      const CoordinateScaling sAzimuth = _coordinateScaling<COORDTYPE>( proto, "sphericalAzimuth" );
+      const CoordinateScaling sElevation =
+         _coordinateScaling<COORDTYPE>( proto, "sphericalElevation" );
+
+      const COORDTYPE *x = buffers.cartesianX;
+      const COORDTYPE *y = buffers.cartesianY;
+      const COORDTYPE *z = buffers.cartesianZ;
+      const int8_t *cartesianInvalidState =
+         written( "cartesianInvalidState", buffers.cartesianInvalidState );
+
+      const COORDTYPE *range = buffers.sphericalRange;
+      const COORDTYPE *azimuth = buffers.sphericalAzimuth;
+      const COORDTYPE *elevation = buffers.sphericalElevation;
+      const int8_t *sphericalInvalidState =
+         written( "sphericalInvalidState", buffers.sphericalInvalidState );
+
+      auto recordsWritten = [=]( size_t recordCount ) {
+         CartesianBounds &c = bounds->cartesian;
+         SphericalBounds &s = bounds->spherical;
+
+         bounds->pointCount += static_cast<int64_t>( recordCount );
+
+         for ( size_t i = 0; cartesian && ( i < recordCount ); ++i )
+         {
+            // Coordinates of points which are invalid or only give a direction don't count
+            if ( ( cartesianInvalidState != nullptr ) && ( cartesianInvalidState[i] != 0 ) )
+            {
+               continue;
+            }
+
+            c.xMinimum = std::min( c.xMinimum, sx( x[i] ) );
+            c.xMaximum = std::max( c.xMaximum, sx( x[i] ) );
+            c.yMinimum = std::min( c.yMinimum, sy( y[i] ) );
+            c.yMaximum = std::max( c.yMaximum, sy( y[i] ) );
+            c.zMinimum = std::min( c.zMinimum, sz( z[i] ) );
+            c.zMaximum = std::max( c.zMaximum, sz( z[i] ) );
+            bounds->haveCartesian = true;
+         }
+
+         for ( size_t i = 0; spherical && ( i < recordCount ); ++i )
+         {
+            const int8_t cState = ( sphericalInvalidState != nullptr ) ? sphericalInvalidState[i]
+                                                                       : int8_t( 0 );
+
+            // The angles of direction-only points (state 1) are still valid
+            if ( cState == 0 )
+            {
+               s.rangeMinimum = std::min( s.rangeMinimum, sRange( range[i] ) );
+               s.rangeMaximum = std::max( s.rangeMaximum, sRange( range[i] ) );
+               bounds->haveRange = true;
+            }
+
+            if ( cState != 2 )
+            {
+               s.azimuthStart = std::min( s.azimuthStart, sAzimuth( azimuth[i] ) );
+               s.azimuthEnd = std::max( s.azimuthEnd, sAzimuth( azimuth[i] ) );
+               s.elevationMinimum = std::min( s.elevationMinimum, sElevation( elevation[i] ) );
+               s.elevationMaximum = std::max( s.elevationMaximum, sElevation( elevation[i] ) );
+               bounds->haveAngles = true;
+            }
+         }
+      };
+
+      ImageFile imf = imf_;
+      StructureNode scanNode = scan;
+      CompressedVectorNode points( scan.get( "points" ) );
+
+      // Add the bounds to the header once all the points are written. Bounds which miss some of
+      // the points (e.g. written from other buffers) would be wrong, so there are none.
+      auto closed = [=]() mutable {
+         if ( bounds->pointCount != points.childCount() )
+         {
+            return;
+         }
+
+         if ( bounds->haveCartesian )
+         {
+            const CartesianBounds &c = bounds->cartesian;
+            StructureNode bbox( imf );
+
+            bbox.set( "xMinimum", FloatNode( imf, c.xMinimum ) );
+            bbox.set( "xMaximum", FloatNode( imf, c.xMaximum ) );
+            bbox.set( "yMinimum", FloatNode( imf, c.yMinimum ) );
+            bbox.set( "yMaximum", FloatNode( imf, c.yMaximum ) );
+            bbox.set( "zMinimum", FloatNode( imf, c.zMinimum ) );
+            bbox.set( "zMaximum", FloatNode( imf, c.zMaximum ) );
+
+            scanNode.set( "cartesianBounds", bbox );
+         }
+
+         if ( bounds->haveAngles )
+         {
+            const SphericalBounds &s = bounds->spherical;
+            StructureNode sbox( imf );
+
+            sbox.set( "rangeMinimum", FloatNode( imf, bounds->haveRange ? s.rangeMinimum : 0.0 ) );
+            sbox.set( "rangeMaximum", FloatNode( imf, bounds->haveRange ? s.rangeMaximum : 0.0 ) );
+            sbox.set( "elevationMinimum", FloatNode( imf, s.elevationMinimum ) );
+            sbox.set( "elevationMaximum", FloatNode( imf, s.elevationMaximum ) );
+            sbox.set( "azimuthStart", FloatNode( imf, s.azimuthStart ) );
+            sbox.set( "azimuthEnd", FloatNode( imf, s.azimuthEnd ) );
+
+            scanNode.set( "sphericalBounds", sbox );
+         }
+      };
+
+      writer.impl()->addHandlers( recordsWritten, closed );
+   }
+
+   template <typename COORDTYPE>
+   void WriterImpl::setUpZoneMap( const StructureNode &scan,
+                                  const Data3DPointsData_t<COORDTYPE> &buffers,
+                                  CompressedVectorWriter &writer )
+   {
+      if ( ( buffers.cartesianX == nullptr ) || ( buffers.cartesianY == nullptr ) ||
+           ( buffers.cartesianZ == nullptr ) )
+      {
+         throw E57_EXCEPTION2( ErrorBadAPIArgument, "zoneMapPointCount needs all cartesian "
+                                                    "coordinates" );
+      }
+
+      // Only look at the fields (and invalid states) which are written to the file
+      const StructureNode proto( CompressedVectorNode( scan.get( "points" ) ).prototype() );
+
+      auto written = [&]( const char *name, auto *buffer ) -> decltype( buffer ) {
+         return proto.isDefined( name ) ? buffer : nullptr;
+      };
+
+      const CoordinateScaling sx = _coordinateScaling<COORDTYPE>( proto, "cartesianX" );
+      const CoordinateScaling sy = _coordinateScaling<COORDTYPE>( proto, "cartesianY" );
+      const CoordinateScaling sz = _coordinateScaling<COORDTYPE>( proto, "cartesianZ" );
+
+      const COORDTYPE *x = buffers.cartesianX;
+      const COORDTYPE *y = buffers.cartesianY;
+      const COORDTYPE *z = buffers.cartesianZ;
+      const int8_t *cartesianInvalidState =
+         written( "cartesianInvalidState", buffers.cartesianInvalidState );
+
+      const double *intensity = written( "intensity", buffers.intensity );
+      const int8_t *isIntensityInvalid =
+         written( "isIntensityInvalid", buffers.isIntensityInvalid );
+
+      const double *timeStamp = written( "timeStamp", buffers.timeStamp );
+      const int8_t *isTimeStampInvalid =
+         written( "isTimeStampInvalid", buffers.isTimeStampInvalid );
+
+      struct Zones
+      {
+         std::vector<Data3DZone> zones;
+         int64_t pointCount = 0;
+      };
+
+      auto zones = std::make_shared<Zones>();
+      const int64_t zonePointCount = zoneMapPointCount_;
+
+      auto recordsWritten = [=]( size_t recordCount ) {
+         for ( size_t i = 0; i < recordCount; ++i, ++zones->pointCount )
+         {
+            if ( ( zones->pointCount % zonePointCount ) == 0 )
+            {
+               Data3DZone zone;
+               zone.firstPoint = zones->pointCount;
+
+               CartesianBounds &c = zone.cartesianBounds;
+               c.xMinimum = c.yMinimum = c.zMinimum = DOUBLE_MAX;
+               c.xMaximum = c.yMaximum = c.zMaximum = -DOUBLE_MAX;
+
+               zone.intensityMinimum = zone.timeStampMinimum = DOUBLE_MAX;
+               zone.intensityMaximum = zone.timeStampMaximum = -DOUBLE_MAX;
+
+               zones->zones.push_back( zone );
+            }
+
+            Data3DZone &zone = zones->zones.back();
+            ++zone.pointCount;
+
+            // Coordinates of points which are invalid or only give a direction don't count
+            if ( ( cartesianInvalidState == nullptr ) || ( cartesianInvalidState[i] == 0 ) )
+            {
+               CartesianBounds &c = zone.cartesianBounds;
+
+               c.xMinimum = std::min( c.xMinimum, sx( x[i] ) );
+               c.xMaximum = std::max( c.xMaximum, sx( x[i] ) );
+               c.yMinimum = std::min( c.yMinimum, sy( y[i] ) );
+               c.yMaximum = std::max( c.yMaximum, sy( y[i] ) );
+               c.zMinimum = std::min( c.zMinimum, sz( z[i] ) );
+               c.zMaximum = std::max( c.zMaximum, sz( z[i] ) );
+            }
+
+            if ( ( intensity != nullptr ) &&
+                 ( ( isIntensityInvalid == nullptr ) || ( isIntensityInvalid[i] == 0 ) ) )
+            {
+               zone.intensityMinimum = std::min( zone.intensityMinimum, intensity[i] );
+               zone.intensityMaximum = std::max( zone.intensityMaximum, intensity[i] );
+            }
+
+            if ( ( timeStamp != nullptr ) &&
+                 ( ( isTimeStampInvalid == nullptr ) || ( isTimeStampInvalid[i] == 0 ) ) )
+            {
+               zone.timeStampMinimum = std::min( zone.timeStampMinimum, timeStamp[i] );
+               zone.timeStampMaximum = std::max( zone.timeStampMaximum, timeStamp[i] );
+            }
+         }
+      };
+
+      ImageFile imf = imf_;
+      StructureNode scanNode = scan;
+      CompressedVectorNode points( scan.get( "points" ) );
+
+      // Write the zones once all the points are written. A zone map which misses some of the
+      // points (e.g. written from other buffers) would hide them from readers, so there is none.
+      auto closed = [=]() mutable {
+         if ( ( zones->pointCount == 0 ) || ( zones->pointCount != points.childCount() ) )
+         {
+            return;
+         }
+
+         ustring prefix;
+
+         if ( !imf.extensionsLookupUri( ZONE_MAP_URI, prefix ) )
+         {
+            prefix = "zm";
+            imf.extensionsAdd( prefix, ZONE_MAP_URI );
+         }
+
+         const std::vector<Data3DZone> &zoneList = zones->zones;
+         const size_t zoneCount = zoneList.size();
+
+         std::vector<std::pair<const char *, std::vector<double>>> columns = {
+            { "xMinimum", {} }, { "xMaximum", {} }, { "yMinimum", {} },
+            { "yMaximum", {} }, { "zMinimum", {} }, { "zMaximum", {} },
+         };
+
+         if ( intensity != nullptr )
+         {
+            columns.push_back( { "intensityMinimum", {} } );
+            columns.push_back( { "intensityMaximum", {} } );
+         }
+
+         if ( timeStamp != nullptr )
+         {
+            columns.push_back( { "timeStampMinimum", {} } );
+            columns.push_back( { "timeStampMaximum", {} } );
+         }
+
+         for ( const Data3DZone &zone : zoneList )
+         {
+            const CartesianBounds &c = zone.cartesianBounds;
+            size_t column = 0;
+
+            auto add = [&]( double value ) { columns[column++].second.push_back( value ); };
+
+            add( c.xMinimum );
+            add( c.xMaximum );
+            add( c.yMinimum );
+            add( c.yMaximum );
+            add( c.zMinimum );
+            add( c.zMaximum );
+
+            if ( intensity != nullptr )
+            {
+               add( zone.intensityMinimum );
+               add( zone.intensityMaximum );
+            }
+
+            if ( timeStamp != nullptr )
+            {
+               add( zone.timeStampMinimum );
+               add( zone.timeStampMaximum );
+            }
+         }
+
+         StructureNode zoneProto( imf );
+
+         for ( const auto &column : columns )
+         {
+            zoneProto.set( column.first, FloatNode( imf, 0.0, PrecisionDouble ) );
+         }
+
+         StructureNode zoneMap( imf );
+         zoneMap.set( "pointCount", IntegerNode( imf, zonePointCount ) );
+
+         CompressedVectorNode zonesNode( imf, zoneProto, VectorNode( imf, true ) );
+         zoneMap.set( "zones", zonesNode );
+
+         scanNode.set( prefix + ":zoneMap", zoneMap );
+
+         std::vector<SourceDestBuffer> sourceBuffers;
+
+         for ( auto &column : columns )
+         {
+            sourceBuffers.emplace_back( imf, column.first, column.second.data(), zoneCount,
+                                        true );
+         }
+
+         CompressedVectorWriter zoneWriter = zonesNode.writer( sourceBuffers );
+         zoneWriter.write( zoneCount );
+         zoneWriter.close();
+      };
+
+      writer.impl()->addHandlers( recordsWritten, closed );
+   }
+
+   void WriterImpl::setUpPreview( const StructureNode &scan,
+                                  const std::vector<SourceDestBuffer> &buffers,
+                                  CompressedVectorWriter &writer )
+   {
+      struct Preview
+      {
+         std::vector<std::vector<double>> columns;
+         int64_t pointCount = 0;
+         int64_t nextPoint = 0;
+      };
+
+      const int64_t interval = previewPointInterval_;
+
+      // The point picked from each run is spread over the run, so it doesn't keep hitting the
+      // same row or column of a structured scan
+      auto pick = [interval]( int64_t run ) {
+         uint64_t hash = static_cast<uint64_t>( run ) * 0x9e3779b97f4a7c15ULL;
+         hash ^= hash >> 29;
+
+         return run * interval + static_cast<int64_t>( hash % static_cast<uint64_t>( interval ) );
+      };
+
+      auto preview = std::make_shared<Preview>();
+      preview->columns.resize( buffers.size() );
+      preview->nextPoint = pick( 0 );
+
+      auto recordsWritten = [=]( size_t recordCount ) {
+         const int64_t endPoint = preview->pointCount + static_cast<int64_t>( recordCount );
+
+         while ( preview->nextPoint < endPoint )
+         {
+            const auto record = static_cast<size_t>( preview->nextPoint - preview->pointCount );
+
+            for ( size_t i = 0; i < buffers.size(); ++i )
+            {
+               preview->columns[i].push_back( buffers[i].impl()->elementAt( record ) );
+            }
+
+            preview->nextPoint = pick( preview->nextPoint / interval + 1 );
+         }
+
+         preview->pointCount = endPoint;
+      };
+
+      ImageFile imf = imf_;
+      StructureNode scanNode = scan;
+      CompressedVectorNode points( scan.get( "points" ) );
+
+      // Write the preview once all the points are written, with the fields of the points
+      auto closed = [=]() mutable {
+         if ( ( preview->pointCount == 0 ) || ( preview->pointCount != points.childCount() ) )
+         {
+            return;
+         }
+
+         ustring prefix;
+
+         if ( !imf.extensionsLookupUri( PREVIEW_URI, prefix ) )
+         {
+            prefix = "pv";
+            imf.extensionsAdd( prefix, PREVIEW_URI );
+         }
+
+         const StructureNode proto( points.prototype() );
+         StructureNode previewProto( imf );
+
+         for ( const SourceDestBuffer &buffer : buffers )
+         {
+            const ustring &name = buffer.pathName();
+            const Node field = proto.get( name );
+
+            switch ( field.type() )
+            {
+               case TypeInteger:
+               {
+                  const IntegerNode integer( field );
+                  previewProto.set( name, IntegerNode( imf, integer.minimum(), integer.minimum(),
+                                                       integer.maximum() ) );
+                  break;
+               }
+
+               case TypeScaledInteger:
+               {
+                  const ScaledIntegerNode scaled( field );
+                  previewProto.set( name, ScaledIntegerNode( imf, scaled.minimum(),
+                                                             scaled.minimum(), scaled.maximum(),
+                                                             scaled.scale(), scaled.offset() ) );
+                  break;
+               }
+
+               case TypeFloat:
+               {
+                  const FloatNode real( field );
+                  previewProto.set( name, FloatNode( imf, real.minimum(), real.precision(),
+                                                     real.minimum(), real.maximum() ) );
+                  break;
+               }
+
+               default:
+                  throw E57_EXCEPTION2( ErrorBadPrototype, "pathName=" + name );
+            }
+         }
+
+         const size_t previewCount = preview->columns.empty() ? 0 : preview->columns[0].size();
+
+         StructureNode previewNode( imf );
+         previewNode.set( "pointInterval", IntegerNode( imf, interval ) );
+
+         CompressedVectorNode previewPoints( imf, previewProto, VectorNode( imf, true ) );
+         previewNode.set( "points", previewPoints );
+
+         scanNode.set( prefix + ":preview", previewNode );
+
+         if ( previewCount == 0 )
+         {
+            return;
+         }
+
+         std::vector<SourceDestBuffer> sourceBuffers;
+
+         for ( size_t i = 0; i < buffers.size(); ++i )
+         {
+            sourceBuffers.emplace_back( imf, buffers[i].pathName(), preview->columns[i].data(),
+                                        previewCount, true, buffers[i].doScaling() );
+         }
+
+         CompressedVectorWriter previewWriter = previewPoints.writer( sourceBuffers );
+         previewWriter.write( previewCount );
+         previewWriter.close();
+      };
+
+      writer.impl()->addHandlers( recordsWritten, closed );
+   }
+
    // Explicit template instantiation
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader,
+                                                 const Data3DPointsData_t<float> &buffers );
+
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader,
+                                                 const Data3DPointsData_t<double> &buffers );
+
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader,
+                                                 const Data3DPointsData_t<int32_t> &buffers );
+
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                                 const Data3DPointsProducer<float> &producer );
+
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                                 const Data3DPointsProducer<double> &producer );
+
+   template int64_t WriterImpl::WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                                                 const Data3DPointsProducer<int32_t> &producer );
+
    template CompressedVectorWriter WriterImpl::SetUpData3DPointsData(
       int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<float> &buffers );
 
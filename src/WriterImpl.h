@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <mutex>
+
+#include "Common.h"
 #include "E57SimpleData.h"
 #include "E57SimpleWriter.h"
 
@@ -37,6 +40,7 @@ namespace e57
    {
    public:
       WriterImpl( const ustring &filePath, const WriterOptions &options );
+      WriterImpl( std::shared_ptr<ImageFileIO> io, const WriterOptions &options );
       ~WriterImpl();
 
       // disallow copying a WriterImpl
@@ -47,6 +51,12 @@ namespace e57
 
       bool IsOpen() const;
 
+      bool FitsScaledIntegerRanges() const;
+
+      /// Held while a Data3D block is added and its writer set up, so WriteData3DData() can be
+      /// called on several threads at once (see ImageFileImpl::writersMutex())
+      std::recursive_mutex &WritersMutex();
+
       bool Close();
 
       int64_t NewImage2D( Image2D &image2DHeader );
@@ -57,6 +67,15 @@ namespace e57
 
       int64_t NewData3D( Data3D &data3DHeader );
 
+      /// Add a Data3D block and write all its points (see Writer::WriteData3DData())
+      template <typename COORDTYPE>
+      int64_t WriteData3DData( Data3D &data3DHeader, const Data3DPointsData_t<COORDTYPE> &buffers );
+
+      /// Add a Data3D block and write the points given by producer (see Writer::WriteData3DData())
+      template <typename COORDTYPE>
+      int64_t WriteData3DData( Data3D &data3DHeader, size_t blockSize,
+                               const Data3DPointsProducer<COORDTYPE> &producer );
+
       template <typename COORDTYPE>
       CompressedVectorWriter SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                     const Data3DPointsData_t<COORDTYPE> &buffers );
@@ -73,11 +92,35 @@ namespace e57
       ImageFile GetRawIMF();
 
    private:
+      WriterImpl( const ImageFile &imf, const WriterOptions &options );
+
+      template <typename COORDTYPE>
+      void setUpBoundsComputation( const StructureNode &scan,
+                                   const Data3DPointsData_t<COORDTYPE> &buffers,
+                                   CompressedVectorWriter &writer );
+
+      template <typename COORDTYPE>
+      void setUpZoneMap( const StructureNode &scan, const Data3DPointsData_t<COORDTYPE> &buffers,
+                         CompressedVectorWriter &writer );
+
+      void setUpPreview( const StructureNode &scan, const std::vector<SourceDestBuffer> &buffers,
+                         CompressedVectorWriter &writer );
+
       ImageFile imf_;
       StructureNode root_;
 
       VectorNode data3D_;
 
       VectorNode images2D_;
+
+      bool computeBounds_;             /// see WriterOptions::computeBounds
+      bool fitScaledIntegerRanges_;    /// see WriterOptions::fitScaledIntegerRanges
+      int64_t zoneMapPointCount_;      /// see WriterOptions::zoneMapPointCount
+      int64_t spatialOrderPointCount_; /// see WriterOptions::spatialOrderPointCount
+      int64_t previewPointInterval_;   /// see WriterOptions::previewPointInterval
+      int deflateLevel_;               /// see WriterOptions::deflateLevel
+      std::vector<ustring> deltaCodecFields_;     /// see WriterOptions::deltaCodecFields
+      std::vector<ustring> runLengthCodecFields_; /// see WriterOptions::runLengthCodecFields
+      bool preallocatePointData_;                 /// see WriterOptions::preallocatePointData
    }; // end Writer class
 } // end namespace e57
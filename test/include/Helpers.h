@@ -2,6 +2,20 @@
 // libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#if defined( _WIN32 )
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "E57SimpleWriter.h"
+
 // GoogleTest's ASSERT_NO_THROW() doesn't let us show any info about the exceptions.
 // This wrapper macro will output the e57::E57Exception context on failure.
 #define E57_ASSERT_NO_THROW( code )                                                                \
@@ -15,3 +29,90 @@
    }
 
 #define E57_ASSERT_THROW( code ) ASSERT_THROW( code, e57::E57Exception )
+
+// Some tests exercise the deprecated API on purpose.
+#if defined( _MSC_VER )
+#define E57_IGNORE_DEPRECATED_BEGIN                                                                \
+   __pragma( warning( push ) ) __pragma( warning( disable : 4996 ) )
+#define E57_IGNORE_DEPRECATED_END __pragma( warning( pop ) )
+#else
+#define E57_IGNORE_DEPRECATED_BEGIN                                                                \
+   _Pragma( "GCC diagnostic push" )                                                                \
+      _Pragma( "GCC diagnostic ignored \"-Wdeprecated-declarations\"" )
+#define E57_IGNORE_DEPRECATED_END _Pragma( "GCC diagnostic pop" )
+#endif
+
+namespace Helpers
+{
+   // Make a new, empty directory in the system's temporary directory.
+   // Returns its path, or an empty string if it couldn't be made.
+   inline std::string MakeTemporaryDirectory( const std::string &prefix )
+   {
+#if defined( _WIN32 )
+      const char *temp = std::getenv( "TEMP" );
+      const std::string base = std::string( ( temp != nullptr ) ? temp : "." ) + "\\" + prefix;
+
+      for ( int attempt = 0; attempt < 100; ++attempt )
+      {
+         const std::string path =
+            base + "-" +
+            std::to_string( std::chrono::steady_clock::now().time_since_epoch().count() );
+
+         if ( ::_mkdir( path.c_str() ) == 0 )
+         {
+            return path;
+         }
+      }
+
+      return {};
+#else
+      const char *temp = std::getenv( "TMPDIR" );
+      std::string path = std::string( ( temp != nullptr ) ? temp : "/tmp" ) + "/" + prefix +
+                         "-XXXXXX";
+
+      return ( ::mkdtemp( &path[0] ) != nullptr ) ? path : std::string();
+#endif
+   }
+
+   // Get the size of a file in bytes.
+   inline int64_t FileSize( const std::string &fileName )
+   {
+      std::ifstream file( fileName, std::ifstream::ate | std::ifstream::binary );
+      return static_cast<int64_t>( file.tellg() );
+   }
+
+   // Write a file with one scan of pointCount cartesian points, with "<name> File GUID" and
+   // "<name> Header GUID". setOptions and setHeader change what the test is about, and
+   // fillPoint( pointsData, i ) sets point i. Returns the header as it was written.
+   template <class PointsData = e57::Data3DPointsDouble, class SetOptions, class SetHeader,
+             class FillPoint>
+   e57::Data3D WriteScan( const std::string &fileName, const std::string &name,
+                          int64_t pointCount, SetOptions setOptions, SetHeader setHeader,
+                          FillPoint fillPoint )
+   {
+      e57::WriterOptions options;
+      options.guid = name + " File GUID";
+      setOptions( options );
+
+      e57::Writer writer( fileName, options );
+
+      e57::Data3D header;
+      header.guid = name + " Header GUID";
+      header.pointCount = pointCount;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      setHeader( header );
+
+      PointsData pointsData( header );
+
+      for ( int64_t i = 0; i < pointCount; ++i )
+      {
+         fillPoint( pointsData, i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+
+      return header;
+   }
+}
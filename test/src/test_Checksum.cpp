@@ -0,0 +1,39 @@
+// libE57Format testing Copyright © 2023 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Checksum.h"
+
+TEST( Checksum, CRC32CCheckValue )
+{
+   // Standard check value for CRC-32C
+   const char cInput[] = "123456789";
+
+   EXPECT_EQ( e57::crc32c( cInput, 9 ), 0xE3069283 );
+   EXPECT_EQ( e57::crc32cSoftware( cInput, 9 ), 0xE3069283 );
+}
+
+TEST( Checksum, CRC32CMatchesSoftware )
+{
+   // Check all the tail lengths and alignments against the table-driven implementation
+   std::vector<char> buffer( 1100 );
+
+   for ( size_t i = 0; i < buffer.size(); ++i )
+   {
+      buffer[i] = static_cast<char>( i * 31 + 7 );
+   }
+
+   for ( size_t offset = 0; offset < 8; ++offset )
+   {
+      for ( size_t size : { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 1020, 1024 } )
+      {
+         EXPECT_EQ( e57::crc32c( buffer.data() + offset, size ),
+                    e57::crc32cSoftware( buffer.data() + offset, size ) )
+            << "implementation=" << e57::crc32cImplementation() << " offset=" << offset
+            << " size=" << size;
+      }
+   }
+}
@@ -102,6 +102,53 @@ TEST( SimpleDataHeader, HeaderMinMaxDouble )
 
 // Checks that the Data3D header and the the cartesianX FloatNode data are the same when read,
 // written, and read again. https://github.com/asmaloney/libE57Format/issues/126
+TEST( SimpleDataHeader, PooledBuffers )
+{
+   e57::Data3D dataHeader;
+
+   dataHeader.pointCount = 7;
+   dataHeader.pointFields.cartesianXField = true;
+   dataHeader.pointFields.cartesianYField = true;
+   dataHeader.pointFields.cartesianZField = true;
+   dataHeader.pointFields.intensityField = true;
+   dataHeader.pointFields.colorRedField = true;
+
+   e57::Data3DPointsPool pool;
+   void *block = nullptr;
+
+   {
+      e57::Data3DPointsFloat pointsData( dataHeader, pool );
+
+      ASSERT_NE( pointsData.cartesianX, nullptr );
+      ASSERT_NE( pointsData.colorRed, nullptr );
+      EXPECT_EQ( pointsData.cartesianInvalidState, nullptr );
+      EXPECT_EQ( pointsData.normalX, nullptr );
+
+      for ( const void *buffer :
+            { static_cast<const void *>( pointsData.cartesianX ),
+              static_cast<const void *>( pointsData.cartesianY ),
+              static_cast<const void *>( pointsData.cartesianZ ),
+              static_cast<const void *>( pointsData.intensity ),
+              static_cast<const void *>( pointsData.colorRed ) } )
+      {
+         EXPECT_EQ( reinterpret_cast<uintptr_t>( buffer ) % e57::DATA3D_POINTS_ALIGNMENT, 0u );
+      }
+
+      // The buffers must not overlap
+      EXPECT_GE( reinterpret_cast<char *>( pointsData.cartesianY ),
+                 reinterpret_cast<char *>( pointsData.cartesianX + dataHeader.pointCount ) );
+
+      block = pointsData.cartesianX;
+   }
+
+   // A header with fewer points fits in the same block
+   dataHeader.pointCount = 3;
+
+   e57::Data3DPointsFloat pointsData( dataHeader, pool );
+
+   EXPECT_EQ( static_cast<void *>( pointsData.cartesianX ), block );
+}
+
 TEST( SimpleData, ReadWrite )
 {
    e57::Reader *originalReader = nullptr;
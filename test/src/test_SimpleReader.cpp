@@ -1,10 +1,27 @@
 // libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "E57SimpleReader.h"
+#include "E57SimpleWriter.h"
 
+#include "CheckedFile.h"
+#include "HalfFloat.h"
+#include "RecordIndex.h"
 #include "Helpers.h"
 #include "TestData.h"
 
@@ -19,6 +36,87 @@ namespace
       EXPECT_EQ( fileHeader.versionMajor, 1 );
       EXPECT_EQ( fileHeader.versionMinor, 0 );
    }
+
+   constexpr int64_t cSeekBufferSize = 1000;
+
+   // @returns the writer's memory usage once the points are written
+   e57::ImageFileMemoryUsage WriteSeekFile( const std::string &fileName, int64_t numPoints,
+                                            e57::WriterOptions writerOptions = {} )
+   {
+      writerOptions.guid = "Seek File GUID";
+
+      e57::Writer writer( fileName, writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Seek Header GUID";
+      header.pointCount = numPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.intensityField = true;
+
+      // Use a bit width which doesn't divide the register size
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.5;
+      header.pointFields.pointRangeMinimum = -2'000'000.0;
+      header.pointFields.pointRangeMaximum = 2'000'000.0;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < numPoints; ++i )
+      {
+         auto doublei = static_cast<double>( i );
+         pointsData.cartesianX[i] = doublei;
+         pointsData.cartesianY[i] = -doublei;
+         pointsData.cartesianZ[i] = doublei * 0.5;
+         pointsData.intensity[i] = static_cast<float>( i % 100 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+
+      return writer.GetRawIMF().memoryUsage();
+   }
+
+   void CheckRead( e57::CompressedVectorReader &vectorReader,
+                   const e57::Data3DPointsDouble &pointsData, int64_t numPoints,
+                   int64_t firstRecord )
+   {
+      const int64_t expected = std::min( cSeekBufferSize, numPoints - firstRecord );
+
+      ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( expected ) );
+
+      for ( int64_t i = 0; i < expected; ++i )
+      {
+         auto doublei = static_cast<double>( firstRecord + i );
+         ASSERT_EQ( pointsData.cartesianX[i], doublei );
+         ASSERT_EQ( pointsData.cartesianY[i], -doublei );
+         ASSERT_EQ( pointsData.cartesianZ[i], doublei * 0.5 );
+         ASSERT_EQ( pointsData.intensity[i], static_cast<float>( ( firstRecord + i ) % 100 ) );
+      }
+   }
+
+   // Check seeking around a file written by WriteSeekFile() with a million points
+   void CheckSeeks( e57::CompressedVectorReader &vectorReader,
+                    const e57::Data3DPointsDouble &pointsData, int64_t numPoints )
+   {
+      // Forwards, backwards, within the current chunk, and to the last record
+      for ( int64_t recordNumber : { 500'000, 123'457, 124'999, 0, 999'999, 640, 765'432 } )
+      {
+         vectorReader.seek( recordNumber );
+         CheckRead( vectorReader, pointsData, numPoints, recordNumber );
+      }
+
+      // Reading carries on from where the seek left off
+      vectorReader.seek( 250'001 );
+      CheckRead( vectorReader, pointsData, numPoints, 250'001 );
+      CheckRead( vectorReader, pointsData, numPoints, 250'001 + cSeekBufferSize );
+
+      // It's OK to seek to one past the end, but not further
+      vectorReader.seek( numPoints );
+      EXPECT_EQ( vectorReader.read(), 0u );
+
+      E57_ASSERT_THROW( vectorReader.seek( numPoints + 1 ) );
+   }
 }
 
 TEST( SimpleReader, PathError )
@@ -26,6 +124,2769 @@ TEST( SimpleReader, PathError )
    E57_ASSERT_THROW( e57::Reader( "./no-path/empty.e57", {} ) );
 }
 
+TEST( SimpleReader, PacketCacheSize )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Packet Cache Size File GUID";
+
+      e57::Writer writer( "./PacketCacheSize.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Packet Cache Size Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.intensityField = true;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         auto doublei = static_cast<double>( i );
+         pointsData.cartesianX[i] = doublei;
+         pointsData.cartesianY[i] = -doublei;
+         pointsData.cartesianZ[i] = doublei * 0.5;
+         pointsData.intensity[i] = static_cast<float>( i % 100 ) / 100.0f;
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   // Each field is read from its own packets, so a single-packet cache has to keep re-reading
+   e57::ReaderOptions options;
+   options.packetCacheSize = 1;
+
+   e57::Reader reader( "./PacketCacheSize.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   EXPECT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+
+   vectorReader.close();
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      auto doublei = static_cast<double>( i );
+      ASSERT_EQ( pointsData.cartesianX[i], doublei );
+      ASSERT_EQ( pointsData.cartesianY[i], -doublei );
+      ASSERT_EQ( pointsData.cartesianZ[i], doublei * 0.5 );
+   }
+
+   // A cache must hold at least one packet
+   options.packetCacheSize = 0;
+
+   E57_ASSERT_THROW( e57::Reader( "./PacketCacheSize.e57", options ) );
+}
+
+TEST( SimpleReader, DecodeThreadCount )
+{
+   constexpr int64_t cNumPoints = 200'000;
+
+   WriteSeekFile( "./DecodeThreadCount.e57", cNumPoints );
+
+   // 0 uses all the hardware threads, which may be just one
+   for ( unsigned threadCount : { 4u, 0u } )
+   {
+      e57::ReaderOptions options;
+      options.decodeThreadCount = threadCount;
+
+      e57::Reader reader( "./DecodeThreadCount.e57", options );
+
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      // Read the whole thing a buffer at a time, so the fields stop in the middle of packets
+      for ( int64_t firstRecord = 0; firstRecord < cNumPoints; firstRecord += cSeekBufferSize )
+      {
+         CheckRead( vectorReader, pointsData, cNumPoints, firstRecord );
+      }
+
+      EXPECT_EQ( vectorReader.read(), 0u );
+
+      vectorReader.seek( 123'457 );
+      CheckRead( vectorReader, pointsData, cNumPoints, 123'457 );
+
+      vectorReader.close();
+   }
+}
+
+namespace
+{
+   // Runs each task on a thread of its own, and counts them
+   class CountingExecutor : public e57::Executor
+   {
+   public:
+      ~CountingExecutor() override
+      {
+         for ( auto &task : tasks_ )
+         {
+            task.wait();
+         }
+      }
+
+      void submit( std::function<void()> task ) override
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         tasks_.push_back( std::async( std::launch::async, std::move( task ) ) );
+      }
+
+      unsigned int concurrency() const override
+      {
+         return 4;
+      }
+
+      size_t submitted()
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         return tasks_.size();
+      }
+
+   private:
+      std::mutex mutex_;
+      std::vector<std::future<void>> tasks_;
+   };
+}
+
+TEST( SimpleReader, Executor )
+{
+   constexpr int64_t cNumPoints = 200'000;
+
+   auto executor = std::make_shared<CountingExecutor>();
+
+   // 0 uses the executor's concurrency
+   e57::WriterOptions writerOptions;
+   writerOptions.encodeThreadCount = 0;
+   writerOptions.executor = executor;
+
+   WriteSeekFile( "./Executor.e57", cNumPoints, writerOptions );
+
+   const size_t encodeTasks = executor->submitted();
+   EXPECT_GT( encodeTasks, 0u );
+
+   e57::ReaderOptions options;
+   options.decodeThreadCount = 0;
+   options.executor = executor;
+
+   e57::Reader reader( "./Executor.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t firstRecord = 0; firstRecord < cNumPoints; firstRecord += cSeekBufferSize )
+   {
+      CheckRead( vectorReader, pointsData, cNumPoints, firstRecord );
+   }
+
+   vectorReader.close();
+
+   EXPECT_GT( executor->submitted(), encodeTasks );
+
+   // Reading ranges on the executor decodes on it too
+   e57::Data3DPointsDouble allPoints( header );
+   ASSERT_TRUE( reader.ReadData3DPointsDataParallel( 0, allPoints, 0 ) );
+
+   for ( int64_t i = 0; i < cNumPoints; i += 997 )
+   {
+      ASSERT_EQ( allPoints.cartesianX[i], static_cast<double>( i ) );
+   }
+}
+
+TEST( SimpleReader, Trace )
+{
+   constexpr int64_t cNumPoints = 20'000;
+
+   // The spans are reported from several threads, and checked once the work is done
+   std::mutex mutex;
+   std::map<std::string, size_t> spans;
+
+   const e57::TraceHandler handler = [&]( const e57::TraceEvent &event ) {
+      std::lock_guard<std::mutex> lock( mutex );
+      ++spans[event.name];
+   };
+
+   e57::WriterOptions writerOptions;
+   writerOptions.traceHandler = handler;
+
+   WriteSeekFile( "./Trace.e57", cNumPoints, writerOptions );
+
+   // Without E57_TRACING nothing is reported
+   if ( spans.empty() )
+   {
+      return;
+   }
+
+   EXPECT_EQ( spans["open"], 1U );
+   EXPECT_GT( spans["writePacket"], 0U );
+   EXPECT_GT( spans["writePages"], 0U );
+   EXPECT_EQ( spans["close"], 1U );
+
+   spans.clear();
+
+   e57::ReaderOptions options;
+   options.traceHandler = handler;
+
+   e57::Reader reader( "./Trace.e57", options );
+
+   // The spans of opening the file were kept until the handler was set
+   EXPECT_EQ( spans["open"], 1U );
+   EXPECT_EQ( spans["parseXml"], 1U );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+   ASSERT_TRUE( reader.ReadData3DPointsDataParallel( 0, pointsData, 1 ) );
+
+   reader.Close();
+
+   EXPECT_GT( spans["readPacket"], 0U );
+   EXPECT_GT( spans["decodePacket"], 0U );
+   EXPECT_EQ( spans["close"], 1U );
+}
+
+TEST( SimpleReader, BufferAllocator )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   // Counts what is taken from the heap, as the encoders and the writer's page buffers use it
+   struct CountingAllocator : e57::BufferAllocator
+   {
+      void *allocate( size_t size ) override
+      {
+         ++allocations;
+         outstanding += size;
+
+         return e57::BufferAllocator::allocate( size );
+      }
+
+      void deallocate( void *memory, size_t size ) override
+      {
+         outstanding -= size;
+
+         e57::BufferAllocator::deallocate( memory, size );
+      }
+
+      std::atomic<size_t> allocations{ 0 };
+      std::atomic<size_t> outstanding{ 0 };
+   };
+
+   auto counting = std::make_shared<CountingAllocator>();
+
+   e57::WriterOptions writerOptions;
+   writerOptions.bufferAllocator = counting;
+
+   WriteSeekFile( "./BufferAllocator.e57", cNumPoints, writerOptions );
+
+   EXPECT_GT( counting->allocations, 0U );
+   EXPECT_EQ( counting->outstanding, 0U );
+
+   // Blocks are aligned, and small ones are reused
+   auto hugePages = std::make_shared<e57::HugePageAllocator>();
+
+   void *small = hugePages->allocate( 1'000 );
+   void *large = hugePages->allocate( 3 * e57::HugePageAllocator::hugePageSize );
+
+   EXPECT_EQ( reinterpret_cast<uintptr_t>( small ) % e57::BUFFER_ALIGNMENT, 0U );
+   EXPECT_EQ( reinterpret_cast<uintptr_t>( large ) % e57::BUFFER_ALIGNMENT, 0U );
+
+   hugePages->deallocate( large, 3 * e57::HugePageAllocator::hugePageSize );
+   hugePages->deallocate( small, 1'000 );
+
+   EXPECT_EQ( hugePages->allocate( 1'000 ), small );
+   hugePages->deallocate( small, 1'000 );
+
+   for ( const std::shared_ptr<e57::BufferAllocator> &allocator :
+         std::vector<std::shared_ptr<e57::BufferAllocator>>{ counting, hugePages } )
+   {
+      const size_t allocations = counting->allocations;
+
+      e57::ReaderOptions options;
+      options.bufferAllocator = allocator;
+
+      e57::Reader reader( "./BufferAllocator.e57", options );
+
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      CheckRead( vectorReader, pointsData, cNumPoints, 0 );
+      vectorReader.seek( 76'543 );
+      CheckRead( vectorReader, pointsData, cNumPoints, 76'543 );
+
+      vectorReader.close();
+      reader.Close();
+
+      if ( allocator == counting )
+      {
+         EXPECT_GT( counting->allocations, allocations );
+      }
+   }
+
+   EXPECT_EQ( counting->outstanding, 0U );
+}
+
+TEST( SimpleReader, ReadData3DPointsData )
+{
+   constexpr int64_t cNumScans = 6;
+
+   // Each scan has a different size, and its points depend on the scan
+   auto pointCount = []( int64_t scan ) { return 20'000 + scan * 7'919; };
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Read Data3D Points File GUID";
+
+      e57::Writer writer( "./ReadData3DPointsData.e57", writerOptions );
+
+      for ( int64_t scan = 0; scan < cNumScans; ++scan )
+      {
+         e57::Data3D header;
+         header.guid = "Read Data3D Points Header GUID " + std::to_string( scan );
+         header.pointCount = pointCount( scan );
+         header.pointFields.cartesianXField = true;
+         header.pointFields.cartesianYField = true;
+         header.pointFields.cartesianZField = true;
+         header.pointFields.intensityField = true;
+
+         e57::Data3DPointsDouble pointsData( header );
+
+         for ( int64_t i = 0; i < header.pointCount; ++i )
+         {
+            auto doublei = static_cast<double>( i );
+            pointsData.cartesianX[i] = doublei;
+            pointsData.cartesianY[i] = static_cast<double>( scan );
+            pointsData.cartesianZ[i] = -doublei;
+            pointsData.intensity[i] = static_cast<float>( ( i + scan ) % 100 );
+         }
+
+         writer.WriteData3DData( header, pointsData );
+      }
+   }
+
+   e57::Reader reader( "./ReadData3DPointsData.e57", {} );
+   ASSERT_EQ( reader.GetData3DCount(), cNumScans );
+
+   // Read them all, except the first, in reverse
+   std::vector<int64_t> dataIndices;
+   std::vector<std::unique_ptr<e57::Data3DPointsDouble>> pointsData;
+   std::vector<e57::Data3DPointsDouble *> buffers;
+
+   for ( int64_t scan = cNumScans - 1; scan > 0; --scan )
+   {
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( scan, header ) );
+
+      dataIndices.push_back( scan );
+      pointsData.emplace_back( new e57::Data3DPointsDouble( header ) );
+      buffers.push_back( pointsData.back().get() );
+   }
+
+   std::mutex callbackMutex;
+   std::map<int64_t, size_t> pointsRead;
+
+   ASSERT_TRUE( reader.ReadData3DPointsData(
+      dataIndices, buffers, 3, [&]( int64_t dataIndex, size_t count ) {
+         std::lock_guard<std::mutex> lock( callbackMutex );
+         pointsRead[dataIndex] = count;
+      } ) );
+
+   ASSERT_EQ( pointsRead.size(), dataIndices.size() );
+
+   for ( size_t n = 0; n < dataIndices.size(); ++n )
+   {
+      const int64_t scan = dataIndices[n];
+      const e57::Data3DPointsDouble &points = *buffers[n];
+
+      ASSERT_EQ( pointsRead[scan], static_cast<size_t>( pointCount( scan ) ) );
+
+      for ( int64_t i = 0; i < pointCount( scan ); ++i )
+      {
+         auto doublei = static_cast<double>( i );
+         ASSERT_EQ( points.cartesianX[i], doublei );
+         ASSERT_EQ( points.cartesianY[i], static_cast<double>( scan ) );
+         ASSERT_EQ( points.cartesianZ[i], -doublei );
+         ASSERT_EQ( points.intensity[i], static_cast<float>( ( i + scan ) % 100 ) );
+      }
+   }
+
+   // Every index must be valid and have a buffer
+   dataIndices.back() = cNumScans;
+   E57_ASSERT_THROW( reader.ReadData3DPointsData( dataIndices, buffers, 2 ) );
+
+   dataIndices.back() = 0;
+   buffers.pop_back();
+   E57_ASSERT_THROW( reader.ReadData3DPointsData( dataIndices, buffers, 2 ) );
+}
+
+TEST( SimpleReader, ReadData3DPointsDataParallel )
+{
+   // Not a multiple of the range size
+   constexpr int64_t cNumPoints = 456'789;
+
+   WriteSeekFile( "./ReadData3DPointsDataParallel.e57", cNumPoints );
+
+   e57::Reader reader( "./ReadData3DPointsDataParallel.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   for ( unsigned threadCount : { 1u, 4u, 0u } )
+   {
+      e57::Data3DPointsDouble pointsData( header );
+
+      ASSERT_TRUE( reader.ReadData3DPointsDataParallel( 0, pointsData, threadCount ) );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         auto doublei = static_cast<double>( i );
+         ASSERT_EQ( pointsData.cartesianX[i], doublei );
+         ASSERT_EQ( pointsData.cartesianY[i], -doublei );
+         ASSERT_EQ( pointsData.cartesianZ[i], doublei * 0.5 );
+         ASSERT_EQ( pointsData.intensity[i], static_cast<float>( i % 100 ) );
+      }
+   }
+
+   e57::Data3DPointsDouble pointsData( header );
+   E57_ASSERT_THROW( reader.ReadData3DPointsDataParallel( 1, pointsData, 4 ) );
+}
+
+// Reads of a block after the first take its points from the sidecar written by the first
+TEST( SimpleReader, DecodedCache )
+{
+   constexpr int64_t cNumPoints = 200'000;
+
+   WriteSeekFile( "./DecodedCache.e57", cNumPoints );
+
+   // No sidecars of earlier runs
+   e57::ReaderOptions options;
+   options.decodedCacheDirectory = Helpers::MakeTemporaryDirectory( "DecodedCache" );
+   ASSERT_FALSE( options.decodedCacheDirectory.empty() );
+
+   const auto checkPoints = []( const e57::Data3DPointsDouble &pointsData ) {
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         auto doublei = static_cast<double>( i );
+         ASSERT_EQ( pointsData.cartesianX[i], doublei );
+         ASSERT_EQ( pointsData.cartesianY[i], -doublei );
+         ASSERT_EQ( pointsData.cartesianZ[i], doublei * 0.5 );
+
+         if ( pointsData.intensity != nullptr )
+         {
+            ASSERT_EQ( pointsData.intensity[i], static_cast<float>( i % 100 ) );
+         }
+      }
+   };
+
+   e57::Data3D header;
+
+   {
+      e57::Reader reader( "./DecodedCache.e57", options );
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      ASSERT_TRUE( reader.ReadData3DPointsData( { 0 }, { &pointsData }, 1 ) );
+      checkPoints( pointsData );
+
+      const e57::ImageFileStatistics statistics = reader.GetRawIMF().statistics();
+      if ( statistics.enabled )
+      {
+         EXPECT_GT( statistics.dataPacketsDecoded, 0u );
+      }
+   }
+
+   // The same buffers, or fewer of them, come from the sidecar
+   e57::Data3D coordinatesHeader = header;
+   coordinatesHeader.pointFields.intensityField = false;
+
+   for ( e57::Data3D *pointsHeader : { &header, &coordinatesHeader } )
+   {
+      e57::Reader reader( "./DecodedCache.e57", options );
+
+      e57::Data3DPointsDouble pointsData( *pointsHeader );
+
+      ASSERT_TRUE( reader.ReadData3DPointsDataParallel( 0, pointsData, 4 ) );
+      checkPoints( pointsData );
+
+      const e57::ImageFileStatistics statistics = reader.GetRawIMF().statistics();
+      EXPECT_EQ( statistics.dataPacketsDecoded, 0u );
+   }
+
+   // Floats have a sidecar of their own
+   e57::Reader reader( "./DecodedCache.e57", options );
+
+   e57::Data3DPointsFloat floatData( header );
+
+   ASSERT_TRUE( reader.ReadData3DPointsDataParallel( 0, floatData, 1 ) );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( floatData.cartesianX[i], static_cast<float>( i ) );
+      ASSERT_EQ( floatData.intensity[i], static_cast<float>( i % 100 ) );
+   }
+}
+
+TEST( SimpleReader, ConcurrentReaders )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   WriteSeekFile( "./ConcurrentReaders.e57", cNumPoints );
+
+   e57::Reader reader( "./ConcurrentReaders.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   // Each thread reads the same scan with its own reader, starting at a different record
+   constexpr int cNumThreads = 4;
+
+   std::vector<std::thread> threads;
+   std::vector<int64_t> failures( cNumThreads, -1 );
+
+   for ( int t = 0; t < cNumThreads; ++t )
+   {
+      threads.emplace_back( [&, t] {
+         try
+         {
+            // The buffers' constructor writes to the header, so each thread needs its own
+            e57::Data3D threadHeader( header );
+            e57::Data3DPointsDouble pointsData( threadHeader );
+
+            auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+            const int64_t firstRecord = t * 12'345;
+            vectorReader.seek( static_cast<uint64_t>( firstRecord ) );
+
+            failures[t] = 0;
+
+            for ( int64_t record = firstRecord; record < cNumPoints; )
+            {
+               const unsigned count = vectorReader.read();
+
+               if ( count == 0 )
+               {
+                  ++failures[t];
+                  break;
+               }
+
+               for ( unsigned i = 0; i < count; ++i, ++record )
+               {
+                  if ( pointsData.cartesianX[i] != static_cast<double>( record ) )
+                  {
+                     ++failures[t];
+                  }
+               }
+            }
+
+            vectorReader.close();
+         }
+         catch ( ... )
+         {
+            failures[t] = -2;
+         }
+      } );
+   }
+
+   for ( auto &thread : threads )
+   {
+      thread.join();
+   }
+
+   for ( int t = 0; t < cNumThreads; ++t )
+   {
+      EXPECT_EQ( failures[t], 0 ) << "thread " << t;
+   }
+}
+
+TEST( SimpleReader, DatasetReader )
+{
+   constexpr int64_t cNumPoints = 5'000;
+   constexpr size_t cNumFiles = 4;
+
+   std::vector<e57::ustring> filePaths;
+
+   for ( size_t i = 0; i < cNumFiles; ++i )
+   {
+      filePaths.push_back( "./DatasetReader-" + std::to_string( i ) + ".e57" );
+      WriteSeekFile( filePaths.back(), cNumPoints + static_cast<int64_t>( i ) );
+   }
+
+   e57::DatasetOptions options;
+   options.maxOpenFiles = 2;
+   options.threadCount = 1;
+
+   e57::DatasetReader dataset( filePaths, options );
+
+   ASSERT_EQ( dataset.FileCount(), cNumFiles );
+   ASSERT_EQ( dataset.FilePath( 3 ), filePaths[3] );
+   ASSERT_EQ( dataset.OpenFileCount(), 0u );
+
+   // Keep the only thread busy until all the reads have been submitted
+   std::promise<void> release;
+   std::shared_future<void> released = release.get_future().share();
+
+   auto blocker = dataset.Submit( 0, [released]( e57::Reader & ) { released.wait(); } );
+
+   std::mutex orderMutex;
+   std::vector<size_t> order;
+   std::vector<std::unique_ptr<e57::Data3DPointsDouble>> buffers;
+   std::vector<std::future<void>> reads;
+
+   for ( size_t i = 0; i < cNumFiles; ++i )
+   {
+      e57::Data3D header;
+      header.pointCount = cNumPoints + static_cast<int64_t>( i );
+      header.pointFields.cartesianXField = true;
+      buffers.emplace_back( new e57::Data3DPointsDouble( header ) );
+   }
+
+   for ( size_t i = 0; i < cNumFiles; ++i )
+   {
+      // Files 1 and 3 first, then 0 and 2 in the order they were submitted
+      const int priority = ( i % 2 == 1 ) ? 10 : 0;
+
+      reads.push_back( dataset.ReadData3DPointsData( i, 0, *buffers[i], priority ) );
+      dataset.Submit(
+         i,
+         [&, i]( e57::Reader & ) {
+            std::lock_guard<std::mutex> lock( orderMutex );
+            order.push_back( i );
+         },
+         priority );
+   }
+
+   auto failing = dataset.Submit( 1, []( e57::Reader & ) { throw std::runtime_error( "task" ); } );
+
+   release.set_value();
+   blocker.get();
+
+   for ( auto &read : reads )
+   {
+      read.get();
+   }
+
+   EXPECT_THROW( failing.get(), std::runtime_error );
+
+   {
+      std::lock_guard<std::mutex> lock( orderMutex );
+      EXPECT_EQ( order, ( std::vector<size_t>{ 1, 3, 0, 2 } ) );
+   }
+
+   for ( size_t i = 0; i < cNumFiles; ++i )
+   {
+      const int64_t count = cNumPoints + static_cast<int64_t>( i );
+
+      ASSERT_EQ( buffers[i]->cartesianX[0], 0.0 );
+      ASSERT_EQ( buffers[i]->cartesianX[count - 1], static_cast<double>( count - 1 ) );
+   }
+
+   EXPECT_LE( dataset.OpenFileCount(), 2u );
+
+   // A reader which is held keeps its file open
+   std::shared_ptr<e57::Reader> reader = dataset.GetReader( 2 );
+   EXPECT_EQ( reader->GetData3DCount(), 1 );
+
+   E57_ASSERT_THROW( dataset.GetReader( cNumFiles ) );
+   E57_ASSERT_THROW( dataset.Submit( cNumFiles, []( e57::Reader & ) {} ) );
+
+   options.readsPerDevice = 0;
+   E57_ASSERT_THROW( e57::DatasetReader( filePaths, options ) );
+}
+
+TEST( SimpleReader, Seek )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   WriteSeekFile( "./Seek.e57", cNumPoints );
+
+   e57::Reader reader( "./Seek.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+   vectorReader.close();
+}
+
+// A single chunk of points has no index, so seeking decodes from the first data packet
+TEST( SimpleReader, SeekWithoutIndex )
+{
+   constexpr int64_t cNumPoints = 5'000;
+
+   WriteSeekFile( "./SeekWithoutIndex.e57", cNumPoints );
+
+   e57::Reader reader( "./SeekWithoutIndex.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t recordNumber : { 3'210, 1'234, 4'999, 0, 2'500 } )
+   {
+      vectorReader.seek( static_cast<uint64_t>( recordNumber ) );
+      CheckRead( vectorReader, pointsData, cNumPoints, recordNumber );
+   }
+
+   vectorReader.close();
+}
+
+// Hints to the OS don't change what is read, including after seeking
+TEST( SimpleReader, AccessHints )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   WriteSeekFile( "./AccessHints.e57", cNumPoints );
+
+   e57::ReaderOptions options;
+   options.accessHints = true;
+
+   e57::Reader reader( "./AccessHints.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t first = 0; first < cNumPoints; first += cSeekBufferSize )
+   {
+      CheckRead( vectorReader, pointsData, cNumPoints, first );
+   }
+
+   EXPECT_EQ( vectorReader.read(), 0u );
+
+   CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+   vectorReader.close();
+}
+
+// The counters are only kept if the library is built with E57_STATISTICS.
+TEST( SimpleReader, Statistics )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   WriteSeekFile( "./Statistics.e57", cNumPoints );
+
+   e57::Reader reader( "./Statistics.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t first = 0; first < cNumPoints; first += cSeekBufferSize )
+   {
+      CheckRead( vectorReader, pointsData, cNumPoints, first );
+   }
+
+   vectorReader.close();
+
+   const e57::ImageFileStatistics statistics = reader.GetRawIMF().statistics();
+
+   if ( !statistics.enabled )
+   {
+      EXPECT_EQ( statistics.bytesRead, 0u );
+      EXPECT_EQ( statistics.packetCacheMisses, 0u );
+      EXPECT_EQ( statistics.dataPacketsDecoded, 0u );
+      EXPECT_EQ( statistics.bitpackValuesDecoded, 0u );
+      EXPECT_EQ( statistics.decodeNanoseconds, 0u );
+      return;
+   }
+
+   EXPECT_GT( statistics.bytesRead, 0u );
+   EXPECT_GT( statistics.pagesVerified, 0u );
+   EXPECT_GT( statistics.packetCacheMisses, 0u );
+   EXPECT_GT( statistics.dataPacketsDecoded, 0u );
+   EXPECT_GT( statistics.decodeNanoseconds, 0u );
+
+   // Each packet is read in one pass. The only pages read twice are the ones a packet shares with
+   // the packet before it, and the ones the file header and the XML section share with others.
+   const auto fileSize = static_cast<uint64_t>( Helpers::FileSize( "./Statistics.e57" ) );
+
+   EXPECT_LE( statistics.bytesRead, fileSize + ( statistics.packetCacheMisses + 2 ) * 1024 );
+   EXPECT_LE( statistics.pagesVerified, fileSize / 1024 );
+
+   // x, y, z, and intensity for each point
+   EXPECT_EQ( statistics.bitpackValuesDecoded + statistics.constantValuesDecoded +
+                 statistics.deltaValuesDecoded + statistics.runLengthValuesDecoded,
+              4u * cNumPoints );
+}
+
+// A reader opened after another one was closed finds the packets the first one read in the
+// cache they share
+TEST( SimpleReader, SharedPacketCache )
+{
+   constexpr int64_t cNumPoints = 20'000;
+
+   WriteSeekFile( "./SharedPacketCache.e57", cNumPoints );
+
+   e57::Reader reader( "./SharedPacketCache.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto readAll = [&]() {
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      for ( int64_t first = 0; first < cNumPoints; first += cSeekBufferSize )
+      {
+         CheckRead( vectorReader, pointsData, cNumPoints, first );
+      }
+
+      vectorReader.close();
+
+      return reader.GetRawIMF().statistics();
+   };
+
+   const e57::ImageFileStatistics first = readAll();
+   const e57::ImageFileStatistics second = readAll();
+
+   if ( !first.enabled )
+   {
+      GTEST_SKIP() << "built without E57_STATISTICS";
+   }
+
+   EXPECT_GT( first.packetCacheMisses, 0u );
+   EXPECT_EQ( second.packetCacheMisses, first.packetCacheMisses );
+   EXPECT_GT( second.packetCacheHits, first.packetCacheHits );
+}
+
+TEST( SimpleReader, MemoryBudget )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+   constexpr uint64_t cBudget = 2 * 1024 * 1024;
+
+   // Encoding chunks in parallel, with smaller encoder buffers and fewer chunks at a time
+   e57::WriterOptions writerOptions;
+   writerOptions.encodeThreadCount = 4;
+   writerOptions.memoryBudget = cBudget;
+
+   const e57::ImageFileMemoryUsage writerUsage =
+      WriteSeekFile( "./MemoryBudget.e57", cNumPoints, writerOptions );
+
+   EXPECT_EQ( writerUsage.budget, cBudget );
+   EXPECT_GT( writerUsage.peak, 0u );
+   EXPECT_LE( writerUsage.peak, cBudget );
+   EXPECT_EQ( writerUsage.current, 0u );
+
+   const auto readAll = []( const e57::ReaderOptions &options ) {
+      e57::Reader reader( "./MemoryBudget.e57", options );
+
+      e57::Data3D header;
+      EXPECT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      for ( int64_t first = 0; first < cNumPoints; first += 97 * cSeekBufferSize )
+      {
+         vectorReader.seek( static_cast<uint64_t>( first ) );
+         CheckRead( vectorReader, pointsData, cNumPoints, first );
+      }
+
+      vectorReader.close();
+
+      return reader.GetRawIMF().memoryUsage();
+   };
+
+   // The default packet cache and read-ahead take more than the budget
+   EXPECT_GT( readAll( {} ).peak, cBudget );
+
+   e57::ReaderOptions readerOptions;
+   readerOptions.memoryBudget = cBudget;
+
+   const e57::ImageFileMemoryUsage readerUsage = readAll( readerOptions );
+
+   EXPECT_EQ( readerUsage.budget, cBudget );
+   EXPECT_GT( readerUsage.peak, 0u );
+   EXPECT_LE( readerUsage.peak, cBudget );
+}
+
+// Double buffered reads: each block is decoded while the one before it is being checked.
+TEST( SimpleReader, ReadAsync )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+   constexpr size_t cBufferSize = 30'000;
+
+   WriteSeekFile( "./ReadAsync.e57", cNumPoints );
+
+   e57::ImageFile imf( "./ReadAsync.e57", "r" );
+
+   const e57::VectorNode data3D( imf.root().get( "/data3D" ) );
+   const e57::StructureNode scan( data3D.get( 0 ) );
+   e57::CompressedVectorNode points( scan.get( "points" ) );
+
+   std::vector<double> x[2] = { std::vector<double>( cBufferSize ),
+                                std::vector<double>( cBufferSize ) };
+   std::vector<double> z[2] = { std::vector<double>( cBufferSize ),
+                                std::vector<double>( cBufferSize ) };
+
+   std::vector<e57::SourceDestBuffer> dbufs[2];
+
+   for ( int i = 0; i < 2; ++i )
+   {
+      dbufs[i].emplace_back( imf, "cartesianX", x[i].data(), cBufferSize, true, true );
+      dbufs[i].emplace_back( imf, "cartesianZ", z[i].data(), cBufferSize, true, true );
+   }
+
+   e57::CompressedVectorReader reader = points.reader( dbufs[0] );
+
+   std::future<unsigned> reads[2];
+   reads[0] = reader.readAsync( dbufs[0] );
+
+   int64_t record = 0;
+
+   for ( int current = 0;; current = 1 - current )
+   {
+      reads[1 - current] = reader.readAsync( dbufs[1 - current] );
+
+      const unsigned count = reads[current].get();
+
+      for ( unsigned i = 0; i < count; ++i, ++record )
+      {
+         ASSERT_EQ( x[current][i], static_cast<double>( record ) );
+         ASSERT_EQ( z[current][i], static_cast<double>( record ) * 0.5 );
+      }
+
+      if ( count < cBufferSize )
+      {
+         reads[1 - current].wait();
+         break;
+      }
+   }
+
+   EXPECT_EQ( record, cNumPoints );
+
+   // The reads are done in order, and everything else waits for them
+   reads[0] = reader.readAsync( dbufs[0] );
+   reader.seek( 0 );
+   EXPECT_EQ( reads[0].get(), 0u );
+
+   reads[0] = reader.readAsync( dbufs[0] );
+   reads[1] = reader.readAsync( dbufs[1] );
+   EXPECT_EQ( reads[0].get(), cBufferSize );
+   EXPECT_EQ( reads[1].get(), cBufferSize );
+   EXPECT_EQ( x[1][0], static_cast<double>( cBufferSize ) );
+
+   reader.close();
+   E57_ASSERT_THROW( reader.readAsync( dbufs[0] ) );
+
+   imf.close();
+}
+
+TEST( SimpleReader, ReadData3DPointBlocks )
+{
+   constexpr int64_t cNumPoints = 100'000;
+   constexpr size_t cBlockSize = 30'000;
+
+   WriteSeekFile( "./PointBlocks.e57", cNumPoints );
+
+   e57::Reader reader( "./PointBlocks.e57", {} );
+
+   int64_t record = 0;
+   int blockCount = 0;
+
+   // The file has no normals, so they are left out
+   for ( const e57::Data3DPointBlock &block :
+         reader.ReadData3DPointBlocks( 0, { "intensity", "cartesianX", "normalX" }, cBlockSize ) )
+   {
+      ASSERT_EQ( block.firstPoint, record );
+      ASSERT_EQ( block.columns.size(), 2u );
+      ASSERT_EQ( block.columns[0].name, "intensity" );
+      ASSERT_EQ( block.column( "normalX" ), nullptr );
+
+      const e57::Data3DPointColumn *x = block.column( "cartesianX" );
+      ASSERT_NE( x, nullptr );
+      ASSERT_EQ( x->memoryRepresentation, e57::Real64 );
+      ASSERT_EQ( block.columns[0].memoryRepresentation, e57::Real32 );
+
+      const float *intensity = block.columns[0].values<float>();
+
+      for ( size_t i = 0; i < block.pointCount; ++i, ++record )
+      {
+         ASSERT_EQ( x->values<double>()[i], static_cast<double>( record ) );
+         ASSERT_EQ( intensity[i], static_cast<float>( record % 100 ) );
+      }
+
+      ++blockCount;
+   }
+
+   EXPECT_EQ( record, cNumPoints );
+   EXPECT_EQ( blockCount, 4 );
+
+   E57_ASSERT_THROW( reader.ReadData3DPointBlocks( 0, { "cartesianW" } ) );
+   E57_ASSERT_THROW( reader.ReadData3DPointBlocks( 0, { "cartesianX", "cartesianX" } ) );
+   E57_ASSERT_THROW( reader.ReadData3DPointBlocks( 0, {}, 0 ) );
+}
+
+// Integer fields are read into the smallest type which holds their range
+TEST( SimpleReader, ReadData3DPointBlocksIntegers )
+{
+   constexpr int64_t cNumPoints = 1'000;
+
+   {
+      e57::WriterOptions options;
+      options.guid = "PointBlocksIntegers File GUID";
+
+      e57::Writer writer( "./PointBlocksIntegers.e57", options );
+
+      e57::Data3D header;
+      header.guid = "PointBlocksIntegers Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.rowIndexField = true;
+      header.pointFields.rowIndexMaximum = 1'000;
+      header.pointFields.colorRedField = true;
+      header.pointFields.colorGreenField = true;
+      header.pointFields.colorBlueField = true;
+      header.colorLimits.colorRedMaximum = 255;
+      header.colorLimits.colorGreenMaximum = 255;
+      header.colorLimits.colorBlueMaximum = 255;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = 0.0f;
+         pointsData.cartesianZ[i] = 0.0f;
+         pointsData.rowIndex[i] = static_cast<int32_t>( i );
+         pointsData.colorRed[i] = static_cast<uint16_t>( i % 256 );
+         pointsData.colorGreen[i] = 0;
+         pointsData.colorBlue[i] = 0;
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./PointBlocksIntegers.e57", {} );
+
+   auto blocks = reader.ReadData3DPointBlocks( 0, { "rowIndex", "colorRed", "cartesianX" } );
+
+   ASSERT_TRUE( blocks.next() );
+
+   const e57::Data3DPointBlock &block = blocks.block();
+   ASSERT_EQ( block.pointCount, static_cast<size_t>( cNumPoints ) );
+   ASSERT_EQ( block.columns.size(), 3u );
+   ASSERT_EQ( block.columns[0].memoryRepresentation, e57::UInt16 );
+   ASSERT_EQ( block.columns[1].memoryRepresentation, e57::UInt8 );
+   ASSERT_EQ( block.columns[2].memoryRepresentation, e57::Real32 );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( block.columns[0].values<uint16_t>()[i], i );
+      ASSERT_EQ( block.columns[1].values<uint8_t>()[i], i % 256 );
+      ASSERT_EQ( block.columns[2].values<float>()[i], static_cast<float>( i ) );
+   }
+
+   EXPECT_FALSE( blocks.next() );
+   EXPECT_FALSE( blocks.next() );
+   EXPECT_EQ( blocks.begin(), blocks.end() );
+}
+
+TEST( SimpleReader, EncodeThreadCount )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   // Packets are filled differently when encoding in parallel, but the data and the chunk index
+   // should be just the same
+   e57::WriterOptions writerOptions;
+   writerOptions.encodeThreadCount = 4;
+
+   WriteSeekFile( "./EncodeThreadCount.e57", cNumPoints, writerOptions );
+
+   e57::Reader reader( "./EncodeThreadCount.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t firstRecord = 0; firstRecord < cNumPoints; firstRecord += 97 * cSeekBufferSize )
+   {
+      vectorReader.seek( static_cast<uint64_t>( firstRecord ) );
+      CheckRead( vectorReader, pointsData, cNumPoints, firstRecord );
+   }
+
+   CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, EncodeThreadCountBatches )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+   constexpr int64_t cBatchSize = 300'007;
+
+   // Batches which hold several whole chunks, starting and ending part way through one
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Seek File GUID";
+      writerOptions.encodeThreadCount = 4;
+
+      e57::Writer writer( "./EncodeThreadCountBatches.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Seek Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.intensityField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.5;
+      header.pointFields.pointRangeMinimum = -2'000'000.0;
+      header.pointFields.pointRangeMaximum = 2'000'000.0;
+
+      int64_t first = 0;
+
+      writer.WriteData3DData(
+         header, cBatchSize, [&first]( e57::Data3DPointsDouble &block, size_t capacity ) {
+            const int64_t count = std::min( static_cast<int64_t>( capacity ), cNumPoints - first );
+
+            for ( int64_t i = 0; i < count; ++i )
+            {
+               auto doublei = static_cast<double>( first + i );
+               block.cartesianX[i] = doublei;
+               block.cartesianY[i] = -doublei;
+               block.cartesianZ[i] = doublei * 0.5;
+               block.intensity[i] = static_cast<float>( ( first + i ) % 100 );
+            }
+
+            first += count;
+
+            return static_cast<size_t>( count );
+         } );
+   }
+
+   e57::Reader reader( "./EncodeThreadCountBatches.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   for ( int64_t firstRecord = 0; firstRecord < cNumPoints; firstRecord += 97 * cSeekBufferSize )
+   {
+      vectorReader.seek( static_cast<uint64_t>( firstRecord ) );
+      CheckRead( vectorReader, pointsData, cNumPoints, firstRecord );
+   }
+
+   CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, PacketFillTarget )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   // Packets must fit in the format's maximum, and each encoder must be able to hold a packet
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.packetFillTarget = 65537;
+
+      E57_ASSERT_THROW( WriteSeekFile( "./PacketFillTargetBad.e57", 1000, writerOptions ) );
+
+      writerOptions.packetFillTarget = 32768;
+      writerOptions.encoderBufferSize = 16384;
+
+      E57_ASSERT_THROW( WriteSeekFile( "./PacketFillTargetBad.e57", 1000, writerOptions ) );
+   }
+
+   // Fill the packets as full as they can be, with buffers large enough for the encoders to get
+   // ahead of each other
+   e57::WriterOptions writerOptions;
+   writerOptions.packetFillTarget = 65536;
+   writerOptions.encoderBufferSize = 4 * 65536;
+
+   WriteSeekFile( "./PacketFillTarget.e57", cNumPoints, writerOptions );
+
+   e57::Reader reader( "./PacketFillTarget.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+   vectorReader.close();
+}
+
+// Packets shared between the bytestreams up to the same record read back the same way
+TEST( SimpleReader, PacketPacking )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   // With buffers large enough for the encoders to get ahead of each other, both on the writing
+   // thread and in chunks encoded in parallel
+   for ( unsigned encodeThreadCount : { 1u, 4u } )
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.packetPacking = e57::PacketPackingRecordAligned;
+      writerOptions.packetFillTarget = 65536;
+      writerOptions.encoderBufferSize = 4 * 65536;
+      writerOptions.encodeThreadCount = encodeThreadCount;
+
+      WriteSeekFile( "./PacketPacking.e57", cNumPoints, writerOptions );
+
+      e57::Reader reader( "./PacketPacking.e57", {} );
+
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+      ASSERT_EQ( header.pointCount, cNumPoints );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      for ( int64_t first = 0; first < cNumPoints; first += cSeekBufferSize )
+      {
+         CheckRead( vectorReader, pointsData, cNumPoints, first );
+      }
+
+      CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+      vectorReader.close();
+   }
+}
+
+TEST( SimpleReader, Projection )
+{
+   constexpr int64_t cNumPoints = 20'000;
+
+   // Only the fields which are asked for are decoded. The one bit intensity field has far fewer
+   // bytes in each packet than the others.
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Projection File GUID";
+
+      e57::Writer writer( "./Projection.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Projection Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.intensityField = true;
+      header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+      header.intensityLimits.intensityMinimum = 0.0;
+      header.intensityLimits.intensityMaximum = 1.0;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = 0.0;
+         pointsData.cartesianZ[i] = 0.0;
+         pointsData.intensity[i] = static_cast<float>( ( i / 3 ) % 2 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./Projection.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   // Read just the intensity, then just X
+   for ( int field = 0; field < 2; ++field )
+   {
+      e57::Data3D projected;
+      projected.pointCount = cNumPoints;
+      projected.pointFields.intensityField = ( field == 0 );
+      projected.pointFields.cartesianXField = ( field == 1 );
+
+      constexpr int64_t cBufferSize = 777;
+
+      e57::Data3DPointsDouble pointsData( projected );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+      int64_t total = 0;
+      bool matches = true;
+
+      while ( unsigned count = vectorReader.read() )
+      {
+         for ( unsigned i = 0; i < count; ++i )
+         {
+            const int64_t record = total + i;
+
+            matches = matches && ( ( field == 0 )
+                                      ? ( pointsData.intensity[i] == ( record / 3 ) % 2 )
+                                      : ( pointsData.cartesianX[i] == record ) );
+         }
+
+         total += count;
+      }
+
+      EXPECT_EQ( total, cNumPoints ) << "field " << field;
+      EXPECT_TRUE( matches ) << "field " << field;
+
+      vectorReader.seek( 12'345 );
+      ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+
+      if ( field == 0 )
+      {
+         EXPECT_EQ( pointsData.intensity[0], ( 12'345 / 3 ) % 2 );
+      }
+      else
+      {
+         EXPECT_EQ( pointsData.cartesianX[0], 12'345 );
+      }
+
+      vectorReader.close();
+   }
+}
+
+TEST( SimpleReader, Interleaved )
+{
+   constexpr int64_t cNumPoints = 5'000;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Interleaved File GUID";
+
+      e57::Writer writer( "./Interleaved.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Interleaved Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.colorRedField = true;
+      header.pointFields.colorGreenField = true;
+      header.pointFields.colorBlueField = true;
+      header.pointFields.intensityField = true;
+      header.colorLimits.colorRedMaximum = 255;
+      header.colorLimits.colorGreenMaximum = 255;
+      header.colorLimits.colorBlueMaximum = 255;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = static_cast<float>( -i );
+         pointsData.cartesianZ[i] = 0.5f;
+         pointsData.colorRed[i] = static_cast<uint16_t>( i % 256 );
+         pointsData.colorGreen[i] = static_cast<uint16_t>( ( i + 1 ) % 256 );
+         pointsData.colorBlue[i] = static_cast<uint16_t>( ( i + 2 ) % 256 );
+         pointsData.intensity[i] = static_cast<float>( i % 100 ) / 100.0f;
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   struct Record
+   {
+      float x, y, z;
+      uint8_t r, g, b;
+      float intensity;
+   };
+
+   e57::Reader reader( "./Interleaved.e57", {} );
+
+   e57::Data3DPointsInterleaved buffers;
+   constexpr int64_t cBufferSize = 999;
+   std::vector<Record> records( cBufferSize );
+
+   buffers.records = records.data();
+   buffers.stride = sizeof( Record );
+   buffers.fields = {
+      { "cartesianX", e57::Real32, offsetof( Record, x ) },
+      { "cartesianY", e57::Real32, offsetof( Record, y ) },
+      { "cartesianZ", e57::Real32, offsetof( Record, z ) },
+      { "colorRed", e57::UInt8, offsetof( Record, r ) },
+      { "colorGreen", e57::UInt8, offsetof( Record, g ) },
+      { "colorBlue", e57::UInt8, offsetof( Record, b ) },
+      { "intensity", e57::Real32, offsetof( Record, intensity ) },
+      // Not in the file, so it is skipped
+      { "normalX", e57::Real32, offsetof( Record, intensity ) },
+   };
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, buffers );
+
+   int64_t total = 0;
+   bool matches = true;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         const int64_t point = total + i;
+         const Record &record = records[i];
+
+         matches = matches && ( record.x == static_cast<float>( point ) ) &&
+                   ( record.y == static_cast<float>( -point ) ) && ( record.z == 0.5f ) &&
+                   ( record.r == point % 256 ) && ( record.g == ( point + 1 ) % 256 ) &&
+                   ( record.b == ( point + 2 ) % 256 ) &&
+                   ( record.intensity == static_cast<float>( point % 100 ) / 100.0f );
+      }
+
+      total += count;
+   }
+
+   EXPECT_EQ( total, cNumPoints );
+   EXPECT_TRUE( matches );
+
+   vectorReader.close();
+
+   // Unknown fields, fields given twice, and fields which don't fit in a record are errors
+   buffers.fields = { { "cartesianW", e57::Real32, 0 } };
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 0, cBufferSize, buffers ) );
+
+   buffers.fields = { { "cartesianX", e57::Real32, 0 }, { "cartesianX", e57::Real32, 4 } };
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 0, cBufferSize, buffers ) );
+
+   buffers.fields = { { "cartesianX", e57::Real64, sizeof( Record ) - 4 } };
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 0, cBufferSize, buffers ) );
+}
+
+TEST( SimpleReader, InterleavedHalfAndNormalized )
+{
+   constexpr int64_t cNumPoints = 4'000;
+   constexpr double cIntensityMaximum = 4'095.0;
+
+   auto normal = []( int64_t i ) { return std::cos( static_cast<double>( i ) * 0.001 ); };
+   auto intensity = []( int64_t i ) { return static_cast<double>( ( i * 7 ) % 4'096 ); };
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Interleaved Half File GUID";
+
+      e57::Writer writer( "./InterleavedHalf.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Interleaved Half Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.normalXField = true;
+      header.pointFields.normalYField = true;
+      header.pointFields.normalZField = true;
+      header.pointFields.intensityField = true;
+      header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+      header.intensityLimits.intensityMaximum = cIntensityMaximum;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = 0.0;
+         pointsData.cartesianZ[i] = 0.0;
+         pointsData.normalX[i] = static_cast<float>( normal( i ) );
+         pointsData.normalY[i] = 0.0f;
+         pointsData.normalZ[i] = -1.0f;
+         pointsData.intensity[i] = intensity( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   struct Record
+   {
+      float x;
+      uint16_t normalX, normalY, normalZ;
+      uint8_t intensity;
+   };
+
+   e57::Reader reader( "./InterleavedHalf.e57", {} );
+
+   e57::Data3DPointsInterleaved buffers;
+   constexpr int64_t cBufferSize = 1'000;
+   std::vector<Record> records( cBufferSize );
+
+   buffers.records = records.data();
+   buffers.stride = sizeof( Record );
+   buffers.fields = {
+      { "cartesianX", e57::Real32, offsetof( Record, x ) },
+      { "normalX", e57::Real16, offsetof( Record, normalX ) },
+      { "normalY", e57::Real16, offsetof( Record, normalY ) },
+      { "normalZ", e57::Real16, offsetof( Record, normalZ ) },
+      { "intensity", e57::UInt8, offsetof( Record, intensity ), true },
+   };
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, buffers );
+
+   int64_t total = 0;
+   bool matches = true;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         const int64_t point = total + i;
+         const Record &record = records[i];
+
+         // Half precision has 11 significant bits
+         const auto expectedIntensity =
+            static_cast<long>( std::lround( intensity( point ) / cIntensityMaximum * 255.0 ) );
+
+         matches = matches && ( record.x == static_cast<float>( point ) ) &&
+                   ( std::fabs( e57::halfToFloat( record.normalX ) - normal( point ) ) < 5e-4 ) &&
+                   ( record.normalY == 0 ) && ( record.normalZ == 0xbc00 ) &&
+                   ( record.intensity == expectedIntensity );
+      }
+
+      total += count;
+   }
+
+   EXPECT_EQ( total, cNumPoints );
+   EXPECT_TRUE( matches );
+
+   vectorReader.close();
+
+   // Rounding to nearest even, the largest value, overflow, and subnormals
+   EXPECT_EQ( e57::floatToHalf( 1.0f ), 0x3c00 );
+   EXPECT_EQ( e57::floatToHalf( 1.0f + 1.0f / 2'048.0f ), 0x3c00 );
+   EXPECT_EQ( e57::floatToHalf( 1.0f + 3.0f / 2'048.0f ), 0x3c02 );
+   EXPECT_EQ( e57::floatToHalf( 65'504.0f ), 0x7bff );
+   EXPECT_EQ( e57::floatToHalf( 65'520.0f ), 0x7c00 );
+   EXPECT_EQ( e57::floatToHalf( std::ldexp( 1.0f, -24 ) ), 0x0001 );
+   EXPECT_EQ( e57::halfToFloat( 0x0001 ), std::ldexp( 1.0f, -24 ) );
+   EXPECT_EQ( e57::halfToFloat( 0xc000 ), -2.0f );
+   EXPECT_TRUE( std::isinf( e57::halfToFloat( 0x7c00 ) ) );
+
+   // Only UInt8, UInt16, Real32, and Real64 fields can be normalized
+   buffers.fields = { { "normalX", e57::Int32, 0, true } };
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 0, cBufferSize, buffers ) );
+}
+
+// 12-bit color read as packed RGBA8 and float intensity read as 0..1
+TEST( SimpleReader, InterleavedNormalizedColor )
+{
+   constexpr int64_t cNumPoints = 3'000;
+   constexpr double cColorMaximum = 4'095.0;
+   constexpr double cIntensityMaximum = 1'000.0;
+
+   auto colour = []( int64_t i, int channel ) {
+      return static_cast<uint16_t>( ( i * 13 + channel * 1'000 ) % 4'096 );
+   };
+   auto intensity = []( int64_t i ) { return static_cast<double>( i % 1'001 ); };
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Normalized Color File GUID";
+
+      e57::Writer writer( "./InterleavedNormalizedColor.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Normalized Color Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.colorRedField = true;
+      header.pointFields.colorGreenField = true;
+      header.pointFields.colorBlueField = true;
+      header.pointFields.intensityField = true;
+      header.colorLimits.colorRedMaximum = cColorMaximum;
+      header.colorLimits.colorGreenMaximum = cColorMaximum;
+      header.colorLimits.colorBlueMaximum = cColorMaximum;
+      header.intensityLimits.intensityMaximum = cIntensityMaximum;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = 0.0f;
+         pointsData.cartesianZ[i] = 0.0f;
+         pointsData.colorRed[i] = colour( i, 0 );
+         pointsData.colorGreen[i] = colour( i, 1 );
+         pointsData.colorBlue[i] = colour( i, 2 );
+         pointsData.intensity[i] = static_cast<float>( intensity( i ) );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./InterleavedNormalizedColor.e57", {} );
+
+   // The alpha byte is left as it is
+   std::vector<std::array<uint8_t, 4>> rgba( cNumPoints, { { 0, 0, 0, 255 } } );
+
+   e57::Data3DPointsInterleaved colourBuffers;
+   colourBuffers.records = rgba.data();
+   colourBuffers.stride = sizeof( rgba[0] );
+   colourBuffers.fields = {
+      { "colorRed", e57::UInt8, 0, true },
+      { "colorGreen", e57::UInt8, 1, true },
+      { "colorBlue", e57::UInt8, 2, true },
+   };
+
+   auto colourReader = reader.SetUpData3DPointsData( 0, cNumPoints, colourBuffers );
+   ASSERT_EQ( colourReader.read(), static_cast<unsigned>( cNumPoints ) );
+   colourReader.close();
+
+   // A plain array of floats
+   std::vector<float> intensities( cNumPoints );
+
+   e57::Data3DPointsInterleaved intensityBuffers;
+   intensityBuffers.records = intensities.data();
+   intensityBuffers.stride = sizeof( float );
+   intensityBuffers.fields = { { "intensity", e57::Real32, 0, true } };
+
+   auto intensityReader = reader.SetUpData3DPointsData( 0, cNumPoints, intensityBuffers );
+   ASSERT_EQ( intensityReader.read(), static_cast<unsigned>( cNumPoints ) );
+   intensityReader.close();
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      for ( int channel = 0; channel < 3; ++channel )
+      {
+         ASSERT_EQ( rgba[i][channel],
+                    std::lround( colour( i, channel ) / cColorMaximum * 255.0 ) );
+      }
+
+      ASSERT_EQ( rgba[i][3], 255 );
+      ASSERT_NEAR( intensities[i], intensity( i ) / cIntensityMaximum, 1e-6 );
+   }
+}
+
+namespace
+{
+   struct RecordSchemaPoint
+   {
+      double x;
+      double y;
+      double z;
+      uint16_t intensity;
+      uint8_t red;
+      uint8_t green;
+      uint8_t blue;
+
+      static constexpr auto e57Fields()
+      {
+         return std::make_tuple( e57::recordField( "cartesianX", &RecordSchemaPoint::x ),
+                                 e57::recordField( "cartesianY", &RecordSchemaPoint::y ),
+                                 e57::recordField( "cartesianZ", &RecordSchemaPoint::z ),
+                                 e57::halfRecordField( "intensity", &RecordSchemaPoint::intensity ),
+                                 e57::recordField( "colorRed", &RecordSchemaPoint::red, true ),
+                                 e57::recordField( "colorGreen", &RecordSchemaPoint::green, true ),
+                                 e57::recordField( "colorBlue", &RecordSchemaPoint::blue, true ) );
+      }
+   };
+}
+
+TEST( SimpleReader, RecordSchema )
+{
+   constexpr int64_t cNumPoints = 2'000;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Record Schema File GUID";
+
+      e57::Writer writer( "./RecordSchema.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Record Schema Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.colorRedField = true;
+      header.pointFields.colorGreenField = true;
+      header.pointFields.colorBlueField = true;
+      header.pointFields.intensityField = true;
+      header.colorLimits.colorRedMaximum = 255.0;
+      header.colorLimits.colorGreenMaximum = 255.0;
+      header.colorLimits.colorBlueMaximum = 255.0;
+      header.intensityLimits.intensityMaximum = 100.0;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i ) * 0.5;
+         pointsData.cartesianY[i] = -static_cast<double>( i );
+         pointsData.cartesianZ[i] = 3.0;
+         pointsData.colorRed[i] = static_cast<uint16_t>( i % 256 );
+         pointsData.colorGreen[i] = 0;
+         pointsData.colorBlue[i] = 255;
+         pointsData.intensity[i] = static_cast<double>( i % 100 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./RecordSchema.e57", {} );
+
+   std::vector<RecordSchemaPoint> points( cNumPoints );
+
+   const e57::Data3DPointsInterleaved buffers = e57::makeData3DPointsInterleaved( points.data() );
+
+   ASSERT_EQ( buffers.stride, sizeof( RecordSchemaPoint ) );
+   ASSERT_EQ( buffers.fields.size(), 7u );
+   ASSERT_EQ( buffers.fields[1].offset, offsetof( RecordSchemaPoint, y ) );
+   ASSERT_EQ( buffers.fields[3].memoryRepresentation, e57::Real16 );
+   ASSERT_EQ( buffers.fields[6].memoryRepresentation, e57::UInt8 );
+
+   auto vectorReader = reader.SetUpData3DRecords( 0, cNumPoints, points.data() );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   vectorReader.close();
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( points[i].x, static_cast<double>( i ) * 0.5 );
+      ASSERT_EQ( points[i].y, -static_cast<double>( i ) );
+      ASSERT_EQ( points[i].z, 3.0 );
+      ASSERT_EQ( e57::halfToFloat( points[i].intensity ), static_cast<float>( i % 100 ) );
+      ASSERT_EQ( points[i].red, i % 256 );
+      ASSERT_EQ( points[i].green, 0 );
+      ASSERT_EQ( points[i].blue, 255 );
+   }
+}
+
+TEST( SimpleReader, SphericalToCartesian )
+{
+   constexpr int64_t cNumPoints = 3'000;
+
+   auto range = []( int64_t i ) { return 1.0 + static_cast<double>( i % 50 ); };
+   auto azimuth = []( int64_t i ) { return static_cast<double>( i ) * 0.002 - 3.0; };
+   auto elevation = []( int64_t i ) { return static_cast<double>( i % 300 ) * 0.01 - 1.5; };
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Spherical File GUID";
+
+      e57::Writer writer( "./SphericalToCartesian.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Spherical Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.sphericalRangeField = true;
+      header.pointFields.sphericalAzimuthField = true;
+      header.pointFields.sphericalElevationField = true;
+      header.pointFields.sphericalInvalidStateField = true;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.sphericalRange[i] = range( i );
+         pointsData.sphericalAzimuth[i] = azimuth( i );
+         pointsData.sphericalElevation[i] = elevation( i );
+         pointsData.sphericalInvalidState[i] = static_cast<int8_t>( i % 3 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::ReaderOptions options;
+   options.sphericalToCartesian = true;
+
+   e57::Reader reader( "./SphericalToCartesian.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   EXPECT_TRUE( header.pointFields.cartesianXField );
+   EXPECT_TRUE( header.pointFields.cartesianYField );
+   EXPECT_TRUE( header.pointFields.cartesianZField );
+   EXPECT_TRUE( header.pointFields.cartesianInvalidStateField );
+
+   // Don't read the spherical coordinates into buffers of our own
+   header.pointFields.sphericalRangeField = false;
+   header.pointFields.sphericalAzimuthField = false;
+   header.pointFields.sphericalElevationField = false;
+   header.pointFields.sphericalInvalidStateField = false;
+
+   constexpr int64_t cBufferSize = 1'000;
+   header.pointCount = cBufferSize;
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   int64_t total = 0;
+   double maxError = 0.0;
+   bool statesMatch = true;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         const int64_t point = total + i;
+         const double cProjected = range( point ) * std::cos( elevation( point ) );
+         const double cX = cProjected * std::cos( azimuth( point ) );
+         const double cY = cProjected * std::sin( azimuth( point ) );
+         const double cZ = range( point ) * std::sin( elevation( point ) );
+
+         maxError = std::max( { maxError, std::abs( pointsData.cartesianX[i] - cX ),
+                                std::abs( pointsData.cartesianY[i] - cY ),
+                                std::abs( pointsData.cartesianZ[i] - cZ ) } );
+
+         statesMatch = statesMatch && ( pointsData.cartesianInvalidState[i] == point % 3 );
+      }
+
+      total += count;
+   }
+
+   EXPECT_EQ( total, cNumPoints );
+   EXPECT_LT( maxError, 1e-9 );
+   EXPECT_TRUE( statesMatch );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, ApplyPose )
+{
+   constexpr int64_t cNumPoints = 2'000;
+
+   // A quarter turn about Z, then a translation
+   e57::RigidBodyTransform pose;
+   pose.rotation.w = std::sqrt( 0.5 );
+   pose.rotation.z = std::sqrt( 0.5 );
+   pose.translation.x = 100.0;
+   pose.translation.y = -20.0;
+   pose.translation.z = 3.0;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "ApplyPose File GUID";
+
+      e57::Writer writer( "./ApplyPose.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "ApplyPose Header GUID";
+      header.pose = pose;
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = static_cast<double>( i % 7 );
+         pointsData.cartesianZ[i] = -static_cast<double>( i % 11 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::ReaderOptions options;
+   options.applyPose = true;
+
+   e57::Reader reader( "./ApplyPose.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   EXPECT_EQ( header.pose, e57::RigidBodyTransform::identity() );
+
+   constexpr int64_t cBufferSize = 600;
+   header.pointCount = cBufferSize;
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   int64_t total = 0;
+   double maxError = 0.0;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         const int64_t point = total + i;
+
+         // ( x, y, z ) rotated to ( -y, x, z ), then translated
+         const double cX = -static_cast<double>( point % 7 ) + 100.0;
+         const double cY = static_cast<double>( point ) - 20.0;
+         const double cZ = -static_cast<double>( point % 11 ) + 3.0;
+
+         maxError = std::max( { maxError, std::abs( pointsData.cartesianX[i] - cX ),
+                                std::abs( pointsData.cartesianY[i] - cY ),
+                                std::abs( pointsData.cartesianZ[i] - cZ ) } );
+      }
+
+      total += count;
+   }
+
+   EXPECT_EQ( total, cNumPoints );
+   EXPECT_LT( maxError, 1e-9 );
+
+   vectorReader.close();
+
+   // Rotating needs all three coordinates
+   header.pointFields.cartesianZField = false;
+
+   e57::Data3DPointsDouble partialData( header );
+
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 0, cBufferSize, partialData ) );
+}
+
+TEST( SimpleReader, RecordFilters )
+{
+   constexpr int64_t cNumPoints = 10'000;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Record Filters File GUID";
+
+      e57::Writer writer( "./RecordFilters.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Record Filters Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.cartesianInvalidStateField = true;
+      header.pointFields.intensityField = true;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = 0.0;
+         pointsData.cartesianZ[i] = 0.0;
+         pointsData.cartesianInvalidState[i] = ( i % 5 == 0 ) ? 2 : 0;
+         pointsData.intensity[i] = static_cast<float>( i % 100 );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   auto keep = []( int64_t i ) { return ( i % 5 != 0 ) && ( i % 100 >= 10 ) && ( i % 100 <= 89 ); };
+
+   e57::Reader reader( "./RecordFilters.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   constexpr int64_t cBufferSize = 128;
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   vectorReader.setRecordFilters( { { "cartesianInvalidState", 0.0, 0.0 },
+                                    { "intensity", 10.0, 89.0 } } );
+
+   // Each read fills the buffers with the records which are kept
+   std::vector<int64_t> expected;
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      if ( keep( i ) )
+      {
+         expected.push_back( i );
+      }
+   }
+
+   size_t total = 0;
+   bool matches = true;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      EXPECT_TRUE( ( count == cBufferSize ) || ( total + count == expected.size() ) );
+
+      for ( unsigned i = 0; i < count && total + i < expected.size(); ++i )
+      {
+         const int64_t record = expected[total + i];
+
+         matches = matches && ( pointsData.cartesianX[i] == record ) &&
+                   ( pointsData.cartesianInvalidState[i] == 0 ) &&
+                   ( pointsData.intensity[i] == static_cast<float>( record % 100 ) );
+      }
+
+      total += count;
+   }
+
+   EXPECT_EQ( total, expected.size() );
+   EXPECT_TRUE( matches );
+
+   // Seeking counts every record
+   vectorReader.seek( 1'000 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.cartesianX[0], 1'011 );
+
+   // No filters returns everything again
+   vectorReader.setRecordFilters( {} );
+   vectorReader.seek( 1'000 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.cartesianX[0], 1'000 );
+
+   E57_ASSERT_THROW( vectorReader.setRecordFilters( { { "sphericalRange", 0.0, 1.0 } } ) );
+   E57_ASSERT_THROW( vectorReader.setRecordFilters( { { "intensity", 1.0, 0.0 } } ) );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, RecordStride )
+{
+   constexpr int64_t cNumPoints = 10'000;
+   constexpr int64_t cColumns = 100;
+
+   {
+      e57::WriterOptions writerOptions;
+      writerOptions.guid = "Record Stride File GUID";
+      writerOptions.deltaCodecFields = { "columnIndex" };
+      writerOptions.runLengthCodecFields = { "rowIndex" };
+
+      e57::Writer writer( "./RecordStride.e57", writerOptions );
+
+      e57::Data3D header;
+      header.guid = "Record Stride Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.cartesianInvalidStateField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.001;
+      header.pointFields.intensityField = true;
+      header.pointFields.intensityNodeType = e57::NumericalNodeType::Float;
+      header.pointFields.rowIndexField = true;
+      header.pointFields.rowIndexMaximum = cNumPoints / cColumns - 1;
+      header.pointFields.columnIndexField = true;
+      header.pointFields.columnIndexMaximum = cColumns - 1;
+      header.intensityLimits.intensityMaximum = 1.0;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i ) * 0.001f;
+         pointsData.cartesianY[i] = static_cast<float>( i % 7 );
+         pointsData.cartesianZ[i] = 0.0f;
+         pointsData.cartesianInvalidState[i] = 0;
+         pointsData.intensity[i] = static_cast<float>( i % 100 ) / 100.0f;
+         pointsData.rowIndex[i] = static_cast<int32_t>( i / cColumns );
+         pointsData.columnIndex[i] = static_cast<int32_t>( i % cColumns );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./RecordStride.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsFloat all( header );
+   reader.ReadData3DPointsData( { 0 }, { &all }, 1 );
+
+   constexpr int64_t cBufferSize = 128;
+   constexpr unsigned cStride = 7;
+   constexpr int64_t cFirstRecord = 1'003;
+
+   e57::Data3D bufferHeader = header;
+   bufferHeader.pointCount = cBufferSize;
+
+   e57::Data3DPointsFloat pointsData( bufferHeader );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   vectorReader.seek( cFirstRecord );
+   vectorReader.setRecordStride( cStride );
+
+   int64_t record = cFirstRecord;
+   bool matches = true;
+
+   while ( unsigned count = vectorReader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i, record += cStride )
+      {
+         matches = matches && ( pointsData.cartesianX[i] == all.cartesianX[record] ) &&
+                   ( pointsData.cartesianY[i] == all.cartesianY[record] ) &&
+                   ( pointsData.cartesianInvalidState[i] == 0 ) &&
+                   ( pointsData.intensity[i] == all.intensity[record] ) &&
+                   ( pointsData.rowIndex[i] == all.rowIndex[record] ) &&
+                   ( pointsData.columnIndex[i] == all.columnIndex[record] );
+      }
+   }
+
+   EXPECT_TRUE( matches );
+   EXPECT_GE( record, cNumPoints );
+   EXPECT_LT( record, cNumPoints + cStride );
+
+   // Seeking starts the stride over from the record sought to
+   vectorReader.seek( 10 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.columnIndex[0], 10 );
+   EXPECT_EQ( pointsData.columnIndex[1], 17 );
+   EXPECT_EQ( pointsData.rowIndex[cBufferSize - 1],
+              ( 10 + ( cBufferSize - 1 ) * cStride ) / cColumns );
+
+   // A stride of 1 returns every record again, from the one after the last returned
+   constexpr int64_t cNextRecord = 10 + ( cBufferSize - 1 ) * cStride + 1;
+
+   vectorReader.setRecordStride( 1 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.cartesianX[0], all.cartesianX[cNextRecord] );
+   EXPECT_EQ( pointsData.cartesianX[1], all.cartesianX[cNextRecord + 1] );
+
+   E57_ASSERT_THROW( vectorReader.setRecordStride( 0 ) );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, ReadWindow )
+{
+   constexpr int64_t cRows = 60;
+   constexpr int64_t cColumns = 90;
+   constexpr int64_t cNumPoints = cRows * cColumns;
+
+   {
+      e57::Writer writer( "./ReadWindow.e57", e57::WriterOptions() );
+
+      e57::Data3D header;
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.rowIndexField = true;
+      header.pointFields.rowIndexMaximum = cRows - 1;
+      header.pointFields.columnIndexField = true;
+      header.pointFields.columnIndexMaximum = cColumns - 1;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = 0.0;
+         pointsData.cartesianZ[i] = 0.0;
+         pointsData.rowIndex[i] = static_cast<int32_t>( i / cColumns );
+         pointsData.columnIndex[i] = static_cast<int32_t>( i % cColumns );
+      }
+
+      // The first scan is grouped by row, the second isn't grouped
+      header.guid = "Read Window Grouped GUID";
+      header.pointGroupingSchemes.groupingByLine.idElementName = "rowIndex";
+      header.pointGroupingSchemes.groupingByLine.groupsSize = cRows;
+      header.pointGroupingSchemes.groupingByLine.pointCountSize = cColumns;
+
+      const int64_t dataIndex = writer.WriteData3DData( header, pointsData );
+
+      std::vector<int64_t> idElementValues( cRows );
+      std::vector<int64_t> startPointIndices( cRows );
+      std::vector<int64_t> pointCounts( cRows, cColumns );
+
+      for ( int64_t row = 0; row < cRows; ++row )
+      {
+         idElementValues[row] = row;
+         startPointIndices[row] = row * cColumns;
+      }
+
+      ASSERT_TRUE( writer.WriteData3DGroupsData( dataIndex, cRows, idElementValues.data(),
+                                                 startPointIndices.data(), pointCounts.data() ) );
+
+      header.guid = "Read Window Not Grouped GUID";
+      header.pointGroupingSchemes.groupingByLine.idElementName.clear();
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   e57::Reader reader( "./ReadWindow.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   e57::IndexBounds window;
+   window.rowMinimum = 20;
+   window.rowMaximum = 29;
+   window.columnMinimum = 40;
+   window.columnMaximum = 54;
+
+   constexpr int64_t cWindowPoints = 10 * 15;
+
+   for ( int64_t dataIndex = 0; dataIndex < 2; ++dataIndex )
+   {
+      ASSERT_EQ( reader.ReadData3DWindow( dataIndex, window, cNumPoints, pointsData ),
+                 cWindowPoints );
+
+      bool matches = true;
+
+      for ( int64_t i = 0; i < cWindowPoints; ++i )
+      {
+         const int64_t row = 20 + i / 15;
+         const int64_t column = 40 + i % 15;
+
+         matches = matches && ( pointsData.rowIndex[i] == row ) &&
+                   ( pointsData.columnIndex[i] == column ) &&
+                   ( pointsData.cartesianX[i] == static_cast<double>( row * cColumns + column ) );
+      }
+
+      EXPECT_TRUE( matches );
+   }
+
+   // Reading stops once the buffers are full, even if there is less room than in a line
+   EXPECT_EQ( reader.ReadData3DWindow( 0, window, 40, pointsData ), 40 );
+   EXPECT_EQ( pointsData.rowIndex[39], 22 );
+   EXPECT_EQ( pointsData.columnIndex[39], 49 );
+
+   EXPECT_EQ( reader.ReadData3DWindow( 0, window, 20, pointsData ), 20 );
+   EXPECT_EQ( pointsData.columnIndex[19], 44 );
+
+   // Windows outside the grid are empty
+   window.rowMinimum = cRows;
+   window.rowMaximum = cRows + 10;
+   EXPECT_EQ( reader.ReadData3DWindow( 0, window, cNumPoints, pointsData ), 0 );
+
+   e57::Data3DPointsDouble noIndices;
+   noIndices.cartesianX = pointsData.cartesianX;
+
+   E57_ASSERT_THROW( reader.ReadData3DWindow( 0, window, cNumPoints, noIndices ) );
+   E57_ASSERT_THROW( reader.ReadData3DWindow( 2, window, cNumPoints, pointsData ) );
+   E57_ASSERT_THROW( reader.ReadData3DWindow( 0, window, -1, pointsData ) );
+}
+
+TEST( SimpleReader, RecordIndex )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   WriteSeekFile( "./RecordIndex.e57", cNumPoints );
+   WriteSeekFile( "./RecordIndexOther.e57", 1000 );
+
+   {
+      e57::Reader reader( "./RecordIndex.e57", {} );
+
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      // There is nothing to write until the index is built
+      E57_ASSERT_THROW( vectorReader.writeRecordIndex( "./RecordIndex.e57idx" ) );
+
+      vectorReader.buildRecordIndex();
+
+      CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+      vectorReader.writeRecordIndex( "./RecordIndex.e57idx" );
+
+      vectorReader.close();
+   }
+
+   {
+      e57::Reader reader( "./RecordIndex.e57", {} );
+
+      e57::Data3D header;
+      ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+      // An E57 file isn't an index file
+      E57_ASSERT_THROW( vectorReader.readRecordIndex( "./RecordIndexOther.e57" ) );
+
+      vectorReader.readRecordIndex( "./RecordIndex.e57idx" );
+
+      CheckSeeks( vectorReader, pointsData, cNumPoints );
+
+      vectorReader.close();
+   }
+
+   // The index only fits the file it was built for
+   e57::Reader reader( "./RecordIndexOther.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cSeekBufferSize, pointsData );
+
+   E57_ASSERT_THROW( vectorReader.readRecordIndex( "./RecordIndex.e57idx" ) );
+
+   vectorReader.close();
+}
+
+TEST( SimpleReader, RecordIndexDamaged )
+{
+   constexpr uint64_t cFileLength = 1'000'000;
+   constexpr uint64_t cSectionStart = 4'096;
+
+   // Write an index file as RecordIndex::write() does, with one bytestream
+   auto writeIndex = []( const e57::ustring &fileName,
+                         const std::vector<uint64_t> &packetOffsets,
+                         const std::vector<uint64_t> &bytestreamOffsets, uint64_t length ) {
+      struct
+      {
+         char signature[8] = { 'E', '5', '7', 'R', 'I', 'D', 'X', '\0' };
+         uint32_t version = 1;
+         uint32_t bytestreamCount = 1;
+         uint64_t fileLength = cFileLength;
+         uint64_t sectionLogicalStart = cSectionStart;
+         uint64_t recordCount = 100;
+         uint64_t packetCount = 0;
+      } header;
+
+      header.packetCount = packetOffsets.size();
+
+      e57::CheckedFile file( fileName, e57::CheckedFile::Write, e57::ChecksumAll );
+      file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+      file.write( reinterpret_cast<const char *>( &length ), sizeof( length ) );
+      file.write( reinterpret_cast<const char *>( packetOffsets.data() ),
+                  packetOffsets.size() * sizeof( uint64_t ) );
+      file.write( reinterpret_cast<const char *>( bytestreamOffsets.data() ),
+                  bytestreamOffsets.size() * sizeof( uint64_t ) );
+      file.close();
+   };
+
+   writeIndex( "./RecordIndexDamaged.e57idx", { 5'000, 70'000 }, { 0, 40 }, 80 );
+
+   std::unique_ptr<e57::RecordIndex> index =
+      e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" );
+
+   uint64_t packetOffset = 0;
+   size_t bufferIndex = 0;
+   size_t bufferLength = 0;
+
+   ASSERT_TRUE( index->find( 0, 50, packetOffset, bufferIndex, bufferLength ) );
+   EXPECT_EQ( packetOffset, 70'000u );
+   EXPECT_EQ( bufferIndex, 10u );
+   EXPECT_EQ( bufferLength, 40u );
+
+   // The first packet of a bytestream must start it
+   writeIndex( "./RecordIndexDamaged.e57idx", { 5'000, 70'000 }, { 10, 40 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+
+   // Its offsets must not decrease, or go past its length
+   writeIndex( "./RecordIndexDamaged.e57idx", { 5'000, 70'000 }, { 0, 90 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+
+   writeIndex( "./RecordIndexDamaged.e57idx", { 5'000, 70'000, 80'000 }, { 0, 40, 30 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+
+   // The packets must be in order, in the section
+   writeIndex( "./RecordIndexDamaged.e57idx", { 70'000, 5'000 }, { 0, 40 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+
+   writeIndex( "./RecordIndexDamaged.e57idx", { 1'000, 70'000 }, { 0, 40 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+
+   writeIndex( "./RecordIndexDamaged.e57idx", { 5'000, cFileLength }, { 0, 40 }, 80 );
+   E57_ASSERT_THROW( e57::RecordIndex::read( "./RecordIndexDamaged.e57idx" ) );
+}
+
+TEST( SimpleReader, LazyLoad )
+{
+   constexpr int cNumScans = 3;
+   constexpr int64_t cNumPoints = 100;
+
+   {
+      e57::WriterOptions options;
+      options.guid = "Lazy Load File GUID";
+
+      e57::Writer writer( "./LazyLoad.e57", options );
+
+      for ( int scan = 0; scan < cNumScans; ++scan )
+      {
+         e57::Data3D header;
+         header.guid = "Lazy Load Header GUID " + std::to_string( scan );
+         header.name = "Scan " + std::to_string( scan );
+         header.pointCount = cNumPoints;
+         header.pose.translation.x = scan;
+         header.pointFields.cartesianXField = true;
+         header.pointFields.cartesianYField = true;
+         header.pointFields.cartesianZField = true;
+
+         e57::Data3DPointsDouble pointsData( header );
+
+         for ( int64_t i = 0; i < cNumPoints; ++i )
+         {
+            pointsData.cartesianX[i] = static_cast<double>( scan * 1000 + i );
+            pointsData.cartesianY[i] = 0.0;
+            pointsData.cartesianZ[i] = 0.0;
+         }
+
+         writer.WriteData3DData( header, pointsData );
+      }
+   }
+
+   // Each scan is parsed when it is first read, in any order and from any thread
+   e57::ReaderOptions options;
+   options.lazyLoad = true;
+
+   e57::Reader reader( "./LazyLoad.e57", options );
+
+   ASSERT_EQ( reader.GetData3DCount(), cNumScans );
+
+   std::vector<std::thread> threads;
+   std::vector<int> failures( cNumScans, -1 );
+
+   for ( int scan = cNumScans - 1; scan >= 0; --scan )
+   {
+      threads.emplace_back( [&, scan] {
+         try
+         {
+            e57::Data3D header;
+            reader.ReadData3D( scan, header );
+
+            failures[scan] = ( header.name == "Scan " + std::to_string( scan ) ) &&
+                                   ( header.pose.translation.x == scan ) &&
+                                   ( header.pointCount == cNumPoints )
+                                ? 0
+                                : 1;
+
+            e57::Data3DPointsDouble pointsData( header );
+
+            auto vectorReader = reader.SetUpData3DPointsData( scan, cNumPoints, pointsData );
+
+            if ( ( vectorReader.read() != cNumPoints ) ||
+                 ( pointsData.cartesianX[cNumPoints - 1] != scan * 1000 + cNumPoints - 1 ) )
+            {
+               ++failures[scan];
+            }
+
+            vectorReader.close();
+         }
+         catch ( ... )
+         {
+            failures[scan] = -2;
+         }
+      } );
+   }
+
+   for ( auto &thread : threads )
+   {
+      thread.join();
+   }
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      EXPECT_EQ( failures[scan], 0 ) << "scan " << scan;
+   }
+
+   // Paths into deferred children work too
+   e57::ImageFile imf( "./LazyLoad.e57", "r", e57::ChecksumAll, true );
+
+   EXPECT_EQ( e57::VectorNode( imf.root().get( "/data3D" ) ).childCount(), cNumScans );
+   EXPECT_EQ( e57::StringNode( imf.root().get( "/data3D/1/name" ) ).value(), "Scan 1" );
+   EXPECT_FALSE( imf.root().isDefined( "/data3D/3" ) );
+
+   imf.close();
+}
+
+TEST( SimpleReader, NodesOutliveClose )
+{
+   {
+      e57::WriterOptions options;
+      options.guid = "Nodes Outlive Close File GUID";
+
+      e57::Writer writer( "./NodesOutliveClose.e57", options );
+   }
+
+   e57::ImageFile imf( "./NodesOutliveClose.e57", "r" );
+
+   // Closing a file being read releases its tree, but nodes the caller holds stay valid
+   std::unique_ptr<e57::StringNode> guid( new e57::StringNode( imf.root().get( "/guid" ) ) );
+   EXPECT_EQ( guid->value(), "Nodes Outlive Close File GUID" );
+
+   imf.close();
+
+   E57_ASSERT_THROW( guid->value() );
+   E57_ASSERT_THROW( imf.root() );
+
+   guid.reset();
+}
+
+TEST( SimpleReader, MetadataReader )
+{
+   constexpr int cNumScans = 4;
+   constexpr int64_t cNumPoints = 10;
+
+   {
+      e57::WriterOptions options;
+      options.guid = "Metadata Reader File GUID";
+
+      e57::Writer writer( "./MetadataReader.e57", options );
+
+      for ( int scan = 0; scan < cNumScans; ++scan )
+      {
+         e57::Data3D header;
+         header.guid = "Metadata Reader Header GUID " + std::to_string( scan );
+         header.name = "Scan " + std::to_string( scan );
+         header.pointCount = cNumPoints;
+         header.pose.translation.y = scan;
+         header.cartesianBounds.xMaximum = scan + 0.5;
+         header.pointFields.cartesianXField = true;
+         header.pointFields.cartesianYField = true;
+         header.pointFields.cartesianZField = true;
+
+         e57::Data3DPointsFloat pointsData( header );
+
+         writer.WriteData3DData( header, pointsData );
+      }
+
+      uint8_t imageBuffer[16] = {};
+
+      e57::Image2D imageHeader;
+      imageHeader.name = "Image";
+      imageHeader.guid = "Metadata Reader Image GUID";
+      imageHeader.associatedData3DGuid = "Metadata Reader Header GUID 1";
+      imageHeader.visualReferenceRepresentation.imageWidth = 4;
+      imageHeader.visualReferenceRepresentation.imageHeight = 2;
+      imageHeader.visualReferenceRepresentation.jpegImageSize = sizeof( imageBuffer );
+
+      writer.WriteImage2DData( imageHeader, e57::ImageJPEG, e57::ProjectionVisual, 0, imageBuffer,
+                               sizeof( imageBuffer ) );
+   }
+
+   e57::Reader reader( "./MetadataReader.e57", {} );
+   e57::MetadataReader metadataReader( "./MetadataReader.e57" );
+
+   ASSERT_TRUE( metadataReader.IsOpen() );
+
+   e57::E57Root fileHeader;
+   ASSERT_TRUE( metadataReader.GetE57Root( fileHeader ) );
+
+   CheckFileHeader( fileHeader );
+   EXPECT_EQ( fileHeader.guid, "Metadata Reader File GUID" );
+   EXPECT_EQ( fileHeader.data3DSize, cNumScans );
+   EXPECT_EQ( fileHeader.images2DSize, 1 );
+
+   ASSERT_EQ( metadataReader.GetData3DCount(), cNumScans );
+
+   // Each block is released once its header has been read, so reading it again parses it again
+   for ( int pass = 0; pass < 2; ++pass )
+   {
+      for ( int scan = 0; scan < cNumScans; ++scan )
+      {
+         e57::Data3D expected;
+         ASSERT_TRUE( reader.ReadData3D( scan, expected ) );
+
+         e57::Data3D header;
+         ASSERT_TRUE( metadataReader.ReadData3D( scan, header ) );
+
+         EXPECT_EQ( header.guid, expected.guid );
+         EXPECT_EQ( header.name, "Scan " + std::to_string( scan ) );
+         EXPECT_EQ( header.pointCount, cNumPoints );
+         EXPECT_EQ( header.pose.translation.y, scan );
+         EXPECT_EQ( header.cartesianBounds.xMaximum, expected.cartesianBounds.xMaximum );
+         EXPECT_EQ( header.pointFields.cartesianXField, expected.pointFields.cartesianXField );
+         EXPECT_EQ( header.pointFields.sphericalRangeField,
+                    expected.pointFields.sphericalRangeField );
+      }
+   }
+
+   e57::Data3D header;
+   EXPECT_FALSE( metadataReader.ReadData3D( cNumScans, header ) );
+
+   ASSERT_EQ( metadataReader.GetImage2DCount(), 1 );
+
+   e57::Image2D imageHeader;
+   ASSERT_TRUE( metadataReader.ReadImage2D( 0, imageHeader ) );
+
+   EXPECT_EQ( imageHeader.name, "Image" );
+   EXPECT_EQ( imageHeader.associatedData3DGuid, "Metadata Reader Header GUID 1" );
+   EXPECT_EQ( imageHeader.visualReferenceRepresentation.imageWidth, 4 );
+   EXPECT_EQ( imageHeader.visualReferenceRepresentation.jpegImageSize, 16 );
+
+   EXPECT_TRUE( metadataReader.Close() );
+   EXPECT_FALSE( metadataReader.IsOpen() );
+
+   // The image's blob has a binary section too
+   EXPECT_EQ( reader.GetRawIMF().verify().sectionCount, cNumScans + 1 );
+}
+
+TEST( SimpleReader, Image2DBlobs )
+{
+   constexpr int cNumImages = 3;
+
+   // Each blob spans several pages, so its view has several segments
+   std::vector<std::vector<uint8_t>> images( cNumImages );
+
+   {
+      e57::Writer writer( "./Image2DBlobs.e57", e57::WriterOptions() );
+
+      for ( int i = 0; i < cNumImages; ++i )
+      {
+         images[i].resize( 5000 + i * 777 );
+
+         for ( size_t j = 0; j < images[i].size(); ++j )
+         {
+            images[i][j] = static_cast<uint8_t>( j * 7 + i );
+         }
+
+         e57::Image2D imageHeader;
+         imageHeader.name = "Image " + std::to_string( i );
+         imageHeader.visualReferenceRepresentation.imageWidth = 4;
+         imageHeader.visualReferenceRepresentation.imageHeight = 2;
+         imageHeader.visualReferenceRepresentation.jpegImageSize =
+            static_cast<int64_t>( images[i].size() );
+
+         writer.WriteImage2DData( imageHeader, e57::ImageJPEG, e57::ProjectionVisual, 0,
+                                  images[i].data(), static_cast<int64_t>( images[i].size() ) );
+      }
+   }
+
+   e57::Reader reader( "./Image2DBlobs.e57", {} );
+
+   std::vector<e57::BlobView> views;
+
+   for ( int i = 0; i < cNumImages; ++i )
+   {
+      const e57::BlobView view = reader.GetImage2DView( i, e57::ProjectionVisual, e57::ImageJPEG );
+
+      ASSERT_EQ( view.size(), images[i].size() );
+      EXPECT_TRUE( view.isInPlace() );
+      EXPECT_GT( view.segmentCount(), 1U );
+
+      std::vector<uint8_t> data;
+
+      for ( size_t segment = 0; segment < view.segmentCount(); ++segment )
+      {
+         const e57::BlobSegment piece = view.segment( segment );
+         data.insert( data.end(), piece.data, piece.data + piece.size );
+      }
+
+      EXPECT_EQ( data, images[i] );
+
+      views.push_back( view );
+   }
+
+   EXPECT_EQ( reader.GetImage2DView( 0, e57::ProjectionPinhole, e57::ImageJPEG ).size(), 0U );
+   EXPECT_EQ( reader.GetImage2DView( 0, e57::ProjectionVisual, e57::ImagePNG ).segmentCount(), 0U );
+
+   // Read parts of the blobs, and one which doesn't exist
+   std::vector<std::vector<uint8_t>> buffers( cNumImages + 1, std::vector<uint8_t>( 4000 ) );
+   std::vector<e57::Image2DRead> reads( cNumImages + 1 );
+
+   for ( int i = 0; i <= cNumImages; ++i )
+   {
+      reads[i].imageIndex = i % cNumImages;
+      reads[i].imageProjection = e57::ProjectionVisual;
+      reads[i].imageType = ( i < cNumImages ) ? e57::ImageJPEG : e57::ImagePNG;
+      reads[i].buffer = buffers[i].data();
+      reads[i].start = 100 * i;
+      reads[i].count = static_cast<int64_t>( buffers[i].size() );
+   }
+
+   ASSERT_TRUE( reader.ReadImage2DDataParallel( reads, 3 ) );
+
+   for ( int i = 0; i < cNumImages; ++i )
+   {
+      EXPECT_EQ( reads[i].transferred, reads[i].count );
+      EXPECT_TRUE( std::equal( buffers[i].begin(), buffers[i].end(),
+                               images[i].begin() + reads[i].start ) );
+   }
+
+   EXPECT_EQ( reads[cNumImages].transferred, 0 );
+
+   // The views can't be used once the file is closed
+   reader.Close();
+
+   E57_ASSERT_THROW( views[0].segment( 0 ) );
+}
+
+TEST( SimpleReader, Verify )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   WriteSeekFile( "./Verify.e57", cNumPoints );
+
+   const auto fileSize = static_cast<uint64_t>( Helpers::FileSize( "./Verify.e57" ) );
+
+   e57::ImageFileVerification verification;
+
+   {
+      e57::ImageFile imf( "./Verify.e57", "r" );
+
+      verification = imf.verify();
+
+      EXPECT_EQ( verification.pageCount, fileSize / 1024 );
+      EXPECT_EQ( verification.sectionCount, 1 );
+      EXPECT_GT( verification.packetCount, 1 );
+
+      // Using more threads checks the same things
+      const e57::ImageFileVerification parallel = imf.verify( 4 );
+
+      EXPECT_EQ( parallel.pageCount, verification.pageCount );
+      EXPECT_EQ( parallel.sectionCount, verification.sectionCount );
+      EXPECT_EQ( parallel.packetCount, verification.packetCount );
+   }
+
+   // Damage a byte in the middle of the points
+   {
+      std::fstream file( "./Verify.e57", std::ios::in | std::ios::out | std::ios::binary );
+
+      file.seekp( static_cast<std::streamoff>( fileSize / 2 ) );
+      file.put( '\x5a' );
+   }
+
+   // Every page is verified, whatever the file was opened with
+   e57::ImageFile imf( "./Verify.e57", "r", e57::ChecksumNone );
+
+   try
+   {
+      imf.verify( 0 );
+      FAIL() << "verify() didn't find the damaged page";
+   }
+   catch ( const e57::E57Exception &e )
+   {
+      EXPECT_EQ( e.errorCode(), e57::ErrorBadChecksum );
+   }
+}
+
 TEST( SimpleReaderData, Empty )
 {
    e57::Reader *reader = nullptr;
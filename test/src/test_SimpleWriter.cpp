@@ -1,11 +1,18 @@
 // libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <thread>
 
 #include "gtest/gtest.h"
 
+#include "E57SimpleReader.h"
 #include "E57SimpleWriter.h"
 
 #include "Helpers.h"
@@ -637,6 +644,2884 @@ TEST( SimpleWriter, MinMaxIssuesSphericalDouble )
    EXPECT_NE( header.intensityLimits.intensityMaximum, 0.0 );
 }
 
+TEST( SimpleWriter, ComputeBounds )
+{
+   constexpr int64_t cBufferSize = 500;
+
+   {
+      e57::WriterOptions options;
+      options.guid = "ComputeBounds File GUID";
+      options.computeBounds = true;
+
+      e57::Writer writer( "./ComputeBounds.e57", options );
+
+      // Points are written in two batches, and the invalid ones are outside the bounds
+      e57::Data3D cartesianHeader;
+      cartesianHeader.guid = "ComputeBounds Cartesian Header GUID";
+      cartesianHeader.pointFields.cartesianXField = true;
+      cartesianHeader.pointFields.cartesianYField = true;
+      cartesianHeader.pointFields.cartesianZField = true;
+      cartesianHeader.pointFields.cartesianInvalidStateField = true;
+
+      int64_t batch = 0;
+
+      writer.WriteData3DData(
+         cartesianHeader, cBufferSize, [&batch]( e57::Data3DPointsDouble &block, size_t ) {
+            if ( batch == 2 )
+            {
+               return size_t{ 0 };
+            }
+
+            for ( int64_t i = 0; i < cBufferSize; ++i )
+            {
+               const double value = static_cast<double>( batch * cBufferSize + i );
+
+               block.cartesianX[i] = value;
+               block.cartesianY[i] = -value;
+               block.cartesianZ[i] = 2.0 * value;
+               block.cartesianInvalidState[i] = ( i % 100 == 0 ) ? 2 : 0;
+            }
+
+            block.cartesianX[7] = 1000.0;
+            block.cartesianInvalidState[7] = 1;
+
+            ++batch;
+
+            return static_cast<size_t>( cBufferSize );
+         } );
+
+      e57::Data3D sphericalHeader;
+      sphericalHeader.guid = "ComputeBounds Spherical Header GUID";
+      sphericalHeader.pointCount = cBufferSize;
+      sphericalHeader.pointFields.sphericalRangeField = true;
+      sphericalHeader.pointFields.sphericalAzimuthField = true;
+      sphericalHeader.pointFields.sphericalElevationField = true;
+      sphericalHeader.pointFields.sphericalInvalidStateField = true;
+
+      e57::Data3DPointsFloat sphericalData( sphericalHeader );
+
+      for ( int64_t i = 0; i < cBufferSize; ++i )
+      {
+         sphericalData.sphericalRange[i] = 1.0f + static_cast<float>( i );
+         sphericalData.sphericalAzimuth[i] = -1.0f + static_cast<float>( i ) / cBufferSize;
+         sphericalData.sphericalElevation[i] = 0.25f;
+         sphericalData.sphericalInvalidState[i] = 0;
+      }
+
+      // Direction only, so its range doesn't count but its angles do
+      sphericalData.sphericalRange[0] = 0.0f;
+      sphericalData.sphericalElevation[0] = -0.5f;
+      sphericalData.sphericalInvalidState[0] = 1;
+
+      // Invalid, so nothing counts
+      sphericalData.sphericalElevation[1] = 1.5f;
+      sphericalData.sphericalInvalidState[1] = 2;
+
+      writer.WriteData3DData( sphericalHeader, sphericalData );
+
+      // Half of the points are written from other buffers, which aren't looked at, so there are
+      // no bounds
+      e57::Data3D swappedHeader;
+      swappedHeader.guid = "ComputeBounds Swapped Header GUID";
+      swappedHeader.pointCount = cBufferSize;
+      swappedHeader.pointFields.cartesianXField = true;
+      swappedHeader.pointFields.cartesianYField = true;
+      swappedHeader.pointFields.cartesianZField = true;
+
+      constexpr size_t cHalfSize = cBufferSize / 2;
+
+      e57::Data3DPointsDouble swappedData( swappedHeader );
+      std::vector<double> otherX( cHalfSize, 5000.0 );
+      std::vector<double> otherY( cHalfSize, 5000.0 );
+      std::vector<double> otherZ( cHalfSize, 5000.0 );
+
+      e57::ImageFile imf = writer.GetRawIMF();
+      std::vector<e57::SourceDestBuffer> otherBuffers;
+      otherBuffers.emplace_back( imf, "cartesianX", otherX.data(), otherX.size(), true );
+      otherBuffers.emplace_back( imf, "cartesianY", otherY.data(), otherY.size(), true );
+      otherBuffers.emplace_back( imf, "cartesianZ", otherZ.data(), otherZ.size(), true );
+
+      E57_IGNORE_DEPRECATED_BEGIN
+      const int64_t swappedIndex = writer.NewData3D( swappedHeader );
+      auto dataWriter = writer.SetUpData3DPointsData( swappedIndex, cHalfSize, swappedData );
+      E57_IGNORE_DEPRECATED_END
+
+      dataWriter.write( cHalfSize );
+      dataWriter.write( otherBuffers, cHalfSize );
+      dataWriter.close();
+   }
+
+   e57::Reader reader( "./ComputeBounds.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   EXPECT_EQ( header.cartesianBounds.xMinimum, 1.0 );
+   EXPECT_EQ( header.cartesianBounds.xMaximum, 999.0 );
+   EXPECT_EQ( header.cartesianBounds.yMinimum, -999.0 );
+   EXPECT_EQ( header.cartesianBounds.yMaximum, -1.0 );
+   EXPECT_EQ( header.cartesianBounds.zMinimum, 2.0 );
+   EXPECT_EQ( header.cartesianBounds.zMaximum, 1998.0 );
+
+   ASSERT_TRUE( reader.ReadData3D( 1, header ) );
+
+   EXPECT_EQ( header.sphericalBounds.rangeMinimum, 3.0 );
+   EXPECT_EQ( header.sphericalBounds.rangeMaximum, static_cast<double>( cBufferSize ) );
+   EXPECT_EQ( header.sphericalBounds.elevationMinimum, -0.5 );
+   EXPECT_EQ( header.sphericalBounds.elevationMaximum, 0.25 );
+   EXPECT_EQ( header.sphericalBounds.azimuthStart, -1.0 );
+   EXPECT_EQ( header.sphericalBounds.azimuthEnd,
+              static_cast<double>( -1.0f + static_cast<float>( cBufferSize - 1 ) / cBufferSize ) );
+
+   ASSERT_TRUE( reader.ReadData3D( 2, header ) );
+
+   EXPECT_FALSE( e57::StructureNode( e57::VectorNode( reader.GetRawData3D() ).get( 2 ) )
+                    .isDefined( "cartesianBounds" ) );
+}
+
+TEST( SimpleWriter, FitScaledIntegerRanges )
+{
+   constexpr int64_t cNumPoints = 4'000;
+
+   auto write = []( const char *fileName, bool fit ) {
+      const e57::Data3D written = Helpers::WriteScan(
+         fileName, "FitScaledIntegerRanges", cNumPoints,
+         [=]( e57::WriterOptions &options ) { options.fitScaledIntegerRanges = fit; },
+         []( e57::Data3D &header ) {
+            // Much wider than the points need
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+            header.pointFields.pointRangeScale = 0.001;
+            header.pointFields.pointRangeMinimum = -1.0e6;
+            header.pointFields.pointRangeMaximum = 1.0e6;
+         },
+         []( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<double>( i % 1000 ) * 0.01;
+            pointsData.cartesianY[i] = 1.0;
+            pointsData.cartesianZ[i] = -2.5;
+         } );
+
+      return written.pointFields;
+   };
+
+   const auto cWide = write( "./FitScaledIntegerRangesWide.e57", false );
+   const auto cFitted = write( "./FitScaledIntegerRanges.e57", true );
+
+   EXPECT_EQ( cWide.pointRangeMinimum, -1.0e6 );
+   EXPECT_EQ( cWide.pointRangeMaximum, 1.0e6 );
+   EXPECT_EQ( cFitted.pointRangeMinimum, -2.5 );
+   EXPECT_EQ( cFitted.pointRangeMaximum, 9.99 );
+
+   // The prototype uses the fitted range, and the points still read back
+   e57::Reader reader( "./FitScaledIntegerRanges.e57", {} );
+
+   const e57::StructureNode scan( reader.GetRawData3D().get( 0 ) );
+   const e57::CompressedVectorNode points( scan.get( "points" ) );
+   const e57::StructureNode proto( points.prototype() );
+   const e57::ScaledIntegerNode x( proto.get( "cartesianX" ) );
+
+   EXPECT_EQ( x.minimum(), -2500 );
+   EXPECT_EQ( x.maximum(), 9990 );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   EXPECT_DOUBLE_EQ( pointsData.cartesianX[123], 1.23 );
+   EXPECT_DOUBLE_EQ( pointsData.cartesianZ[123], -2.5 );
+
+   vectorReader.close();
+}
+
+TEST( SimpleWriter, Deflate )
+{
+   constexpr int64_t cNumPoints = 50'000;
+
+   auto write = []( const char *fileName, int deflateLevel ) {
+      Helpers::WriteScan(
+         fileName, "Deflate", cNumPoints,
+         [=]( e57::WriterOptions &options ) { options.deflateLevel = deflateLevel; },
+         []( e57::Data3D &header ) {
+            header.pointFields.intensityField = true;
+            header.intensityLimits.intensityMinimum = 0.0;
+            header.intensityLimits.intensityMaximum = 1.0;
+         },
+         // A grid, so the data repeats
+         []( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<double>( i % 100 );
+            pointsData.cartesianY[i] = static_cast<double>( i / 100 );
+            pointsData.cartesianZ[i] = 1.5;
+            pointsData.intensity[i] = 0.5;
+         } );
+   };
+
+   try
+   {
+      write( "./DeflateNone.e57", 0 );
+      write( "./Deflate.e57", 6 );
+   }
+   catch ( const e57::E57Exception &e )
+   {
+      if ( e.errorCode() == e57::ErrorNotImplemented )
+      {
+         GTEST_SKIP() << "built without E57_WITH_ZLIB";
+      }
+
+      throw;
+   }
+
+   EXPECT_LT( Helpers::FileSize( "./Deflate.e57" ) * 4,
+              Helpers::FileSize( "./DeflateNone.e57" ) );
+
+   e57::Reader reader( "./Deflate.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   e57::Data3DPointsDouble pointsData( header );
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( pointsData.cartesianX[i], static_cast<double>( i % 100 ) );
+      ASSERT_EQ( pointsData.cartesianY[i], static_cast<double>( i / 100 ) );
+      ASSERT_EQ( pointsData.cartesianZ[i], 1.5 );
+      ASSERT_EQ( pointsData.intensity[i], 0.5 );
+   }
+
+   // Seeking uses the uncompressed lengths in the packets
+   vectorReader.seek( 31'234 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints - 31'234 ) );
+   EXPECT_EQ( pointsData.cartesianX[0], 34.0 );
+
+   vectorReader.close();
+}
+
+// Checks integers of every register size and a mix of bit widths which do and don't divide it,
+// with a record count which leaves a partial block at the end.
+TEST( SimpleWriter, IntegerBitWidths )
+{
+   const std::vector<unsigned> cBitWidths = { 1,  3,  5,  8,  9,  13, 16, 17,
+                                              24, 31, 32, 33, 47, 63, 64 };
+   constexpr size_t cNumRecords = 10'007;
+
+   auto fieldName = []( unsigned bits ) { return "b" + std::to_string( bits ); };
+
+   auto fieldMinimum = []( unsigned bits ) {
+      return ( bits == 64 ) ? INT64_MIN : int64_t{ -1000 };
+   };
+
+   auto fieldMaximum = [&]( unsigned bits ) {
+      return ( bits == 64 ) ? INT64_MAX
+                            : static_cast<int64_t>( fieldMinimum( bits ) +
+                                                    ( ( uint64_t{ 1 } << bits ) - 1 ) );
+   };
+
+   // Spread the values over the whole range, including both ends
+   auto value = [&]( unsigned bits, size_t record ) {
+      const uint64_t mask = ( bits == 64 ) ? ~uint64_t{ 0 } : ( uint64_t{ 1 } << bits ) - 1;
+
+      uint64_t v = ( record * 0x9E3779B97F4A7C15ULL ) ^ ( record >> 3 );
+      if ( record % 101 == 0 )
+      {
+         v = 0;
+      }
+      else if ( record % 103 == 0 )
+      {
+         v = ~uint64_t{ 0 };
+      }
+
+      return static_cast<int64_t>( static_cast<uint64_t>( fieldMinimum( bits ) ) + ( v & mask ) );
+   };
+
+   std::vector<std::vector<int64_t>> data( cBitWidths.size(),
+                                           std::vector<int64_t>( cNumRecords ) );
+
+   {
+      e57::ImageFile imf( "./IntegerBitWidths.e57", "w" );
+
+      e57::StructureNode proto( imf );
+
+      for ( unsigned bits : cBitWidths )
+      {
+         proto.set( fieldName( bits ),
+                    e57::IntegerNode( imf, fieldMinimum( bits ), fieldMinimum( bits ),
+                                     fieldMaximum( bits ) ) );
+      }
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      // Records are written from a copy, so the writes can start anywhere in data
+      std::vector<std::vector<int64_t>> writeData( cBitWidths.size(),
+                                                   std::vector<int64_t>( cNumRecords ) );
+      std::vector<e57::SourceDestBuffer> sbufs;
+
+      for ( size_t i = 0; i < cBitWidths.size(); ++i )
+      {
+         for ( size_t record = 0; record < cNumRecords; ++record )
+         {
+            data[i][record] = value( cBitWidths[i], record );
+         }
+
+         sbufs.emplace_back( imf, fieldName( cBitWidths[i] ), writeData[i].data(), cNumRecords,
+                             true );
+      }
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+
+      // Start with some small writes which leave the encoders part way through a word, then
+      // write the rest in one go
+      size_t written = 0;
+
+      for ( size_t count : { size_t{ 1 }, size_t{ 7 }, size_t{ 63 }, size_t{ 64 }, size_t{ 65 },
+                             cNumRecords - 200 } )
+      {
+         for ( size_t i = 0; i < cBitWidths.size(); ++i )
+         {
+            std::copy_n( data[i].begin() + written, count, writeData[i].begin() );
+         }
+
+         writer.write( count );
+         written += count;
+      }
+
+      writer.close();
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./IntegerBitWidths.e57", "r" );
+
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+   ASSERT_EQ( points.childCount(), static_cast<int64_t>( cNumRecords ) );
+
+   std::vector<std::vector<int64_t>> readData( cBitWidths.size(),
+                                               std::vector<int64_t>( cNumRecords ) );
+   std::vector<e57::SourceDestBuffer> dbufs;
+
+   for ( size_t i = 0; i < cBitWidths.size(); ++i )
+   {
+      dbufs.emplace_back( imf, fieldName( cBitWidths[i] ), readData[i].data(), cNumRecords,
+                          true );
+   }
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+
+   ASSERT_EQ( reader.read(), cNumRecords );
+
+   for ( size_t i = 0; i < cBitWidths.size(); ++i )
+   {
+      for ( size_t record = 0; record < cNumRecords; ++record )
+      {
+         ASSERT_EQ( readData[i][record], data[i][record] )
+            << "bits=" << cBitWidths[i] << " record=" << record;
+      }
+   }
+
+   reader.close();
+
+   imf.close();
+}
+
+TEST( SimpleWriter, DeltaCodec )
+{
+   constexpr int64_t cNumRows = 200;
+   constexpr int64_t cNumColumns = 300;
+   constexpr int64_t cNumPoints = cNumRows * cNumColumns;
+
+   auto write = []( const char *fileName, const std::vector<e57::ustring> &deltaCodecFields ) {
+      Helpers::WriteScan(
+         fileName, "DeltaCodec", cNumPoints,
+         [&]( e57::WriterOptions &options ) { options.deltaCodecFields = deltaCodecFields; },
+         []( e57::Data3D &header ) {
+            header.pointFields.rowIndexField = true;
+            header.pointFields.rowIndexMaximum = cNumRows - 1;
+            header.pointFields.columnIndexField = true;
+            header.pointFields.columnIndexMaximum = cNumColumns - 1;
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+            header.pointFields.pointRangeScale = 0.001;
+            header.pointFields.pointRangeMinimum = -100.0;
+            header.pointFields.pointRangeMaximum = 100.0;
+         },
+         // A smooth surface scanned row by row
+         []( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            const int64_t row = i / cNumColumns;
+            const int64_t column = i % cNumColumns;
+
+            pointsData.rowIndex[i] = static_cast<int32_t>( row );
+            pointsData.columnIndex[i] = static_cast<int32_t>( column );
+            pointsData.cartesianX[i] = static_cast<double>( column ) * 0.01;
+            pointsData.cartesianY[i] = static_cast<double>( row ) * 0.01;
+            pointsData.cartesianZ[i] = 10.0 + std::sin( static_cast<double>( i ) * 0.001 );
+         } );
+   };
+
+   write( "./DeltaCodecNone.e57", {} );
+   write( "./DeltaCodec.e57",
+          { "rowIndex", "columnIndex", "cartesianX", "cartesianY", "cartesianZ", "missing" } );
+
+   EXPECT_LT( Helpers::FileSize( "./DeltaCodec.e57" ) * 2,
+              Helpers::FileSize( "./DeltaCodecNone.e57" ) );
+
+   e57::Reader reader( "./DeltaCodec.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   // Read in odd sized pieces, so blocks are split between reads
+   constexpr int64_t cBufferSize = 1'001;
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   int64_t first = 0;
+   while ( const unsigned count = vectorReader.read() )
+   {
+      for ( unsigned j = 0; j < count; ++j )
+      {
+         const int64_t i = first + j;
+
+         ASSERT_EQ( pointsData.rowIndex[j], i / cNumColumns ) << "i=" << i;
+         ASSERT_EQ( pointsData.columnIndex[j], i % cNumColumns ) << "i=" << i;
+         ASSERT_NEAR( pointsData.cartesianZ[j], 10.0 + std::sin( static_cast<double>( i ) * 0.001 ),
+                      0.001 );
+      }
+
+      first += count;
+   }
+
+   EXPECT_EQ( first, cNumPoints );
+
+   // Seeking starts decoding at the start of a block
+   vectorReader.seek( 45'678 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.rowIndex[0], 45'678 / cNumColumns );
+   EXPECT_EQ( pointsData.columnIndex[0], 45'678 % cNumColumns );
+
+   vectorReader.close();
+}
+
+TEST( SimpleWriter, RunLengthCodec )
+{
+   constexpr int64_t cNumPoints = 100'003;
+
+   // Mostly constant fields, which change now and then
+   auto invalidState = []( int64_t i ) { return ( i % 10'007 == 0 ) ? 1 : 0; };
+   auto red = []( int64_t i ) { return ( i % 5'000 < 3 ) ? 10 : 200; };
+   auto intensity = []( int64_t i ) { return static_cast<double>( i / 20'000 * 100 ); };
+
+   auto write = [&]( const char *fileName,
+                     const std::vector<e57::ustring> &runLengthCodecFields ) {
+      Helpers::WriteScan(
+         fileName, "RunLengthCodec", cNumPoints,
+         [&]( e57::WriterOptions &options ) {
+            options.runLengthCodecFields = runLengthCodecFields;
+         },
+         []( e57::Data3D &header ) {
+            header.pointFields.cartesianInvalidStateField = true;
+            header.pointFields.returnIndexField = true;
+            header.pointFields.returnCountField = true;
+            header.pointFields.colorRedField = true;
+            header.pointFields.colorGreenField = true;
+            header.pointFields.colorBlueField = true;
+            header.pointFields.intensityField = true;
+            header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+            header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+            header.pointFields.pointRangeScale = 0.001;
+            header.pointFields.pointRangeMinimum = -10.0;
+            header.pointFields.pointRangeMaximum = 10.0;
+            header.colorLimits.colorRedMaximum = 255;
+            header.colorLimits.colorGreenMaximum = 255;
+            header.colorLimits.colorBlueMaximum = 255;
+            header.intensityLimits.intensityMaximum = 4095;
+         },
+         [&]( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<double>( i % 1'000 ) * 0.01;
+            pointsData.cartesianY[i] = static_cast<double>( i / 1'000 ) * 0.01;
+            pointsData.cartesianZ[i] = std::sin( static_cast<double>( i ) * 0.001 );
+            pointsData.cartesianInvalidState[i] = static_cast<int8_t>( invalidState( i ) );
+            pointsData.returnIndex[i] = 0;
+            pointsData.returnCount[i] = 1;
+            pointsData.colorRed[i] = static_cast<uint16_t>( red( i ) );
+            pointsData.colorGreen[i] = 100;
+            pointsData.colorBlue[i] = 50;
+            pointsData.intensity[i] = intensity( i );
+         } );
+   };
+
+   write( "./RunLengthCodecNone.e57", {} );
+   write( "./RunLengthCodec.e57",
+          { "cartesianInvalidState", "returnIndex", "returnCount", "colorRed", "colorGreen",
+            "colorBlue", "intensity", "cartesianX", "missing" } );
+
+   EXPECT_LT( Helpers::FileSize( "./RunLengthCodec.e57" ) * 3,
+              Helpers::FileSize( "./RunLengthCodecNone.e57" ) * 2 );
+
+   e57::Reader reader( "./RunLengthCodec.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   // Read in odd sized pieces, so runs are split between reads
+   constexpr int64_t cBufferSize = 1'001;
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cBufferSize, pointsData );
+
+   int64_t first = 0;
+   while ( const unsigned count = vectorReader.read() )
+   {
+      for ( unsigned j = 0; j < count; ++j )
+      {
+         const int64_t i = first + j;
+
+         ASSERT_NEAR( pointsData.cartesianX[j], static_cast<double>( i % 1'000 ) * 0.01, 0.001 );
+         ASSERT_EQ( pointsData.cartesianInvalidState[j], invalidState( i ) ) << "i=" << i;
+         ASSERT_EQ( pointsData.returnIndex[j], 0 ) << "i=" << i;
+         ASSERT_EQ( pointsData.returnCount[j], 1 ) << "i=" << i;
+         ASSERT_EQ( pointsData.colorRed[j], red( i ) ) << "i=" << i;
+         ASSERT_EQ( pointsData.colorGreen[j], 100 ) << "i=" << i;
+         ASSERT_EQ( pointsData.intensity[j], intensity( i ) ) << "i=" << i;
+      }
+
+      first += count;
+   }
+
+   EXPECT_EQ( first, cNumPoints );
+
+   // Seeking starts decoding at the start of a run
+   vectorReader.seek( 45'002 );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cBufferSize ) );
+   EXPECT_EQ( pointsData.colorRed[0], red( 45'002 ) );
+   EXPECT_EQ( pointsData.colorRed[cBufferSize - 1], red( 45'002 + cBufferSize - 1 ) );
+   EXPECT_EQ( pointsData.intensity[0], intensity( 45'002 ) );
+
+   vectorReader.close();
+}
+
+// Checks the delta codec with values which jump all over the range of each register size, and
+// with prediction from the previous two values.
+TEST( SimpleWriter, DeltaCodecBitWidths )
+{
+   const std::vector<unsigned> cBitWidths = { 1, 7, 8, 13, 32, 33, 63, 64 };
+   constexpr size_t cNumRecords = 5'003;
+
+   auto fieldName = []( unsigned bits ) { return "b" + std::to_string( bits ); };
+
+   auto fieldMinimum = []( unsigned bits ) {
+      return ( bits == 64 ) ? INT64_MIN : int64_t{ -1000 };
+   };
+
+   auto fieldMaximum = [&]( unsigned bits ) {
+      return ( bits == 64 ) ? INT64_MAX
+                            : static_cast<int64_t>( fieldMinimum( bits ) +
+                                                    ( ( uint64_t{ 1 } << bits ) - 1 ) );
+   };
+
+   // Mostly a slope, with jumps to both ends of the range
+   auto value = [&]( unsigned bits, size_t record ) {
+      const uint64_t mask = ( bits == 64 ) ? ~uint64_t{ 0 } : ( uint64_t{ 1 } << bits ) - 1;
+
+      uint64_t v = record * 3;
+      if ( record % 101 == 0 )
+      {
+         v = 0;
+      }
+      else if ( record % 103 == 0 )
+      {
+         v = ~uint64_t{ 0 };
+      }
+      else if ( record % 7 == 0 )
+      {
+         v = record * 0x9E3779B97F4A7C15ULL;
+      }
+
+      return static_cast<int64_t>( static_cast<uint64_t>( fieldMinimum( bits ) ) + ( v & mask ) );
+   };
+
+   std::vector<std::vector<int64_t>> data( cBitWidths.size(),
+                                           std::vector<int64_t>( cNumRecords ) );
+
+   {
+      e57::ImageFile imf( "./DeltaCodecBitWidths.e57", "w" );
+      imf.extensionsAdd( "delta", e57::DELTA_CODEC_URI );
+
+      e57::StructureNode proto( imf );
+      e57::VectorNode inputs( imf, false );
+
+      for ( unsigned bits : cBitWidths )
+      {
+         proto.set( fieldName( bits ),
+                    e57::IntegerNode( imf, fieldMinimum( bits ), fieldMinimum( bits ),
+                                     fieldMaximum( bits ) ) );
+         inputs.append( e57::StringNode( imf, fieldName( bits ) ) );
+      }
+
+      e57::StructureNode deltaCodec( imf );
+      deltaCodec.set( "order", e57::IntegerNode( imf, 2, 1, 2 ) );
+
+      e57::StructureNode codec( imf );
+      codec.set( "inputs", inputs );
+      codec.set( "delta:deltaCodec", deltaCodec );
+
+      e57::VectorNode codecs( imf, true );
+      codecs.append( codec );
+
+      e57::CompressedVectorNode points( imf, proto, codecs );
+      imf.root().set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+
+      for ( size_t i = 0; i < cBitWidths.size(); ++i )
+      {
+         for ( size_t record = 0; record < cNumRecords; ++record )
+         {
+            data[i][record] = value( cBitWidths[i], record );
+         }
+
+         sbufs.emplace_back( imf, fieldName( cBitWidths[i] ), data[i].data(), cNumRecords, true );
+      }
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumRecords );
+      writer.close();
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./DeltaCodecBitWidths.e57", "r" );
+
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+
+   std::vector<std::vector<int64_t>> readData( cBitWidths.size(),
+                                               std::vector<int64_t>( cNumRecords ) );
+   std::vector<e57::SourceDestBuffer> dbufs;
+
+   for ( size_t i = 0; i < cBitWidths.size(); ++i )
+   {
+      dbufs.emplace_back( imf, fieldName( cBitWidths[i] ), readData[i].data(), cNumRecords,
+                          true );
+   }
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+
+   ASSERT_EQ( reader.read(), cNumRecords );
+
+   for ( size_t i = 0; i < cBitWidths.size(); ++i )
+   {
+      for ( size_t record = 0; record < cNumRecords; ++record )
+      {
+         ASSERT_EQ( readData[i][record], data[i][record] )
+            << "bits=" << cBitWidths[i] << " record=" << record;
+      }
+   }
+
+   reader.close();
+
+   imf.close();
+}
+
+// Checks converting between the memory representations of buffers and the types in the file.
+TEST( SimpleWriter, BufferConversions )
+{
+   constexpr size_t cNumRecords = 1000;
+
+   {
+      e57::ImageFile imf( "./BufferConversions.e57", "w" );
+
+      e57::StructureNode proto( imf );
+      proto.set( "integer", e57::IntegerNode( imf, 0, 0, 1000 ) );
+      proto.set( "scaled", e57::ScaledIntegerNode( imf, 0, -100000, 100000, 0.01, 5.0 ) );
+      proto.set( "float", e57::FloatNode( imf, 0.0, e57::PrecisionSingle ) );
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      // Write each field from a buffer with a different representation
+      std::vector<double> integers( cNumRecords );
+      std::vector<float> scaled( cNumRecords );
+      std::vector<int16_t> floats( cNumRecords );
+
+      for ( size_t i = 0; i < cNumRecords; ++i )
+      {
+         integers[i] = static_cast<double>( i );
+         scaled[i] = static_cast<float>( i ) * 0.25f - 90.0f;
+         floats[i] = static_cast<int16_t>( 500 - static_cast<int16_t>( i ) );
+      }
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "integer", integers.data(), cNumRecords, true );
+      sbufs.emplace_back( imf, "scaled", scaled.data(), cNumRecords, true, true );
+      sbufs.emplace_back( imf, "float", floats.data(), cNumRecords, true );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumRecords );
+      writer.close();
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./BufferConversions.e57", "r" );
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+
+   std::vector<float> integers( cNumRecords );
+   std::vector<int32_t> scaledRaw( cNumRecords );
+   std::vector<double> scaled( cNumRecords );
+   std::vector<float> scaledFloat( cNumRecords );
+   std::vector<float> scaledStrided( 2 * cNumRecords );
+   std::vector<int32_t> floats( cNumRecords );
+
+   {
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "integer", integers.data(), cNumRecords, true );
+      dbufs.emplace_back( imf, "scaled", scaledRaw.data(), cNumRecords, true, false );
+      dbufs.emplace_back( imf, "float", floats.data(), cNumRecords, true );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+      ASSERT_EQ( reader.read(), cNumRecords );
+      reader.close();
+   }
+
+   {
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "scaled", scaled.data(), cNumRecords, true, true );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+      ASSERT_EQ( reader.read(), cNumRecords );
+      reader.close();
+   }
+
+   // Scaled values into contiguous and strided float buffers
+   {
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "scaled", scaledFloat.data(), cNumRecords, true, true );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+      ASSERT_EQ( reader.read(), cNumRecords );
+      reader.close();
+   }
+
+   {
+      std::vector<e57::SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "scaled", scaledStrided.data() + 1, cNumRecords, true, true,
+                          2 * sizeof( float ) );
+
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+      ASSERT_EQ( reader.read(), cNumRecords );
+      reader.close();
+   }
+
+   for ( size_t i = 0; i < cNumRecords; ++i )
+   {
+      const double scaledValue = static_cast<double>( i ) * 0.25 - 90.0;
+      const double rawValue = std::floor( ( scaledValue - 5.0 ) / 0.01 + 0.5 );
+
+      ASSERT_EQ( integers[i], static_cast<float>( i ) );
+      ASSERT_EQ( scaledRaw[i], static_cast<int32_t>( rawValue ) );
+      ASSERT_NEAR( scaled[i], scaledValue, 0.005 );
+      ASSERT_EQ( scaledFloat[i], static_cast<float>( scaled[i] ) );
+      ASSERT_EQ( scaledStrided[2 * i], 0.0f );
+      ASSERT_EQ( scaledStrided[2 * i + 1], scaledFloat[i] );
+      ASSERT_EQ( floats[i], 500 - static_cast<int32_t>( i ) );
+   }
+
+   // Values which don't fit in the buffer's type are an error
+   std::vector<uint8_t> small( cNumRecords );
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "integer", small.data(), cNumRecords, true );
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+   E57_ASSERT_THROW( reader.read() );
+   reader.close();
+
+   imf.close();
+}
+
+TEST( SimpleWriter, FloatBuffers )
+{
+   constexpr size_t cNumRecords = 5000;
+
+   // Interleaved x/y values, so the buffers are strided
+   std::vector<double> xy( 2 * cNumRecords );
+   std::vector<float> intensity( cNumRecords );
+
+   for ( size_t i = 0; i < cNumRecords; ++i )
+   {
+      xy[2 * i] = static_cast<double>( i ) / 3.0;
+      xy[2 * i + 1] = -static_cast<double>( i ) * 1.0e10;
+      intensity[i] = static_cast<float>( i ) / 7.0f;
+   }
+
+   {
+      e57::ImageFile imf( "./FloatBuffers.e57", "w" );
+
+      e57::StructureNode proto( imf );
+      proto.set( "x", e57::FloatNode( imf, 0.0, e57::PrecisionDouble ) );
+      proto.set( "y", e57::FloatNode( imf, 0.0, e57::PrecisionDouble ) );
+      proto.set( "intensity", e57::FloatNode( imf, 0.0, e57::PrecisionSingle ) );
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "x", xy.data(), cNumRecords, false, false, 2 * sizeof( double ) );
+      sbufs.emplace_back( imf, "y", xy.data() + 1, cNumRecords, false, false,
+                          2 * sizeof( double ) );
+      sbufs.emplace_back( imf, "intensity", intensity.data(), cNumRecords );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumRecords );
+      writer.close();
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./FloatBuffers.e57", "r" );
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+
+   // Read back into contiguous buffers, and intensity into a strided one
+   std::vector<double> x( cNumRecords );
+   std::vector<double> y( cNumRecords );
+   std::vector<float> intensityStrided( 3 * cNumRecords );
+
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "x", x.data(), cNumRecords );
+   dbufs.emplace_back( imf, "y", y.data(), cNumRecords );
+   dbufs.emplace_back( imf, "intensity", intensityStrided.data(), cNumRecords, false, false,
+                       3 * sizeof( float ) );
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+   ASSERT_EQ( reader.read(), cNumRecords );
+   reader.close();
+
+   imf.close();
+
+   for ( size_t i = 0; i < cNumRecords; ++i )
+   {
+      ASSERT_EQ( x[i], xy[2 * i] );
+      ASSERT_EQ( y[i], xy[2 * i + 1] );
+      ASSERT_EQ( intensityStrided[3 * i], intensity[i] );
+      ASSERT_EQ( intensityStrided[3 * i + 1], 0.0f );
+      ASSERT_EQ( intensityStrided[3 * i + 2], 0.0f );
+   }
+}
+
+TEST( SimpleWriter, ChildLookup )
+{
+   // Enough children that the names are looked up through an index, added out of order
+   constexpr int cNumFields = 40;
+
+   auto fieldName = []( int i ) { return "field" + std::to_string( ( i * 17 ) % cNumFields ); };
+
+   auto checkLookups = []( e57::ImageFile &imf ) {
+      e57::StructureNode root = imf.root();
+
+      for ( int i = 0; i < cNumFields; ++i )
+      {
+         const std::string name = "field" + std::to_string( i );
+
+         ASSERT_TRUE( root.isDefined( name ) );
+         EXPECT_EQ( e57::StringNode( root.get( name ) ).value(), "value" + std::to_string( i ) );
+         EXPECT_EQ( e57::StringNode( root.get( "/" + name ) ).value(),
+                    "value" + std::to_string( i ) );
+      }
+
+      EXPECT_FALSE( root.isDefined( "field" ) );
+      EXPECT_FALSE( root.isDefined( "field40" ) );
+      EXPECT_FALSE( root.isDefined( "field1/x" ) );
+      EXPECT_FALSE( root.isDefined( "nested/a/c" ) );
+      EXPECT_FALSE( root.isDefined( "list/12" ) );
+      EXPECT_FALSE( root.isDefined( "list/01" ) );
+
+      EXPECT_EQ( e57::StringNode( root.get( "nested/a/b" ) ).value(), "b" );
+      EXPECT_EQ( e57::StringNode( root.get( "/list/11" ) ).value(), "11" );
+
+      e57::StructureNode a( root.get( "nested/a" ) );
+      EXPECT_EQ( e57::StringNode( a.get( "b" ) ).value(), "b" );
+      EXPECT_EQ( e57::StringNode( a.get( "/field3" ) ).value(), "value3" );
+
+      EXPECT_THROW( root.isDefined( "bad name" ), e57::E57Exception );
+      EXPECT_THROW( root.isDefined( "nested/a//b" ), e57::E57Exception );
+      EXPECT_THROW( root.get( "field40" ), e57::E57Exception );
+   };
+
+   {
+      e57::ImageFile imf( "./ChildLookup.e57", "w" );
+      e57::StructureNode root = imf.root();
+
+      for ( int i = 0; i < cNumFields; ++i )
+      {
+         const std::string name = fieldName( i );
+
+         root.set( name, e57::StringNode( imf, "value" + name.substr( 5 ) ) );
+      }
+
+      e57::StructureNode nested( imf );
+      e57::StructureNode nestedA( imf );
+      root.set( "nested", nested );
+      nested.set( "a", nestedA );
+      nestedA.set( "b", e57::StringNode( imf, "b" ) );
+
+      e57::VectorNode list( imf, true );
+      root.set( "list", list );
+
+      for ( int i = 0; i < 12; ++i )
+      {
+         list.append( e57::StringNode( imf, std::to_string( i ) ) );
+      }
+
+      EXPECT_THROW( root.set( "field7", e57::StringNode( imf, "again" ) ), e57::E57Exception );
+
+      checkLookups( imf );
+
+      imf.close();
+   }
+
+   for ( bool lazyLoad : { false, true } )
+   {
+      e57::ImageFile imf( "./ChildLookup.e57", "r", e57::ChecksumAll, lazyLoad );
+
+      checkLookups( imf );
+
+      imf.close();
+   }
+}
+
+TEST( SimpleWriter, HomogeneousVector )
+{
+   e57::ImageFile imf( "./HomogeneousVector.e57", "w" );
+
+   auto structure = [&]( const std::vector<std::string> &names ) {
+      e57::StructureNode s( imf );
+
+      for ( const auto &name : names )
+      {
+         s.set( name, e57::FloatNode( imf ) );
+      }
+
+      return s;
+   };
+
+   e57::VectorNode vector( imf, false );
+   imf.root().set( "vector", vector );
+
+   // Children with the same names are equivalent, in any order
+   vector.append( structure( { "x", "y", "z" } ) );
+   vector.append( structure( { "x", "y", "z" } ) );
+   vector.append( structure( { "z", "x", "y" } ) );
+
+   EXPECT_EQ( vector.childCount(), 3 );
+
+   E57_ASSERT_THROW( vector.append( structure( { "x", "y", "w" } ) ) );
+   E57_ASSERT_THROW( vector.append( structure( { "x", "y" } ) ) );
+
+   imf.close();
+}
+
+namespace
+{
+   // Keeps the data of a file in memory, counting the calls made to it
+   class MemoryIO : public e57::ImageFileIO
+   {
+   public:
+      explicit MemoryIO( std::shared_ptr<std::vector<char>> data ) : data_( std::move( data ) )
+      {
+      }
+
+      size_t readAt( uint64_t offset, void *buffer, size_t count ) override
+      {
+         ++readCount;
+
+         // Return short reads to check they are continued
+         count = std::min<size_t>( { count, maxReadSize, data_->size() - offset } );
+         std::memcpy( buffer, data_->data() + offset, count );
+         return count;
+      }
+
+      size_t writeAt( uint64_t offset, const void *buffer, size_t count ) override
+      {
+         ++writeCount;
+
+         if ( offset + count > data_->size() )
+         {
+            data_->resize( offset + count );
+         }
+
+         std::memcpy( data_->data() + offset, buffer, count );
+         return count;
+      }
+
+      uint64_t size() override
+      {
+         return data_->size();
+      }
+
+      e57::ustring name() const override
+      {
+         return "memory";
+      }
+
+      size_t maxReadSize = 10'000;
+
+      std::atomic<int> readCount{ 0 };
+      int writeCount = 0;
+
+   private:
+      std::shared_ptr<std::vector<char>> data_;
+   };
+}
+
+TEST( SimpleWriter, Preallocate )
+{
+   constexpr int64_t cNumPoints = 20'000;
+
+   auto write = []( const char *fileName, uint64_t estimatedFileSize, bool preallocatePoints ) {
+      Helpers::WriteScan(
+         fileName, "Preallocate", cNumPoints,
+         [=]( e57::WriterOptions &options ) {
+            options.estimatedFileSize = estimatedFileSize;
+            options.preallocatePointData = preallocatePoints;
+         },
+         []( e57::Data3D & ) {},
+         []( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<double>( i );
+            pointsData.cartesianY[i] = static_cast<double>( i ) * 0.5;
+            pointsData.cartesianZ[i] = -static_cast<double>( i );
+         } );
+   };
+
+   write( "./PreallocateNone.e57", 0, false );
+   write( "./Preallocate.e57", 50'000'000, true );
+
+   // The space which wasn't used is given back
+   EXPECT_EQ( Helpers::FileSize( "./Preallocate.e57" ),
+              Helpers::FileSize( "./PreallocateNone.e57" ) );
+
+   e57::Reader reader( "./Preallocate.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   EXPECT_EQ( pointsData.cartesianX[12'345], 12'345.0 );
+   EXPECT_EQ( pointsData.cartesianZ[cNumPoints - 1], -static_cast<double>( cNumPoints - 1 ) );
+
+   vectorReader.close();
+}
+
+namespace
+{
+   // A scan for the tests writing several at once, with values which depend on the scan
+   e57::Data3D ConcurrentHeader( int scan, int64_t pointCount )
+   {
+      e57::Data3D header;
+      header.guid = "Concurrent Header GUID " + std::to_string( scan );
+      header.pointCount = pointCount;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.25;
+      header.pointFields.pointRangeMinimum = -1'000'000.0;
+      header.pointFields.pointRangeMaximum = 1'000'000.0;
+
+      return header;
+   }
+
+   void FillConcurrent( int scan, int64_t firstRecord, int64_t count,
+                        e57::Data3DPointsDouble &pointsData )
+   {
+      for ( int64_t i = 0; i < count; ++i )
+      {
+         const auto record = static_cast<double>( firstRecord + i );
+
+         pointsData.cartesianX[i] = record;
+         pointsData.cartesianY[i] = -record * 0.5;
+         pointsData.cartesianZ[i] = static_cast<double>( scan );
+      }
+   }
+
+   void CheckConcurrent( const std::string &fileName, const std::vector<int64_t> &pointCounts )
+   {
+      e57::Reader reader( fileName, {} );
+
+      ASSERT_EQ( reader.GetData3DCount(), static_cast<int64_t>( pointCounts.size() ) );
+
+      for ( size_t scan = 0; scan < pointCounts.size(); ++scan )
+      {
+         e57::Data3D header;
+         ASSERT_TRUE( reader.ReadData3D( static_cast<int64_t>( scan ), header ) );
+
+         // The scans may be in any order
+         const int scanNumber = std::stoi( header.guid.substr( header.guid.rfind( ' ' ) + 1 ) );
+         ASSERT_EQ( header.pointCount, pointCounts.at( static_cast<size_t>( scanNumber ) ) );
+
+         e57::Data3DPointsDouble pointsData( header );
+
+         auto vectorReader =
+            reader.SetUpData3DPointsData( static_cast<int64_t>( scan ), header.pointCount,
+                                          pointsData );
+
+         ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( header.pointCount ) );
+
+         for ( int64_t i = 0; i < header.pointCount; ++i )
+         {
+            ASSERT_EQ( pointsData.cartesianX[i], static_cast<double>( i ) );
+            ASSERT_EQ( pointsData.cartesianY[i], -static_cast<double>( i ) * 0.5 );
+            ASSERT_EQ( pointsData.cartesianZ[i], static_cast<double>( scanNumber ) );
+         }
+
+         // The index points into the section wherever it ended up
+         const int64_t seekRecord = header.pointCount * 2 / 3;
+         vectorReader.seek( static_cast<uint64_t>( seekRecord ) );
+
+         ASSERT_GT( vectorReader.read(), 0u );
+         EXPECT_EQ( pointsData.cartesianX[0], static_cast<double>( seekRecord ) );
+
+         vectorReader.close();
+      }
+   }
+}
+
+TEST( SimpleWriter, ConcurrentData3D )
+{
+   const std::vector<int64_t> cPointCounts = { 400'000, 250'003, 1'000, 333'333 };
+
+   {
+      e57::WriterOptions options;
+      options.guid = "Concurrent File GUID";
+      options.encodeThreadCount = 2;
+
+      e57::Writer writer( "./ConcurrentData3D.e57", options );
+
+      // Each thread writes its own scan with WriteData3DData()
+      std::vector<std::thread> threads;
+      std::vector<int> failures( cPointCounts.size(), 0 );
+
+      for ( size_t scan = 0; scan < cPointCounts.size(); ++scan )
+      {
+         threads.emplace_back( [&, scan] {
+            try
+            {
+               e57::Data3D header =
+                  ConcurrentHeader( static_cast<int>( scan ), cPointCounts[scan] );
+               e57::Data3DPointsDouble pointsData( header );
+
+               FillConcurrent( static_cast<int>( scan ), 0, header.pointCount, pointsData );
+
+               writer.WriteData3DData( header, pointsData );
+            }
+            catch ( ... )
+            {
+               failures[scan] = 1;
+            }
+         } );
+      }
+
+      for ( auto &thread : threads )
+      {
+         thread.join();
+      }
+
+      for ( const int failed : failures )
+      {
+         EXPECT_EQ( failed, 0 );
+      }
+   }
+
+   CheckConcurrent( "./ConcurrentData3D.e57", cPointCounts );
+}
+
+TEST( SimpleWriter, OverlappingWriters )
+{
+   constexpr int64_t cNumPoints = 300'000;
+   constexpr int64_t cBufferSize = 50'000;
+
+   // Two writers open at once on one thread, the second one closed first
+   {
+      e57::WriterOptions options;
+      options.guid = "Overlapping File GUID";
+
+      e57::Writer writer( "./OverlappingWriters.e57", options );
+
+      e57::Data3D header0 = ConcurrentHeader( 0, cNumPoints );
+      e57::Data3D header1 = ConcurrentHeader( 1, cNumPoints );
+
+      e57::Data3D bufferHeader = header0;
+      bufferHeader.pointCount = cBufferSize;
+
+      e57::Data3DPointsDouble pointsData0( bufferHeader );
+      e57::Data3DPointsDouble pointsData1( bufferHeader );
+
+      // Two writers can only be open at once with the deprecated set-up calls
+      E57_IGNORE_DEPRECATED_BEGIN
+      const int64_t index0 = writer.NewData3D( header0 );
+      const int64_t index1 = writer.NewData3D( header1 );
+
+      auto dataWriter0 = writer.SetUpData3DPointsData( index0, cBufferSize, pointsData0 );
+      auto dataWriter1 = writer.SetUpData3DPointsData( index1, cBufferSize, pointsData1 );
+
+      // Not a second writer of the same points, nor a blob among the packets of the first one
+      try
+      {
+         writer.SetUpData3DPointsData( index0, cBufferSize, pointsData0 );
+         FAIL() << "a second writer of the same points was opened";
+      }
+      catch ( const e57::E57Exception &e )
+      {
+         EXPECT_EQ( e.errorCode(), e57::ErrorTooManyWriters );
+      }
+      E57_IGNORE_DEPRECATED_END
+
+      try
+      {
+         e57::BlobNode blob( writer.GetRawIMF(), 16 );
+         FAIL() << "a blob was created while a writer had the end of the file";
+      }
+      catch ( const e57::E57Exception &e )
+      {
+         EXPECT_EQ( e.errorCode(), e57::ErrorTooManyWriters );
+      }
+
+      for ( int64_t first = 0; first < cNumPoints; first += cBufferSize )
+      {
+         FillConcurrent( 0, first, cBufferSize, pointsData0 );
+         dataWriter0.write( cBufferSize );
+
+         FillConcurrent( 1, first, cBufferSize, pointsData1 );
+         dataWriter1.write( cBufferSize );
+
+         E57_ASSERT_NO_THROW( dataWriter0.checkInvariant() );
+         E57_ASSERT_NO_THROW( dataWriter1.checkInvariant() );
+      }
+
+      dataWriter1.close();
+      dataWriter0.close();
+
+      E57_ASSERT_NO_THROW( writer.GetRawIMF().checkInvariant( false ) );
+   }
+
+   CheckConcurrent( "./OverlappingWriters.e57", { cNumPoints, cNumPoints } );
+}
+
+TEST( SimpleWriter, DirectIO )
+{
+   constexpr int64_t cNumPoints = 200'000;
+
+   auto write = []( const char *fileName, bool directIO ) {
+      Helpers::WriteScan(
+         fileName, "DirectIO", cNumPoints,
+         [=]( e57::WriterOptions &options ) {
+            options.encodeThreadCount = 2;
+            options.directIO = directIO;
+         },
+         []( e57::Data3D &header ) {
+            header.pointFields.intensityField = true;
+            header.intensityLimits.intensityMinimum = 0.0;
+            header.intensityLimits.intensityMaximum = 1.0;
+         },
+         []( e57::Data3DPointsDouble &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<double>( i );
+            pointsData.cartesianY[i] = std::sin( static_cast<double>( i ) );
+            pointsData.cartesianZ[i] = -static_cast<double>( i ) * 0.25;
+            pointsData.intensity[i] = static_cast<double>( i % 101 ) / 100.0;
+         } );
+   };
+
+   write( "./DirectIONone.e57", false );
+   write( "./DirectIO.e57", true );
+
+   EXPECT_EQ( Helpers::FileSize( "./DirectIO.e57" ), Helpers::FileSize( "./DirectIONone.e57" ) );
+
+   e57::ReaderOptions options;
+   options.directIO = true;
+
+   e57::Reader reader( "./DirectIO.e57", options );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( pointsData.cartesianX[i], static_cast<double>( i ) ) << "i=" << i;
+      ASSERT_EQ( pointsData.cartesianY[i], std::sin( static_cast<double>( i ) ) ) << "i=" << i;
+      ASSERT_NEAR( pointsData.intensity[i], static_cast<double>( i % 101 ) / 100.0, 1e-6 )
+         << "i=" << i;
+   }
+
+   vectorReader.close();
+}
+
+TEST( SimpleWriter, ImageFileIO )
+{
+   constexpr int64_t cNumPoints = 100'000;
+
+   auto data = std::make_shared<std::vector<char>>();
+
+   {
+      auto io = std::make_shared<MemoryIO>( data );
+
+      e57::WriterOptions options;
+      options.guid = "ImageFileIO File GUID";
+
+      e57::Writer writer( io, options );
+
+      e57::Data3D header;
+      header.guid = "ImageFileIO Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = static_cast<float>( i ) * 0.5f;
+         pointsData.cartesianZ[i] = -static_cast<float>( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+      writer.Close();
+
+      EXPECT_GT( io->writeCount, 0 );
+      EXPECT_EQ( data->size() % 1024, 0u );
+   }
+
+   auto io = std::make_shared<MemoryIO>( data );
+
+   e57::Reader reader( io, {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsFloat pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   vectorReader.close();
+
+   for ( int64_t i = 0; i < cNumPoints; i += 997 )
+   {
+      ASSERT_EQ( pointsData.cartesianX[i], static_cast<float>( i ) );
+      ASSERT_EQ( pointsData.cartesianY[i], static_cast<float>( i ) * 0.5f );
+      ASSERT_EQ( pointsData.cartesianZ[i], -static_cast<float>( i ) );
+   }
+
+   EXPECT_GT( io->readCount, 0 );
+   EXPECT_EQ( reader.GetRawIMF().fileName(), "memory" );
+
+   reader.Close();
+}
+
+// Point data read through an ImageFileIO should be fetched in a few large requests.
+TEST( SimpleWriter, ImageFileIORangeReads )
+{
+   constexpr int64_t cNumPoints = 1'000'000;
+
+   auto data = std::make_shared<std::vector<char>>();
+
+   {
+      e57::Writer writer( std::make_shared<MemoryIO>( data ), {} );
+
+      e57::Data3D header;
+      header.guid = "ImageFileIORangeReads Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = static_cast<float>( i % 1000 );
+         pointsData.cartesianZ[i] = -static_cast<float>( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+      writer.Close();
+   }
+
+   // Returns the number of reads made
+   auto readPoints = [&]( unsigned rangeReadsInFlight ) {
+      auto io = std::make_shared<MemoryIO>( data );
+      io->maxReadSize = data->size();
+
+      e57::ReaderOptions options;
+      options.rangeReadSize = 4 * 1024 * 1024;
+      options.rangeReadsInFlight = rangeReadsInFlight;
+
+      e57::Reader reader( io, options );
+
+      e57::Data3D header;
+      EXPECT_TRUE( reader.ReadData3D( 0, header ) );
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+      EXPECT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+      vectorReader.close();
+
+      for ( int64_t i = 0; i < cNumPoints; i += 997 )
+      {
+         EXPECT_EQ( pointsData.cartesianX[i], static_cast<float>( i ) );
+         EXPECT_EQ( pointsData.cartesianY[i], static_cast<float>( i % 1000 ) );
+         EXPECT_EQ( pointsData.cartesianZ[i], -static_cast<float>( i ) );
+      }
+
+      reader.Close();
+
+      return io->readCount.load();
+   };
+
+   const int directReads = readPoints( 0 );
+   const int rangeReads = readPoints( 3 );
+
+   EXPECT_GT( directReads, 100 );
+   EXPECT_LT( rangeReads * 10, directReads );
+}
+
+// Reads parts of a large blob back, both while it is being written (from the file) and after
+// (from memory), starting and ending in and between pages.
+TEST( SimpleWriter, BlobReadBack )
+{
+   constexpr int64_t cBlobSize = 5'000'000;
+
+   std::vector<uint8_t> data( cBlobSize );
+   for ( int64_t i = 0; i < cBlobSize; ++i )
+   {
+      data[i] = static_cast<uint8_t>( ( i * 7 ) ^ ( i >> 11 ) );
+   }
+
+   const std::vector<std::pair<int64_t, size_t>> cRanges = {
+      { 0, cBlobSize }, { 1, 1'019 }, { 1'000, 2'048 }, { 3, 4'500'001 }, { 4'999'000, 1'000 },
+   };
+
+   auto checkRanges = [&]( e57::BlobNode &blob ) {
+      for ( const auto &range : cRanges )
+      {
+         std::vector<uint8_t> buffer( range.second );
+         blob.read( buffer.data(), range.first, range.second );
+
+         ASSERT_TRUE( std::equal( buffer.begin(), buffer.end(), data.begin() + range.first ) )
+            << "start=" << range.first << " count=" << range.second;
+      }
+   };
+
+   {
+      e57::ImageFile imf( "./BlobReadBack.e57", "w" );
+
+      e57::BlobNode blob( imf, cBlobSize );
+      imf.root().set( "blob", blob );
+
+      blob.write( data.data(), 0, cBlobSize );
+
+      checkRanges( blob );
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./BlobReadBack.e57", "r" );
+
+   e57::BlobNode blob( imf.root().get( "blob" ) );
+
+   checkRanges( blob );
+
+   imf.close();
+}
+
+// Checks adding a scan to an existing file in update mode, and putting it back with cancel().
+TEST( SimpleWriter, UpdateMode )
+{
+   constexpr int64_t cNumPoints = 30'000;
+   constexpr size_t cNumAdded = 12'345;
+   const char *cFileName = "./UpdateMode.e57";
+
+   {
+      e57::Writer writer( cFileName, e57::WriterOptions() );
+
+      e57::Data3D header;
+      header.guid = "Update Mode Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      e57::Data3DPointsDouble pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<double>( i );
+         pointsData.cartesianY[i] = static_cast<double>( i ) * 0.5;
+         pointsData.cartesianZ[i] = -static_cast<double>( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   auto fileContents = []( const char *fileName ) {
+      std::ifstream file( fileName, std::ifstream::binary );
+      return std::vector<char>( std::istreambuf_iterator<char>( file ),
+                                std::istreambuf_iterator<char>() );
+   };
+
+   const std::vector<char> original = fileContents( cFileName );
+
+   std::vector<double> added( cNumAdded );
+
+   for ( size_t i = 0; i < cNumAdded; ++i )
+   {
+      added[i] = static_cast<double>( i ) * 0.25;
+   }
+
+   auto addScan = [&]( e57::ImageFile &imf ) {
+      e57::VectorNode data3D( imf.root().get( "/data3D" ) );
+
+      // What was in the file can't be written again
+      e57::CompressedVectorNode existing( imf.root().get( "/data3D/0/points" ) );
+      std::vector<e57::SourceDestBuffer> existingBuffers;
+      existingBuffers.emplace_back( imf, "cartesianX", added.data(), cNumAdded, true );
+      existingBuffers.emplace_back( imf, "cartesianY", added.data(), cNumAdded, true );
+      existingBuffers.emplace_back( imf, "cartesianZ", added.data(), cNumAdded, true );
+
+      E57_ASSERT_THROW( existing.writer( existingBuffers ) );
+
+      e57::StructureNode scan( imf );
+      scan.set( "guid", e57::StringNode( imf, "Added Scan GUID" ) );
+      data3D.append( scan );
+
+      e57::StructureNode proto( imf );
+      proto.set( "cartesianX", e57::FloatNode( imf, 0.0 ) );
+      proto.set( "cartesianY", e57::FloatNode( imf, 0.0 ) );
+      proto.set( "cartesianZ", e57::FloatNode( imf, 0.0 ) );
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      scan.set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "cartesianX", added.data(), cNumAdded, true );
+      sbufs.emplace_back( imf, "cartesianY", added.data(), cNumAdded, true );
+      sbufs.emplace_back( imf, "cartesianZ", added.data(), cNumAdded, true );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumAdded );
+      writer.close();
+   };
+
+   // Cancelling leaves the file as it was
+   {
+      e57::ImageFile imf( cFileName, "a" );
+      ASSERT_TRUE( imf.isWritable() );
+
+      addScan( imf );
+
+      imf.cancel();
+   }
+
+   ASSERT_TRUE( fileContents( cFileName ) == original );
+
+   {
+      e57::ImageFile imf( cFileName, "a" );
+
+      addScan( imf );
+
+      imf.close();
+   }
+
+   // Only the header page was written to, everything else was added after it
+   const std::vector<char> updated = fileContents( cFileName );
+
+   ASSERT_GT( updated.size(), original.size() );
+   EXPECT_TRUE( std::equal( original.begin() + 1024, original.end(), updated.begin() + 1024 ) );
+
+   e57::Reader reader( cFileName, e57::ReaderOptions() );
+
+   ASSERT_EQ( reader.GetData3DCount(), 2 );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   EXPECT_EQ( pointsData.cartesianY[12'345], 12'345.0 * 0.5 );
+   EXPECT_EQ( pointsData.cartesianZ[cNumPoints - 1], -static_cast<double>( cNumPoints - 1 ) );
+
+   vectorReader.close();
+
+   ASSERT_TRUE( reader.ReadData3D( 1, header ) );
+   ASSERT_EQ( header.guid, "Added Scan GUID" );
+   ASSERT_EQ( header.pointCount, static_cast<int64_t>( cNumAdded ) );
+
+   e57::Data3DPointsDouble addedData( header );
+
+   vectorReader = reader.SetUpData3DPointsData( 1, cNumAdded, addedData );
+
+   ASSERT_EQ( vectorReader.read(), cNumAdded );
+
+   for ( size_t i = 0; i < cNumAdded; ++i )
+   {
+      ASSERT_EQ( addedData.cartesianX[i], added[i] ) << "i=" << i;
+   }
+
+   vectorReader.close();
+}
+
+// Checks changing the values of existing nodes in update mode.
+TEST( SimpleWriter, UpdateMetadata )
+{
+   constexpr int64_t cNumPoints = 10'000;
+   const char *cFileName = "./UpdateMetadata.e57";
+
+   {
+      e57::Writer writer( cFileName, e57::WriterOptions() );
+
+      e57::Data3D header;
+      header.guid = "Update Metadata Header GUID";
+      header.name = "Unregistered";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pose.translation.x = 1.0;
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = static_cast<float>( i );
+         pointsData.cartesianY[i] = 0.0f;
+         pointsData.cartesianZ[i] = -static_cast<float>( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+   }
+
+   {
+      e57::ImageFile imf( cFileName, "r" );
+
+      e57::StringNode name( imf.root().get( "/data3D/0/name" ) );
+      E57_ASSERT_THROW( name.setValue( "Registered" ) );
+
+      imf.close();
+   }
+
+   const int64_t originalSize = Helpers::FileSize( cFileName );
+
+   {
+      e57::ImageFile imf( cFileName, "a" );
+
+      e57::FloatNode x( imf.root().get( "/data3D/0/pose/translation/x" ) );
+      x.setValue( 123.25 );
+
+      e57::StringNode name( imf.root().get( "/data3D/0/name" ) );
+      name.setValue( "Registered" );
+
+      e57::IntegerNode versionMinor( imf.root().get( "/versionMinor" ) );
+      versionMinor.setValue( versionMinor.value() );
+
+      imf.close();
+   }
+
+   const int64_t updatedSize = Helpers::FileSize( cFileName );
+
+   // Only a new XML section was added
+   EXPECT_GT( updatedSize, originalSize );
+   EXPECT_LT( updatedSize - originalSize, originalSize / 4 );
+
+   e57::Reader reader( cFileName, e57::ReaderOptions() );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   EXPECT_EQ( header.name, "Registered" );
+   EXPECT_EQ( header.guid, "Update Metadata Header GUID" );
+   EXPECT_EQ( header.pose.translation.x, 123.25 );
+   ASSERT_EQ( header.pointCount, cNumPoints );
+
+   e57::Data3DPointsFloat pointsData( header );
+
+   auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+   ASSERT_EQ( vectorReader.read(), static_cast<unsigned>( cNumPoints ) );
+   EXPECT_EQ( pointsData.cartesianX[cNumPoints - 1], static_cast<float>( cNumPoints - 1 ) );
+
+   vectorReader.close();
+}
+
+// Checks copying the data packets of a CompressedVector into another file.
+TEST( SimpleWriter, CopyPackets )
+{
+   constexpr size_t cNumRecords = 300'000;
+
+   std::vector<double> x( cNumRecords );
+   std::vector<double> y( cNumRecords );
+   std::vector<int64_t> intensity( cNumRecords );
+
+   for ( size_t i = 0; i < cNumRecords; ++i )
+   {
+      x[i] = static_cast<double>( i % 1'000'000 ) * 0.001 - 500.0;
+      y[i] = std::sin( static_cast<double>( i ) );
+      intensity[i] = static_cast<int64_t>( ( i * 37 ) % 4'096 );
+   }
+
+   auto makePoints = []( e57::ImageFile &imf, int64_t intensityMaximum ) {
+      e57::StructureNode proto( imf );
+      proto.set( "cartesianX", e57::ScaledIntegerNode( imf, 0, -1'000'000, 1'000'000, 0.001 ) );
+      proto.set( "cartesianY", e57::FloatNode( imf, 0.0 ) );
+      proto.set( "intensity", e57::IntegerNode( imf, 0, 0, intensityMaximum ) );
+
+      return e57::CompressedVectorNode( imf, proto, e57::VectorNode( imf, true ) );
+   };
+
+   auto makeBuffers = [&]( e57::ImageFile &imf ) {
+      std::vector<e57::SourceDestBuffer> buffers;
+      buffers.emplace_back( imf, "cartesianX", x.data(), cNumRecords, true, true );
+      buffers.emplace_back( imf, "cartesianY", y.data(), cNumRecords, true );
+      buffers.emplace_back( imf, "intensity", intensity.data(), cNumRecords, true );
+      return buffers;
+   };
+
+   {
+      e57::ImageFile imf( "./CopyPacketsSource.e57", "w" );
+
+      e57::CompressedVectorNode points = makePoints( imf, 4'095 );
+      imf.root().set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs = makeBuffers( imf );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumRecords );
+      writer.close();
+
+      imf.close();
+   }
+
+   {
+      e57::ImageFile source( "./CopyPacketsSource.e57", "r" );
+      e57::ImageFile imf( "./CopyPackets.e57", "w" );
+
+      e57::CompressedVectorNode sourcePoints( source.root().get( "points" ) );
+
+      // The fields have to be encoded the same way
+      e57::CompressedVectorNode other = makePoints( imf, 65'535 );
+      imf.root().set( "other", other );
+
+      E57_ASSERT_THROW( other.copyPacketsFrom( sourcePoints ) );
+
+      e57::CompressedVectorNode points = makePoints( imf, 4'095 );
+      imf.root().set( "points", points );
+
+      points.copyPacketsFrom( sourcePoints );
+
+      EXPECT_EQ( points.childCount(), static_cast<int64_t>( cNumRecords ) );
+
+      source.close();
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./CopyPackets.e57", "r" );
+
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+   ASSERT_EQ( points.childCount(), static_cast<int64_t>( cNumRecords ) );
+
+   std::vector<double> readX( cNumRecords );
+   std::vector<double> readY( cNumRecords );
+   std::vector<int64_t> readIntensity( cNumRecords );
+
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "cartesianX", readX.data(), cNumRecords, true, true );
+   dbufs.emplace_back( imf, "cartesianY", readY.data(), cNumRecords, true );
+   dbufs.emplace_back( imf, "intensity", readIntensity.data(), cNumRecords, true );
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+
+   ASSERT_EQ( reader.read(), cNumRecords );
+
+   for ( size_t i = 0; i < cNumRecords; ++i )
+   {
+      ASSERT_NEAR( readX[i], x[i], 0.0005 ) << "i=" << i;
+      ASSERT_EQ( readY[i], y[i] ) << "i=" << i;
+      ASSERT_EQ( readIntensity[i], intensity[i] ) << "i=" << i;
+   }
+
+   // The index was copied too
+   constexpr size_t cSeekRecord = 270'001;
+
+   reader.seek( cSeekRecord );
+
+   ASSERT_GT( reader.read(), 0U );
+   EXPECT_EQ( readIntensity[0], intensity[cSeekRecord] );
+
+   reader.close();
+   imf.close();
+}
+
+// Checks that the validation level decides which values are checked as they are written and read.
+TEST( SimpleWriter, ValidationLevel )
+{
+   constexpr int64_t cNumPoints = 10'000;
+
+   // The limit of 3000 needs 12 bits, so the intensity of 4000 at this index fits them but is
+   // outside the limits
+   constexpr int64_t cOutOfLimits = 4'321;
+
+   auto write = [&]( const char *fileName, e57::ValidationLevel level ) {
+      Helpers::WriteScan<e57::Data3DPointsFloat>(
+         fileName, "ValidationLevel", cNumPoints,
+         [=]( e57::WriterOptions &options ) { options.validationLevel = level; },
+         []( e57::Data3D &header ) {
+            header.pointFields.intensityField = true;
+            header.pointFields.intensityNodeType = e57::NumericalNodeType::Integer;
+            header.intensityLimits.intensityMaximum = 3'000;
+         },
+         [&]( e57::Data3DPointsFloat &pointsData, int64_t i ) {
+            pointsData.cartesianX[i] = static_cast<float>( i );
+            pointsData.cartesianY[i] = 1.0f;
+            pointsData.cartesianZ[i] = 2.0f;
+            pointsData.intensity[i] =
+               static_cast<float>( ( i == cOutOfLimits ) ? 4'000 : i % 3'000 );
+         } );
+   };
+
+   E57_ASSERT_THROW( write( "./ValidationLevel.e57", e57::ValidationBasic ) );
+
+   // A trusted writer doesn't check the limits
+   E57_ASSERT_NO_THROW( write( "./ValidationLevel.e57", e57::ValidationNone ) );
+
+   auto read = []( e57::ValidationLevel level ) {
+      e57::ReaderOptions options;
+      options.validationLevel = level;
+
+      e57::Reader reader( "./ValidationLevel.e57", options );
+
+      e57::Data3D header;
+      reader.ReadData3D( 0, header );
+
+      e57::Data3DPointsFloat pointsData( header );
+
+      auto vectorReader = reader.SetUpData3DPointsData( 0, cNumPoints, pointsData );
+      const uint64_t readCount = vectorReader.read();
+      vectorReader.close();
+
+      EXPECT_EQ( readCount, static_cast<uint64_t>( cNumPoints ) );
+      EXPECT_EQ( pointsData.cartesianX[cNumPoints - 1], static_cast<float>( cNumPoints - 1 ) );
+
+      return pointsData.intensity[cOutOfLimits];
+   };
+
+   EXPECT_EQ( read( e57::ValidationNone ), 4'000.0f );
+   EXPECT_EQ( read( e57::ValidationBasic ), 4'000.0f );
+
+   // Only the deep checks look at every value read
+   E57_ASSERT_THROW( read( e57::ValidationDeep ) );
+}
+
+// Checks writing from and reading into buffer sets which are only checked once.
+TEST( SimpleWriter, BufferSets )
+{
+   constexpr size_t cBufferSize = 10'000;
+   constexpr size_t cNumBatches = 7;
+
+   std::vector<double> x[2] = { std::vector<double>( cBufferSize ),
+                                std::vector<double>( cBufferSize ) };
+   std::vector<int64_t> intensity[2] = { std::vector<int64_t>( cBufferSize ),
+                                         std::vector<int64_t>( cBufferSize ) };
+
+   {
+      e57::ImageFile imf( "./BufferSets.e57", "w" );
+
+      e57::StructureNode proto( imf );
+      proto.set( "cartesianX", e57::FloatNode( imf, 0.0 ) );
+      proto.set( "intensity", e57::IntegerNode( imf, 0, 0, 1'000'000 ) );
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs[2];
+
+      for ( int i = 0; i < 2; ++i )
+      {
+         sbufs[i].emplace_back( imf, "cartesianX", x[i].data(), cBufferSize, true );
+         sbufs[i].emplace_back( imf, "intensity", intensity[i].data(), cBufferSize, true );
+      }
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs[0] );
+
+      ASSERT_EQ( writer.addBufferSet( sbufs[0] ), 0U );
+      ASSERT_EQ( writer.addBufferSet( sbufs[1] ), 1U );
+
+      E57_ASSERT_THROW( writer.useBufferSet( 2 ) );
+
+      // A set has to hold the same fields
+      std::vector<e57::SourceDestBuffer> other;
+      other.emplace_back( imf, "cartesianX", x[0].data(), cBufferSize, true );
+      E57_ASSERT_THROW( writer.addBufferSet( other ) );
+
+      for ( size_t batch = 0; batch < cNumBatches; ++batch )
+      {
+         const size_t current = batch % 2;
+
+         for ( size_t i = 0; i < cBufferSize; ++i )
+         {
+            const size_t record = batch * cBufferSize + i;
+
+            x[current][i] = static_cast<double>( record ) * 0.25;
+            intensity[current][i] = static_cast<int64_t>( record );
+         }
+
+         writer.useBufferSet( static_cast<unsigned>( current ) );
+         writer.write( cBufferSize );
+      }
+
+      writer.close();
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./BufferSets.e57", "r" );
+
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+   ASSERT_EQ( points.childCount(), static_cast<int64_t>( cBufferSize * cNumBatches ) );
+
+   std::vector<e57::SourceDestBuffer> dbufs[2];
+
+   for ( int i = 0; i < 2; ++i )
+   {
+      dbufs[i].emplace_back( imf, "cartesianX", x[i].data(), cBufferSize, true );
+      dbufs[i].emplace_back( imf, "intensity", intensity[i].data(), cBufferSize, true );
+   }
+
+   e57::CompressedVectorReader reader = points.reader( dbufs[0] );
+
+   ASSERT_EQ( reader.addBufferSet( dbufs[0] ), 0U );
+   ASSERT_EQ( reader.addBufferSet( dbufs[1] ), 1U );
+
+   size_t record = 0;
+
+   for ( size_t batch = 0;; ++batch )
+   {
+      const size_t current = ( batch + 1 ) % 2;
+
+      reader.useBufferSet( static_cast<unsigned>( current ) );
+
+      const unsigned count = reader.read();
+
+      for ( unsigned i = 0; i < count; ++i, ++record )
+      {
+         ASSERT_EQ( x[current][i], static_cast<double>( record ) * 0.25 );
+         ASSERT_EQ( intensity[current][i], static_cast<int64_t>( record ) );
+      }
+
+      if ( count < cBufferSize )
+      {
+         break;
+      }
+   }
+
+   EXPECT_EQ( record, cBufferSize * cNumBatches );
+
+   reader.close();
+   E57_ASSERT_THROW( reader.useBufferSet( 0 ) );
+
+   imf.close();
+}
+
+// Fill one set of buffers while the other one is written in the background
+TEST( SimpleWriter, WriteAsync )
+{
+   constexpr size_t cBufferSize = 10'000;
+   constexpr size_t cNumBatches = 7;
+
+   std::vector<double> x[2] = { std::vector<double>( cBufferSize ),
+                                std::vector<double>( cBufferSize ) };
+   std::vector<int64_t> intensity[2] = { std::vector<int64_t>( cBufferSize ),
+                                         std::vector<int64_t>( cBufferSize ) };
+
+   {
+      e57::ImageFile imf( "./WriteAsync.e57", "w" );
+
+      e57::StructureNode proto( imf );
+      proto.set( "cartesianX", e57::FloatNode( imf, 0.0 ) );
+      proto.set( "intensity", e57::IntegerNode( imf, 0, 0, 1'000'000 ) );
+
+      e57::CompressedVectorNode points( imf, proto, e57::VectorNode( imf, true ) );
+      imf.root().set( "points", points );
+
+      std::vector<e57::SourceDestBuffer> sbufs[2];
+
+      for ( int i = 0; i < 2; ++i )
+      {
+         sbufs[i].emplace_back( imf, "cartesianX", x[i].data(), cBufferSize, true );
+         sbufs[i].emplace_back( imf, "intensity", intensity[i].data(), cBufferSize, true );
+      }
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs[0] );
+
+      std::future<void> pending[2];
+
+      for ( size_t batch = 0; batch < cNumBatches; ++batch )
+      {
+         const size_t current = batch % 2;
+
+         // The buffers can only be filled again once their last write is done
+         if ( pending[current].valid() )
+         {
+            pending[current].get();
+         }
+
+         for ( size_t i = 0; i < cBufferSize; ++i )
+         {
+            const size_t record = batch * cBufferSize + i;
+
+            x[current][i] = static_cast<double>( record ) * 0.25;
+            intensity[current][i] = static_cast<int64_t>( record );
+         }
+
+         pending[current] = writer.writeAsync( sbufs[current], cBufferSize );
+      }
+
+      // A plain write waits for the ones in the background first
+      pending[0].get();
+
+      x[0][0] = static_cast<double>( cBufferSize * cNumBatches ) * 0.25;
+      intensity[0][0] = static_cast<int64_t>( cBufferSize * cNumBatches );
+      writer.write( sbufs[0], 1 );
+
+      EXPECT_EQ( pending[1].wait_for( std::chrono::seconds( 0 ) ), std::future_status::ready );
+      pending[1].get();
+
+      writer.close();
+
+      E57_ASSERT_THROW( writer.writeAsync( sbufs[0], 1 ).get() );
+
+      imf.close();
+   }
+
+   constexpr size_t cNumRecords = cBufferSize * cNumBatches + 1;
+
+   e57::ImageFile imf( "./WriteAsync.e57", "r" );
+
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+   ASSERT_EQ( points.childCount(), static_cast<int64_t>( cNumRecords ) );
+
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "cartesianX", x[0].data(), cBufferSize, true );
+   dbufs.emplace_back( imf, "intensity", intensity[0].data(), cBufferSize, true );
+
+   e57::CompressedVectorReader reader = points.reader( dbufs );
+
+   size_t record = 0;
+
+   while ( const unsigned count = reader.read() )
+   {
+      for ( unsigned i = 0; i < count; ++i, ++record )
+      {
+         ASSERT_EQ( x[0][i], static_cast<double>( record ) * 0.25 );
+         ASSERT_EQ( intensity[0][i], static_cast<int64_t>( record ) );
+      }
+   }
+
+   EXPECT_EQ( record, cNumRecords );
+
+   reader.close();
+   imf.close();
+}
+
+// Read many small scans with the same fields into the same buffers using one reader
+TEST( SimpleWriter, RestartReader )
+{
+   constexpr int64_t cNumScans = 40;
+   constexpr size_t cBufferSize = 256;
+
+   auto scanPointCount = []( int64_t scan ) { return 100 + scan * 37; };
+
+   {
+      e57::Writer writer( "./RestartReader.e57", e57::WriterOptions() );
+
+      e57::Data3D header;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::Double;
+
+      for ( int64_t scan = 0; scan < cNumScans + 2; ++scan )
+      {
+         header.guid = "Restart Reader Scan " + std::to_string( scan ) + " GUID";
+         header.pointCount = scanPointCount( scan );
+
+         // The last two differ from the others: one has more fields, the other a pose
+         if ( scan == cNumScans )
+         {
+            header.pointFields.intensityField = true;
+            header.intensityLimits.intensityMaximum = 1.0;
+         }
+         else if ( scan == cNumScans + 1 )
+         {
+            header.pointFields.intensityField = false;
+            header.pose.translation.x = 1.0;
+         }
+
+         e57::Data3DPointsDouble points( header );
+
+         for ( int64_t i = 0; i < header.pointCount; ++i )
+         {
+            points.cartesianX[i] = static_cast<double>( scan * 1000 + i );
+            points.cartesianY[i] = static_cast<double>( i );
+            points.cartesianZ[i] = static_cast<double>( scan );
+         }
+
+         writer.WriteData3DData( header, points );
+      }
+   }
+
+   e57::ReaderOptions options;
+   options.applyPose = true;
+
+   e57::Reader reader( "./RestartReader.e57", options );
+
+   e57::Data3D header;
+   reader.ReadData3D( 0, header );
+   header.pointCount = cBufferSize;
+
+   e57::Data3DPointsDouble points( header );
+
+   e57::CompressedVectorReader vectorReader =
+      reader.SetUpData3DPointsData( 0, cBufferSize, points );
+
+   for ( int64_t scan = 0; scan < cNumScans; ++scan )
+   {
+      if ( scan > 0 )
+      {
+         E57_ASSERT_NO_THROW( reader.RestartData3DPointsData( scan, vectorReader ) );
+      }
+
+      int64_t pointCount = 0;
+      unsigned count = 0;
+
+      while ( ( count = vectorReader.read() ) > 0 )
+      {
+         for ( unsigned i = 0; i < count; ++i, ++pointCount )
+         {
+            ASSERT_EQ( points.cartesianX[i], static_cast<double>( scan * 1000 + pointCount ) );
+            ASSERT_EQ( points.cartesianY[i], static_cast<double>( pointCount ) );
+            ASSERT_EQ( points.cartesianZ[i], static_cast<double>( scan ) );
+         }
+      }
+
+      ASSERT_EQ( pointCount, scanPointCount( scan ) );
+   }
+
+   // Part way through a scan is fine too
+   vectorReader.seek( 50 );
+   reader.RestartData3DPointsData( 5, vectorReader );
+
+   ASSERT_EQ( vectorReader.read(), cBufferSize );
+   EXPECT_EQ( points.cartesianX[0], 5000.0 );
+
+   E57_ASSERT_THROW( reader.RestartData3DPointsData( cNumScans, vectorReader ) );
+   E57_ASSERT_THROW( reader.RestartData3DPointsData( cNumScans + 1, vectorReader ) );
+
+   vectorReader.close();
+   E57_ASSERT_THROW( reader.RestartData3DPointsData( 1, vectorReader ) );
+}
+
+TEST( SimpleWriter, ZoneMap )
+{
+   constexpr int64_t cNumPoints = 100'000;
+   constexpr int64_t cZonePointCount = 4'096;
+
+   {
+      e57::WriterOptions options;
+      options.zoneMapPointCount = -1;
+
+      E57_ASSERT_THROW( e57::Writer( "./ZoneMap.e57", options ) );
+   }
+
+   auto writeFile = [&]( const char *fileName, int64_t zoneMapPointCount ) {
+      e57::WriterOptions options;
+      options.zoneMapPointCount = zoneMapPointCount;
+
+      e57::Writer writer( fileName, options );
+
+      e57::Data3D header;
+      header.guid = "Zone Map Scan GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.intensityField = true;
+      header.intensityLimits.intensityMaximum = 100.0;
+
+      e57::Data3DPointsDouble points( header );
+
+      // A line along x, which is what a scanner moving along a road sees
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         points.cartesianX[i] = static_cast<double>( i ) * 0.01;
+         points.cartesianY[i] = std::sin( static_cast<double>( i ) );
+         points.cartesianZ[i] = 0.0;
+         points.intensity[i] = static_cast<double>( i % 100 );
+      }
+
+      writer.WriteData3DData( header, points );
+   };
+
+   writeFile( "./ZoneMap.e57", cZonePointCount );
+   writeFile( "./ZoneMapNone.e57", 0 );
+
+   e57::Reader reader( "./ZoneMap.e57", e57::ReaderOptions() );
+
+   std::vector<e57::Data3DZone> zones;
+   ASSERT_TRUE( reader.ReadData3DZones( 0, zones ) );
+   ASSERT_EQ( zones.size(), 25U );
+
+   EXPECT_EQ( zones[3].firstPoint, 3 * cZonePointCount );
+   EXPECT_EQ( zones[3].pointCount, cZonePointCount );
+   EXPECT_NEAR( zones[3].cartesianBounds.xMinimum, 3 * cZonePointCount * 0.01, 0.001 );
+   EXPECT_NEAR( zones[3].cartesianBounds.xMaximum, ( 4 * cZonePointCount - 1 ) * 0.01, 0.001 );
+   EXPECT_EQ( zones[3].intensityMinimum, 0.0 );
+   EXPECT_EQ( zones[3].intensityMaximum, 99.0 );
+   EXPECT_EQ( zones[24].pointCount, cNumPoints - 24 * cZonePointCount );
+
+   e57::CartesianBounds box;
+   box.xMinimum = 500.0;
+   box.xMaximum = 510.0;
+
+   const std::vector<e57::Data3DZone> found = reader.FindData3DZones( 0, box );
+   ASSERT_EQ( found.size(), 1U );
+   EXPECT_EQ( found[0].firstPoint, 12 * cZonePointCount );
+
+   // Read the points in the box, starting with the zone
+   e57::Data3D header;
+   reader.ReadData3D( 0, header );
+   header.pointCount = cZonePointCount;
+
+   e57::Data3DPointsDouble points( header );
+
+   e57::CompressedVectorReader vectorReader =
+      reader.SetUpData3DPointsData( 0, cZonePointCount, points );
+
+   vectorReader.setRecordFilters( { { "cartesianX", box.xMinimum, box.xMaximum } } );
+   vectorReader.seek( found[0].firstPoint );
+
+   const unsigned count = vectorReader.read();
+   ASSERT_GE( count, 1000U );
+   ASSERT_LE( count, 1002U );
+
+   for ( unsigned i = 0; i < count; ++i )
+   {
+      ASSERT_GE( points.cartesianX[i], box.xMinimum );
+      ASSERT_LE( points.cartesianX[i], box.xMaximum );
+   }
+
+   vectorReader.close();
+
+   // Without a zone map, all the points may be in the box
+   e57::Reader readerNone( "./ZoneMapNone.e57", e57::ReaderOptions() );
+
+   EXPECT_FALSE( readerNone.ReadData3DZones( 0, zones ) );
+
+   const std::vector<e57::Data3DZone> all = readerNone.FindData3DZones( 0, box );
+   ASSERT_EQ( all.size(), 1U );
+   EXPECT_EQ( all[0].firstPoint, 0 );
+   EXPECT_EQ( all[0].pointCount, cNumPoints );
+}
+
+TEST( SimpleWriter, SpatialOrder )
+{
+   constexpr int64_t cNumPoints = 50'000;
+   constexpr int64_t cColumns = 1'000;
+   constexpr int64_t cRunPointCount = 20'000;
+   constexpr int64_t cZonePointCount = 1'000;
+
+   {
+      e57::WriterOptions options;
+      options.spatialOrderPointCount = -1;
+
+      E57_ASSERT_THROW( e57::Writer( "./SpatialOrder.e57", options ) );
+   }
+
+   e57::Data3D header;
+   header.guid = "Spatial Order Scan GUID";
+   header.pointCount = cNumPoints;
+   header.pointFields.cartesianXField = true;
+   header.pointFields.cartesianYField = true;
+   header.pointFields.cartesianZField = true;
+   header.pointFields.cartesianInvalidStateField = true;
+   header.pointFields.rowIndexField = true;
+   header.pointFields.rowIndexMaximum = cNumPoints / cColumns - 1;
+   header.pointFields.columnIndexField = true;
+   header.pointFields.columnIndexMaximum = cColumns - 1;
+
+   e57::Data3DPointsDouble points( header );
+
+   // Points scattered through a cube, in no useful order
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      const auto value = static_cast<double>( i );
+
+      points.cartesianX[i] = std::fmod( value * 0.6180339887, 1.0 ) * 10.0;
+      points.cartesianY[i] = std::fmod( value * 0.7548776662, 1.0 ) * 10.0;
+      points.cartesianZ[i] = std::fmod( value * 0.5698402910, 1.0 ) * 10.0;
+      points.cartesianInvalidState[i] = ( i % 100 == 0 ) ? 2 : 0;
+      points.rowIndex[i] = static_cast<int32_t>( i / cColumns );
+      points.columnIndex[i] = static_cast<int32_t>( i % cColumns );
+   }
+
+   auto writeFile = [&]( const char *fileName, int64_t spatialOrderPointCount ) {
+      e57::WriterOptions options;
+      options.spatialOrderPointCount = spatialOrderPointCount;
+      options.zoneMapPointCount = cZonePointCount;
+
+      e57::Writer writer( fileName, options );
+
+      e57::Data3D scanHeader = header;
+      writer.WriteData3DData( scanHeader, points );
+   };
+
+   writeFile( "./SpatialOrder.e57", cRunPointCount );
+   writeFile( "./SpatialOrderNone.e57", 0 );
+
+   // The buffers written from are left as they were
+   EXPECT_EQ( points.rowIndex[1234], 1 );
+   EXPECT_EQ( points.columnIndex[1234], 234 );
+
+   e57::Reader reader( "./SpatialOrder.e57", e57::ReaderOptions() );
+
+   e57::Data3D readHeader;
+   reader.ReadData3D( 0, readHeader );
+   ASSERT_EQ( readHeader.pointCount, cNumPoints );
+
+   e57::Data3DPointsDouble readPoints( readHeader );
+   ASSERT_TRUE( reader.ReadData3DPointsData( { 0 }, { &readPoints }, 1 ) );
+
+   // Every point is there, and rowIndex and columnIndex say where it came from
+   std::vector<bool> seen( cNumPoints, false );
+   int64_t moved = 0;
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      const int64_t original = readPoints.rowIndex[i] * cColumns + readPoints.columnIndex[i];
+
+      ASSERT_FALSE( seen[original] );
+      seen[original] = true;
+
+      if ( original != i )
+      {
+         ++moved;
+      }
+
+      // Each run keeps its own points
+      ASSERT_EQ( original / cRunPointCount, i / cRunPointCount );
+
+      ASSERT_EQ( readPoints.cartesianInvalidState[i], points.cartesianInvalidState[original] );
+
+      if ( points.cartesianInvalidState[original] == 0 )
+      {
+         ASSERT_NEAR( readPoints.cartesianX[i], points.cartesianX[original], 1e-9 );
+         ASSERT_NEAR( readPoints.cartesianY[i], points.cartesianY[original], 1e-9 );
+         ASSERT_NEAR( readPoints.cartesianZ[i], points.cartesianZ[original], 1e-9 );
+      }
+   }
+
+   EXPECT_GT( moved, cNumPoints / 2 );
+
+   // The invalid points are at the end of each run
+   EXPECT_EQ( readPoints.cartesianInvalidState[cRunPointCount - 1], 2 );
+   EXPECT_EQ( readPoints.cartesianInvalidState[cRunPointCount - cRunPointCount / 100], 2 );
+   EXPECT_EQ( readPoints.cartesianInvalidState[cRunPointCount - cRunPointCount / 100 - 1], 0 );
+
+   // The zones of the ordered points are much smaller than those of the points as given
+   auto zoneVolume = []( const char *fileName ) {
+      e57::Reader zoneReader( fileName, e57::ReaderOptions() );
+
+      std::vector<e57::Data3DZone> zones;
+      EXPECT_TRUE( zoneReader.ReadData3DZones( 0, zones ) );
+
+      double volume = 0.0;
+
+      for ( const auto &zone : zones )
+      {
+         const e57::CartesianBounds &bounds = zone.cartesianBounds;
+
+         volume += ( bounds.xMaximum - bounds.xMinimum ) * ( bounds.yMaximum - bounds.yMinimum ) *
+                   ( bounds.zMaximum - bounds.zMinimum );
+      }
+
+      return volume;
+   };
+
+   EXPECT_LT( zoneVolume( "./SpatialOrder.e57" ) * 4.0, zoneVolume( "./SpatialOrderNone.e57" ) );
+
+   // Ordering needs the cartesian coordinates
+   {
+      e57::WriterOptions options;
+      options.spatialOrderPointCount = cRunPointCount;
+
+      e57::Writer writer( "./SpatialOrder.e57", options );
+
+      e57::Data3D sphericalHeader;
+      sphericalHeader.guid = "Spatial Order Spherical Scan GUID";
+      sphericalHeader.pointCount = 10;
+      sphericalHeader.pointFields.sphericalRangeField = true;
+      sphericalHeader.pointFields.sphericalAzimuthField = true;
+      sphericalHeader.pointFields.sphericalElevationField = true;
+
+      e57::Data3DPointsDouble sphericalPoints( sphericalHeader );
+
+      E57_ASSERT_THROW( writer.WriteData3DData( sphericalHeader, sphericalPoints ) );
+   }
+}
+
+TEST( SimpleWriter, Preview )
+{
+   constexpr int64_t cNumPoints = 100'000;
+   constexpr int64_t cColumns = 1'000;
+   constexpr int64_t cPointInterval = 100;
+
+   {
+      e57::WriterOptions options;
+      options.previewPointInterval = -1;
+
+      E57_ASSERT_THROW( e57::Writer( "./Preview.e57", options ) );
+   }
+
+   auto writeFile = [&]( const char *fileName, int64_t previewPointInterval ) {
+      e57::WriterOptions options;
+      options.previewPointInterval = previewPointInterval;
+
+      e57::Writer writer( fileName, options );
+
+      e57::Data3D header;
+      header.guid = "Preview Scan GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = 0.001;
+      header.pointFields.rowIndexField = true;
+      header.pointFields.rowIndexMaximum = cNumPoints / cColumns - 1;
+      header.pointFields.columnIndexField = true;
+      header.pointFields.columnIndexMaximum = cColumns - 1;
+
+      e57::Data3DPointsDouble points( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         points.cartesianX[i] = static_cast<double>( i % cColumns ) * 0.01;
+         points.cartesianY[i] = static_cast<double>( i / cColumns ) * 0.01;
+         points.cartesianZ[i] = 1.0;
+         points.rowIndex[i] = static_cast<int32_t>( i / cColumns );
+         points.columnIndex[i] = static_cast<int32_t>( i % cColumns );
+      }
+
+      writer.WriteData3DData( header, points );
+   };
+
+   writeFile( "./Preview.e57", cPointInterval );
+   writeFile( "./PreviewNone.e57", 0 );
+
+   auto pointIndex = []( const e57::Data3DPointsDouble &points, int64_t i ) {
+      return points.rowIndex[i] * cColumns + points.columnIndex[i];
+   };
+
+   auto checkPoint = [&]( const e57::Data3DPointsDouble &points, int64_t i ) {
+      const int64_t index = pointIndex( points, i );
+
+      ASSERT_NEAR( points.cartesianX[i], static_cast<double>( index % cColumns ) * 0.01, 0.001 );
+      ASSERT_NEAR( points.cartesianY[i], static_cast<double>( index / cColumns ) * 0.01, 0.001 );
+   };
+
+   e57::Reader reader( "./Preview.e57", e57::ReaderOptions() );
+
+   e57::Data3D header;
+   reader.ReadData3D( 0, header );
+   header.pointCount = 2'000;
+
+   e57::Data3DPointsDouble points( header );
+
+   E57_ASSERT_THROW( reader.ReadData3DPreview( 0, -1, points ) );
+   E57_ASSERT_THROW( reader.ReadData3DPreview( 1, 2'000, points ) );
+
+   // One point of each run of cPointInterval points, in order
+   ASSERT_EQ( reader.ReadData3DPreview( 0, 2'000, points ), cNumPoints / cPointInterval );
+
+   for ( int64_t i = 0; i < cNumPoints / cPointInterval; ++i )
+   {
+      EXPECT_EQ( pointIndex( points, i ) / cPointInterval, i );
+      checkPoint( points, i );
+   }
+
+   // Not all in the same column
+   EXPECT_NE( pointIndex( points, 1 ) - pointIndex( points, 0 ), cPointInterval );
+
+   // A smaller preview is sampled from the stored one
+   ASSERT_EQ( reader.ReadData3DPreview( 0, 640, points ), 640 );
+
+   for ( int64_t i = 0; i < 640; ++i )
+   {
+      checkPoint( points, i );
+   }
+
+   EXPECT_GT( pointIndex( points, 639 ), cNumPoints * 9 / 10 );
+
+   // Without a stored preview, runs of points are sampled through the data block
+   e57::Reader readerNone( "./PreviewNone.e57", e57::ReaderOptions() );
+
+   const int64_t sampled = readerNone.ReadData3DPreview( 0, 1'000, points );
+   ASSERT_EQ( sampled, 992 );
+
+   for ( int64_t i = 0; i < sampled; ++i )
+   {
+      checkPoint( points, i );
+   }
+
+   EXPECT_EQ( pointIndex( points, 0 ), 0 );
+   EXPECT_EQ( pointIndex( points, 15 ), 15 );
+   EXPECT_GT( pointIndex( points, sampled - 1 ), cNumPoints * 9 / 10 );
+}
+
+TEST( SimpleWriter, RawCoordinates )
+{
+   constexpr int64_t cNumPoints = 5'000;
+   constexpr double cScale = 0.001;
+
+   auto rawX = []( int64_t i ) { return static_cast<int32_t>( i * 3 - 7'000 ); };
+   auto rawY = []( int64_t i ) { return static_cast<int32_t>( i % 100 ); };
+   auto rawZ = []( int64_t i ) { return static_cast<int32_t>( -i ); };
+
+   {
+      e57::WriterOptions options;
+      options.computeBounds = true;
+
+      e57::Writer writer( "./RawCoordinates.e57", options );
+
+      e57::Data3D header;
+      header.guid = "Raw Coordinates GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+      header.pointFields.pointRangeNodeType = e57::NumericalNodeType::ScaledInteger;
+      header.pointFields.pointRangeScale = cScale;
+
+      e57::Data3DPointsInt32 pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = rawX( i );
+         pointsData.cartesianY[i] = rawY( i );
+         pointsData.cartesianZ[i] = rawZ( i );
+      }
+
+      writer.WriteData3DData( header, pointsData );
+
+      // The range is worked out from the scaled coordinates
+      EXPECT_DOUBLE_EQ( header.pointFields.pointRangeMinimum, -7.0 );
+      EXPECT_DOUBLE_EQ( header.pointFields.pointRangeMaximum, 7.997 );
+
+      // Raw coordinates are only kept for ScaledIntegers
+      e57::Data3D floatHeader = header;
+      floatHeader.pointFields.pointRangeNodeType = e57::NumericalNodeType::Float;
+
+      E57_ASSERT_THROW( e57::Data3DPointsInt32 floatPoints( floatHeader ) );
+
+      floatHeader.guid = "Float Coordinates GUID";
+
+      e57::Data3DPointsFloat floatPoints( floatHeader );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         floatPoints.cartesianX[i] = floatPoints.cartesianY[i] = floatPoints.cartesianZ[i] = 1.0f;
+      }
+
+      writer.WriteData3DData( floatHeader, floatPoints );
+   }
+
+   e57::Reader reader( "./RawCoordinates.e57", {} );
+
+   e57::Data3D header;
+   ASSERT_TRUE( reader.ReadData3D( 0, header ) );
+
+   EXPECT_DOUBLE_EQ( header.cartesianBounds.xMinimum, -7.0 );
+   EXPECT_DOUBLE_EQ( header.cartesianBounds.xMaximum, 7.997 );
+   EXPECT_DOUBLE_EQ( header.cartesianBounds.zMinimum, -4.999 );
+
+   double scale = 0.0;
+   double offset = 1.0;
+
+   ASSERT_TRUE( reader.GetData3DScaling( 0, "cartesianX", scale, offset ) );
+   EXPECT_EQ( scale, cScale );
+   EXPECT_EQ( offset, 0.0 );
+
+   EXPECT_FALSE( reader.GetData3DScaling( 0, "intensity", scale, offset ) );
+   EXPECT_FALSE( reader.GetData3DScaling( 1, "cartesianX", scale, offset ) );
+
+   e57::Data3DPointsInt32 rawPoints( header );
+   e57::Data3DPointsDouble scaledPoints( header );
+
+   ASSERT_TRUE( reader.ReadData3DPointsData( { 0 }, { &rawPoints }, 1 ) );
+   ASSERT_TRUE( reader.ReadData3DPointsData( { 0 }, { &scaledPoints }, 1 ) );
+
+   bool matches = true;
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      matches = matches && ( rawPoints.cartesianX[i] == rawX( i ) ) &&
+                ( rawPoints.cartesianY[i] == rawY( i ) ) &&
+                ( rawPoints.cartesianZ[i] == rawZ( i ) ) &&
+                ( std::abs( scaledPoints.cartesianX[i] - rawX( i ) * scale ) < 1e-9 );
+   }
+
+   EXPECT_TRUE( matches );
+
+   // The second scan's coordinates aren't ScaledIntegers
+   e57::Data3D floatHeader;
+   ASSERT_TRUE( reader.ReadData3D( 1, floatHeader ) );
+
+   e57::Data3DPointsInt32 floatRaw;
+   floatRaw.cartesianX = rawPoints.cartesianX;
+
+   E57_ASSERT_THROW( reader.SetUpData3DPointsData( 1, cNumPoints, floatRaw ) );
+}
+
+// Checks writing and reading string fields with StringColumn buffers.
+TEST( SimpleWriter, StringColumns )
+{
+   constexpr size_t cNumRecords = 2'000;
+   constexpr size_t cBufferSize = 300;
+
+   // Empty, short, long (8 byte prefix), and longer than a decoder's input buffer
+   auto label = []( size_t record ) {
+      const size_t length = ( record % 10 == 0 ) ? 0 : ( record % 97 == 0 ) ? 3'000 : record % 200;
+      return std::string( length, static_cast<char>( 'a' + record % 26 ) ) +
+             std::to_string( record );
+   };
+
+   {
+      e57::ImageFile imf( "./StringColumns.e57", "w" );
+
+      e57::StructureNode proto( imf );
+      proto.set( "id", e57::IntegerNode( imf, 0, 0, cNumRecords ) );
+      proto.set( "label", e57::StringNode( imf ) );
+
+      e57::VectorNode codecs( imf, true );
+      e57::CompressedVectorNode points( imf, proto, codecs );
+      imf.root().set( "points", points );
+
+      std::vector<int64_t> ids( cNumRecords );
+      e57::StringColumn labels;
+
+      for ( size_t record = 0; record < cNumRecords; ++record )
+      {
+         const std::string string = label( record );
+
+         ids[record] = static_cast<int64_t>( record );
+         labels.append( string.data(), string.length() );
+      }
+
+      std::vector<e57::SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "id", ids.data(), cNumRecords );
+      sbufs.emplace_back( imf, "label", &labels, cNumRecords );
+
+      e57::CompressedVectorWriter writer = points.writer( sbufs );
+      writer.write( cNumRecords );
+      writer.close();
+
+      imf.close();
+   }
+
+   e57::ImageFile imf( "./StringColumns.e57", "r" );
+   e57::CompressedVectorNode points( imf.root().get( "points" ) );
+
+   std::vector<int64_t> ids( cBufferSize );
+   e57::StringColumn labels;
+
+   std::vector<e57::SourceDestBuffer> dbufs;
+   dbufs.emplace_back( imf, "id", ids.data(), cBufferSize );
+   dbufs.emplace_back( imf, "label", &labels, cBufferSize );
+
+   {
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+
+      size_t total = 0;
+      bool matches = true;
+
+      while ( const unsigned count = reader.read() )
+      {
+         ASSERT_EQ( labels.size(), count );
+
+         for ( size_t i = 0; i < count; ++i )
+         {
+            matches = matches && ( labels.at( i ) == label( total + i ) );
+         }
+
+         total += count;
+      }
+
+      EXPECT_EQ( total, cNumRecords );
+      EXPECT_TRUE( matches );
+
+      reader.close();
+   }
+
+   // Filtering out records compacts the column
+   {
+      e57::CompressedVectorReader reader = points.reader( dbufs );
+      reader.setRecordFilters( { { "id", 500.0, 1'499.0 } } );
+
+      size_t total = 0;
+      bool matches = true;
+
+      while ( const unsigned count = reader.read() )
+      {
+         ASSERT_EQ( labels.size(), count );
+
+         for ( size_t i = 0; i < count; ++i )
+         {
+            matches = matches && ( labels.at( i ) == label( static_cast<size_t>( ids[i] ) ) );
+         }
+
+         total += count;
+      }
+
+      EXPECT_EQ( total, 1'000 );
+      EXPECT_TRUE( matches );
+
+      reader.close();
+   }
+
+   imf.close();
+}
+
+TEST( SimpleWriter, Data3DProducer )
+{
+   constexpr size_t cNumPoints = 25'003;
+   constexpr size_t cBlockSize = 1'000;
+
+   e57::Data3D header;
+   header.guid = "Data3D Producer Scan GUID";
+   header.pointFields.cartesianXField = true;
+   header.pointFields.cartesianYField = true;
+   header.pointFields.cartesianZField = true;
+   header.pointFields.intensityField = true;
+   header.intensityLimits.intensityMinimum = 0.0;
+   header.intensityLimits.intensityMaximum = 1.0;
+
+   auto value = []( size_t i ) { return static_cast<float>( i % 1'000 ) * 0.01f; };
+
+   {
+      // Bounds are worked out from the blocks as they are written
+      e57::WriterOptions options;
+      options.computeBounds = true;
+
+      e57::Writer writer( "./Data3DProducer.e57", options );
+
+      e57::Data3D badHeader = header;
+
+      E57_ASSERT_THROW( writer.WriteData3DData(
+         badHeader, 0, []( e57::Data3DPointsFloat &, size_t ) -> size_t { return 0; } ) );
+
+      // Blocks of different sizes, as they might come from a scanner
+      size_t produced = 0;
+      size_t blocks = 0;
+
+      e57::Data3D scanHeader = header;
+
+      writer.WriteData3DData(
+         scanHeader, cBlockSize, [&]( e57::Data3DPointsFloat &block, size_t capacity ) {
+            EXPECT_EQ( capacity, cBlockSize );
+            EXPECT_NE( block.cartesianX, nullptr );
+            EXPECT_NE( block.intensity, nullptr );
+            EXPECT_EQ( block.colorRed, nullptr );
+
+            const size_t count =
+               std::min( { capacity, cNumPoints - produced, 1 + ( blocks++ * 397 ) % capacity } );
+
+            for ( size_t i = 0; i < count; ++i )
+            {
+               block.cartesianX[i] = value( produced + i );
+               block.cartesianY[i] = -value( produced + i );
+               block.cartesianZ[i] = 1.0f;
+               block.intensity[i] = static_cast<float>( ( produced + i ) % 2 );
+            }
+
+            produced += count;
+
+            return count;
+         } );
+
+      EXPECT_EQ( scanHeader.pointCount, cNumPoints );
+      EXPECT_GT( blocks, cNumPoints / cBlockSize );
+
+      // These fail after their scans were added
+      E57_ASSERT_THROW( writer.WriteData3DData(
+         badHeader, cBlockSize,
+         []( e57::Data3DPointsFloat &, size_t capacity ) { return capacity + 1; } ) );
+
+      // An exception thrown by the producer is passed on
+      e57::Data3D throwHeader = header;
+
+      EXPECT_THROW( writer.WriteData3DData( throwHeader, cBlockSize,
+                                            []( e57::Data3DPointsFloat &, size_t ) -> size_t {
+                                               throw std::runtime_error( "producer" );
+                                            } ),
+                    std::runtime_error );
+
+      writer.Close();
+   }
+
+   e57::Reader reader( "./Data3DProducer.e57", e57::ReaderOptions() );
+
+   e57::Data3D readHeader;
+   reader.ReadData3D( 0, readHeader );
+   ASSERT_EQ( readHeader.pointCount, cNumPoints );
+
+   EXPECT_FLOAT_EQ( static_cast<float>( readHeader.cartesianBounds.xMaximum ), value( 999 ) );
+   EXPECT_FLOAT_EQ( static_cast<float>( readHeader.cartesianBounds.yMinimum ), -value( 999 ) );
+
+   e57::Data3DPointsFloat readPoints( readHeader );
+   ASSERT_TRUE( reader.ReadData3DPointsData( { 0 }, { &readPoints }, 1 ) );
+
+   bool matches = true;
+
+   for ( size_t i = 0; i < cNumPoints; ++i )
+   {
+      matches = matches && ( readPoints.cartesianX[i] == value( i ) ) &&
+                ( readPoints.cartesianY[i] == -value( i ) ) &&
+                ( readPoints.intensity[i] == static_cast<float>( i % 2 ) );
+   }
+
+   EXPECT_TRUE( matches );
+}
+
 TEST( SimpleWriterData, VisualRefImage )
 {
    e57::WriterOptions options;
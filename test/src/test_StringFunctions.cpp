@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include <clocale>
+#include <cmath>
 
 #include "gtest/gtest.h"
 
@@ -44,6 +45,16 @@ TEST( StringFunctions, FloatToStrConversion2 )
    ASSERT_EQ( converted, "1.23456e+05" );
 }
 
+TEST( StringFunctions, FloatToStrSignsAndExponents )
+{
+   EXPECT_EQ( e57::floatingPointToStr<double>( -0.0, 17 ), "-0" );
+   EXPECT_EQ( e57::floatingPointToStr<float>( -2.5f, 7 ), "-2.5" );
+   EXPECT_EQ( e57::floatingPointToStr<double>( 0.1, 17 ), "1.00000000000000006e-01" );
+   EXPECT_EQ( e57::floatingPointToStr<double>( 1e-300, 17 ), "1.00000000000000003e-300" );
+   EXPECT_EQ( e57::floatingPointToStr<double>( 1.5e100, 0 ), "1e+100" );
+   EXPECT_EQ( e57::floatingPointToStr<double>( -INFINITY, 17 ), "-inf" );
+}
+
 // Related to https://github.com/asmaloney/libE57Format/issues/172
 // Floating point should always use '.'.
 TEST( StringFunctions, FloatToStrLocale )
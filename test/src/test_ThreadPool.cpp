@@ -0,0 +1,62 @@
+// libE57Format testing Copyright © 2023 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <atomic>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "ThreadPool.h"
+
+TEST( ThreadPool, ParallelForCallsEachIndexOnce )
+{
+   e57::ThreadPool pool( 3 );
+
+   std::vector<std::atomic<int>> calls( 100 );
+
+   pool.parallelFor( calls.size(), [&]( size_t i ) { ++calls[i]; } );
+
+   for ( const auto &count : calls )
+   {
+      EXPECT_EQ( count, 1 );
+   }
+}
+
+TEST( ThreadPool, ParallelForRethrowsFirstException )
+{
+   e57::ThreadPool pool( 2 );
+
+   std::atomic<int> calls( 0 );
+
+   try
+   {
+      pool.parallelFor( 10, [&]( size_t i ) {
+         ++calls;
+
+         if ( ( i == 3 ) || ( i == 7 ) )
+         {
+            throw std::runtime_error( std::to_string( i ) );
+         }
+      } );
+
+      FAIL() << "Expected an exception";
+   }
+   catch ( const std::runtime_error &e )
+   {
+      EXPECT_STREQ( e.what(), "3" );
+   }
+
+   // All of the calls are made even though some of them failed
+   EXPECT_EQ( calls, 10 );
+}
+
+TEST( ThreadPool, Submit )
+{
+   e57::ThreadPool pool( 1 );
+
+   int value = 0;
+
+   pool.submit( [&] { value = 42; } ).get();
+
+   EXPECT_EQ( value, 42 );
+}
@@ -0,0 +1,143 @@
+// libE57Format testing Copyright © 2023 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "E57Exception.h"
+#include "E57XmlReader.h"
+
+namespace
+{
+   // Records the events from a parse as text, e.g. "<{uri}local|qName k=v>text</local>"
+   class RecordingHandler : public e57::E57XmlHandler
+   {
+   public:
+      void startElement( const e57::ustring &uri, const e57::ustring &localName,
+                         const e57::ustring &qName,
+                         const e57::E57XmlAttributes &attributes ) override
+      {
+         events += "<{" + uri + "}" + localName + "|" + qName;
+
+         for ( size_t i = 0; i < attributes.length(); ++i )
+         {
+            // The URI of xmlns attributes differs between parsers, so only look at the others.
+            if ( attributes.qName( i ).compare( 0, 5, "xmlns" ) == 0 )
+            {
+               continue;
+            }
+
+            events += " {" + attributes.uri( i ) + "}" + attributes.localName( i ) + "|" +
+                      attributes.qName( i ) + "=" + attributes.value( i );
+         }
+
+         events += ">";
+      }
+
+      void endElement( const e57::ustring &, const e57::ustring &localName,
+                       const e57::ustring & ) override
+      {
+         events += "</" + localName + ">";
+      }
+
+      void characters( const char *chars, size_t length ) override
+      {
+         events.append( chars, length );
+      }
+
+      e57::ustring events;
+   };
+
+   e57::ustring parse( const char *xml )
+   {
+      RecordingHandler handler;
+      e57::E57XmlReader reader( handler );
+
+      reader.parse( xml, std::strlen( xml ) );
+
+      return handler.events;
+   }
+
+   // Attribute lookup by qualified name, as used by E57XmlParser.
+   class FindHandler : public e57::E57XmlHandler
+   {
+   public:
+      void startElement( const e57::ustring &, const e57::ustring &, const e57::ustring &,
+                         const e57::E57XmlAttributes &attributes ) override
+      {
+         foundType = attributes.find( "type", type );
+         foundMissing = attributes.find( "missing", missing );
+      }
+
+      void endElement( const e57::ustring &, const e57::ustring &, const e57::ustring & ) override
+      {
+      }
+
+      void characters( const char *, size_t ) override
+      {
+      }
+
+      bool foundType = false;
+      bool foundMissing = false;
+      e57::ustring type;
+      e57::ustring missing;
+   };
+}
+
+TEST( XmlReader, ElementsAndNamespaces )
+{
+   const char *xml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<e57Root type="Structure" xmlns="http://www.astm.org/COMMIT/E57/2010-e57-v1.0"
+         xmlns:ext="urn:test"><name type="String"/><ext:a ext:k='v'>t</ext:a></e57Root>)";
+
+   EXPECT_EQ( parse( xml ), "<{http://www.astm.org/COMMIT/E57/2010-e57-v1.0}e57Root|e57Root"
+                            " {}type|type=Structure>"
+                            "<{http://www.astm.org/COMMIT/E57/2010-e57-v1.0}name|name"
+                            " {}type|type=String></name>"
+                            "<{urn:test}a|ext:a {urn:test}k|ext:k=v>t</a>"
+                            "</e57Root>" );
+}
+
+TEST( XmlReader, FindAttribute )
+{
+   const char *xml = R"(<e57Root type="Structure"/>)";
+
+   FindHandler handler;
+   e57::E57XmlReader reader( handler );
+
+   reader.parse( xml, std::strlen( xml ) );
+
+   EXPECT_TRUE( handler.foundType );
+   EXPECT_EQ( handler.type, "Structure" );
+   EXPECT_FALSE( handler.foundMissing );
+}
+
+TEST( XmlReader, References )
+{
+   const char *xml = R"(<a b="&lt;&amp;&gt; &quot;&apos;">1 &lt; 2 &#65;&#x42;&#xE9;</a>)";
+
+   EXPECT_EQ( parse( xml ), "<{}a|a {}b|b=<&> \"'>1 < 2 AB\xC3\xA9</a>" );
+}
+
+TEST( XmlReader, CDataAndComments )
+{
+   const char *xml = "<a><!-- <b/> --><![CDATA[<c>&amp;]]><?pi x?>d</a>";
+
+   EXPECT_EQ( parse( xml ), "<{}a|a><c>&amp;d</a>" );
+}
+
+TEST( XmlReader, LineEndings )
+{
+   const char *xml = "<a>1\r\n2\r3\n4</a>";
+
+   EXPECT_EQ( parse( xml ), "<{}a|a>1\n2\n3\n4</a>" );
+}
+
+TEST( XmlReader, MalformedThrows )
+{
+   EXPECT_THROW( parse( "<a><b></a>" ), e57::E57Exception );
+   EXPECT_THROW( parse( "<a>" ), e57::E57Exception );
+   EXPECT_THROW( parse( "<x:a/>" ), e57::E57Exception );
+}
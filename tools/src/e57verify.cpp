@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MIT
+
+// Check that E57 files are intact without decoding their points (see e57::ImageFile::verify()).
+// The exit status is 0 if all of them are (or for --help), 1 if any isn't, and 2 for bad
+// arguments.
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "E57Format.h"
+
+namespace
+{
+   void printUsage( std::ostream &os )
+   {
+      os << "Usage: e57verify [--threads <count>] [--] <file.e57>..." << std::endl
+         << "  --threads <count>  threads to use, 0 (the default) for one per hardware thread"
+         << std::endl
+         << "  -h, --help         show this help" << std::endl;
+   }
+
+   bool parseCount( const std::string &text, unsigned &count )
+   {
+      try
+      {
+         size_t length = 0;
+         const unsigned long value = std::stoul( text, &length );
+
+         if ( ( length != text.size() ) || ( text[0] == '-' ) ||
+              ( value > std::numeric_limits<unsigned>::max() ) )
+         {
+            return false;
+         }
+
+         count = static_cast<unsigned>( value );
+
+         return true;
+      }
+      catch ( const std::exception & )
+      {
+         return false;
+      }
+   }
+
+   bool verifyFile( const std::string &fileName, unsigned threadCount )
+   {
+      try
+      {
+         e57::ImageFile imf( fileName, "r" );
+
+         const e57::ImageFileVerification verification = imf.verify( threadCount );
+
+         imf.close();
+
+         std::cout << fileName << ": OK (" << verification.pageCount << " pages, "
+                   << verification.sectionCount << " sections, " << verification.packetCount
+                   << " packets)" << std::endl;
+
+         return true;
+      }
+      catch ( const e57::E57Exception &e )
+      {
+         std::cout << fileName << ": FAILED: " << e.errorStr() << " " << e.context()
+                   << std::endl;
+      }
+      catch ( const std::exception &e )
+      {
+         std::cout << fileName << ": FAILED: " << e.what() << std::endl;
+      }
+
+      return false;
+   }
+}
+
+int main( int argc, char *argv[] )
+{
+   unsigned threadCount = 0;
+   std::vector<std::string> fileNames;
+   bool options = true;
+
+   for ( int i = 1; i < argc; ++i )
+   {
+      const std::string arg = argv[i];
+
+      if ( !options || ( arg.size() < 2 ) || ( arg[0] != '-' ) )
+      {
+         fileNames.push_back( arg );
+      }
+      else if ( arg == "--" )
+      {
+         // Everything after this is a file, even if it starts with '-'
+         options = false;
+      }
+      else if ( ( arg == "-h" ) || ( arg == "--help" ) )
+      {
+         printUsage( std::cout );
+         return 0;
+      }
+      else if ( arg == "--threads" )
+      {
+         if ( ( ++i == argc ) || !parseCount( argv[i], threadCount ) )
+         {
+            std::cerr << "e57verify: --threads needs a count" << std::endl;
+            printUsage( std::cerr );
+            return 2;
+         }
+      }
+      else
+      {
+         std::cerr << "e57verify: unknown option " << arg << std::endl;
+         printUsage( std::cerr );
+         return 2;
+      }
+   }
+
+   if ( fileNames.empty() )
+   {
+      printUsage( std::cerr );
+      return 2;
+   }
+
+   bool allGood = true;
+
+   for ( const auto &fileName : fileNames )
+   {
+      allGood = verifyFile( fileName, threadCount ) && allGood;
+   }
+
+   return allGood ? 0 : 1;
+}